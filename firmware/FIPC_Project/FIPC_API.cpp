@@ -5,33 +5,87 @@
 
 #include "FIPC_API.h"
 
-#define NUMBER_MAX_OF_COMMAND 16 /*!< Numero de comando de lectura. */
+#define NUMBER_MAX_OF_COMMAND 32 /*!< Numero de comando de lectura. */
+#define SYNC_TIME_MARGIN      1.01 /*!< Margen sobre el tiempo mínimo para no alcanzar la velocidad máxima. */
 
 
 // Constructor.
-FIPC_API::FIPC_API(){
-  // Crea ejes
-  _axis[0] = new FIPC_Axis(1, STEP_01, DIR_01, EN, SW1_01, SW2_01, SW2_01);
-  _axis[1] = new FIPC_Axis(2, STEP_02, DIR_02, EN, SW1_02, SW2_02, SW2_02);
-  _axis[2] = new FIPC_Axis(3, STEP_03, DIR_03, EN, SW1_03, SW2_03, SW2_03);
-  _axis[3] = new FIPC_Axis(4, STEP_04, DIR_04, EN, SW1_04, SW2_04, SW2_04);
-  _axis[4] = new FIPC_Axis(5, STEP_05, DIR_05, EN, SW1_05, SW2_05, SW2_05);
-  _axis[5] = new FIPC_Axis(6, STEP_06, DIR_06, EN, SW1_06, SW2_06, SW2_06);
+// Todos los objetos son miembros de la API: no se reserva memoria dinámica.
+FIPC_API::FIPC_API() :
+  _axisStore{ {1, STEP_01, DIR_01, EN, SW1_01, SW2_01, SW2_01},
+              {2, STEP_02, DIR_02, EN, SW1_02, SW2_02, SW2_02},
+              {3, STEP_03, DIR_03, EN, SW1_03, SW2_03, SW2_03},
+              {4, STEP_04, DIR_04, EN, SW1_04, SW2_04, SW2_04},
+              {5, STEP_05, DIR_05, EN, SW1_05, SW2_05, SW2_05},
+              {6, STEP_06, DIR_06, EN, SW1_06, SW2_06, SW2_06},
+#if AXIS_NUMBERS>6
+              {7, STEP_07, DIR_07, EN, SW1_07, SW2_07, SW2_07},
+#endif
+#if AXIS_NUMBERS>7
+              {8, STEP_08, DIR_08, EN, SW1_08, SW2_08, SW2_08},
+#endif
+            },
+  _scan(_axis, AXIS_NUMBERS, &_budget),
+  _align(_axis, AXIS_NUMBERS, &_sensor, &_budget),
+  _tune(_axis, AXIS_NUMBERS, &_budget),
+  _kin(_axis, AXIS_NUMBERS, &_budget),
+  _limits(_axis, AXIS_NUMBERS),
+#if defined(ARDUINO_ARCH_ESP32)
+  _storage("fipc"),
+#else
+  _storage("fipc_nvs"),
+#endif
+  _config(&_storage, AXIS_NUMBERS),
+  _trajectory(&_storage),
+  _persist(_axis, AXIS_NUMBERS, &_storage),
+  _budget(_axis, AXIS_NUMBERS, &_storage),
+  _program(this, _axis, AXIS_NUMBERS, &_storage),
+  _recorder(_axis, AXIS_NUMBERS),
+  _sync(&_syncLine),
+  _out(_outBuffer, API_OUTPUT_SIZE),
+  _events(_eventBuffer, API_EVENT_SIZE) {
+  // Lista de ejes
+  for(uint8_t i = 0; i<AXIS_NUMBERS; i++){
+    _axis[i] = &_axisStore[i];
+    _axis[i]->setTrajectoryCache(&_trajectory);
+  }
 
-  // Configura los ejes
-  _axis[0]->setMotorStage(FIPC_Axis::MOX_02_30);
-  _axis[1]->setMotorStage(FIPC_Axis::MOX_02_30);
-  _axis[2]->setMotorStage(FIPC_Axis::MOX_02_30);
-  _axis[3]->setMotorStage(FIPC_Axis::MOR_100_30);
-  _axis[4]->setMotorStage(FIPC_Axis::MOG_65_10);
-  _axis[5]->setMotorStage(FIPC_Axis::MOG_65_15);
+  // Configuración por defecto, reemplazada en begin() por la guardada con "CFGW:" y "CFGC:".
+  // El switch de referencia es el fin de carrera negativo.
+  FIPC_API::setDefault(1, FIPC_Axis::MOX_02_30,  STEP_01, DIR_01, SW1_01, SW2_01);
+  FIPC_API::setDefault(2, FIPC_Axis::MOX_02_30,  STEP_02, DIR_02, SW1_02, SW2_02);
+  FIPC_API::setDefault(3, FIPC_Axis::MOX_02_30,  STEP_03, DIR_03, SW1_03, SW2_03);
+  FIPC_API::setDefault(4, FIPC_Axis::MOR_100_30, STEP_04, DIR_04, SW1_04, SW2_04);
+  FIPC_API::setDefault(5, FIPC_Axis::MOG_65_10,  STEP_05, DIR_05, SW1_05, SW2_05);
+  FIPC_API::setDefault(6, FIPC_Axis::MOG_65_15,  STEP_06, DIR_06, SW1_06, SW2_06);
+#if AXIS_NUMBERS>6
+  FIPC_API::setDefault(7, FIPC_Axis::MOX_02_30,  STEP_07, DIR_07, SW1_07, SW2_07);
+#endif
+#if AXIS_NUMBERS>7
+  FIPC_API::setDefault(8, FIPC_Axis::MOX_02_30,  STEP_08, DIR_08, SW1_08, SW2_08);
+#endif
+  FIPC_API::applyConfig();
 }
 
 
 // Proceso de ejecución en tiempo real
 void FIPC_API::exec(void* pvParameters){
-  _axis[0]->exec(); _axis[1]->exec(); _axis[2]->exec();
-  _axis[3]->exec(); _axis[4]->exec(); _axis[5]->exec();
+  uint32_t allocations = FIPC_Memory::getAllocations();
+  unsigned long start = _recorder.isRecording() ? micros() : 0;
+  _budget.exec();
+  uint32_t fired = _sync.exec();
+  if( fired ) _releaseEpoch = fired;
+  else if( _sync.getHeld() ) _sync.setReady(FIPC_API::isBatchReady(_sync.getHeld()));
+  uint32_t epoch = _releaseEpoch;
+  if( epoch!=_commitEpoch ) FIPC_API::commitActions(epoch);
+  _limits.exec();
+  _kin.exec();
+  for(uint8_t i = 0; i<AXIS_NUMBERS; i++) _axis[i]->exec();
+  _scan.exec();
+  _align.exec();
+  _tune.exec();
+  if( _recorder.isRecording() ) _recorder.exec(micros()-start);
+  FIPC_Memory::checkAllocations(allocations);
 }
 
     
@@ -39,50 +93,387 @@ void FIPC_API::exec(void* pvParameters){
 /* Begin: Public                          */
 
 // Método público de interfaz con la aplicación.
-String FIPC_API::request(String myString){
-  String out = "";
-  String command[NUMBER_MAX_OF_COMMAND];
-  int8_t count;
+const char* FIPC_API::request(const char* myString){
+  uint32_t allocations = FIPC_Memory::getAllocations();
 
   // lectura de comandos
-  count = FIPC_API::getCommands(myString,command);
+  strncpy(_line, myString, API_REQUEST_SIZE-1);
+  _line[API_REQUEST_SIZE-1] = '\0';
+  _recorder.request(_line);
+  FIPC_API::execute(_line, _out.clear());
+  LATENCY_END();
+
+  FIPC_Memory::checkAllocations(allocations);
+  return _out.c_str();
+}
+
+// Ejecuta una lista de comandos.
+void FIPC_API::execute(char* line, FIPC_Text &out){
+  const char* command[NUMBER_MAX_OF_COMMAND];
+  int8_t count = FIPC_API::getCommands(line,command);
+  LATENCY_PROBE(PROBE_PARSE);
   
   for(uint8_t i = 0; i<count; i++){
-    if( command[i].equals(API_Q_REPO_ALL))  out += getAllReport()+"\n"; 
-    if( command[i].equals(API_Q_REPO))      out += getReport(command[++i].toInt())+"\n";
-    if( command[i].equals(API_Q_STAT))      out += getStatus(command[++i].toInt())+"\n";
-    if( command[i].equals(API_Q_ISMOV))     out += isRunning(command[++i].toInt())+"\n";    
-    if( command[i].equals(API_Q_POS))       out += getCurrentPosition(command[++i].toInt())+"\n";
-    if( command[i].equals(API_Q_VELO))      out += getSpeed(command[++i].toInt())+"\n";
-    if( command[i].equals(API_Q_ACCEL))     out += getAccelerationTime(command[++i].toInt())+"\n"; 
-    if( command[i].equals(API_ENABLE))      requestAction(FIPC_Axis::ACTION_ENABLE); 
-    if( command[i].equals(API_DISABLE))     requestAction(FIPC_Axis::ACTION_DISABLE); 
-    if( command[i].equals(API_HOME_ALL))    requestAction(FIPC_Axis::ACTION_HOMING); 
-    if( command[i].equals(API_STOP_ALL))    requestAction(FIPC_Axis::ACTION_STOP); 
-    if( command[i].equals(API_HOME))        requestAction(FIPC_Axis::ACTION_HOMING,command[++i].toInt());
-    if( command[i].equals(API_STOP))        requestAction(FIPC_Axis::ACTION_STOP,command[++i].toInt());
-    if( command[i].equals(API_VELO))        setSpeed(command[++i].toInt(),command[++i].toFloat());
-    if( command[i].equals(API_ACCEL))       setAccelerationTime(command[++i].toInt(),command[++i].toFloat());
-    if( command[i].equals(API_RELATIVE))    requestAction(FIPC_Axis::ACTION_MOVE_RELATIVE,command[++i].toInt(),command[++i].toFloat());
-    if( command[i].equals(API_ABSOLUTE))    requestAction(FIPC_Axis::ACTION_MOVE_ABSOLUTE,command[++i].toInt(),command[++i].toFloat());
+    if( !strcmp(command[i],API_Q_REPO_ALL))  getAllReport(out); 
+    if( !strcmp(command[i],API_Q_REPO))      getReport(atoi(command[++i]),out);
+    if( !strcmp(command[i],API_Q_STAT))      getStatus(atoi(command[++i]),out);
+    if( !strcmp(command[i],API_Q_ISMOV))     isRunning(atoi(command[++i]),out);    
+    if( !strcmp(command[i],API_Q_POS))       getCurrentPosition(atoi(command[++i]),out);
+    if( !strcmp(command[i],API_Q_VELO))      getSpeed(atoi(command[++i]),out);
+    if( !strcmp(command[i],API_Q_ACCEL))     getAccelerationTime(atoi(command[++i]),out); 
+    if( !strcmp(command[i],API_ENABLE))      requestAction(FIPC_Axis::ACTION_ENABLE); 
+    if( !strcmp(command[i],API_DISABLE))     requestAction(FIPC_Axis::ACTION_DISABLE); 
+    if( !strcmp(command[i],API_HOME_ALL))    requestAction(FIPC_Axis::ACTION_HOMING); 
+    if( !strcmp(command[i],API_STOP_ALL))    { _program.stop(); _scan.stop(); _align.stop(); _tune.stop(); _kin.stop(); requestAction(FIPC_Axis::ACTION_STOP); }
+    if( !strcmp(command[i],API_HOME))        requestAction(FIPC_Axis::ACTION_HOMING,atoi(command[++i]));
+    if( !strcmp(command[i],API_STOP))        requestAction(FIPC_Axis::ACTION_STOP,atoi(command[++i]));
+    if( !strcmp(command[i],API_RESTORE_ALL)) requestAction(FIPC_Axis::ACTION_RESTORE); 
+    if( !strcmp(command[i],API_RESTORE))     requestAction(FIPC_Axis::ACTION_RESTORE,atoi(command[++i]));
+    if( !strcmp(command[i],API_Q_STORE))     { _persist.getReport(atoi(command[++i]),out); out.add('\n'); }
+    if( !strcmp(command[i],API_Q_MEMORY))    { _memory.getReport(out); out.add('\n'); }
+
+    // Grabación de la sesión
+    if( !strcmp(command[i],API_RECORD) )     { if( atoi(command[++i]) ) _recorder.start(); else _recorder.stop(); }
+    if( !strcmp(command[i],API_Q_RECORD))    { _recorder.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_Q_RECORD_DATA)) { _recorder.getData(atoi(command[++i]), out); out.add('\n'); }
+
+    // Sincronización con otros controladores
+    if( !strcmp(command[i],API_LINK) )       { FIPC_API::cancelHold(); uint8_t role = atoi(command[++i]); _sync.setRole(role, atoi(command[++i])); }
+    if( !strcmp(command[i],API_LINK_ARM) )   _sync.arm();
+    if( !strcmp(command[i],API_LINK_FIRE) )  _sync.fire();
+    if( !strcmp(command[i],API_LINK_CANCEL)) FIPC_API::cancelHold();
+    if( !strcmp(command[i],API_Q_LINK))      { _sync.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_Q_CLOCK))     out.add((unsigned long)micros()).add('\n');
+
+    // Tablas de las rampas
+    if( !strcmp(command[i],API_TCACHE) )     { bool ok = atoi(command[++i]) ? _trajectory.save() : _trajectory.clear(); out.add(ok ? "1\n" : "0\n"); }
+    if( !strcmp(command[i],API_Q_TCACHE))    { _trajectory.getReport(out); out.add('\n'); }
+
+    // Latencia de los comandos
+    if( !strcmp(command[i],API_LATENCY_CLEAR)) FIPC_Latency::clear();
+    if( !strcmp(command[i],API_Q_LATENCY))     { FIPC_Latency::getReport(atoi(command[++i]), out); out.add('\n'); }
+    if( !strcmp(command[i],API_Q_LATENCY_HIST)) { FIPC_Latency::getHistogram(atoi(command[++i]), out); out.add('\n'); }
+
+    // Presupuesto de la frecuencia de pasos
+    if( !strcmp(command[i],API_BUDGET))      _budget.setMode(atoi(command[++i]));
+    if( !strcmp(command[i],API_BUDGET_CAL))  out.add(_budget.calibrate(atol(command[++i])) ? "1\n" : "0\n");
+    if( !strcmp(command[i],API_Q_BUDGET))    { _budget.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_Q_SHIFT))     { FIPC_ShiftOut::getReport(out); out.add('\n'); }
+
+    // Configuración de los ejes
+    if( !strcmp(command[i],API_Q_CONFIG))      { _config.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_Q_CONFIG_DATA)) { _config.getBlob(out); out.add('\n'); }
+    if( !strcmp(command[i],API_CONFIG_COMMIT)) out.add(FIPC_API::commitConfig() ? "1\n" : "0\n");
+    if( !strcmp(command[i],API_CONFIG_WRITE) ){
+      uint16_t offset = atoi(command[++i]);
+      out.add(_config.upload(offset, command[++i]) ? "1\n" : "0\n");
+    }
+    // Los argumentos se leen en orden antes de la llamada: el orden de evaluación de los
+    // argumentos de una función no está definido
+    if( !strcmp(command[i],API_VELO) ){
+      int8_t id = atoi(command[++i]);
+      setSpeed(id,atof(command[++i]));
+    }
+    if( !strcmp(command[i],API_ACCEL) ){
+      int8_t id = atoi(command[++i]);
+      setAccelerationTime(id,atof(command[++i]));
+    }
+    if( !strcmp(command[i],API_RELATIVE) ){
+      int8_t id = atoi(command[++i]);
+      requestAction(FIPC_Axis::ACTION_MOVE_RELATIVE,id,atof(command[++i]));
+    }
+    if( !strcmp(command[i],API_ABSOLUTE) ){
+      int8_t id = atoi(command[++i]);
+      requestAction(FIPC_Axis::ACTION_MOVE_ABSOLUTE,id,atof(command[++i]));
+    }
+
+    // Modo velocidad
+    if( !strcmp(command[i],API_JOG) ){
+      int8_t id = atoi(command[++i]);
+      requestAction(FIPC_Axis::ACTION_JOG,id,atof(command[++i]));
+    }
+    if( !strcmp(command[i],API_JOG_ALL) ){
+      float speed[AXIS_NUMBERS], rate[AXIS_NUMBERS], scale;
+      for(uint8_t j = 0; j<AXIS_NUMBERS; j++){
+        speed[j] = atof(command[++i]);
+        rate[j] = (speed[j]) ? _axis[j]->getExecRate(FIPC_Axis::ACTION_JOG, speed[j]) : BUDGET_KEEP;
+      }
+      if( _budget.admit(rate, scale) ){
+        uint32_t epoch = FIPC_API::armBegin();
+        for(uint8_t j = 0; j<AXIS_NUMBERS; j++) _axis[j]->armAction(epoch, FIPC_Axis::ACTION_JOG, speed[j]*scale);
+        FIPC_API::release(epoch);
+      }
+    }
+    if( !strcmp(command[i],API_JOG_TIMEOUT) ){
+      uint16_t timeout = atoi(command[++i]);
+      for(uint8_t j = 0; j<AXIS_NUMBERS; j++) _axis[j]->setJogTimeout(timeout);
+    }
 
     // get Sync motion
-    if( command[i].equals(API_SYNC_REL) ){
+    if( !strcmp(command[i],API_SYNC_REL) ){
       float iDist[AXIS_NUMBERS];
-      for(uint8_t j = 0; j<AXIS_NUMBERS; j++) iDist[j] = command[++i].toFloat();
-      FIPC_API::syncMotionRel(iDist, command[++i].toFloat(), command[++i].toFloat());
+      for(uint8_t j = 0; j<AXIS_NUMBERS; j++) iDist[j] = atof(command[++i]);
+      float iTimeSpeed = atof(command[++i]);
+      FIPC_API::syncMotionRel(iDist, iTimeSpeed, atof(command[++i]));
     }
 
     // get Sync motion
-    if( command[i].equals(API_SYNC_ABS) ){
+    if( !strcmp(command[i],API_SYNC_ABS) ){
+      float iAbsolute[AXIS_NUMBERS];
+      for(uint8_t j = 0; j<AXIS_NUMBERS; j++) iAbsolute[j] = atof(command[++i]);
+      float iTimeSpeed = atof(command[++i]);
+      FIPC_API::syncMotionAbs(iAbsolute, iTimeSpeed, atof(command[++i]));
+    }
+
+    // Estimación de desplazamientos sin ejecutarlos
+    if( !strcmp(command[i],API_Q_TIME_REL) ){
+      uint8_t id = atoi(command[++i]);
+      estimateMoveRelative(id, atof(command[++i]), out);
+    }
+    if( !strcmp(command[i],API_Q_TIME_ABS) ){
+      uint8_t id = atoi(command[++i]);
+      float iAbsolute = atof(command[++i]);
+      if( (id>0)&&(id<=AXIS_NUMBERS) ) iAbsolute -= _axis[id-1]->getCurrentPosition();
+      estimateMoveRelative(id, iAbsolute, out);
+    }
+    if( !strcmp(command[i],API_Q_TIME_BATCH) ){
+      uint8_t id = atoi(command[++i]);
+      uint8_t n  = atoi(command[++i]);
+      float current = ((id>0)&&(id<=AXIS_NUMBERS)) ? _axis[id-1]->getCurrentPosition() : 0.0;
+      for(uint8_t j = 0; (j<n)&&(i+1<count); j++)
+        estimateMoveRelative(id, atof(command[++i])-current, out);
+    }
+    if( !strcmp(command[i],API_Q_TIME_SYNC) ){
+      float iDist[AXIS_NUMBERS];
+      for(uint8_t j = 0; j<AXIS_NUMBERS; j++) iDist[j] = atof(command[++i]);
+      float iTimeSpeed = atof(command[++i]);
+      estimateSyncMotionRel(iDist, iTimeSpeed, atof(command[++i]), out);
+    }
+
+    // Barridos
+    if( !strcmp(command[i],API_Q_SCAN))      { _scan.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_SCAN_START))  out.add(_scan.start() ? "1\n" : "0\n");
+    if( !strcmp(command[i],API_SCAN_STOP))   _scan.stop();
+    if( !strcmp(command[i],API_SCAN_TRIG) ){
+      uint8_t pin = atoi(command[++i]);
+      _scan.setTrigger(pin, atoi(command[++i]));
+    }
+    if( !strcmp(command[i],API_SCAN) ){
+      uint8_t type = atoi(command[++i]);
+      uint8_t id[SCAN_AXIS_NUMBERS];
+      float start[SCAN_AXIS_NUMBERS], pitch[SCAN_AXIS_NUMBERS];
+      uint16_t points[SCAN_AXIS_NUMBERS];
+      for(uint8_t j = 0; j<SCAN_AXIS_NUMBERS; j++) id[j]     = atoi(command[++i]);
+      for(uint8_t j = 0; j<SCAN_AXIS_NUMBERS; j++) start[j]  = atof(command[++i]);
+      for(uint8_t j = 0; j<SCAN_AXIS_NUMBERS; j++) pitch[j]  = atof(command[++i]);
+      for(uint8_t j = 0; j<SCAN_AXIS_NUMBERS; j++) points[j] = atoi(command[++i]);
+      out.add(_scan.setScan(type, id, start, pitch, points, atof(command[++i])) ? "1\n" : "0\n");
+    }
+
+    // Salida sincronizada con la posición
+    if( !strcmp(command[i],API_Q_PSO) ){
+      uint8_t id = atoi(command[++i]);
+      if( getPSO(id) ) getPSO(id)->getReport(out);
+      else             out.add("0;0;0;0");
+      out.add('\n');
+    }
+    if( !strcmp(command[i],API_PSO_OUT) ){
+      uint8_t id  = atoi(command[++i]);
+      uint8_t pin = atoi(command[++i]);
+      uint8_t mode = atoi(command[++i]);
+      if( getPSO(id) ) getPSO(id)->setOutput(pin, mode);
+    }
+    if( !strcmp(command[i],API_PSO_OFF) ){
+      uint8_t id = atoi(command[++i]);
+      if( getPSO(id) ) getPSO(id)->disarm();
+    }
+    if( !strcmp(command[i],API_PSO_PITCH) ){
+      uint8_t id  = atoi(command[++i]);
+      float start = atof(command[++i]);
+      float pitch = atof(command[++i]);
+      uint32_t n  = atoi(command[++i]);
+      bool ok = false;
+      if( getPSO(id) ){
+        float factor = _axis[id-1]->getStepsPerUnit();
+        ok = getPSO(id)->armPitch(start*factor, pitch*factor, n);
+      }
+      out.add(ok ? "1\n" : "0\n");
+    }
+    if( !strcmp(command[i],API_PSO_TABLE) ){
+      uint8_t id = atoi(command[++i]);
+      uint8_t n  = atoi(command[++i]);
+      bool ok = (getPSO(id)!=NULL);
+      if( ok ) getPSO(id)->disarm();
+      for(uint8_t j = 0; (j<n)&&(i+1<count); j++){
+        float position = atof(command[++i]);
+        if( ok ) ok = getPSO(id)->addTable(lroundf(position*_axis[id-1]->getStepsPerUnit()));
+      }
+      if( ok ) ok = getPSO(id)->armTable();
+      out.add(ok ? "1\n" : "0\n");
+    }
+
+    // Búsqueda del máximo de potencia óptica
+    if( !strcmp(command[i],API_Q_ALIGN))     { _align.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_ALIGN_STOP))  _align.stop();
+    if( !strcmp(command[i],API_ALIGN_ADC) ){
+      _sensor.setPin(atoi(command[++i]));
+      _align.setSensor(&_sensor, atoi(command[++i]));
+    }
+    if( !strcmp(command[i],API_ALIGN) ){
+      uint8_t type = atoi(command[++i]);
+      uint8_t id[ALIGN_AXIS_NUMBERS];
+      for(uint8_t j = 0; j<ALIGN_AXIS_NUMBERS; j++) id[j] = atoi(command[++i]);
+      float step    = atof(command[++i]);
+      float minStep = atof(command[++i]);
+      uint16_t maxEval = atoi(command[++i]);
+      out.add(_align.start(type, id, step, minStep, maxEval, atof(command[++i])) ? "1\n" : "0\n");
+    }
+
+    // Caracterización de los límites de un eje
+    if( !strcmp(command[i],API_Q_TUNE))      { _tune.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_TUNE_STOP))   _tune.stop();
+    if( !strcmp(command[i],API_TUNE) ){
+      uint8_t id = atoi(command[++i]);
+      float distance = atof(command[++i]);
+      uint16_t cycles = atoi(command[++i]);
+      out.add(_tune.start(id, distance, cycles, atof(command[++i])) ? "1\n" : "0\n");
+    }
+
+    // Desplazamientos de la herramienta alrededor del pivote
+    if( !strcmp(command[i],API_Q_KIN))       { _kin.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_KIN_PIVOT) ){
+      float pivot[3];
+      for(uint8_t j = 0; j<3; j++) pivot[j] = atof(command[++i]);
+      out.add(_kin.setPivot(pivot) ? "1\n" : "0\n");
+    }
+    if( (!strcmp(command[i],API_KIN_ABS))||(!strcmp(command[i],API_KIN_REL)) ){
+      bool absolute = !strcmp(command[i],API_KIN_ABS);
+      float pose[KIN_AXIS_NUMBERS];
+      for(uint8_t j = 0; j<KIN_AXIS_NUMBERS; j++) pose[j] = atof(command[++i]);
+      float iTimeSpeed = atof(command[++i]);
+      float iAccelTime = atof(command[++i]);
+      float time = absolute ? _kin.moveAbsolute(pose, iTimeSpeed, iAccelTime) : _kin.moveRelative(pose, iTimeSpeed, iAccelTime);
+      out.add(time,3).add('\n');
+    }
+
+    // Programas almacenados
+    if( !strcmp(command[i],API_Q_PROGRAM))     { _program.getReport(out); out.add('\n'); }
+    if( !strcmp(command[i],API_Q_PROGRAM_VAR)) { _program.getVariable(atoi(command[++i]),out); out.add('\n'); }
+    if( !strcmp(command[i],API_PROGRAM_COMMIT)) out.add(_program.commit() ? "1\n" : "0\n");
+    if( !strcmp(command[i],API_PROGRAM_RUN))    out.add(_program.start() ? "1\n" : "0\n");
+    if( !strcmp(command[i],API_PROGRAM_STOP))   _program.stop();
+    if( !strcmp(command[i],API_PROGRAM_WRITE) ){
+      uint16_t offset = atoi(command[++i]);
+      out.add(_program.upload(offset, command[++i]) ? "1\n" : "0\n");
+    }
+
+    // get Sync motion (menor tiempo posible)
+    if( !strcmp(command[i],API_SYNC_REL_FAST) ){
+      float iDist[AXIS_NUMBERS];
+      for(uint8_t j = 0; j<AXIS_NUMBERS; j++) iDist[j] = atof(command[++i]);
+      out.add(FIPC_API::syncMotionRelFast(iDist),3).add('\n');
+    }
+
+    // get Sync motion (menor tiempo posible)
+    if( !strcmp(command[i],API_SYNC_ABS_FAST) ){
       float iAbsolute[AXIS_NUMBERS];
-      for(uint8_t j = 0; j<AXIS_NUMBERS; j++) iAbsolute[j] = command[++i].toFloat();
-      FIPC_API::syncMotionAbs(iAbsolute, command[++i].toFloat(), command[++i].toFloat());
+      for(uint8_t j = 0; j<AXIS_NUMBERS; j++) iAbsolute[j] = atof(command[++i]);
+      out.add(FIPC_API::syncMotionAbsFast(iAbsolute),3).add('\n');
     }
 
   }// END FOR
+}
+
+// Retorna los eventos asincrónicos pendientes.
+const char* FIPC_API::getEvents(){
+  uint32_t allocations = FIPC_Memory::getAllocations();
+  FIPC_Text &out = _events.clear();
+  _limits.getEvents(out);
+  _budget.getEvents(out);
+  if( _scan.finished() )  { out.add("SCAN:");  _scan.getReport(out);  out.add('\n'); }
+  if( _align.finished() ) { out.add("ALIGN:"); _align.getReport(out); out.add('\n'); }
+  if( _tune.finished() )  { out.add("TUNE:");  _tune.getReport(out);  out.add('\n'); }
+  if( _kin.finished() )   { out.add("KIN:");   _kin.getReport(out);   out.add('\n'); }
+  if( _program.finished() ) { out.add("PRG:"); _program.getReport(out); out.add('\n'); }
+  FIPC_Memory::checkAllocations(allocations);
+  return out.c_str();
+}
+
+// Lee la configuración y las posiciones guardadas.
+void FIPC_API::begin(){
+#if SHIFT_ENABLED
+  FIPC_ShiftOut::begin(SHIFT_DATA, SHIFT_CLOCK, SHIFT_LATCH);
+#endif
+  if( _config.begin() ) FIPC_API::applyConfig();
+  _persist.begin();
+  _program.begin();
+  _trajectory.begin();
+  _budget.begin();
+}
+
+// Guarda las posiciones pendientes.
+void FIPC_API::persist(){
+  _persist.service();
+  _budget.service();
+
+  // Límites medidos por la caracterización
+  uint8_t id;
+  float veloMax, accelMax;
+  if( _tune.getResult(id, veloMax, accelMax) ) _config.setLimits(id, veloMax, accelMax);
+}
+
+// Registra una tarea para informar su pila libre.
+void FIPC_API::addTask(void* pTask){
+  _memory.addTask(pTask);
+}
+
+// Ejecuta el programa almacenado.
+void FIPC_API::runProgram(){
+  _program.service();
+}
 
-  return out;
+// Lee la entrada analógica de potencia óptica.
+void FIPC_API::sample(){
+  _sensor.sample();
+}
+
+// Verifica si los ejes indicados están en reposo.
+bool FIPC_API::isIdle(uint8_t mask){
+  // Una acción de un lote liberado que todavía no se aplicó (ver isBatchReady()) no está en reposo
+  uint32_t epoch = _releaseEpoch;
+  for(uint8_t i = 0; i<AXIS_NUMBERS; i++)
+    if( (mask&(1<<i))&&((!_axis[i]->isIdle())||(_axis[i]->isArmed(epoch))) ) return false;
+
+  // Barridos, alineaciones, caracterizaciones y desplazamientos de la herramienta mueven ejes
+  uint8_t scan = _scan.getStatus(), align = _align.getStatus(), kin = _kin.getStatus();
+  if( (scan==FIPC_Scan::SCAN_MOVE)||(scan==FIPC_Scan::SCAN_LINE) ) return false;
+  if( (align==FIPC_Align::ALIGN_MOVE)||(align==FIPC_Align::ALIGN_SAMPLE)||(align==FIPC_Align::ALIGN_FINISH) ) return false;
+  if( _tune.isRunning() ) return false;
+  if( (kin==FIPC_Kinematics::KIN_START)||(kin==FIPC_Kinematics::KIN_RUN)||(kin==FIPC_Kinematics::KIN_FINISH) ) return false;
+  return true;
+}
+
+// Escribe el estado de los ejes para la telemetría.
+void FIPC_API::getTelemetry(FIPC_Text &out){
+  uint8_t moving = 0;
+  for(uint8_t i = 0; i<AXIS_NUMBERS; i++){
+    out.add(_axis[i]->getCurrentPosition(),2).add(';');
+    if( _axis[i]->isRunning() ) moving |= 1<<i;
+  }
+  out.add((unsigned int)moving);
+}
+
+// Desplazamiento sincrónico en coordenadas absolutas.
+float FIPC_API::moveSync(float iAbsolute[], float iTimeSpeed, float iAccelTime){
+  if( iTimeSpeed<=0.0 ) return FIPC_API::syncMotionAbsFast(iAbsolute);
+  if( !FIPC_API::syncMotionAbs(iAbsolute, iTimeSpeed, iAccelTime) ) return -1.0;
+  return iTimeSpeed+iAccelTime;
+}
+
+// Desplazamiento de un eje.
+bool FIPC_API::moveAxis(int8_t id, bool iAbsolute, float iData){
+  if( (id<1)||(id>AXIS_NUMBERS) ) return false;
+  return FIPC_API::requestAction(iAbsolute ? FIPC_Axis::ACTION_MOVE_ABSOLUTE : FIPC_Axis::ACTION_MOVE_RELATIVE, id, iData);
 }
 
 /* End: Public                            */
@@ -94,24 +485,93 @@ String FIPC_API::request(String myString){
 /* Begin: Private                         */
 
 // Intérprete de comandos
-int8_t FIPC_API::getCommands(String myString, String command[]){
-  String myTrimString = myString;
-  int8_t auxIndex, count;
+int8_t FIPC_API::getCommands(char* line, const char* command[]){
+  char* auxIndex;
+  int8_t count;
   
   for(count=0; count<NUMBER_MAX_OF_COMMAND; count++){
-    auxIndex = myTrimString.indexOf(':');
-    if( auxIndex==-1 ) break; // check if exist other command
-    command[count] = myTrimString.substring(0,auxIndex);
-    myTrimString = myTrimString.substring(auxIndex+1);    
+    auxIndex = strchr(line, ':');
+    if( auxIndex==NULL ) break; // check if exist other command
+    *auxIndex = '\0';
+    command[count] = line;
+    line = auxIndex+1;
   }
+  for(int8_t i = count; i<NUMBER_MAX_OF_COMMAND; i++) command[i] = "";
   
   return count;    
 }
 
 // Solicitud de acciones a los ejes
-void FIPC_API::requestAction(uint8_t action, int8_t id, float iData){  
-  for (uint8_t i = 0; i<AXIS_NUMBERS; i++) // if (id = -1) same request to all axis
-    if( (id==i+1)||(id==-1) ) _axis[i]->setAction(action,iData);
+bool FIPC_API::requestAction(uint8_t action, int8_t id, float iData){  
+  // La parada y la deshabilitación no se retienen (ver FIPC_Axis::armAction())
+  if( (action==FIPC_Axis::ACTION_STOP)||(action==FIPC_Axis::ACTION_DISABLE) ) FIPC_API::cancelHold();
+
+  // Presupuesto de pasos de la acción de un eje o de todos ("HA:" busca el cero en todos)
+  // La búsqueda del cero y el seguimiento no se estiran
+  float data[AXIS_NUMBERS], speed[AXIS_NUMBERS], scale;
+  uint8_t i;
+  for (i = 0; i<AXIS_NUMBERS; i++){ data[i] = iData; speed[i] = 0.0; }
+  bool move = (action==FIPC_Axis::ACTION_MOVE_RELATIVE)||(action==FIPC_Axis::ACTION_MOVE_ABSOLUTE);
+  bool stretch = (move)||(action==FIPC_Axis::ACTION_JOG);
+  if( (id>0)&&(id<=AXIS_NUMBERS) ){
+    if( !_budget.admit(&_axis[id-1], 1, action, data, scale, stretch) ) return false;
+  } else if( !_budget.admit(_axis, AXIS_NUMBERS, action, data, scale, stretch) ) return false;
+  if( scale<1.0 ){
+    // El desplazamiento toma la velocidad al prepararse y el eje sigue en reposo hasta que el
+    // lote se libera: la velocidad configurada se restaura antes de release()
+    if( action==FIPC_Axis::ACTION_JOG ) iData *= scale;
+    if( move )
+      for (i = 0; i<AXIS_NUMBERS; i++)
+        if( (id==i+1)||(id==-1) ){ speed[i] = _axis[i]->getSpeed(); _axis[i]->setSpeed(speed[i]*scale); }
+  }
+
+  bool accepted = false;
+  uint32_t epoch = FIPC_API::armBegin();
+  for (i = 0; i<AXIS_NUMBERS; i++){ // if (id = -1) same request to all axis
+    if( (id!=i+1)&&(id!=-1) ) continue;
+    // "SA:" desacelera la herramienta sobre la trayectoria (ver FIPC_Kinematics::stop())
+    if( (id==-1)&&(action==FIPC_Axis::ACTION_STOP)&&(_axis[i]->isTracking()) ) continue;
+    if( _axis[i]->armAction(epoch,action,iData) ) accepted = true;
+  }
+  for (i = 0; i<AXIS_NUMBERS; i++)
+    if( speed[i]>0.0 ) _axis[i]->setSpeed(speed[i]);
+  FIPC_API::release(epoch);
+  return accepted;
+}
+
+// Abre un lote de acciones que se aplican en un mismo ciclo de exec().
+uint32_t FIPC_API::armBegin(){
+  uint32_t epoch = _releaseEpoch+1;
+  return epoch ? epoch : 1; // 0 indica que no hay lote en preparación
+}
+
+// Libera un lote de acciones, o lo retiene hasta el disparo.
+void FIPC_API::release(uint32_t epoch){
+  if( !_sync.hold(epoch) ) _releaseEpoch = epoch;
+}
+
+// Cancela las acciones retenidas hasta el disparo.
+void FIPC_API::cancelHold(){
+  if( !_sync.cancel() ) return;
+  for (uint8_t i = 0; i<AXIS_NUMBERS; i++) _axis[i]->disarm();
+}
+
+// Verifica si un lote puede aplicarse en este ciclo.
+// Se consultan todos los ejes para que guarden su posición en paralelo.
+bool FIPC_API::isBatchReady(uint32_t epoch){
+  bool ready = true;
+  for (uint8_t i = 0; i<AXIS_NUMBERS; i++)
+    if( (_axis[i]->isArmed(epoch))&&(!_axis[i]->isArmedReady()) ) ready = false;
+  return ready;
+}
+
+// Aplica las acciones preparadas de los lotes liberados.
+// Se aplican todas en el mismo ciclo: si un eje todavía no guardó su posición, esperan todos.
+void FIPC_API::commitActions(uint32_t epoch){
+  if( !FIPC_API::isBatchReady(epoch) ) return;
+  for (uint8_t i = 0; i<AXIS_NUMBERS; i++)
+    if( _axis[i]->isArmed(epoch) ) _axis[i]->commit();
+  _commitEpoch = epoch;
 }       
 
 // Configuración de velocidad
@@ -127,70 +587,194 @@ void FIPC_API::setAccelerationTime(int8_t id, float iData){
 }       
 
 // Genera una solicitud de movimiento sincrónico en coordenadas relativas.
-void FIPC_API::syncMotionRel(float iDist[],float iTimeSpeed, float iAccelTime){  
+bool FIPC_API::syncMotionRel(float iDist[],float iTimeSpeed, float iAccelTime){  
   // Primero verifica que todos los desplazamiento puedan realizarse
   // y luego realiza la solicitud a cada eje
   uint8_t i;
   for (i = 0; i<AXIS_NUMBERS; i++) // check if can move that distance    
-    if( (iDist[i])&&(!_axis[i]->canMoveRelative(iDist[i])) ) return;  
+    if( (iDist[i])&&(!_axis[i]->canMoveRelative(iDist[i])) ) return false;  
     
   for (i = 0; i<AXIS_NUMBERS; i++) // check and config speeds
-    if( (iDist[i])&&(!_axis[i]->setSpeed(abs(iDist[i])/iTimeSpeed)) ) return;  
+    if( (iDist[i])&&(!_axis[i]->setSpeed(abs(iDist[i])/iTimeSpeed)) ) return false;  
 
   for (i = 0; i<AXIS_NUMBERS; i++) // check and config acceleration times
-    if( (iDist[i])&&(!_axis[i]->setAccelerationTime(iAccelTime)) ) return;  
-
+    if( (iDist[i])&&(!_axis[i]->setAccelerationTime(iAccelTime)) ) return false;  
+
+  // Presupuesto de pasos: estirar el desplazamiento reduce todas las velocidades por igual
+  float rate[AXIS_NUMBERS], scale;
+  for (i = 0; i<AXIS_NUMBERS; i++)
+    rate[i] = (iDist[i]) ? _axis[i]->getExecRate(FIPC_Axis::ACTION_MOVE_RELATIVE, iDist[i]) : BUDGET_KEEP;
+  if( !_budget.admit(rate, scale) ) return false;
+  if( scale<1.0 )
+    for (i = 0; i<AXIS_NUMBERS; i++)
+      if( iDist[i] ) _axis[i]->setSpeed(abs(iDist[i])*scale/iTimeSpeed);
+
+  uint32_t epoch = FIPC_API::armBegin();
   for (i = 0; i<AXIS_NUMBERS; i++) // if all config were accepeted, then request action
-    if( iDist[i] ) _axis[i]->setAction(FIPC_Axis::ACTION_MOVE_RELATIVE,iDist[i]);    
+    if( iDist[i] ) _axis[i]->armAction(epoch,FIPC_Axis::ACTION_MOVE_RELATIVE,iDist[i]);    
+  FIPC_API::release(epoch); // todos los ejes inician en el mismo ciclo de exec()
+  return true;
 }
 
 // Genera una solicitud de movimiento sincrónico en coordenadas absolutas.
-void FIPC_API::syncMotionAbs(float iAbsolute[],float iTimeSpeed, float iAccelTime){  
+bool FIPC_API::syncMotionAbs(float iAbsolute[],float iTimeSpeed, float iAccelTime){  
   // Primero debe calcular la distancia y llama a la funcion
   // de movimiento sincrónico
   float iDist[AXIS_NUMBERS];
   for (uint8_t i = 0; i<AXIS_NUMBERS; i++) // check if can move that distance    
-    iDist[i] = iAbsolute[i]-(_axis[i]->getCurrentPosition()).toFloat();
+    iDist[i] = iAbsolute[i]-_axis[i]->getCurrentPosition();
 
-  FIPC_API::syncMotionRel(iDist,iTimeSpeed, iAccelTime);  
+  return FIPC_API::syncMotionRel(iDist,iTimeSpeed, iAccelTime);  
+}
+
+// Genera un movimiento sincrónico en coordenadas relativas en el menor tiempo posible.
+float FIPC_API::syncMotionRelFast(float iDist[]){
+  // Con un perfil trapezoidal común, cada eje cumple v = d/T y a = d/(T*ta).
+  // tCruise: menor T que respeta la velocidad máxima del eje más lento.
+  // kAccel:  menor T*ta que respeta la aceleración máxima del eje más lento.
+  float tCruise = 0.0, kAccel = 0.0;
+  for (uint8_t i = 0; i<AXIS_NUMBERS; i++){
+    if( !iDist[i] ) continue;
+    tCruise = max(tCruise, (float)(abs(iDist[i])/_axis[i]->getMaxSpeed()));
+    kAccel  = max(kAccel,  (float)(abs(iDist[i])/_axis[i]->getMaxAcceleration()));
+  }
+  if( tCruise==0.0 ) return 0.0; // no hay desplazamiento
+
+  // Si el perfil resulta triangular (T = ta) se limita por aceleración,
+  // en caso contrario la velocidad máxima define el tiempo de crucero.
+  float iTimeSpeed, iAccelTime;
+  if( tCruise*tCruise<kAccel ){
+    iTimeSpeed = iAccelTime = sqrt(kAccel);
+  } else {
+    iTimeSpeed = tCruise;
+    iAccelTime = kAccel/tCruise;
+  }
+  iTimeSpeed *= SYNC_TIME_MARGIN;
+
+  if( !FIPC_API::syncMotionRel(iDist, iTimeSpeed, iAccelTime) ) return -1.0;
+  return iTimeSpeed/_budget.getScale()+iAccelTime; // el presupuesto puede estirar el crucero
+}
+
+// Genera un movimiento sincrónico en coordenadas absolutas en el menor tiempo posible.
+float FIPC_API::syncMotionAbsFast(float iAbsolute[]){
+  float iDist[AXIS_NUMBERS];
+  for (uint8_t i = 0; i<AXIS_NUMBERS; i++)
+    iDist[i] = iAbsolute[i]-_axis[i]->getCurrentPosition();
+
+  return FIPC_API::syncMotionRelFast(iDist);
 }
 
 // Retorna un reporte del estado de un eje.
-String FIPC_API::getReport(uint8_t id){
-  return _axis[id-1]->getReport();  
+void FIPC_API::getReport(uint8_t id, FIPC_Text &out){
+  _axis[id-1]->getReport(out);
+  out.add('\n');
 }
 
 // Retorna un reporte completo.
-String FIPC_API::getAllReport(){
-  String report = "";
+void FIPC_API::getAllReport(FIPC_Text &out){
   for(uint8_t i = 0; i<AXIS_NUMBERS; i++)
-    report = report + FIPC_API::getReport(i+1)+"\n";
-  return report;  
+    FIPC_API::getReport(i+1, out);
+  out.add('\n');
 }
 
 // Retorna la velocidad configurada de un eje.
-String FIPC_API::getSpeed(uint8_t id){
-  return _axis[id-1]->getSpeed();  
+void FIPC_API::getSpeed(uint8_t id, FIPC_Text &out){
+  out.add(_axis[id-1]->getSpeed(),2).add('\n');
 }
 
 // Retorna el tiempo de aceleración configurado de un eje.
-String FIPC_API::getAccelerationTime(uint8_t id){
-  return _axis[id-1]->getAccelerationTime();  
+void FIPC_API::getAccelerationTime(uint8_t id, FIPC_Text &out){
+  out.add(_axis[id-1]->getAccelerationTime(),2).add('\n');
 }
 
 // Retorna la posición absoluta de un eje.
-String FIPC_API::getCurrentPosition(uint8_t id){
-  return _axis[id-1]->getCurrentPosition();  
+void FIPC_API::getCurrentPosition(uint8_t id, FIPC_Text &out){
+  out.add(_axis[id-1]->getCurrentPosition(),2).add('\n');
 }
 
 // Verifica si un eje se está moviendo.
-String FIPC_API::isRunning(uint8_t id){
-  return _axis[id-1]->isRunning();  
+void FIPC_API::isRunning(uint8_t id, FIPC_Text &out){
+  out.add(_axis[id-1]->isRunning() ? "1\n" : "0\n");
 }
 
 // Retorna el estado de un eje.
-String FIPC_API::getStatus(uint8_t id){
-  return _axis[id-1]->getStatus();  
+void FIPC_API::getStatus(uint8_t id, FIPC_Text &out){
+  out.add(_axis[id-1]->getStatus()).add('\n');
+}
+
+// Estima un desplazamiento relativo de un eje sin ejecutarlo.
+void FIPC_API::estimateMoveRelative(uint8_t id, float iRelative, FIPC_Text &out){
+  if( (id==0)||(id>AXIS_NUMBERS) ){
+    out.add("0;0.00;0.00\n");
+    return;
+  }
+  float oTime, oPeak;
+  bool feasible = _axis[id-1]->estimateMoveRelative(iRelative, oTime, oPeak);
+  out.add(feasible ? "1;" : "0;").add(oTime,2).add(';').add(oPeak,2).add('\n');
+}
+
+// Estima un desplazamiento sincrónico en coordenadas relativas sin ejecutarlo.
+void FIPC_API::estimateSyncMotionRel(float iDist[], float iTimeSpeed, float iAccelTime, FIPC_Text &out){
+  // Mismo criterio que syncMotionRel(): cada eje se desplaza a abs(iDist)/iTimeSpeed
+  if( (iTimeSpeed<=0.0)||(iAccelTime<=0.0) ){
+    out.add("0;0.00\n");
+    return;
+  }
+  bool feasible = true;
+  float duration = 0.0, oTime, oPeak[AXIS_NUMBERS];
+  for (uint8_t i = 0; i<AXIS_NUMBERS; i++){
+    oPeak[i] = 0.0;
+    if( iDist[i] ){
+      if( !_axis[i]->estimateMoveRelative(iDist[i], oTime, oPeak[i], abs(iDist[i])/iTimeSpeed, iAccelTime) ) feasible = false;
+      duration = max(duration, oTime);
+    }
+  }
+  out.add(feasible ? "1;" : "0;").add(duration,2);
+  for (uint8_t i = 0; i<AXIS_NUMBERS; i++) out.add(';').add(oPeak[i],2);
+  out.add('\n');
+}
+
+// Establece la configuración por defecto de un eje.
+void FIPC_API::setDefault(uint8_t id, FIPC_Axis::MotorStage type, uint8_t pinStep, uint8_t pinDir, uint8_t pinPositive, uint8_t pinNegative){
+  FIPC_Config::AxisConfig config;
+  FIPC_Axis::getPreset(type, config);
+  config.pinStep = pinStep;
+  config.pinDir = pinDir;
+  config.pinEnable = EN;
+  config.pinPositive = pinPositive;
+  config.pinNegative = pinNegative;
+  config.pinRef = pinNegative;
+  _config.setDefault(id, config);
+}
+
+// Aplica la configuración activa a los ejes y a la supervisión de los fines de carrera.
+void FIPC_API::applyConfig(){
+  for(uint8_t i = 0; i<AXIS_NUMBERS; i++){
+    const FIPC_Config::AxisConfig &config = _config.getAxis(i+1);
+    _axis[i]->setConfig(config);
+#if LIMITS_ENABLED
+    bool limits = config.flags&CONFIG_LIMITS;
+    _limits.setMask(i+1, limits ? PIN_MASK(config.pinPositive) : 0, limits ? PIN_MASK(config.pinNegative) : 0);
+#endif
+  }
+}
+
+// Guarda y aplica la configuración recibida.
+bool FIPC_API::commitConfig(){
+  // Solo se reconfigura con todos los ejes deshabilitados (sin referencia ni desplazamientos)
+  for(uint8_t i = 0; i<AXIS_NUMBERS; i++)
+    if( !_axis[i]->isDisabled() ) return false;
+  if( !_config.commit() ) return false;
+
+  FIPC_API::applyConfig();
+  _persist.begin(); // un registro guardado de otro tipo de eje deja de ser válido
+  return true;
+}
+
+// Retorna la salida sincronizada con la posición de un eje.
+FIPC_PSO* FIPC_API::getPSO(uint8_t id){
+  if( (id==0)||(id>AXIS_NUMBERS) ) return NULL;
+  return _axis[id-1]->getPSO();
 }
 
 /* End: Private                           */
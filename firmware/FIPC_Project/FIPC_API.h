@@ -23,8 +23,30 @@
 #include "Arduino.h"
 #include "FIPC_pinTable.h"
 #include "FIPC_Axis.h"
+#include "FIPC_Scan.h"
+#include "FIPC_Align.h"
+#include "FIPC_Tune.h"
+#include "FIPC_Kinematics.h"
+#include "FIPC_Persist.h"
+#include "FIPC_Limits.h"
+#include "FIPC_Memory.h"
+#include "FIPC_Config.h"
+#include "FIPC_Program.h"
+#include "FIPC_Recorder.h"
+#include "FIPC_Sync.h"
+#include "FIPC_TrajectoryCache.h"
+#include "FIPC_Latency.h"
+#include "FIPC_Budget.h"
 
-#define AXIS_NUMBERS 6    /*!< Cantidad de ejes. */
+#ifndef AXIS_NUMBERS
+#define AXIS_NUMBERS ((SHIFT_ENABLED) ? 8 : 6) /*!< Cantidad de ejes (7 y 8 solo con la cadena de 74HC595, ver FIPC_pinTable.h). */
+#endif
+#if (AXIS_NUMBERS<6)||(AXIS_NUMBERS>CONFIG_AXIS_NUMBERS)||((AXIS_NUMBERS>6)&&!(SHIFT_ENABLED))
+#error "AXIS_NUMBERS debe estar entre 6 y CONFIG_AXIS_NUMBERS (más de 6 requiere SHIFT_ENABLED)"
+#endif
+#define API_REQUEST_SIZE 256  /*!< Largo máximo de una solicitud en caracteres (incluye el '\0'). */
+#define API_OUTPUT_SIZE  1024 /*!< Tamaño del buffer de respuesta de request(). */
+#define API_EVENT_SIZE   256  /*!< Tamaño del buffer de eventos de getEvents(). */
 
 /**
  * \defgroup API_Commands Comandos de API
@@ -44,7 +66,105 @@
  * relativas. El anteúltimo elemento define el tiempo del desplazamiento (2.5 segundos) mientras que 
  * el último elemento define el tiempo de aceleración (0.1 segundos). Notar que los ejes #3, #4 y #5 no
  * realizarán movimientos.
- * 
+ * \li <b>"SYNCRF:45:31.5:0:0:0:15.6:"</b> Ejecuta el mismo movimiento sincrónico en el menor tiempo
+ * posible. El tiempo del desplazamiento y el de aceleración se calculan a partir de la velocidad y 
+ * aceleración máxima de cada eje. Retorna el tiempo total del desplazamiento en segundos o "-1" si 
+ * el movimiento fue rechazado.
+ * \li <b>"?TR:2:1500:"</b> Estima, sin mover el eje, el desplazamiento relativo del eje #2. Retorna 
+ * "factible;duración;velocidad pico", por ejemplo "1;4.20;375.00".
+ * \li <b>"?TB:1:3:100:2500:800:"</b> Estima el costo de 3 destinos absolutos candidatos del eje #1 
+ * partiendo de la posición actual. Retorna una línea "factible;duración;velocidad pico" por destino.
+ * \li <b>"?TS:45:31.5:0:0:0:15.6:2.5:0.1:"</b> Estima el desplazamiento sincrónico equivalente a SYNCR. 
+ * Retorna "factible;duración" seguido de la velocidad pico de cada eje.
+ * \li <b>"SCANT:4:10:SCAN:1:1:2:0:0:0:0:50:50:0:21:11:1:1500:SCANGO:"</b> Configura la salida de 
+ * disparo en la GPIO 4 con pulsos de 10 us, define una serpentina de 21x11 puntos con paso de 50 um 
+ * sobre los ejes #1 (rápido) y #2 (lento) a 1500 um/s y la inicia. El tipo de barrido es 0 (raster), 
+ * 1 (serpentina) o 2 (espiral). Al finalizar se envía el evento "SCAN:Done;líneas;disparos;perdidos", 
+ * donde perdidos cuenta los puntos que el eje alcanzó en el ciclo de otro punto (un disparo por ciclo).
+ * \li <b>"ALIGNADC:34:8:ALIGN:2:1:2:0:20:0.5:200:100:"</b> Lee la potencia óptica en la GPIO 34 
+ * promediando 8 lecturas y busca el máximo con Nelder-Mead (algoritmo 2) sobre los ejes #1 y #2, 
+ * con paso inicial 20, paso mínimo 0.5 y hasta 200 evaluaciones. El algoritmo 0 es ascenso por 
+ * coordenadas y el 1 espiral de primera luz (umbral 100) seguida de gradiente. Al finalizar se envía 
+ * el evento "ALIGN:Done;evaluaciones;potencia;posiciones".
+ * \li <b>"TUNE:1:5000:3:2:"</b> Caracteriza el eje #1 (ver FIPC_Tune): cada ensayo repite 3 idas y 
+ * vueltas de 5000 um desde la posición actual y vuelve a buscar el cero; si la referencia se desplaza 
+ * más de 2 um se perdieron pasos. La velocidad y luego la aceleración máxima se buscan por bisección 
+ * y al finalizar se aplican y se guardan en la configuración (ver FIPC_Config) con un margen del 20%. 
+ * <b>"?TUNE:"</b> retorna "estado;eje;ensayos;velocidad;aceleración;desvío en pasos" y al finalizar se 
+ * envía el evento "TUNE:Done;..." ("Failed" si ningún ensayo resultó sin pérdida). "TUNESTOP:" o "SA:" 
+ * la cancelan y restauran los límites anteriores. Requiere los switches reales: compilado con el 
+ * switch simulado (HOMING_SIMULATED en 1) retorna "0".
+ * \li <b>"PSOP:1:4:1:PSO:1:1000:10:500:MA:1:6000:"</b> Configura la salida sincronizada con la 
+ * posición del eje #1 en la GPIO 4 en modo pulso (0 invierte el nivel), programa 500 disparos cada 
+ * 10 um a partir de 1000 um y ejecuta el desplazamiento. Con <b>"PSOT:1:3:1000:1250.5:1800:"</b> se 
+ * programa en cambio una tabla de posiciones.
+ * \li <b>"E:HRA:"</b> Luego de un reinicio habilita los ejes y restaura la posición guardada en memoria 
+ * no volátil sin buscar el cero. Solo se restauran los ejes que estaban detenidos con referencia válida, 
+ * el resto queda en "NoHome". <b>"?NV:1:"</b> retorna "referencia válida;posición;generación;errores" 
+ * del registro guardado del eje #1.
+ * \li <b>"JOGT:300:JOG:1:-250:"</b> Configura en 300 ms el tiempo límite sin actualizaciones del modo 
+ * velocidad y desplaza el eje #1 a -250 um/s. Cada nuevo "JOG:" cambia la velocidad y el sentido en el 
+ * siguiente ciclo de tiempo real; si dejan de llegar actualizaciones el eje desacelera y se detiene. 
+ * Con <b>"JOGA:100:0:0:0:0:-50:"</b> se actualizan varios ejes a la vez (0 no inicia el modo en un eje 
+ * detenido). "S:" o "SA:" desaceleran hasta detener el eje.
+ * \li <b>"?MEM:"</b> Retorna "heap libre;mínimo heap libre" seguido de la pila libre mínima en bytes 
+ * de cada tarea registrada con addTask(), por ejemplo "250312;248876;1456;2212;2980;1840;2630".
+ * \li Por la red (ver FIPC_Network) se aceptan los mismos comandos en conexiones TCP al puerto 5025, 
+ * una lista por línea terminada en '\\n'. Cada respuesta termina con la línea ">" y las líneas que 
+ * comienzan con '!' son asincrónicas: <b>"NETSUB:3:10:"</b> suscribe la conexión a los eventos y a 
+ * la telemetría "!TEL:ms;posición de cada eje;máscara de ejes en movimiento" cada 10 ms. <b>"?NET:"</b> 
+ * retorna "conexiones;bytes enviados;tramas descartadas". Ver python_lib/module_network.py.
+ * \li <b>"D:CFGW:0:31434946...:CFGW:112:...:CFGC:"</b> Carga una nueva configuración de los ejes 
+ * (ver FIPC_Config) en tramos hexadecimales consecutivos indicando la posición de cada tramo en bytes, 
+ * y la confirma. Cada tramo retorna "1" si fue aceptado; "CFGC:" retorna "1" si el bloque es válido, 
+ * todos los ejes están deshabilitados y se guardó, en cuyo caso se aplica sin reiniciar. 
+ * <b>"?CFG:"</b> retorna "origen;crc;ejes" (origen 0 configuración por defecto, 1 guardada) y 
+ * <b>"?CFGD:"</b> el bloque activo en hexadecimal. Ver python_lib/module_stage_config.py.
+ * \li <b>"KP:0:0:12000:KMR:0:0:0:0:500:0:0:0:"</b> Define el pivote 12 mm sobre el centro de rotación 
+ * (ver FIPC_Kinematics) y gira 500 mgrad alrededor de X en el menor tiempo posible manteniendo el pivote 
+ * fijo. Los ejes #1 a #3 compensan la rotación en cada ciclo sin intervención del host. Con 
+ * <b>"KMA:x:y:z:a:b:c:T:ta:"</b> se lleva la herramienta a una pose absoluta (T = 0 para el menor tiempo). 
+ * Ambos retornan el tiempo total en segundos o "-1" si fue rechazado. <b>"?K:"</b> retorna 
+ * "estado;x;y;z;a;b;c" y al finalizar se envía el evento "KIN:Done;x;y;z;a;b;c". "SA:" desacelera sobre 
+ * la trayectoria; "S:" o "D:" sobre uno de los ejes lo detienen en el lugar junto con el resto.
+ * \li <b>"PRGW:0:31504946...:PRGW:112:...:PRGC:PRGRUN:"</b> Carga un programa (ver FIPC_Program) en tramos 
+ * hexadecimales, lo guarda en memoria no volátil y lo ejecuta sin intervención del host: lazos, esperas 
+ * al reposo de los ejes o a una entrada, variables y posiciones con nombre. "PRGC:" retorna "1" si el 
+ * programa es válido y no había uno en ejecución. <b>"?PRG:"</b> retorna "estado;instrucción;crc", 
+ * <b>"?PRGV:3:"</b> el valor de la variable #3 y al finalizar se envía el evento "PRG:Done;instrucción;crc". 
+ * "PRGSTOP:" detiene el programa sin detener los ejes y "SA:" detiene ambos. Ver python_lib/module_program.py.
+ * \li <b>"REC:1:"</b> Inicia la grabación de la sesión (ver FIPC_Recorder): cada solicitud con su instante 
+ * en us, los cambios de estado de los ejes y los ciclos de tiempo real de más de 80 us. "REC:0:" la detiene. 
+ * <b>"?REC:"</b> retorna "grabando;bytes;registros;descartados;ciclos;exec medio;exec máximo;ciclos lentos" 
+ * (tiempos en us) y <b>"?RECD:0:"</b> el registro en tramos hexadecimales de 256 bytes. Ver 
+ * python_lib/module_session.py para descargarlo y reproducirlo en el emulador.
+ * \li <b>"LINK:1:4:"</b> Configura el controlador como líder de la línea de disparo en la GPIO 4 
+ * (ver FIPC_Sync); en los demás controladores <b>"LINK:2:4:"</b> los configura como seguidores. Con 
+ * <b>"LINKARM:SYNCRF:100:0:0:0:0:0:"</b> en cada controlador el desplazamiento queda retenido y 
+ * <b>"LINKGO:"</b> en el líder lo inicia en todos a la vez. "LINKX:", "S:", "SA:" o "D:" cancelan las acciones 
+ * retenidas. <b>"?LINK:"</b> retorna "rol;retenido;listo;disparos;instante del último disparo" (listo 
+ * indica que todos los ejes retenidos pueden iniciar en el ciclo del disparo) y <b>"?CLK:"</b> el reloj 
+ * del controlador en us, para estimar la diferencia entre relojes. Ver python_lib/module_sync.py.
+ * \li <b>"?TCACHE:"</b> Retorna "tablas;bytes usados;bytes totales;aciertos;fallos;descartadas" de las 
+ * rampas guardadas de los desplazamientos con el periférico RMT (ver FIPC_TrajectoryCache), para 
+ * dimensionar la memoria. "TCACHE:1:" guarda las tablas en memoria no volátil y "TCACHE:0:" las descarta 
+ * con los contadores; ambos retornan "1" o "0" si hay una tabla en uso o la escritura falló.
+ * \li <b>"?LAT:5:"</b> Retorna "muestras;mínimo;media;máximo;p50;p99" en us de la latencia desde que llegan
+ * los primeros bytes de un comando de desplazamiento hasta el primer paso (ver FIPC_Latency). Las etapas
+ * 0 a 4 son recepción de la línea, interpretación, aceptación del eje, espera de exec() y primer paso.
+ * <b>"?LATH:0:"</b> retorna el histograma de una etapa y "LATX:" descarta las mediciones.
+ * \li <b>"BUDGET:1:"</b> Verifica cada desplazamiento, "JOG:", "SYNC", la búsqueda del cero, los programas,
+ * barridos, alineaciones, caracterizaciones y trayectorias contra la frecuencia de pasos que el proceso en
+ * tiempo real puede atender (ver FIPC_Budget): en el modo 1 se rechazan los que la superan con el evento
+ * "BUDGET:ejes;carga pedida en %", en el modo 2 se reducen las velocidades de los desplazamientos y del modo
+ * velocidad (la búsqueda del cero, las caracterizaciones y las trayectorias se rechazan) y en el modo 0
+ * no se verifica. <b>"BUDGETCAL:20000:"</b> mide el costo de exec() en los próximos 20000 ciclos mientras
+ * los ejes se desplazan, y el modo y los costos se guardan en memoria no volátil. <b>"?BUDGET:"</b> retorna
+ * "modo;costo base;costo por paso;carga en %;rechazados;estirados;ciclos de calibración pendientes".
+ * \li <b>"?SHIFT:"</b> Retorna "habilitada;bits;muestras/s;pasos;atrasados;descartados" de la cadena de
+ * 74HC595 que emite los pasos de los ejes #4 a #8 al compilar con SHIFT_ENABLED (ver FIPC_ShiftOut). Con
+ * 8 ejes los comandos con una coordenada por eje ("SYNCR:", "SYNCA:", "JOGA:", etc.) reciben 8 valores.
+ *
  * @{
  */
 #define API_ENABLE     "E"     /*!< Habilita el sistema. */
@@ -53,12 +173,50 @@
 #define API_STOP_ALL   "SA"    /*!< Detiene todos los ejes. */
 #define API_HOME       "H"     /*!< Busca referencia de un eje. */
 #define API_STOP       "S"     /*!< Detiene un eje. */
+#define API_RESTORE_ALL "HRA"  /*!< Restaura la posición guardada de todos los ejes sin buscar el cero. */
+#define API_RESTORE    "HR"    /*!< Restaura la posición guardada de un eje sin buscar el cero. */
 #define API_VELO       "V"     /*!< Configura la velocidad de 1 eje. */
 #define API_ACCEL      "A"     /*!< Configura el tiempo de aceleración de 1 eje. */
 #define API_RELATIVE   "MR"    /*!< Configura el desplazamiento relativo de 1 eje. */
 #define API_ABSOLUTE   "MA"    /*!< Configura el desplazamiento absoluto de 1 eje. */
 #define API_SYNC_REL   "SYNCR" /*!< Configura un desplazamiento syncrónico en coordenadas relativas. */
 #define API_SYNC_ABS   "SYNCA" /*!< Configura un desplazamiento syncrónico en coordenadas absolutas. */
+#define API_SYNC_REL_FAST "SYNCRF" /*!< Desplazamiento syncrónico en coordenadas relativas en el menor tiempo posible. */
+#define API_SYNC_ABS_FAST "SYNCAF" /*!< Desplazamiento syncrónico en coordenadas absolutas en el menor tiempo posible. */
+#define API_SCAN       "SCAN"     /*!< Configura un barrido (tipo, ejes, inicio, paso, puntos y velocidad). */
+#define API_SCAN_TRIG  "SCANT"    /*!< Configura la GPIO y el ancho de pulso de la salida de disparo del barrido. */
+#define API_SCAN_START "SCANGO"   /*!< Inicia el barrido configurado. */
+#define API_SCAN_STOP  "SCANSTOP" /*!< Cancela el barrido en ejecución. */
+#define API_ALIGN      "ALIGN"     /*!< Inicia la búsqueda del máximo de potencia (algoritmo, ejes, paso, paso mínimo, evaluaciones y umbral). */
+#define API_ALIGN_ADC  "ALIGNADC"  /*!< Configura la GPIO analógica y la cantidad de lecturas a promediar. */
+#define API_ALIGN_STOP "ALIGNSTOP" /*!< Cancela la búsqueda del máximo de potencia. */
+#define API_TUNE       "TUNE"      /*!< Inicia la caracterización de la velocidad y la aceleración máxima de 1 eje (eje, distancia, idas y vueltas y tolerancia). */
+#define API_TUNE_STOP  "TUNESTOP"  /*!< Cancela la caracterización. */
+#define API_PSO_OUT    "PSOP"  /*!< Configura la GPIO y el modo de la salida sincronizada con la posición de 1 eje. */
+#define API_PSO_PITCH  "PSO"   /*!< Programa disparos equiespaciados (inicio, paso y cantidad) de 1 eje. */
+#define API_PSO_TABLE  "PSOT"  /*!< Programa una tabla de posiciones de disparo de 1 eje. */
+#define API_PSO_OFF    "PSOX"  /*!< Deshabilita la salida sincronizada con la posición de 1 eje. */
+#define API_JOG        "JOG"   /*!< Desplazamiento en modo velocidad de 1 eje (velocidad con signo). */
+#define API_JOG_ALL    "JOGA"  /*!< Desplazamiento en modo velocidad de todos los ejes (una velocidad por eje). */
+#define API_JOG_TIMEOUT "JOGT" /*!< Configura el tiempo límite en ms sin actualizaciones del modo velocidad. */
+#define API_CONFIG_WRITE  "CFGW" /*!< Recibe un tramo hexadecimal del bloque de configuración (posición y datos). */
+#define API_CONFIG_COMMIT "CFGC" /*!< Valida, guarda y aplica el bloque de configuración recibido. */
+#define API_KIN_PIVOT  "KP"    /*!< Configura el pivote de la herramienta (distancia X, Y, Z al centro de rotación). */
+#define API_KIN_ABS    "KMA"   /*!< Desplaza la herramienta a una pose absoluta (pose, tiempo y tiempo de aceleración). */
+#define API_KIN_REL    "KMR"   /*!< Desplazamiento relativo en el sistema de la herramienta (pose, tiempo y tiempo de aceleración). */
+#define API_PROGRAM_WRITE  "PRGW"    /*!< Recibe un tramo hexadecimal del programa (posición y datos). */
+#define API_PROGRAM_COMMIT "PRGC"    /*!< Valida y guarda el programa recibido. */
+#define API_PROGRAM_RUN    "PRGRUN"  /*!< Inicia el programa guardado. */
+#define API_PROGRAM_STOP   "PRGSTOP" /*!< Detiene el programa en ejecución. */
+#define API_RECORD     "REC"   /*!< Inicia (1) o detiene (0) la grabación de la sesión. */
+#define API_LINK       "LINK"    /*!< Configura el rol (0 sin sincronización, 1 líder, 2 seguidor) y la GPIO de la línea de disparo. */
+#define API_LINK_ARM   "LINKARM" /*!< Retiene las acciones siguientes hasta el próximo disparo. */
+#define API_LINK_FIRE  "LINKGO"  /*!< Genera el pulso de disparo (solo el líder). */
+#define API_LINK_CANCEL "LINKX"  /*!< Cancela las acciones retenidas. */
+#define API_TCACHE     "TCACHE"  /*!< Descarta (0) o guarda en memoria no volátil (1) las tablas de las rampas. */
+#define API_LATENCY_CLEAR "LATX" /*!< Descarta las mediciones de latencia. */
+#define API_BUDGET     "BUDGET"    /*!< Configura el presupuesto de pasos (0 sin verificar, 1 rechaza, 2 reduce las velocidades). */
+#define API_BUDGET_CAL "BUDGETCAL" /*!< Calibra el costo de exec() en la cantidad de ciclos pedida. */
 
 #define API_Q_REPO_ALL "?RA"   /*!< Solicitud. Reporte de todos los ejes. */
 #define API_Q_REPO     "?R"    /*!< Solicitud. Reporte de 1 eje. */
@@ -67,22 +225,57 @@
 #define API_Q_POS      "?P"    /*!< Solicitud. Retorna la posición en condenadas absolutas de 1 eje. */
 #define API_Q_VELO     "?V"    /*!< Solicitud. Retorna la velocidad configurada de 1 eje. */
 #define API_Q_ACCEL    "?A"    /*!< Solicitud. Retorna el tiempo de aceleración configurado de 1 eje. */
+#define API_Q_TIME_REL   "?TR" /*!< Solicitud. Estima la duración de un desplazamiento relativo de 1 eje. */
+#define API_Q_TIME_ABS   "?TA" /*!< Solicitud. Estima la duración de un desplazamiento absoluto de 1 eje. */
+#define API_Q_TIME_BATCH "?TB" /*!< Solicitud. Estima la duración hacia una lista de destinos absolutos de 1 eje. */
+#define API_Q_TIME_SYNC  "?TS" /*!< Solicitud. Estima la duración de un desplazamiento syncrónico relativo. */
+#define API_Q_SCAN     "?SCAN" /*!< Solicitud. Retorna el estado del barrido ("estado;línea o punto;disparos;perdidos"). */
+#define API_Q_STORE    "?NV"    /*!< Solicitud. Registro guardado de 1 eje ("referencia válida;posición;generación;errores"). */
+#define API_Q_PSO      "?PSO"   /*!< Solicitud. Estado de la salida sincronizada de 1 eje ("habilitado;disparos;restantes;error en pasos"). */
+#define API_Q_ALIGN    "?ALIGN" /*!< Solicitud. Retorna el estado de la alineación ("estado;evaluaciones;potencia;posiciones"). */
+#define API_Q_TUNE     "?TUNE"  /*!< Solicitud. Retorna el estado de la caracterización ("estado;eje;ensayos;velocidad;aceleración;desvío"). */
+#define API_Q_MEMORY   "?MEM"   /*!< Solicitud. Uso de memoria ("heap libre;mínimo heap libre;pila libre de cada tarea"). */
+#define API_Q_CONFIG   "?CFG"   /*!< Solicitud. Configuración activa ("origen;crc;ejes"). */
+#define API_Q_CONFIG_DATA "?CFGD" /*!< Solicitud. Bloque de configuración activo en hexadecimal. */
+#define API_Q_KIN      "?K"     /*!< Solicitud. Pose de la herramienta ("estado;x;y;z;a;b;c"). */
+#define API_Q_PROGRAM  "?PRG"   /*!< Solicitud. Estado del programa ("estado;instrucción;crc"). */
+#define API_Q_PROGRAM_VAR "?PRGV" /*!< Solicitud. Valor de una variable del programa. */
+#define API_Q_RECORD   "?REC"   /*!< Solicitud. Estado de la grabación ("grabando;bytes;registros;descartados;ciclos;exec medio;exec máximo;ciclos lentos"). */
+#define API_Q_RECORD_DATA "?RECD" /*!< Solicitud. Tramo del registro de la sesión en hexadecimal. */
+#define API_Q_LINK     "?LINK"  /*!< Solicitud. Estado de la sincronización ("rol;retenido;listo;disparos;instante del último disparo en us"). */
+#define API_Q_CLOCK    "?CLK"   /*!< Solicitud. Reloj del controlador en us. */
+#define API_Q_TCACHE   "?TCACHE" /*!< Solicitud. Uso de las tablas de las rampas ("tablas;bytes usados;bytes totales;aciertos;fallos;descartadas"). */
+#define API_Q_LATENCY  "?LAT"    /*!< Solicitud. Latencia de una etapa desde la recepción de un comando hasta el primer paso ("muestras;mínimo;media;máximo;p50;p99" en us). */
+#define API_Q_LATENCY_HIST "?LATH" /*!< Solicitud. Histograma de la latencia de una etapa (cuentas de 2^n a 2^(n+1)-1 us). */
+#define API_Q_BUDGET   "?BUDGET" /*!< Solicitud. Presupuesto de pasos ("modo;costo base;costo por paso;carga en %;rechazados;estirados;ciclos de calibración"). */
+#define API_Q_SHIFT    "?SHIFT"  /*!< Solicitud. Estado de la cadena de 74HC595 ("habilitada;bits;muestras/s;pasos;atrasados;descartados"). */
 /**@}*/
 
 
 
 
-//!  Clase que implementa una interfaz de aplicación para controlar 6 ejes.
+//!  Clase que implementa una interfaz de aplicación para controlar AXIS_NUMBERS ejes.
 /*!
  *   La API está formada por la función exec() que debe ser llamada en un proceso 
  *   a ejecutarse en tiempo real y por método que interpreta comandos a ejecutar
  *   llamada request(). Para más información sobre los comandos (ver \ref API_Commands).
+ *
+ *   Todos los objetos son miembros de la API y las respuestas se escriben en buffers
+ *   de capacidad fija (ver FIPC_Text): luego de setup() no se reserva memoria dinámica.
+ *
+ *   Las acciones de un comando sobre varios ejes ("SYNCRF:", "HA:", "JOGA:", etc.)
+ *   se preparan en cada eje y se liberan juntas: exec() lee el último lote liberado una
+ *   vez por ciclo y aplica todas sus acciones antes de ejecutar los ejes, por lo que todos
+ *   inician en el mismo ciclo. Si algún eje todavía no guardó el registro sin referencia
+ *   válida (ver FIPC_Persist), el lote completo espera al ciclo siguiente. Las paradas y
+ *   las deshabilitaciones ("S:", "SA:", "D:") no forman parte de un lote: cancelan las
+ *   acciones preparadas de sus ejes y se aplican en el ciclo siguiente.
 */
 class FIPC_API{
   public:    
     //! Constructor.
     /*!
-     *  Al instanciar la API se crean los 6 ejes.
+     *  Al instanciar la API se crean los AXIS_NUMBERS ejes.
      */ 
     FIPC_API();
     
@@ -94,29 +287,204 @@ class FIPC_API{
     
     //! Método público de interfaz con la aplicación.
     /*!
+     *  Se interpretan como máximo API_REQUEST_SIZE-1 caracteres.
      *  \param myString Texto con una lista de comandos.
-     *  \return Texto con el reporte solicitado.
+     *  \return Texto con el reporte solicitado, válido hasta la próxima llamada.
+     */     
+    const char* request(const char* myString);        
+
+    //! Ejecuta una lista de comandos.
+    /*!
+     *  Intérprete de request(), utilizado también por los programas almacenados (ver FIPC_Program).
+     *  \param line Texto con una lista de comandos, se modifica durante la interpretación.
+     *  \param out Texto donde se agrega la respuesta.
+     */     
+    void execute(char* line, FIPC_Text &out);
+
+    //! Retorna los eventos asincrónicos pendientes.
+    /*!
+     *  Por ejemplo el fin de un barrido o la detención por un fin de carrera 
+     *  ("LIMIT:eje;sentido;posición"). Debe consultarse periódicamente.
+     *  \return Texto con los eventos, vacío si no hay eventos. Válido hasta la próxima llamada.
+     */     
+    const char* getEvents();
+
+    //! Lee la configuración de los ejes y las posiciones guardadas en memoria no volátil.
+    /*!
+     *  Debe llamarse una vez en setup(), antes de crear la tarea de tiempo real. Con
+     *  SHIFT_ENABLED también inicia la cadena de 74HC595 (ver FIPC_ShiftOut).
+     */     
+    void begin();
+
+    //! Guarda las posiciones pendientes y los límites medidos (ver FIPC_Tune) en memoria no volátil.
+    /*!
+     *  Debe llamarse periódicamente desde una tarea que no sea la de tiempo real.
      */     
-    String request(String myString);        
+    void persist();
+
+    //! Registra una tarea para informar su pila libre con "?MEM:".
+    /*!
+     *  \param pTask Handle de la tarea de FreeRTOS.
+     */     
+    void addTask(void* pTask);
+
+    //! Ejecuta el programa almacenado.
+    /*!
+     *  Debe llamarse periódicamente desde una tarea que no sea la de tiempo real, con el mismo
+     *  semáforo que protege request().
+     */     
+    void runProgram();
+
+    //! Lee la entrada analógica de potencia óptica para la alineación (ver FIPC_AnalogSensor).
+    /*!
+     *  Debe llamarse periódicamente desde una tarea que no sea la de tiempo real: cada
+     *  evaluación de FIPC_Align promedia las lecturas nuevas de esta función.
+     */     
+    void sample();
+
+    //! Verifica si los ejes indicados están en reposo.
+    /*!
+     *  \param mask Máscara de ejes (bit 0 para el eje #1).
+     *  \return true si los ejes no tienen desplazamientos en curso ni pendientes y no hay barridos,
+     *  alineaciones ni desplazamientos de la herramienta en ejecución.
+     */     
+    bool isIdle(uint8_t mask);
+
+    //! Escribe el estado de los ejes para la telemetría.
+    /*!
+     *  \param out Texto donde se agrega "posición de cada eje;máscara de ejes en movimiento".
+     */     
+    void getTelemetry(FIPC_Text &out);
+
+    //! Desplazamiento sincrónico en coordenadas absolutas.
+    /*!
+     *  \param iAbsolute Posición absoluta de cada eje.
+     *  \param iTimeSpeed Tiempo del desplazamiento en segundos (0 para el menor tiempo posible).
+     *  \param iAccelTime Tiempo de aceleración en segundos.
+     *  \return Tiempo total en segundos, o un valor negativo si fue rechazado.
+     */     
+    float moveSync(float iAbsolute[], float iTimeSpeed, float iAccelTime);
+
+    //! Desplazamiento de un eje.
+    /*!
+     *  Como "MR:" y "MA:", pasa por el presupuesto de pasos y por el lote retenido hasta el
+     *  disparo con "LINKARM:".
+     *  \param id Identificador del eje.
+     *  \param iAbsolute true si iData es una posición absoluta, false si es una distancia.
+     *  \param iData Posición o distancia.
+     *  \return true si el eje aceptó el desplazamiento.
+     */     
+    bool moveAxis(int8_t id, bool iAbsolute, float iData);
     
   private:
+    FIPC_Axis _axisStore[AXIS_NUMBERS]; /*!< Ejes. */
+
     FIPC_Axis *_axis[AXIS_NUMBERS]; /*!< Lista de ejes. */
 
+    FIPC_Scan _scan; /*!< Motor de barridos. */
+
+    FIPC_AnalogSensor _sensor; /*!< Entrada analógica de potencia óptica. */
+
+    FIPC_Align _align; /*!< Búsqueda del máximo de potencia óptica. */
+
+    FIPC_Tune _tune; /*!< Caracterización de los límites de los ejes. */
+
+    FIPC_Kinematics _kin; /*!< Desplazamientos de la herramienta alrededor del pivote. */
+
+    FIPC_Limits _limits; /*!< Supervisión de los fines de carrera. */
+
+#if defined(ARDUINO_ARCH_ESP32)
+    FIPC_NVSStorage _storage; /*!< Memoria no volátil. */
+#else
+    FIPC_FileStorage _storage; /*!< Memoria no volátil (archivos en la PC). */
+#endif
+
+    FIPC_Config _config; /*!< Configuración de los ejes. */
+
+    FIPC_TrajectoryCache _trajectory; /*!< Tablas de las rampas de los desplazamientos del periférico RMT. */
+
+    FIPC_Persist _persist; /*!< Posición y referencia guardadas de los ejes. */
+
+    FIPC_Budget _budget; /*!< Presupuesto de la frecuencia de pasos de exec(). */
+
+    FIPC_Memory _memory; /*!< Reporte del uso de memoria. */
+
+    FIPC_Program _program; /*!< Programa almacenado. */
+
+    FIPC_Recorder _recorder; /*!< Grabación de la sesión. */
+
+#if defined(ARDUINO_ARCH_ESP32)
+    FIPC_GpioSyncLine _syncLine; /*!< Línea de disparo entre controladores. */
+#else
+    FIPC_SharedSyncLine _syncLine; /*!< Línea de disparo entre controladores (compartida en el proceso). */
+#endif
+
+    FIPC_Sync _sync; /*!< Sincronización con otros controladores. */
+
+    volatile uint32_t _releaseEpoch = 0; /*!< Último lote de acciones liberado. */
+
+    uint32_t _commitEpoch = 0; /*!< Último lote de acciones aplicado por exec(). */
+
+    char _line[API_REQUEST_SIZE]; /*!< Copia de la solicitud en interpretación. */
+
+    char _outBuffer[API_OUTPUT_SIZE]; /*!< Buffer de la respuesta de request(). */
+
+    char _eventBuffer[API_EVENT_SIZE]; /*!< Buffer de los eventos de getEvents(). */
+
+    FIPC_Text _out; /*!< Respuesta de request(). */
+
+    FIPC_Text _events; /*!< Eventos de getEvents(). */
+
     //! Lectura de comandos solicitados
     /*!
-     *  \param myString Texto completo de comandos.
-     *  \param iTimeSpeed Vector de comandos donde guardar la lectura.
-     *  \return iAccelTime Cantidad de comandos interpretados.
+     *  Separa los comandos sobre el mismo texto reemplazando los ':' por '\0'.
+     *  Los comandos no recibidos quedan como texto vacío.
+     *  \param line Texto completo de comandos.
+     *  \param command Vector de comandos donde guardar la lectura.
+     *  \return Cantidad de comandos interpretados.
      */         
-    int8_t getCommands(String myString, String command[]);
+    int8_t getCommands(char* line, const char* command[]);
 
     //! Solicita una acción al eje.
     /*!
      *  \param action Acción a ejecutar.
      *  \param id Identificador del eje.
      *  \param iData Valor a pasar como acción.
+     *  \return true si algún eje aceptó la acción.
+     */     
+    bool requestAction(uint8_t action = 0, int8_t id = -1, float iData = 0.0);
+
+    //! Abre un lote de acciones que se aplican en un mismo ciclo de exec().
+    /*!
+     *  Las acciones se preparan con FIPC_Axis::armAction() y el lote se libera
+     *  con release().
+     *  \return Lote a preparar.
+     */     
+    uint32_t armBegin();
+
+    //! Libera un lote de acciones.
+    /*!
+     *  Si se solicitó "LINKARM:" el lote queda retenido hasta el disparo (ver FIPC_Sync).
+     *  \param epoch Lote preparado.
      */     
-    void requestAction(uint8_t action = 0, int8_t id = -1, float iData = 0.0);
+    void release(uint32_t epoch);
+
+    //! Cancela las acciones retenidas hasta el disparo.
+    void cancelHold();
+
+    //! Verifica si un lote puede aplicarse en este ciclo.
+    /*!
+     *  \param epoch Lote.
+     *  \return false si algún eje del lote todavía no guardó su posición.
+     */     
+    bool isBatchReady(uint32_t epoch);
+
+    //! Aplica las acciones preparadas de los lotes liberados.
+    /*!
+     *  Llamado al comienzo de exec() cuando se liberó un lote nuevo.
+     *  \param epoch Último lote liberado.
+     */     
+    void commitActions(uint32_t epoch);
 
     //! Configura el tiempo de aceleración.
     /*!
@@ -137,64 +505,126 @@ class FIPC_API{
      *  \param iDist Vector con las distancias relativas del desplazamiento.
      *  \param iTimeSpeed Tiempo total del desplazamiento.
      *  \param iAccelTime Tiempo de aceleración del desplazamiento.
+     *  \return true si todos los ejes aceptaron el desplazamiento.
      */     
-    void syncMotionRel(float iDist[],float iTimeSpeed, float iAccelTime);
+    bool syncMotionRel(float iDist[],float iTimeSpeed, float iAccelTime);
 
     //! Genera una solicitud de movimiento sincrónico en coordenadas absolutas.
     /*!
      *  \param iAbsolute Vector con las coordenadas absolutas.
      *  \param iTimeSpeed Tiempo total del desplazamiento.
      *  \param iAccelTime Tiempo de aceleración del desplazamiento.
+     *  \return true si todos los ejes aceptaron el desplazamiento.
+     */     
+    bool syncMotionAbs(float iAbsolute[],float iTimeSpeed, float iAccelTime);
+
+    //! Genera un movimiento sincrónico en coordenadas relativas en el menor tiempo posible.
+    /*!
+     *  Todos los ejes comparten el mismo perfil trapezoidal escalado, por lo que arrancan
+     *  y se detienen juntos. El tiempo de desplazamiento y de aceleración se eligen de 
+     *  manera que ningún eje supere su velocidad ni su aceleración máxima.
+     *  \param iDist Vector con las distancias relativas del desplazamiento.
+     *  \return Tiempo total del desplazamiento en segundos, o un valor negativo si fue rechazado.
      */     
-    void syncMotionAbs(float iAbsolute[],float iTimeSpeed, float iAccelTime);
+    float syncMotionRelFast(float iDist[]);
+
+    //! Genera un movimiento sincrónico en coordenadas absolutas en el menor tiempo posible.
+    /*!
+     *  \param iAbsolute Vector con las coordenadas absolutas.
+     *  \return Tiempo total del desplazamiento en segundos, o un valor negativo si fue rechazado.
+     */     
+    float syncMotionAbsFast(float iAbsolute[]);
 
     //! Retorna un reporte del estado de un eje.
     /*!
      *  \param id Identificador del eje.
-     *  \return Un texto con el reporte solicitado.
+     *  \param out Texto donde se agrega el reporte solicitado.
      */     
-    String getReport(uint8_t id);
+    void getReport(uint8_t id, FIPC_Text &out);
 
     //! Retorna un reporte completo.
     /*!
-     *  \param id Identificador del eje
-     *  \return Un texto con el reporte solicitado.
+     *  \param out Texto donde se agrega una línea de reporte por eje.
      */     
-    String getAllReport();
+    void getAllReport(FIPC_Text &out);
 
     //! Retorna la velocidad configurada de un eje.
     /*!
      *  \param id Identificador del eje.
-     *  \return Un texto con la velocidad.
+     *  \param out Texto donde se agrega la velocidad.
      */     
-    String getSpeed(uint8_t id);
+    void getSpeed(uint8_t id, FIPC_Text &out);
 
     //! Retorna la aceleracion configurada de un eje.
     /*!
      *  \param id Identificador del eje.
-     *  \return Un texto con el tiempo de aceleración.
+     *  \param out Texto donde se agrega el tiempo de aceleración.
      */     
-    String getAccelerationTime(uint8_t id);
+    void getAccelerationTime(uint8_t id, FIPC_Text &out);
 
     //! Retorna la posición absoluta actual de un eje.
     /*!
      *  \param id Identificador del eje.
-     *  \return Un texto con la posición absoluta del eje.
+     *  \param out Texto donde se agrega la posición absoluta del eje.
      */     
-    String getCurrentPosition(uint8_t id);    
+    void getCurrentPosition(uint8_t id, FIPC_Text &out);    
 
     //! Verifica si un eje se está moviendo.
     /*!
      *  \param id Identificador del eje.
-     *  \return "1" si el eje se está desplazando.
+     *  \param out Texto donde se agrega "1" si el eje se está desplazando.
      */     
-    String isRunning(uint8_t id);
+    void isRunning(uint8_t id, FIPC_Text &out);
 
     //! Retorna el estado de un eje.
     /*!
      *  \param id Identificador del eje.
-     *  \return Un texto con el estado en el que se encuentra el eje.
+     *  \param out Texto donde se agrega el estado en el que se encuentra el eje.
+     */     
+    void getStatus(uint8_t id, FIPC_Text &out);
+
+    //! Estima un desplazamiento relativo de un eje sin ejecutarlo.
+    /*!
+     *  \param id Identificador del eje.
+     *  \param iRelative Desplazamiento en coordenadas relativas.
+     *  \param out Texto donde se agrega "factible;duración;velocidad pico".
+     */     
+    void estimateMoveRelative(uint8_t id, float iRelative, FIPC_Text &out);
+
+    //! Estima un desplazamiento sincrónico en coordenadas relativas sin ejecutarlo.
+    /*!
+     *  \param iDist Vector con las distancias relativas del desplazamiento.
+     *  \param iTimeSpeed Tiempo total del desplazamiento.
+     *  \param iAccelTime Tiempo de aceleración del desplazamiento.
+     *  \param out Texto donde se agrega "factible;duración" seguido de la velocidad pico de cada eje.
+     */     
+    void estimateSyncMotionRel(float iDist[], float iTimeSpeed, float iAccelTime, FIPC_Text &out);
+
+    //! Retorna la salida sincronizada con la posición de un eje.
+    /*!
+     *  \param id Identificador del eje.
+     *  \return Puntero al objeto FIPC_PSO o NULL si el eje no existe.
+     */     
+    FIPC_PSO* getPSO(uint8_t id);
+
+    //! Establece la configuración por defecto de un eje.
+    /*!
+     *  \param id Identificador del eje.
+     *  \param type Tipo de eje.
+     *  \param pinStep GPIO de pulsos.
+     *  \param pinDir GPIO de dirección.
+     *  \param pinPositive GPIO del fin de carrera positivo.
+     *  \param pinNegative GPIO del fin de carrera negativo, también utilizado como referencia.
+     */     
+    void setDefault(uint8_t id, FIPC_Axis::MotorStage type, uint8_t pinStep, uint8_t pinDir, uint8_t pinPositive, uint8_t pinNegative);
+
+    //! Aplica la configuración activa a los ejes y a la supervisión de los fines de carrera.
+    void applyConfig();
+
+    //! Guarda y aplica la configuración recibida con "CFGW:".
+    /*!
+     *  \return true si todos los ejes estaban deshabilitados y el bloque fue guardado.
      */     
-    String getStatus(uint8_t id);
+    bool commitConfig();
 };
 #endif 
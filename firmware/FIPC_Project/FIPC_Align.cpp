@@ -0,0 +1,399 @@
+/*! \file FIPC_Align.cpp
+    \brief Clase que implementa la búsqueda del máximo de potencia óptica.
+*/
+
+#include "FIPC_Align.h"
+
+#define ALIGN_INVALID -1.0e30 /*!< Potencia asignada a los puntos fuera de los límites. */
+#define NM_EXPAND      2.0    /*!< Coeficiente de expansión de Nelder-Mead. */
+#define NM_CONTRACT    0.5    /*!< Coeficiente de contracción de Nelder-Mead. */
+#define NM_SHRINK      0.5    /*!< Coeficiente de reducción de Nelder-Mead. */
+
+// Constructor.
+FIPC_Align::FIPC_Align(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_PowerSensor* pSensor, FIPC_Budget* pBudget) {
+  _axisList = pAxis;
+  _axisNumbers = iAxisNumbers;
+  _sensor = pSensor;
+  _budget = pBudget;
+  for(uint8_t i = 0; i<ALIGN_AXIS_NUMBERS; i++) _axis[i] = NULL;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura la lectura de potencia óptica.
+void FIPC_Align::setSensor(FIPC_PowerSensor* pSensor, uint16_t iSamples){
+  _sensor = pSensor;
+  if( iSamples ) _samples = iSamples;
+}
+
+// Inicia una alineación desde la posición actual.
+bool FIPC_Align::start(uint8_t type, uint8_t id[], float step, float minStep, uint16_t maxEval, float threshold){
+  if( (_status==ALIGN_MOVE)||(_status==ALIGN_SAMPLE)||(_status==ALIGN_FINISH) ) return false;
+  if( (type>ALIGN_SIMPLEX)||(step<=0.0)||(minStep<=0.0)||(maxEval==0) ) return false;
+
+  // Los ejes seleccionados son los primeros identificadores distintos de 0
+  uint8_t n = 0;
+  for(uint8_t i = 0; i<ALIGN_AXIS_NUMBERS; i++){
+    if( id[i]==0 ) break;
+    if( id[i]>_axisNumbers ) return false;
+    for(uint8_t j = 0; j<i; j++) if( id[i]==id[j] ) return false;
+    if( !_axisList[id[i]-1]->isReady() ) return false;
+    n++;
+  }
+  if( (n==0)||((type==ALIGN_SPIRAL_GRADIENT)&&(n<2)) ) return false;
+
+  _n = n;
+  for(uint8_t i = 0; i<ALIGN_AXIS_NUMBERS; i++){
+    _axis[i] = (i<_n) ? _axisList[id[i]-1] : NULL;
+    if( i<_n ) _trial[i] = _axis[i]->getCurrentPosition();
+  }
+  _type = (AlignType)type;
+  _step = step;
+  _minStep = minStep;
+  _maxEval = maxEval;
+  _threshold = threshold;
+  _evals = 0;
+  _bestValue = ALIGN_INVALID;
+  _finished = false;
+  _phase = PHASE_BASE;
+
+  FIPC_Align::evaluate();
+  return true;
+}
+
+// Cancela la alineación.
+void FIPC_Align::stop(){
+  if( (_status!=ALIGN_MOVE)&&(_status!=ALIGN_SAMPLE)&&(_status!=ALIGN_FINISH) ) return;
+  for(uint8_t i = 0; i<_n; i++) _axis[i]->setAction(FIPC_Axis::ACTION_STOP);
+  _status = ALIGN_ABORTED;
+  _finished = true;
+}
+
+// Retorna el estado de la alineación.
+uint8_t FIPC_Align::getStatus(){ return _status;}
+
+// Solicita un reporte de la alineación.
+void FIPC_Align::getReport(FIPC_Text &out){
+  switch(_status){
+    case ALIGN_IDLE:    out.add("Idle");    break;
+    case ALIGN_MOVE:    out.add("Moving");  break;
+    case ALIGN_SAMPLE:  out.add("Sample");  break;
+    case ALIGN_FINISH:  out.add("Finish");  break;
+    case ALIGN_DONE:    out.add("Done");    break;
+    case ALIGN_ABORTED: out.add("Aborted"); break;
+  }
+  out.add(';').add(_evals);
+  out.add(';').add(_bestValue,2);
+  for(uint8_t i = 0; i<_n; i++) out.add(';').add(_best[i],2);
+}
+
+// Consulta si la alineación terminó desde la última consulta.
+bool FIPC_Align::finished(){
+  if( !_finished ) return false;
+  _finished = false;
+  return true;
+}
+
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+void FIPC_Align::exec(){
+  if( (_status!=ALIGN_MOVE)&&(_status!=ALIGN_SAMPLE)&&(_status!=ALIGN_FINISH) ) return;
+
+  // Espera que los ejes se detengan
+  for(uint8_t i = 0; i<_n; i++) if( !_axis[i]->isReady() ) return;
+
+  // 1° Llegó al mejor punto
+  if( _status==ALIGN_FINISH ){
+    _status = ALIGN_DONE;
+    _finished = true;
+    return;
+  }
+
+  // 2° Punto fuera de los límites, se evalúa sin desplazarse
+  if( _invalid ){
+    _evals++;
+    FIPC_Align::onEval(ALIGN_INVALID);
+    return;
+  }
+
+  // 3° Promedia las lecturas nuevas hasta completar el promedio
+  float value;
+  if( _status==ALIGN_MOVE ){
+    _status = ALIGN_SAMPLE;
+    _sum = 0.0;
+    _count = 0;
+    _sensor->read(value); // descarta la lectura tomada durante el desplazamiento
+    return;
+  }
+  if( !_sensor->read(value) ) return;
+  _sum += value;
+  if( ++_count<_samples ) return;
+
+  _evals++;
+  FIPC_Align::onEval(_sum/_count);
+}
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Ancho de la diferencia finita del eje k.
+// Con un ancho menor que un paso el eje no se desplaza y el gradiente sería nulo.
+float FIPC_Align::probeWidth(uint8_t k){
+  return max(_minStep, 1.0f/_axis[k]->getStepsPerUnit());
+}
+
+// Ordena el desplazamiento al punto _trial.
+void FIPC_Align::evaluate(){
+  _status = ALIGN_MOVE;
+  _invalid = false;
+  uint8_t i;
+  for(i = 0; i<_n; i++) if( !_axis[i]->canMoveAbsolute(_trial[i]) ) _invalid = true;
+  if( _invalid ) return;
+  // El presupuesto de pasos puede estirar el desplazamiento; si lo descarta se cancela
+  if( !_budget->setAction(_axis, _n, FIPC_Axis::ACTION_MOVE_ABSOLUTE, _trial, true) ) FIPC_Align::stop();
+}
+
+// Procesa la potencia medida según el algoritmo.
+void FIPC_Align::onEval(float value){
+  _lastImproved = (value>_bestValue);
+  if( _lastImproved ){
+    _bestValue = value;
+    for(uint8_t i = 0; i<_n; i++) _best[i] = _trial[i];
+  }
+  if( _evals>=_maxEval ){
+    FIPC_Align::finish();
+    return;
+  }
+
+  switch(_type){
+    case ALIGN_HILL:            FIPC_Align::hillEval(value);     break;
+    case ALIGN_SPIRAL_GRADIENT: FIPC_Align::gradientEval(value); break;
+    case ALIGN_SIMPLEX:         FIPC_Align::simplexEval(value);  break;
+  }
+}
+
+// Ascenso por coordenadas.
+void FIPC_Align::hillEval(float value){
+  if( _phase==PHASE_BASE ){
+    _phase = PHASE_HILL;
+    _k = 0; _dir = 1;
+    _moved = _improved = false;
+  } else if( _lastImproved ){   // continúa en el mismo sentido
+    _moved = _improved = true;
+  } else if( (_dir==1)&&(!_moved) ){ // prueba el sentido opuesto
+    _dir = -1;
+  } else {                      // siguiente eje
+    _dir = 1;
+    _moved = false;
+    if( ++_k>=_n ){
+      _k = 0;
+      if( !_improved ) _step /= 2.0;
+      _improved = false;
+      if( _step<_minStep ){ FIPC_Align::finish(); return; }
+    }
+  }
+
+  for(uint8_t i = 0; i<_n; i++) _trial[i] = _best[i];
+  _trial[_k] += _dir*_step;
+  FIPC_Align::evaluate();
+}
+
+// Espiral de primera luz y ascenso por gradiente.
+void FIPC_Align::gradientEval(float value){
+  uint8_t i;
+  switch(_phase){
+    case PHASE_BASE:
+      for(i = 0; i<_n; i++) _base[i] = _trial[i];
+      _baseValue = value;
+      _theta = 0.0;
+      _phase = PHASE_SPIRAL;
+      if( value>=_threshold ) { _phase = PHASE_PROBE; _k = 0; }
+      break;
+
+    case PHASE_SPIRAL:
+      if( value>=_threshold ){ // primera luz, comienza el gradiente desde este punto
+        for(i = 0; i<_n; i++) _base[i] = _trial[i];
+        _baseValue = value;
+        _phase = PHASE_PROBE;
+        _k = 0;
+      }
+      break;
+
+    case PHASE_PROBE:
+      _grad[_k] = (value-_baseValue)/FIPC_Align::probeWidth(_k);
+      _k++;
+      break;
+
+    case PHASE_ASCENT:
+      if( value>_baseValue ){ // acepta el paso y vuelve a estimar el gradiente
+        for(i = 0; i<_n; i++) _base[i] = _trial[i];
+        _baseValue = value;
+        _phase = PHASE_PROBE;
+        _k = 0;
+      } else {
+        _step /= 2.0;
+        if( _step<_minStep ){ FIPC_Align::finish(); return; }
+      }
+      break;
+
+    default: break;
+  }
+
+  // Próximo punto de la espiral (paso radial y separación entre puntos iguales a _step)
+  if( _phase==PHASE_SPIRAL ){
+    float radius = _step*_theta/(2.0*PI);
+    _theta += _step/max(radius, _step);
+    radius = _step*_theta/(2.0*PI);
+    for(i = 0; i<_n; i++) _trial[i] = _base[i];
+    _trial[0] += radius*cos(_theta);
+    _trial[1] += radius*sin(_theta);
+    FIPC_Align::evaluate();
+    return;
+  }
+
+  // Diferencias finitas hacia adelante con ancho _minStep (al menos un paso del eje)
+  if( (_phase==PHASE_PROBE)&&(_k<_n) ){
+    for(i = 0; i<_n; i++) _trial[i] = _base[i];
+    _trial[_k] += FIPC_Align::probeWidth(_k);
+    FIPC_Align::evaluate();
+    return;
+  }
+
+  // Paso de longitud _step en la dirección del gradiente
+  float norm = 0.0;
+  for(i = 0; i<_n; i++) norm += _grad[i]*_grad[i];
+  norm = sqrt(norm);
+  if( norm==0.0 ){ FIPC_Align::finish(); return; }
+  _phase = PHASE_ASCENT;
+  for(i = 0; i<_n; i++) _trial[i] = _base[i] + _step*_grad[i]/norm;
+  FIPC_Align::evaluate();
+}
+
+// Nelder-Mead (maximización).
+void FIPC_Align::simplexEval(float value){
+  uint8_t i, j;
+  switch(_phase){
+    case PHASE_BASE:
+      _phase = PHASE_NM_INIT;
+      _k = 0;
+      // sin break, registra el vértice 0
+    case PHASE_NM_INIT:
+    case PHASE_NM_SHRINK:
+      for(i = 0; i<_n; i++) _simplex[_k][i] = _trial[i];
+      _simplexValue[_k] = value;
+      // Próximo vértice a evaluar
+      for(_k++; _k<=_n; _k++){
+        if( _phase==PHASE_NM_INIT ){
+          for(i = 0; i<_n; i++) _trial[i] = _simplex[0][i];
+          _trial[_k-1] += _step;
+          FIPC_Align::evaluate();
+          return;
+        }
+        if( _k!=_worst ){ // en la reducción _worst guarda el índice del mejor vértice
+          for(i = 0; i<_n; i++) _trial[i] = _simplex[_worst][i] + NM_SHRINK*(_simplex[_k][i]-_simplex[_worst][i]);
+          FIPC_Align::evaluate();
+          return;
+        }
+      }
+      FIPC_Align::simplexIterate();
+      return;
+
+    case PHASE_NM_REFLECT: {
+      _reflectValue = value;
+      for(i = 0; i<_n; i++) _reflect[i] = _trial[i];
+      float bestV = ALIGN_INVALID, secondV = -ALIGN_INVALID;
+      for(j = 0; j<=_n; j++){
+        if( _simplexValue[j]>bestV ) bestV = _simplexValue[j];
+        if( (j!=_worst)&&(_simplexValue[j]<secondV) ) secondV = _simplexValue[j];
+      }
+      if( value>bestV ){ // expansión
+        _phase = PHASE_NM_EXPAND;
+        for(i = 0; i<_n; i++) _trial[i] = _centroid[i] + NM_EXPAND*(_reflect[i]-_centroid[i]);
+        FIPC_Align::evaluate();
+        return;
+      }
+      if( value>secondV ){ // acepta la reflexión
+        for(i = 0; i<_n; i++) _simplex[_worst][i] = _reflect[i];
+        _simplexValue[_worst] = value;
+        FIPC_Align::simplexIterate();
+        return;
+      }
+      // contracción exterior o interior
+      _phase = PHASE_NM_CONTRACT;
+      float* from = (value>_simplexValue[_worst]) ? _reflect : _simplex[_worst];
+      for(i = 0; i<_n; i++) _trial[i] = _centroid[i] + NM_CONTRACT*(from[i]-_centroid[i]);
+      FIPC_Align::evaluate();
+      return;
+    }
+
+    case PHASE_NM_EXPAND:
+      if( value>_reflectValue ){
+        for(i = 0; i<_n; i++) _simplex[_worst][i] = _trial[i];
+        _simplexValue[_worst] = value;
+      } else {
+        for(i = 0; i<_n; i++) _simplex[_worst][i] = _reflect[i];
+        _simplexValue[_worst] = _reflectValue;
+      }
+      FIPC_Align::simplexIterate();
+      return;
+
+    case PHASE_NM_CONTRACT:
+      if( value>=max(_reflectValue, _simplexValue[_worst]) ){
+        for(i = 0; i<_n; i++) _simplex[_worst][i] = _trial[i];
+        _simplexValue[_worst] = value;
+        FIPC_Align::simplexIterate();
+        return;
+      }
+      // reducción hacia el mejor vértice
+      _worst = 0;
+      for(j = 1; j<=_n; j++) if( _simplexValue[j]>_simplexValue[_worst] ) _worst = j;
+      _phase = PHASE_NM_SHRINK;
+      _k = (_worst==0) ? 1 : 0;
+      for(i = 0; i<_n; i++) _trial[i] = _simplex[_worst][i] + NM_SHRINK*(_simplex[_k][i]-_simplex[_worst][i]);
+      FIPC_Align::evaluate();
+      return;
+
+    default: break;
+  }
+}
+
+// Inicia una iteración de Nelder-Mead con todos los vértices evaluados.
+void FIPC_Align::simplexIterate(){
+  uint8_t i, j, best = 0;
+  _worst = 0;
+  for(j = 1; j<=_n; j++){
+    if( _simplexValue[j]>_simplexValue[best] )   best = j;
+    if( _simplexValue[j]<_simplexValue[_worst] ) _worst = j;
+  }
+
+  // Convergencia: todos los vértices a menos de _minStep del mejor
+  float size = 0.0;
+  for(j = 0; j<=_n; j++)
+    for(i = 0; i<_n; i++) size = max(size, (float)abs(_simplex[j][i]-_simplex[best][i]));
+  if( size<_minStep ){ FIPC_Align::finish(); return; }
+
+  for(i = 0; i<_n; i++){
+    _centroid[i] = 0.0;
+    for(j = 0; j<=_n; j++) if( j!=_worst ) _centroid[i] += _simplex[j][i];
+    _centroid[i] /= _n;
+    _trial[i] = 2.0*_centroid[i]-_simplex[_worst][i];
+  }
+  _phase = PHASE_NM_REFLECT;
+  FIPC_Align::evaluate();
+}
+
+// Termina la búsqueda desplazándose al mejor punto.
+void FIPC_Align::finish(){
+  for(uint8_t i = 0; i<_n; i++) _trial[i] = _best[i];
+  FIPC_Align::evaluate();
+  if( _status==ALIGN_MOVE ) _status = ALIGN_FINISH;
+}
+
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,238 @@
+/*! \file FIPC_Align.h
+ *  \brief Clase que implementa la búsqueda del máximo de potencia óptica.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Align_h
+#define FIPC_Align_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+#include "FIPC_Budget.h"
+#include "FIPC_PowerSensor.h"
+
+#define ALIGN_AXIS_NUMBERS 3 /*!< Cantidad máxima de ejes que participan de la alineación. */
+
+//!  Clase que implementa la búsqueda del máximo de potencia óptica.
+/*!
+ *   La alineación se ejecuta completamente en el controlador desde el proceso en
+ *   tiempo real. Cada evaluación desplaza los ejes seleccionados al punto a evaluar,
+ *   espera a que se detengan y promedia varias lecturas de FIPC_PowerSensor tomadas
+ *   luego de la detención (el conversor se lee fuera de la tarea de tiempo real, ver
+ *   FIPC_AnalogSensor). Al finalizar los ejes quedan en el mejor punto encontrado.
+ *
+ *   \par Algoritmos
+ *   \li FIPC_Align::ALIGN_HILL Ascenso por coordenadas: recorre cada eje mientras la potencia
+ *   aumente y reduce el paso a la mitad cuando ningún eje mejora.
+ *   \li FIPC_Align::ALIGN_SPIRAL_GRADIENT Busca primera luz con una espiral sobre los dos primeros
+ *   ejes hasta superar el umbral y luego asciende por el gradiente estimado por diferencias finitas.
+ *   \li FIPC_Align::ALIGN_SIMPLEX Nelder-Mead sobre los ejes seleccionados.
+ *
+ *   \par Convergencia
+ *   La búsqueda termina cuando el paso (o el tamaño del simplex) es menor que el paso mínimo
+ *   o cuando se alcanza la cantidad máxima de evaluaciones.
+*/
+class FIPC_Align
+{
+  public:
+
+    //! Definicion de variable simbólica de algoritmos.
+    typedef enum{ ALIGN_HILL,             /*!< Ascenso por coordenadas. */
+                  ALIGN_SPIRAL_GRADIENT,  /*!< Espiral de primera luz y ascenso por gradiente. */
+                  ALIGN_SIMPLEX           /*!< Nelder-Mead. */
+                  }AlignType;
+
+    //! Definicion de variable simbólica de estados de la alineación.
+    typedef enum{ ALIGN_IDLE,     /*!< Sin alineación en ejecución. */
+                  ALIGN_MOVE,     /*!< Desplazándose al punto a evaluar. */
+                  ALIGN_SAMPLE,   /*!< Leyendo la potencia en el punto. */
+                  ALIGN_FINISH,   /*!< Desplazándose al mejor punto encontrado. */
+                  ALIGN_DONE,     /*!< Alineación finalizada. */
+                  ALIGN_ABORTED   /*!< Alineación cancelada. */
+                  }AlignStatus;
+
+    //! Constructor.
+    /*!
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista.
+      \param pSensor Lectura de potencia óptica.
+      \param pBudget Presupuesto de pasos de exec() de las acciones de los ejes.
+     */
+    FIPC_Align(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_PowerSensor* pSensor, FIPC_Budget* pBudget);
+
+    //! Configura la lectura de potencia óptica.
+    /*!
+      \param pSensor Lectura de potencia óptica.
+      \param iSamples Cantidad de lecturas a promediar por evaluación.
+    */
+    void setSensor(FIPC_PowerSensor* pSensor, uint16_t iSamples);
+
+    //! Inicia una alineación desde la posición actual.
+    /*!
+      \param type Algoritmo (ver FIPC_Align::AlignType).
+      \param id Identificadores de los ejes, 0 si no se utiliza (el primero es obligatorio).
+      \param step Paso inicial en unidades de los ejes.
+      \param minStep Paso mínimo, define la convergencia.
+      \param maxEval Cantidad máxima de evaluaciones.
+      \param threshold Umbral de primera luz (solo ALIGN_SPIRAL_GRADIENT).
+      \return true si la alineación fue iniciada.
+    */
+    bool start(uint8_t type, uint8_t id[], float step, float minStep, uint16_t maxEval, float threshold);
+
+    //! Cancela la alineación y detiene los ejes.
+    void stop();
+
+    //! Ejecuta la alineación.
+    /*!
+     * Esta función deberá ser llamada recurrentemente en tiempo real.
+    */
+    void exec();
+
+    //! Retorna el estado de la alineación.
+    /*!
+      \return La variable simbólica que describe el estado de la alineación.
+    */
+    uint8_t getStatus();
+
+    //! Solicita un reporte de la alineación.
+    /*!
+      \param out Texto donde se agrega "estado;evaluaciones;mejor potencia;posición de cada eje".
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Consulta si la alineación terminó desde la última consulta.
+    /*!
+      \return true una única vez al finalizar la alineación.
+    */
+    bool finished();
+
+  private:
+    //! Definicion de variable simbólica de etapas internas de cada algoritmo.
+    typedef enum{ PHASE_BASE,       /*!< Evaluación del punto inicial. */
+                  PHASE_HILL,       /*!< Ascenso por coordenadas. */
+                  PHASE_SPIRAL,     /*!< Espiral de primera luz. */
+                  PHASE_PROBE,      /*!< Estimación del gradiente. */
+                  PHASE_ASCENT,     /*!< Paso en la dirección del gradiente. */
+                  PHASE_NM_INIT,    /*!< Evaluación de los vértices iniciales del simplex. */
+                  PHASE_NM_REFLECT, /*!< Reflexión del peor vértice. */
+                  PHASE_NM_EXPAND,  /*!< Expansión. */
+                  PHASE_NM_CONTRACT,/*!< Contracción. */
+                  PHASE_NM_SHRINK   /*!< Reducción hacia el mejor vértice. */
+                  }AlignPhase;
+
+    FIPC_Axis** _axisList; /*!< Lista de ejes del controlador. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes en la lista. */
+
+    FIPC_PowerSensor* _sensor; /*!< Lectura de potencia óptica. */
+
+    FIPC_Budget* _budget; /*!< Presupuesto de pasos de exec(). */
+
+    uint16_t _samples = 8; /*!< Cantidad de lecturas a promediar por evaluación. */
+
+    FIPC_Axis* _axis[ALIGN_AXIS_NUMBERS]; /*!< Ejes seleccionados. */
+
+    uint8_t _n = 0; /*!< Cantidad de ejes seleccionados. */
+
+    AlignType _type = ALIGN_HILL; /*!< Algoritmo en ejecución. */
+
+    AlignPhase _phase = PHASE_BASE; /*!< Etapa interna del algoritmo. */
+
+    volatile AlignStatus _status = ALIGN_IDLE; /*!< Estado de la alineación. */
+
+    volatile bool _finished = false; /*!< Indica el fin de la alineación hasta ser consultado. */
+
+    float _step; /*!< Paso actual. */
+
+    float _minStep; /*!< Paso mínimo. */
+
+    uint16_t _maxEval; /*!< Cantidad máxima de evaluaciones. */
+
+    uint16_t _evals = 0; /*!< Cantidad de evaluaciones realizadas. */
+
+    float _threshold; /*!< Umbral de primera luz. */
+
+    float _trial[ALIGN_AXIS_NUMBERS]; /*!< Punto en evaluación. */
+
+    bool _invalid = false; /*!< El punto en evaluación está fuera de los límites. */
+
+    float _sum = 0.0; /*!< Suma de lecturas del punto en evaluación. */
+
+    uint16_t _count = 0; /*!< Cantidad de lecturas del punto en evaluación. */
+
+    float _best[ALIGN_AXIS_NUMBERS]; /*!< Mejor punto encontrado. */
+
+    float _bestValue; /*!< Potencia en el mejor punto encontrado. */
+
+    float _base[ALIGN_AXIS_NUMBERS]; /*!< Punto de referencia de la etapa (inicio de espiral o gradiente). */
+
+    float _baseValue; /*!< Potencia en el punto de referencia. */
+
+    float _grad[ALIGN_AXIS_NUMBERS]; /*!< Gradiente estimado. */
+
+    uint8_t _k = 0; /*!< Eje o vértice en evaluación. */
+
+    int8_t _dir = 1; /*!< Sentido del ascenso por coordenadas. */
+
+    bool _moved = false; /*!< El eje actual mejoró en el sentido actual. */
+
+    bool _improved = false; /*!< Algún eje mejoró en el ciclo actual. */
+
+    bool _lastImproved = false; /*!< La última evaluación mejoró la potencia. */
+
+    float _theta = 0.0; /*!< Ángulo de la espiral en radianes. */
+
+    float _simplex[ALIGN_AXIS_NUMBERS+1][ALIGN_AXIS_NUMBERS]; /*!< Vértices del simplex. */
+
+    float _simplexValue[ALIGN_AXIS_NUMBERS+1]; /*!< Potencia en cada vértice. */
+
+    float _centroid[ALIGN_AXIS_NUMBERS]; /*!< Centroide de los vértices sin el peor. */
+
+    float _reflect[ALIGN_AXIS_NUMBERS]; /*!< Punto reflejado. */
+
+    float _reflectValue; /*!< Potencia en el punto reflejado. */
+
+    uint8_t _worst = 0; /*!< Índice del peor vértice. */
+
+    //! Ancho de la diferencia finita del eje k (_minStep, al menos un paso del eje).
+    /*!
+      \param k Índice del eje en la alineación.
+    */
+    float probeWidth(uint8_t k);
+
+    //! Ordena el desplazamiento al punto _trial.
+    void evaluate();
+
+    //! Procesa la potencia medida en _trial según el algoritmo.
+    void onEval(float value);
+
+    //! Etapa del ascenso por coordenadas.
+    void hillEval(float value);
+
+    //! Etapas de espiral y gradiente.
+    void gradientEval(float value);
+
+    //! Etapas de Nelder-Mead.
+    void simplexEval(float value);
+
+    //! Inicia una iteración de Nelder-Mead con todos los vértices evaluados.
+    void simplexIterate();
+
+    //! Termina la búsqueda desplazándose al mejor punto.
+    void finish();
+};
+#endif
@@ -8,24 +8,43 @@
 # define INIT_ACCEL_TIME    1.0   /*!< Identificador. */
 # define HOME_FACTOR_SLOW   0.02  /*!< Factor de velocidad máxima configurada al asignar tipo de eje en búsqueda de cero lenta. */
 # define HOME_FACTOR_FAST   0.1   /*!< Factor de velocidad máxima configurada al asignar tipo de eje en búsqueda de cero rápida. */
+# define PERSIST_SETTLE_MS  1000  /*!< Tiempo en reposo en ms antes de guardar la posición (agrupa escrituras). */
+# define JOG_TIMEOUT_MS     500   /*!< Tiempo límite por defecto sin actualizaciones del modo velocidad en ms. */
+
+portMUX_TYPE FIPC_Axis::_armMux = portMUX_INITIALIZER_UNLOCKED;
 
 // Constructor.
-FIPC_Axis::FIPC_Axis(uint8_t set_id, uint8_t pinSTEP, uint8_t pinDIR, uint8_t pinEN, uint8_t switch_1, uint8_t switch_2, uint8_t switch_ref) {
+// El driver, la búsqueda del cero y la salida sincronizada son miembros del eje:
+// no se reserva memoria dinámica.
+FIPC_Axis::FIPC_Axis(uint8_t set_id, uint8_t pinSTEP, uint8_t pinDIR, uint8_t pinEN, uint8_t switch_1, uint8_t switch_2, uint8_t switch_ref) :
+  _stepper(pinSTEP, pinDIR),
+  _homing(&_stepper, switch_ref) {
   _id = set_id;
 
-  // Inicializa y configura una nueva instancia de AccelStepper
+  // Configura el driver del motor
   _direction = false;
-  _Axis = new AccelStepper(AccelStepper::DRIVER, pinSTEP, pinDIR);    
-  _Axis->setEnablePin(pinEN);
-  _Axis->setPinsInverted(_direction,false,true);
+  _pinStep = pinSTEP;
+  _pinDir = pinDIR;
+  _Axis = &_stepper;
+  _Axis->setEnablePin(_pinEnable = pinEN);
+  _stepper.setPinsInverted(_direction,false,true);
   _Axis->disableOutputs();
 
   // Configura las GPIO de entrada
   pinMode(_switch_1 = switch_1, INPUT);
   pinMode(_switch_2 = switch_2, INPUT);
 
-  // Construye una nueva instancia de la clase FIPC_Homing
-  _Homing = new FIPC_Homing(_Axis,_switch_ref=switch_ref); 
+  // Búsqueda de la referencia cero
+  _Homing = &_homing;
+  _switch_ref = switch_ref;
+
+  // Salida sincronizada con la posición
+  _PSO = &_pso;
+
+  // Entradas de modo de micropasos
+  _StepMode = &_stepMode;
+
+  _jogTimeout = JOG_TIMEOUT_MS;
 }
 
 
@@ -37,57 +56,115 @@ FIPC_Axis::FIPC_Axis(uint8_t set_id, uint8_t pinSTEP, uint8_t pinDIR, uint8_t pi
 // Está basado en los datasheet de los ejes
 // para más información ver https://www.optics-focus.com/6axis-motorized-positioning-stage-p-661.html.
 // La configuración de la máxima velocidad corresponde a 6000 pasos per second.
-void FIPC_Axis::setMotorStage(MotorStage type){
+// La aceleración máxima permite alcanzar la velocidad máxima en 0.25 segundos.
+void FIPC_Axis::getPreset(MotorStage type, FIPC_Config::AxisConfig &oConfig){
+  memset(&oConfig, 0, sizeof(oConfig));
+  memset(oConfig.pinMode, MICROSTEP_NONE, MICROSTEP_PINS);
+  oConfig.stage = type;
+  oConfig.flags = CONFIG_LIMITS;
   switch(type){
     case MOX_02_30:
-      _type = type;
-      _factorToStep = 3.2;      // en [_units/um]
-      _veloMax = 1875;          // en [_units/s]
-      _minPosition = 0;         // en [_units]
-      _maxPosition = 30000;     // en [_units]
-      _speed = _veloMax*INIT_FACTOR_SPEED;
-      _accelTime = INIT_ACCEL_TIME;
-      _units = String("um");
+      oConfig.stepsPerUnit = 3.2;   // en [step/_units]
+      oConfig.veloMax = 1875;       // en [_units/s]
+      oConfig.accelMax = 7500;      // en [_units/s^2]
+      oConfig.minPosition = 0;      // en [_units]
+      oConfig.maxPosition = 30000;  // en [_units]
+      strcpy(oConfig.units, "um");
       break;
       
     case MOR_100_30:
-      _type = type;
-      _factorToStep = 1.6;      // en [step/_units]
-      _veloMax = 3750;          // en [_units/s]
-      _minPosition = 0;         // en [_units]
-      _maxPosition = 360000;    // en [_units]
-      _speed = _veloMax*INIT_FACTOR_SPEED; 
-      _accelTime = INIT_ACCEL_TIME;
-      FIPC_Axis::invertDirection();
-      _units = String("mgrad");
+      oConfig.stepsPerUnit = 1.6;   // en [step/_units]
+      oConfig.veloMax = 3750;       // en [_units/s]
+      oConfig.accelMax = 15000;     // en [_units/s^2]
+      oConfig.minPosition = 0;      // en [_units]
+      oConfig.maxPosition = 360000; // en [_units]
+      oConfig.flags = CONFIG_INVERT_DIR; // rotativo: sin fines de carrera
+      strcpy(oConfig.units, "mgrad");
       break;
       
     case MOG_65_10:
-      _type = type;
-      _factorToStep = 6.25;     // en [step/_units]
-      _veloMax = 960;          // en [_units/s]
-      _minPosition = -15000;    // en [_units]
-      _maxPosition = 15000;     // en [_units]
-      _speed = _veloMax*INIT_FACTOR_SPEED; 
-      _accelTime = INIT_ACCEL_TIME;
-      _Homing->setZero(-15000*_factorToStep);
-      _units = String("mgrad");
+      oConfig.stepsPerUnit = 6.25;  // en [step/_units]
+      oConfig.veloMax = 960;        // en [_units/s]
+      oConfig.accelMax = 3840;      // en [_units/s^2]
+      oConfig.minPosition = -15000; // en [_units]
+      oConfig.maxPosition = 15000;  // en [_units]
+      oConfig.zero = -15000;        // en [_units]
+      strcpy(oConfig.units, "mgrad");
       break;
       
     case MOG_65_15:
-      _type = type;
-      _factorToStep = 4.44444;  // en [step/_units]
-      _veloMax = 1350;          // en [_units/s]
-      _minPosition = -21000;    // en [_units]
-      _maxPosition = 21000;     // en [_units]
-      _speed = _veloMax*INIT_FACTOR_SPEED;
-      _accelTime = INIT_ACCEL_TIME;
-      _Homing->setZero(-21000*_factorToStep);
-      _units = String("mgrad");
+      oConfig.stepsPerUnit = 4.44444; // en [step/_units]
+      oConfig.veloMax = 1350;       // en [_units/s]
+      oConfig.accelMax = 5400;      // en [_units/s^2]
+      oConfig.minPosition = -21000; // en [_units]
+      oConfig.maxPosition = 21000;  // en [_units]
+      oConfig.zero = -21000;        // en [_units]
+      strcpy(oConfig.units, "mgrad");
       break;
   }
+}
 
-  _Homing->setSpeed(HOME_FACTOR_FAST*_veloMax*_factorToStep, HOME_FACTOR_SLOW*_veloMax*_factorToStep);
+// Establece el tipo de eje conservando las GPIO configuradas.
+void FIPC_Axis::setMotorStage(MotorStage type){
+  FIPC_Config::AxisConfig config;
+  FIPC_Axis::getPreset(type, config);
+  config.pinStep = _pinStep;
+  config.pinDir = _pinDir;
+  config.pinEnable = _pinEnable;
+  config.pinPositive = _switch_1;
+  config.pinNegative = _switch_2;
+  config.pinRef = _switch_ref;
+  FIPC_Axis::setConfig(config);
+}
+
+// Aplica la configuración del eje.
+// Los valores que usa el proceso en tiempo real se precalculan en pasos.
+bool FIPC_Axis::setConfig(const FIPC_Config::AxisConfig &iConfig){
+  if( _axis_status!=STATUS_DISABLE ) return false;
+
+  // Driver del motor: solo se reinicia si cambian las GPIO
+  if( (iConfig.pinStep!=_pinStep)||(iConfig.pinDir!=_pinDir)||(iConfig.pinEnable!=_pinEnable) ){
+    _stepper = FIPC_Stepper(_pinStep = iConfig.pinStep, _pinDir = iConfig.pinDir);
+    _Axis->setEnablePin(_pinEnable = iConfig.pinEnable);
+  }
+  _direction = iConfig.flags&CONFIG_INVERT_DIR;
+  _stepper.setPinsInverted(_direction,false,true);
+  _Axis->disableOutputs();
+  pinMode(_switch_1 = iConfig.pinPositive, INPUT);
+  pinMode(_switch_2 = iConfig.pinNegative, INPUT);
+
+  _type = iConfig.stage;
+  strncpy(_units, iConfig.units, CONFIG_UNITS_SIZE);
+  _factorToStep = iConfig.stepsPerUnit;
+  _minPosition = iConfig.minPosition;
+  _maxPosition = iConfig.maxPosition;
+  FIPC_Axis::applyLimits(iConfig.veloMax, iConfig.accelMax);
+  _speed = _veloMax*INIT_FACTOR_SPEED;
+  _accelTime = INIT_ACCEL_TIME;
+
+  _minSteps = lroundf(_minPosition*_factorToStep);
+  _maxSteps = lroundf(_maxPosition*_factorToStep);
+
+  // Generación de pulsos por hardware: un canal RMT por eje, solo con pasos en GPIO
+  _pulseEnable = (iConfig.flags&CONFIG_PULSE_RMT)&&(!_stepper.isShifted())&&(_pulse.begin(_id-1, _pinStep));
+
+  // Cambio de micropasos: el driver queda en el modo fino
+  _microEnable = false;
+  if( iConfig.flags&CONFIG_MICROSTEP ){
+    if( _StepMode==&_stepMode ) _stepMode.begin(iConfig.pinMode);
+    _microEnable = _micro.begin(_StepMode, iConfig.stepFine, iConfig.stepCoarse);
+  }
+  _rateMax = (_pulseEnable) ? CONFIG_MAX_PULSE_RATE : CONFIG_MAX_STEP_RATE;
+  if( _microEnable ) _rateMax *= 1L<<(iConfig.stepFine-iConfig.stepCoarse);
+  _execScale = (_pulseEnable) ? 0.0 : 1.0;
+  if( _microEnable ) _execScale /= 1L<<(iConfig.stepFine-iConfig.stepCoarse);
+
+  // Búsqueda de la referencia cero
+  _Homing->setSwitch(_switch_ref = iConfig.pinRef);
+  _Homing->setDirection(iConfig.flags&CONFIG_HOME_POSITIVE);
+  _Homing->setZero(_zeroSteps = lroundf(iConfig.zero*_factorToStep));
+  _Homing->setSpeed(HOME_FACTOR_FAST*_veloSoft*_factorToStep, HOME_FACTOR_SLOW*_veloSoft*_factorToStep);
+  return true;
 }
 
 // Analiza la acción según el estado en que se encuentra el objeto
@@ -95,47 +172,131 @@ bool FIPC_Axis::setAction(uint8_t iAction, float iData){
   switch(_axis_status) {
     case STATUS_DISABLE:
       if( iAction==ACTION_ENABLE ) {
-        _newExec = EXEC_ENABLE;
+        FIPC_Axis::post(EXEC_ENABLE);
         return true;
       }
       break;
     case STATUS_NO_HOME:
       if( iAction==ACTION_DISABLE ){
-        _newExec = EXEC_DISABLE;
+        FIPC_Axis::post(EXEC_DISABLE);
         return true;
       }
       if( iAction==ACTION_HOMING ){
-        _newExec = EXEC_HOMING;
+        FIPC_Axis::post(EXEC_HOMING);
+        return true;
+      }
+      if( (iAction==ACTION_RESTORE)&&(_persist)&&(_storedHomed) ){
+        FIPC_Axis::post(EXEC_RESTORE);
         return true;
       }
       break;
     case STATUS_HOMING:
       if( iAction==ACTION_STOP ){
-        _newExec = EXEC_STOP;
+        FIPC_Axis::post(EXEC_STOP);
         return true;
       }
       break;
     case STATUS_READY:
       if( iAction==ACTION_DISABLE ){
-        _newExec = EXEC_DISABLE;
+        FIPC_Axis::post(EXEC_DISABLE);
         return true;
       }
       if( ((iAction==ACTION_MOVE_RELATIVE)&&(FIPC_Axis::configMoveRelative(iData))) ||
           ((iAction==ACTION_MOVE_ABSOLUTE)&&(FIPC_Axis::configMoveAbsolute(iData))) ){
-            _newExec = EXEC_RUN;
+            FIPC_Axis::post(EXEC_RUN);
             return true;            
           }
+      if( (iAction==ACTION_JOG)&&(iData!=0.0) ){
+        FIPC_Axis::configJog(iData);
+        FIPC_Axis::post(EXEC_JOG);
+        return true;
+      }
+      if( iAction==ACTION_TRACK ){
+        FIPC_Axis::post(EXEC_TRACK);
+        return true;
+      }
+      if( (iAction==ACTION_STOP)&&(_newExec==EXEC_TRACK) ){
+        _newExec = EXEC_WAIT; // cancela el seguimiento antes de iniciarlo
+        return true;
+      }
       break;
     case STATUS_MOVING:
       if( iAction==ACTION_STOP ){
-        _newExec = EXEC_STOP;
+        FIPC_Axis::post(EXEC_STOP);
         return true;
       }
       break;        
+    case STATUS_TRACKING:
+      if( iAction==ACTION_STOP ){
+        FIPC_Axis::post(EXEC_STOP);
+        return true;
+      }
+      if( iAction==ACTION_DISABLE ){
+        FIPC_Axis::post(EXEC_DISABLE);
+        return true;
+      }
+      break;
+    case STATUS_JOGGING:
+      if( iAction==ACTION_STOP ){
+        FIPC_Axis::post(EXEC_STOP);
+        return true;
+      }
+      if( (iAction==ACTION_JOG)&&(_newExec!=EXEC_STOP)&&(!_jogStop) ){
+        FIPC_Axis::configJog(iData);
+        return true;
+      }
+      break;
   }
   return false;
 }
 
+// Prepara una acción para iniciarla en el mismo ciclo que la de otros ejes.
+bool FIPC_Axis::armAction(uint32_t epoch, uint8_t iAction, float iData){
+  // La parada y la deshabilitación no esperan al lote: se aplican en el próximo ciclo
+  if( (iAction==ACTION_STOP)||(iAction==ACTION_DISABLE) ){
+    FIPC_Axis::disarm();
+    return FIPC_Axis::setAction(iAction, iData);
+  }
+  _arming = epoch;
+  bool accepted = FIPC_Axis::setAction(iAction, iData);
+  _arming = 0;
+#if LATENCY_ENABLED
+  if( (accepted)&&((_armedExec==EXEC_RUN)||(_armedExec==EXEC_JOG)) ) LATENCY_PROBE(PROBE_ACCEPT);
+#endif
+  return accepted;
+}
+
+// Verifica si hay una acción preparada en un lote liberado.
+bool FIPC_Axis::isArmed(uint32_t epoch){
+  return (_armedExec!=EXEC_WAIT)&&((int32_t)(epoch-_armedEpoch)>=0);
+}
+
+// Verifica si la acción preparada puede aplicarse en este ciclo.
+bool FIPC_Axis::isArmedReady(){
+  ExecAccelStepper exec = _armedExec;
+  if( FIPC_Axis::isMove(exec) ) return FIPC_Axis::persistReadyToMove();
+  return true;
+}
+
+// Aplica la acción preparada.
+void FIPC_Axis::commit(){
+  portENTER_CRITICAL(&_armMux);
+  if( _armedExec==EXEC_JOG ) _jogUpdate = millis(); // el tiempo límite del modo velocidad corre desde el inicio
+  if( _armedExec!=EXEC_WAIT ) _newExec = _armedExec;
+  _armedExec = EXEC_WAIT;
+  portEXIT_CRITICAL(&_armMux);
+#if LATENCY_ENABLED
+  if( (_newExec==EXEC_RUN)||(_newExec==EXEC_JOG) ) LATENCY_PROBE(PROBE_PICKUP);
+#endif
+}
+
+// Cancela la acción preparada y no aplicada.
+void FIPC_Axis::disarm(){
+  portENTER_CRITICAL(&_armMux);
+  _armedExec = EXEC_WAIT;
+  portEXIT_CRITICAL(&_armMux);
+}
+
 // Configuración de velocidad
 bool FIPC_Axis::setSpeed(float iSpeed){
   if( _axis_status!=STATUS_READY ) return false;
@@ -169,46 +330,266 @@ bool FIPC_Axis::canMoveAbsolute(float iAbsolute){
 }
 
 // Elabora un reporte completo del estado del objeto
-String FIPC_Axis::getReport(){ 
-  String str_out = "#"+String(_id);   
-  str_out += ";" + FIPC_Axis::getStatus();
-  str_out += ";" + String(_Axis->currentPosition()/_factorToStep,2);
-  str_out += ";" + _units;
-  return str_out;
+void FIPC_Axis::getReport(FIPC_Text &out){ 
+  out.add('#').add(_id);   
+  out.add(';').add(FIPC_Axis::getStatus());
+  out.add(';').add(_Axis->currentPosition()/_factorToStep,2);
+  out.add(';').add(_units);
 }
 
 // Retorna el estado en que se encuentra el objeto
-String FIPC_Axis::getStatus(){ 
-  String str_out = "";   
+const char* FIPC_Axis::getStatus(){ 
   switch(_axis_status){
-    case STATUS_DISABLE: str_out +=  "Disable"; break;  
-    case STATUS_NO_HOME: str_out +=  "NoHome"; break;  
-    case STATUS_HOMING:  str_out +=  "Homing"; break;  
-    case STATUS_READY:   str_out +=  "Ready";  break;  
-    case STATUS_MOVING:  str_out +=  "Moving"; break;  
+    case STATUS_DISABLE: return "Disable";
+    case STATUS_NO_HOME: return "NoHome";
+    case STATUS_HOMING:  return "Homing";
+    case STATUS_READY:   return "Ready";
+    case STATUS_MOVING:  return "Moving";
+    case STATUS_JOGGING: return "Jogging";
+    case STATUS_TRACKING: return "Tracking";
   }
-  return str_out;
+  return "";
 }
 
 // Retorna la velocidad configurada.
-String FIPC_Axis::getSpeed(){
-  return String(_speed,2);
+float FIPC_Axis::getSpeed(){
+  return _speed;
 }
 
 // Retorna el tiempo de aceleración configurado.
-String FIPC_Axis::getAccelerationTime(){
-  return String(_accelTime,2);
+float FIPC_Axis::getAccelerationTime(){
+  return _accelTime;
 }
 
 // Retorna la posición actual en coordenadas absolutas.
-String FIPC_Axis::getCurrentPosition(){
-  return String(_Axis->currentPosition()/_factorToStep,2);
+float FIPC_Axis::getCurrentPosition(){
+  return _Axis->currentPosition()/_factorToStep;
 }
 
 // Retorna verificación de movimiento.
-String FIPC_Axis::isRunning(){
-  if(_Axis->isRunning())  return "1";
-  else  return "0";
+bool FIPC_Axis::isRunning(){
+  return (_Axis->isRunning())||(_stepper.isPending());
+}
+
+// Retorna la velocidad máxima permitida.
+float FIPC_Axis::getMaxSpeed(){
+  return _veloMax;
+}
+
+// Retorna la aceleración máxima permitida.
+float FIPC_Axis::getMaxAcceleration(){
+  return _accelMax;
+}
+
+// Configura la velocidad y la aceleración máxima permitida.
+bool FIPC_Axis::setLimits(float iVeloMax, float iAccelMax){
+  if( !FIPC_Axis::isIdle() ) return false;
+  if( !(iVeloMax>0.0)||!(iVeloMax*_factorToStep<=_rateMax)||!(iAccelMax>0.0) ) return false;
+  FIPC_Axis::applyLimits(iVeloMax, iAccelMax);
+  if( _speed>=_veloMax ) _speed = _veloMax*INIT_FACTOR_SPEED;
+  return true;
+}
+
+// Retorna la máxima velocidad que admite la generación de pulsos.
+float FIPC_Axis::getSpeedLimit(){
+  return _rateMax/_factorToStep;
+}
+
+// Estima la frecuencia de los pasos que exec() emite en una acción.
+float FIPC_Axis::getExecRate(uint8_t iAction, float iData){
+  if( (iAction==ACTION_MOVE_RELATIVE)||(iAction==ACTION_MOVE_ABSOLUTE) ) return _speed*_factorToStep*_execScale;
+  if( iAction==ACTION_JOG ) return min((float)abs(iData), _veloSoft)*_factorToStep;
+  if( iAction==ACTION_HOMING ) return HOME_FACTOR_FAST*_veloSoft*_factorToStep;
+  if( iAction==ACTION_TRACK ) return _veloSoft*_factorToStep;
+  return 0.0;
+}
+
+// Estima la frecuencia de los pasos que exec() emite en la acción en curso.
+// Un desplazamiento pendiente ya tiene su velocidad: configMoveAbsolute() la asigna al prepararlo.
+float FIPC_Axis::getExecLoad(){
+  ExecAccelStepper pending = _newExec, armed = _armedExec;
+  AxisStatus status = _axis_status;
+  if( status==STATUS_MOVING ) return _Axis->maxSpeed()*FIPC_Axis::getExecScale();
+  if( (pending==EXEC_RUN)||(armed==EXEC_RUN) ) return _Axis->maxSpeed()*_execScale;
+  if( (status==STATUS_HOMING)||(pending==EXEC_HOMING)||(armed==EXEC_HOMING) ) return HOME_FACTOR_FAST*_veloSoft*_factorToStep;
+  if( (status==STATUS_JOGGING)||(status==STATUS_TRACKING)||
+      (pending==EXEC_JOG)||(pending==EXEC_TRACK)||
+      (armed==EXEC_JOG)||(armed==EXEC_TRACK) ) return _veloSoft*_factorToStep;
+  return 0.0;
+}
+
+// Retorna la cantidad de pasos de exec() por paso de la posición en el ciclo actual.
+float FIPC_Axis::getExecScale(){
+  if( _axis_status!=STATUS_MOVING ) return 1.0;
+  if( _pulseMove ) return 0.0;
+  return (_microMove) ? _execScale : 1.0;
+}
+
+// Repite la búsqueda del cero desde el reposo.
+bool FIPC_Axis::rehome(){
+  if( !FIPC_Axis::isReady() ) return false;
+  FIPC_Axis::post(EXEC_HOMING);
+  return true;
+}
+
+// Retorna el desvío de la referencia en la última búsqueda del cero.
+long FIPC_Axis::getHomingError(){
+  return _Homing->getLatchSteps()-_zeroSteps;
+}
+
+// Estima la duración de un desplazamiento relativo (perfil trapezoidal o triangular).
+bool FIPC_Axis::estimateMoveRelative(float iRelative, float &oTime, float &oPeak, float iSpeed, float iAccelTime){
+  if( iSpeed==0.0 )     iSpeed = _speed;
+  if( iAccelTime==0.0 ) iAccelTime = _accelTime;
+  float dist  = abs(iRelative);
+  float accel = iSpeed/iAccelTime;
+
+  if( dist>=iSpeed*iSpeed/accel ){ // alcanza la velocidad de crucero
+    oPeak = iSpeed;
+    oTime = dist/iSpeed + iSpeed/accel;
+  } else {                         // perfil triangular
+    oPeak = sqrt(dist*accel);
+    oTime = 2.0*sqrt(dist/accel);
+  }
+  return FIPC_Axis::canMoveRelative(iRelative)&&(iSpeed<_veloMax);
+}
+
+// Verifica si el eje está en espera por una acción.
+bool FIPC_Axis::isReady(){
+  return (_axis_status==STATUS_READY)&&(_newExec==EXEC_WAIT);
+}
+
+// Verifica si el eje está deshabilitado.
+bool FIPC_Axis::isDisabled(){
+  return (_axis_status==STATUS_DISABLE)&&(_newExec==EXEC_WAIT);
+}
+
+// Verifica si el eje está en reposo.
+bool FIPC_Axis::isIdle(){
+  // Se lee primero la acción pendiente: exec() cambia el estado antes de descartarla
+  if( _newExec!=EXEC_WAIT ) return false;
+  return (_axis_status==STATUS_DISABLE)||(_axis_status==STATUS_NO_HOME)||(_axis_status==STATUS_READY);
+}
+
+// Retorna la posición actual en pasos.
+long FIPC_Axis::getCurrentSteps(){
+  return _Axis->currentPosition();
+}
+
+// Convierte una posición a pasos.
+long FIPC_Axis::unitsToSteps(float iUnits){
+  return iUnits*_factorToStep;
+}
+
+// Retorna el factor de conversión de unidades a pasos.
+float FIPC_Axis::getStepsPerUnit(){
+  return _factorToStep;
+}
+
+// Retorna la salida sincronizada con la posición.
+FIPC_PSO* FIPC_Axis::getPSO(){
+  return _PSO;
+}
+
+// Reemplaza las entradas de modo de micropasos.
+void FIPC_Axis::setStepMode(FIPC_StepMode* pMode){
+  if( _axis_status!=STATUS_DISABLE ) return;
+  _StepMode = (pMode) ? pMode : &_stepMode;
+}
+
+// Asigna las tablas de las rampas de los desplazamientos del periférico RMT.
+void FIPC_Axis::setTrajectoryCache(FIPC_TrajectoryCache* pCache){
+  _pulse.setCache(pCache);
+}
+
+// Detiene el eje si se desplaza hacia un fin de carrera presionado.
+bool FIPC_Axis::limitStop(bool iPositive){
+  if( _limitStop ) return false;
+  if( _axis_status==STATUS_JOGGING ){
+    if( _jogSpeed==0.0 ) return false;
+    if( ((_jogSpeed>0)!=_direction)!=iPositive ) return false; // se aleja del fin de carrera
+    _limitStop = true; // jog() desacelera con la aceleración máxima
+    return true;
+  }
+  if( (_axis_status!=STATUS_MOVING)&&(_axis_status!=STATUS_TRACKING) ) return false;
+  long togo = _Axis->distanceToGo();
+  if( togo==0 ) return false;
+  if( ((togo>0)!=_direction)!=iPositive ) return false; // se aleja del fin de carrera
+
+  if( _axis_status==STATUS_TRACKING ){
+    // La trayectoria se interrumpe en el lugar: FIPC_Kinematics detiene el resto de los ejes
+    _Axis->moveTo(_Axis->currentPosition());
+    _trackLast = true;
+    _limitStop = true;
+    return true;
+  }
+
+  if( _pulseMove )      _pulse.stop(_accelMaxSteps);
+  else if( _microMove ) _micro.stop(_accelMaxSteps);
+  else {
+    _Axis->setAcceleration(_accelMaxSteps);
+    _Axis->stop();
+  }
+  _limitStop = true;
+  return true;
+}
+
+// Actualiza el destino intermedio del seguimiento de una trayectoria.
+bool FIPC_Axis::track(long iSteps, float iSpeed, bool iLast){
+  if( (_axis_status!=STATUS_TRACKING)||(_limitStop) ) return false;
+  if( iSteps<_minSteps ) iSteps = _minSteps;
+  if( iSteps>_maxSteps ) iSteps = _maxSteps;
+  if( iSpeed>_veloSoft*_factorToStep ) iSpeed = _veloSoft*_factorToStep;
+  _Axis->moveTo(iSteps);
+  _Axis->setSpeed(iSpeed);
+  _trackLast = iLast;
+  return true;
+}
+
+// Verifica si el eje está siguiendo una trayectoria o por iniciarla.
+bool FIPC_Axis::isTracking(){
+  return (_axis_status==STATUS_TRACKING)||((_axis_status==STATUS_READY)&&(_newExec==EXEC_TRACK));
+}
+
+// Retorna el tipo de eje configurado.
+uint8_t FIPC_Axis::getMotorStage(){
+  return _type;
+}
+
+// Configura el tiempo límite sin actualizaciones del modo velocidad.
+void FIPC_Axis::setJogTimeout(uint16_t iTimeout){
+  _jogTimeout = iTimeout;
+}
+
+// Habilita la publicación de registros para guardar.
+void FIPC_Axis::setPersist(bool iEnable){
+  _persist = iEnable;
+}
+
+// Carga la posición guardada.
+void FIPC_Axis::setStoredPosition(long iSteps, bool iHomed){
+  _storedSteps = iSteps;
+  _storedHomed = iHomed;
+  _persistClean = iHomed; // el primer desplazamiento debe invalidar el registro
+  _persist = true;
+}
+
+// Obtiene el registro pendiente de guardar.
+bool FIPC_Axis::getPersistRequest(uint32_t &oSeq, long &oSteps, bool &oHomed){
+  do{
+    oSeq = _persistSeq;
+    if( (oSeq==_persistAck)||(oSeq&1) ) return false; // sin pedido o escribiéndose
+    oSteps = _persistSteps;
+    oHomed = _persistHomed;
+  }while( oSeq!=_persistSeq );
+  return true;
+}
+
+// Confirma que el registro fue guardado.
+void FIPC_Axis::persistAck(uint32_t iSeq, long iSteps, bool iHomed){
+  _storedSteps = iSteps;
+  _storedHomed = iHomed;
+  _persistAck = iSeq;
 }
 
 /*------------ PROCESO EN TIEMPO REAL ----------*/
@@ -216,13 +597,67 @@ void FIPC_Axis::exec(){
   // 1° debe atender si se está desplazando
   if( _axis_status==STATUS_MOVING ) {
     if( _newExec==EXEC_STOP ) {
-      _Axis->stop();
+      if( _pulseMove )      _pulse.stop();
+      else if( _microMove ) _micro.stop();
+      else                  _Axis->stop();
       _newExec = EXEC_WAIT;
     }
     
-    if( !_Axis->run() ) _axis_status = STATUS_READY;
+    bool running;
+    if( _pulseMove )      running = FIPC_Axis::pulseRun();
+    else if( _microMove ) running = FIPC_Axis::microRun();
+    else                  running = _Axis->run();
+#if LATENCY_ENABLED
+    FIPC_Axis::latencyStep();
+#endif
+    // En la cadena de 74HC595 el eje sigue en movimiento hasta que se emite el último paso
+    if( (!running)&&(!_stepper.isPending()) ) {
+      _axis_status = STATUS_READY;
+      _restTime = millis();
+      _limitStop = false;
+    }
+    _PSO->check(_Axis->currentPosition()); // mismo ciclo en que se emitió el paso
+    return;
+  }
+
+  // Desplazamiento en modo velocidad
+  if( _axis_status==STATUS_JOGGING ) {
+    if( _newExec==EXEC_STOP ) {
+      _jogStop = true;
+      _newExec = EXEC_WAIT;
+    }
+    bool jogging = FIPC_Axis::jog();
+#if LATENCY_ENABLED
+    FIPC_Axis::latencyStep();
+#endif
+    if( (!jogging)&&(!_stepper.isPending()) ) {
+      _Axis->setCurrentPosition(_Axis->currentPosition()); // descarta el destino del último desplazamiento
+      _axis_status = STATUS_READY;
+      _restTime = millis();
+      _limitStop = false;
+    }
+    _PSO->check(_Axis->currentPosition());
+    return;
+  }
+
+  // Seguimiento de una trayectoria
+  if( _axis_status==STATUS_TRACKING ) {
+    if( (_newExec==EXEC_STOP)||(_newExec==EXEC_DISABLE) ) {
+      // Se detiene en el lugar (FIPC_Kinematics detiene el resto de los ejes); la
+      // deshabilitación se aplica en reposo, luego de guardar la posición (ver 3°)
+      _Axis->moveTo(_Axis->currentPosition());
+      _trackLast = true;
+      if( _newExec==EXEC_STOP ) _newExec = EXEC_WAIT;
+    }
+    if( (!_Axis->runSpeedToPosition())&&(_trackLast)&&(_Axis->distanceToGo()==0)&&(!_stepper.isPending()) ) {
+      _axis_status = STATUS_READY;
+      _restTime = millis();
+      _limitStop = false;
+    }
+    _PSO->check(_Axis->currentPosition());
     return;
   }
+  _PSO->check(_Axis->currentPosition());
   
   // 2° Debe atender si se está buscando el cero
   if( _axis_status==STATUS_HOMING ) {
@@ -232,17 +667,67 @@ void FIPC_Axis::exec(){
       _axis_status = STATUS_NO_HOME;
       return;
     }
-    if( !_Homing->run() ) _axis_status = STATUS_READY;
+    if( !_Homing->run() ) {
+      if( _Homing->getStatus()!=FIPC_Homing::HOMING_OK ){ // la pasada lenta no encontró el switch
+        _axis_status = STATUS_NO_HOME;
+        return;
+      }
+      _microOrigin += _zeroSteps-_Homing->getLatchSteps(); // cambio de coordenadas de la referencia
+      _axis_status = STATUS_READY;
+      _restTime = millis();
+    }
     return;
   }
 
   // 3° Espera por una acción de desplazamiento
   if( _axis_status==STATUS_READY ) {    
-    if( _newExec==EXEC_RUN ) {  
+    if( (_newExec==EXEC_RUN)&&(FIPC_Axis::persistReadyToMove()) ) {  
+      _pulseMove = (_pulseEnable)&&(FIPC_Axis::pulseStart());
+      _microMove = (_microEnable)&&(FIPC_Axis::microStart());
       _axis_status = STATUS_MOVING;          
       _newExec = EXEC_WAIT;
+#if LATENCY_ENABLED
+      _latencyStep = true;
+      _latencyFrom = _Axis->currentPosition();
+      FIPC_Axis::latencyStep(); // el periférico RMT ya emite el primer pulso
+#endif
     }
-    if( _newExec==EXEC_DISABLE ) { 
+    if( (_newExec==EXEC_JOG)&&(FIPC_Axis::persistReadyToMove()) ) {
+      _Axis->setMaxSpeed(_veloSoft*_factorToStep);
+      _jogSpeed = 0.0;
+      _jogStop = false;
+      _jogTime = micros();
+      _axis_status = STATUS_JOGGING;
+      _newExec = EXEC_WAIT;
+#if LATENCY_ENABLED
+      _latencyStep = true;
+      _latencyFrom = _Axis->currentPosition();
+#endif
+    }
+    if( (_newExec==EXEC_HOMING)&&(FIPC_Axis::persistReadyToMove()) ) {
+      _Homing->stop(); // descarta la referencia encontrada para repetir la secuencia
+      _axis_status = STATUS_HOMING;
+      _newExec = EXEC_WAIT;
+    }
+    if( (_newExec==EXEC_TRACK)&&(FIPC_Axis::persistReadyToMove()) ) {
+      _Axis->setMaxSpeed(_veloSoft*_factorToStep);
+      _Axis->moveTo(_Axis->currentPosition());
+      _trackLast = false;
+      _axis_status = STATUS_TRACKING;
+      _newExec = EXEC_WAIT;
+    }
+    if( (_axis_status==STATUS_READY)&&(_persist)&&(!_persistClean)&&(!FIPC_Axis::isMove(_newExec))&&(_armedExec==EXEC_WAIT) ){
+      // Guarda la posición luego de un tiempo en reposo o antes de deshabilitarse (no si el
+      // desplazamiento inició en este ciclo, ni mientras una acción preparada espera su lote,
+      // ver armAction()). post() publica el registro de desplazamiento desde otro núcleo: la
+      // condición se repite en la sección crítica.
+      if( (_newExec==EXEC_DISABLE)||(millis()-_restTime>=PERSIST_SETTLE_MS) ){
+        portENTER_CRITICAL(&_armMux);
+        if( (!FIPC_Axis::isMove(_newExec))&&(_armedExec==EXEC_WAIT) ) FIPC_Axis::persistPost(true);
+        portEXIT_CRITICAL(&_armMux);
+      }
+    }
+    if( (_newExec==EXEC_DISABLE)&&(!_stepper.isPending()) ) { // espera que la cadena emita los últimos pasos
       _Axis->disableOutputs();
       _Homing->stop();
       _axis_status = STATUS_DISABLE;
@@ -253,11 +738,21 @@ void FIPC_Axis::exec(){
 
   // 4° espera para buscar el cero
   if( _axis_status==STATUS_NO_HOME ) {
-    if( _newExec==EXEC_HOMING ) {
+    if( (_newExec==EXEC_HOMING)&&(FIPC_Axis::persistReadyToMove()) ) {
       _axis_status = STATUS_HOMING;
       _newExec = EXEC_WAIT;
     }
-    if( _newExec==EXEC_DISABLE ) { 
+    if( _newExec==EXEC_RESTORE ) {
+      // El registro guardado ya indica reposo en esta posición
+      _microOrigin += _storedSteps-_Axis->currentPosition();
+      _Axis->setCurrentPosition(_storedSteps);
+      portENTER_CRITICAL(&_armMux);
+      _persistClean = true;
+      portEXIT_CRITICAL(&_armMux);
+      _axis_status = STATUS_READY;
+      _newExec = EXEC_WAIT;
+    }
+    if( (_newExec==EXEC_DISABLE)&&(!_stepper.isPending()) ) { // espera que la cadena emita los últimos pasos
       _Axis->disableOutputs();
       _Homing->stop();
       _axis_status = STATUS_DISABLE;
@@ -284,9 +779,29 @@ void FIPC_Axis::exec(){
 /******************************************/ 
 /* Begin: Private                         */
 
-// Invierte el sentido de giro
-void FIPC_Axis::invertDirection(){
-  _Axis->setPinsInverted(_direction=!_direction,false,true);
+// Precalcula en pasos la velocidad y la aceleración máxima.
+void FIPC_Axis::applyLimits(float iVeloMax, float iAccelMax){
+  _veloMax = iVeloMax;
+  _accelMax = iAccelMax;
+  _veloMaxSteps = _veloMax*_factorToStep;
+  _accelMaxSteps = _accelMax*_factorToStep;
+  _veloSoft = (_veloMaxSteps>CONFIG_MAX_STEP_RATE) ? CONFIG_MAX_STEP_RATE/_factorToStep : _veloMax;
+}
+
+// Solicita una ejecución, o la prepara si se llamó desde armAction().
+// El lote se escribe antes que la ejecución: exec() nunca ve una ejecución con el lote anterior.
+// Un desplazamiento publica antes el registro sin referencia válida: service() lo escribe
+// mientras exec() espera para iniciarlo (ver persistReadyToMove()).
+void FIPC_Axis::post(ExecAccelStepper iExec){
+  portENTER_CRITICAL(&_armMux);
+  if( (_persist)&&(_persistClean)&&(FIPC_Axis::isMove(iExec)) ) FIPC_Axis::persistPost(false);
+  if( _arming ){
+    _armedEpoch = _arming;
+    _armedExec = iExec;
+  } else {
+    _newExec = iExec;
+  }
+  portEXIT_CRITICAL(&_armMux);
 }
 
 // Configura un desplazamiento en coordenadas relativas
@@ -303,5 +818,138 @@ bool FIPC_Axis::configMoveAbsolute(float iAbsolute){
   _Axis->setAcceleration(_speed*_factorToStep/_accelTime);  
   return true;
 }
+
+// Inicia el desplazamiento configurado con el periférico RMT.
+// Se usa el destino, la velocidad y la aceleración que configuró configMoveAbsolute().
+bool FIPC_Axis::pulseStart(){
+  long togo = _Axis->distanceToGo();
+  if( togo==0 ) return false;
+  _pulseForward = (togo>0);
+  _pulseStart = _Axis->currentPosition();
+  _pulseSent = 0;
+  // Misma polaridad que AccelStepper: la dirección se invierte con CONFIG_INVERT_DIR
+  _stepper.writeDir(_pulseForward!=_direction);
+  return _pulse.start(abs(togo), _Axis->maxSpeed(), _Axis->acceleration());
+}
+
+// Actualiza la posición con los pasos emitidos por el periférico RMT.
+// AccelStepper conserva el destino: distanceToGo() sigue indicando el sentido para limitStop().
+bool FIPC_Axis::pulseRun(){
+  uint32_t sent;
+  bool running = _pulse.run(sent);
+  if( sent!=_pulseSent ){
+    _pulseSent = sent;
+    long target = _Axis->targetPosition();
+    _Axis->setCurrentPosition((_pulseForward) ? _pulseStart+(long)sent : _pulseStart-(long)sent);
+    _Axis->moveTo(target);
+  }
+  if( !running ){
+    _Axis->setCurrentPosition(_Axis->currentPosition()); // descarta el destino si se detuvo antes
+    _pulseMove = false;
+  }
+  return running;
+}
+
+// Inicia el desplazamiento configurado con cambio de micropasos.
+// Se usa el destino, la velocidad y la aceleración que configuró configMoveAbsolute().
+bool FIPC_Axis::microStart(){
+  long togo = _Axis->distanceToGo();
+  if( togo==0 ) return false;
+  _stepper.writeDir((togo>0)!=_direction);
+  return _micro.start(_Axis->currentPosition(), _Axis->targetPosition(), _microOrigin,
+                      _Axis->maxSpeed(), _Axis->acceleration(), micros());
+}
+
+// Emite los pulsos del desplazamiento con cambio de micropasos.
+// Como con el periférico RMT, AccelStepper conserva el destino para limitStop().
+bool FIPC_Axis::microRun(){
+  bool step;
+  bool running = _micro.run(micros(), step);
+  if( step ){
+    _stepper.pulse(MICROSTEP_PULSE_US);
+    long target = _Axis->targetPosition();
+    _Axis->setCurrentPosition(_micro.getPosition());
+    _Axis->moveTo(target);
+  }
+  if( !running ){
+    _Axis->setCurrentPosition(_Axis->currentPosition()); // descarta el destino si se detuvo antes
+    _microMove = false;
+  }
+  return running;
+}
+
+#if LATENCY_ENABLED
+// Registra en FIPC_Latency el primer paso del desplazamiento en curso.
+// Con el periférico RMT el primer pulso sale al iniciar el tren, antes de contarse en la posición.
+void FIPC_Axis::latencyStep(){
+  if( !_latencyStep ) return;
+  if( (!_pulseMove)&&(_Axis->currentPosition()==_latencyFrom) ) return;
+  _latencyStep = false;
+  LATENCY_PROBE(PROBE_STEP);
+}
+#endif
+
+// Actualiza la velocidad pedida en modo velocidad.
+void FIPC_Axis::configJog(float iSpeed){
+  if( iSpeed>_veloSoft )  iSpeed = _veloSoft;
+  if( iSpeed<-_veloSoft ) iSpeed = -_veloSoft;
+  _jogTarget = iSpeed*_factorToStep;
+  _jogUpdate = millis();
+}
+
+// Ejecuta un ciclo del modo velocidad.
+bool FIPC_Axis::jog(){
+  unsigned long now = micros();
+  float dt = (now-_jogTime)*1e-6;
+  _jogTime = now;
+
+  // Sin actualizaciones dentro del tiempo límite se detiene (hombre muerto)
+  bool stop = (_jogStop)||(_limitStop)||(millis()-_jogUpdate>_jogTimeout);
+  float target = (stop) ? 0.0 : _jogTarget;
+  float accel = (_limitStop) ? _accelMaxSteps : _speed*_factorToStep/_accelTime;
+
+  // Rampa hacia la velocidad pedida
+  float delta = accel*dt;
+  if( target>_jogSpeed+delta )      _jogSpeed += delta;
+  else if( target<_jogSpeed-delta ) _jogSpeed -= delta;
+  else                              _jogSpeed = target;
+
+  // Límites: no supera la velocidad que permite frenar exactamente en la posición límite
+  long position = _Axis->currentPosition();
+  if( _jogSpeed>0.0 ){
+    float toGo = _maxSteps-position;
+    float vMax = (toGo>0.0) ? sqrtf(2.0*accel*toGo) : 0.0;
+    if( _jogSpeed>vMax ) _jogSpeed = vMax;
+  } else if( _jogSpeed<0.0 ){
+    float toGo = position-_minSteps;
+    float vMax = (toGo>0.0) ? sqrtf(2.0*accel*toGo) : 0.0;
+    if( _jogSpeed<-vMax ) _jogSpeed = -vMax;
+  }
+
+  _Axis->setSpeed(_jogSpeed);
+  _Axis->runSpeed();
+  return !((stop)&&(_jogSpeed==0.0));
+}
+
+// Publica un registro para guardar en memoria no volátil.
+void FIPC_Axis::persistPost(bool iHomed){
+  _persistSeq++; // impar: registro en escritura
+  _persistSteps = _Axis->currentPosition();
+  _persistHomed = iHomed;
+  _persistSeq++;
+  _persistClean = iHomed;
+}
+
+// Verifica que el registro guardado no indique reposo antes de desplazarse.
+// post() ya publicó el registro sin referencia válida: se espera a que se guarde.
+bool FIPC_Axis::persistReadyToMove(){
+  if( !_persist ) return true;
+  return _persistAck==_persistSeq;
+}
+
+// Verifica si una ejecución desplaza el eje.
+bool FIPC_Axis::isMove(ExecAccelStepper iExec){
+  return (iExec==EXEC_RUN)||(iExec==EXEC_JOG)||(iExec==EXEC_TRACK)||(iExec==EXEC_HOMING);
+}
 /* End: Private                           */
 /******************************************/ 
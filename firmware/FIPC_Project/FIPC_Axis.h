@@ -22,7 +22,12 @@
 
 #include "Arduino.h"
 #include "FIPC_Homing.h"
-#include <AccelStepper.h>
+#include "FIPC_PSO.h"
+#include "FIPC_Config.h"
+#include "FIPC_PulseTrain.h"
+#include "FIPC_Microstep.h"
+#include "FIPC_Latency.h"
+#include "FIPC_Stepper.h"
 
 //!  Clase que implementa el control de un eje.
 /*!
@@ -38,7 +43,7 @@
  *   Este módulo ofrece una interfaz que le permite al usuario solicitar acciones, 
  *   mientras un proceso que se ejecuta en tiempo real actualiza el estado del motor.
  *   Una vez instanciado este objeto, antes de solicitar cualquier acción, se deberá 
- *   configurar el tipo de eje. Adicionalmente, se implementan funciones para configurar la 
+ *   configurar el tipo de eje con setMotorStage() o setConfig(). Adicionalmente, se implementan funciones para configurar la 
  *   velocidad y aceleración de los desplazamientos, como así también una serie de 
  *   funciones de consulta.
  *   
@@ -49,6 +54,9 @@
  *   \li FIPC_Axis::ACTION_MOVE_RELATIVE Desplazamiento en coordenadas relativas.
  *   \li FIPC_Axis::ACTION_STOP Detiene cualquier desplazamiento.
  *   \li FIPC_Axis::ACTION_DISABLE Deshabilita los movimientos de los motores, es decir, los desenergiza.
+ *   \li FIPC_Axis::ACTION_RESTORE Restaura la posición guardada sin buscar el cero (ver FIPC_Persist).
+ *   \li FIPC_Axis::ACTION_JOG Desplazamiento en modo velocidad, cada nueva acción actualiza la velocidad y el sentido.
+ *   \li FIPC_Axis::ACTION_TRACK Seguimiento de una trayectoria calculada en el proceso en tiempo real (ver track()).
  *  
  *   \par Estados del eje:
  *   La implementación se basa en una máquina de estados que describe el estado del eje.
@@ -59,6 +67,18 @@
  *   \li FIPC_Axis::STATUS_HOMING El eje se encuentra desplazándose hacia la referencia.
  *   \li FIPC_Axis::STATUS_READY Una vez que el eje encontró la referencia o terminó un movimiento, el eje queda en espera por una acción.
  *   \li FIPC_Axis::STATUS_MOVING El eje se encuentra desplazándose.
+ *   \li FIPC_Axis::STATUS_JOGGING El eje se desplaza en modo velocidad.
+ *   \li FIPC_Axis::STATUS_TRACKING El eje sigue los destinos intermedios de una trayectoria (ver FIPC_Kinematics).
+ *   La trayectoria se detiene con FIPC_Kinematics::stop(); en este estado el eje solo acepta
+ *   FIPC_Axis::ACTION_STOP, que lo detiene en el lugar, y FIPC_Axis::ACTION_DISABLE, que además
+ *   lo deshabilita en reposo.
+ *   
+ *   \par Modo velocidad
+ *   La velocidad pedida con FIPC_Axis::ACTION_JOG (con signo, en unidades del eje por segundo)
+ *   se aplica en el siguiente ciclo de exec() con una rampa a la aceleración configurada. Si no 
+ *   llegan actualizaciones durante el tiempo límite (ver setJogTimeout()) o se pide una parada, 
+ *   el eje desacelera y vuelve a FIPC_Axis::STATUS_READY. La velocidad se limita en cada ciclo a 
+ *   la que permite frenar exactamente en la posición mínima o máxima del eje.
  *   
  *   \par Tipos de ejes implementados
  *   Este proyecto está basado en una plataforma de 6 ejes de la empresa optics-focus 
@@ -68,15 +88,45 @@
  *   \li FIPC_Axis::MOR_100_30 para más info https://www.optics-focus.com/motorized-rotation-stage-p-523.html
  *   \li FIPC_Axis::MOG_65_10  para más info https://www.optics-focus.com/motorized-goniometer-stage-p-534.html
  *   \li FIPC_Axis::MOG_65_15  para más info https://www.optics-focus.com/motorized-goniometer-stage-p-535.html
+ *   
+ *   Cualquier otro eje se describe con una FIPC_Config::AxisConfig y se aplica con setConfig(), 
+ *   sin recompilar el firmware (ver FIPC_Config).
  *  
+ *   \par Generación de pulsos por hardware
+ *   Con la opción CONFIG_PULSE_RMT los desplazamientos absolutos y relativos se emiten con
+ *   el periférico RMT (ver FIPC_PulseTrain) con el mismo perfil trapezoidal, hasta
+ *   CONFIG_MAX_PULSE_RATE pasos/s y sin carga para exec(). La posición se actualiza por
+ *   bloques de PULSE_HALF_ITEMS pasos durante el desplazamiento, por lo que la salida
+ *   sincronizada (FIPC_PSO) y la parada por fin de carrera se resuelven con esa granularidad.
+ *   El modo velocidad, la búsqueda del cero y el seguimiento de trayectorias se siguen
+ *   generando por software y se limitan a CONFIG_MAX_STEP_RATE.
+ *
+ *   \par Cambio de micropasos
+ *   Con la opción CONFIG_MICROSTEP los desplazamientos absolutos y relativos se generan por
+ *   software con FIPC_Microstep, que pasa el DRV8825 al modo grueso durante el crucero (a
+ *   través de sus entradas MODE) y vuelve al modo fino para la aproximación final. La posición
+ *   se mantiene en pasos del modo fino; en el modo grueso avanza de a 2^(fino-grueso) pasos,
+ *   con la misma granularidad para FIPC_PSO. Los cambios se hacen en posiciones de paso
+ *   completo de la tabla del driver, que se cuentan desde el encendido: se supone que el
+ *   driver se reinicia junto con el controlador y el origen se corrige con los cambios de
+ *   coordenadas de la búsqueda del cero y de la restauración de la posición. El modo
+ *   velocidad, la búsqueda del cero y el seguimiento de trayectorias usan el modo fino.
+ *
+ *   \par Cadena de 74HC595
+ *   Los pasos de un eje con salidas en la cadena (ver FIPC_Stepper) se emiten SHIFT_LATENCY_US
+ *   después de generarse: el desplazamiento, el modo velocidad y el seguimiento terminan, y la
+ *   deshabilitación se aplica, recién cuando la cadena emitió el último flanco programado.
+ *
  *   \par Advertencias
  *   En cada tipo de eje se preconfigura los límites de posición máximos y mínimos, 
  *   como así también la velocidad máxima basada en mediciones en el límite de generación
- *   de pulsos. La frecuencia máxima utilizada es 12 kHz.
+ *   de pulsos. La frecuencia máxima utilizada es 12 kHz. Los límites de velocidad y
+ *   aceleración de cada eje pueden medirse con FIPC_Tune y se aplican con setLimits().
  *   Si el usuario solicita una acción que no está permitida, será rechazada. 
  *   
  *   Para el correcto funcionamiento el usuario debe garantizar que la función exec() sea
- *   ejecutada con una frecuencia mayor a 12 kHz, mientras se está ejecutando un desplazamiento. 
+ *   ejecutada con una frecuencia mayor a 12 kHz, mientras se está ejecutando un desplazamiento
+ *   generado por software. 
 */
 class FIPC_Axis {
   public:
@@ -91,7 +141,10 @@ class FIPC_Axis {
                   ACTION_DISABLE,         /*!< Deshabilitar o desenergizar. */
                   ACTION_HOMING,          /*!< Ejecuta la búsqueda del cero. */
                   ACTION_MOVE_ABSOLUTE,   /*!< Deplazamiento en coordenadas absolutas. */
-                  ACTION_MOVE_RELATIVE    /*!< Deplazamiento en coordenadas relativas. */
+                  ACTION_MOVE_RELATIVE,   /*!< Deplazamiento en coordenadas relativas. */
+                  ACTION_RESTORE,         /*!< Restaura la posición guardada en memoria no volátil. */
+                  ACTION_JOG,             /*!< Desplazamiento en modo velocidad (o actualización de la velocidad). */
+                  ACTION_TRACK            /*!< Seguimiento de una trayectoria (ver track()). */
                   } AxisAction;
 
     //! Definicion de variable simbólica de tipos de ejes
@@ -117,12 +170,34 @@ class FIPC_Axis {
      * \param switch_ref GPIO del pin del switch de referencia.
      */
     FIPC_Axis(uint8_t set_id, uint8_t pinSTEP, uint8_t pinDIR, uint8_t pinEN, uint8_t switch_1, uint8_t switch_2, uint8_t switch_ref);
-    
+
+    //! Los ejes no se copian: el driver, la búsqueda del cero y la salida sincronizada son miembros propios.
+    FIPC_Axis(const FIPC_Axis&) = delete;
+
     //! Establece el tipo de eje.
     /*!
+     * Aplica la configuración predefinida del tipo de eje (ver getPreset()) conservando las GPIO.
      * \param type Variable simbólica de tipo de eje.
     */    
     void setMotorStage(MotorStage type);
+
+    //! Retorna la configuración predefinida de un tipo de eje.
+    /*!
+     * Las GPIO quedan en cero.
+     * \param type Variable simbólica de tipo de eje.
+     * \param oConfig Configuración del tipo de eje.
+    */    
+    static void getPreset(MotorStage type, FIPC_Config::AxisConfig &oConfig);
+
+    //! Aplica una configuración del eje.
+    /*!
+     * Precalcula en pasos los límites, la velocidad y la aceleración máxima que utiliza el
+     * proceso en tiempo real. Si cambian las GPIO de pulsos, dirección o habilitación se
+     * reinicia el driver. Restablece la velocidad y el tiempo de aceleración iniciales.
+     * \param iConfig Configuración del eje (ver FIPC_Config).
+     * \return false si el eje no está deshabilitado.
+    */    
+    bool setConfig(const FIPC_Config::AxisConfig &iConfig);
     
     //! Verifica si puede ejecutar un desplazamiento en coordenadas relativas.
     /*!
@@ -171,6 +246,42 @@ class FIPC_Axis {
      * \return false si no se realizará ninguna acción.
     */    
     bool setAction(uint8_t iAction = FIPC_Axis::ACTION_NOTHING, float iData = 0.0);
+
+    //! Prepara una acción para iniciarla en el mismo ciclo que la de otros ejes.
+    /*!
+     * La acción se valida como en setAction() pero se aplica recién con commit(): FIPC_API
+     * prepara las acciones de todos los ejes de un comando y las libera juntas en un único
+     * ciclo de exec(). Una parada o una deshabilitación cancela la acción preparada que
+     * todavía no se aplicó y se solicita directamente, sin esperar al lote.
+     * \param epoch Lote de acciones (distinto de 0).
+     * \param iAction Tipo de acción solicitada.
+     * \param iData Parámetro adicional de acción.
+     * \return false si no se realizará ninguna acción.
+    */    
+    bool armAction(uint32_t epoch, uint8_t iAction = FIPC_Axis::ACTION_NOTHING, float iData = 0.0);
+
+    //! Verifica si hay una acción preparada en un lote liberado.
+    /*!
+     * \param epoch Último lote liberado.
+     * \return true si hay una acción preparada en ese lote o en uno anterior.
+    */    
+    bool isArmed(uint32_t epoch);
+
+    //! Verifica si la acción preparada puede aplicarse en este ciclo.
+    /*!
+     * \return false si es un desplazamiento o una búsqueda del cero y la posición todavía
+     * no se guardó en memoria no volátil.
+    */    
+    bool isArmedReady();
+
+    //! Aplica la acción preparada.
+    /*!
+     * Debe llamarse desde el proceso en tiempo real, antes de exec().
+    */    
+    void commit();
+
+    //! Cancela la acción preparada y no aplicada.
+    void disarm();
         
     //! Ejecuta el control de los motores.
     /*!
@@ -180,39 +291,264 @@ class FIPC_Axis {
 
     //! Solicita un reporte general del objeto.
     /*!
-     * \return Una cadena de caracteres que describe el estado completo del objeto.
+     * \param out Texto donde se agrega "#id;estado;posición;unidades".
     */    
-    String getReport();
+    void getReport(FIPC_Text &out);
 
     //! Solicita un reporte del estado del objeto.
     /*!
-     * \return Una cadena de caracteres con el estado en que se encuentra el objeto.
+     * \return Una cadena de caracteres constante con el estado en que se encuentra el objeto.
     */    
-    String getStatus();
+    const char* getStatus();
         
     //! Solicita la velocidad configurada.
     /*!
-     * \return Una cadena de caracteres con la velocidad configurada.
+     * \return La velocidad configurada en unidades del eje por segundo.
     */    
-    String getSpeed();
+    float getSpeed();
 
     //! Solicita el tiempo de aceleración configurado.
     /*!
-     * \return Una cadena de caracteres con el tiempo de aceleración configurado.
+     * \return El tiempo de aceleración configurado en segundos.
     */    
-    String getAccelerationTime();
+    float getAccelerationTime();
 
     //! Solicita la posición actual en coordenadas absolutas.
     /*!
-     * \return Una cadena de caracteres la posición actual del eje.
+     * \return La posición actual del eje en unidades del eje.
     */    
-    String getCurrentPosition();
+    float getCurrentPosition();
 
     //! Verifica si el eje se está moviendo.
     /*!
-     * \return "1" si se está moviendo.
+     * \return true si se está moviendo.
+    */    
+    bool isRunning();
+
+    //! Retorna la velocidad máxima permitida.
+    /*!
+     * \return La velocidad máxima en unidades del eje por segundo.
+    */    
+    float getMaxSpeed();
+
+    //! Retorna la aceleración máxima permitida.
+    /*!
+     * \return La aceleración máxima en unidades del eje por segundo al cuadrado.
+    */    
+    float getMaxAcceleration();
+
+    //! Configura la velocidad y la aceleración máxima permitida.
+    /*!
+     * Solo en reposo (ver isIdle()). Si la velocidad configurada no es menor que la nueva
+     * velocidad máxima se reduce a la fracción inicial de setConfig(). No modifica las
+     * velocidades de la búsqueda del cero, que se recalculan con setConfig().
+     * 
+     * \param iVeloMax Velocidad máxima en unidades del eje por segundo (hasta getSpeedLimit()).
+     * \param iAccelMax Aceleración máxima en unidades del eje por segundo al cuadrado.
+     * \return true si los límites se configuraron correctamente.
+    */
+    bool setLimits(float iVeloMax, float iAccelMax);
+
+    //! Retorna la máxima velocidad que admite la generación de pulsos.
+    /*!
+     * Mismo criterio que FIPC_Config: CONFIG_MAX_STEP_RATE, CONFIG_MAX_PULSE_RATE con
+     * CONFIG_PULSE_RMT y 2^(fino-grueso) veces más con CONFIG_MICROSTEP.
+     * \return La velocidad en unidades del eje por segundo.
+    */
+    float getSpeedLimit();
+
+    //! Estima la frecuencia de los pasos que exec() emite en una acción.
+    /*!
+     * Los desplazamientos del periférico RMT no emiten pasos en exec() y con CONFIG_MICROSTEP
+     * cada paso del crucero avanza 2^(fino-grueso) micropasos; el modo velocidad, la búsqueda
+     * del cero (a la velocidad de la pasada rápida) y el seguimiento generan los pulsos por
+     * software, como en getExecLoad().
+     * Ver FIPC_Budget.
+     * \param iAction FIPC_Axis::ACTION_MOVE_RELATIVE, FIPC_Axis::ACTION_MOVE_ABSOLUTE,
+     * FIPC_Axis::ACTION_JOG, FIPC_Axis::ACTION_HOMING o FIPC_Axis::ACTION_TRACK.
+     * \param iData Velocidad del modo velocidad en unidades/s (los desplazamientos usan la configurada).
+     * \return Pasos/s de exec() a la velocidad máxima de la acción (0 en las demás acciones).
+    */
+    float getExecRate(uint8_t iAction, float iData);
+
+    //! Estima la frecuencia de los pasos que exec() emite en la acción en curso.
+    /*!
+     * Incluye las acciones pendientes y las preparadas con armAction(). La búsqueda del cero
+     * y el seguimiento se cuentan a la velocidad de los pulsos generados por software.
+     * \return Pasos/s de exec() a la velocidad máxima de la acción (0 en reposo).
+    */
+    float getExecLoad();
+
+    //! Retorna la cantidad de pasos de exec() por paso de la posición en el ciclo actual.
+    /*!
+     * Pensada para ser consultada desde el proceso en tiempo real (ver FIPC_Budget::exec()).
+     * \return 0 durante un desplazamiento del periférico RMT, 2^(grueso-fino) durante uno de
+     * FIPC_Microstep y 1 en los demás casos.
+    */
+    float getExecScale();
+
+    //! Repite la búsqueda del cero desde el reposo.
+    /*!
+     * Solo con referencia válida (ver isReady()). La secuencia es la de FIPC_Axis::ACTION_HOMING
+     * y al terminar getHomingError() indica los pasos perdidos desde la búsqueda anterior.
+     * \return true si la búsqueda fue iniciada.
+    */
+    bool rehome();
+
+    //! Retorna el desvío de la referencia en la última búsqueda del cero.
+    /*!
+     * Diferencia entre la posición del flanco del switch, en las coordenadas previas a la
+     * búsqueda, y la posición asignada a la referencia. Solo es significativo si la búsqueda
+     * partió con referencia válida (ver rehome()).
+     * \return El desvío en pasos.
+    */
+    long getHomingError();
+
+    //! Estima la duración de un desplazamiento en coordenadas relativas sin ejecutarlo.
+    /*!
+     * Reproduce el perfil trapezoidal que genera AccelStepper: si la distancia no alcanza
+     * para llegar a la velocidad de crucero el perfil resulta triangular.
+     * 
+     * \param iRelative Desplazamiento en coordenadas relativas.
+     * \param oTime Tiempo estimado del desplazamiento en segundos.
+     * \param oPeak Velocidad máxima alcanzada durante el desplazamiento.
+     * \param iSpeed Velocidad del desplazamiento, si es 0 se utiliza la configurada.
+     * \param iAccelTime Tiempo de aceleración, si es 0 se utiliza el configurado.
+     * \return true si el desplazamiento puede realizarse.
+    */    
+    bool estimateMoveRelative(float iRelative, float &oTime, float &oPeak, float iSpeed = 0.0, float iAccelTime = 0.0);
+
+    //! Verifica si el eje está en espera por una acción.
+    /*!
+     * \return true si el eje se encuentra en el estado FIPC_Axis::STATUS_READY.
+    */    
+    bool isReady();
+
+    //! Verifica si el eje está deshabilitado.
+    /*!
+     * \return true si el eje se encuentra en el estado FIPC_Axis::STATUS_DISABLE sin acciones pendientes.
+    */    
+    bool isDisabled();
+
+    //! Verifica si el eje está en reposo.
+    /*!
+     * \return true si el eje se encuentra en los estados FIPC_Axis::STATUS_DISABLE, FIPC_Axis::STATUS_NO_HOME
+     * o FIPC_Axis::STATUS_READY sin acciones pendientes.
+    */    
+    bool isIdle();
+
+    //! Retorna la posición actual en pasos.
+    /*!
+     * Pensada para ser consultada desde el proceso en tiempo real.
+     * \return La posición actual en pasos.
+    */    
+    long getCurrentSteps();
+
+    //! Convierte una posición a pasos.
+    /*!
+     * \param iUnits Posición en las unidades del eje.
+     * \return La posición en pasos.
+    */    
+    long unitsToSteps(float iUnits);
+
+    //! Retorna el factor de conversión de unidades a pasos.
+    /*!
+     * \return Cantidad de pasos por unidad del eje.
+    */    
+    float getStepsPerUnit();
+
+    //! Retorna la salida sincronizada con la posición del eje.
+    /*!
+     * Las posiciones de FIPC_PSO se programan en pasos (ver getStepsPerUnit()).
+     * \return Puntero al objeto FIPC_PSO del eje.
+    */    
+    FIPC_PSO* getPSO();
+
+    //! Reemplaza las entradas de modo de micropasos.
+    /*!
+     * Por defecto se usan las GPIO de FIPC_Config::AxisConfig::pinMode; permite verificar los
+     * cambios de modo en el host. Debe llamarse con el eje deshabilitado, antes de setConfig().
+     * \param pMode Entradas de modo del driver.
+    */
+    void setStepMode(FIPC_StepMode* pMode);
+
+    //! Asigna las tablas de las rampas de los desplazamientos del periférico RMT.
+    /*!
+     * \param pCache Tablas compartidas por los ejes (ver FIPC_TrajectoryCache).
+    */
+    void setTrajectoryCache(FIPC_TrajectoryCache* pCache);
+
+    //! Detiene el eje si se desplaza hacia un fin de carrera presionado.
+    /*!
+     * Ordena la parada con la aceleración máxima del eje. Debe llamarse desde el proceso
+     * en tiempo real antes de exec(), para que la parada se aplique en el mismo ciclo.
+     * \param iPositive true si el fin de carrera presionado es el positivo (sentido físico).
+     * \return true si se ordenó la parada (una única vez por desplazamiento).
+    */    
+    bool limitStop(bool iPositive);
+
+    //! Retorna el tipo de eje configurado.
+    /*!
+     * \return La variable simbólica del tipo de eje (ver FIPC_Axis::MotorStage).
+    */    
+    uint8_t getMotorStage();
+
+    //! Configura el tiempo límite sin actualizaciones del modo velocidad.
+    /*!
+     * \param iTimeout Tiempo en ms luego del cual el eje desacelera hasta detenerse.
+    */    
+    void setJogTimeout(uint16_t iTimeout);
+
+    //! Actualiza el destino intermedio del seguimiento de una trayectoria.
+    /*!
+     * Solo debe llamarse desde el proceso en tiempo real, antes de exec(), con el eje en
+     * FIPC_Axis::STATUS_TRACKING (ver isTracking()). El eje avanza hacia el destino a velocidad
+     * constante sin sobrepasarlo; la rampa la define la trayectoria. El destino se limita a la
+     * posición mínima y máxima del eje.
+     * \param iSteps Destino intermedio en pasos.
+     * \param iSpeed Velocidad en pasos/s (se limita a la máxima).
+     * \param iLast true si es el destino final: al alcanzarlo el eje vuelve a FIPC_Axis::STATUS_READY.
+     * \return false si el eje no está siguiendo una trayectoria o se detuvo por un fin de carrera.
+    */    
+    bool track(long iSteps, float iSpeed, bool iLast = false);
+
+    //! Verifica si el eje está siguiendo una trayectoria.
+    /*!
+     * \return true si el eje se encuentra en el estado FIPC_Axis::STATUS_TRACKING o
+     * aceptó FIPC_Axis::ACTION_TRACK y aún no lo inició.
+    */    
+    bool isTracking();
+
+    //! Habilita la publicación de registros para guardar en memoria no volátil.
+    /*!
+     * \param iEnable true para habilitar.
+    */    
+    void setPersist(bool iEnable);
+
+    //! Carga la posición guardada en memoria no volátil.
+    /*!
+     * Habilita la persistencia. Debe llamarse antes de iniciar el proceso en tiempo real.
+     * \param iSteps Posición guardada en pasos.
+     * \param iHomed true si el eje estaba detenido con referencia válida.
     */    
-    String isRunning();
+    void setStoredPosition(long iSteps, bool iHomed);
+
+    //! Obtiene el registro pendiente de guardar.
+    /*!
+     * \param oSeq Número de secuencia del registro.
+     * \param oSteps Posición en pasos.
+     * \param oHomed true si el eje está detenido con referencia válida.
+     * \return true si hay un registro pendiente.
+    */    
+    bool getPersistRequest(uint32_t &oSeq, long &oSteps, bool &oHomed);
+
+    //! Confirma que el registro fue guardado.
+    /*!
+     * \param iSeq Número de secuencia del registro guardado.
+     * \param iSteps Posición guardada en pasos.
+     * \param iHomed Referencia válida guardada.
+    */    
+    void persistAck(uint32_t iSeq, long iSteps, bool iHomed);
 
   private:
     //! Definicion de variable simbólica interna de estado del motor.
@@ -220,7 +556,9 @@ class FIPC_Axis {
                   STATUS_NO_HOME, /*!< Eje habilitado y sin referencia de cero. */
                   STATUS_HOMING,  /*!< Desplazándose en búsqueda de la referencia cero. */
                   STATUS_READY,   /*!< Eje habilitado y en espera por un desplazamiento. */
-                  STATUS_MOVING   /*!< Desplazándose. */
+                  STATUS_MOVING,  /*!< Desplazándose. */
+                  STATUS_JOGGING, /*!< Desplazándose en modo velocidad. */
+                  STATUS_TRACKING /*!< Siguiendo una trayectoria. */
                   } AxisStatus;
                   
     //! Definicion de variable simbólica interna de tipos de ejecución.
@@ -230,22 +568,49 @@ class FIPC_Axis {
                   EXEC_HOMING,        /*!< Debe ejecutar la búsqueda de la referencia cero. */
                   EXEC_HOMING_STOP,   /*!< Debe ejecutar una parada de la búsqueda de la referencia cero. */
                   EXEC_ENABLE,        /*!< Debe habilitar el eje.  */
-                  EXEC_DISABLE        /*!< Debe deshabilitar el eje. */
+                  EXEC_DISABLE,       /*!< Debe deshabilitar el eje. */
+                  EXEC_RESTORE,       /*!< Debe restaurar la posición guardada. */
+                  EXEC_JOG,           /*!< Debe iniciar el modo velocidad. */
+                  EXEC_TRACK          /*!< Debe iniciar el seguimiento de una trayectoria. */
                   } ExecAccelStepper;
 
+    FIPC_Stepper _stepper; /*!< Driver del motor paso a paso. */
+
+    FIPC_Homing _homing; /*!< Búsqueda de la referencia cero. */
+
+    FIPC_PSO _pso; /*!< Salida sincronizada con la posición. */
+
+    FIPC_PulseTrain _pulse; /*!< Generación de pulsos por hardware. */
+
+    FIPC_Microstep _micro; /*!< Generación de pulsos con cambio de micropasos. */
+
+    FIPC_GpioStepMode _stepMode; /*!< Entradas de modo de micropasos en GPIO. */
+
+    FIPC_StepMode* _StepMode; /*!< Puntero a las entradas de modo de micropasos. */
+
     AccelStepper* _Axis; /*!< Puntero al driver del motor paso a paso. */
     
     FIPC_Homing*  _Homing; /*!< Puntero al objeto encargado de realizar la búsqueda de la referencia cero. */
 
+    FIPC_PSO*  _PSO; /*!< Puntero a la salida sincronizada con la posición. */
+
     AxisStatus _axis_status  = STATUS_DISABLE;  /*!< Almacena el estado del eje. */
 
     ExecAccelStepper  _newExec = EXEC_WAIT; /*!< Almacena el tipo de ejecución. */
 
-    MotorStage _type; /*!< Almacena el tipo de eje configurado. */
+    volatile ExecAccelStepper _armedExec = EXEC_WAIT; /*!< Ejecución preparada con armAction() y no aplicada. */
+
+    volatile uint32_t _armedEpoch = 0; /*!< Lote de la ejecución preparada. */
+
+    uint32_t _arming = 0; /*!< Lote en preparación durante armAction() (0 fuera de armAction()). */
+
+    static portMUX_TYPE _armMux; /*!< Exclusión entre la preparación y la aplicación de las acciones. */
+
+    uint8_t _type; /*!< Almacena el tipo de eje configurado. */
 
     uint8_t _id; /*!< Identificador. */
     
-    String _units; /*!< Tipo de unidad configurada. */
+    char _units[CONFIG_UNITS_SIZE] = ""; /*!< Tipo de unidad configurada. */
     
     bool _direction; /*!< Sentido de giro. */
 
@@ -253,6 +618,12 @@ class FIPC_Axis {
 
     float _accelTime; /*!< Tiempo de aceleración configurado. */
   
+    uint8_t _pinStep; /*!< Pin de pulsos (GPIO o SHIFT_PIN()). */
+
+    uint8_t _pinDir; /*!< Pin de dirección (GPIO o SHIFT_PIN()). */
+
+    uint8_t _pinEnable; /*!< GPIO de habilitación. */
+
     uint8_t _switch_1; /*!< GPIO del switch de límite positivo. */
 
     uint8_t _switch_2; /*!< GPIO del switch de límite negativo. */
@@ -267,8 +638,154 @@ class FIPC_Axis {
     
     float _veloMax; /*!< Velocidad máxima permitida. */
 
-    //! Invierte la dirección de desplazamiento.
-    void invertDirection();
+    float _accelMax; /*!< Aceleración máxima permitida. */
+
+    long _minSteps; /*!< Posicion mínima absoluta en pasos. */
+
+    long _maxSteps; /*!< Posicion máxima absoluta en pasos. */
+
+    float _veloMaxSteps; /*!< Velocidad máxima permitida en pasos/s. */
+
+    float _accelMaxSteps; /*!< Aceleración máxima permitida en pasos/s^2. */
+
+    float _veloSoft; /*!< Velocidad máxima de los pulsos generados por software en unidades/s. */
+
+    float _rateMax; /*!< Máxima frecuencia de la generación de pulsos en pasos/s (ver getSpeedLimit()). */
+
+    float _execScale; /*!< Pasos de exec() por paso de un desplazamiento (ver getExecRate()). */
+
+    bool _pulseEnable = false; /*!< Los desplazamientos se emiten con el periférico RMT. */
+
+    bool _pulseMove = false; /*!< El desplazamiento en curso lo emite el periférico RMT. */
+
+    bool _pulseForward = false; /*!< Sentido del desplazamiento en curso del periférico RMT. */
+
+    long _pulseStart = 0; /*!< Posición en pasos al iniciar el desplazamiento del periférico RMT. */
+
+    uint32_t _pulseSent = 0; /*!< Pasos emitidos por el periférico RMT. */
+
+    bool _microEnable = false; /*!< Los desplazamientos cambian la resolución de micropasos. */
+
+    bool _microMove = false; /*!< El desplazamiento en curso lo genera FIPC_Microstep. */
+
+    long _microOrigin = 0; /*!< Posición en pasos de un estado de paso completo de la tabla del driver. */
+
+#if LATENCY_ENABLED
+    bool _latencyStep = false; /*!< Espera el primer paso del desplazamiento para FIPC_Latency. */
+
+    long _latencyFrom = 0; /*!< Posición en pasos al iniciar el desplazamiento. */
+#endif
+
+    long _zeroSteps = 0; /*!< Posición en pasos asignada a la referencia. */
+
+    bool _limitStop = false; /*!< El desplazamiento actual fue detenido por un fin de carrera. */
+
+    bool _persist = false; /*!< Publica registros para guardar en memoria no volátil. */
+
+    volatile uint32_t _persistSeq = 0; /*!< Secuencia del último registro publicado (impar mientras se escribe). */
+
+    volatile uint32_t _persistAck = 0; /*!< Secuencia del último registro guardado. */
+
+    volatile long _persistSteps = 0; /*!< Posición del registro publicado. */
+
+    volatile bool _persistHomed = false; /*!< Referencia válida del registro publicado. */
+
+    volatile bool _persistClean = false; /*!< El último registro publicado indica reposo con referencia válida. */
+
+    unsigned long _restTime = 0; /*!< Instante en ms en que el eje quedó en reposo. */
+
+    volatile long _storedSteps = 0; /*!< Posición guardada en pasos. */
+
+    volatile bool _storedHomed = false; /*!< La posición guardada tiene referencia válida. */
+
+    volatile float _jogTarget = 0.0; /*!< Velocidad pedida en modo velocidad en pasos/s (con signo). */
+
+    volatile unsigned long _jogUpdate = 0; /*!< Instante en ms de la última actualización de la velocidad. */
+
+    uint16_t _jogTimeout; /*!< Tiempo límite en ms sin actualizaciones de la velocidad. */
+
+    float _jogSpeed = 0.0; /*!< Velocidad actual en modo velocidad en pasos/s (con signo). */
+
+    unsigned long _jogTime = 0; /*!< Instante en us del último ciclo en modo velocidad. */
+
+    bool _jogStop = false; /*!< Se pidió detener el modo velocidad. */
+
+    bool _trackLast = false; /*!< El destino del seguimiento es el final de la trayectoria. */
+
+    //! Precalcula en pasos la velocidad y la aceleración máxima.
+    /*!
+     * \param iVeloMax Velocidad máxima en unidades del eje por segundo.
+     * \param iAccelMax Aceleración máxima en unidades del eje por segundo al cuadrado.
+    */
+    void applyLimits(float iVeloMax, float iAccelMax);
+
+    //! Publica un registro para guardar en memoria no volátil.
+    /*!
+     * Se llama desde post() y exec() dentro de la sección crítica de _armMux: los registros
+     * se publican desde los dos núcleos.
+     * \param iHomed true si el eje está detenido con referencia válida.
+    */
+    void persistPost(bool iHomed);
+
+    //! Verifica que el registro guardado no indique reposo antes de desplazarse.
+    /*!
+     * \return true si el desplazamiento puede iniciarse.
+    */
+    bool persistReadyToMove();
+
+    //! Verifica si una ejecución desplaza el eje.
+    /*!
+     * \param iExec Ejecución.
+     * \return true para un desplazamiento, el modo velocidad, el seguimiento o la búsqueda del cero.
+    */
+    static bool isMove(ExecAccelStepper iExec);
+
+    //! Inicia el desplazamiento configurado con el periférico RMT.
+    /*!
+     * \return false si debe generarse por software.
+    */
+    bool pulseStart();
+
+    //! Actualiza la posición con los pasos emitidos por el periférico RMT.
+    /*!
+     * \return false cuando terminó el desplazamiento.
+    */
+    bool pulseRun();
+
+    //! Inicia el desplazamiento configurado con cambio de micropasos.
+    /*!
+     * \return false si debe generarse con AccelStepper.
+    */
+    bool microStart();
+
+    //! Emite los pulsos del desplazamiento con cambio de micropasos.
+    /*!
+     * \return false cuando terminó el desplazamiento.
+    */
+    bool microRun();
+
+#if LATENCY_ENABLED
+    //! Registra en FIPC_Latency el primer paso del desplazamiento en curso.
+    void latencyStep();
+#endif
+
+    //! Actualiza la velocidad pedida en modo velocidad.
+    /*!
+     * \param iSpeed Velocidad con signo en unidades del eje por segundo (se limita a la máxima).
+    */
+    void configJog(float iSpeed);
+
+    //! Solicita una ejecución, o la prepara si se llamó desde armAction().
+    /*!
+     * \param iExec Ejecución solicitada.
+    */
+    void post(ExecAccelStepper iExec);
+
+    //! Ejecuta un ciclo del modo velocidad.
+    /*!
+     * \return false cuando el eje se detuvo por una parada o por falta de actualizaciones.
+    */
+    bool jog();
 
     //! Configura el destino en coordenadas absolutas.
     /*!
@@ -0,0 +1,225 @@
+/*! \file FIPC_Budget.cpp
+    \brief Presupuesto de la frecuencia de pasos del proceso en tiempo real.
+*/
+
+#include "FIPC_Budget.h"
+
+#define BUDGET_MAGIC 0x46494231 /*!< Identificador del formato del registro ("FIB1"). */
+#define BUDGET_KEY   "budget"   /*!< Clave del registro en el almacenamiento. */
+
+// Constructor.
+FIPC_Budget::FIPC_Budget(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Storage* pStorage) {
+  _axisList = pAxis;
+  _axisNumbers = min(iAxisNumbers, (uint8_t)BUDGET_AXIS_NUMBERS);
+  _storage = pStorage;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Lee el modo y los costos guardados.
+bool FIPC_Budget::begin(){
+  BudgetBlob blob;
+  if( !_storage->read(BUDGET_KEY, &blob, sizeof(blob)) ) return false;
+  if( (blob.magic!=BUDGET_MAGIC)||(blob.mode>BUDGET_STRETCH)||!(blob.base>0.0)||!(blob.step>=0.0) ) return false;
+  _mode = (BudgetMode)blob.mode;
+  _base = blob.base;
+  _step = blob.step;
+  return true;
+}
+
+// Configura el modo.
+bool FIPC_Budget::setMode(uint8_t iMode){
+  if( iMode>BUDGET_STRETCH ) return false;
+  if( iMode!=_mode ) _save = true;
+  _mode = (BudgetMode)iMode;
+  return true;
+}
+
+// Verifica una acción nueva.
+// La carga crece con el factor s de las velocidades pedidas y es lineal a tramos: hasta
+// cross el eje más rápido es uno de los que conservan su acción y desde cross uno de la
+// acción nueva. El mayor s que entra se despeja en el tramo correspondiente.
+bool FIPC_Budget::admit(const float iRate[], float &oScale, bool iStretch){
+  oScale = _scale = 1.0;
+  if( _mode==BUDGET_OFF ) return true;
+  float keepMax = 0.0, keepSum = 0.0, newMax = 0.0, newSum = 0.0;
+  uint32_t mask = 0;
+  for( uint8_t i=0; i<_axisNumbers; i++ ){
+    if( iRate[i]==BUDGET_KEEP ){
+      float rate = _axisList[i]->getExecLoad();
+      keepMax = max(keepMax, rate);
+      keepSum += rate;
+    } else if( iRate[i]>0.0 ){
+      newMax = max(newMax, iRate[i]);
+      newSum += iRate[i];
+      mask |= 1UL<<i;
+    }
+  }
+  float demand = FIPC_Budget::load(max(keepMax, newMax), keepSum+newSum);
+  if( demand<=1.0 ) return true;
+
+  float scale = 0.0;
+  if( (_mode==BUDGET_STRETCH)&&(iStretch)&&(FIPC_Budget::load(keepMax, keepSum)<1.0) ){
+    float cross = keepMax/newMax;
+    if( (cross<1.0)&&(FIPC_Budget::load(keepMax, keepSum+cross*newSum)<=1.0) )
+      scale = (1e6-_step*keepSum)/(_base*newMax/BUDGET_MARGIN+_step*newSum);
+    else if( _step>0.0 )
+      scale = (1e6-_base*keepMax/BUDGET_MARGIN-_step*keepSum)/(_step*newSum);
+  }
+  if( scale>=BUDGET_STRETCH_MIN ){
+    oScale = _scale = min(scale, (float)1.0);
+    _stretched++;
+    return true;
+  }
+  _rejected++;
+  _eventMask = mask;
+  _eventLoad = demand;
+  return false;
+}
+
+// Verifica una misma acción de un grupo de ejes.
+// Los ejes del grupo que no emiten pasos en la acción conservan la carga en curso.
+bool FIPC_Budget::admit(FIPC_Axis* const pAxis[], uint8_t count, uint8_t iAction, const float iData[], float &oScale, bool iStretch){
+  float rate[BUDGET_AXIS_NUMBERS];
+  bool check = false;
+  oScale = 1.0;
+  for( uint8_t j=0; j<_axisNumbers; j++ ){
+    rate[j] = BUDGET_KEEP;
+    for( uint8_t i=0; i<count; i++ ){
+      if( (!pAxis[i])||(pAxis[i]!=_axisList[j]) ) continue;
+      float value = pAxis[i]->getExecRate(iAction, iData ? iData[i] : 0.0);
+      if( value>0.0 ){
+        rate[j] = value;
+        check = true;
+      }
+    }
+  }
+  return (!check)||(FIPC_Budget::admit(rate, oScale, iStretch));
+}
+
+// Verifica y solicita una misma acción a un grupo de ejes.
+bool FIPC_Budget::setAction(FIPC_Axis* const pAxis[], uint8_t count, uint8_t iAction, const float iData[], bool iStretch){
+  float scale;
+  if( !FIPC_Budget::admit(pAxis, count, iAction, iData, scale, iStretch) ) return false;
+  for( uint8_t i=0; i<count; i++ ){
+    if( !pAxis[i] ) continue;
+    float speed = pAxis[i]->getSpeed();
+    if( scale<1.0 ) pAxis[i]->setSpeed(speed*scale);
+    bool accepted = pAxis[i]->setAction(iAction, iData ? iData[i] : 0.0);
+    if( scale<1.0 ) pAxis[i]->setSpeed(speed);
+    if( !accepted ) return false;
+  }
+  return true;
+}
+
+// Retorna el factor de la última acción aceptada.
+float FIPC_Budget::getScale(){
+  return _scale;
+}
+
+// Inicia la calibración de los costos.
+// Los ciclos pendientes se asignan al final: exec() no lee las sumas hasta entonces.
+bool FIPC_Budget::calibrate(uint32_t cycles){
+  if( cycles<BUDGET_CAL_MIN ) return false;
+  _calRemaining = 0;
+  _calDone = false;
+  _calStarted = false;
+  _calN = 0;
+  _calX = _calXX = _calT = _calXT = 0;
+  _calRemaining = cycles;
+  return true;
+}
+
+// Registra un ciclo de la calibración.
+// La duración de un ciclo va de su inicio al del siguiente, por lo que incluye el resto
+// de la tarea; los pasos son el avance de las posiciones en el mismo intervalo.
+void FIPC_Budget::exec(){
+  if( !_calRemaining ) return;
+  unsigned long now = micros();
+  float steps = 0.0;
+  for( uint8_t i=0; i<_axisNumbers; i++ ){
+    long position = _axisList[i]->getCurrentSteps();
+    steps += abs(position-_calLast[i])*_axisList[i]->getExecScale();
+    _calLast[i] = position;
+  }
+  if( _calStarted ){
+    uint32_t x = (uint32_t)(steps+0.5);
+    uint32_t t = now-_calTime;
+    _calN++;
+    _calX += x;
+    _calXX += (uint64_t)x*x;
+    _calT += t;
+    _calXT += (uint64_t)x*t;
+    if( --_calRemaining==0 ) _calDone = true;
+  }
+  _calStarted = true;
+  _calTime = now;
+}
+
+// Termina la calibración y guarda el modo y los costos.
+// Sin ciclos con distinta cantidad de pasos el ajuste no está definido y se conservan los costos.
+void FIPC_Budget::service(){
+  if( _calDone ){
+    _calDone = false;
+    double n = _calN;
+    double den = n*(double)_calXX-(double)_calX*(double)_calX;
+    if( den>0.0 ){
+      double step = (n*(double)_calXT-(double)_calX*(double)_calT)/den;
+      double base = ((double)_calT-step*(double)_calX)/n;
+      if( (base>0.0)&&(step>=0.0) ){
+        _base = base;
+        _step = step;
+        _save = true;
+      }
+    }
+  }
+  if( _save ){
+    BudgetBlob blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.magic = BUDGET_MAGIC;
+    blob.mode = _mode;
+    blob.base = _base;
+    blob.step = _step;
+    _storage->write(BUDGET_KEY, &blob, sizeof(blob));
+    _save = false;
+  }
+}
+
+// Solicita un reporte del presupuesto.
+void FIPC_Budget::getReport(FIPC_Text &out){
+  float rateMax = 0.0, rateSum = 0.0;
+  for( uint8_t i=0; i<_axisNumbers; i++ ){
+    float rate = _axisList[i]->getExecLoad();
+    rateMax = max(rateMax, rate);
+    rateSum += rate;
+  }
+  out.add((int)_mode).add(';');
+  out.add(_base,3).add(';');
+  out.add(_step,3).add(';');
+  out.add(100.0*FIPC_Budget::load(rateMax, rateSum),1).add(';');
+  out.add((unsigned long)_rejected).add(';');
+  out.add((unsigned long)_stretched).add(';');
+  out.add((unsigned long)_calRemaining);
+}
+
+// Agrega el evento de la última acción rechazada.
+void FIPC_Budget::getEvents(FIPC_Text &out){
+  if( !_eventMask ) return;
+  out.add("BUDGET:").add((unsigned long)_eventMask).add(';').add(100.0*_eventLoad,1).add('\n');
+  _eventMask = 0;
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Calcula la carga de una combinación de frecuencias.
+float FIPC_Budget::load(float rateMax, float rateSum){
+  return (_base*rateMax/BUDGET_MARGIN+_step*rateSum)/1e6;
+}
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,237 @@
+/*! \file FIPC_Budget.h
+ *  \brief Presupuesto de la frecuencia de pasos del proceso en tiempo real.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Budget_h
+#define FIPC_Budget_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+#include "FIPC_Storage.h"
+#include "FIPC_Text.h"
+
+#define BUDGET_AXIS_NUMBERS 8     /*!< Cantidad máxima de ejes verificados. */
+#define BUDGET_BASE_US      20.0  /*!< Costo de un ciclo de exec() sin pasos en us, hasta la calibración. */
+#define BUDGET_STEP_US      8.0   /*!< Costo de cada paso emitido en un ciclo en us, hasta la calibración. */
+#define BUDGET_MARGIN       0.5   /*!< Fracción del período de paso del eje más rápido que puede durar un ciclo. */
+#define BUDGET_STRETCH_MIN  0.1   /*!< Menor factor de las velocidades de una acción estirada. */
+#define BUDGET_CAL_MIN      1000  /*!< Ciclos mínimos de una calibración. */
+#define BUDGET_KEEP         -1.0  /*!< Frecuencia de los ejes que conservan la acción en curso (ver admit()). */
+
+//!  Clase que verifica las acciones nuevas contra la frecuencia de pasos que exec() puede atender.
+/*!
+ *   AccelStepper emite a lo sumo un paso por llamada, por lo que un ciclo de exec() debe durar
+ *   menos que el período de paso del eje más rápido; si no, el ciclo marca flag_time_out y el
+ *   eje pierde pasos. El costo de un ciclo se modela como b + c·n us, con n los pasos emitidos
+ *   en el ciclo, y con los ejes a r_i pasos/s (ver FIPC_Axis::getExecRate()) el ciclo dura
+ *   b/(1 - c·R) con R = Σ r_i. La condición de cada acción nueva es que dure a lo sumo
+ *   BUDGET_MARGIN períodos del eje más rápido:
+ *
+ *   \f$ b \cdot max(r_i)/BUDGET\_MARGIN + c \cdot \sum r_i \le 10^6 \f$
+ *
+ *   La carga es el lado izquierdo sobre 10^6. Los desplazamientos del periférico RMT no emiten
+ *   pasos en exec() y no suman; la búsqueda del cero, el modo velocidad y el seguimiento suman
+ *   a la velocidad de los pulsos generados por software.
+ *
+ *   \par Modos
+ *   \li BUDGET_OFF: no se verifica (por defecto).
+ *   \li BUDGET_REJECT: la acción que supera el presupuesto se descarta y getEvents() informa
+ *   los ejes y la carga pedida.
+ *   \li BUDGET_STRETCH: las velocidades de la acción se reducen por el mayor factor que entra
+ *   en el presupuesto, con lo que los desplazamientos sincrónicos duran más con las mismas
+ *   posiciones; si el factor es menor que BUDGET_STRETCH_MIN o los ejes en movimiento ya
+ *   superan el presupuesto se descarta como en BUDGET_REJECT. La búsqueda del cero y el
+ *   seguimiento no se estiran: se descartan.
+ *
+ *   \par Calibración
+ *   Con calibrate() exec() registra durante la cantidad de ciclos pedida la duración de cada
+ *   ciclo y los pasos emitidos (ver FIPC_Axis::getExecScale()), y al terminar b y c resultan
+ *   del ajuste por cuadrados mínimos. Los ejes deben moverse a distintas velocidades durante
+ *   la calibración para que el ajuste tenga pasos distintos por ciclo; si no, se conservan
+ *   los costos anteriores. El modo y los costos se guardan en la memoria no volátil desde
+ *   service(), fuera del proceso en tiempo real.
+*/
+class FIPC_Budget
+{
+  public:
+    //! Definicion de variable simbólica de modos.
+    typedef enum{ BUDGET_OFF,     /*!< Sin verificación. */
+                  BUDGET_REJECT,  /*!< Descarta las acciones que superan el presupuesto. */
+                  BUDGET_STRETCH  /*!< Reduce las velocidades de las acciones que lo superan. */
+                  }BudgetMode;
+
+    //! Constructor.
+    /*!
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista.
+      \param pStorage Almacenamiento no volátil.
+     */
+    FIPC_Budget(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Storage* pStorage);
+
+    //! Lee el modo y los costos guardados.
+    /*!
+      \return true si se leyó un registro válido.
+    */
+    bool begin();
+
+    //! Configura el modo.
+    /*!
+      \param iMode Modo (ver BudgetMode).
+      \return true si el modo es válido.
+    */
+    bool setMode(uint8_t iMode);
+
+    //! Verifica una acción nueva.
+    /*!
+      \param iRate Pasos/s de exec() pedidos de cada eje de la lista (ver FIPC_Axis::getExecRate()),
+      BUDGET_KEEP en los ejes que conservan su acción en curso.
+      \param oScale Factor a aplicar a las velocidades pedidas: 1 si la acción entra en el
+      presupuesto, menor en BUDGET_STRETCH.
+      \param iStretch false si las velocidades de la acción no pueden reducirse (la búsqueda
+      del cero, el seguimiento o una caracterización): en BUDGET_STRETCH se descarta.
+      \return true si la acción se acepta.
+    */
+    bool admit(const float iRate[], float &oScale, bool iStretch = true);
+
+    //! Verifica una misma acción de un grupo de ejes.
+    /*!
+      Los demás ejes de la lista conservan su acción en curso. FIPC_Kinematics y la búsqueda
+      del cero de FIPC_Tune verifican así la acción antes de solicitarla.
+      \param pAxis Ejes del grupo (los NULL se ignoran).
+      \param count Cantidad de ejes del grupo.
+      \param iAction Acción (ver FIPC_Axis::getExecRate()).
+      \param iData Dato de la acción de cada eje del grupo, NULL si la acción no lleva datos.
+      \param oScale Factor a aplicar a las velocidades pedidas (ver admit()).
+      \param iStretch false si las velocidades de la acción no pueden reducirse.
+      \return true si la acción se acepta o no emite pasos en exec().
+    */
+    bool admit(FIPC_Axis* const pAxis[], uint8_t count, uint8_t iAction, const float iData[], float &oScale, bool iStretch = true);
+
+    //! Verifica y solicita una misma acción a un grupo de ejes.
+    /*!
+      Los módulos que ordenan acciones a los ejes sin pasar por FIPC_API::requestAction()
+      (FIPC_Scan, FIPC_Align y FIPC_Tune) las solicitan con esta función en lugar de
+      FIPC_Axis::setAction(). Un desplazamiento estirado toma la velocidad reducida
+      al prepararse y la configurada se restaura enseguida.
+      \param pAxis Ejes del grupo (los NULL se ignoran).
+      \param count Cantidad de ejes del grupo.
+      \param iAction Acción (ver FIPC_Axis::AxisAction).
+      \param iData Dato de la acción de cada eje del grupo, NULL si la acción no lleva datos.
+      \param iStretch false si las velocidades de la acción no pueden reducirse.
+      \return true si todos los ejes del grupo aceptaron la acción.
+    */
+    bool setAction(FIPC_Axis* const pAxis[], uint8_t count, uint8_t iAction, const float iData[] = NULL, bool iStretch = false);
+
+    //! Retorna el factor de la última acción aceptada.
+    float getScale();
+
+    //! Inicia la calibración de los costos.
+    /*!
+      \param cycles Ciclos de exec() a registrar (al menos BUDGET_CAL_MIN).
+      \return true si la calibración fue iniciada.
+    */
+    bool calibrate(uint32_t cycles);
+
+    //! Registra un ciclo de la calibración.
+    /*!
+     * Esta función deberá ser llamada recurrentemente en tiempo real, al comienzo de exec().
+    */
+    void exec();
+
+    //! Termina la calibración y guarda el modo y los costos.
+    /*!
+     * Debe llamarse fuera del proceso en tiempo real (ver FIPC_API::persist()).
+    */
+    void service();
+
+    //! Solicita un reporte del presupuesto.
+    /*!
+      \param out Texto donde se agrega "modo;costo base en us;costo por paso en us;carga en %;
+      rechazados;estirados;ciclos de calibración pendientes".
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Agrega el evento de la última acción rechazada.
+    /*!
+      \param out Texto donde se agrega "BUDGET:ejes;carga pedida en %\n" una única vez por
+      rechazo, con los ejes como máscara de bits (bit 0 el eje #1).
+    */
+    void getEvents(FIPC_Text &out);
+
+  private:
+    //! Registro guardado.
+    typedef struct{
+      uint32_t magic; /*!< Identificador del formato. */
+      uint8_t mode;   /*!< Modo. */
+      float base;     /*!< Costo base en us. */
+      float step;     /*!< Costo por paso en us. */
+    }BudgetBlob;
+
+    FIPC_Axis** _axisList; /*!< Lista de ejes del controlador. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes en la lista. */
+
+    FIPC_Storage* _storage; /*!< Almacenamiento no volátil. */
+
+    BudgetMode _mode = BUDGET_OFF; /*!< Modo. */
+
+    float _base = BUDGET_BASE_US; /*!< Costo de un ciclo sin pasos en us. */
+
+    float _step = BUDGET_STEP_US; /*!< Costo por paso en us. */
+
+    float _scale = 1.0; /*!< Factor de la última acción aceptada. */
+
+    uint32_t _rejected = 0; /*!< Acciones rechazadas. */
+
+    uint32_t _stretched = 0; /*!< Acciones estiradas. */
+
+    uint32_t _eventMask = 0; /*!< Ejes de la última acción rechazada y no informada. */
+
+    float _eventLoad = 0.0; /*!< Carga pedida por la última acción rechazada. */
+
+    bool _save = false; /*!< Modo o costos sin guardar. */
+
+    volatile uint32_t _calRemaining = 0; /*!< Ciclos pendientes de la calibración. */
+
+    volatile bool _calDone = false; /*!< Calibración terminada y no procesada. */
+
+    bool _calStarted; /*!< Se registró el primer ciclo de la calibración. */
+
+    unsigned long _calTime; /*!< Inicio del ciclo anterior en us. */
+
+    long _calLast[BUDGET_AXIS_NUMBERS]; /*!< Posición de cada eje al inicio del ciclo anterior. */
+
+    uint32_t _calN; /*!< Ciclos registrados. */
+
+    uint64_t _calX; /*!< Suma de los pasos por ciclo. */
+
+    uint64_t _calXX; /*!< Suma de los cuadrados de los pasos por ciclo. */
+
+    uint64_t _calT; /*!< Suma de las duraciones en us. */
+
+    uint64_t _calXT; /*!< Suma de los productos de pasos y duración. */
+
+    //! Calcula la carga de una combinación de frecuencias.
+    /*!
+      \param rateMax Mayor frecuencia en pasos/s.
+      \param rateSum Suma de las frecuencias en pasos/s.
+      \return Carga (1 es el presupuesto completo).
+    */
+    float load(float rateMax, float rateSum);
+};
+#endif
@@ -0,0 +1,230 @@
+/*! \file FIPC_Config.cpp
+    \brief Configuración de los ejes cargada desde memoria no volátil.
+*/
+
+#include "FIPC_Config.h"
+#include <stddef.h>
+
+#define CONFIG_MAGIC   0x46494331 /*!< Identificador del formato del bloque ("FIC1"). */
+#define CONFIG_VERSION 2          /*!< Versión del formato del bloque. */
+#define CONFIG_V1_AXIS 40         /*!< Bytes de un registro AxisConfig de la versión 1. */
+#define CONFIG_KEY     "config"   /*!< Clave del bloque en el almacenamiento. */
+
+// Constructor.
+FIPC_Config::FIPC_Config(FIPC_Storage* pStorage, uint8_t iAxisNumbers) {
+  _storage = pStorage;
+  _axisNumbers = min(iAxisNumbers, (uint8_t)CONFIG_AXIS_NUMBERS);
+  memset(&_active, 0, sizeof(_active));
+  _active.magic = CONFIG_MAGIC;
+  _active.version = CONFIG_VERSION;
+  _active.axisNumbers = _axisNumbers;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Establece la configuración por defecto de un eje.
+void FIPC_Config::setDefault(uint8_t id, const AxisConfig &iConfig){
+  if( (id==0)||(id>_axisNumbers) ) return;
+  _active.axis[id-1] = iConfig;
+  _active.crc = FIPC_Config::crc(_active);
+}
+
+// Lee el bloque guardado.
+bool FIPC_Config::begin(){
+  if( (!_storage->read(CONFIG_KEY, &_upload, sizeof(_upload)))&&(!FIPC_Config::migrate()) ) return false;
+  if( !FIPC_Config::validate(_upload) ) return false;
+  _active = _upload;
+  _stored = true;
+  return true;
+}
+
+// Retorna la configuración activa de un eje.
+const FIPC_Config::AxisConfig& FIPC_Config::getAxis(uint8_t id){
+  return _active.axis[id-1];
+}
+
+// Recibe un tramo del bloque a cargar.
+bool FIPC_Config::upload(uint16_t offset, const char* hex){
+  if( offset==0 ) _uploadSize = 0;
+  if( offset!=_uploadSize ) return false; // tramo fuera de orden
+
+  uint8_t* data = (uint8_t*)&_upload;
+  for(; *hex; hex += 2){
+    int8_t high = FIPC_Config::hexValue(hex[0]);
+    int8_t low  = (high<0) ? -1 : FIPC_Config::hexValue(hex[1]);
+    if( (low<0)||(_uploadSize>=sizeof(_upload)) ){
+      _uploadSize = 0; // un tramo inválido descarta la carga
+      return false;
+    }
+    data[_uploadSize++] = (high<<4)|low;
+  }
+  return true;
+}
+
+// Valida y guarda el bloque recibido.
+bool FIPC_Config::commit(){
+  if( _uploadSize!=sizeof(_upload) ) return false;
+  _uploadSize = 0;
+  if( !FIPC_Config::validate(_upload) ) return false;
+  if( !_storage->write(CONFIG_KEY, &_upload, sizeof(_upload)) ) return false;
+  _active = _upload;
+  _stored = true;
+  return true;
+}
+
+// Guarda la velocidad y la aceleración máxima de un eje.
+// Ante un error se restauran los valores anteriores de la configuración activa.
+bool FIPC_Config::setLimits(uint8_t id, float veloMax, float accelMax){
+  if( (id==0)||(id>_axisNumbers) ) return false;
+  AxisConfig &axis = _active.axis[id-1];
+  float velo = axis.veloMax, accel = axis.accelMax;
+  axis.veloMax = veloMax;
+  axis.accelMax = accelMax;
+  _active.crc = FIPC_Config::crc(_active);
+  if( (FIPC_Config::validate(axis))&&(_storage->write(CONFIG_KEY, &_active, sizeof(_active))) ){
+    _stored = true;
+    return true;
+  }
+  axis.veloMax = velo;
+  axis.accelMax = accel;
+  _active.crc = FIPC_Config::crc(_active);
+  return false;
+}
+
+// Solicita un reporte de la configuración activa.
+void FIPC_Config::getReport(FIPC_Text &out){
+  out.add(_stored ? '1' : '0');
+  out.add(';').add((unsigned)_active.crc);
+  out.add(';').add(_active.axisNumbers);
+}
+
+// Retorna el bloque activo en hexadecimal.
+void FIPC_Config::getBlob(FIPC_Text &out){
+  static const char digits[] = "0123456789ABCDEF";
+  const uint8_t* data = (const uint8_t*)&_active;
+  for(size_t i = 0; i<sizeof(_active); i++)
+    out.add(digits[data[i]>>4]).add(digits[data[i]&0x0F]);
+}
+
+// Convierte un dígito hexadecimal.
+int8_t FIPC_Config::hexValue(char c){
+  if( (c>='0')&&(c<='9') ) return c-'0';
+  if( (c>='A')&&(c<='F') ) return c-'A'+10;
+  if( (c>='a')&&(c<='f') ) return c-'a'+10;
+  return -1;
+}
+
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Lee y convierte un bloque de la versión 1.
+// Los registros se desplazan desde el último para no sobrescribir los que faltan mover.
+bool FIPC_Config::migrate(){
+  const size_t head = offsetof(ConfigBlob, axis);
+  const size_t size = head + CONFIG_AXIS_NUMBERS*CONFIG_V1_AXIS;
+  uint8_t* data = (uint8_t*)&_upload;
+  if( !_storage->read(CONFIG_KEY, data, size+4) ) return false;
+  if( (_upload.magic!=CONFIG_MAGIC)||(_upload.version!=1) ) return false;
+  uint16_t crc;
+  memcpy(&crc, data+size, sizeof(crc));
+  if( crc!=FIPC_Storage::crc16(data, size) ) return false;
+
+  for(int8_t i = CONFIG_AXIS_NUMBERS-1; i>=0; i--){
+    AxisConfig &axis = _upload.axis[i];
+    memmove(&axis, data+head+i*CONFIG_V1_AXIS, CONFIG_V1_AXIS);
+    memset((uint8_t*)&axis+CONFIG_V1_AXIS, 0, sizeof(AxisConfig)-CONFIG_V1_AXIS);
+    memset(axis.pinMode, MICROSTEP_NONE, MICROSTEP_PINS);
+  }
+  _upload.version = CONFIG_VERSION;
+  _upload.crc = FIPC_Config::crc(_upload);
+  _upload.padding = 0;
+  return true;
+}
+
+// Verifica un bloque.
+bool FIPC_Config::validate(const ConfigBlob &iBlob){
+  if( (iBlob.magic!=CONFIG_MAGIC)||(iBlob.version!=CONFIG_VERSION) ) return false;
+  if( iBlob.axisNumbers!=_axisNumbers ) return false;
+  if( iBlob.crc!=FIPC_Config::crc(iBlob) ) return false;
+
+  for(uint8_t i = 0; i<_axisNumbers; i++){
+    if( !FIPC_Config::validate(iBlob.axis[i]) ) return false;
+
+    // Las salidas de pulsos, dirección y modo no pueden compartirse entre ejes
+    for(uint8_t j = 0; j<i; j++){
+      const AxisConfig &a = iBlob.axis[i], &b = iBlob.axis[j];
+      if( (a.pinStep==b.pinStep)||(a.pinStep==b.pinDir)||
+          (a.pinDir==b.pinStep)||(a.pinDir==b.pinDir) ) return false;
+      if( a.flags&CONFIG_MICROSTEP )
+        for(uint8_t k = 0; k<MICROSTEP_PINS; k++)
+          if( FIPC_Config::usesOutput(b, a.pinMode[k]) ) return false;
+      if( b.flags&CONFIG_MICROSTEP )
+        for(uint8_t k = 0; k<MICROSTEP_PINS; k++)
+          if( FIPC_Config::usesOutput(a, b.pinMode[k]) ) return false;
+    }
+  }
+  return true;
+}
+
+// Verifica la configuración de un eje.
+bool FIPC_Config::validate(const AxisConfig &iAxis){
+  if( !FIPC_Config::isStepOutput(iAxis.pinStep)||!FIPC_Config::isStepOutput(iAxis.pinDir)||
+      (iAxis.pinEnable>CONFIG_GPIO_OUTPUT_MAX)||(iAxis.pinStep==iAxis.pinDir) ) return false;
+  // Pasos y dirección por la misma vía; el periférico RMT solo emite en GPIO y el cambio de
+  // micropasos necesita los pasos sin la demora de la cadena (los pines de modo son GPIO)
+  if( SHIFT_IS_PIN(iAxis.pinStep)!=SHIFT_IS_PIN(iAxis.pinDir) ) return false;
+  if( SHIFT_IS_PIN(iAxis.pinStep)&&(iAxis.flags&(CONFIG_PULSE_RMT|CONFIG_MICROSTEP)) ) return false;
+  if( (iAxis.pinPositive>CONFIG_GPIO_INPUT_MAX)||(iAxis.pinNegative>CONFIG_GPIO_INPUT_MAX)||
+      (iAxis.pinRef>CONFIG_GPIO_INPUT_MAX) ) return false;
+  if( memchr(iAxis.units, '\0', CONFIG_UNITS_SIZE)==NULL ) return false;
+
+  // Las comparaciones negadas también rechazan NaN
+  if( !(iAxis.stepsPerUnit>0.0) ) return false;
+  if( !(iAxis.minPosition<iAxis.maxPosition) ) return false;
+  float rate = (iAxis.flags&CONFIG_PULSE_RMT) ? CONFIG_MAX_PULSE_RATE : CONFIG_MAX_STEP_RATE;
+  if( iAxis.flags&CONFIG_MICROSTEP ){
+    // Solo por software: cada pulso del crucero avanza 2^(fino-grueso) pasos finos
+    if( (iAxis.flags&CONFIG_PULSE_RMT)||(iAxis.stepFine>MICROSTEP_MODE_MAX)||(iAxis.stepCoarse>=iAxis.stepFine) ) return false;
+    for(uint8_t k = 0; k<MICROSTEP_PINS; k++){
+      uint8_t pin = iAxis.pinMode[k];
+      if( pin==MICROSTEP_NONE ) continue;
+      if( (pin>CONFIG_GPIO_OUTPUT_MAX)||(pin==iAxis.pinStep)||(pin==iAxis.pinDir)||(pin==iAxis.pinEnable) ) return false;
+      for(uint8_t m = 0; m<k; m++) if( pin==iAxis.pinMode[m] ) return false;
+    }
+    rate *= 1L<<(iAxis.stepFine-iAxis.stepCoarse);
+  }
+  if( !(iAxis.veloMax>0.0)||!(iAxis.veloMax*iAxis.stepsPerUnit<=rate) ) return false;
+  if( !(iAxis.accelMax>0.0) ) return false;
+  if( !(iAxis.zero>=iAxis.minPosition)||!(iAxis.zero<=iAxis.maxPosition) ) return false;
+  return true;
+}
+
+// Verifica si un pin puede ser salida de pulsos o dirección.
+// Las salidas de la cadena de 74HC595 solo existen si se compila con SHIFT_ENABLED.
+bool FIPC_Config::isStepOutput(uint8_t pin){
+  if( pin<=CONFIG_GPIO_OUTPUT_MAX ) return true;
+  return (SHIFT_ENABLED)&&(SHIFT_IS_PIN(pin));
+}
+
+// Verifica si una GPIO es salida de pulsos, dirección o modo de un eje.
+bool FIPC_Config::usesOutput(const AxisConfig &iAxis, uint8_t pin){
+  if( pin==MICROSTEP_NONE ) return false;
+  if( (pin==iAxis.pinStep)||(pin==iAxis.pinDir) ) return true;
+  if( iAxis.flags&CONFIG_MICROSTEP )
+    for(uint8_t k = 0; k<MICROSTEP_PINS; k++) if( pin==iAxis.pinMode[k] ) return true;
+  return false;
+}
+
+// Calcula el CRC del bloque.
+uint16_t FIPC_Config::crc(const ConfigBlob &iBlob){
+  return FIPC_Storage::crc16(&iBlob, offsetof(ConfigBlob, crc));
+}
+
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,217 @@
+/*! \file FIPC_Config.h
+ *  \brief Configuración de los ejes cargada desde memoria no volátil.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Config_h
+#define FIPC_Config_h
+
+#include "Arduino.h"
+#include "FIPC_Storage.h"
+#include "FIPC_Text.h"
+#include "FIPC_Microstep.h"
+#include "FIPC_ShiftOut.h"
+
+#define CONFIG_AXIS_NUMBERS 8          /*!< Cantidad máxima de ejes del bloque de configuración. */
+#define CONFIG_UNITS_SIZE   8          /*!< Largo del nombre de las unidades (incluye el '\0'). */
+#define CONFIG_MAX_STEP_RATE 12000.0   /*!< Máxima frecuencia de pasos aceptada en pasos/s. */
+#define CONFIG_MAX_PULSE_RATE 150000.0 /*!< Máxima frecuencia de pasos con CONFIG_PULSE_RMT en pasos/s. */
+#define CONFIG_GPIO_OUTPUT_MAX 33      /*!< Mayor GPIO del ESP32 que puede usarse como salida. */
+#define CONFIG_GPIO_INPUT_MAX  39      /*!< Mayor GPIO del ESP32 que puede usarse como entrada. */
+
+#define CONFIG_INVERT_DIR    0x01 /*!< Invierte el sentido de giro del motor. */
+#define CONFIG_HOME_POSITIVE 0x02 /*!< Busca la referencia hacia coordenadas positivas. */
+#define CONFIG_LIMITS        0x04 /*!< Supervisa los fines de carrera del eje (ver FIPC_Limits). */
+#define CONFIG_PULSE_RMT     0x08 /*!< Emite los desplazamientos con el periférico RMT (ver FIPC_PulseTrain). */
+#define CONFIG_MICROSTEP     0x10 /*!< Cambia la resolución de micropasos durante los desplazamientos (ver FIPC_Microstep). */
+
+//!  Configuración de los ejes cargada desde memoria no volátil.
+/*!
+ *   La configuración de todos los ejes (pasos por unidad, límites, velocidad y aceleración
+ *   máxima, sentido de la búsqueda del cero, posición del cero y GPIO) se guarda como un
+ *   único bloque binario con un CRC. En begin() se lee el bloque y, si es válido, reemplaza
+ *   la configuración por defecto compilada en el firmware (ver setDefault()).
+ *
+ *   \par Carga de un nuevo bloque
+ *   El bloque se envía en tramos consecutivos con upload() y se confirma con commit(), que
+ *   lo valida y lo guarda con una única escritura atómica de FIPC_Storage: ante un error o
+ *   un corte de energía se conserva el bloque anterior completo. Todos los valores están en
+ *   little-endian, como en la memoria del ESP32.
+ *
+ *   \par Formato
+ *   Encabezado ConfigBlob::magic, ConfigBlob::version, ConfigBlob::axisNumbers, seguido de
+ *   CONFIG_AXIS_NUMBERS registros AxisConfig (los que no se usan en cero) y el CRC-16 (CCITT)
+ *   de todos los bytes anteriores.
+ *
+ *   Los límites de velocidad y aceleración de un eje también se actualizan con setLimits(),
+ *   que guarda el bloque activo completo.
+ *
+ *   Un bloque de la versión 1 (registros sin las entradas de modo de micropasos) guardado
+ *   por un firmware anterior se convierte al leerlo en begin(), sin CONFIG_MICROSTEP.
+*/
+class FIPC_Config
+{
+  public:
+    //! Configuración de un eje.
+    typedef struct{
+      uint8_t  stage;        /*!< Tipo de eje (ver FIPC_Axis::MotorStage), se guarda con la posición. */
+      uint8_t  flags;        /*!< Opciones CONFIG_INVERT_DIR, CONFIG_HOME_POSITIVE, CONFIG_LIMITS, CONFIG_PULSE_RMT y CONFIG_MICROSTEP. */
+      uint8_t  pinStep;      /*!< GPIO de pulsos o salida de la cadena de 74HC595 (SHIFT_PIN()). */
+      uint8_t  pinDir;       /*!< GPIO de dirección o salida de la cadena de 74HC595 (SHIFT_PIN()). */
+      uint8_t  pinEnable;    /*!< GPIO de habilitación. */
+      uint8_t  pinPositive;  /*!< GPIO del fin de carrera positivo. */
+      uint8_t  pinNegative;  /*!< GPIO del fin de carrera negativo. */
+      uint8_t  pinRef;       /*!< GPIO del switch de referencia. */
+      char     units[CONFIG_UNITS_SIZE]; /*!< Nombre de las unidades. */
+      float    stepsPerUnit; /*!< Pasos por unidad. */
+      float    minPosition;  /*!< Posición mínima en unidades. */
+      float    maxPosition;  /*!< Posición máxima en unidades. */
+      float    veloMax;      /*!< Velocidad máxima en unidades/s. */
+      float    accelMax;     /*!< Aceleración máxima en unidades/s^2. */
+      float    zero;         /*!< Posición en unidades asignada a la referencia. */
+      uint8_t  pinMode[MICROSTEP_PINS]; /*!< GPIO de MODE0, MODE1 y MODE2 del driver (MICROSTEP_NONE si tiene un nivel fijo). */
+      uint8_t  stepFine;     /*!< Modo de micropasos de stepsPerUnit con CONFIG_MICROSTEP (5 = 1/32 de paso). */
+      uint8_t  stepCoarse;   /*!< Modo de micropasos del crucero con CONFIG_MICROSTEP (menor que stepFine). */
+      uint8_t  reserved[3];  /*!< Sin uso, en cero. */
+    }AxisConfig;
+
+    //! Bloque de configuración guardado.
+    typedef struct{
+      uint32_t   magic;       /*!< Identificador del formato. */
+      uint16_t   version;     /*!< Versión del formato. */
+      uint8_t    axisNumbers; /*!< Cantidad de ejes configurados. */
+      uint8_t    reserved;    /*!< Sin uso, en cero. */
+      AxisConfig axis[CONFIG_AXIS_NUMBERS]; /*!< Configuración de cada eje. */
+      uint16_t   crc;         /*!< CRC-16 de los campos anteriores. */
+      uint16_t   padding;     /*!< Sin uso, en cero. */
+    }ConfigBlob;
+
+    //! Constructor.
+    /*!
+      \param pStorage Almacenamiento no volátil.
+      \param iAxisNumbers Cantidad de ejes del controlador.
+     */
+    FIPC_Config(FIPC_Storage* pStorage, uint8_t iAxisNumbers);
+
+    //! Establece la configuración por defecto de un eje.
+    /*!
+      \param id Identificador del eje.
+      \param iConfig Configuración compilada en el firmware.
+    */
+    void setDefault(uint8_t id, const AxisConfig &iConfig);
+
+    //! Lee el bloque guardado.
+    /*!
+     * Debe llamarse una vez antes de iniciar el proceso en tiempo real.
+     * \return true si se cargó un bloque válido, false si se mantiene la configuración por defecto.
+    */
+    bool begin();
+
+    //! Retorna la configuración activa de un eje.
+    /*!
+      \param id Identificador del eje.
+      \return La configuración del eje.
+    */
+    const AxisConfig& getAxis(uint8_t id);
+
+    //! Recibe un tramo del bloque a cargar.
+    /*!
+      Los tramos deben enviarse en orden; un tramo en la posición 0 inicia una nueva carga.
+      \param offset Posición del tramo en bytes.
+      \param hex Datos del tramo en hexadecimal.
+      \return true si el tramo fue aceptado.
+    */
+    bool upload(uint16_t offset, const char* hex);
+
+    //! Valida y guarda el bloque recibido.
+    /*!
+      Si el bloque es válido y se guardó, pasa a ser la configuración activa.
+      \return true si el bloque fue guardado.
+    */
+    bool commit();
+
+    //! Guarda la velocidad y la aceleración máxima de un eje.
+    /*!
+      Modifica la configuración activa (por defecto o guardada) y la guarda completa con
+      una única escritura, por ejemplo con los límites medidos por FIPC_Tune. No aplica los
+      límites al eje. Escribe en memoria no volátil: no debe llamarse desde el proceso en
+      tiempo real.
+      \param id Identificador del eje.
+      \param veloMax Velocidad máxima en unidades/s.
+      \param accelMax Aceleración máxima en unidades/s^2.
+      \return true si los límites son válidos y se guardaron.
+    */
+    bool setLimits(uint8_t id, float veloMax, float accelMax);
+
+    //! Solicita un reporte de la configuración activa.
+    /*!
+      \param out Texto donde se agrega "origen;crc;ejes" (origen 0 por defecto, 1 memoria no volátil).
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Retorna el bloque activo en hexadecimal.
+    /*!
+      \param out Texto donde se agrega el bloque.
+    */
+    void getBlob(FIPC_Text &out);
+
+    //! Convierte un dígito hexadecimal.
+    /*!
+      Utilizada también por la carga de programas (ver FIPC_Program).
+      \return El valor del dígito o -1 si no es un dígito hexadecimal.
+    */
+    static int8_t hexValue(char c);
+
+  private:
+    FIPC_Storage* _storage; /*!< Almacenamiento no volátil. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes del controlador. */
+
+    ConfigBlob _active; /*!< Configuración activa. */
+
+    ConfigBlob _upload; /*!< Bloque en carga. */
+
+    uint16_t _uploadSize = 0; /*!< Bytes recibidos del bloque en carga. */
+
+    bool _stored = false; /*!< La configuración activa proviene de la memoria no volátil. */
+
+    //! Lee y convierte un bloque de la versión 1.
+    /*!
+      \return true si se leyó un bloque de la versión 1 con CRC válido (queda en _upload).
+    */
+    bool migrate();
+
+    //! Verifica un bloque.
+    /*!
+      \param iBlob Bloque a verificar.
+      \return true si el formato, el CRC y todos los valores son válidos.
+    */
+    bool validate(const ConfigBlob &iBlob);
+
+    //! Verifica la configuración de un eje.
+    bool validate(const AxisConfig &iAxis);
+
+    //! Verifica si un pin puede ser salida de pulsos o dirección.
+    bool isStepOutput(uint8_t pin);
+
+    //! Verifica si una GPIO es salida de pulsos, dirección o modo de un eje.
+    bool usesOutput(const AxisConfig &iAxis, uint8_t pin);
+
+    //! Calcula el CRC del bloque.
+    uint16_t crc(const ConfigBlob &iBlob);
+};
+#endif
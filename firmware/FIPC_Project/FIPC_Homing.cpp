@@ -4,8 +4,6 @@
 
 #include "FIPC_Homing.h"
 
-#define DELAY_MS_AR 25 /*!< Tiempo de retardo para el antirebote en milisegundos. */
-
 // Constructor.
 FIPC_Homing::FIPC_Homing(AccelStepper* pAxis, uint8_t iSwitchRef) {
   _axis = pAxis;
@@ -14,11 +12,7 @@ FIPC_Homing::FIPC_Homing(AccelStepper* pAxis, uint8_t iSwitchRef) {
 
 // Ejecuta la búsqueda de la referencia
 bool FIPC_Homing::run(){
-   /* Decomentar sección si se quiere simular */
-   _status = HOMING_OK; 
-   _axis->setCurrentPosition(_absoluteZero);
-   return false; 
-   /* Decomentar sección si se quiere simular */
+  float toward = (_speedFast<0) ? -1.0 : 1.0; // sentido hacia el switch
 
   switch(_status){
     case HOMING_NOT:
@@ -26,34 +20,81 @@ bool FIPC_Homing::run(){
       break;
       
     case HOMING_INIT:
-      _axis->setMaxSpeed(_speedFast);
+      _steps = _axis->currentPosition();
+#if HOMING_SIMULATED
+      if( !_simFound ) _simSwitch = _steps + toward*HOMING_SIM_TRAVEL;
+      _simPressed = false;
+#else
+      attachInterruptArg(digitalPinToInterrupt(_switchRef), FIPC_Homing::isr, this, CHANGE);
+#endif
+      _axis->setMaxSpeed(abs(_speedFast));
+      _released = false;
     
-      if( digitalRead(_switchRef) ){
+      if( !FIPC_Homing::pressed() ){
+        FIPC_Homing::arm(true);
         _axis->setSpeed(_speedFast);
         _status = HOMING_FAST;       
       } else {
-        _axis->setSpeed(_speedSlow); 
-        _status = HOMING_SLOW;          
-        _time_saved = millis();
+        _pressSteps = _steps;
+        FIPC_Homing::arm(false);
+        _axis->setSpeed(-_speedFast);
+        _status = HOMING_BACKOFF;          
       }
       break;
       
     case HOMING_FAST:
-      if( !digitalRead(_switchRef) ){ 
-        _axis->setSpeed(_speedSlow);          
+      if( _edge ){ 
+        _pressSteps = _edgeSteps;
+        FIPC_Homing::arm(false);
+        _axis->setSpeed(-_speedFast);          
+        _status = HOMING_BACKOFF;
+      } else {
+        FIPC_Homing::step(); 
+      }
+      break;
+
+    case HOMING_BACKOFF:
+      if( (!_released)&&(_edge) ){
+        _released = true;
+        _backoffEnd = _edgeSteps - toward*HOMING_BACKOFF_STEPS;
+      }
+      if( (_released)&&((_steps-_backoffEnd)*toward<=0) ){
+        if( FIPC_Homing::pressed() ){
+          // El flanco fue un rebote: espera la liberación siguiente y se aleja desde allí
+          _released = false;
+          FIPC_Homing::arm(false);
+          FIPC_Homing::step();
+          break;
+        }
+        FIPC_Homing::arm(true);
+        _axis->setSpeed(toward*abs(_speedSlow));
         _status = HOMING_SLOW;
-        _time_saved = millis();
       } else {
-        _axis->runSpeed(); 
+        FIPC_Homing::step(); 
       }
       break;
 
     case HOMING_SLOW:
-      if( ((millis()-_time_saved)>DELAY_MS_AR)&&(digitalRead(_switchRef)) ){
-        _axis->setCurrentPosition(_absoluteZero);
+      if( _edge ){
+        // La referencia es la posición del flanco, no la del ciclo en que se atiende
+        _latchSteps = _edgeSteps;
+        _axis->setCurrentPosition(_absoluteZero + (_axis->currentPosition()-_edgeSteps));
+#if HOMING_SIMULATED
+        _simSwitch = _absoluteZero; // el switch queda en la referencia de las nuevas coordenadas
+        _simFound = true;
+#else
+        detachInterrupt(digitalPinToInterrupt(_switchRef));
+#endif
         _status = HOMING_OK;        
+      } else if( (_steps-_pressSteps)*toward>=HOMING_SLOW_STEPS ){
+        // El switch no se presionó en el recorrido esperado: la búsqueda se aborta
+#if !HOMING_SIMULATED
+        detachInterrupt(digitalPinToInterrupt(_switchRef));
+#endif
+        _status = HOMING_NOT;
+        return false;
       } else {
-        _axis->runSpeed(); 
+        FIPC_Homing::step(); 
       }
       break;
 
@@ -67,10 +108,16 @@ bool FIPC_Homing::run(){
 // Detiene y deshabilita la búsqueda de la referencia.
 void FIPC_Homing::stop(){
   switch(_status){
-    case HOMING_FAST: _status = HOMING_NOT; break;
-    case HOMING_SLOW: _status = HOMING_NOT; break;
-    case HOMING_OK:   _status = HOMING_NOT; break;
+    case HOMING_INIT:    _status = HOMING_NOT; break;
+    case HOMING_FAST:    _status = HOMING_NOT; break;
+    case HOMING_BACKOFF: _status = HOMING_NOT; break;
+    case HOMING_SLOW:    _status = HOMING_NOT; break;
+    case HOMING_OK:      _status = HOMING_NOT; return;
+    default: return;
   }    
+#if !HOMING_SIMULATED
+  detachInterrupt(digitalPinToInterrupt(_switchRef));
+#endif
 }
 
 // Configuración de velocidades.
@@ -102,3 +149,48 @@ void FIPC_Homing::invertDirection(){
   else _direction = true;
   FIPC_Homing::setSpeed(_speedFast,_speedSlow);
 }
+
+//Configura la dirección de la búsqueda.
+void FIPC_Homing::setDirection(bool iPositive){ _direction = !iPositive;}
+
+//Retorna la posición del flanco de referencia.
+long FIPC_Homing::getLatchSteps(){ return _latchSteps;}
+
+// Espera un flanco del switch.
+void FIPC_Homing::arm(bool iPressed){
+  _wantPressed = iPressed;
+  _edge = false;
+}
+
+// Verifica si el switch está presionado (activo en bajo).
+bool FIPC_Homing::pressed(){
+#if HOMING_SIMULATED
+  return _simPressed;
+#else
+  return !digitalRead(_switchRef);
+#endif
+}
+
+// Emite un paso a velocidad constante y actualiza la posición.
+void FIPC_Homing::step(){
+  if( !_axis->runSpeed() ) return;
+  _steps = _axis->currentPosition();
+#if HOMING_SIMULATED
+  bool level = ((_steps-_simSwitch)*((_speedFast<0) ? -1 : 1)>=0);
+  if( level!=_simPressed ) FIPC_Homing::edge(_simPressed = level);
+#endif
+}
+
+// Registra un flanco del switch.
+void IRAM_ATTR FIPC_Homing::edge(bool iPressed){
+  if( (_edge)||(iPressed!=_wantPressed) ) return; // rebotes y flancos no esperados
+  _edgeSteps = _steps;
+  _edgeTime = micros();
+  _edge = true;
+}
+
+// Atención de la interrupción del switch.
+void IRAM_ATTR FIPC_Homing::isr(void* arg){
+  FIPC_Homing* homing = (FIPC_Homing*)arg;
+  homing->edge(!digitalRead(homing->_switchRef));
+}
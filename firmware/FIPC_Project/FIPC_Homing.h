@@ -23,12 +23,36 @@
 #include "Arduino.h"
 #include <AccelStepper.h>
 
+#ifndef HOMING_SIMULATED
+#define HOMING_SIMULATED 1 /*!< 1 simula el switch de referencia a partir de la posición, 0 utiliza los switches reales. */
+#endif
+
+#define HOMING_BACKOFF_STEPS 400   /*!< Pasos de alejamiento luego de liberar el switch antes de la pasada lenta. */
+#define HOMING_SLOW_STEPS    HOMING_BACKOFF_STEPS /*!< Recorrido en pasos de la pasada lenta más allá del switch de la pasada rápida, sin flanco se aborta la búsqueda. */
+#define HOMING_SIM_TRAVEL    2000  /*!< Distancia en pasos al switch simulado desde el inicio de la búsqueda. */
+
 //!  Clase que implementa la búsqueda de la referencia cero.
 /*!
  * Ejecuta la secuencia de búsqueda de la referencia:
- * Si no detecta el switch mueve de forma rápida hasta detectarlo.
- * Una vez encontrada la referencia, cambia el sentido de giro y se
- * desplaza hasta que el switch combie de estado.
+ * \li Si el switch no está presionado se desplaza rápido hasta presionarlo.
+ * \li Se aleja rápido hasta liberarlo y recorre HOMING_BACKOFF_STEPS pasos más. Si al final
+ * del alejamiento el switch está presionado la liberación fue un rebote, por lo que espera
+ * la liberación siguiente y repite el alejamiento desde allí.
+ * \li Se acerca lento y toma como referencia el flanco en que se presiona el switch. Si el
+ * switch no se presiona antes de superar en HOMING_SLOW_STEPS pasos la posición en que se
+ * presionó en la pasada rápida, la búsqueda se aborta (HOMING_NOT).
+ *
+ * Los flancos del switch (activo en bajo) se capturan por interrupción junto con
+ * la posición en pasos del último paso emitido, por lo que la referencia no depende
+ * del período de exec() ni requiere un retardo antirebote: solo se acepta el primer
+ * flanco esperado en cada etapa. Cada eje tiene su propia instancia, por lo que la
+ * búsqueda de todos los ejes se ejecuta en paralelo.
+ *
+ * Con HOMING_SIMULATED en 1 (por defecto, ver compilación con -DHOMING_SIMULATED=0)
+ * el switch se simula a HOMING_SIM_TRAVEL pasos de la posición inicial de la primera
+ * búsqueda y los flancos se generan desde exec() por el mismo camino que la interrupción.
+ * Luego queda fijo en la referencia encontrada, como un switch real, por lo que repetir
+ * la búsqueda sin perder pasos reproduce la misma referencia (ver FIPC_Axis::rehome()).
  */
 class FIPC_Homing
 {
@@ -38,6 +62,7 @@ class FIPC_Homing
     typedef enum{ HOMING_NOT,   /*!< Sin referencia, en espera de la orden de inicio. */
                   HOMING_INIT,  /*!< Inicializa la secuencia. */
                   HOMING_FAST,  /*!< Se desplaza rápido hasta encontrar referencia. */
+                  HOMING_BACKOFF, /*!< Se aleja rápido hasta liberar el switch. */
                   HOMING_SLOW,  /*!< Se desplaza lento hasta definir la referencia. */
                   HOMING_OK     /*!< Referencia encontrada. */
                   }HomingStatus;
@@ -51,7 +76,8 @@ class FIPC_Homing
 
     //! Ejecuta la búsqueda de la referencia cero.
     /*!
-      \return true la referencia fue encontrada.
+      \return false al terminar la búsqueda: getStatus() es HOMING_OK si se encontró la
+      referencia o HOMING_NOT si se abortó.
     */    
     bool run();
     
@@ -91,6 +117,19 @@ class FIPC_Homing
 
     //! Invierte la dirección de la búsqueda.
     void    invertDirection();
+
+    //! Configura la dirección de la búsqueda.
+    /*!
+      Debe llamarse antes de setSpeed().
+      \param iPositive true para buscar la referencia hacia coordenadas positivas.
+    */    
+    void    setDirection(bool iPositive);
+
+    //! Retorna la posición del flanco de referencia.
+    /*!
+      \return Posición en pasos, antes de fijar el cero, del último paso emitido al presionarse el switch.
+    */    
+    long getLatchSteps();
   
   private:
     AccelStepper* _axis; /*!< Puntero a driver del motor paso a paso. */
@@ -101,12 +140,54 @@ class FIPC_Homing
 
     bool _direction = true; /*!< Dirección de búsqueda de referencia. */
 
-    long _time_saved = 0; /*!< Variable de tiempo en microsegundo para la implementación del antirebote. */    
+    volatile long _steps = 0; /*!< Posición del último paso emitido, leída por la interrupción. */
+
+    volatile bool _edge = false; /*!< Se capturó el flanco esperado. */
+
+    volatile bool _wantPressed = true; /*!< Flanco esperado (true presionado). */
+
+    volatile long _edgeSteps = 0; /*!< Posición en pasos en el flanco capturado. */
+
+    volatile unsigned long _edgeTime = 0; /*!< Instante en us del flanco capturado. */
+
+    bool _released = false; /*!< El switch fue liberado durante el alejamiento. */
+
+    long _pressSteps = 0; /*!< Posición en que se presionó el switch en la pasada rápida. */
+
+    long _backoffEnd = 0; /*!< Posición de fin del alejamiento. */
+
+    long _latchSteps = 0; /*!< Posición del flanco de referencia. */
+
+#if HOMING_SIMULATED
+    long _simSwitch = 0; /*!< Posición del switch simulado. */
+
+    bool _simPressed = false; /*!< Estado del switch simulado. */
+
+    bool _simFound = false; /*!< El switch simulado quedó fijo en la referencia encontrada. */
+#endif
     
     float _speedFast=0; /*!< Almacena la velocidad máxima en pasos/s. */    
 
     float _speedSlow=0; /*!< Almacena la velocidad mínima en pasos/s. */    
 
     long _absoluteZero = 0; /*!< Distancia virtual al cero en pasos. */    
+
+    //! Espera un flanco del switch.
+    /*!
+      \param iPressed true para esperar que se presione.
+    */
+    void arm(bool iPressed);
+
+    //! Verifica si el switch está presionado.
+    bool pressed();
+
+    //! Emite un paso a velocidad constante y actualiza la posición.
+    void step();
+
+    //! Registra un flanco del switch (interrupción o simulación).
+    void IRAM_ATTR edge(bool iPressed);
+
+    //! Atención de la interrupción del switch.
+    static void IRAM_ATTR isr(void* arg);
 };
 #endif 
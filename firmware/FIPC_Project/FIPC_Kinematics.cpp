@@ -0,0 +1,334 @@
+/*! \file FIPC_Kinematics.cpp
+    \brief Clase que implementa desplazamientos de la herramienta alrededor de un punto de pivote.
+*/
+
+#include "FIPC_Kinematics.h"
+
+#define KIN_Q30         1073741824LL /*!< Uno en Q30. */
+#define KIN_Q32         4294967296LL /*!< Uno en Q32. */
+#define KIN_QUARTER     90000000L    /*!< Cuarto de vuelta en ugrad. */
+#define KIN_TURN        360000000L   /*!< Vuelta completa en ugrad. */
+#define KIN_POSE_MAX    1000000.0    /*!< Máximo valor absoluto de una pose en um o mgrad. */
+#define KIN_TIME_MARGIN 1.01         /*!< Margen sobre el tiempo mínimo para no alcanzar la velocidad máxima. */
+
+int32_t FIPC_Kinematics::_sine[KIN_SINE_SIZE+1];
+
+// Constructor.
+// La tabla del seno se calcula una única vez, fuera del proceso en tiempo real.
+FIPC_Kinematics::FIPC_Kinematics(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Budget* pBudget) {
+  _axis = pAxis;
+  _budget = pBudget;
+  _valid = (iAxisNumbers>=KIN_AXIS_NUMBERS);
+  if( _sine[KIN_SINE_SIZE]==0 )
+    for(uint16_t i = 0; i<=KIN_SINE_SIZE; i++) _sine[i] = lround(sin(i*PI/(2.0*KIN_SINE_SIZE))*KIN_Q30);
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura el punto de pivote.
+bool FIPC_Kinematics::setPivot(float pivot[]){
+  if( (_status==KIN_START)||(_status==KIN_RUN)||(_status==KIN_FINISH) ) return false;
+  int32_t value[3];
+  if( !FIPC_Kinematics::toFixed(pivot, value) ) return false;
+  for(uint8_t i = 0; i<3; i++) _pivot[i] = value[i];
+  return true;
+}
+
+// Inicia un desplazamiento a una pose absoluta de la herramienta.
+float FIPC_Kinematics::moveAbsolute(float pose[], float iTimeSpeed, float iAccelTime){
+  int32_t target[KIN_AXIS_NUMBERS];
+  if( (!FIPC_Kinematics::toFixed(pose, target))||(!FIPC_Kinematics::toFixed(pose+3, target+3)) ) return -1.0;
+  return FIPC_Kinematics::startMove(target, iTimeSpeed, iAccelTime);
+}
+
+// Inicia un desplazamiento relativo en el sistema de la herramienta.
+float FIPC_Kinematics::moveRelative(float delta[], float iTimeSpeed, float iAccelTime){
+  int32_t value[KIN_AXIS_NUMBERS], target[KIN_AXIS_NUMBERS];
+  if( (!_valid)||(!FIPC_Kinematics::toFixed(delta, value))||(!FIPC_Kinematics::toFixed(delta+3, value+3)) ) return -1.0;
+
+  // La traslación se rota con la orientación actual de la herramienta
+  FIPC_Kinematics::currentPose(target);
+  int64_t p[3] = {value[0], value[1], value[2]};
+  FIPC_Kinematics::rotation(target+3, p);
+  for(uint8_t i = 0; i<3; i++) target[i] += p[i];
+  for(uint8_t i = 3; i<KIN_AXIS_NUMBERS; i++) target[i] += value[i];
+  return FIPC_Kinematics::startMove(target, iTimeSpeed, iAccelTime);
+}
+
+// Detiene el desplazamiento desacelerando sobre la trayectoria.
+void FIPC_Kinematics::stop(){
+  if( (_status==KIN_START)||(_status==KIN_RUN) ) _stop = true;
+}
+
+// Retorna el estado del desplazamiento.
+uint8_t FIPC_Kinematics::getStatus(){ return _status;}
+
+// Solicita un reporte de la pose de la herramienta.
+void FIPC_Kinematics::getReport(FIPC_Text &out){
+  switch(_status){
+    case KIN_IDLE:    out.add("Idle");    break;
+    case KIN_START:
+    case KIN_RUN:
+    case KIN_FINISH:  out.add("Moving");  break;
+    case KIN_DONE:    out.add("Done");    break;
+    case KIN_ABORTED: out.add("Aborted"); break;
+  }
+  int32_t pose[KIN_AXIS_NUMBERS];
+  if( _valid ) FIPC_Kinematics::currentPose(pose);
+  else         memset(pose, 0, sizeof(pose));
+  for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++) out.add(';').add(pose[i]/1000.0, 3);
+}
+
+// Consulta si el desplazamiento terminó desde la última consulta.
+bool FIPC_Kinematics::finished(){
+  if( !_finished ) return false;
+  _finished = false;
+  return true;
+}
+
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+void FIPC_Kinematics::exec(){
+  // 1° Espera que todos los ejes inicien el seguimiento
+  if( _status==KIN_START ){
+    for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++)
+      if( !_axis[i]->isTracking() ){ FIPC_Kinematics::abort(); return; }
+    if( _stop ){ FIPC_Kinematics::abort(); return; }
+    if( !FIPC_Kinematics::trackAll(false) ) return;
+    _tickTime = micros();
+    _status = KIN_RUN;
+    return;
+  }
+
+  // 2° Avanza sobre la trayectoria con un perfil trapezoidal
+  if( _status==KIN_RUN ){
+    if( (micros()-_tickTime)<KIN_PERIOD_US ) return;
+    _tickTime += KIN_PERIOD_US;
+    if( (micros()-_tickTime)>=KIN_PERIOD_US ) _tickTime = micros(); // sin acumular atrasos
+
+    // Un eje atrasado detiene el avance para mantener el pivote fijo
+    for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++)
+      if( abs(_target[i]-_axis[i]->getCurrentSteps())>KIN_LAG_STEPS ){
+        if( !FIPC_Kinematics::trackAll(false) ) FIPC_Kinematics::abort();
+        return;
+      }
+
+    const float dt = KIN_PERIOD_US*1e-6;
+    bool last = false;
+    if( _stop ){
+      _v -= _aMax*dt;
+      if( _v<=0.0 ){ _v = 0.0; last = true; _aborted = true; }
+    } else {
+      // Frena cuando la distancia restante alcanza para detenerse
+      if( _v*_v>=2.0*_aMax*(1.0-_s) ) _v -= _aMax*dt;
+      else                            _v += _aMax*dt;
+      _v = constrain(_v, _aMax*dt, _vMax);
+    }
+    _s += _v*dt;
+    if( _s>=1.0 ){ _s = 1.0; last = true; }
+
+    if( !FIPC_Kinematics::trackAll(last) ) FIPC_Kinematics::abort();
+    else if( last ) _status = KIN_FINISH;
+    return;
+  }
+
+  // 3° Espera que todos los ejes alcancen el destino final
+  if( _status==KIN_FINISH ){
+    for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++)
+      if( _axis[i]->isTracking() ) return;
+    _status = (_aborted) ? KIN_ABORTED : KIN_DONE;
+    _finished = true;
+    return;
+  }
+}
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Seno en Q30 de un ángulo en ugrad.
+int32_t FIPC_Kinematics::sine(int32_t angle){
+  int32_t a = angle%KIN_TURN;
+  if( a<0 ) a += KIN_TURN;
+  uint8_t quadrant = a/KIN_QUARTER;
+  int32_t r = a%KIN_QUARTER;
+  if( quadrant&1 ) r = KIN_QUARTER-r;
+
+  int64_t pos = (int64_t)r*KIN_SINE_SIZE;
+  int32_t idx = pos/KIN_QUARTER;
+  int32_t out = _sine[idx];
+  if( idx<KIN_SINE_SIZE ) out += (int64_t)(_sine[idx+1]-_sine[idx])*(pos%KIN_QUARTER)/KIN_QUARTER;
+  return (quadrant>=2) ? -out : out;
+}
+
+// Rota el par (u, v) con el seno y coseno en Q30.
+void FIPC_Kinematics::rotate(int64_t &u, int64_t &v, int32_t s, int32_t c){
+  int64_t ru = (u*c-v*s+(KIN_Q30>>1))>>30;
+  int64_t rv = (u*s+v*c+(KIN_Q30>>1))>>30;
+  u = ru;
+  v = rv;
+}
+
+// Aplica R = Rz(a)·Rx(b)·Ry(c): primero Ry, luego Rx y por último Rz.
+void FIPC_Kinematics::rotation(const int32_t angle[], int64_t p[]){
+  FIPC_Kinematics::rotate(p[2], p[0], sine(angle[2]), sine(angle[2]+KIN_QUARTER)); // Ry: z -> x
+  FIPC_Kinematics::rotate(p[1], p[2], sine(angle[1]), sine(angle[1]+KIN_QUARTER)); // Rx: y -> z
+  FIPC_Kinematics::rotate(p[0], p[1], sine(angle[0]), sine(angle[0]+KIN_QUARTER)); // Rz: x -> y
+}
+
+// Calcula (I - R)·d del pivote.
+void FIPC_Kinematics::offset(const int32_t angle[], int32_t out[]){
+  int64_t p[3] = {_pivot[0], _pivot[1], _pivot[2]};
+  FIPC_Kinematics::rotation(angle, p);
+  for(uint8_t i = 0; i<3; i++) out[i] = _pivot[i]-p[i];
+}
+
+// Pose de la herramienta a partir de la posición actual de los ejes.
+void FIPC_Kinematics::currentPose(int32_t pose[]){
+  for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++){
+    // Inversa del factor en Q32 para que pose y pasos sean consistentes
+    int64_t factor = llround(_axis[i]->getStepsPerUnit()/1000.0*KIN_Q32);
+    int64_t num = (int64_t)_axis[i]->getCurrentSteps()*KIN_Q32;
+    pose[i] = (num+((num>=0) ? factor/2 : -factor/2))/factor;
+  }
+  int32_t off[3];
+  FIPC_Kinematics::offset(pose+3, off);
+  for(uint8_t i = 0; i<3; i++) pose[i] -= off[i];
+}
+
+// Pose de la herramienta en el avance s en Q30.
+void FIPC_Kinematics::poseAt(int32_t sQ, int32_t pose[]){
+  for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++)
+    pose[i] = _from[i] + (((int64_t)_delta[i]*sQ+(KIN_Q30>>1))>>30);
+}
+
+// Coordenadas de los ejes para una pose: q = P + (I - R)·d.
+void FIPC_Kinematics::jointValues(const int32_t pose[], int32_t joint[]){
+  int32_t off[3];
+  FIPC_Kinematics::offset(pose+3, off);
+  for(uint8_t i = 0; i<3; i++) joint[i] = pose[i]+off[i];
+  for(uint8_t i = 3; i<KIN_AXIS_NUMBERS; i++) joint[i] = pose[i];
+}
+
+// Destino en pasos de cada eje para una pose.
+void FIPC_Kinematics::jointSteps(const int32_t pose[], long steps[]){
+  int32_t joint[KIN_AXIS_NUMBERS];
+  FIPC_Kinematics::jointValues(pose, joint);
+  for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++)
+    steps[i] = ((int64_t)joint[i]*_factor[i]+(KIN_Q32>>1))>>32;
+}
+
+// Convierte una pose en um y mgrad a nm y ugrad.
+bool FIPC_Kinematics::toFixed(const float value[], int32_t out[]){
+  for(uint8_t i = 0; i<3; i++){
+    if( !(abs(value[i])<=KIN_POSE_MAX) ) return false; // también descarta NaN
+    out[i] = lround(value[i]*1000.0);
+  }
+  return true;
+}
+
+// Verifica la trayectoria e inicia el seguimiento de todos los ejes.
+float FIPC_Kinematics::startMove(const int32_t target[], float iTimeSpeed, float iAccelTime){
+  if( !_valid ) return -1.0;
+  if( (_status==KIN_START)||(_status==KIN_RUN)||(_status==KIN_FINISH) ) return -1.0;
+  if( !FIPC_Kinematics::axisReady() ) return -1.0;
+
+  uint8_t i;
+  for(i = 0; i<KIN_AXIS_NUMBERS; i++) _factor[i] = llround(_axis[i]->getStepsPerUnit()/1000.0*KIN_Q32);
+  FIPC_Kinematics::currentPose(_from);
+  for(i = 0; i<KIN_AXIS_NUMBERS; i++) _delta[i] = target[i]-_from[i];
+
+  // Recorre la trayectoria en tramos: límites de los ejes y máxima derivada de cada eje
+  // respecto del avance (unidades del eje por unidad de avance)
+  float rate[KIN_AXIS_NUMBERS] = {0, 0, 0, 0, 0, 0};
+  int32_t pose[KIN_AXIS_NUMBERS], joint[KIN_AXIS_NUMBERS], previous[KIN_AXIS_NUMBERS];
+  for(uint8_t k = 0; k<=KIN_SAMPLES; k++){
+    FIPC_Kinematics::poseAt((int32_t)(KIN_Q30*k/KIN_SAMPLES), pose);
+    FIPC_Kinematics::jointValues(pose, joint);
+    for(i = 0; i<KIN_AXIS_NUMBERS; i++){
+      if( !_axis[i]->canMoveAbsolute(joint[i]/1000.0) ) return -1.0;
+      if( k ) rate[i] = max(rate[i], (float)(abs(joint[i]-previous[i])*KIN_SAMPLES/1000.0));
+      previous[i] = joint[i];
+    }
+  }
+
+  // Igual que un desplazamiento sincrónico: v = rate/T y a = rate/(T*ta)
+  float tCruise = 0.0, kAccel = 0.0;
+  for(i = 0; i<KIN_AXIS_NUMBERS; i++){
+    tCruise = max(tCruise, rate[i]/_axis[i]->getMaxSpeed());
+    kAccel  = max(kAccel,  rate[i]/_axis[i]->getMaxAcceleration());
+  }
+  if( tCruise==0.0 ) return 0.0; // no hay desplazamiento
+
+  if( iTimeSpeed<=0.0 ){
+    if( tCruise*tCruise<kAccel ){
+      iTimeSpeed = iAccelTime = sqrt(kAccel);
+    } else {
+      iTimeSpeed = tCruise;
+      iAccelTime = kAccel/tCruise;
+    }
+    iTimeSpeed *= KIN_TIME_MARGIN;
+  } else if( (iAccelTime<=0.0)||(iTimeSpeed<tCruise)||(iTimeSpeed*iAccelTime<kAccel) ) {
+    return -1.0;
+  }
+  _vMax = 1.0/iTimeSpeed;
+  _aMax = _vMax/iAccelTime;
+  _s = 0.0;
+  _v = 0.0;
+  _stop = false;
+  _aborted = false;
+  _finished = false;
+
+  // El seguimiento no se estira: se descarta si no entra en el presupuesto de pasos
+  float scale;
+  if( !_budget->admit(_axis, KIN_AXIS_NUMBERS, FIPC_Axis::ACTION_TRACK, NULL, scale, false) ) return -1.0;
+  for(i = 0; i<KIN_AXIS_NUMBERS; i++){
+    if( _axis[i]->setAction(FIPC_Axis::ACTION_TRACK) ) continue;
+    // cancela los ejes que ya aceptaron el seguimiento
+    while( i>0 ) _axis[--i]->setAction(FIPC_Axis::ACTION_STOP);
+    return -1.0;
+  }
+  _status = KIN_START;
+  return iTimeSpeed+iAccelTime;
+}
+
+// Verifica si todos los ejes están en espera.
+bool FIPC_Kinematics::axisReady(){
+  for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++)
+    if( !_axis[i]->isReady() ) return false;
+  return true;
+}
+
+// Detiene todos los ejes en el lugar y espera que abandonen el seguimiento.
+// Los ejes que aún no iniciaron el seguimiento lo cancelan.
+void FIPC_Kinematics::abort(){
+  for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++)
+    if( !_axis[i]->track(_axis[i]->getCurrentSteps(), 0.0, true) ) _axis[i]->setAction(FIPC_Axis::ACTION_STOP);
+  _aborted = true;
+  _status = KIN_FINISH;
+}
+
+// Envía los destinos del avance actual a todos los ejes.
+// La velocidad de cada eje es la necesaria para alcanzar el destino en un período.
+bool FIPC_Kinematics::trackAll(bool iLast){
+  int32_t pose[KIN_AXIS_NUMBERS];
+  long steps[KIN_AXIS_NUMBERS];
+  FIPC_Kinematics::poseAt((int32_t)(_s*KIN_Q30), pose);
+  FIPC_Kinematics::jointSteps(pose, steps);
+
+  bool ok = true;
+  for(uint8_t i = 0; i<KIN_AXIS_NUMBERS; i++){
+    float speed = abs(steps[i]-_axis[i]->getCurrentSteps())*(1e6/KIN_PERIOD_US);
+    if( !_axis[i]->track(steps[i], speed, iLast) ) ok = false;
+    _target[i] = steps[i];
+  }
+  return ok;
+}
+
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,219 @@
+/*! \file FIPC_Kinematics.h
+ *  \brief Clase que implementa desplazamientos de la herramienta alrededor de un punto de pivote.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Kinematics_h
+#define FIPC_Kinematics_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+#include "FIPC_Budget.h"
+
+#define KIN_AXIS_NUMBERS 6     /*!< Ejes de la platina: X, Y, Z (um) y rotaciones alrededor de Z, X, Y (mgrad). */
+#define KIN_PERIOD_US    2000  /*!< Período de actualización de los destinos intermedios en microsegundos. */
+#define KIN_SAMPLES      32    /*!< Tramos en que se verifica la trayectoria antes de iniciarla. */
+#define KIN_SINE_SIZE    512   /*!< Segmentos de la tabla de un cuarto de onda del seno. */
+#define KIN_LAG_STEPS    2     /*!< Atraso en pasos de un eje que detiene el avance sobre la trayectoria. */
+
+//!  Clase que implementa desplazamientos de la herramienta alrededor de un punto de pivote.
+/*!
+ *   La pose de la herramienta es la posición del pivote (por ejemplo la punta de una fibra)
+ *   y los ángulos de los 3 ejes rotativos. Los ejes #1, #2 y #3 son X, Y y Z en um, y los
+ *   ejes #4, #5 y #6 rotan alrededor de Z, X e Y en mgrad, con la matriz de rotación
+ *   R = Rz(a)·Rx(b)·Ry(c) alrededor del centro de rotación común de la platina.
+ *
+ *   \par Pivote
+ *   El pivote se define con setPivot() como la distancia al centro de rotación con los
+ *   ángulos en cero. Las coordenadas de los ejes lineales que mantienen el pivote en la
+ *   posición P de la herramienta son q = P + (I - R)·d. Con ángulos en cero la pose de la
+ *   herramienta coincide con la posición de los ejes.
+ *
+ *   \par Trayectoria
+ *   La pose se interpola en línea recta desde la pose actual con un perfil trapezoidal y
+ *   cada KIN_PERIOD_US se calculan los destinos de los 6 ejes, que los siguen en el modo
+ *   FIPC_Axis::STATUS_TRACKING. De esta manera el pivote permanece fijo durante una rotación
+ *   pura. Si un eje no alcanzó su destino anterior (atraso mayor a KIN_LAG_STEPS) el avance
+ *   espera un período para que ningún eje se separe de la trayectoria. La pose se calcula en punto fijo (nm y ugrad) con una tabla del seno interpolada,
+ *   sin funciones trigonométricas en el proceso en tiempo real.
+ *
+ *   \par Detención
+ *   stop() desacelera sobre la misma trayectoria, por lo que el pivote no se desplaza. Si un
+ *   eje abandona el seguimiento (por ejemplo por un fin de carrera) se detienen todos.
+*/
+class FIPC_Kinematics
+{
+  public:
+
+    //! Definicion de variable simbólica de estados del desplazamiento.
+    typedef enum{ KIN_IDLE,         /*!< Sin desplazamiento en ejecución. */
+                  KIN_START,        /*!< Esperando que todos los ejes inicien el seguimiento. */
+                  KIN_RUN,          /*!< Recorriendo la trayectoria. */
+                  KIN_FINISH,       /*!< Esperando que todos los ejes alcancen el destino final. */
+                  KIN_DONE,         /*!< Desplazamiento finalizado. */
+                  KIN_ABORTED       /*!< Desplazamiento cancelado. */
+                  }KinStatus;
+
+    //! Constructor.
+    /*!
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista (debe ser al menos KIN_AXIS_NUMBERS).
+      \param pBudget Presupuesto de pasos de exec() de las acciones de los ejes.
+     */
+    FIPC_Kinematics(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Budget* pBudget);
+
+    //! Configura el punto de pivote.
+    /*!
+      \param pivot Distancia X, Y, Z en um del pivote al centro de rotación con los ángulos en cero.
+      \return false si hay un desplazamiento en ejecución.
+    */
+    bool setPivot(float pivot[]);
+
+    //! Inicia un desplazamiento a una pose absoluta de la herramienta.
+    /*!
+      \param pose Posición X, Y, Z del pivote en um y ángulos a, b, c en mgrad.
+      \param iTimeSpeed Tiempo del desplazamiento en segundos (0 para el menor tiempo posible).
+      \param iAccelTime Tiempo de aceleración en segundos.
+      \return Tiempo total en segundos, o un valor negativo si fue rechazado.
+    */
+    float moveAbsolute(float pose[], float iTimeSpeed, float iAccelTime);
+
+    //! Inicia un desplazamiento relativo en el sistema de la herramienta.
+    /*!
+     * La traslación se expresa en los ejes de la herramienta (se rota con la orientación
+     * actual) y los ángulos se suman a los actuales.
+      \param delta Traslación X, Y, Z en um y rotación a, b, c en mgrad.
+      \param iTimeSpeed Tiempo del desplazamiento en segundos (0 para el menor tiempo posible).
+      \param iAccelTime Tiempo de aceleración en segundos.
+      \return Tiempo total en segundos, o un valor negativo si fue rechazado.
+    */
+    float moveRelative(float delta[], float iTimeSpeed, float iAccelTime);
+
+    //! Detiene el desplazamiento desacelerando sobre la trayectoria.
+    void stop();
+
+    //! Ejecuta el desplazamiento.
+    /*!
+     * Esta función deberá ser llamada recurrentemente en tiempo real, antes de exec() de los ejes.
+    */
+    void exec();
+
+    //! Retorna el estado del desplazamiento.
+    /*!
+      \return La variable simbólica que describe el estado (ver FIPC_Kinematics::KinStatus).
+    */
+    uint8_t getStatus();
+
+    //! Solicita un reporte de la pose de la herramienta.
+    /*!
+      \param out Texto donde se agrega "estado;x;y;z;a;b;c".
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Consulta si el desplazamiento terminó desde la última consulta.
+    /*!
+      \return true una única vez al finalizar el desplazamiento.
+    */
+    bool finished();
+
+  private:
+    FIPC_Axis** _axis; /*!< Lista de ejes del controlador. */
+
+    FIPC_Budget* _budget; /*!< Presupuesto de pasos de exec(). */
+
+    bool _valid; /*!< true si el controlador tiene los ejes necesarios. */
+
+    volatile KinStatus _status = KIN_IDLE; /*!< Estado del desplazamiento. */
+
+    volatile bool _finished = false; /*!< Indica el fin del desplazamiento hasta ser consultado. */
+
+    volatile bool _stop = false; /*!< Se pidió detener el desplazamiento. */
+
+    bool _aborted = false; /*!< El desplazamiento terminó antes del destino. */
+
+    int32_t _pivot[3] = {0, 0, 0}; /*!< Pivote en nm respecto del centro de rotación. */
+
+    int32_t _from[KIN_AXIS_NUMBERS]; /*!< Pose inicial (nm y ugrad). */
+
+    int32_t _delta[KIN_AXIS_NUMBERS]; /*!< Desplazamiento de la pose (nm y ugrad). */
+
+    int64_t _factor[KIN_AXIS_NUMBERS]; /*!< Pasos por nm o por ugrad de cada eje en Q32. */
+
+    long _target[KIN_AXIS_NUMBERS]; /*!< Último destino en pasos enviado a cada eje. */
+
+    float _s = 0.0; /*!< Avance sobre la trayectoria (0 a 1). */
+
+    float _v = 0.0; /*!< Velocidad sobre la trayectoria en 1/s. */
+
+    float _vMax = 0.0; /*!< Velocidad de crucero sobre la trayectoria en 1/s. */
+
+    float _aMax = 0.0; /*!< Aceleración sobre la trayectoria en 1/s^2. */
+
+    unsigned long _tickTime = 0; /*!< Tiempo en microsegundos de la última actualización. */
+
+    static int32_t _sine[KIN_SINE_SIZE+1]; /*!< Cuarto de onda del seno en Q30. */
+
+    //! Seno en Q30 de un ángulo en ugrad (tabla con interpolación lineal).
+    static int32_t sine(int32_t angle);
+
+    //! Rota el par (u, v) con el seno y coseno en Q30.
+    static void rotate(int64_t &u, int64_t &v, int32_t s, int32_t c);
+
+    //! Aplica R = Rz(a)·Rx(b)·Ry(c) al vector p (nm).
+    static void rotation(const int32_t angle[], int64_t p[]);
+
+    //! Calcula (I - R)·d del pivote para los ángulos dados.
+    void offset(const int32_t angle[], int32_t out[]);
+
+    //! Pose de la herramienta a partir de la posición actual de los ejes.
+    void currentPose(int32_t pose[]);
+
+    //! Pose de la herramienta en el avance s en Q30.
+    void poseAt(int32_t sQ, int32_t pose[]);
+
+    //! Destino en pasos de cada eje para una pose.
+    void jointSteps(const int32_t pose[], long steps[]);
+
+    //! Convierte 3 valores en um o mgrad a nm o ugrad.
+    /*!
+      \return false si algún valor está fuera del rango representable.
+    */
+    static bool toFixed(const float value[], int32_t out[]);
+
+    //! Coordenadas de los ejes (nm y ugrad) para una pose.
+    void jointValues(const int32_t pose[], int32_t joint[]);
+
+    //! Verifica la trayectoria hacia la pose destino e inicia el seguimiento de todos los ejes.
+    /*!
+      \return Tiempo total en segundos, o un valor negativo si fue rechazado.
+    */
+    float startMove(const int32_t target[], float iTimeSpeed, float iAccelTime);
+
+    //! Verifica si todos los ejes están en espera.
+    bool axisReady();
+
+    //! Detiene todos los ejes en el lugar y espera que abandonen el seguimiento.
+    void abort();
+
+    //! Envía los destinos del avance actual a todos los ejes.
+    /*!
+      \param iLast true para el destino final.
+      \return false si algún eje abandonó el seguimiento.
+    */
+    bool trackAll(bool iLast);
+};
+#endif
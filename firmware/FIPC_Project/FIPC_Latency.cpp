@@ -0,0 +1,119 @@
+/*! \file FIPC_Latency.cpp
+    \brief Medición de la latencia desde la recepción de un comando hasta el primer paso.
+*/
+
+#include "FIPC_Latency.h"
+
+FIPC_Latency::LatencyStage FIPC_Latency::_stage[LATENCY_STAGES];
+uint32_t FIPC_Latency::_time[PROBE_NUMBERS];
+volatile uint8_t FIPC_Latency::_next = PROBE_BYTE;
+portMUX_TYPE FIPC_Latency::_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Registra el instante de una sonda.
+// Fuera de su etapa solo compara: es el costo en exec() mientras no hay una medición.
+void FIPC_Latency::probe(Probe probe){
+  if( (probe!=_next)&&(probe!=PROBE_BYTE) ) return;
+  uint32_t now = micros();
+  portENTER_CRITICAL(&_mux);
+  uint8_t next = _next;
+  if( probe==PROBE_BYTE ){
+    // Abre una medición si no hay otra en curso o si la anterior quedó sin primer paso
+    if( (next==PROBE_BYTE)||(now-_time[PROBE_BYTE]>=LATENCY_TIMEOUT_US) ){
+      _time[PROBE_BYTE] = now;
+      _next = PROBE_LINE;
+    }
+  } else if( probe==next ){
+    _time[probe] = now;
+    FIPC_Latency::add(probe-1, now-_time[probe-1]);
+    if( probe==PROBE_STEP ){
+      FIPC_Latency::add(LATENCY_STAGES-1, now-_time[PROBE_BYTE]);
+      _next = PROBE_BYTE;
+    } else {
+      _next = probe+1;
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Descarta la medición si la solicitud no inició un desplazamiento.
+// Una medición que todavía espera la línea es de los bytes que llegaron mientras tanto.
+void FIPC_Latency::end(){
+  portENTER_CRITICAL(&_mux);
+  if( (_next==PROBE_PARSE)||(_next==PROBE_ACCEPT) ) _next = PROBE_BYTE;
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Descarta las mediciones acumuladas.
+void FIPC_Latency::clear(){
+  portENTER_CRITICAL(&_mux);
+  memset(_stage, 0, sizeof(_stage));
+  _next = PROBE_BYTE;
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Solicita un reporte de una etapa.
+void FIPC_Latency::getReport(uint8_t stage, FIPC_Text &out){
+  LatencyStage s;
+  memset(&s, 0, sizeof(s));
+  if( stage<LATENCY_STAGES ){
+    portENTER_CRITICAL(&_mux);
+    s = _stage[stage];
+    portEXIT_CRITICAL(&_mux);
+  }
+  out.add((unsigned long)s.count).add(';');
+  out.add((unsigned long)s.min).add(';');
+  out.add((unsigned long)(s.count ? s.sum/s.count : 0)).add(';');
+  out.add((unsigned long)s.max).add(';');
+  out.add((unsigned long)FIPC_Latency::percentile(s, 50)).add(';');
+  out.add((unsigned long)FIPC_Latency::percentile(s, 99));
+}
+
+// Solicita el histograma de una etapa.
+void FIPC_Latency::getHistogram(uint8_t stage, FIPC_Text &out){
+  LatencyStage s;
+  memset(&s, 0, sizeof(s));
+  if( stage<LATENCY_STAGES ){
+    portENTER_CRITICAL(&_mux);
+    s = _stage[stage];
+    portEXIT_CRITICAL(&_mux);
+  }
+  for( uint8_t i=0; i<LATENCY_BUCKETS; i++ ){
+    if( i ) out.add(';');
+    out.add((unsigned long)s.bucket[i]);
+  }
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Agrega una muestra a una etapa (dentro de la sección crítica).
+void FIPC_Latency::add(uint8_t stage, uint32_t elapsed){
+  LatencyStage &s = _stage[stage];
+  if( (s.count==0)||(elapsed<s.min) ) s.min = elapsed;
+  if( elapsed>s.max ) s.max = elapsed;
+  s.sum += elapsed;
+  s.count++;
+  uint8_t bucket = elapsed ? 31-__builtin_clz(elapsed) : 0;
+  s.bucket[(bucket<LATENCY_BUCKETS) ? bucket : LATENCY_BUCKETS-1]++;
+}
+
+// Estima un percentil con el histograma.
+uint32_t FIPC_Latency::percentile(const LatencyStage &s, uint8_t percent){
+  if( s.count==0 ) return 0;
+  uint32_t rank = ((uint64_t)s.count*percent+99)/100; // muestra del percentil, desde 1
+  uint32_t seen = 0;
+  for( uint8_t i=0; i<LATENCY_BUCKETS-1; i++ ){
+    seen += s.bucket[i];
+    if( seen>=rank ) return min((uint32_t)((2UL<<i)-1), s.max);
+  }
+  return s.max;
+}
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,146 @@
+/*! \file FIPC_Latency.h
+ *  \brief Medición de la latencia desde la recepción de un comando hasta el primer paso.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Latency_h
+#define FIPC_Latency_h
+
+#include "Arduino.h"
+#include "FIPC_Text.h"
+
+#ifndef LATENCY_ENABLED
+#define LATENCY_ENABLED 1 /*!< 1 registra las marcas de tiempo de las sondas, 0 las elimina de la compilación. */
+#endif
+
+#define LATENCY_STAGES     6       /*!< Etapas informadas: las 5 entre sondas consecutivas y el total. */
+#define LATENCY_BUCKETS    24      /*!< Intervalos del histograma: el n cuenta latencias de 2^n a 2^(n+1)-1 us. */
+#define LATENCY_TIMEOUT_US 1000000 /*!< Tiempo en us tras el cual se abandona una medición sin primer paso. */
+
+#if LATENCY_ENABLED
+#define LATENCY_PROBE(p) FIPC_Latency::probe(FIPC_Latency::p) /*!< Marca de tiempo de una sonda. */
+#define LATENCY_END()    FIPC_Latency::end()                  /*!< Fin de la interpretación de una solicitud. */
+#else
+#define LATENCY_PROBE(p) ((void)0)
+#define LATENCY_END()    ((void)0)
+#endif
+
+//!  Clase que mide la latencia desde la recepción de un comando hasta el primer paso.
+/*!
+ *   Las sondas se ubican en cada etapa del camino de un comando de desplazamiento:
+ *   \li PROBE_BYTE: llegan los primeros bytes de la línea. El driver del puerto serie los
+ *   entrega al llenarse su FIFO o al terminar la ráfaga, por lo que en líneas cortas la marca
+ *   es el final de la transmisión.
+ *   \li PROBE_LINE: la línea está completa y se entrega a FIPC_API::request().
+ *   \li PROBE_PARSE: los comandos de la línea están separados.
+ *   \li PROBE_ACCEPT: un eje aceptó el desplazamiento (FIPC_Axis::armAction()).
+ *   \li PROBE_PICKUP: exec() aplicó la acción (FIPC_Axis::commit()).
+ *   \li PROBE_STEP: el eje emitió el primer paso.
+ *
+ *   Se mide un comando a la vez: PROBE_BYTE abre una medición y cada sonda solo registra
+ *   su instante si la anterior ya lo hizo, por lo que el resto de las líneas que llegan
+ *   mientras tanto no se miden. Al terminar la solicitud sin un desplazamiento aceptado
+ *   (consultas, comandos rechazados) la medición se descarta, conservando las etapas de
+ *   recepción e interpretación. Una medición sin primer paso (acción retenida hasta el
+ *   disparo, desplazamiento nulo) se abandona luego de LATENCY_TIMEOUT_US.
+ *
+ *   Cada etapa acumula un histograma en escala logarítmica de LATENCY_BUCKETS intervalos,
+ *   con el mínimo, el máximo y la media, consultados con "?LAT:" y "?LATH:".
+ *
+ *   Las sondas se llaman desde ambos núcleos, por lo que el registro se hace en una sección
+ *   crítica; fuera de su etapa una sonda solo compara. Con LATENCY_ENABLED en 0 (ver
+ *   compilación con -DLATENCY_ENABLED=0) LATENCY_PROBE() no genera código y los reportes
+ *   quedan en cero.
+*/
+class FIPC_Latency
+{
+  public:
+    //! Sondas, en el orden en que se recorren.
+    typedef enum {PROBE_BYTE,   /*!< Primeros bytes de la línea. */
+                  PROBE_LINE,   /*!< Línea completa. */
+                  PROBE_PARSE,  /*!< Comandos separados. */
+                  PROBE_ACCEPT, /*!< Desplazamiento aceptado por un eje. */
+                  PROBE_PICKUP, /*!< Acción aplicada por exec(). */
+                  PROBE_STEP,   /*!< Primer paso emitido. */
+                  PROBE_NUMBERS /*!< Cantidad de sondas. */
+    }Probe;
+
+    //! Registra el instante de una sonda.
+    /*!
+      \param probe Sonda.
+    */
+    static void IRAM_ATTR probe(Probe probe);
+
+    //! Descarta la medición si la solicitud no inició un desplazamiento.
+    /*!
+      Debe llamarse al terminar de interpretar una solicitud.
+    */
+    static void end();
+
+    //! Descarta las mediciones acumuladas.
+    static void clear();
+
+    //! Solicita un reporte de una etapa.
+    /*!
+      \param stage Etapa: 0 a 4 desde la sonda del mismo número hasta la siguiente y 5 el total
+      desde PROBE_BYTE hasta PROBE_STEP.
+      \param out Texto donde se agrega "muestras;mínimo;media;máximo;p50;p99" en us. Los
+      percentiles son el límite superior del intervalo del histograma que los contiene.
+    */
+    static void getReport(uint8_t stage, FIPC_Text &out);
+
+    //! Solicita el histograma de una etapa.
+    /*!
+      \param stage Etapa (ver getReport()).
+      \param out Texto donde se agregan las LATENCY_BUCKETS cuentas separadas por ';'.
+    */
+    static void getHistogram(uint8_t stage, FIPC_Text &out);
+
+  private:
+    //! Acumulado de una etapa.
+    typedef struct{
+      uint32_t count;  /*!< Muestras. */
+      uint32_t min;    /*!< Mínimo en us. */
+      uint32_t max;    /*!< Máximo en us. */
+      uint64_t sum;    /*!< Suma en us. */
+      uint32_t bucket[LATENCY_BUCKETS]; /*!< Histograma. */
+    }LatencyStage;
+
+    static LatencyStage _stage[LATENCY_STAGES]; /*!< Acumulado de cada etapa. */
+
+    static uint32_t _time[PROBE_NUMBERS]; /*!< Instantes de la medición en curso en us. */
+
+    static volatile uint8_t _next; /*!< Próxima sonda de la medición en curso (PROBE_BYTE sin medición). */
+
+    static portMUX_TYPE _mux; /*!< Exclusión entre los núcleos. */
+
+    //! Agrega una muestra a una etapa.
+    /*!
+      \param stage Etapa.
+      \param elapsed Latencia en us.
+    */
+    static void IRAM_ATTR add(uint8_t stage, uint32_t elapsed);
+
+    //! Estima un percentil con el histograma.
+    /*!
+      \param s Acumulado de la etapa.
+      \param percent Percentil.
+      \return Límite superior en us del intervalo que lo contiene, acotado al máximo.
+    */
+    static uint32_t percentile(const LatencyStage &s, uint8_t percent);
+};
+#endif
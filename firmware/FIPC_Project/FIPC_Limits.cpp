@@ -0,0 +1,87 @@
+/*! \file FIPC_Limits.cpp
+    \brief Clase que supervisa los fines de carrera de los ejes.
+*/
+
+#include "FIPC_Limits.h"
+#include "FIPC_pinTable.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "soc/gpio_reg.h"
+#endif
+
+// Constructor.
+FIPC_Limits::FIPC_Limits(FIPC_Axis* pAxis[], uint8_t iAxisNumbers) {
+  _axisList = pAxis;
+  _axisNumbers = min(iAxisNumbers, (uint8_t)LIMITS_AXIS_NUMBERS);
+  for(uint8_t i = 0; i<LIMITS_AXIS_NUMBERS; i++){
+    _positive[i] = _negative[i] = 0;
+    _event[i] = false;
+  }
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura las máscaras de los fines de carrera de un eje.
+void FIPC_Limits::setMask(uint8_t id, uint64_t iPositive, uint64_t iNegative){
+  if( (id==0)||(id>_axisNumbers) ) return;
+  _positive[id-1] = iPositive;
+  _negative[id-1] = iNegative;
+  _mask = 0;
+  for(uint8_t i = 0; i<_axisNumbers; i++) _mask |= _positive[i]|_negative[i];
+}
+
+// Retorna los eventos de fin de carrera pendientes.
+void FIPC_Limits::getEvents(FIPC_Text &out){
+  for(uint8_t i = 0; i<_axisNumbers; i++){
+    if( !_event[i] ) continue;
+    out.add("LIMIT:").add(i+1).add(_eventPositive[i] ? ";+;" : ";-;");
+    out.add(_eventSteps[i]/_axisList[i]->getStepsPerUnit(),2).add('\n');
+    _event[i] = false;
+  }
+}
+
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+void FIPC_Limits::exec(){
+  if( _mask==0 ) return;
+  uint64_t pressed = ~FIPC_Limits::read() & _mask; // activos en bajo
+  if( pressed==0 ) return;
+
+  for(uint8_t i = 0; i<_axisNumbers; i++){
+    if( (pressed&_positive[i])&&(_axisList[i]->limitStop(true)) ){
+      _eventPositive[i] = true;
+      _eventSteps[i] = _axisList[i]->getCurrentSteps();
+      _event[i] = true;
+    }
+    if( (pressed&_negative[i])&&(_axisList[i]->limitStop(false)) ){
+      _eventPositive[i] = false;
+      _eventSteps[i] = _axisList[i]->getCurrentSteps();
+      _event[i] = true;
+    }
+  }
+}
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Lee todas las entradas.
+uint64_t FIPC_Limits::read(){
+#if defined(ARDUINO_ARCH_ESP32)
+  // GPIO_IN_REG contiene las GPIO 0 a 31 y GPIO_IN1_REG las GPIO 32 a 39
+  return ((uint64_t)REG_READ(GPIO_IN1_REG)<<32) | REG_READ(GPIO_IN_REG);
+#else
+  uint64_t out = 0;
+  for(uint8_t pin = 0; pin<64; pin++)
+    if( (_mask&PIN_MASK(pin))&&(digitalRead(pin)) ) out |= PIN_MASK(pin);
+  return out;
+#endif
+}
+
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,98 @@
+/*! \file FIPC_Limits.h
+ *  \brief Clase que supervisa los fines de carrera de los ejes.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Limits_h
+#define FIPC_Limits_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+
+#ifndef LIMITS_ENABLED
+#define LIMITS_ENABLED 1 /*!< 1 supervisa los fines de carrera de los ejes con CONFIG_LIMITS, con o sin el switch de referencia simulado. */
+#endif
+
+#define LIMITS_AXIS_NUMBERS 8 /*!< Cantidad máxima de ejes supervisados. */
+
+//!  Clase que supervisa los fines de carrera de los ejes.
+/*!
+ *   En cada ciclo de exec() lee todas las entradas con una única lectura de los
+ *   registros GPIO_IN_REG y GPIO_IN1_REG y la compara con la máscara de todos los
+ *   fines de carrera (switches activos en bajo). Solo si alguno está presionado
+ *   compara con las máscaras de cada eje, por lo que el costo por ciclo no depende
+ *   de la cantidad de ejes en movimiento.
+ *
+ *   Si un eje se desplaza hacia un fin de carrera presionado se detiene en el mismo
+ *   ciclo con la aceleración máxima (ver FIPC_Axis::limitStop()) y se registra un
+ *   evento "LIMIT:eje;sentido;posición" que se obtiene con getEvents().
+*/
+class FIPC_Limits
+{
+  public:
+
+    //! Constructor.
+    /*!
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista.
+     */
+    FIPC_Limits(FIPC_Axis* pAxis[], uint8_t iAxisNumbers);
+
+    //! Configura las máscaras de los fines de carrera de un eje.
+    /*!
+      \param id Identificador del eje.
+      \param iPositive Máscara del fin de carrera positivo (ver FIPC_pinTable.h).
+      \param iNegative Máscara del fin de carrera negativo.
+    */
+    void setMask(uint8_t id, uint64_t iPositive, uint64_t iNegative);
+
+    //! Supervisa los fines de carrera.
+    /*!
+     * Esta función deberá ser llamada recurrentemente en tiempo real, antes de exec() de los ejes.
+    */
+    void exec();
+
+    //! Retorna los eventos de fin de carrera pendientes.
+    /*!
+      \param out Texto donde se agrega una línea "LIMIT:eje;sentido;posición" por evento.
+    */
+    void getEvents(FIPC_Text &out);
+
+  private:
+    FIPC_Axis** _axisList; /*!< Lista de ejes del controlador. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes en la lista. */
+
+    uint64_t _mask = 0; /*!< Máscara de todos los fines de carrera. */
+
+    uint64_t _positive[LIMITS_AXIS_NUMBERS]; /*!< Máscara del fin de carrera positivo de cada eje. */
+
+    uint64_t _negative[LIMITS_AXIS_NUMBERS]; /*!< Máscara del fin de carrera negativo de cada eje. */
+
+    volatile bool _event[LIMITS_AXIS_NUMBERS]; /*!< Evento pendiente de cada eje. */
+
+    bool _eventPositive[LIMITS_AXIS_NUMBERS]; /*!< Sentido del evento de cada eje. */
+
+    long _eventSteps[LIMITS_AXIS_NUMBERS]; /*!< Posición en pasos al detectar el evento. */
+
+    //! Lee todas las entradas.
+    /*!
+      \return Un bit por GPIO (bit n = GPIO n).
+    */
+    uint64_t read();
+};
+#endif
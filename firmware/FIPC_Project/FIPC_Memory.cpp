@@ -0,0 +1,65 @@
+/*! \file FIPC_Memory.cpp
+    \brief Clase que informa el uso de memoria del controlador.
+*/
+
+#include "FIPC_Memory.h"
+
+#if !defined(ARDUINO_ARCH_ESP32)
+#include <assert.h>
+#include <new>
+
+static volatile uint32_t allocations = 0; /*!< Cantidad de reservas de memoria. */
+
+// Reemplazo del operador new para contar las reservas de memoria.
+void* operator new(size_t size){
+  allocations++;
+  void* p = malloc(size ? size : 1);
+  if( !p ) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t size){ return operator new(size);}
+void operator delete(void* p) noexcept { free(p);}
+void operator delete[](void* p) noexcept { free(p);}
+#endif
+
+// Constructor.
+FIPC_Memory::FIPC_Memory() {
+  for(uint8_t i = 0; i<MEMORY_TASK_NUMBERS; i++) _task[i] = NULL;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Registra una tarea.
+bool FIPC_Memory::addTask(void* pTask){
+  if( (pTask==NULL)||(_taskNumbers>=MEMORY_TASK_NUMBERS) ) return false;
+  _task[_taskNumbers++] = pTask;
+  return true;
+}
+
+// Solicita un reporte del uso de memoria.
+void FIPC_Memory::getReport(FIPC_Text &out){
+#if defined(ARDUINO_ARCH_ESP32)
+  out.add((unsigned long)ESP.getFreeHeap()).add(';').add((unsigned long)ESP.getMinFreeHeap());
+  for(uint8_t i = 0; i<_taskNumbers; i++)
+    out.add(';').add((unsigned long)uxTaskGetStackHighWaterMark((TaskHandle_t)_task[i]));
+#else
+  out.add("0;0");
+  for(uint8_t i = 0; i<_taskNumbers; i++) out.add(";0");
+#endif
+}
+
+#if !defined(ARDUINO_ARCH_ESP32)
+// Retorna la cantidad de reservas de memoria realizadas.
+uint32_t FIPC_Memory::getAllocations(){ return allocations;}
+
+// Verifica que no hubo reservas de memoria.
+void FIPC_Memory::checkAllocations(uint32_t iAllocations){
+  assert(allocations==iAllocations);
+  (void) iAllocations;
+}
+#endif
+
+/* End: Public                            */
+/******************************************/
@@ -0,0 +1,79 @@
+/*! \file FIPC_Memory.h
+ *  \brief Clase que informa el uso de memoria del controlador.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Memory_h
+#define FIPC_Memory_h
+
+#include "Arduino.h"
+#include "FIPC_Text.h"
+
+#define MEMORY_TASK_NUMBERS 5 /*!< Cantidad máxima de tareas supervisadas. */
+
+//!  Clase que informa el uso de memoria del controlador.
+/*!
+ *   Todos los objetos del controlador se ubican estáticamente y no se reserva
+ *   memoria dinámica luego de setup(). Esta clase informa el heap libre, el
+ *   mínimo histórico de heap libre y la marca de agua de la pila de cada tarea
+ *   registrada, es decir, la menor cantidad de bytes de pila que quedaron libres.
+ *
+ *   \par Compilación para PC
+ *   Fuera del ESP32 se reemplaza el operador new para contar las reservas de
+ *   memoria; checkAllocations() verifica con assert() que una sección no reservó
+ *   memoria. En el ESP32 la verificación no genera código.
+*/
+class FIPC_Memory
+{
+  public:
+    //! Constructor.
+    FIPC_Memory();
+
+    //! Registra una tarea para informar su marca de agua de pila.
+    /*!
+      \param pTask Handle de la tarea de FreeRTOS.
+      \return true si la tarea fue registrada.
+    */
+    bool addTask(void* pTask);
+
+    //! Solicita un reporte del uso de memoria.
+    /*!
+      \param out Texto donde se agrega "heap libre;mínimo heap libre" seguido de
+      la pila libre mínima en bytes de cada tarea en el orden de registro.
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Retorna la cantidad de reservas de memoria realizadas (0 en el ESP32).
+    static uint32_t getAllocations();
+
+    //! Verifica que no hubo reservas de memoria desde getAllocations().
+    /*!
+      \param iAllocations Valor retornado por getAllocations() al inicio de la sección.
+    */
+    static void checkAllocations(uint32_t iAllocations);
+
+  private:
+    void* _task[MEMORY_TASK_NUMBERS]; /*!< Tareas registradas. */
+
+    uint8_t _taskNumbers = 0; /*!< Cantidad de tareas registradas. */
+};
+
+#if defined(ARDUINO_ARCH_ESP32)
+inline uint32_t FIPC_Memory::getAllocations(){ return 0;}
+inline void FIPC_Memory::checkAllocations(uint32_t iAllocations){ (void) iAllocations;}
+#endif
+#endif
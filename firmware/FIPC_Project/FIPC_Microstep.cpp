@@ -0,0 +1,142 @@
+/*! \file FIPC_Microstep.cpp
+    \brief Cambio de la resolución de micropasos del DRV8825 durante un desplazamiento.
+*/
+
+#include "FIPC_Microstep.h"
+
+// Constructor.
+FIPC_Microstep::FIPC_Microstep(){
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura las GPIO de las entradas de modo.
+void FIPC_GpioStepMode::begin(const uint8_t pins[MICROSTEP_PINS]){
+  for(uint8_t i = 0; i<MICROSTEP_PINS; i++){
+    _pins[i] = pins[i];
+    if( _pins[i]!=MICROSTEP_NONE ) pinMode(_pins[i], OUTPUT);
+  }
+}
+
+// Escribe el modo en binario en MODE0..MODE2.
+void FIPC_GpioStepMode::set(uint8_t mode){
+  for(uint8_t i = 0; i<MICROSTEP_PINS; i++)
+    if( _pins[i]!=MICROSTEP_NONE ) digitalWrite(_pins[i], ((mode>>i)&1) ? HIGH : LOW);
+}
+
+// Configura los modos.
+bool FIPC_Microstep::begin(FIPC_StepMode* pMode, uint8_t fine, uint8_t coarse){
+  _running = false;
+  _coarseOn = false;
+  _switches = 0;
+  if( (pMode==NULL)||(fine>MICROSTEP_MODE_MAX)||(coarse>=fine) ) return false;
+  _mode = pMode;
+  _fine = fine;
+  _coarse = coarse;
+  _ratio = 1L<<(fine-coarse);
+  _full = 1L<<fine;
+  _mode->set(_fine);
+  return true;
+}
+
+// Inicia un desplazamiento.
+// Siempre comienza en el modo fino: el origen puede no estar en una posición de paso completo.
+bool FIPC_Microstep::start(long position, long target, long origin, float speed, float accel, unsigned long now){
+  _running = false;
+  if( (_mode==NULL)||(target==position)||!(speed>0.0)||!(accel>0.0) ) return false;
+  if( _coarseOn ) FIPC_Microstep::setCoarse(false);
+  _position = position;
+  _target = target;
+  _origin = origin;
+  _dir = (target>position) ? 1 : -1;
+  _speed = 0.0;
+  _maxSpeed = speed;
+  _accel = accel;
+  FIPC_Microstep::setApproach();
+  _next = now;
+  _fraction = 0.0;
+  _running = true;
+  return true;
+}
+
+// Inicia la desaceleración.
+// En el modo grueso el destino no puede quedar antes de la próxima posición de paso
+// completo, donde se vuelve al modo fino.
+void FIPC_Microstep::stop(float accel){
+  if( !_running ) return;
+  if( accel>_accel ){
+    _accel = accel;
+    FIPC_Microstep::setApproach();
+  }
+  long brake = (long)(_speed*_speed/(2.0*_accel))+1;
+  if( _coarseOn ){
+    long toAligned = (-(_position-_origin)*_dir)&(_full-1);
+    if( brake<toAligned ) brake = toAligned;
+  }
+  if( brake<(_target-_position)*_dir ) _target = _position+_dir*brake;
+}
+
+// Ejecuta un ciclo del desplazamiento.
+bool FIPC_Microstep::run(unsigned long now, bool &oStep){
+  oStep = false;
+  if( !_running ) return false;
+  if( (long)(now-_next)<0 ) return true;
+  long remaining = (_target-_position)*_dir;
+  if( remaining<=0 ){
+    if( _coarseOn ) FIPC_Microstep::setCoarse(false);
+    _running = false;
+    return false;
+  }
+
+  // Cambio de modo solo en posiciones de paso completo de la tabla del driver
+  if( ((_position-_origin)&(_full-1))==0 ){
+    if( _coarseOn ){
+      if( remaining<_approach+_full ) FIPC_Microstep::setCoarse(false);
+    } else if( (_speed>=MICROSTEP_SWITCH_RATE)&&(remaining>=_approach+_full) ){
+      FIPC_Microstep::setCoarse(true);
+    }
+  }
+
+  // Velocidad al final del pulso: acelera hasta el crucero sin superar la que permite frenar en el destino
+  long u = (_coarseOn) ? _ratio : 1;
+  float up = sqrtf(_speed*_speed + 2.0*_accel*u);
+  if( up>_maxSpeed ) up = _maxSpeed;
+  float brake = sqrtf(2.0*_accel*(remaining-u));
+  float speed = (up<brake) ? up : brake;
+  float mean = 0.5*(_speed+speed);
+  float least = 0.5*sqrtf(_accel*u); // pulso aislado desde el reposo hasta el reposo
+  if( mean<least ) mean = least;
+  float exact = u*1e6/mean + _fraction; // la fracción de us se acumula: el crucero no adelanta
+  unsigned long interval = (unsigned long)exact;
+  _fraction = exact-interval;
+
+  _position += _dir*u;
+  _speed = speed;
+  // Con un atraso mayor a un intervalo se reprograma desde el ciclo actual (sin ráfagas)
+  _next = (now-_next>interval) ? now+interval : _next+interval;
+  oStep = true;
+  return true;
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Calcula la aproximación final: distancia de frenado desde MICROSTEP_SWITCH_RATE.
+void FIPC_Microstep::setApproach(){
+  float v = (_maxSpeed<MICROSTEP_SWITCH_RATE) ? _maxSpeed : MICROSTEP_SWITCH_RATE;
+  _approach = (long)(v*v/(2.0*_accel))+1;
+}
+
+// Cambia el modo.
+void FIPC_Microstep::setCoarse(bool coarse){
+  _coarseOn = coarse;
+  _mode->set((coarse) ? _coarse : _fine);
+  _switches++;
+}
+/* End: Private                           */
+/******************************************/
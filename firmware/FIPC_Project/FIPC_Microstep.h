@@ -0,0 +1,188 @@
+/*! \file FIPC_Microstep.h
+ *  \brief Cambio de la resolución de micropasos del DRV8825 durante un desplazamiento.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Microstep_h
+#define FIPC_Microstep_h
+
+#include "Arduino.h"
+
+#define MICROSTEP_PINS        3      /*!< Entradas MODE0, MODE1 y MODE2 del DRV8825. */
+#define MICROSTEP_NONE        0xFF   /*!< GPIO sin asignar. */
+#define MICROSTEP_MODE_MAX    5      /*!< Mayor modo del DRV8825 (1/32 de paso). */
+#define MICROSTEP_SWITCH_RATE 6000.0 /*!< Frecuencia de pasos finos en pasos/s a partir de la cual se pasa a pasos gruesos. */
+#define MICROSTEP_PULSE_US    2      /*!< Duración del pulso en alto en us (el DRV8825 requiere 1,9 us). */
+
+//!  Interfaz de las entradas de modo de micropasos del driver.
+/*!
+ *   El modo es el logaritmo en base 2 de los micropasos por paso completo, igual que el
+ *   valor binario de MODE2..MODE0 del DRV8825: 0 paso completo, 1 medio paso, ... 5 1/32.
+ *   FIPC_Microstep solo utiliza esta interfaz, por lo que los cambios de modo pueden
+ *   verificarse en el host reemplazando las GPIO (ver FIPC_Axis::setStepMode()).
+*/
+class FIPC_StepMode
+{
+  public:
+    //! Selecciona el modo de micropasos.
+    /*!
+      El driver lo aplica desde el próximo flanco ascendente del pulso de paso.
+      \param mode Modo (0 a MICROSTEP_MODE_MAX).
+    */
+    virtual void set(uint8_t mode) = 0;
+};
+
+
+//!  Entradas de modo de micropasos en GPIO.
+class FIPC_GpioStepMode : public FIPC_StepMode
+{
+  public:
+    //! Configura las GPIO.
+    /*!
+      \param pins GPIO de MODE0, MODE1 y MODE2 (MICROSTEP_NONE en las que tienen un nivel fijo).
+    */
+    void begin(const uint8_t pins[MICROSTEP_PINS]);
+
+    void set(uint8_t mode);
+
+  private:
+    uint8_t _pins[MICROSTEP_PINS] = {MICROSTEP_NONE, MICROSTEP_NONE, MICROSTEP_NONE}; /*!< GPIO de MODE0..MODE2. */
+};
+
+
+//!  Clase que genera un desplazamiento cambiando la resolución de micropasos.
+/*!
+ *   Generación por software de los desplazamientos de FIPC_Axis con la opción
+ *   CONFIG_MICROSTEP de FIPC_Config. La posición se lleva siempre en pasos del modo fino (el
+ *   de FIPC_Config::AxisConfig::stepsPerUnit); en el modo grueso cada pulso avanza 2^(fino-grueso)
+ *   pasos finos, por lo que la velocidad ya no está limitada por la frecuencia de exec() sino
+ *   por esa relación.
+ *
+ *   \par Perfil
+ *   Trapezoidal en pasos finos, calculado pulso a pulso a partir de la velocidad: cada pulso
+ *   de u pasos finos acelera hasta sqrt(v^2+2au), limitado por la velocidad de crucero y por
+ *   la que permite frenar en el destino, y dura u dividido la velocidad media del pulso. El
+ *   instante de cada pulso se programa desde el anterior, no desde el ciclo en que se emitió.
+ *
+ *   \par Cambio de modo
+ *   El DRV8825 aplica un nuevo modo en el próximo paso avanzando al estado válido más cercano
+ *   de su tabla, por lo que un cambio fuera de una posición de paso completo perdería
+ *   micropasos. Los cambios se hacen solo en posiciones múltiplo de un paso completo contadas
+ *   desde el origen de la tabla del driver (ver start()):
+ *   \li Fino a grueso al superar MICROSTEP_SWITCH_RATE pasos finos/s.
+ *   \li Grueso a fino al quedar menos que la distancia de frenado desde MICROSTEP_SWITCH_RATE
+ *   más un paso completo, de modo que la aproximación final siempre se hace en pasos finos.
+ *   Los desplazamientos lentos se hacen enteramente en el modo fino.
+*/
+class FIPC_Microstep
+{
+  public:
+    //! Constructor.
+    FIPC_Microstep();
+
+    //! Configura los modos.
+    /*!
+      Selecciona el modo fino.
+      \param pMode Entradas de modo del driver.
+      \param fine Modo fino, el de la posición.
+      \param coarse Modo grueso del crucero (menor que fine).
+      \return false si los modos no son válidos.
+    */
+    bool begin(FIPC_StepMode* pMode, uint8_t fine, uint8_t coarse);
+
+    //! Inicia un desplazamiento.
+    /*!
+      \param position Posición actual en pasos finos.
+      \param target Destino en pasos finos.
+      \param origin Posición en pasos finos de un estado de paso completo de la tabla del driver.
+      \param speed Velocidad de crucero en pasos finos/s.
+      \param accel Aceleración en pasos finos/s^2.
+      \param now Instante actual en us.
+      \return false si no hay desplazamiento.
+    */
+    bool start(long position, long target, long origin, float speed, float accel, unsigned long now);
+
+    //! Inicia la desaceleración.
+    /*!
+      \param accel Aceleración de frenado en pasos finos/s^2, si es 0 o menor que la del desplazamiento se utiliza esta.
+    */
+    void stop(float accel = 0.0);
+
+    //! Ejecuta un ciclo del desplazamiento.
+    /*!
+      \param now Instante actual en us.
+      \param oStep true si debe emitirse un pulso de paso (la posición ya lo incluye).
+      \return false cuando terminó el desplazamiento.
+    */
+    bool run(unsigned long now, bool &oStep);
+
+    //! Retorna la posición en pasos finos.
+    long getPosition() { return _position; }
+
+    //! Retorna el modo actual.
+    uint8_t getMode() { return (_coarseOn) ? _coarse : _fine; }
+
+    //! Retorna la cantidad de cambios de modo desde begin().
+    uint32_t getSwitches() { return _switches; }
+
+  private:
+    FIPC_StepMode* _mode = NULL; /*!< Entradas de modo del driver. */
+
+    uint8_t _fine = 0; /*!< Modo fino. */
+
+    uint8_t _coarse = 0; /*!< Modo grueso. */
+
+    long _ratio = 1; /*!< Pasos finos por pulso en el modo grueso. */
+
+    long _full = 1; /*!< Pasos finos por paso completo. */
+
+    bool _coarseOn = false; /*!< Se emiten pulsos en el modo grueso. */
+
+    bool _running = false; /*!< Desplazamiento en curso. */
+
+    long _position = 0; /*!< Posición en pasos finos. */
+
+    long _target = 0; /*!< Destino en pasos finos. */
+
+    long _origin = 0; /*!< Posición de un estado de paso completo del driver. */
+
+    long _dir = 1; /*!< Sentido del desplazamiento (1 o -1). */
+
+    float _speed = 0.0; /*!< Velocidad luego del último pulso en pasos finos/s. */
+
+    float _maxSpeed = 0.0; /*!< Velocidad de crucero en pasos finos/s. */
+
+    float _accel = 0.0; /*!< Aceleración en pasos finos/s^2. */
+
+    long _approach = 0; /*!< Pasos finos de la aproximación final. */
+
+    unsigned long _next = 0; /*!< Instante en us del próximo pulso. */
+
+    float _fraction = 0.0; /*!< Fracción de us del instante del próximo pulso. */
+
+    uint32_t _switches = 0; /*!< Cambios de modo. */
+
+    //! Calcula la aproximación final para la aceleración actual.
+    void setApproach();
+
+    //! Cambia el modo.
+    /*!
+      \param coarse true para el modo grueso.
+    */
+    void setCoarse(bool coarse);
+};
+#endif
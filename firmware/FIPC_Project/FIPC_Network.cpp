@@ -0,0 +1,189 @@
+/*! \file FIPC_Network.cpp
+    \brief Comandos, eventos y telemetría por la red.
+*/
+
+#include "FIPC_Network.h"
+#include "FIPC_Memory.h"
+
+// Constructor.
+FIPC_Network::FIPC_Network(FIPC_API* pApi, FIPC_Transport* pTransport) :
+  _out(_outBuffer, sizeof(_outBuffer)),
+  _frame(_frameBuffer, sizeof(_frameBuffer)) {
+  _api = pApi;
+  _transport = pTransport;
+  memset(_client, 0, sizeof(_client));
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Comienza a aceptar conexiones.
+bool FIPC_Network::begin(uint16_t port){
+  return _transport->begin(port);
+}
+
+// Atiende las conexiones.
+void FIPC_Network::service(){
+  uint32_t allocations = FIPC_Memory::getAllocations();
+  int8_t id;
+  while( (id = _transport->incoming())>=0 ){
+    memset(&_client[id], 0, sizeof(Client));
+    _client[id].open = true;
+  }
+
+  FIPC_Network::telemetry();
+  for( uint8_t i=0; i<TRANSPORT_CLIENTS; i++ ){
+    if( !_client[i].open ) continue;
+    FIPC_Network::flush(i);
+    if( _client[i].open ) FIPC_Network::receive(i);
+    if( _client[i].open ) FIPC_Network::flush(i);
+  }
+  FIPC_Memory::checkAllocations(allocations);
+}
+
+// Publica eventos a las conexiones suscriptas.
+// Cada línea se envía con el prefijo '!' y se descarta completa si no hay lugar.
+void FIPC_Network::publish(const char* events){
+  while( *events ){
+    const char* end = strchr(events, '\n');
+    uint16_t size = end ? end-events+1 : strlen(events);
+    for( uint8_t i=0; i<TRANSPORT_CLIENTS; i++ ){
+      if( (!_client[i].open)||(!(_client[i].subscribe&NET_SUB_EVENTS)) ) continue;
+      if( (NET_TX_SIZE-_client[i].txSize<size+2)||(!FIPC_Network::queue(i, "!", 1)) ){
+        _dropped++;
+        continue;
+      }
+      FIPC_Network::queue(i, events, size);
+      if( events[size-1]!='\n' ) FIPC_Network::queue(i, "\n", 1);
+    }
+    events += size;
+  }
+}
+
+// Solicita un reporte del estado de la red.
+void FIPC_Network::getReport(FIPC_Text &out){
+  uint8_t clients = 0;
+  for( uint8_t i=0; i<TRANSPORT_CLIENTS; i++ ) if( _client[i].open ) clients++;
+  out.add((unsigned int)clients).add(';').add((unsigned long)_sent).add(';').add((unsigned long)_dropped);
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Interpreta las líneas recibidas de una conexión.
+// Igual que en el puerto serie, una línea que llena el buffer se interpreta sin esperar el '\n'.
+// Solo se interpreta si hay lugar para la respuesta: el resto queda en el buffer del transporte.
+void FIPC_Network::receive(uint8_t id){
+  Client &c = _client[id];
+  for( uint8_t lines=0; lines<NET_LINES; ){
+    char* end = (char*)memchr(c.line, '\n', c.lineSize);
+    if( (end==NULL)&&(c.lineSize<API_REQUEST_SIZE-1) ){
+      int16_t n = _transport->receive(id, c.line+c.lineSize, API_REQUEST_SIZE-1-c.lineSize);
+      if( n<0 ){
+        FIPC_Network::close(id);
+        return;
+      }
+      if( n==0 ) return;
+      if( c.lineSize==0 ) LATENCY_PROBE(PROBE_BYTE);
+      c.lineSize += n;
+      continue;
+    }
+    if( NET_TX_SIZE-c.txSize<API_OUTPUT_SIZE+2 ) return;
+
+    uint16_t size = end ? end-c.line : c.lineSize;
+    memcpy(_line, c.line, size);
+    while( (size>0)&&(_line[size-1]=='\r') ) size--;
+    _line[size] = '\0';
+    uint16_t used = end ? end-c.line+1 : c.lineSize;
+    c.lineSize -= used;
+    memmove(c.line, c.line+used, c.lineSize);
+    if( size>0 ){
+      LATENCY_PROBE(PROBE_LINE);
+      FIPC_Network::command(id, _line);
+    }
+    lines++;
+  }
+}
+
+// Interpreta una línea.
+// Los comandos de la API se registran como los del puerto serie (ver FIPC_Recorder).
+void FIPC_Network::command(uint8_t id, char* line){
+  Client &c = _client[id];
+  FIPC_Text &out = _out.clear();
+  const char* reply = out.c_str();
+  if( !strncmp(line, NET_SUBSCRIBE ":", strlen(NET_SUBSCRIBE)+1) ){
+    char* mask = line+strlen(NET_SUBSCRIBE)+1;
+    char* period = strchr(mask, ':');
+    c.subscribe = atoi(mask)&(NET_SUB_EVENTS|NET_SUB_TELEMETRY);
+    c.period = max(period ? atoi(period+1) : 0, NET_PERIOD_MIN);
+    c.last = millis();
+    out.add((unsigned int)c.subscribe).add(';').add((unsigned int)c.period).add('\n');
+  }
+  else if( !strncmp(line, NET_Q_STATUS ":", strlen(NET_Q_STATUS)+1) ){
+    FIPC_Network::getReport(out);
+    out.add('\n');
+  }
+  else reply = _api->request(line);
+  FIPC_Network::queue(id, reply, strlen(reply));
+  FIPC_Network::queue(id, ">\n", 2);
+}
+
+// Envía la telemetría a las conexiones suscriptas cuyo período venció.
+// La trama se arma una sola vez para todas las conexiones.
+void FIPC_Network::telemetry(){
+  unsigned long now = millis();
+  bool built = false;
+  for( uint8_t i=0; i<TRANSPORT_CLIENTS; i++ ){
+    Client &c = _client[i];
+    if( (!c.open)||(!(c.subscribe&NET_SUB_TELEMETRY))||(now-c.last<c.period) ) continue;
+    c.last = now;
+    if( !built ){
+      _frame.clear().add("!TEL:").add(now).add(';');
+      _api->getTelemetry(_frame);
+      _frame.add('\n');
+      built = true;
+    }
+    if( !FIPC_Network::queue(i, _frame.c_str(), _frame.length()) ) _dropped++;
+  }
+}
+
+// Agrega datos al buffer de envío.
+bool FIPC_Network::queue(uint8_t id, const char* data, uint16_t size){
+  Client &c = _client[id];
+  if( NET_TX_SIZE-c.txSize<size ) return false;
+  uint16_t tail = (c.txHead+c.txSize)%NET_TX_SIZE;
+  uint16_t first = min(size, (uint16_t)(NET_TX_SIZE-tail));
+  memcpy(c.tx+tail, data, first);
+  memcpy(c.tx, data+first, size-first);
+  c.txSize += size;
+  return true;
+}
+
+// Envía lo que admita el transporte del buffer de envío.
+void FIPC_Network::flush(uint8_t id){
+  Client &c = _client[id];
+  while( c.txSize>0 ){
+    uint16_t size = min(c.txSize, (uint16_t)(NET_TX_SIZE-c.txHead));
+    int16_t n = _transport->transmit(id, c.tx+c.txHead, size);
+    if( n<0 ){
+      FIPC_Network::close(id);
+      return;
+    }
+    if( n==0 ) return;
+    c.txHead = (c.txHead+n)%NET_TX_SIZE;
+    c.txSize -= n;
+    _sent += n;
+  }
+}
+
+// Cierra una conexión.
+void FIPC_Network::close(uint8_t id){
+  _transport->release(id);
+  _client[id].open = false;
+}
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,156 @@
+/*! \file FIPC_Network.h
+ *  \brief Clase que atiende comandos y publica eventos y telemetría por la red.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Network_h
+#define FIPC_Network_h
+
+#include "Arduino.h"
+#include "FIPC_API.h"
+#include "FIPC_Transport.h"
+#include "FIPC_Text.h"
+
+#define NET_PORT            5025 /*!< Puerto por defecto. */
+#define NET_TX_SIZE         4096 /*!< Buffer de envío de cada conexión en bytes. */
+#define NET_LINES           4    /*!< Comandos atendidos como máximo por conexión en cada llamada a service(). */
+#define NET_TELEMETRY_SIZE  128  /*!< Tamaño de una trama de telemetría. */
+#define NET_PERIOD_MIN      1    /*!< Período mínimo de la telemetría en ms. */
+
+#define NET_SUB_EVENTS      0x01 /*!< Suscripción a los eventos asincrónicos. */
+#define NET_SUB_TELEMETRY   0x02 /*!< Suscripción a la telemetría periódica. */
+
+#define NET_SUBSCRIBE       "NETSUB" /*!< Suscripción de la conexión (máscara y período de la telemetría en ms). */
+#define NET_Q_STATUS        "?NET"   /*!< Solicitud. Estado de la red ("conexiones;bytes enviados;tramas descartadas"). */
+
+//!  Clase que atiende comandos y publica eventos y telemetría por la red.
+/*!
+ *   Cada conexión del transporte (ver FIPC_Transport) envía listas de comandos terminadas
+ *   en '\\n', que se interpretan con FIPC_API::request() igual que las del puerto serie.
+ *   Se atienden hasta TRANSPORT_CLIENTS conexiones simultáneas, cada una con su buffer
+ *   de envío y sus suscripciones.
+ *
+ *   \par Protocolo
+ *   \li La respuesta de cada línea se envía completa y termina con la línea ">".
+ *   \li Las líneas asincrónicas comienzan con '!': eventos ("!LIMIT:1;1;1234", ver
+ *   FIPC_API::getEvents()) y telemetría ("!TEL:ms;posición de cada eje;máscara de ejes en
+ *   movimiento"). Nunca se intercalan dentro de una respuesta.
+ *   \li <b>"NETSUB:3:10:"</b> suscribe la conexión a eventos (0x01) y a telemetría (0x02)
+ *   cada 10 ms. <b>"?NET:"</b> informa "conexiones;bytes enviados;tramas descartadas".
+ *   Estos comandos se atienden en esta clase y deben enviarse solos en la línea.
+ *
+ *   \par Control de flujo
+ *   Una línea se interpreta solo si el buffer de envío de la conexión tiene lugar para la
+ *   respuesta más larga (API_OUTPUT_SIZE): un cliente que no lee deja de ser atendido y el
+ *   TCP detiene su envío, sin afectar al resto. Las tramas de telemetría y los eventos que
+ *   no entran en el buffer se descartan completos y se cuentan.
+ *
+ *   service() debe llamarse periódicamente desde una tarea del núcleo 0 con el semáforo
+ *   que protege FIPC_API::request(), al igual que publish().
+*/
+class FIPC_Network
+{
+  public:
+    //! Constructor.
+    /*!
+      \param pApi API que interpreta los comandos.
+      \param pTransport Transporte de las conexiones.
+    */
+    FIPC_Network(FIPC_API* pApi, FIPC_Transport* pTransport);
+
+    //! Comienza a aceptar conexiones.
+    /*!
+      \param port Puerto.
+      \return true si el transporte pudo abrir el puerto.
+    */
+    bool begin(uint16_t port = NET_PORT);
+
+    //! Atiende las conexiones.
+    /*!
+      Acepta conexiones, interpreta los comandos recibidos, envía la telemetría y vacía
+      los buffers de envío.
+    */
+    void service();
+
+    //! Publica eventos a las conexiones suscriptas.
+    /*!
+      \param events Texto con los eventos (ver FIPC_API::getEvents()).
+    */
+    void publish(const char* events);
+
+    //! Solicita un reporte del estado de la red.
+    /*!
+      \param out Texto donde se agrega "conexiones;bytes enviados;tramas descartadas".
+    */
+    void getReport(FIPC_Text &out);
+
+  private:
+    //! Estado de una conexión.
+    typedef struct{
+      bool     open;                   /*!< Conexión abierta. */
+      uint8_t  subscribe;              /*!< Suscripciones NET_SUB_EVENTS y NET_SUB_TELEMETRY. */
+      uint16_t period;                 /*!< Período de la telemetría en ms. */
+      unsigned long last;              /*!< Instante en ms de la última trama de telemetría. */
+      char     line[API_REQUEST_SIZE]; /*!< Bytes recibidos. */
+      uint16_t lineSize;               /*!< Cantidad de bytes recibidos. */
+      char     tx[NET_TX_SIZE];        /*!< Buffer circular de envío. */
+      uint16_t txHead;                 /*!< Primer byte a enviar. */
+      uint16_t txSize;                 /*!< Bytes a enviar. */
+    }Client;
+
+    FIPC_API* _api; /*!< API que interpreta los comandos. */
+
+    FIPC_Transport* _transport; /*!< Transporte de las conexiones. */
+
+    Client _client[TRANSPORT_CLIENTS]; /*!< Conexiones. */
+
+    char _line[API_REQUEST_SIZE]; /*!< Línea en interpretación. */
+
+    char _outBuffer[API_OUTPUT_SIZE]; /*!< Buffer de las respuestas. */
+
+    FIPC_Text _out; /*!< Respuesta en construcción. */
+
+    char _frameBuffer[NET_TELEMETRY_SIZE]; /*!< Buffer de la trama de telemetría. */
+
+    FIPC_Text _frame; /*!< Trama de telemetría. */
+
+    uint32_t _sent = 0; /*!< Bytes enviados. */
+
+    uint32_t _dropped = 0; /*!< Tramas descartadas. */
+
+    //! Interpreta las líneas recibidas de una conexión.
+    void receive(uint8_t id);
+
+    //! Interpreta una línea.
+    void command(uint8_t id, char* line);
+
+    //! Envía la telemetría a las conexiones suscriptas cuyo período venció.
+    void telemetry();
+
+    //! Agrega datos al buffer de envío.
+    /*!
+      \return false si no entran completos (no se agrega nada).
+    */
+    bool queue(uint8_t id, const char* data, uint16_t size);
+
+    //! Envía lo que admita el transporte del buffer de envío.
+    void flush(uint8_t id);
+
+    //! Cierra una conexión.
+    void close(uint8_t id);
+};
+#endif
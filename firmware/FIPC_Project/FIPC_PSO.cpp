@@ -0,0 +1,114 @@
+/*! \file FIPC_PSO.cpp
+    \brief Clase que implementa la salida sincronizada con la posición (PSO).
+*/
+
+#include "FIPC_PSO.h"
+
+#define NO_PIN 0xFF /*!< Identificador de GPIO sin asignar. */
+
+// Constructor.
+FIPC_PSO::FIPC_PSO() {
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura la salida.
+void FIPC_PSO::setOutput(uint8_t pin, uint8_t mode){
+  _pin = pin;
+  _mode = (mode==OUT_TOGGLE) ? OUT_TOGGLE : OUT_PULSE;
+  _level = false;
+  if( _pin!=NO_PIN ){
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+  }
+}
+
+// Programa posiciones equiespaciadas.
+bool FIPC_PSO::armPitch(float start, float pitch, uint32_t count){
+  if( (count==0)||((pitch==0.0)&&(count>1)) ) return false;
+  _armed = false;
+  _useTable = false;
+  _start = start;
+  _pitch = pitch;
+  _k = 0;
+  _next = lroundf(start);
+  _sense = (pitch<0) ? -1 : 1;
+  _remaining = count;
+  _fired = 0;
+  _maxError = 0;
+  _armed = true;
+  return true;
+}
+
+// Agrega una posición a la tabla.
+bool FIPC_PSO::addTable(long position){
+  if( (_armed)||(_tableSize>=PSO_TABLE_SIZE) ) return false;
+  _table[_tableSize++] = position;
+  return true;
+}
+
+// Habilita la comparación con la tabla cargada.
+bool FIPC_PSO::armTable(){
+  if( _tableSize==0 ) return false;
+
+  // La tabla debe ser monótona en el sentido del desplazamiento
+  _sense = ((_tableSize>1)&&(_table[1]<_table[0])) ? -1 : 1;
+  for(uint16_t i = 1; i<_tableSize; i++)
+    if( (_table[i]-_table[i-1])*_sense<=0 ) return false;
+
+  _useTable = true;
+  _tableIndex = 0;
+  _next = _table[0];
+  _remaining = _tableSize;
+  _fired = 0;
+  _maxError = 0;
+  _armed = true;
+  return true;
+}
+
+// Deshabilita la comparación y borra la tabla.
+void FIPC_PSO::disarm(){
+  _armed = false;
+  _tableSize = 0;
+  _remaining = 0;
+}
+
+// Solicita un reporte.
+void FIPC_PSO::getReport(FIPC_Text &out){
+  out.add((_armed) ? "1" : "0");
+  out.add(';').add((unsigned long)_fired);
+  out.add(';').add((unsigned long)_remaining);
+  out.add(';').add(_maxError);
+}
+
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+void FIPC_PSO::check(long position){
+  // Fin del pulso del ciclo anterior
+  if( (_mode==OUT_PULSE)&&(_level) ){
+    digitalWrite(_pin, LOW);
+    _level = false;
+  }
+  if( !_armed ) return;
+  if( (position-_next)*_sense<0 ) return; // todavía no alcanzó la posición
+
+  if( _pin!=NO_PIN ){
+    _level = !_level;
+    digitalWrite(_pin, _level ? HIGH : LOW);
+  }
+  long error = (position-_next)*_sense;
+  if( error>_maxError ) _maxError = error;
+  _fired++;
+
+  if( --_remaining==0 ){
+    _armed = false;
+    return;
+  }
+  if( _useTable ) _next = _table[++_tableIndex];
+  else            _next = lroundf(_start + (++_k)*_pitch);
+}
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+
+/* End: Public                            */
+/******************************************/
@@ -0,0 +1,135 @@
+/*! \file FIPC_PSO.h
+ *  \brief Clase que implementa la salida sincronizada con la posición (PSO).
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_PSO_h
+#define FIPC_PSO_h
+
+#include "Arduino.h"
+#include "FIPC_Text.h"
+
+#define PSO_TABLE_SIZE 64 /*!< Cantidad máxima de posiciones de la tabla de comparación. */
+
+//!  Clase que implementa la salida sincronizada con la posición (PSO).
+/*!
+ *   Compara la posición en pasos del eje con la próxima posición programada
+ *   y actúa sobre una GPIO en el mismo ciclo en que se emite el paso que
+ *   alcanza dicha posición. La comparación es O(1) por paso: solo se guarda
+ *   la próxima posición a comparar.
+ *
+ *   \par Modos de programación
+ *   \li Inicio, paso y cantidad: posiciones inicio + k*paso, con k = 0..cantidad-1.
+ *   \li Tabla: lista de posiciones monótona en el sentido del desplazamiento.
+ *
+ *   \par Salida
+ *   \li FIPC_PSO::OUT_TOGGLE Invierte el nivel de la GPIO en cada coincidencia.
+ *   \li FIPC_PSO::OUT_PULSE Pone la GPIO en alto en la coincidencia y en bajo en el ciclo siguiente.
+*/
+class FIPC_PSO
+{
+  public:
+
+    //! Definicion de variable simbólica de modos de salida.
+    typedef enum{ OUT_TOGGLE,   /*!< Invierte el nivel en cada coincidencia. */
+                  OUT_PULSE     /*!< Pulso de un ciclo en cada coincidencia. */
+                  }OutputMode;
+
+    //! Constructor.
+    FIPC_PSO();
+
+    //! Configura la salida.
+    /*!
+      \param pin GPIO de salida (0xFF sin asignar).
+      \param mode Modo de salida (ver FIPC_PSO::OutputMode).
+    */
+    void setOutput(uint8_t pin, uint8_t mode);
+
+    //! Programa posiciones equiespaciadas y habilita la comparación.
+    /*!
+      El paso puede ser fraccionario: cada posición se calcula como inicio + k*paso
+      y se redondea al paso más cercano, sin acumular error de redondeo.
+      \param start Primera posición en pasos.
+      \param pitch Distancia en pasos entre posiciones (el signo define el sentido).
+      \param count Cantidad de posiciones.
+      \return true si la programación fue aceptada.
+    */
+    bool armPitch(float start, float pitch, uint32_t count);
+
+    //! Agrega una posición a la tabla de comparación.
+    /*!
+      \param position Posición en pasos.
+      \return true si la posición fue agregada.
+    */
+    bool addTable(long position);
+
+    //! Habilita la comparación con la tabla cargada.
+    /*!
+      \return true si la tabla es válida y la comparación fue habilitada.
+    */
+    bool armTable();
+
+    //! Deshabilita la comparación y borra la tabla.
+    void disarm();
+
+    //! Compara la posición actual.
+    /*!
+     * Debe llamarse en cada ciclo del proceso en tiempo real luego de emitir el paso.
+     * \param position Posición actual en pasos.
+    */
+    void check(long position);
+
+    //! Solicita un reporte.
+    /*!
+      \param out Texto donde se agrega "habilitado;disparos;restantes;error máximo en pasos".
+    */
+    void getReport(FIPC_Text &out);
+
+  private:
+    uint8_t _pin = 0xFF; /*!< GPIO de salida. */
+
+    OutputMode _mode = OUT_PULSE; /*!< Modo de salida. */
+
+    bool _level = false; /*!< Nivel actual de la salida. */
+
+    volatile bool _armed = false; /*!< Comparación habilitada. */
+
+    bool _useTable = false; /*!< Utiliza la tabla de posiciones. */
+
+    long _next = 0; /*!< Próxima posición a comparar en pasos. */
+
+    float _start = 0.0; /*!< Primera posición en pasos. */
+
+    float _pitch = 0.0; /*!< Paso entre posiciones en pasos. */
+
+    uint32_t _k = 0; /*!< Índice de la próxima posición equiespaciada. */
+
+    int8_t _sense = 1; /*!< Sentido del desplazamiento esperado (1 o -1). */
+
+    uint32_t _remaining = 0; /*!< Cantidad de posiciones restantes. */
+
+    uint32_t _fired = 0; /*!< Cantidad de coincidencias. */
+
+    long _maxError = 0; /*!< Máxima diferencia en pasos entre la posición y la programada al disparar. */
+
+    long _table[PSO_TABLE_SIZE]; /*!< Tabla de posiciones en pasos. */
+
+    uint16_t _tableSize = 0; /*!< Cantidad de posiciones cargadas. */
+
+    uint16_t _tableIndex = 0; /*!< Índice de la próxima posición de la tabla. */
+};
+#endif
@@ -0,0 +1,103 @@
+/*! \file FIPC_Persist.cpp
+    \brief Clase que guarda la posición y la referencia de los ejes en memoria no volátil.
+*/
+
+#include "FIPC_Persist.h"
+#include <stddef.h>
+
+#define PERSIST_MAGIC   0x46495031 /*!< Identificador del formato del registro ("FIP1"). */
+#define PERSIST_RETRIES 3          /*!< Escrituras fallidas antes de deshabilitar la persistencia del eje. */
+
+// Constructor.
+FIPC_Persist::FIPC_Persist(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Storage* pStorage) {
+  _axisList = pAxis;
+  _axisNumbers = min(iAxisNumbers, (uint8_t)PERSIST_AXIS_NUMBERS);
+  _storage = pStorage;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Lee los registros guardados.
+void FIPC_Persist::begin(){
+  char name[8];
+  for(uint8_t i = 0; i<_axisNumbers; i++){
+    FIPC_Persist::key(name, i);
+    _errors[i] = 0;
+    PersistRecord &record = _record[i];
+    if( (!_storage->read(name, &record, sizeof(record)))||(record.magic!=PERSIST_MAGIC)||
+        (record.crc!=FIPC_Persist::crc(record)) ){
+      record.magic = PERSIST_MAGIC;
+      record.generation = 0;
+      record.position = 0;
+      record.homed = 0;
+    }
+
+    // Un registro de otro tipo de eje no es válido
+    if( record.stage!=_axisList[i]->getMotorStage() ) record.homed = 0;
+    record.stage = _axisList[i]->getMotorStage();
+    _axisList[i]->setStoredPosition(record.position, record.homed);
+  }
+}
+
+// Guarda los registros pendientes.
+void FIPC_Persist::service(){
+  char name[8];
+  uint32_t seq;
+  long steps;
+  bool homed;
+
+  for(uint8_t i = 0; i<_axisNumbers; i++){
+    if( !_axisList[i]->getPersistRequest(seq, steps, homed) ) continue;
+
+    PersistRecord record = _record[i];
+    record.generation++;
+    record.position = steps;
+    record.homed = homed ? 1 : 0;
+    record.crc = FIPC_Persist::crc(record);
+    FIPC_Persist::key(name, i);
+
+    if( _storage->write(name, &record, sizeof(record)) ){
+      _record[i] = record;
+      _errors[i] = 0;
+      _axisList[i]->persistAck(seq, steps, homed);
+    } else if( ++_errors[i]>=PERSIST_RETRIES ) {
+      // No se puede guardar: el eje continúa sin persistencia
+      _axisList[i]->setPersist(false);
+    }
+  }
+}
+
+// Solicita un reporte del registro guardado de un eje.
+void FIPC_Persist::getReport(uint8_t id, FIPC_Text &out){
+  if( (id==0)||(id>_axisNumbers) ){
+    out.add("0;0.00;0;0");
+    return;
+  }
+  PersistRecord &record = _record[id-1];
+  out.add(record.homed);
+  out.add(';').add(record.position/_axisList[id-1]->getStepsPerUnit(),2);
+  out.add(';').add((unsigned long)record.generation);
+  out.add(';').add(_errors[id-1]);
+}
+
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Arma la clave de un eje.
+void FIPC_Persist::key(char* oKey, uint8_t index){
+  snprintf(oKey, 8, "axis%u", index+1);
+}
+
+// Calcula el CRC-16 (CCITT) de un registro.
+uint16_t FIPC_Persist::crc(const PersistRecord &iRecord){
+  return FIPC_Storage::crc16(&iRecord, offsetof(PersistRecord, crc));
+}
+
+/* End: Private                           */
+/******************************************/
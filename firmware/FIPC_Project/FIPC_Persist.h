@@ -0,0 +1,103 @@
+/*! \file FIPC_Persist.h
+ *  \brief Clase que guarda la posición y la referencia de los ejes en memoria no volátil.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Persist_h
+#define FIPC_Persist_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+#include "FIPC_Storage.h"
+
+#define PERSIST_AXIS_NUMBERS 8 /*!< Cantidad máxima de ejes que se guardan. */
+
+//!  Clase que guarda la posición y la referencia de los ejes en memoria no volátil.
+/*!
+ *   Cada eje publica desde FIPC_Axis::exec() el registro a guardar y esta clase lo
+ *   escribe fuera del proceso en tiempo real, por lo que la escritura en flash no
+ *   afecta la generación de pasos.
+ *
+ *   \par Consistencia
+ *   Al aceptar un desplazamiento o una búsqueda de cero el eje publica un registro sin
+ *   referencia válida (ver FIPC_Axis::post()) y lo inicia recién cuando service() lo
+ *   guardó. Un comando recibido por el puerto serie espera solo la escritura, que se hace
+ *   en la misma iteración de TaskReadAction; uno del programa, de la red o de los módulos
+ *   espera además hasta un período de TaskReadAction. Al quedar en reposo se guarda la
+ *   posición con referencia válida. De esta forma, ante un corte de energía, el registro
+ *   solo indica una referencia válida si el eje estaba detenido en la posición guardada.
+ *   Cada registro incluye un contador de generación, el tipo de eje y un CRC.
+*/
+class FIPC_Persist
+{
+  public:
+
+    //! Constructor.
+    /*!
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista.
+      \param pStorage Almacenamiento no volátil.
+     */
+    FIPC_Persist(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Storage* pStorage);
+
+    //! Lee los registros guardados y habilita la persistencia en los ejes.
+    /*!
+     * Debe llamarse una vez antes de iniciar el proceso en tiempo real.
+    */
+    void begin();
+
+    //! Guarda los registros pendientes.
+    /*!
+     * Debe llamarse periódicamente fuera del proceso en tiempo real.
+    */
+    void service();
+
+    //! Solicita un reporte del registro guardado de un eje.
+    /*!
+      \param id Identificador del eje.
+      \param out Texto donde se agrega "referencia válida;posición;generación;errores".
+    */
+    void getReport(uint8_t id, FIPC_Text &out);
+
+  private:
+    //! Registro guardado por eje.
+    typedef struct{
+      uint32_t magic;       /*!< Identificador del formato. */
+      uint32_t generation;  /*!< Contador de escrituras. */
+      int32_t  position;    /*!< Posición en pasos. */
+      uint8_t  stage;       /*!< Tipo de eje (ver FIPC_Axis::MotorStage). */
+      uint8_t  homed;       /*!< 1 si el eje estaba detenido con referencia válida. */
+      uint16_t crc;         /*!< CRC-16 de los campos anteriores. */
+    }PersistRecord;
+
+    FIPC_Axis** _axisList; /*!< Lista de ejes del controlador. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes en la lista. */
+
+    FIPC_Storage* _storage; /*!< Almacenamiento no volátil. */
+
+    PersistRecord _record[PERSIST_AXIS_NUMBERS]; /*!< Último registro guardado de cada eje. */
+
+    uint8_t _errors[PERSIST_AXIS_NUMBERS]; /*!< Escrituras fallidas consecutivas de cada eje. */
+
+    //! Arma la clave de un eje.
+    void key(char* oKey, uint8_t index);
+
+    //! Calcula el CRC-16 (CCITT) de un registro.
+    uint16_t crc(const PersistRecord &iRecord);
+};
+#endif
@@ -0,0 +1,43 @@
+/*! \file FIPC_PowerSensor.cpp
+    \brief Interfaz de lectura de potencia óptica.
+*/
+
+#include "FIPC_PowerSensor.h"
+
+#define NO_PIN 0xFF /*!< Identificador de GPIO sin asignar. */
+
+// Constructor.
+FIPC_AnalogSensor::FIPC_AnalogSensor(uint8_t iPin) {
+  FIPC_AnalogSensor::setPin(iPin);
+}
+
+// Configuración de la entrada analógica.
+void FIPC_AnalogSensor::setPin(uint8_t iPin){
+  _pin = iPin;
+  if( _pin!=NO_PIN ) pinMode(_pin, INPUT);
+}
+
+// Lee el conversor y guarda la lectura.
+void FIPC_AnalogSensor::sample(){
+  uint8_t pin = _pin;
+  if( pin==NO_PIN ) return;
+  float value = analogRead(pin);
+  portENTER_CRITICAL(&_mux);
+  _value = value;
+  _samples = _samples+1;
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Toma la última lectura guardada.
+bool FIPC_AnalogSensor::read(float &value){
+  if( _pin==NO_PIN ){
+    value = 0.0;
+    return true;
+  }
+  portENTER_CRITICAL(&_mux);
+  bool fresh = (_samples!=_seen);
+  _seen = _samples;
+  value = _value;
+  portEXIT_CRITICAL(&_mux);
+  return fresh;
+}
@@ -0,0 +1,87 @@
+/*! \file FIPC_PowerSensor.h
+ *  \brief Interfaz de lectura de potencia óptica.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_PowerSensor_h
+#define FIPC_PowerSensor_h
+
+#include "Arduino.h"
+
+//!  Interfaz de lectura de potencia óptica.
+/*!
+ *   FIPC_Align solo conoce esta interfaz, por lo que la fuente de la medición
+ *   puede reemplazarse sin modificar los algoritmos de alineación. En el
+ *   controlador se utiliza FIPC_AnalogSensor, mientras que una simulación puede
+ *   implementar read() con un modelo sintético de acoplamiento.
+*/
+class FIPC_PowerSensor
+{
+  public:
+    //! Toma la lectura más reciente.
+    /*!
+      Se llama desde la tarea de tiempo real, por lo que no debe esperar al conversor.
+      \param value Valor proporcional a la potencia óptica (mayor es mejor).
+      \return false si no hubo una lectura nueva desde la llamada anterior.
+    */
+    virtual bool read(float &value) = 0;
+};
+
+
+//!  Lectura de potencia óptica a partir de una entrada analógica del ESP32.
+/*!
+ *   analogRead() demora decenas de us, por lo que no
+ *   se llama desde la tarea de tiempo real: sample() lee el conversor desde una tarea del
+ *   núcleo 0 y read() entrega en el núcleo 1 la última lectura guardada.
+*/
+class FIPC_AnalogSensor : public FIPC_PowerSensor
+{
+  public:
+    //! Constructor.
+    /*!
+      \param iPin GPIO de la entrada analógica (0xFF sin asignar).
+     */
+    FIPC_AnalogSensor(uint8_t iPin = 0xFF);
+
+    //! Configuración de la entrada analógica.
+    /*!
+      \param iPin GPIO de la entrada analógica.
+    */
+    void setPin(uint8_t iPin);
+
+    //! Lee el conversor y guarda la lectura (núcleo 0).
+    void sample();
+
+    //! Toma la última lectura guardada por sample().
+    /*!
+      \param value Cuentas del conversor, 0 si no hay entrada asignada.
+      \return false si no hubo una lectura nueva. Sin entrada asignada siempre retorna true.
+    */
+    bool read(float &value);
+
+  private:
+    volatile uint8_t _pin; /*!< GPIO de la entrada analógica. */
+
+    volatile float _value = 0.0; /*!< Última lectura del conversor. */
+
+    volatile uint32_t _samples = 0; /*!< Lecturas guardadas por sample(). */
+
+    uint32_t _seen = 0; /*!< Lecturas entregadas por read(). */
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED; /*!< Exclusión entre los núcleos. */
+};
+#endif
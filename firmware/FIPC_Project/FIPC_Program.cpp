@@ -0,0 +1,399 @@
+/*! \file FIPC_Program.cpp
+    \brief Programas de comandos almacenados en el controlador.
+*/
+
+#include "FIPC_Program.h"
+#include "FIPC_API.h"
+#include <stddef.h>
+
+#define PROGRAM_MAGIC   0x46495031 /*!< Identificador del formato del programa ("FIP1"). */
+#define PROGRAM_VERSION 1          /*!< Versión del formato del programa. */
+#define PROGRAM_KEY     "program"  /*!< Clave del programa en el almacenamiento. */
+#define PROGRAM_HEADER  offsetof(FIPC_Program::ProgramBlob, position) /*!< Bytes del encabezado. */
+
+// Constructor.
+FIPC_Program::FIPC_Program(FIPC_API* pApi, FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Storage* pStorage) :
+  _out(_outBuffer, sizeof(_outBuffer)) {
+  _api = pApi;
+  _axis = pAxis;
+  _axisNumbers = min(iAxisNumbers, (uint8_t)PROGRAM_AXIS_NUMBERS);
+  _storage = pStorage;
+  memset(&_active, 0, sizeof(_active));
+  memset(_var, 0, sizeof(_var));
+  memset(_position, 0, sizeof(_position));
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Lee el programa guardado.
+bool FIPC_Program::begin(){
+  if( !_storage->read(PROGRAM_KEY, &_upload, sizeof(_upload)) ) return false;
+  if( !FIPC_Program::validate(_upload) ) return false;
+  _active = _upload;
+  _loaded = true;
+  return true;
+}
+
+// Recibe un tramo del programa a cargar.
+bool FIPC_Program::upload(uint16_t offset, const char* hex){
+  if( offset==0 ) _uploadSize = 0;
+  if( offset!=_uploadSize ) return false; // tramo fuera de orden
+
+  uint8_t* data = (uint8_t*)&_upload;
+  for(; *hex; hex += 2){
+    int8_t high = FIPC_Config::hexValue(hex[0]);
+    int8_t low  = (high<0) ? -1 : FIPC_Config::hexValue(hex[1]);
+    if( (low<0)||(_uploadSize>=sizeof(_upload)) ){
+      _uploadSize = 0; // un tramo inválido descarta la carga
+      return false;
+    }
+    data[_uploadSize++] = (high<<4)|low;
+  }
+  return true;
+}
+
+// Verifica y guarda el programa recibido.
+bool FIPC_Program::commit(){
+  if( _status==PROGRAM_RUN ) return false;
+  if( _uploadSize<PROGRAM_HEADER+sizeof(_upload.position)+_upload.size ) return false;
+  // El código no enviado se completa con ceros (OP_END)
+  memset((uint8_t*)&_upload+_uploadSize, 0, sizeof(_upload)-_uploadSize);
+  _uploadSize = 0;
+  if( !FIPC_Program::validate(_upload) ) return false;
+  if( !_storage->write(PROGRAM_KEY, &_upload, sizeof(_upload)) ) return false;
+  _active = _upload;
+  _loaded = true;
+  _status = PROGRAM_IDLE;
+  return true;
+}
+
+// Inicia el programa desde la primera instrucción.
+bool FIPC_Program::start(){
+  if( (!_loaded)||(_status==PROGRAM_RUN) ) return false;
+  memset(_var, 0, sizeof(_var));
+  memcpy(_position, _active.position, sizeof(_position));
+  _pc = 0;
+  _loopDepth = 0;
+  _wait = WAIT_NONE;
+  _finished = false;
+  _status = PROGRAM_RUN;
+  return true;
+}
+
+// Detiene el programa en ejecución.
+void FIPC_Program::stop(){
+  if( _status==PROGRAM_RUN ) FIPC_Program::end(PROGRAM_STOPPED);
+}
+
+// Ejecuta el programa.
+void FIPC_Program::service(){
+  for(uint8_t i = 0; (i<PROGRAM_BURST)&&(_status==PROGRAM_RUN); i++){
+    if( (_wait!=WAIT_NONE)&&(!FIPC_Program::waitDone()) ) return;
+    if( !FIPC_Program::step() ) return;
+  }
+}
+
+// Retorna el estado del programa.
+uint8_t FIPC_Program::getStatus(){
+  return _status;
+}
+
+// Solicita un reporte del programa.
+void FIPC_Program::getReport(FIPC_Text &out){
+  switch(_status){
+    case PROGRAM_IDLE:    out.add(_loaded ? "Idle" : "Empty"); break;
+    case PROGRAM_RUN:     out.add("Running"); break;
+    case PROGRAM_DONE:    out.add("Done"); break;
+    case PROGRAM_STOPPED: out.add("Stopped"); break;
+    default:              out.add("Error"); break;
+  }
+  out.add(';').add((unsigned)_pc).add(';').add((unsigned)_active.crc);
+}
+
+// Solicita el valor de una variable.
+void FIPC_Program::getVariable(uint8_t id, FIPC_Text &out){
+  out.add((id<PROGRAM_VARIABLES) ? _var[id] : 0.0, 3);
+}
+
+// Consulta si el programa terminó desde la última consulta.
+bool FIPC_Program::finished(){
+  if( !_finished ) return false;
+  _finished = false;
+  return true;
+}
+
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Ejecuta una instrucción.
+bool FIPC_Program::step(){
+  const uint8_t* code = _active.code;
+  uint16_t pc = _pc+1;
+  uint8_t op = code[_pc];
+
+  switch(op){
+    case OP_END:
+      FIPC_Program::end(PROGRAM_DONE);
+      return false;
+
+    case OP_CMD: {
+      uint8_t len = code[pc++];
+      memcpy(_line, &code[pc], len);
+      _line[len] = '\0';
+      pc += len;
+      _api->execute(_line, _out.clear());
+      break;
+    }
+
+    case OP_MOVE: {
+      uint8_t mode = code[pc++];
+      uint8_t id = code[pc++];
+      FIPC_Axis* axis = _axis[id-1];
+      float value = FIPC_Program::operand(pc);
+      bool ok = mode ? axis->canMoveAbsolute(value) : axis->canMoveRelative(value);
+      // Como "MR:" y "MA:": presupuesto de pasos y lote retenido hasta el disparo
+      if( ok ) ok = _api->moveAxis(id, mode, value);
+      if( !ok ){
+        FIPC_Program::end(PROGRAM_ERROR);
+        return false;
+      }
+      break;
+    }
+
+    case OP_MOVEPOS: {
+      uint8_t index = code[pc++];
+      float iTimeSpeed = FIPC_Program::operand(pc);
+      float iAccelTime = FIPC_Program::operand(pc);
+      if( _api->moveSync(_position[index], iTimeSpeed, iAccelTime)<0.0 ){
+        FIPC_Program::end(PROGRAM_ERROR);
+        return false;
+      }
+      break;
+    }
+
+    case OP_WAIT:
+      _waitMask = code[pc++];
+      _wait = WAIT_IDLE;
+      break;
+
+    case OP_TRIGGER:
+    case OP_DELAY: {
+      if( op==OP_TRIGGER ){
+        _waitPin = code[pc++];
+        _waitLevel = code[pc++];
+      }
+      float time = FIPC_Program::operand(pc);
+      _waitTime = (time>0.0) ? (unsigned long)time : 0;
+      _waitStart = millis();
+      _wait = (op==OP_TRIGGER) ? WAIT_TRIGGER : WAIT_DELAY;
+      break;
+    }
+
+    case OP_SET: case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: {
+      float &var = _var[code[pc++]];
+      float value = FIPC_Program::operand(pc);
+      if( op==OP_SET ) var = value;
+      if( op==OP_ADD ) var += value;
+      if( op==OP_SUB ) var -= value;
+      if( op==OP_MUL ) var *= value;
+      if( op==OP_DIV ){
+        if( value==0.0 ){
+          FIPC_Program::end(PROGRAM_ERROR);
+          return false;
+        }
+        var /= value;
+      }
+      break;
+    }
+
+    case OP_GETPOS: {
+      uint8_t id = code[pc++];
+      _var[id] = _axis[code[pc++]-1]->getCurrentPosition();
+      break;
+    }
+
+    case OP_STOREPOS: {
+      uint8_t index = code[pc++];
+      for(uint8_t i = 0; i<_axisNumbers; i++) _position[index][i] = _axis[i]->getCurrentPosition();
+      break;
+    }
+
+    case OP_LOOP: {
+      float count = FIPC_Program::operand(pc);
+      if( count>=1.0 ){
+        _loop[_loopDepth].start = pc;
+        _loop[_loopDepth].count = (count<4e9) ? (uint32_t)count : 4000000000UL;
+        _loopDepth++;
+        break;
+      }
+      // Sin repeticiones: continúa luego del OP_NEXT correspondiente
+      for(uint8_t depth = 1; depth>0; ){
+        if( code[pc]==OP_LOOP ) depth++;
+        if( code[pc]==OP_NEXT ) depth--;
+        pc += FIPC_Program::length(code, pc, _active.size);
+      }
+      break;
+    }
+
+    case OP_NEXT: {
+      Loop &loop = _loop[_loopDepth-1];
+      if( --loop.count>0 ) pc = loop.start;
+      else                 _loopDepth--;
+      break;
+    }
+  }
+  _pc = pc;
+  return true;
+}
+
+// Verifica si terminó la espera en curso.
+bool FIPC_Program::waitDone(){
+  unsigned long elapsed = millis()-_waitStart;
+  switch(_wait){
+    case WAIT_IDLE:
+      if( !_api->isIdle(_waitMask) ) return false;
+      break;
+    case WAIT_TRIGGER:
+      if( (digitalRead(_waitPin)?1:0)!=_waitLevel ){
+        if( (_waitTime)&&(elapsed>=_waitTime) ) FIPC_Program::end(PROGRAM_ERROR);
+        return false;
+      }
+      break;
+    case WAIT_DELAY:
+      if( elapsed<_waitTime ) return false;
+      break;
+    default:
+      break;
+  }
+  _wait = WAIT_NONE;
+  return true;
+}
+
+// Lee un operando.
+float FIPC_Program::operand(uint16_t &pc){
+  uint8_t tag = _active.code[pc++];
+  if( tag<PROGRAM_VARIABLES ) return _var[tag];
+  float value;
+  memcpy(&value, &_active.code[pc], sizeof(value));
+  pc += sizeof(value);
+  return value;
+}
+
+// Termina el programa.
+void FIPC_Program::end(ProgramStatus iStatus){
+  _wait = WAIT_NONE;
+  _status = iStatus;
+  _finished = true;
+}
+
+// Verifica un programa.
+bool FIPC_Program::validate(const ProgramBlob &iBlob){
+  if( (iBlob.magic!=PROGRAM_MAGIC)||(iBlob.version!=PROGRAM_VERSION) ) return false;
+  if( (iBlob.size==0)||(iBlob.size>PROGRAM_CODE_SIZE) ) return false;
+  if( iBlob.crc!=FIPC_Program::crc(iBlob) ) return false;
+
+  // El código no utilizado debe estar en cero
+  for(uint16_t i = iBlob.size; i<PROGRAM_CODE_SIZE; i++)
+    if( iBlob.code[i] ) return false;
+
+  // Recorre todas las instrucciones: cada una completa, lazos balanceados y OP_END al final
+  const uint8_t* code = iBlob.code;
+  uint8_t depth = 0, last = OP_NEXT;
+  for(uint16_t pc = 0; pc<iBlob.size; ){
+    uint16_t len = FIPC_Program::length(code, pc, iBlob.size);
+    if( len==0 ) return false;
+    if( (code[pc]==OP_LOOP)&&(++depth>PROGRAM_LOOP_DEPTH) ) return false;
+    if( (code[pc]==OP_NEXT)&&(depth--==0) ) return false;
+    last = code[pc];
+    pc += len;
+  }
+  return (last==OP_END)&&(depth==0);
+}
+
+// Retorna el largo de una instrucción.
+uint16_t FIPC_Program::length(const uint8_t* code, uint16_t pc, uint16_t size){
+  uint16_t start = pc++;
+  uint8_t op = code[start];
+  uint8_t n = 0; // operandos
+
+  switch(op){
+    case OP_END:
+    case OP_NEXT:
+      break;
+    case OP_CMD: {
+      if( pc>=size ) return 0;
+      uint8_t len = code[pc++];
+      if( (len==0)||(len>=PROGRAM_LINE_SIZE)||(pc+len>size) ) return 0;
+      const char* text = (const char*)&code[pc];
+      if( (memchr(text, '\0', len)!=NULL)||(text[len-1]!=':') ) return 0;
+      // Un programa no puede cargar, iniciar ni detener programas
+      for(uint8_t i = 0; i<len; i++)
+        if( ((i==0)||(text[i-1]==':'))&&(i+3<=len)&&(!strncmp(&text[i], "PRG", 3)) ) return 0;
+      pc += len;
+      break;
+    }
+    case OP_MOVE:
+      if( pc+2>size ) return 0;
+      if( (code[pc]>1)||(code[pc+1]==0)||(code[pc+1]>_axisNumbers) ) return 0;
+      pc += 2;
+      n = 1;
+      break;
+    case OP_MOVEPOS:
+      if( (pc>=size)||(code[pc++]>=PROGRAM_POSITIONS) ) return 0;
+      n = 2;
+      break;
+    case OP_WAIT:
+      if( pc>=size ) return 0;
+      pc++;
+      break;
+    case OP_TRIGGER:
+      if( pc+2>size ) return 0;
+      if( (code[pc]>CONFIG_GPIO_INPUT_MAX)||(code[pc+1]>1) ) return 0;
+      pc += 2;
+      n = 1;
+      break;
+    case OP_DELAY:
+    case OP_LOOP:
+      n = 1;
+      break;
+    case OP_SET: case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+      if( (pc>=size)||(code[pc++]>=PROGRAM_VARIABLES) ) return 0;
+      n = 1;
+      break;
+    case OP_GETPOS:
+      if( pc+2>size ) return 0;
+      if( (code[pc]>=PROGRAM_VARIABLES)||(code[pc+1]==0)||(code[pc+1]>_axisNumbers) ) return 0;
+      pc += 2;
+      break;
+    case OP_STOREPOS:
+      if( (pc>=size)||(code[pc++]>=PROGRAM_POSITIONS) ) return 0;
+      break;
+    default:
+      return 0;
+  }
+
+  // Operandos: índice de una variable o constante de 4 bytes
+  for(uint8_t i = 0; i<n; i++){
+    if( pc>=size ) return 0;
+    uint8_t tag = code[pc++];
+    if( tag==PROGRAM_CONST ) pc += sizeof(float);
+    else if( tag>=PROGRAM_VARIABLES ) return 0;
+    if( pc>size ) return 0;
+  }
+  return pc-start;
+}
+
+// Calcula el CRC del programa.
+uint16_t FIPC_Program::crc(const ProgramBlob &iBlob){
+  // Posiciones con nombre y código utilizado (el código sigue a las posiciones en el bloque)
+  return FIPC_Storage::crc16(iBlob.position, sizeof(iBlob.position)+iBlob.size);
+}
+
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,295 @@
+/*! \file FIPC_Program.h
+ *  \brief Clase que implementa programas de comandos almacenados en el controlador.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Program_h
+#define FIPC_Program_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+#include "FIPC_Storage.h"
+#include "FIPC_Text.h"
+
+#define PROGRAM_CODE_SIZE      1024 /*!< Tamaño máximo del código en bytes. */
+#define PROGRAM_POSITIONS      16   /*!< Cantidad de posiciones con nombre. */
+#define PROGRAM_AXIS_NUMBERS   6    /*!< Coordenadas de cada posición con nombre. */
+#define PROGRAM_VARIABLES      16   /*!< Cantidad de variables. */
+#define PROGRAM_LOOP_DEPTH     4    /*!< Máximo anidamiento de lazos. */
+#define PROGRAM_BURST          32   /*!< Instrucciones ejecutadas como máximo en cada llamada a service(). */
+#define PROGRAM_LINE_SIZE      256  /*!< Largo máximo de un comando de la API (incluye el '\0'). */
+#define PROGRAM_CONST          0xFF /*!< Marca de un operando constante (float de 4 bytes a continuación). */
+
+class FIPC_API;
+
+//!  Clase que implementa programas de comandos almacenados en el controlador.
+/*!
+ *   Un programa es un código compacto (bytecode) que se carga desde el host con upload() y
+ *   commit(), se guarda en memoria no volátil y se ejecuta con start() sin intervención del
+ *   host. Lo interpreta service(), llamada periódicamente desde una tarea propia del núcleo 0
+ *   con el semáforo del puerto serie tomado: las acciones se envían a FIPC_API como si fueran
+ *   comandos recibidos. Ver python_lib/module_program.py, que compila las recetas.
+ *
+ *   \par Formato
+ *   Encabezado ProgramBlob::magic, ProgramBlob::version, ProgramBlob::size (bytes de código) y
+ *   ProgramBlob::crc (CRC-16 de las posiciones y del código), seguido de PROGRAM_POSITIONS
+ *   posiciones con nombre y el código. Solo es necesario enviar el código utilizado; el resto
+ *   se completa con ceros. Todos los valores están en little-endian.
+ *
+ *   \par Operandos
+ *   Un operando es un byte: un índice menor que PROGRAM_VARIABLES lee una variable y
+ *   PROGRAM_CONST indica un float constante en los 4 bytes siguientes.
+ *
+ *   \par Instrucciones
+ *   \li FIPC_Program::OP_END Fin del programa.
+ *   \li FIPC_Program::OP_CMD largo, texto: lista de comandos de la API terminada en ':'.
+ *   \li FIPC_Program::OP_MOVE modo (0 relativo, 1 absoluto), eje, operando: desplaza 1 eje.
+ *   \li FIPC_Program::OP_MOVEPOS posición, tiempo, tiempo de aceleración: desplazamiento
+ *   sincrónico a una posición con nombre (tiempo 0 para el menor tiempo posible).
+ *   \li FIPC_Program::OP_WAIT máscara de ejes: espera que los ejes estén en reposo y que no
+ *   haya barridos, alineaciones ni desplazamientos de la herramienta en ejecución.
+ *   \li FIPC_Program::OP_TRIGGER GPIO, nivel, operando: espera el nivel de la entrada con un
+ *   tiempo límite en ms (0 sin límite). Si vence el programa termina con error.
+ *   \li FIPC_Program::OP_DELAY operando: espera en ms.
+ *   \li FIPC_Program::OP_SET, FIPC_Program::OP_ADD, FIPC_Program::OP_SUB, FIPC_Program::OP_MUL
+ *   y FIPC_Program::OP_DIV variable, operando: aritmética sobre una variable.
+ *   \li FIPC_Program::OP_GETPOS variable, eje: lee la posición actual de un eje.
+ *   \li FIPC_Program::OP_STOREPOS posición: guarda la posición actual de los ejes (solo en RAM).
+ *   \li FIPC_Program::OP_LOOP operando y FIPC_Program::OP_NEXT: repite el bloque la cantidad
+ *   de veces indicada (0 lo saltea).
+ *
+ *   El código se verifica completo en commit(): el intérprete no encuentra instrucciones
+ *   inválidas durante la ejecución.
+*/
+class FIPC_Program
+{
+  public:
+
+    //! Definicion de variable simbólica de las instrucciones.
+    typedef enum{ OP_END,       /*!< Fin del programa. */
+                  OP_CMD,       /*!< Comandos de la API. */
+                  OP_MOVE,      /*!< Desplazamiento de 1 eje. */
+                  OP_MOVEPOS,   /*!< Desplazamiento sincrónico a una posición con nombre. */
+                  OP_WAIT,      /*!< Espera el reposo de los ejes. */
+                  OP_TRIGGER,   /*!< Espera el nivel de una entrada. */
+                  OP_DELAY,     /*!< Espera un tiempo. */
+                  OP_SET,       /*!< Asigna una variable. */
+                  OP_ADD,       /*!< Suma a una variable. */
+                  OP_SUB,       /*!< Resta a una variable. */
+                  OP_MUL,       /*!< Multiplica una variable. */
+                  OP_DIV,       /*!< Divide una variable. */
+                  OP_GETPOS,    /*!< Lee la posición de un eje. */
+                  OP_STOREPOS,  /*!< Guarda la posición actual de los ejes. */
+                  OP_LOOP,      /*!< Inicio de un lazo. */
+                  OP_NEXT       /*!< Fin de un lazo. */
+                  }OpCode;
+
+    //! Definicion de variable simbólica de estados del programa.
+    typedef enum{ PROGRAM_IDLE,     /*!< Sin ejecutar. */
+                  PROGRAM_RUN,      /*!< En ejecución. */
+                  PROGRAM_DONE,     /*!< Finalizado. */
+                  PROGRAM_STOPPED,  /*!< Detenido por el host. */
+                  PROGRAM_ERROR     /*!< Terminado por un error (desplazamiento rechazado o tiempo límite). */
+                  }ProgramStatus;
+
+    //! Bloque del programa guardado.
+    typedef struct{
+      uint32_t magic;    /*!< Identificador del formato. */
+      uint16_t version;  /*!< Versión del formato. */
+      uint16_t size;     /*!< Bytes de código utilizados. */
+      uint16_t crc;      /*!< CRC-16 de las posiciones y de los bytes de código utilizados. */
+      uint16_t reserved; /*!< Sin uso, en cero. */
+      float    position[PROGRAM_POSITIONS][PROGRAM_AXIS_NUMBERS]; /*!< Posiciones con nombre. */
+      uint8_t  code[PROGRAM_CODE_SIZE]; /*!< Código. */
+    }ProgramBlob;
+
+    //! Constructor.
+    /*!
+      \param pApi API a la que se envían los comandos.
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista.
+      \param pStorage Almacenamiento no volátil.
+     */
+    FIPC_Program(FIPC_API* pApi, FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Storage* pStorage);
+
+    //! Lee el programa guardado.
+    /*!
+     * Debe llamarse una vez en setup().
+     * \return true si se cargó un programa válido.
+    */
+    bool begin();
+
+    //! Recibe un tramo del programa a cargar.
+    /*!
+      Los tramos deben enviarse en orden; un tramo en la posición 0 inicia una nueva carga.
+      \param offset Posición del tramo en bytes.
+      \param hex Datos del tramo en hexadecimal.
+      \return true si el tramo fue aceptado.
+    */
+    bool upload(uint16_t offset, const char* hex);
+
+    //! Verifica y guarda el programa recibido.
+    /*!
+      \return true si el programa es válido, no había uno en ejecución y se guardó.
+    */
+    bool commit();
+
+    //! Inicia el programa desde la primera instrucción.
+    /*!
+      \return true si hay un programa cargado y no estaba en ejecución.
+    */
+    bool start();
+
+    //! Detiene el programa en ejecución.
+    /*!
+     * Los desplazamientos en curso no se detienen, para eso se utiliza "SA:".
+    */
+    void stop();
+
+    //! Ejecuta el programa.
+    /*!
+     * Debe llamarse periódicamente desde la tarea del programa (núcleo 0) con el semáforo
+     * del puerto serie tomado. Ejecuta instrucciones hasta que el programa deba esperar,
+     * como máximo PROGRAM_BURST.
+    */
+    void service();
+
+    //! Retorna el estado del programa.
+    /*!
+      \return La variable simbólica que describe el estado (ver FIPC_Program::ProgramStatus).
+    */
+    uint8_t getStatus();
+
+    //! Solicita un reporte del programa.
+    /*!
+      \param out Texto donde se agrega "estado;instrucción;crc".
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Solicita el valor de una variable.
+    /*!
+      \param id Índice de la variable.
+      \param out Texto donde se agrega el valor.
+    */
+    void getVariable(uint8_t id, FIPC_Text &out);
+
+    //! Consulta si el programa terminó desde la última consulta.
+    /*!
+      \return true una única vez al finalizar el programa.
+    */
+    bool finished();
+
+  private:
+    //! Definicion de variable simbólica de esperas.
+    typedef enum{ WAIT_NONE,    /*!< Sin espera. */
+                  WAIT_IDLE,    /*!< Reposo de los ejes. */
+                  WAIT_TRIGGER, /*!< Nivel de una entrada. */
+                  WAIT_DELAY    /*!< Tiempo. */
+                  }WaitType;
+
+    //! Lazo en ejecución.
+    typedef struct{
+      uint16_t start; /*!< Primera instrucción del bloque. */
+      uint32_t count; /*!< Repeticiones restantes. */
+    }Loop;
+
+    FIPC_API* _api; /*!< API a la que se envían los comandos. */
+
+    FIPC_Axis** _axis; /*!< Lista de ejes del controlador. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes en la lista. */
+
+    FIPC_Storage* _storage; /*!< Almacenamiento no volátil. */
+
+    ProgramBlob _active; /*!< Programa cargado. */
+
+    ProgramBlob _upload; /*!< Programa en carga. */
+
+    uint16_t _uploadSize = 0; /*!< Bytes recibidos del programa en carga. */
+
+    bool _loaded = false; /*!< Hay un programa válido cargado. */
+
+    volatile ProgramStatus _status = PROGRAM_IDLE; /*!< Estado del programa. */
+
+    volatile bool _finished = false; /*!< Indica el fin del programa hasta ser consultado. */
+
+    uint16_t _pc = 0; /*!< Posición de la instrucción en ejecución. */
+
+    float _var[PROGRAM_VARIABLES]; /*!< Variables. */
+
+    float _position[PROGRAM_POSITIONS][PROGRAM_AXIS_NUMBERS]; /*!< Posiciones con nombre en uso. */
+
+    Loop _loop[PROGRAM_LOOP_DEPTH]; /*!< Lazos en ejecución. */
+
+    uint8_t _loopDepth = 0; /*!< Cantidad de lazos en ejecución. */
+
+    WaitType _wait = WAIT_NONE; /*!< Espera en curso. */
+
+    uint8_t _waitMask = 0; /*!< Ejes de la espera de reposo. */
+
+    uint8_t _waitPin = 0; /*!< GPIO de la espera de una entrada. */
+
+    uint8_t _waitLevel = 0; /*!< Nivel esperado de la entrada. */
+
+    unsigned long _waitStart = 0; /*!< Tiempo en ms de inicio de la espera. */
+
+    unsigned long _waitTime = 0; /*!< Duración o tiempo límite de la espera en ms (0 sin límite). */
+
+    char _line[PROGRAM_LINE_SIZE]; /*!< Comando en ejecución. */
+
+    char _outBuffer[64]; /*!< Respuesta de los comandos (se descarta). */
+
+    FIPC_Text _out; /*!< Respuesta de los comandos. */
+
+    //! Ejecuta una instrucción.
+    /*!
+      \return false si el programa terminó.
+    */
+    bool step();
+
+    //! Verifica si terminó la espera en curso.
+    /*!
+      \return true si el programa puede continuar.
+    */
+    bool waitDone();
+
+    //! Lee un operando.
+    float operand(uint16_t &pc);
+
+    //! Termina el programa.
+    void end(ProgramStatus iStatus);
+
+    //! Verifica un programa.
+    /*!
+      \param iBlob Programa a verificar.
+      \return true si el formato, el CRC y todas las instrucciones son válidas.
+    */
+    bool validate(const ProgramBlob &iBlob);
+
+    //! Retorna el largo de una instrucción.
+    /*!
+      \param code Código.
+      \param pc Posición de la instrucción.
+      \param size Bytes de código.
+      \return Largo en bytes, 0 si la instrucción es inválida.
+    */
+    uint16_t length(const uint8_t* code, uint16_t pc, uint16_t size);
+
+    //! Calcula el CRC del programa.
+    uint16_t crc(const ProgramBlob &iBlob);
+};
+#endif
@@ -41,29 +41,67 @@
  *  Copyright (C) 2020-2021 Roberto Peyton
 */
 
+#include <WiFi.h>
 #include "FIPC_API.h"
+#include "FIPC_Network.h"
 
 #define EXEC_TIME_OUT 80 // exec time-out in microseconds
 unsigned long dt_exec,t1_exec,flag_time_out=0; // global variable time analysis
 
+#define READ_STACK_SIZE   3*1024 // task stack sizes in bytes
+#define REPORT_STACK_SIZE 4*1024
+#define EXEC_STACK_SIZE   2*1024
+#define PROGRAM_STACK_SIZE 3*1024
+#define NETWORK_STACK_SIZE 4*1024
+
+#define WIFI_SSID     ""  // network command endpoint disabled when empty
+#define WIFI_PASSWORD ""
+
 FIPC_API axis_api;
+FIPC_TcpTransport axis_tcp;
+FIPC_Network axis_network(&axis_api, &axis_tcp);
 
 void TaskReadAction   ( void *pvParameters ); // execute in core 0
 void TaskReportStatus ( void *pvParameters ); // execute in core 0
 void TaskExec         ( void *pvParameters ); // execute in core 1
+void TaskProgram      ( void *pvParameters ); // execute in core 0
+void TaskNetwork      ( void *pvParameters ); // execute in core 0
+void SerialReceived   ();                     // UART driver callback
 SemaphoreHandle_t xSerialSemaphore;
 
+// static FreeRTOS objects: no heap is used after setup()
+StackType_t  xReadStack[READ_STACK_SIZE], xReportStack[REPORT_STACK_SIZE], xExecStack[EXEC_STACK_SIZE], xProgramStack[PROGRAM_STACK_SIZE], xNetworkStack[NETWORK_STACK_SIZE];
+StaticTask_t xReadTask, xReportTask, xExecTask, xProgramTask, xNetworkTask;
+StaticSemaphore_t xSerialMutex;
+char serial_line[API_REQUEST_SIZE]; // serial request buffer
+
 void setup() {
   Serial.begin(115200);
+#if LATENCY_ENABLED
+  Serial.onReceive(SerialReceived); // time stamp of the first bytes of each command line
+#endif
+
+  // restore the stored axis positions before the real time task starts
+  axis_api.begin();
 
   // config FreeRTOS
   if ( xSerialSemaphore==NULL ) {
-    xSerialSemaphore = xSemaphoreCreateMutex();
+    xSerialSemaphore = xSemaphoreCreateMutexStatic( &xSerialMutex );
     if ( xSerialSemaphore!=NULL ) xSemaphoreGive( xSerialSemaphore );
   }
-  xTaskCreatePinnedToCore(TaskReadAction,"TaskReadAction",3*1024,NULL,2,NULL,0);
-  xTaskCreatePinnedToCore(TaskReportStatus,"TaskReportStatus",4*1024,NULL,2,NULL,0);    
-  xTaskCreatePinnedToCore(TaskExec,"TaskExec",2*1024,NULL,configMAX_PRIORITIES-1,NULL,1);
+  // the stack high water marks are reported by "?MEM:" in this order
+  axis_api.addTask(xTaskCreateStaticPinnedToCore(TaskReadAction,"TaskReadAction",READ_STACK_SIZE,NULL,2,xReadStack,&xReadTask,0));
+  axis_api.addTask(xTaskCreateStaticPinnedToCore(TaskReportStatus,"TaskReportStatus",REPORT_STACK_SIZE,NULL,2,xReportStack,&xReportTask,0));
+  axis_api.addTask(xTaskCreateStaticPinnedToCore(TaskExec,"TaskExec",EXEC_STACK_SIZE,NULL,configMAX_PRIORITIES-1,xExecStack,&xExecTask,1));
+  axis_api.addTask(xTaskCreateStaticPinnedToCore(TaskProgram,"TaskProgram",PROGRAM_STACK_SIZE,NULL,2,xProgramStack,&xProgramTask,0));
+
+  // network command endpoint: same API as the serial port
+  if( strlen(WIFI_SSID)>0 ){
+    WiFi.mode(WIFI_STA);
+    WiFi.setSleep(false); // modem sleep adds up to 100 ms of latency
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    axis_api.addTask(xTaskCreateStaticPinnedToCore(TaskNetwork,"TaskNetwork",NETWORK_STACK_SIZE,NULL,2,xNetworkStack,&xNetworkTask,0));
+  }
 }
 
 /****************** CORE 0 ******************/
@@ -98,9 +136,9 @@ void TaskReportStatus(void *pvParameters) {
       
       Serial.println(axis_api.request("?RA:"));
       
-      Serial.println("**** "+String(dt_exec)+"us ****");
+      Serial.print("**** "); Serial.print(dt_exec); Serial.println("us ****");
       if(flag_time_out) {
-        Serial.println("##### Time out "+String(flag_time_out)+"us");
+        Serial.print("##### Time out "); Serial.print(flag_time_out); Serial.println("us");
         flag_time_out = 0;
       }
       Serial.println("");
@@ -114,17 +152,57 @@ void TaskReportStatus(void *pvParameters) {
 // Tarea de lectura de comandos
 void TaskReadAction(void *pvParameters) {
   (void) pvParameters;
-  String str_out = "";
+  const char* str_out;
   for (;;) {
     if ( xSemaphoreTake( xSerialSemaphore, ( TickType_t ) 5 ) == pdTRUE ){
       if (Serial.available() > 0) {
-        str_out = axis_api.request( Serial.readStringUntil('\n') );
-        if( str_out!="" ) Serial.print(str_out);
+        serial_line[Serial.readBytesUntil('\n', serial_line, API_REQUEST_SIZE-1)] = '\0';
+        LATENCY_PROBE(PROBE_LINE);
+        str_out = axis_api.request( serial_line );
+        if( *str_out ) Serial.print(str_out);
+      }
+      str_out = axis_api.getEvents();
+      if( *str_out ){
+        Serial.print(str_out);
+        axis_network.publish(str_out); // events are sent to the subscribed connections too
       }
       xSemaphoreGive( xSerialSemaphore );
     }    
+    axis_api.persist(); // flash writes out of the real time task
     vTaskDelay(100);
   }
 }
+
+// Bytes recibidos por el puerto serie (tarea de eventos del driver)
+void SerialReceived() {
+  LATENCY_PROBE(PROBE_BYTE);
+}
+
+// Tarea de ejecución del programa almacenado
+void TaskProgram(void *pvParameters) {
+  (void) pvParameters;
+  for (;;) {
+    if ( xSemaphoreTake( xSerialSemaphore, ( TickType_t ) 5 ) == pdTRUE ){
+      axis_api.runProgram(); // same lock as request(): commands never interleave
+      xSemaphoreGive( xSerialSemaphore );
+    }
+    axis_api.sample(); // analog power input read out of the real time task
+    vTaskDelay(5);
+  }
+}
+
+// Tarea de atención de la red
+void TaskNetwork(void *pvParameters) {
+  (void) pvParameters;
+  bool listening = false;
+  for (;;) {
+    if( !listening ) listening = (WiFi.status()==WL_CONNECTED)&&(axis_network.begin(NET_PORT));
+    if ( (listening)&&(xSemaphoreTake( xSerialSemaphore, ( TickType_t ) 5 ) == pdTRUE) ){
+      axis_network.service(); // same lock as request(): commands never interleave
+      xSemaphoreGive( xSerialSemaphore );
+    }
+    vTaskDelay(1); // one tick: bounds the command latency and the telemetry period
+  }
+}
 /********************************************/
 /****************** CORE 1 ******************/
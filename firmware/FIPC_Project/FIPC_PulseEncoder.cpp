@@ -0,0 +1,200 @@
+/*! \file FIPC_PulseEncoder.cpp
+    \brief Codificación del perfil de un desplazamiento en símbolos de pulsos.
+*/
+
+#include "FIPC_PulseEncoder.h"
+
+#define PULSE_FRACTION      24                      /*!< Bits de fracción de los tiempos del crucero. */
+#define PULSE_ROUND         ((uint64_t)1<<(PULSE_FRACTION-1)) /*!< Medio tick en punto fijo. */
+#define PULSE_ACCEL_TICKS   2147483647.0            /*!< Duración máxima de la aceleración en ticks (T^2 en 64 bits). */
+#define PULSE_TRAVEL_TICKS  549755813888.0          /*!< Duración máxima del desplazamiento en ticks (2^39, crucero en 64 bits). */
+
+// Constructor.
+FIPC_PulseEncoder::FIPC_PulseEncoder(){
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Inicia la codificación de un desplazamiento.
+// Los coeficientes se calculan una única vez en doble precisión; fill() solo usa enteros.
+bool FIPC_PulseEncoder::start(uint32_t steps, float speed, float accel){
+  FIPC_PulseEncoder::close();
+  _done = true;
+  _total = 0;
+  if( (steps==0)||!(speed>0.0)||(speed>PULSE_MAX_RATE)||!(accel>0.0) ) return false;
+
+  const double f = PULSE_TICK_HZ;
+  // El período de crucero se redondea a 2^-24 ticks: el resto del perfil usa la velocidad
+  // efectiva para que el crucero continúe la aceleración sin saltos.
+  _period = (uint64_t)(f*(1<<PULSE_FRACTION)/speed + 0.5);
+  double v = f*(1<<PULSE_FRACTION)/_period;
+  double accelTicks = f*v/accel;
+  if( (accelTicks>PULSE_ACCEL_TICKS)||(f*(steps/v + v/accel)>PULSE_TRAVEL_TICKS) ) return false;
+
+  _accelK = _decelK = (uint64_t)(2.0*f*f/accel + 0.5);
+  double ramp = 0.5*v*v/accel; // pasos de la aceleración
+  if( 2.0*ramp<=steps ){       // alcanza la velocidad de crucero
+    _accelEnd = (uint32_t)ramp;
+    _decelStart = steps-_accelEnd;
+    _cruise0 = (uint64_t)(0.5*accelTicks*(1<<PULSE_FRACTION) + 0.5);
+    _end = (2*_cruise0 + (uint64_t)steps*_period + PULSE_ROUND)>>PULSE_FRACTION;
+  } else {                     // perfil triangular
+    _accelEnd = steps/2;
+    _decelStart = _accelEnd+1;
+    _cruise0 = 0;
+    _end = FIPC_PulseEncoder::isqrt64(2*(uint64_t)steps*_accelK);
+  }
+  _total = steps;
+  _step = 0;
+  _time = 0;
+  _nextStep = 0;
+  _done = false;
+
+  // La desaceleración resta de _end los instantes de la aceleración desde el paso _mirrorStep
+  if( _cache ){
+    _cacheMode = _cache->open(_accelK, _accelEnd, _reader);
+    _replay = (_cacheMode==FIPC_TrajectoryCache::TRAJECTORY_HIT);
+    _record = (_cacheMode==FIPC_TrajectoryCache::TRAJECTORY_RECORD);
+    _mirrorStep = _total-_decelStart;
+  }
+  return true;
+}
+
+// Inicia la desaceleración desde el último paso codificado.
+void FIPC_PulseEncoder::stop(float accel){
+  if( (_done)||(_step>=_decelStart) ) return;
+  uint32_t m = _step;
+  _nextStep = 0;
+  _replay = _record = false; // el frenado no es el de la tabla
+  if( m==0 ){ // todavía no se entregó ningún paso
+    _total = 0;
+    return;
+  }
+
+  // Pasos para frenar desde la velocidad del paso m: con la aceleración del desplazamiento
+  // son los mismos que llevó acelerar. Nunca se frena más suave que el desplazamiento, para
+  // no superar el destino.
+  uint32_t ramp = (m<_accelEnd) ? m : _accelEnd;
+  uint64_t k = _accelK;
+  if( accel>0.0 ){
+    uint64_t kStop = (uint64_t)(2.0*PULSE_TICK_HZ*(double)PULSE_TICK_HZ/accel + 0.5);
+    if( kStop<k ) k = kStop;
+  }
+  uint32_t brake = (uint32_t)((double)ramp*k/_accelK + 0.5);
+
+  uint64_t t = FIPC_PulseEncoder::timeAt(m);
+  _accelEnd = (m<_accelEnd) ? m : _accelEnd;
+  _decelStart = m+1;
+  _decelK = k;
+  _total = m+brake;
+  _end = t + FIPC_PulseEncoder::isqrt64(brake*k);
+}
+
+// Genera el próximo bloque de símbolos.
+uint16_t IRAM_ATTR FIPC_PulseEncoder::fill(uint32_t* out, uint16_t size, uint16_t &oSteps){
+  uint16_t n = 0;
+  oSteps = 0;
+  while( (n<size)&&(!_done) ){
+    if( _step>=_total ){ // nivel bajo luego del último pulso y símbolo de fin
+      out[n++] = PULSE_ITEM(PULSE_HIGH_TICKS,0,0,0);
+      _done = true;
+      break;
+    }
+    if( _nextStep!=_step+1 ){
+      _nextTime = FIPC_PulseEncoder::plan(_step+1);
+      _nextStep = _step+1;
+    }
+    uint64_t next = _nextTime;
+    uint64_t low = (next>_time) ? next-_time : 1;
+    if( low>PULSE_ITEM_MAX ){
+      // Intervalo largo: símbolos en bajo, dejando al menos un tick para el paso
+      uint64_t c = (low-1<2*PULSE_ITEM_MAX) ? low-1 : 2*PULSE_ITEM_MAX;
+      out[n++] = PULSE_ITEM(c/2,0,c-c/2,0);
+      _time += c;
+      continue;
+    }
+    out[n++] = PULSE_ITEM(low,0,PULSE_HIGH_TICKS,1);
+    _time += low+PULSE_HIGH_TICKS;
+    _step++;
+    oSteps++;
+  }
+  return n;
+}
+
+// Verifica si se generaron todos los símbolos.
+bool FIPC_PulseEncoder::done(){
+  return _done;
+}
+
+// Retorna la cantidad de pasos codificados.
+uint32_t FIPC_PulseEncoder::getSteps(){
+  return _step;
+}
+
+// Retorna la cantidad total de pasos del desplazamiento.
+uint32_t FIPC_PulseEncoder::getTotal(){
+  return _total;
+}
+
+// Retorna el instante del flanco ascendente del paso k.
+uint64_t IRAM_ATTR FIPC_PulseEncoder::timeAt(uint32_t k){
+  if( k<=_accelEnd )  return FIPC_PulseEncoder::isqrt64((uint64_t)k*_accelK);
+  if( k<_decelStart ) return (_cruise0 + (uint64_t)k*_period + PULSE_ROUND)>>PULSE_FRACTION;
+  return _end - FIPC_PulseEncoder::isqrt64((uint64_t)(_total-k)*_decelK);
+}
+
+// Raíz cuadrada entera por el método de dígitos binarios (sin divisiones).
+uint32_t IRAM_ATTR FIPC_PulseEncoder::isqrt64(uint64_t v){
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1<<62;
+  while( bit>v ) bit >>= 2;
+  while( bit ){
+    if( v>=root+bit ){
+      v -= root+bit;
+      root = (root>>1)+bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+// Libera la tabla del desplazamiento.
+void FIPC_PulseEncoder::close(){
+  if( _cacheMode!=FIPC_TrajectoryCache::TRAJECTORY_MISS ) _cache->close(_cacheMode);
+  _cacheMode = FIPC_TrajectoryCache::TRAJECTORY_MISS;
+  _replay = _record = false;
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Calcula el instante del flanco del próximo paso.
+// Con la tabla, la desaceleración recorre hacia atrás los instantes de la aceleración:
+// T(k) = Tfin - T(N-k) de la aceleración.
+uint64_t IRAM_ATTR FIPC_PulseEncoder::plan(uint32_t k){
+  if( !_replay ){
+    uint64_t t = FIPC_PulseEncoder::timeAt(k);
+    if( (_record)&&(k<=_accelEnd) ) _record = _cache->record((uint32_t)t);
+    return t;
+  }
+  if( k<=_accelEnd ){
+    FIPC_TrajectoryCache::forward(_reader);
+    if( k==_mirrorStep ){
+      _mirror = _reader;
+      FIPC_TrajectoryCache::reverse(_mirror);
+    }
+    return _reader.time;
+  }
+  if( k<_decelStart ) return FIPC_PulseEncoder::timeAt(k); // crucero
+  if( k>_decelStart ) FIPC_TrajectoryCache::backward(_mirror);
+  return _end-_mirror.time;
+}
+/* End: Private                           */
+/******************************************/
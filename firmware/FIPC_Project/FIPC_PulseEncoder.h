@@ -0,0 +1,183 @@
+/*! \file FIPC_PulseEncoder.h
+ *  \brief Clase que codifica el perfil de un desplazamiento en símbolos de pulsos.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_PulseEncoder_h
+#define FIPC_PulseEncoder_h
+
+#include "Arduino.h"
+#include "FIPC_TrajectoryCache.h"
+
+#define PULSE_TICK_HZ     10000000 /*!< Frecuencia de la base de tiempo de los símbolos (80 MHz / 8) en Hz. */
+#define PULSE_HIGH_TICKS  25       /*!< Duración del pulso en alto (2,5 us, el DRV8825 requiere 1,9 us). */
+#define PULSE_ITEM_MAX    32767    /*!< Duración máxima de medio símbolo en ticks. */
+#define PULSE_MAX_RATE    (PULSE_TICK_HZ/(2*PULSE_HIGH_TICKS)) /*!< Máxima frecuencia de pasos codificable en pasos/s. */
+
+//! Símbolo de dos mitades (duración, nivel) con el formato rmt_item32_t del ESP32.
+#define PULSE_ITEM(d0,l0,d1,l1) ( (uint32_t)(d0) | ((uint32_t)(l0)<<15) | ((uint32_t)(d1)<<16) | ((uint32_t)(l1)<<31) )
+
+//!  Clase que codifica el perfil de un desplazamiento en símbolos de pulsos.
+/*!
+ *   Traduce un desplazamiento de N pasos con aceleración, velocidad de crucero y
+ *   desaceleración en una secuencia de símbolos de duración y nivel que un periférico
+ *   (ver FIPC_PulseTrain) emite sin intervención del procesador. No depende del hardware:
+ *   el mismo código se compila en el host para verificar la cantidad de pasos y el instante
+ *   de cada flanco contra el perfil analítico.
+ *
+ *   \par Perfil
+ *   El flanco ascendente del paso k (k = 1..N) ocurre en el instante en que el perfil
+ *   continuo de aceleración constante alcanza la posición k:
+ *   \li Aceleración: T(k) = sqrt(2k/a).
+ *   \li Crucero: T(k) = v/(2a) + k/v.
+ *   \li Desaceleración: T(k) = Tfin - sqrt(2(N-k)/a).
+ *
+ *   Si la distancia no alcanza para llegar a la velocidad de crucero el perfil es
+ *   triangular. Los tiempos se calculan en ticks de PULSE_TICK_HZ con aritmética entera
+ *   (raíz cuadrada entera de 64 bits y crucero en punto fijo de 24 bits), por lo que cada
+ *   flanco difiere del perfil analítico en a lo sumo un tick y la velocidad no acumula error.
+ *
+ *   \par Símbolos
+ *   Cada paso es un símbolo {bajo, alto}: el nivel bajo completa el intervalo desde el paso
+ *   anterior y el alto dura PULSE_HIGH_TICKS. Los intervalos mayores a PULSE_ITEM_MAX se
+ *   completan con símbolos en bajo. El último paso se sigue de un símbolo con duración 0,
+ *   que indica el fin de la transmisión.
+ *
+ *   fill() genera los símbolos de a bloques a medida que el periférico los consume, por lo
+ *   que la longitud del desplazamiento no está limitada por la memoria.
+ *
+ *   \par Tablas
+ *   Con setCache() los instantes de la aceleración y la desaceleración se leen de la tabla
+ *   de la aceleración del desplazamiento, o se registran en ella la primera vez (ver
+ *   FIPC_TrajectoryCache). Los ticks son los mismos que con timeAt(). Luego de stop() el
+ *   frenado se calcula.
+*/
+class FIPC_PulseEncoder
+{
+  public:
+    //! Constructor.
+    FIPC_PulseEncoder();
+
+    //! Inicia la codificación de un desplazamiento.
+    /*!
+      \param steps Cantidad de pasos.
+      \param speed Velocidad de crucero en pasos/s (como máximo PULSE_MAX_RATE).
+      \param accel Aceleración en pasos/s^2.
+      \return false si los parámetros no son válidos.
+    */
+    bool start(uint32_t steps, float speed, float accel);
+
+    //! Inicia la desaceleración desde el último paso codificado.
+    /*!
+      Los símbolos ya entregados se emiten completos. Si ya está desacelerando no tiene efecto.
+      \param accel Aceleración de frenado en pasos/s^2, si es 0 se utiliza la del desplazamiento.
+    */
+    void stop(float accel = 0.0);
+
+    //! Genera el próximo bloque de símbolos.
+    /*!
+      \param out Destino de los símbolos (ver PULSE_ITEM()).
+      \param size Cantidad máxima de símbolos.
+      \param oSteps Cantidad de pasos incluidos en el bloque.
+      \return Cantidad de símbolos generados, menor que size solo al terminar.
+    */
+    uint16_t IRAM_ATTR fill(uint32_t* out, uint16_t size, uint16_t &oSteps);
+
+    //! Verifica si se generaron todos los símbolos.
+    /*!
+      \return true si se entregó el símbolo de fin.
+    */
+    bool done();
+
+    //! Retorna la cantidad de pasos codificados.
+    uint32_t getSteps();
+
+    //! Retorna la cantidad total de pasos del desplazamiento (se reduce con stop()).
+    uint32_t getTotal();
+
+    //! Retorna el instante del flanco ascendente de un paso.
+    /*!
+      \param k Número de paso (1..getTotal()).
+      \return El instante en ticks desde el inicio.
+    */
+    uint64_t IRAM_ATTR timeAt(uint32_t k);
+
+    //! Raíz cuadrada entera (truncada).
+    static uint32_t IRAM_ATTR isqrt64(uint64_t v);
+
+    //! Asigna las tablas de las rampas.
+    /*!
+      \param pCache Tablas compartidas por los ejes (NULL sin tablas).
+    */
+    void setCache(FIPC_TrajectoryCache* pCache) { _cache = pCache; }
+
+    //! Libera la tabla del desplazamiento.
+    /*!
+      Debe llamarse desde el proceso en tiempo real al terminar el desplazamiento; start()
+      la llama si quedó pendiente.
+    */
+    void close();
+
+  private:
+    uint32_t _total = 0; /*!< Cantidad total de pasos. */
+
+    uint32_t _step = 0; /*!< Pasos codificados. */
+
+    uint32_t _accelEnd = 0; /*!< Último paso de la aceleración. */
+
+    uint32_t _decelStart = 0; /*!< Primer paso de la desaceleración. */
+
+    uint64_t _accelK = 0; /*!< 2f^2/a de la aceleración en ticks^2 por paso. */
+
+    uint64_t _decelK = 0; /*!< 2f^2/a de la desaceleración en ticks^2 por paso. */
+
+    uint64_t _cruise0 = 0; /*!< Término constante del crucero en ticks con 24 bits de fracción. */
+
+    uint64_t _period = 0; /*!< Período de crucero en ticks con 24 bits de fracción. */
+
+    uint64_t _end = 0; /*!< Instante en ticks en que el perfil llega al reposo. */
+
+    uint64_t _time = 0; /*!< Instante en ticks del final del último símbolo entregado. */
+
+    bool _done = true; /*!< Se entregó el símbolo de fin. */
+
+    uint32_t _nextStep = 0; /*!< Paso de _nextTime (0 sin calcular). */
+
+    uint64_t _nextTime = 0; /*!< Instante del flanco del próximo paso en ticks. */
+
+    FIPC_TrajectoryCache* _cache = NULL; /*!< Tablas de las rampas. */
+
+    FIPC_TrajectoryCache::TrajectoryOpen _cacheMode = FIPC_TrajectoryCache::TRAJECTORY_MISS; /*!< Uso de la tabla en el desplazamiento. */
+
+    bool _replay = false; /*!< Los instantes de las rampas se leen de la tabla. */
+
+    bool _record = false; /*!< Los instantes de la aceleración se registran en la tabla. */
+
+    TrajectoryReader _reader; /*!< Cursor de la aceleración. */
+
+    TrajectoryReader _mirror; /*!< Cursor de la desaceleración. */
+
+    uint32_t _mirrorStep = 0; /*!< Paso de la aceleración con el instante que resta el primer paso de la desaceleración. */
+
+    //! Calcula el instante del flanco del próximo paso.
+    /*!
+      \param k Número de paso, consecutivo al anterior.
+      \return El instante en ticks desde el inicio.
+    */
+    uint64_t IRAM_ATTR plan(uint32_t k);
+};
+#endif
@@ -0,0 +1,176 @@
+/*! \file FIPC_PulseTrain.cpp
+    \brief Emisión de los pulsos de un desplazamiento con el periférico RMT del ESP32.
+*/
+
+#include "FIPC_PulseTrain.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "driver/rmt.h"
+#include "soc/rmt_struct.h"
+#include "esp32-hal-matrix.h"
+
+#define PULSE_CLK_DIV   8 /*!< Divisor del reloj APB de 80 MHz (ver PULSE_TICK_HZ). */
+#define PULSE_INT_THR   24 /*!< Primer bit de las interrupciones de umbral en RMT.int_st. */
+
+FIPC_PulseTrain* FIPC_PulseTrain::_channels[PULSE_CHANNELS];
+portMUX_TYPE FIPC_PulseTrain::_mux = portMUX_INITIALIZER_UNLOCKED;
+static rmt_isr_handle_t pulseIsrHandle = NULL; /*!< Rutina de interrupción compartida por los canales. */
+#endif
+
+// Constructor.
+FIPC_PulseTrain::FIPC_PulseTrain(){
+  _halfSteps[0] = _halfSteps[1] = 0;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura el canal.
+// No se instala el driver de RMT: la memoria del canal y las interrupciones se manejan
+// directamente para poder completar el bloque mientras se emite.
+bool FIPC_PulseTrain::begin(uint8_t channel, uint8_t pinStep){
+  if( (_running)||(channel>=PULSE_CHANNELS) ) return false;
+  _pin = pinStep;
+#if defined(ARDUINO_ARCH_ESP32)
+  rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pinStep, (rmt_channel_t)channel);
+  config.clk_div = PULSE_CLK_DIV;
+  config.mem_block_num = 1;
+  config.tx_config.idle_output_en = true;
+  config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+  if( rmt_config(&config)!=ESP_OK ) return false;
+  if( (pulseIsrHandle==NULL)&&(rmt_isr_register(FIPC_PulseTrain::isr, NULL, ESP_INTR_FLAG_IRAM, &pulseIsrHandle)!=ESP_OK) ) return false;
+  RMT.apb_conf.fifo_mask = 1;       // acceso directo a la memoria del canal
+  RMT.apb_conf.mem_tx_wrap_en = 1;  // el bloque se emite en forma circular
+  rmt_set_tx_thr_intr_en((rmt_channel_t)channel, true, PULSE_HALF_ITEMS);
+  rmt_set_tx_intr_en((rmt_channel_t)channel, true);
+  _channels[channel] = this;
+#endif
+  _channel = channel;
+  _attached = true;
+  FIPC_PulseTrain::release();
+  return true;
+}
+
+// Inicia un desplazamiento.
+bool FIPC_PulseTrain::start(uint32_t steps, float speed, float accel){
+  if( (_channel>=PULSE_CHANNELS)||(_running) ) return false;
+  if( !_encoder.start(steps, speed, accel) ) return false;
+  _sent = 0;
+  _half = 0;
+#if defined(ARDUINO_ARCH_ESP32)
+  FIPC_PulseTrain::load(0);
+  FIPC_PulseTrain::load(1);
+  rmt_set_gpio((rmt_channel_t)_channel, RMT_MODE_TX, (gpio_num_t)_pin, false);
+  _attached = true;
+  _running = true;
+  rmt_tx_start((rmt_channel_t)_channel, true);
+#else
+  _count = _index = 0;
+  _clock = 0;
+  _startTime = micros();
+  _attached = true;
+  _running = true;
+#endif
+  return true;
+}
+
+// Inicia la desaceleración.
+void FIPC_PulseTrain::stop(float accel){
+#if defined(ARDUINO_ARCH_ESP32)
+  portENTER_CRITICAL(&_mux);
+  _encoder.stop(accel);
+  portEXIT_CRITICAL(&_mux);
+#else
+  _encoder.stop(accel);
+#endif
+}
+
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+bool FIPC_PulseTrain::run(uint32_t &oSteps){
+#if !defined(ARDUINO_ARCH_ESP32)
+  // Emulación: se consumen los símbolos cuyo final ya transcurrió
+  uint64_t now = (uint64_t)(micros()-_startTime)*(PULSE_TICK_HZ/1000000);
+  while( _running ){
+    if( _index>=_count ){
+      _count = _encoder.fill(_items, PULSE_HALF_ITEMS, _halfSteps[0]);
+      _index = 0;
+      if( _count==0 ){
+        _running = false;
+        break;
+      }
+    }
+    uint32_t item = _items[_index];
+    uint32_t duration = (item&PULSE_ITEM_MAX) + ((item>>16)&PULSE_ITEM_MAX);
+    if( ((item&PULSE_ITEM_MAX)==0)||(((item>>16)&PULSE_ITEM_MAX)==0) ){ // símbolo de fin
+      _running = false;
+      break;
+    }
+    if( _clock+duration>now ) break;
+    _clock += duration;
+    if( item>>31 ) _sent++;
+    _index++;
+  }
+#endif
+  oSteps = _sent;
+  if( _running ) return true;
+  if( _attached ){
+    FIPC_PulseTrain::release();
+    _encoder.close();
+  }
+  return false;
+}
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Devuelve la GPIO a la generación por software.
+void FIPC_PulseTrain::release(){
+#if defined(ARDUINO_ARCH_ESP32)
+  pinMatrixOutDetach(_pin, false, false);
+#endif
+  pinMode(_pin, OUTPUT);
+  digitalWrite(_pin, LOW);
+  _attached = false;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// Completa una mitad del bloque del canal.
+// Si el codificador terminó, un símbolo de duración 0 evita que se repita la mitad anterior.
+void IRAM_ATTR FIPC_PulseTrain::load(uint8_t half){
+  uint32_t items[PULSE_HALF_ITEMS];
+  uint16_t n = _encoder.fill(items, PULSE_HALF_ITEMS, _halfSteps[half]);
+  volatile rmt_item32_t* mem = &RMTMEM.chan[_channel].data32[half*PULSE_HALF_ITEMS];
+  for( uint16_t i=0; i<n; i++ ) mem[i].val = items[i];
+  if( n<PULSE_HALF_ITEMS ) mem[n].val = 0;
+}
+
+// Atención de la interrupción del periférico RMT.
+// Umbral: se emitió la mitad _half, se suman sus pasos y se vuelve a completar.
+// Fin: se emitieron todos los pasos codificados.
+void IRAM_ATTR FIPC_PulseTrain::isr(void* arg){
+  uint32_t status = RMT.int_st.val;
+  RMT.int_clr.val = status;
+  for( uint8_t ch=0; ch<PULSE_CHANNELS; ch++ ){
+    FIPC_PulseTrain* train = _channels[ch];
+    if( (train==NULL)||(!train->_running) ) continue;
+    portENTER_CRITICAL_ISR(&_mux);
+    if( status&(1<<(PULSE_INT_THR+ch)) ){
+      train->_sent += train->_halfSteps[train->_half];
+      train->load(train->_half);
+      train->_half ^= 1;
+    }
+    if( status&(1<<(3*ch)) ){
+      train->_sent = train->_encoder.getSteps();
+      train->_running = false;
+    }
+    portEXIT_CRITICAL_ISR(&_mux);
+  }
+}
+#endif
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,134 @@
+/*! \file FIPC_PulseTrain.h
+ *  \brief Clase que emite los pulsos de un desplazamiento con el periférico RMT del ESP32.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_PulseTrain_h
+#define FIPC_PulseTrain_h
+
+#include "Arduino.h"
+#include "FIPC_PulseEncoder.h"
+
+#define PULSE_CHANNELS    8  /*!< Canales RMT del ESP32 (uno por eje). */
+#define PULSE_HALF_ITEMS  32 /*!< Símbolos de cada mitad del bloque de memoria del canal (64 en total). */
+
+//!  Clase que emite los pulsos de un desplazamiento con el periférico RMT del ESP32.
+/*!
+ *   Alternativa a la generación de pasos por software de AccelStepper para los
+ *   desplazamientos de FIPC_Axis (opción CONFIG_PULSE_RMT de FIPC_Config): el canal RMT
+ *   emite los símbolos que genera FIPC_PulseEncoder sin intervención del procesador, lo que
+ *   permite frecuencias de hasta CONFIG_MAX_PULSE_RATE.
+ *
+ *   \par Doble buffer
+ *   El bloque de memoria del canal (64 símbolos) se usa como dos mitades circulares. La
+ *   interrupción de umbral avisa cada vez que se emitió una mitad, que se vuelve a completar
+ *   con los próximos símbolos mientras se emite la otra; la de fin avisa que se emitió el
+ *   símbolo de duración 0. Ambas las atiende una única rutina en IRAM para todos los canales.
+ *
+ *   \par Posición
+ *   Los pasos emitidos se cuentan por mitad de bloque: run() informa la posición con una
+ *   granularidad de PULSE_HALF_ITEMS pasos durante el desplazamiento y exacta al terminar.
+ *
+ *   En el host (sin RMT) los símbolos se consumen según micros(), con la misma
+ *   granularidad de bloques, para ejecutar el firmware con los mismos tiempos.
+*/
+class FIPC_PulseTrain
+{
+  public:
+    //! Constructor.
+    FIPC_PulseTrain();
+
+    //! Configura el canal.
+    /*!
+      Al terminar la GPIO queda como salida digital para la generación por software.
+      \param channel Canal RMT (0 a PULSE_CHANNELS-1).
+      \param pinStep GPIO de pulsos.
+      \return false si el canal no pudo configurarse.
+    */
+    bool begin(uint8_t channel, uint8_t pinStep);
+
+    //! Inicia un desplazamiento.
+    /*!
+      La GPIO de dirección debe estar configurada.
+      \param steps Cantidad de pasos.
+      \param speed Velocidad de crucero en pasos/s.
+      \param accel Aceleración en pasos/s^2.
+      \return false si no está configurado, hay un desplazamiento en curso o el perfil no es válido.
+    */
+    bool start(uint32_t steps, float speed, float accel);
+
+    //! Inicia la desaceleración (ver FIPC_PulseEncoder::stop()).
+    /*!
+      \param accel Aceleración de frenado en pasos/s^2, si es 0 se utiliza la del desplazamiento.
+    */
+    void stop(float accel = 0.0);
+
+    //! Atiende el desplazamiento en curso.
+    /*!
+      Debe llamarse desde el proceso en tiempo real. Al terminar devuelve la GPIO a la
+      generación por software.
+      \param oSteps Pasos emitidos desde el inicio.
+      \return false cuando terminó el desplazamiento.
+    */
+    bool run(uint32_t &oSteps);
+
+    //! Asigna las tablas de las rampas (ver FIPC_PulseEncoder::setCache()).
+    void setCache(FIPC_TrajectoryCache* pCache) { _encoder.setCache(pCache); }
+
+  private:
+    FIPC_PulseEncoder _encoder; /*!< Codificador del perfil. */
+
+    uint8_t _channel = PULSE_CHANNELS; /*!< Canal RMT (PULSE_CHANNELS sin configurar). */
+
+    uint8_t _pin; /*!< GPIO de pulsos. */
+
+    volatile bool _running = false; /*!< Desplazamiento en curso. */
+
+    bool _attached = false; /*!< La GPIO está conectada al canal. */
+
+    volatile uint32_t _sent = 0; /*!< Pasos emitidos. */
+
+    uint16_t _halfSteps[2]; /*!< Pasos de cada mitad del bloque. */
+
+    uint8_t _half = 0; /*!< Mitad del bloque que se está emitiendo. */
+
+#if defined(ARDUINO_ARCH_ESP32)
+    static FIPC_PulseTrain* _channels[PULSE_CHANNELS]; /*!< Objeto de cada canal, para la interrupción. */
+
+    static portMUX_TYPE _mux; /*!< Exclusión entre stop() y la interrupción. */
+
+    //! Completa una mitad del bloque del canal.
+    void IRAM_ATTR load(uint8_t half);
+
+    //! Atención de la interrupción del periférico RMT.
+    static void IRAM_ATTR isr(void* arg);
+#else
+    uint32_t _items[PULSE_HALF_ITEMS]; /*!< Símbolos a emitir. */
+
+    uint16_t _count = 0; /*!< Cantidad de símbolos a emitir. */
+
+    uint16_t _index = 0; /*!< Próximo símbolo a emitir. */
+
+    uint64_t _clock = 0; /*!< Ticks emitidos. */
+
+    unsigned long _startTime = 0; /*!< Instante en us del inicio. */
+#endif
+
+    //! Devuelve la GPIO a la generación por software.
+    void release();
+};
+#endif
@@ -0,0 +1,113 @@
+/*! \file FIPC_Recorder.cpp
+    \brief Registro de las solicitudes y los cambios de estado de una sesión.
+*/
+
+#include "FIPC_Recorder.h"
+
+// Constructor.
+FIPC_Recorder::FIPC_Recorder(FIPC_Axis* pAxis[], uint8_t iAxisNumbers) {
+  _axisList = pAxis;
+  _axisNumbers = min(iAxisNumbers, (uint8_t)RECORDER_AXIS_NUMBERS);
+  for(uint8_t i = 0; i<RECORDER_AXIS_NUMBERS; i++) _status[i] = NULL;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Inicia una grabación.
+void FIPC_Recorder::start(){
+  _recording = false;
+  _size = 0;
+  _records = _dropped = 0;
+  _cycles = _execMax = _execSlow = 0;
+  _execSum = 0;
+  _startTime = micros();
+  for(uint8_t i = 0; i<_axisNumbers; i++){
+    uint8_t head[5];
+    float position = _axisList[i]->getCurrentPosition();
+    head[0] = i+1;
+    memcpy(&head[1], &position, sizeof(position));
+    _status[i] = _axisList[i]->getStatus();
+    FIPC_Recorder::write(REC_AXIS, head, sizeof(head), _status[i], strlen(_status[i]));
+  }
+  _recording = true;
+}
+
+// Detiene la grabación.
+void FIPC_Recorder::stop(){
+  _recording = false;
+}
+
+// Registra una solicitud.
+void FIPC_Recorder::request(const char* text){
+  if( !_recording ) return;
+  if( (!strncmp(text, "REC:", 4))||(!strncmp(text, "?REC", 4)) ) return;
+  FIPC_Recorder::write(REC_REQUEST, NULL, 0, text, strlen(text));
+}
+
+// Registra el ciclo de tiempo real y los cambios de estado de los ejes.
+// Los estados se comparan por puntero: getStatus() retorna textos constantes.
+void FIPC_Recorder::exec(uint32_t elapsed){
+  if( !_recording ) return;
+  _cycles++;
+  _execSum += elapsed;
+  if( elapsed>_execMax ) _execMax = elapsed;
+  if( elapsed>RECORDER_EXEC_LIMIT ){
+    _execSlow++;
+    uint16_t duration = min(elapsed, (uint32_t)0xFFFF);
+    FIPC_Recorder::write(REC_EXEC, &duration, sizeof(duration), NULL, 0);
+  }
+  for(uint8_t i = 0; i<_axisNumbers; i++){
+    const char* status = _axisList[i]->getStatus();
+    if( status==_status[i] ) continue;
+    _status[i] = status;
+    uint8_t id = i+1;
+    FIPC_Recorder::write(REC_STATE, &id, 1, status, strlen(status));
+  }
+}
+
+// Solicita un reporte de la grabación.
+void FIPC_Recorder::getReport(FIPC_Text &out){
+  out.add(_recording ? "1;" : "0;").add((unsigned int)_size).add(';');
+  out.add((unsigned long)_records).add(';').add((unsigned long)_dropped).add(';');
+  out.add((unsigned long)_cycles).add(';').add(_cycles ? (double)_execSum/_cycles : 0.0, 1).add(';');
+  out.add((unsigned long)_execMax).add(';').add((unsigned long)_execSlow);
+}
+
+// Escribe un tramo del registro en hexadecimal.
+void FIPC_Recorder::getData(uint16_t offset, FIPC_Text &out){
+  static const char digits[] = "0123456789ABCDEF";
+  uint16_t size = _size;
+  for(uint16_t i = offset; (i<size)&&(i<offset+RECORDER_CHUNK); i++)
+    out.add(digits[_log[i]>>4]).add(digits[_log[i]&0x0F]);
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Agrega un registro.
+void FIPC_Recorder::write(uint8_t type, const void* head, uint8_t headSize, const void* data, uint16_t dataSize){
+  uint32_t now = micros()-_startTime;
+  uint8_t size = min((uint16_t)(headSize+dataSize), (uint16_t)255);
+  portENTER_CRITICAL(&_mux);
+  if( _size+RECORDER_HEADER+size>RECORDER_SIZE ){
+    _dropped++;
+    portEXIT_CRITICAL(&_mux);
+    return;
+  }
+  uint8_t* p = &_log[_size];
+  memcpy(p, &now, sizeof(now));
+  p[4] = type;
+  p[5] = size;
+  if( headSize ) memcpy(p+RECORDER_HEADER, head, headSize);
+  if( size>headSize ) memcpy(p+RECORDER_HEADER+headSize, data, size-headSize);
+  _size += RECORDER_HEADER+size;
+  _records++;
+  portEXIT_CRITICAL(&_mux);
+}
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,149 @@
+/*! \file FIPC_Recorder.h
+ *  \brief Clase que registra las solicitudes y los cambios de estado de una sesión.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Recorder_h
+#define FIPC_Recorder_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+#include "FIPC_Text.h"
+
+#define RECORDER_SIZE        16384 /*!< Bytes del registro. */
+#define RECORDER_CHUNK       256   /*!< Bytes por respuesta de "?RECD:". */
+#define RECORDER_AXIS_NUMBERS 8    /*!< Cantidad máxima de ejes registrados. */
+#define RECORDER_EXEC_LIMIT  80    /*!< Tiempo de exec() en us a partir del cual se registra el ciclo (EXEC_TIME_OUT del programa principal). */
+#define RECORDER_HEADER      6     /*!< Bytes del encabezado de cada registro. */
+
+//!  Clase que registra las solicitudes y los cambios de estado de una sesión.
+/*!
+ *   Registro binario en RAM para reproducir una sesión en el emulador (ver
+ *   python_lib/module_session.py). Cada registro tiene un encabezado de RECORDER_HEADER
+ *   bytes en little-endian: instante en us desde start() (uint32), tipo (uint8) y
+ *   cantidad de bytes de datos (uint8), seguido de los datos:
+ *   \li REC_AXIS: estado inicial de un eje (eje, posición float y estado en texto), uno
+ *   por eje al iniciar.
+ *   \li REC_REQUEST: texto de una solicitud recibida por request().
+ *   \li REC_STATE: cambio de estado de un eje (eje y estado en texto, ver FIPC_Axis::getStatus()).
+ *   \li REC_EXEC: ciclo de exec() de más de RECORDER_EXEC_LIMIT us (duración en us, uint16).
+ *
+ *   Las solicitudes se registran desde el núcleo 0 y los estados y ciclos desde la tarea
+ *   de tiempo real, por lo que la escritura se hace en una sección crítica. Cuando el
+ *   registro se llena se dejan de agregar registros (se conserva el comienzo de la sesión,
+ *   necesario para reproducirla) y se cuentan los descartados.
+ *
+ *   Sin grabar el costo en exec() es una comparación: las estadísticas de tiempo de ciclo
+ *   y los estados solo se calculan durante la grabación.
+*/
+class FIPC_Recorder
+{
+  public:
+    //! Tipos de registro.
+    typedef enum {REC_AXIS,    /*!< Estado inicial de un eje. */
+                  REC_REQUEST, /*!< Solicitud. */
+                  REC_STATE,   /*!< Cambio de estado de un eje. */
+                  REC_EXEC     /*!< Ciclo de tiempo real que excedió RECORDER_EXEC_LIMIT. */
+    }RecordType;
+
+    //! Constructor.
+    /*!
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista.
+     */
+    FIPC_Recorder(FIPC_Axis* pAxis[], uint8_t iAxisNumbers);
+
+    //! Inicia una grabación.
+    /*!
+      Descarta el registro anterior y agrega el estado inicial de los ejes.
+    */
+    void start();
+
+    //! Detiene la grabación.
+    void stop();
+
+    //! Verifica si hay una grabación en curso.
+    bool isRecording() { return _recording; }
+
+    //! Registra una solicitud.
+    /*!
+      No se registran las solicitudes de este registro ("REC:", "?REC:" y "?RECD:").
+      \param text Texto de la solicitud.
+    */
+    void request(const char* text);
+
+    //! Registra el ciclo de tiempo real y los cambios de estado de los ejes.
+    /*!
+      Debe llamarse al final de cada ciclo de exec() durante la grabación.
+      \param elapsed Duración del ciclo en us.
+    */
+    void exec(uint32_t elapsed);
+
+    //! Solicita un reporte de la grabación.
+    /*!
+      \param out Texto donde se agrega "grabando;bytes;registros;descartados;ciclos;exec medio
+      en us;exec máximo en us;ciclos de más de RECORDER_EXEC_LIMIT us".
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Escribe un tramo del registro en hexadecimal.
+    /*!
+      \param offset Posición del tramo en bytes.
+      \param out Texto donde se agregan hasta RECORDER_CHUNK bytes.
+    */
+    void getData(uint16_t offset, FIPC_Text &out);
+
+  private:
+    FIPC_Axis** _axisList; /*!< Lista de ejes del controlador. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes en la lista. */
+
+    uint8_t _log[RECORDER_SIZE]; /*!< Registro. */
+
+    volatile uint16_t _size = 0; /*!< Bytes del registro. */
+
+    volatile bool _recording = false; /*!< Grabación en curso. */
+
+    unsigned long _startTime = 0; /*!< Instante en us del inicio. */
+
+    uint32_t _records = 0; /*!< Registros agregados. */
+
+    uint32_t _dropped = 0; /*!< Registros descartados. */
+
+    uint32_t _cycles = 0; /*!< Ciclos de tiempo real registrados. */
+
+    uint64_t _execSum = 0; /*!< Suma de la duración de los ciclos en us. */
+
+    uint32_t _execMax = 0; /*!< Duración máxima de un ciclo en us. */
+
+    uint32_t _execSlow = 0; /*!< Ciclos de más de RECORDER_EXEC_LIMIT us. */
+
+    const char* _status[RECORDER_AXIS_NUMBERS]; /*!< Último estado registrado de cada eje. */
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED; /*!< Exclusión entre los núcleos. */
+
+    //! Agrega un registro.
+    /*!
+      \param type Tipo de registro.
+      \param head Primera parte de los datos.
+      \param headSize Bytes de la primera parte.
+      \param data Segunda parte de los datos.
+      \param dataSize Bytes de la segunda parte (se trunca a 255 bytes en total).
+    */
+    void write(uint8_t type, const void* head, uint8_t headSize, const void* data, uint16_t dataSize);
+};
+#endif
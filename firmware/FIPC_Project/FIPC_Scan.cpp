@@ -0,0 +1,257 @@
+/*! \file FIPC_Scan.cpp
+    \brief Clase que implementa barridos parametrizados con salida de disparo.
+*/
+
+#include "FIPC_Scan.h"
+
+#define NO_PIN 0xFF /*!< Identificador de GPIO sin asignar. */
+
+// Constructor.
+FIPC_Scan::FIPC_Scan(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Budget* pBudget) {
+  _axisList = pAxis;
+  _axisNumbers = iAxisNumbers;
+  _budget = pBudget;
+  for(uint8_t i = 0; i<SCAN_AXIS_NUMBERS; i++) _axis[i] = NULL;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura el barrido.
+bool FIPC_Scan::setScan(uint8_t type, uint8_t id[], float start[], float pitch[], uint16_t points[], float speed){
+  if( (_status==SCAN_MOVE)||(_status==SCAN_LINE) ) return false;
+  if( type>SCAN_SPIRAL ) return false;
+  if( speed<=0.0 ) return false;
+
+  // Los ejes A y B son obligatorios, C es opcional (id = 0)
+  for(uint8_t i = 0; i<SCAN_AXIS_NUMBERS; i++){
+    if( (i==SCAN_AXIS_NUMBERS-1)&&(id[i]==0) ) continue;
+    if( (id[i]==0)||(id[i]>_axisNumbers)||(points[i]==0) ) return false;
+    for(uint8_t j = 0; j<i; j++) if( id[i]==id[j] ) return false;
+  }
+
+  for(uint8_t i = 0; i<SCAN_AXIS_NUMBERS; i++){
+    _axis[i]   = (id[i]) ? _axisList[id[i]-1] : NULL;
+    _start[i]  = start[i];
+    _pitch[i]  = pitch[i];
+    _points[i] = (id[i]) ? points[i] : 1;
+  }
+  _type  = (ScanType)type;
+  _speed = speed;
+  _configured = true;
+  _status = SCAN_IDLE;
+  return true;
+}
+
+// Configura la salida de disparo.
+void FIPC_Scan::setTrigger(uint8_t pin, uint16_t widthUs){
+  _trigPin = pin;
+  _trigWidth = widthUs;
+  if( _trigPin!=NO_PIN ){
+    pinMode(_trigPin, OUTPUT);
+    digitalWrite(_trigPin, LOW);
+  }
+}
+
+// Inicia el barrido configurado.
+bool FIPC_Scan::start(){
+  if( !_configured ) return false;
+  if( (_status==SCAN_MOVE)||(_status==SCAN_LINE) ) return false;
+  if( !FIPC_Scan::axisReady() ) return false;
+  if( !_axis[0]->setSpeed(_speed) ) return false;
+
+  _index = 0;
+  _theta = 0.0;
+  _triggers = 0;
+  _missed = 0;
+  _finished = false;
+  if( _type==SCAN_SPIRAL ) _total = (uint32_t)_points[0]*_points[2];
+  else                     _total = (uint32_t)_points[1]*_points[2];
+
+  if( !FIPC_Scan::moveToCurrent() ) return false;
+  _status = SCAN_MOVE;
+  return true;
+}
+
+// Cancela el barrido en ejecución.
+void FIPC_Scan::stop(){
+  if( (_status!=SCAN_MOVE)&&(_status!=SCAN_LINE) ) return;
+  for(uint8_t i = 0; i<SCAN_AXIS_NUMBERS; i++)
+    if( _axis[i] ) _axis[i]->setAction(FIPC_Axis::ACTION_STOP);
+  _status = SCAN_ABORTED;
+  _finished = true;
+}
+
+// Retorna el estado del barrido.
+uint8_t FIPC_Scan::getStatus(){ return _status;}
+
+// Solicita un reporte del barrido.
+void FIPC_Scan::getReport(FIPC_Text &out){
+  switch(_status){
+    case SCAN_IDLE:    out.add("Idle");    break;
+    case SCAN_MOVE:    out.add("Moving");  break;
+    case SCAN_LINE:    out.add("Line");    break;
+    case SCAN_DONE:    out.add("Done");    break;
+    case SCAN_ABORTED: out.add("Aborted"); break;
+  }
+  out.add(';').add(_index);
+  out.add(';').add(_triggers);
+  out.add(';').add(_missed);
+}
+
+// Consulta si el barrido terminó desde la última consulta.
+bool FIPC_Scan::finished(){
+  if( !_finished ) return false;
+  _finished = false;
+  return true;
+}
+
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+void FIPC_Scan::exec(){
+  // Finaliza el pulso de disparo
+  if( (_trigHigh)&&((micros()-_trigTime)>=_trigWidth) ){
+    digitalWrite(_trigPin, LOW);
+    _trigHigh = false;
+  }
+
+  // 1° Recorre una línea disparando en cada punto de la grilla
+  if( _status==SCAN_LINE ){
+    long current = _axis[0]->getCurrentSteps();
+    if( (_lineTrigger<_points[0])&&(FIPC_Scan::reached(current)) ){
+      FIPC_Scan::fire();
+      FIPC_Scan::nextPoint();
+      // Un único disparo por ciclo: los demás puntos alcanzados en el mismo ciclo se pierden
+      while( (_lineTrigger<_points[0])&&(FIPC_Scan::reached(current)) ){
+        _missed++;
+        FIPC_Scan::nextPoint();
+      }
+    }
+    if( !FIPC_Scan::axisReady() ) return;
+
+    // El eje se detuvo antes del final de la línea (parada externa)
+    if( current!=_axis[0]->unitsToSteps(FIPC_Scan::lineEdge(true)) ){
+      _status = SCAN_ABORTED;
+      _finished = true;
+      return;
+    }
+    _missed += _points[0]-_lineTrigger;
+
+    if( ++_index>=_total ){
+      _status = SCAN_DONE;
+      _finished = true;
+    } else if( FIPC_Scan::moveToCurrent() ) {
+      _status = SCAN_MOVE;
+    } else {
+      FIPC_Scan::stop();
+    }
+    return;
+  }
+
+  // 2° Espera llegar al inicio de la línea o al punto de la espiral
+  if( _status==SCAN_MOVE ){
+    if( !FIPC_Scan::axisReady() ) return;
+    FIPC_Scan::fire();
+
+    if( _type==SCAN_SPIRAL ){
+      // Avanza sobre la espiral manteniendo la separación entre puntos
+      float radius = abs(_pitch[0])*_theta/(2.0*PI);
+      _theta += abs(_pitch[1])/max(radius, (float)abs(_pitch[1]));
+      if( ++_index>=_total ){
+        _status = SCAN_DONE;
+        _finished = true;
+      } else if( !FIPC_Scan::moveToCurrent() ) {
+        FIPC_Scan::stop();
+      }
+      return;
+    }
+
+    // Barrido por líneas: el primer disparo es el inicio de la línea
+    long first = _axis[0]->unitsToSteps(FIPC_Scan::lineEdge(false));
+    long last  = _axis[0]->unitsToSteps(FIPC_Scan::lineEdge(true));
+    _lineForward = (last>=first);
+    _lineTrigger = 0;
+    FIPC_Scan::nextPoint();
+    if( first==last ){ // la línea entera cabe en un paso
+      _missed += _points[0]-_lineTrigger;
+      _lineTrigger = _points[0];
+    }
+
+    float edge = FIPC_Scan::lineEdge(true);
+    if( _budget->setAction(_axis, 1, FIPC_Axis::ACTION_MOVE_ABSOLUTE, &edge, true) ) _status = SCAN_LINE;
+    else FIPC_Scan::stop();
+    return;
+  }
+}
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Emite un pulso de disparo.
+void FIPC_Scan::fire(){
+  _triggers++;
+  if( _trigPin==NO_PIN ) return;
+  digitalWrite(_trigPin, HIGH);
+  _trigHigh = true;
+  _trigTime = micros();
+}
+
+// Verifica si todos los ejes del barrido están en espera.
+bool FIPC_Scan::axisReady(){
+  for(uint8_t i = 0; i<SCAN_AXIS_NUMBERS; i++)
+    if( (_axis[i])&&(!_axis[i]->isReady()) ) return false;
+  return true;
+}
+
+// Avanza al punto siguiente de la línea actual.
+// La posición en pasos se calcula para cada punto desde el inicio de la línea, sin
+// acumular el error de redondeo del paso.
+void FIPC_Scan::nextPoint(){
+  if( ++_lineTrigger>=_points[0] ) return;
+  bool reverse = (_type==SCAN_SERPENTINE)&&(_index&1);
+  uint16_t k = reverse ? _points[0]-1-_lineTrigger : _lineTrigger;
+  _nextStep = _axis[0]->unitsToSteps(_start[0]+k*_pitch[0]);
+}
+
+// Verifica si el eje A alcanzó el próximo punto de la línea.
+bool FIPC_Scan::reached(long current){
+  return _lineForward ? (current>=_nextStep) : (current<=_nextStep);
+}
+
+// Posición del eje A al inicio o final de la línea actual.
+float FIPC_Scan::lineEdge(bool end){
+  bool reverse = (_type==SCAN_SERPENTINE)&&(_index&1);
+  if( end!=reverse ) return _start[0]+(_points[0]-1)*_pitch[0];
+  return _start[0];
+}
+
+// Ordena el desplazamiento al inicio de la línea o al punto actual.
+bool FIPC_Scan::moveToCurrent(){
+  float target[SCAN_AXIS_NUMBERS];
+
+  if( _type==SCAN_SPIRAL ){
+    if( (_index%_points[0])==0 ) _theta = 0.0; // nuevo plano
+    float radius = abs(_pitch[0])*_theta/(2.0*PI);
+    target[0] = _start[0] + radius*cos(_theta);
+    target[1] = _start[1] + radius*sin(_theta);
+    target[2] = _start[2] + (_index/_points[0])*_pitch[2];
+  } else {
+    target[0] = FIPC_Scan::lineEdge(false);
+    target[1] = _start[1] + (_index%_points[1])*_pitch[1];
+    target[2] = _start[2] + (_index/_points[1])*_pitch[2];
+  }
+
+  // Primero verifica que todos los desplazamientos puedan realizarse y que entren
+  // en el presupuesto de pasos
+  for(uint8_t i = 0; i<SCAN_AXIS_NUMBERS; i++)
+    if( (_axis[i])&&(!_axis[i]->canMoveAbsolute(target[i])) ) return false;
+  return _budget->setAction(_axis, SCAN_AXIS_NUMBERS, FIPC_Axis::ACTION_MOVE_ABSOLUTE, target, true);
+}
+
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,211 @@
+/*! \file FIPC_Scan.h
+ *  \brief Clase que implementa barridos parametrizados con salida de disparo.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Scan_h
+#define FIPC_Scan_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+#include "FIPC_Budget.h"
+
+#define SCAN_AXIS_NUMBERS 3 /*!< Cantidad máxima de ejes que participan de un barrido. */
+
+//!  Clase que implementa barridos parametrizados sobre 2 o 3 ejes.
+/*!
+ *   El barrido se configura una única vez con setScan() y luego se ejecuta
+ *   completamente en el controlador desde el proceso en tiempo real, sin
+ *   intervención del host entre puntos.
+ *
+ *   \par Ejes del barrido
+ *   El eje A es el eje rápido, el eje B el lento y el eje C (opcional) define
+ *   planos sucesivos. Cada eje se describe con la posición inicial, el paso y
+ *   la cantidad de puntos.
+ *
+ *   \par Tipos de barrido
+ *   \li FIPC_Scan::SCAN_RASTER Todas las líneas se recorren en el mismo sentido.
+ *   \li FIPC_Scan::SCAN_SERPENTINE Las líneas alternan el sentido de recorrido.
+ *   \li FIPC_Scan::SCAN_SPIRAL Espiral de Arquímedes centrada en la posición inicial de A y B.
+ *   En este caso el paso de A es el avance radial por vuelta, el paso de B la separación
+ *   entre puntos a lo largo de la espiral y la cantidad de puntos de A el total de puntos por plano.
+ *
+ *   \par Disparos
+ *   En los barridos por líneas el eje rápido se desplaza sin detenerse y el disparo se
+ *   genera en el mismo ciclo en que la posición en pasos alcanza cada punto de la grilla.
+ *   La posición en pasos de cada punto se calcula desde la posición inicial del eje, por lo
+ *   que el redondeo no se acumula a lo largo de la línea. Se emite a lo sumo un disparo por
+ *   ciclo: si el eje alcanza varios puntos en el mismo ciclo (paso de la grilla menor que el
+ *   avance por ciclo) los restantes se cuentan como perdidos en el reporte.
+ *   En la espiral el desplazamiento es punto a punto y el disparo se genera al llegar a
+ *   cada punto. El pulso se emite en la GPIO configurada con setTrigger().
+*/
+class FIPC_Scan
+{
+  public:
+
+    //! Definicion de variable simbólica de tipos de barrido.
+    typedef enum{ SCAN_RASTER,      /*!< Líneas en el mismo sentido. */
+                  SCAN_SERPENTINE,  /*!< Líneas en sentido alternado. */
+                  SCAN_SPIRAL       /*!< Espiral de Arquímedes punto a punto. */
+                  }ScanType;
+
+    //! Definicion de variable simbólica de estados del barrido.
+    typedef enum{ SCAN_IDLE,        /*!< Sin barrido en ejecución. */
+                  SCAN_MOVE,        /*!< Desplazándose al inicio de una línea o a un punto. */
+                  SCAN_LINE,        /*!< Recorriendo una línea con disparos. */
+                  SCAN_DONE,        /*!< Barrido finalizado. */
+                  SCAN_ABORTED      /*!< Barrido cancelado. */
+                  }ScanStatus;
+
+    //! Constructor.
+    /*!
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista.
+      \param pBudget Presupuesto de pasos de exec() de las acciones de los ejes.
+     */
+    FIPC_Scan(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Budget* pBudget);
+
+    //! Configura el barrido.
+    /*!
+      \param type Tipo de barrido (ver FIPC_Scan::ScanType).
+      \param id Identificadores de los ejes A, B y C. Si C es 0 el barrido es de 2 ejes.
+      \param start Posición inicial de cada eje.
+      \param pitch Paso de cada eje.
+      \param points Cantidad de puntos de cada eje.
+      \param speed Velocidad del eje rápido durante el barrido.
+      \return true si la configuración fue aceptada.
+    */
+    bool setScan(uint8_t type, uint8_t id[], float start[], float pitch[], uint16_t points[], float speed);
+
+    //! Configura la salida de disparo.
+    /*!
+      \param pin GPIO de salida.
+      \param widthUs Ancho del pulso en microsegundos.
+    */
+    void setTrigger(uint8_t pin, uint16_t widthUs);
+
+    //! Inicia el barrido configurado.
+    /*!
+      \return true si el barrido fue iniciado.
+    */
+    bool start();
+
+    //! Cancela el barrido en ejecución y detiene los ejes.
+    void stop();
+
+    //! Ejecuta el barrido.
+    /*!
+     * Esta función deberá ser llamada recurrentemente en tiempo real.
+    */
+    void exec();
+
+    //! Retorna el estado del barrido.
+    /*!
+      \return La variable simbólica que describe el estado del barrido.
+    */
+    uint8_t getStatus();
+
+    //! Solicita un reporte del barrido.
+    /*!
+      \param out Texto donde se agrega "estado;línea o punto;disparos;perdidos".
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Consulta si el barrido terminó desde la última consulta.
+    /*!
+      \return true una única vez al finalizar el barrido.
+    */
+    bool finished();
+
+  private:
+    FIPC_Axis** _axisList; /*!< Lista de ejes del controlador. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes en la lista. */
+
+    FIPC_Budget* _budget; /*!< Presupuesto de pasos de exec(). */
+
+    FIPC_Axis* _axis[SCAN_AXIS_NUMBERS]; /*!< Ejes A, B y C del barrido (C puede ser NULL). */
+
+    ScanType _type = SCAN_RASTER; /*!< Tipo de barrido configurado. */
+
+    volatile ScanStatus _status = SCAN_IDLE; /*!< Estado del barrido. */
+
+    bool _configured = false; /*!< true si hay un barrido configurado. */
+
+    volatile bool _finished = false; /*!< Indica el fin del barrido hasta ser consultado. */
+
+    float _start[SCAN_AXIS_NUMBERS]; /*!< Posición inicial de cada eje. */
+
+    float _pitch[SCAN_AXIS_NUMBERS]; /*!< Paso de cada eje. */
+
+    uint16_t _points[SCAN_AXIS_NUMBERS]; /*!< Cantidad de puntos de cada eje. */
+
+    float _speed; /*!< Velocidad del eje rápido. */
+
+    uint32_t _index = 0; /*!< Línea (barrido por líneas) o punto (espiral) en ejecución. */
+
+    uint32_t _total = 0; /*!< Cantidad total de líneas o puntos. */
+
+    uint16_t _lineTrigger = 0; /*!< Cantidad de disparos emitidos en la línea en ejecución. */
+
+    long _nextStep = 0; /*!< Posición en pasos del próximo disparo de la línea. */
+
+    bool _lineForward = true; /*!< La línea en ejecución se recorre en el sentido de los pasos crecientes. */
+
+    float _theta = 0.0; /*!< Ángulo actual de la espiral en radianes. */
+
+    uint32_t _triggers = 0; /*!< Cantidad de disparos emitidos. */
+
+    uint32_t _missed = 0; /*!< Cantidad de puntos sin disparo (alcanzados en el ciclo de otro punto). */
+
+    uint8_t _trigPin = 0xFF; /*!< GPIO de disparo (0xFF sin asignar). */
+
+    uint16_t _trigWidth = 10; /*!< Ancho del pulso de disparo en microsegundos. */
+
+    bool _trigHigh = false; /*!< Indica que el pulso de disparo está activo. */
+
+    unsigned long _trigTime = 0; /*!< Tiempo en microsegundos de inicio del pulso. */
+
+    //! Emite un pulso de disparo.
+    void fire();
+
+    //! Verifica si todos los ejes del barrido están en espera.
+    bool axisReady();
+
+    //! Ordena el desplazamiento al inicio de la línea o al punto actual.
+    /*!
+      \return false si algún eje rechazó el desplazamiento.
+    */
+    bool moveToCurrent();
+
+    //! Avanza al punto siguiente de la línea actual y calcula su posición en pasos.
+    void nextPoint();
+
+    //! Verifica si el eje A alcanzó el próximo punto de la línea.
+    /*!
+      \param current Posición actual del eje A en pasos.
+    */
+    bool reached(long current);
+
+    //! Posición del eje A al inicio o final de la línea actual.
+    /*!
+      \param end true para la posición final.
+    */
+    float lineEdge(bool end);
+};
+#endif
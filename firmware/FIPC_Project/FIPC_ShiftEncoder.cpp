@@ -0,0 +1,169 @@
+/*! \file FIPC_ShiftEncoder.cpp
+    \brief Codificación de los pulsos de paso y dirección en muestras de registros de desplazamiento.
+*/
+
+#include "FIPC_ShiftEncoder.h"
+
+#define SHIFT_MASK (SHIFT_RING-1) /*!< Máscara del índice de las tablas circulares. */
+
+//! Verifica si la muestra a es posterior a la b (con desborde de 32 bits).
+#define SHIFT_AFTER(a,b) ((int32_t)((a)-(b))>0)
+
+// Constructor.
+FIPC_ShiftEncoder::FIPC_ShiftEncoder(){
+  FIPC_ShiftEncoder::begin(_rate, _pulse, _setup, _latency);
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura la codificación y descarta los flancos programados.
+// Las salidas conservan su nivel: los flancos pendientes se pierden.
+void FIPC_ShiftEncoder::begin(uint32_t rate, uint8_t pulse, uint8_t setup, uint32_t latency){
+  portENTER_CRITICAL(&_mux);
+  _rate = (rate>0) ? rate : 1;
+  _pulse = (pulse>0) ? pulse : 1;
+  _setup = setup;
+  _latency = latency;
+  memset(_set, 0, sizeof(_set));
+  memset(_clear, 0, sizeof(_clear));
+  for( uint8_t i=0; i<SHIFT_BITS; i++ ) _last[i] = _free[i] = _next-1;
+  _level = _state;
+  _anchorSample = _next;
+  _anchorTime = micros();
+  _steps = _late = _dropped = 0;
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Programa un pulso de paso.
+// El flanco de subida es la primera muestra que cumple el instante pedido, la separación
+// con el pulso anterior y la demora desde el último cambio de dirección.
+bool FIPC_ShiftEncoder::step(uint8_t stepBit, uint8_t dirBit, bool dir, uint32_t time){
+  if( (stepBit>=SHIFT_BITS)||(dirBit>=SHIFT_BITS)||(stepBit==dirBit) ) return false;
+  portENTER_CRITICAL(&_mux);
+  uint32_t rise = FIPC_ShiftEncoder::toSample(time);
+  bool late = !SHIFT_AFTER(rise, _next-1);
+  if( late ) rise = _next;
+  if( SHIFT_AFTER(_free[stepBit], rise) ) rise = _free[stepBit];
+  if( !SHIFT_AFTER(rise, _last[stepBit]) ) rise = _last[stepBit]+1;
+
+  // Cambio de dirección: setup muestras antes del paso, sin adelantar el último flanco
+  bool change = ((_level>>dirBit)&1)!=(uint32_t)dir;
+  uint32_t turn = _last[dirBit];
+  if( change ){
+    turn = rise-_setup;
+    if( !SHIFT_AFTER(turn, _next-1) ) turn = _next;
+    if( !SHIFT_AFTER(turn, _last[dirBit]) ) turn = _last[dirBit]+1;
+  }
+  if( SHIFT_AFTER(turn+_setup, rise) ) rise = turn+_setup;
+
+  // Horizonte: el flanco de bajada debe caer dentro de las tablas
+  bool done = (rise+_pulse-_next<SHIFT_RING);
+  if( done ){
+    if( change ) FIPC_ShiftEncoder::edge(dirBit, dir, turn);
+    FIPC_ShiftEncoder::edge(stepBit, true, rise);
+    FIPC_ShiftEncoder::edge(stepBit, false, rise+_pulse);
+    _free[stepBit] = rise+2*_pulse;
+    _steps++;
+    if( late ) _late++;
+  } else {
+    _dropped++;
+  }
+  portEXIT_CRITICAL(&_mux);
+  return done;
+}
+
+// Programa el nivel de una salida.
+void FIPC_ShiftEncoder::write(uint8_t bit, bool level, uint32_t time){
+  if( bit>=SHIFT_BITS ) return;
+  portENTER_CRITICAL(&_mux);
+  if( ((_level>>bit)&1)!=(uint32_t)level ){
+    uint32_t sample = FIPC_ShiftEncoder::toSample(time);
+    if( !SHIFT_AFTER(sample, _next-1) ) sample = _next;
+    if( !SHIFT_AFTER(sample, _last[bit]) ) sample = _last[bit]+1;
+    if( sample-_next<SHIFT_RING ) FIPC_ShiftEncoder::edge(bit, level, sample);
+    else _dropped++;
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Codifica el próximo bloque de muestras.
+// Cada muestra aplica sus flancos al nivel de la anterior y libera su posición en las tablas.
+void FIPC_ShiftEncoder::encode(uint32_t* frame, uint16_t samples, uint32_t time){
+  portENTER_CRITICAL(&_mux);
+  _anchorSample = _next;
+  _anchorTime = time;
+  for( uint16_t i=0; i<samples; i++ ){
+    uint16_t index = _next&SHIFT_MASK;
+    _state = (_state&~_clear[index])|_set[index];
+    _set[index] = _clear[index] = 0;
+    frame[i] = _state;
+    _next++;
+  }
+  // Las marcas viejas se acercan al horizonte para no confundirse con el desborde de 32 bits
+  for( uint8_t i=0; i<SHIFT_BITS; i++ ){
+    if( SHIFT_AFTER(_next-SHIFT_RING, _last[i]) ) _last[i] = _next-SHIFT_RING;
+    if( SHIFT_AFTER(_next-SHIFT_RING, _free[i]) ) _free[i] = _next-SHIFT_RING;
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Verifica si una salida tiene flancos programados que todavía no se emitieron.
+// El instante de emisión del último flanco se obtiene del ancla como en toSample().
+bool FIPC_ShiftEncoder::pending(uint8_t bit, uint32_t time){
+  if( bit>=SHIFT_BITS ) return false;
+  portENTER_CRITICAL(&_mux);
+  int64_t ahead = (int32_t)(_last[bit]-_anchorSample);
+  uint32_t emitted = _anchorTime+(int32_t)(ahead*1000000/_rate);
+  portEXIT_CRITICAL(&_mux);
+  return (int32_t)(emitted-time)>=0;
+}
+
+// Retorna la próxima muestra a codificar.
+uint32_t FIPC_ShiftEncoder::getSample(){
+  return _next;
+}
+
+// Retorna el nivel de las salidas en la última muestra codificada.
+uint32_t FIPC_ShiftEncoder::getState(){
+  return _state;
+}
+
+// Solicita un reporte de la codificación.
+void FIPC_ShiftEncoder::getCounters(uint32_t &oSteps, uint32_t &oLate, uint32_t &oDropped){
+  portENTER_CRITICAL(&_mux);
+  oSteps = _steps;
+  oLate = _late;
+  oDropped = _dropped;
+  portEXIT_CRITICAL(&_mux);
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Convierte un instante en la muestra en que se emite, con la latencia.
+// La diferencia con el ancla es de a lo sumo unos bloques: se calcula con 64 bits.
+uint32_t FIPC_ShiftEncoder::toSample(uint32_t time){
+  int64_t elapsed = (int32_t)(time+_latency-_anchorTime);
+  return _anchorSample+(int32_t)(elapsed*_rate/1000000);
+}
+
+// Programa un flanco en una muestra (dentro de la sección crítica).
+void FIPC_ShiftEncoder::edge(uint8_t bit, bool level, uint32_t sample){
+  uint16_t index = sample&SHIFT_MASK;
+  uint32_t mask = 1UL<<bit;
+  if( level ){
+    _set[index] |= mask;
+    _level |= mask;
+  } else {
+    _clear[index] |= mask;
+    _level &= ~mask;
+  }
+  _last[bit] = sample;
+}
+/* End: Private                           */
+/******************************************/
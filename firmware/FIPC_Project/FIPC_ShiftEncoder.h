@@ -0,0 +1,171 @@
+/*! \file FIPC_ShiftEncoder.h
+ *  \brief Codificación de los pulsos de paso y dirección en muestras de registros de desplazamiento.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_ShiftEncoder_h
+#define FIPC_ShiftEncoder_h
+
+#include "Arduino.h"
+
+#define SHIFT_BITS      32   /*!< Salidas de la cadena de 74HC595 (bits de una muestra). */
+#define SHIFT_RING      1024 /*!< Muestras del horizonte de los flancos programados (potencia de 2). */
+#define SHIFT_PIN_BASE  64   /*!< Primer número de pin de las salidas de la cadena (mayor que las GPIO del ESP32). */
+
+#define SHIFT_PIN(n)    (SHIFT_PIN_BASE+(n)) /*!< Número de pin de la salida n de la cadena. */
+#define SHIFT_IS_PIN(pin) (((pin)>=SHIFT_PIN_BASE)&&((pin)<SHIFT_PIN_BASE+SHIFT_BITS)) /*!< Verifica si un pin es una salida de la cadena. */
+
+//!  Clase que codifica los pulsos de paso y dirección de varios ejes en muestras de una cadena de 74HC595.
+/*!
+ *   Cada muestra es una palabra de SHIFT_BITS bits con el nivel de todas las salidas de la
+ *   cadena; el bit n es la salida n (ver SHIFT_PIN()). Las muestras se emiten a una frecuencia
+ *   fija (ver FIPC_ShiftOut), por lo que un flanco solo puede ocurrir en el límite de una
+ *   muestra y su instante se cuantiza al período de muestreo.
+ *
+ *   \par Programación
+ *   step() programa un pulso en la muestra que corresponde al instante pedido más una latencia
+ *   fija: el ancla de encode() relaciona la primera muestra de cada bloque con el instante en
+ *   que se emite, y la latencia debe cubrir los bloques ya codificados. Los flancos se anotan
+ *   en dos tablas circulares de SHIFT_RING muestras (bits a subir y a bajar), por lo que
+ *   programar un pulso no depende de la cantidad de ejes ni del orden de las llamadas.
+ *
+ *   \par Temporización de cada eje
+ *   \li El pulso dura pulse muestras y entre dos pulsos del mismo bit hay al menos pulse
+ *   muestras en nivel bajo: un paso pedido antes se demora.
+ *   \li Si el pulso cambia la dirección, la salida de dirección cambia setup muestras antes
+ *   del flanco de subida del paso.
+ *   \li Un pulso pedido para una muestra ya codificada sale en la primera libre y se cuenta
+ *   como atrasado; uno más allá del horizonte se descarta y se cuenta.
+ *
+ *   La clase no usa periféricos: la codificación puede verificarse en la PC llamando a
+ *   step() y encode() con instantes simulados y midiendo los flancos de cada bit en las
+ *   muestras resultantes.
+*/
+class FIPC_ShiftEncoder
+{
+  public:
+    //! Constructor.
+    FIPC_ShiftEncoder();
+
+    //! Configura la codificación y descarta los flancos programados.
+    /*!
+      \param rate Frecuencia de muestreo en muestras/s.
+      \param pulse Ancho del pulso de paso en muestras (al menos 1).
+      \param setup Muestras entre el cambio de dirección y el pulso siguiente.
+      \param latency Demora en us entre el instante pedido y el flanco.
+    */
+    void begin(uint32_t rate, uint8_t pulse, uint8_t setup, uint32_t latency);
+
+    //! Programa un pulso de paso.
+    /*!
+      \param stepBit Salida de pasos.
+      \param dirBit Salida de dirección.
+      \param dir Nivel de la salida de dirección durante el pulso.
+      \param time Instante pedido en us (micros()).
+      \return true si el pulso fue programado.
+    */
+    bool IRAM_ATTR step(uint8_t stepBit, uint8_t dirBit, bool dir, uint32_t time);
+
+    //! Programa el nivel de una salida.
+    /*!
+      \param bit Salida.
+      \param level Nivel.
+      \param time Instante pedido en us (micros()).
+    */
+    void IRAM_ATTR write(uint8_t bit, bool level, uint32_t time);
+
+    //! Codifica el próximo bloque de muestras.
+    /*!
+      \param frame Muestras a completar.
+      \param samples Cantidad de muestras.
+      \param time Instante en us en que se emite la primera muestra del bloque (ancla).
+    */
+    void encode(uint32_t* frame, uint16_t samples, uint32_t time);
+
+    //! Verifica si una salida tiene flancos programados que todavía no se emitieron.
+    /*!
+      \param bit Salida.
+      \param time Instante en us (micros()).
+      \return true si el último flanco programado de la salida se emite en time o después.
+    */
+    bool IRAM_ATTR pending(uint8_t bit, uint32_t time);
+
+    //! Retorna la próxima muestra a codificar.
+    uint32_t getSample();
+
+    //! Retorna el nivel de las salidas en la última muestra codificada.
+    uint32_t getState();
+
+    //! Solicita un reporte de la codificación.
+    /*!
+      \param oSteps Pulsos programados.
+      \param oLate Pulsos demorados por pedirse para una muestra ya codificada.
+      \param oDropped Pulsos descartados por superar el horizonte.
+    */
+    void getCounters(uint32_t &oSteps, uint32_t &oLate, uint32_t &oDropped);
+
+  private:
+    uint32_t _set[SHIFT_RING]; /*!< Bits que suben en cada muestra del horizonte. */
+
+    uint32_t _clear[SHIFT_RING]; /*!< Bits que bajan en cada muestra del horizonte. */
+
+    uint32_t _last[SHIFT_BITS]; /*!< Muestra del último flanco programado de cada bit. */
+
+    uint32_t _free[SHIFT_BITS]; /*!< Primera muestra admitida para el próximo pulso de cada bit de pasos. */
+
+    uint32_t _level = 0; /*!< Nivel de cada salida luego de los flancos programados. */
+
+    uint32_t _state = 0; /*!< Nivel de cada salida en la última muestra codificada. */
+
+    uint32_t _next = 0; /*!< Próxima muestra a codificar. */
+
+    uint32_t _anchorSample = 0; /*!< Primera muestra del último bloque codificado. */
+
+    uint32_t _anchorTime = 0; /*!< Instante en us en que se emite _anchorSample. */
+
+    uint32_t _rate = 1000000; /*!< Frecuencia de muestreo en muestras/s. */
+
+    uint8_t _pulse = 1; /*!< Ancho del pulso en muestras. */
+
+    uint8_t _setup = 1; /*!< Muestras entre el cambio de dirección y el pulso. */
+
+    uint32_t _latency = 0; /*!< Demora en us entre el instante pedido y el flanco. */
+
+    uint32_t _steps = 0; /*!< Pulsos programados. */
+
+    uint32_t _late = 0; /*!< Pulsos demorados. */
+
+    uint32_t _dropped = 0; /*!< Pulsos descartados. */
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED; /*!< Exclusión entre el proceso en tiempo real y la codificación. */
+
+    //! Convierte un instante en la muestra en que se emite, con la latencia.
+    /*!
+      \param time Instante en us.
+      \return Muestra, no anterior a la próxima a codificar.
+    */
+    uint32_t IRAM_ATTR toSample(uint32_t time);
+
+    //! Programa un flanco en una muestra.
+    /*!
+      \param bit Salida.
+      \param level Nivel luego del flanco.
+      \param sample Muestra, posterior al último flanco del bit y dentro del horizonte.
+    */
+    void IRAM_ATTR edge(uint8_t bit, bool level, uint32_t sample);
+};
+#endif
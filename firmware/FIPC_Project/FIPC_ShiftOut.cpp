@@ -0,0 +1,130 @@
+/*! \file FIPC_ShiftOut.cpp
+    \brief Salidas de paso y dirección en registros de desplazamiento 74HC595 con el periférico I2S del ESP32.
+*/
+
+#include "FIPC_ShiftOut.h"
+
+#if (SHIFT_ENABLED)&&defined(ARDUINO_ARCH_ESP32)
+#include "driver/i2s.h"
+
+#define SHIFT_I2S_PORT I2S_NUM_0 /*!< Periférico I2S de la cadena. */
+
+StackType_t FIPC_ShiftOut::_stack[SHIFT_STACK_SIZE];
+StaticTask_t FIPC_ShiftOut::_task;
+#endif
+
+#if SHIFT_ENABLED
+FIPC_ShiftEncoder FIPC_ShiftOut::_encoder;
+#endif
+bool FIPC_ShiftOut::_enabled = false;
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura el periférico e inicia la tarea de codificación.
+// Sin flancos pendientes cada buffer repite el nivel de la última muestra; si la tarea no llega a
+// completar un buffer el driver emite ceros (pasos y direcciones en bajo).
+bool FIPC_ShiftOut::begin(uint8_t pinData, uint8_t pinClock, uint8_t pinLatch){
+  if( _enabled ) return true;
+#if (SHIFT_ENABLED)&&defined(ARDUINO_ARCH_ESP32)
+  i2s_config_t config;
+  memset(&config, 0, sizeof(config));
+  config.mode = (i2s_mode_t)(I2S_MODE_MASTER|I2S_MODE_TX);
+  config.sample_rate = SHIFT_SAMPLE_RATE;
+  config.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+  config.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+  config.communication_format = I2S_COMM_FORMAT_STAND_MSB; // el último bit precede al flanco de WS
+  config.dma_buf_count = SHIFT_DMA_BUFFERS;
+  config.dma_buf_len = SHIFT_FRAME;
+  config.use_apll = false;
+  config.tx_desc_auto_clear = true;
+  if( i2s_driver_install(SHIFT_I2S_PORT, &config, 0, NULL)!=ESP_OK ) return false;
+
+  i2s_pin_config_t pins;
+  memset(&pins, 0, sizeof(pins));
+  pins.bck_io_num = pinClock;
+  pins.ws_io_num = pinLatch;
+  pins.data_out_num = pinData;
+  pins.data_in_num = I2S_PIN_NO_CHANGE;
+  if( i2s_set_pin(SHIFT_I2S_PORT, &pins)!=ESP_OK ){
+    i2s_driver_uninstall(SHIFT_I2S_PORT);
+    return false;
+  }
+  _encoder.begin(SHIFT_SAMPLE_RATE, SHIFT_PULSE_SAMPLES, SHIFT_SETUP_SAMPLES, SHIFT_LATENCY_US);
+  _enabled = true;
+
+  // Núcleo 0: el proceso en tiempo real solo programa los flancos
+  xTaskCreateStaticPinnedToCore(FIPC_ShiftOut::run, "TaskShiftOut", SHIFT_STACK_SIZE, NULL,
+                                configMAX_PRIORITIES-1, _stack, &_task, 0);
+  return true;
+#else
+  (void)pinData; (void)pinClock; (void)pinLatch;
+  return false;
+#endif
+}
+
+// Programa un pulso de paso.
+void FIPC_ShiftOut::step(uint8_t pinStep, uint8_t pinDir, bool dir){
+#if SHIFT_ENABLED
+  if( _enabled ) _encoder.step(pinStep-SHIFT_PIN_BASE, pinDir-SHIFT_PIN_BASE, dir, micros());
+#endif
+}
+
+// Programa el nivel de una salida.
+void FIPC_ShiftOut::write(uint8_t pin, bool level){
+#if SHIFT_ENABLED
+  if( _enabled ) _encoder.write(pin-SHIFT_PIN_BASE, level, micros());
+#endif
+}
+
+// Verifica si un eje de la cadena tiene flancos programados que todavía no se emitieron.
+bool FIPC_ShiftOut::pending(uint8_t pinStep, uint8_t pinDir){
+#if SHIFT_ENABLED
+  if( !_enabled ) return false;
+  uint32_t now = micros();
+  return (_encoder.pending(pinStep-SHIFT_PIN_BASE, now))||(_encoder.pending(pinDir-SHIFT_PIN_BASE, now));
+#else
+  (void)pinStep; (void)pinDir;
+  return false;
+#endif
+}
+
+// Solicita un reporte de la cadena.
+void FIPC_ShiftOut::getReport(FIPC_Text &out){
+  uint32_t steps = 0, late = 0, dropped = 0;
+#if SHIFT_ENABLED
+  _encoder.getCounters(steps, late, dropped);
+#endif
+  out.add((int)_enabled).add(';');
+  out.add((int)SHIFT_BITS).add(';');
+  out.add((unsigned long)SHIFT_SAMPLE_RATE).add(';');
+  out.add((unsigned long)steps).add(';');
+  out.add((unsigned long)late).add(';');
+  out.add((unsigned long)dropped);
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+#if (SHIFT_ENABLED)&&defined(ARDUINO_ARCH_ESP32)
+// Tarea de codificación.
+// i2s_write() retorna al copiar el buffer en uno libre del DMA: el próximo se codifica
+// mientras se espera el siguiente y se emite luego de los SHIFT_DMA_BUFFERS encolados.
+void FIPC_ShiftOut::run(void* arg){
+  (void)arg;
+  uint32_t samples[SHIFT_FRAME];
+  uint32_t frame[2*SHIFT_FRAME];
+  for(;;){
+    _encoder.encode(samples, SHIFT_FRAME, micros()+SHIFT_DMA_BUFFERS*SHIFT_FRAME_US);
+    for( uint8_t i=0; i<SHIFT_FRAME; i++ ) frame[2*i] = frame[2*i+1] = samples[i]; // ambos canales
+    size_t written;
+    i2s_write(SHIFT_I2S_PORT, frame, sizeof(frame), &written, portMAX_DELAY);
+  }
+}
+#endif
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,130 @@
+/*! \file FIPC_ShiftOut.h
+ *  \brief Salidas de paso y dirección en registros de desplazamiento 74HC595 con el periférico I2S del ESP32.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_ShiftOut_h
+#define FIPC_ShiftOut_h
+
+#include "Arduino.h"
+#include "FIPC_ShiftEncoder.h"
+#include "FIPC_Text.h"
+
+#ifndef SHIFT_ENABLED
+#define SHIFT_ENABLED 0 /*!< 1 emite los pasos de los ejes de la cadena de 74HC595 (ver FIPC_pinTable.h), 0 solo GPIO. */
+#endif
+
+#define SHIFT_SAMPLE_RATE   100000 /*!< Muestras/s de la cadena (reloj de desplazamiento de 64 veces: 6,4 MHz). */
+#define SHIFT_FRAME         32     /*!< Muestras de cada buffer DMA. */
+#define SHIFT_DMA_BUFFERS   3      /*!< Buffers DMA encolados. */
+#define SHIFT_PULSE_SAMPLES 1      /*!< Ancho del pulso de paso en muestras (10 us, el DRV8825 requiere 1,9 us). */
+#define SHIFT_SETUP_SAMPLES 1      /*!< Muestras entre el cambio de dirección y el paso (el DRV8825 requiere 650 ns). */
+#define SHIFT_FRAME_US      (SHIFT_FRAME*1000000UL/SHIFT_SAMPLE_RATE) /*!< Duración de un buffer en us. */
+#define SHIFT_LATENCY_US    ((SHIFT_DMA_BUFFERS+1)*SHIFT_FRAME_US)     /*!< Demora de los flancos respecto de las GPIO en us. */
+#define SHIFT_STACK_SIZE    2*1024 /*!< Pila de la tarea de codificación en bytes. */
+
+//!  Clase que emite los pasos y la dirección de varios ejes por una cadena de 74HC595.
+/*!
+ *   Amplía las salidas del ESP32 para controlar más ejes que los que permiten sus GPIO: las
+ *   salidas de paso y dirección de un eje pueden ser bits de la cadena (pines SHIFT_PIN(n),
+ *   ver FIPC_Stepper), que el periférico I2S actualiza SHIFT_SAMPLE_RATE veces por segundo.
+ *
+ *   \par Conexión
+ *   El I2S transmite tramas estéreo de 32 bits con el formato MSB: DATA es la entrada serie
+ *   (SER), BCK el reloj de desplazamiento (SRCLK) y WS el de las salidas (RCLK). Cada muestra
+ *   se envía en ambos canales, por lo que el flanco de subida de WS copia a las salidas la
+ *   palabra completa; el bit n es la salida Qn%8 del registro n/8 de la cadena.
+ *
+ *   \par Codificación
+ *   Una tarea en el núcleo 0 codifica con FIPC_ShiftEncoder un buffer de SHIFT_FRAME muestras
+ *   cada vez que el DMA libera uno. step() y write() solo programan los flancos, por lo que el
+ *   proceso en tiempo real no espera al periférico.
+ *
+ *   \par Demora
+ *   Los flancos se emiten SHIFT_LATENCY_US después del pedido (los buffers encolados más el que
+ *   se está codificando), con una resolución de 1/SHIFT_SAMPLE_RATE. Los ejes de la cadena
+ *   quedan atrasados ese tiempo respecto de los de GPIO: los desplazamientos sincronizados y la
+ *   salida PSO entre ejes de ambos tipos tienen ese desfasaje. La generación de pulsos con el
+ *   periférico RMT (CONFIG_PULSE_RMT) no está disponible en la cadena, ni el cambio de
+ *   micropasos (CONFIG_MICROSTEP): los pines de modo cambiarían antes que los pasos atrasados.
+ *
+ *   Con SHIFT_ENABLED en 0 (sin las tablas del codificador) y en el host (sin I2S) begin()
+ *   retorna false y los pasos de la cadena se descartan.
+*/
+class FIPC_ShiftOut
+{
+  public:
+    //! Configura el periférico e inicia la tarea de codificación.
+    /*!
+      \param pinData GPIO de datos (SER).
+      \param pinClock GPIO del reloj de desplazamiento (SRCLK).
+      \param pinLatch GPIO del reloj de las salidas (RCLK).
+      \return false si el periférico no pudo configurarse.
+    */
+    static bool begin(uint8_t pinData, uint8_t pinClock, uint8_t pinLatch);
+
+    //! Verifica si la cadena está emitiendo.
+    static bool isEnabled() { return _enabled; }
+
+    //! Programa un pulso de paso (ver FIPC_ShiftEncoder::step()).
+    /*!
+      \param pinStep Pin de pasos (SHIFT_PIN()).
+      \param pinDir Pin de dirección (SHIFT_PIN()).
+      \param dir Nivel de la dirección durante el pulso.
+    */
+    static void IRAM_ATTR step(uint8_t pinStep, uint8_t pinDir, bool dir);
+
+    //! Programa el nivel de una salida (ver FIPC_ShiftEncoder::write()).
+    /*!
+      \param pin Pin (SHIFT_PIN()).
+      \param level Nivel.
+    */
+    static void IRAM_ATTR write(uint8_t pin, bool level);
+
+    //! Verifica si un eje de la cadena tiene flancos programados que todavía no se emitieron.
+    /*!
+      Los pasos salen SHIFT_LATENCY_US después de programarse: el eje no termina su
+      desplazamiento ni se deshabilita hasta que la cadena emite el último (ver FIPC_Axis).
+      \param pinStep Pin de pasos (SHIFT_PIN()).
+      \param pinDir Pin de dirección (SHIFT_PIN()).
+      \return true si queda algún flanco del paso o de la dirección por emitir.
+    */
+    static bool IRAM_ATTR pending(uint8_t pinStep, uint8_t pinDir);
+
+    //! Solicita un reporte de la cadena.
+    /*!
+      \param out Texto donde se agrega "habilitada;bits;muestras/s;pasos;atrasados;descartados".
+    */
+    static void getReport(FIPC_Text &out);
+
+  private:
+    static bool _enabled; /*!< La cadena está emitiendo. */
+
+#if SHIFT_ENABLED
+    static FIPC_ShiftEncoder _encoder; /*!< Codificador de las muestras. */
+#endif
+
+#if (SHIFT_ENABLED)&&defined(ARDUINO_ARCH_ESP32)
+    static StackType_t _stack[SHIFT_STACK_SIZE]; /*!< Pila de la tarea. */
+
+    static StaticTask_t _task; /*!< Tarea de codificación. */
+
+    //! Tarea de codificación.
+    static void run(void* arg);
+#endif
+};
+#endif
@@ -0,0 +1,63 @@
+/*! \file FIPC_Stepper.cpp
+    \brief Driver de un motor paso a paso con salidas en GPIO o en la cadena de 74HC595.
+*/
+
+#include "FIPC_Stepper.h"
+
+// Constructor.
+FIPC_Stepper::FIPC_Stepper(uint8_t pinStep, uint8_t pinDir) :
+  AccelStepper(AccelStepper::DRIVER, pinStep, pinDir) {
+  _pinStep = pinStep;
+  _pinDir = pinDir;
+  _shifted = SHIFT_IS_PIN(pinStep);
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura la inversión de las salidas.
+void FIPC_Stepper::setPinsInverted(bool directionInvert, bool stepInvert, bool enableInvert){
+  _invertDir = directionInvert;
+  AccelStepper::setPinsInverted(directionInvert, stepInvert, enableInvert);
+}
+
+// Escribe la salida de dirección.
+void FIPC_Stepper::writeDir(bool level){
+  _dirLevel = level;
+  if( _shifted ) FIPC_ShiftOut::write(_pinDir, level);
+  else digitalWrite(_pinDir, level ? HIGH : LOW);
+}
+
+// Emite un paso con la dirección actual.
+void FIPC_Stepper::pulse(uint16_t width){
+  if( _shifted ){
+    FIPC_ShiftOut::step(_pinStep, _pinDir, _dirLevel);
+    return;
+  }
+  digitalWrite(_pinStep, HIGH);
+  delayMicroseconds(width);
+  digitalWrite(_pinStep, LOW);
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Protected                       */
+
+// Escribe las salidas según la máscara de AccelStepper.
+// En la cadena el pulso completo se programa en el flanco de subida: la bajada que
+// escribe AccelStepper luego de setMinPulseWidth() no tiene efecto.
+void FIPC_Stepper::setOutputPins(uint8_t mask){
+  if( !_shifted ){
+    AccelStepper::setOutputPins(mask);
+    return;
+  }
+  _dirLevel = ((mask&0x02)!=0)!=_invertDir;
+  if( (mask&0x01)&&!(_mask&0x01) ) FIPC_ShiftOut::step(_pinStep, _pinDir, _dirLevel);
+  else FIPC_ShiftOut::write(_pinDir, _dirLevel);
+  _mask = mask;
+}
+/* End: Protected                         */
+/******************************************/
@@ -0,0 +1,92 @@
+/*! \file FIPC_Stepper.h
+ *  \brief Driver de un motor paso a paso con salidas en GPIO o en la cadena de 74HC595.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Stepper_h
+#define FIPC_Stepper_h
+
+#include "Arduino.h"
+#include <AccelStepper.h>
+#include "FIPC_ShiftOut.h"
+
+//!  Clase que extiende AccelStepper con salidas de paso y dirección en la cadena de 74HC595.
+/*!
+ *   Con pines de GPIO se comporta como AccelStepper con interfaz DRIVER. Con pines de la
+ *   cadena (SHIFT_PIN(), ver FIPC_ShiftOut) el flanco de subida de cada paso que genera
+ *   AccelStepper se programa como un pulso con la dirección en ese instante, y el resto de
+ *   los cambios de la dirección como escrituras de la cadena. Ambos pines deben ser del
+ *   mismo tipo (ver FIPC_Config::validate()).
+ *
+ *   writeDir() y pulse() permiten a los generadores de pulsos del eje (FIPC_Microstep) usar
+ *   las mismas salidas.
+*/
+class FIPC_Stepper : public AccelStepper
+{
+  public:
+    //! Constructor.
+    /*!
+      \param pinStep Pin de pasos (GPIO o SHIFT_PIN()).
+      \param pinDir Pin de dirección (GPIO o SHIFT_PIN()).
+    */
+    FIPC_Stepper(uint8_t pinStep, uint8_t pinDir);
+
+    //! Configura la inversión de las salidas.
+    /*!
+      Reemplaza al de AccelStepper para conservar la inversión de la dirección en la cadena.
+      \param directionInvert Invierte la dirección.
+      \param stepInvert Invierte los pasos (solo GPIO).
+      \param enableInvert Invierte la habilitación.
+    */
+    void setPinsInverted(bool directionInvert, bool stepInvert, bool enableInvert);
+
+    //! Escribe la salida de dirección.
+    /*!
+      \param level Nivel, con la inversión ya aplicada.
+    */
+    void IRAM_ATTR writeDir(bool level);
+
+    //! Emite un paso con la dirección actual.
+    /*!
+      \param width Ancho del pulso en us (en la cadena es SHIFT_PULSE_SAMPLES).
+    */
+    void IRAM_ATTR pulse(uint16_t width);
+
+    //! Verifica si las salidas son de la cadena.
+    bool isShifted() { return _shifted; }
+
+    //! Verifica si quedan pasos o cambios de dirección de la cadena sin emitir (ver FIPC_ShiftOut::pending()).
+    bool isPending() { return (_shifted)&&(FIPC_ShiftOut::pending(_pinStep, _pinDir)); }
+
+  protected:
+    //! Escribe las salidas según la máscara de AccelStepper (bit 0 paso, bit 1 dirección).
+    virtual void IRAM_ATTR setOutputPins(uint8_t mask);
+
+  private:
+    uint8_t _pinStep; /*!< Pin de pasos. */
+
+    uint8_t _pinDir; /*!< Pin de dirección. */
+
+    bool _shifted; /*!< Las salidas son de la cadena. */
+
+    bool _invertDir = false; /*!< Inversión de la dirección. */
+
+    bool _dirLevel = false; /*!< Nivel escrito en la dirección. */
+
+    uint8_t _mask = 0; /*!< Última máscara escrita. */
+};
+#endif
@@ -0,0 +1,78 @@
+/*! \file FIPC_Storage.cpp
+    \brief Interfaz de almacenamiento no volátil.
+*/
+
+#include "FIPC_Storage.h"
+
+// Calcula el CRC-16 (CCITT) de un bloque de datos.
+uint16_t FIPC_Storage::crc16(const void* data, size_t size){
+  const uint8_t* bytes = (const uint8_t*)data;
+  uint16_t out = 0xFFFF;
+  for(size_t i = 0; i<size; i++){
+    out ^= (uint16_t)bytes[i]<<8;
+    for(uint8_t j = 0; j<8; j++) out = (out&0x8000) ? (out<<1)^0x1021 : (out<<1);
+  }
+  return out;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+// Constructor.
+FIPC_NVSStorage::FIPC_NVSStorage(const char* iNamespace) {
+  _namespace = iNamespace;
+}
+
+// Lee un bloque de datos.
+bool FIPC_NVSStorage::read(const char* key, void* data, size_t size){
+  if( !_prefs.begin(_namespace, true) ) return false;
+  bool ok = (_prefs.getBytesLength(key)==size)&&(_prefs.getBytes(key, data, size)==size);
+  _prefs.end();
+  return ok;
+}
+
+// Escribe un bloque de datos.
+bool FIPC_NVSStorage::write(const char* key, const void* data, size_t size){
+  if( !_prefs.begin(_namespace, false) ) return false;
+  bool ok = (_prefs.putBytes(key, data, size)==size);
+  _prefs.end();
+  return ok;
+}
+
+#else
+#include <stdio.h>
+
+// Constructor.
+FIPC_FileStorage::FIPC_FileStorage(const char* iPrefix) {
+  _prefix = iPrefix;
+}
+
+// Lee un bloque de datos.
+bool FIPC_FileStorage::read(const char* key, void* data, size_t size){
+  char name[64];
+  FIPC_FileStorage::fileName(name, sizeof(name), key, "bin");
+  FILE* file = fopen(name, "rb");
+  if( file==NULL ) return false;
+  bool ok = (fread(data, 1, size, file)==size)&&(fgetc(file)==EOF);
+  fclose(file);
+  return ok;
+}
+
+// Escribe un bloque de datos.
+bool FIPC_FileStorage::write(const char* key, const void* data, size_t size){
+  char name[64], temp[64];
+  FIPC_FileStorage::fileName(name, sizeof(name), key, "bin");
+  FIPC_FileStorage::fileName(temp, sizeof(temp), key, "tmp");
+  FILE* file = fopen(temp, "wb");
+  if( file==NULL ) return false;
+  bool ok = (fwrite(data, 1, size, file)==size);
+  ok = (fflush(file)==0)&&ok;
+  ok = (fclose(file)==0)&&ok;
+  return ok&&(rename(temp, name)==0); // el renombre reemplaza el archivo de forma atómica
+}
+
+// Arma el nombre del archivo de una clave.
+void FIPC_FileStorage::fileName(char* oName, size_t iSize, const char* key, const char* ext){
+  snprintf(oName, iSize, "%s_%s.%s", _prefix, key, ext);
+}
+
+#endif
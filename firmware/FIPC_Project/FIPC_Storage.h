@@ -0,0 +1,118 @@
+/*! \file FIPC_Storage.h
+ *  \brief Interfaz de almacenamiento no volátil.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Storage_h
+#define FIPC_Storage_h
+
+#include "Arduino.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Preferences.h>
+#endif
+
+//!  Interfaz de almacenamiento no volátil.
+/*!
+ *   Almacena bloques de datos identificados por una clave. La escritura de una
+ *   clave debe ser atómica: ante un corte de energía se conserva el valor anterior
+ *   o el nuevo, nunca una mezcla. En el controlador se utiliza FIPC_NVSStorage y en
+ *   una compilación para PC FIPC_FileStorage.
+*/
+class FIPC_Storage
+{
+  public:
+    //! Lee un bloque de datos.
+    /*!
+      \param key Clave del bloque.
+      \param data Destino de los datos.
+      \param size Cantidad de bytes a leer.
+      \return true si el bloque existe y tiene el tamaño solicitado.
+    */
+    virtual bool read(const char* key, void* data, size_t size) = 0;
+
+    //! Escribe un bloque de datos.
+    /*!
+      \param key Clave del bloque.
+      \param data Datos a escribir.
+      \param size Cantidad de bytes a escribir.
+      \return true si la escritura fue completada.
+    */
+    virtual bool write(const char* key, const void* data, size_t size) = 0;
+
+    //! Calcula el CRC-16 (CCITT) de un bloque de datos.
+    /*!
+      \param data Datos.
+      \param size Cantidad de bytes.
+      \return El CRC de los datos.
+    */
+    static uint16_t crc16(const void* data, size_t size);
+};
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+//!  Almacenamiento en la partición NVS del ESP32.
+/*!
+ *   La NVS distribuye las escrituras sobre sus páginas (nivelación de desgaste) y
+ *   cada entrada se escribe de forma atómica.
+*/
+class FIPC_NVSStorage : public FIPC_Storage
+{
+  public:
+    //! Constructor.
+    /*!
+      \param iNamespace Espacio de nombres de la NVS (hasta 15 caracteres).
+     */
+    FIPC_NVSStorage(const char* iNamespace);
+
+    bool read(const char* key, void* data, size_t size);
+
+    bool write(const char* key, const void* data, size_t size);
+
+  private:
+    const char* _namespace; /*!< Espacio de nombres de la NVS. */
+
+    Preferences _prefs; /*!< Acceso a la NVS. */
+};
+
+#else
+//!  Almacenamiento en archivos para la compilación en PC.
+/*!
+ *   Cada clave se guarda en un archivo. La escritura se realiza sobre un archivo
+ *   temporal que luego se renombra, por lo que es atómica.
+*/
+class FIPC_FileStorage : public FIPC_Storage
+{
+  public:
+    //! Constructor.
+    /*!
+      \param iPrefix Prefijo de los archivos (por ejemplo "fipc_nvs").
+     */
+    FIPC_FileStorage(const char* iPrefix);
+
+    bool read(const char* key, void* data, size_t size);
+
+    bool write(const char* key, const void* data, size_t size);
+
+  private:
+    const char* _prefix; /*!< Prefijo de los archivos. */
+
+    //! Arma el nombre del archivo de una clave.
+    void fileName(char* oName, size_t iSize, const char* key, const char* ext);
+};
+#endif
+#endif
@@ -0,0 +1,109 @@
+/*! \file FIPC_Sync.cpp
+    \brief Sincronización del inicio de los movimientos de varios controladores.
+*/
+
+#include "FIPC_Sync.h"
+
+// Constructor.
+FIPC_Sync::FIPC_Sync(FIPC_SyncLine* pLine) {
+  _line = pLine;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura el rol y la GPIO de la línea.
+bool FIPC_Sync::setRole(uint8_t role, uint8_t pin){
+  if( role>SYNC_FOLLOWER ) return false;
+  FIPC_Sync::cancel();
+  _role = SYNC_OFF; // la tarea de tiempo real no utiliza la línea durante el cambio
+  _fire = _pulse = false;
+  if( role==SYNC_OFF ) pin = SYNC_LINE_NONE;
+  else if( pin==SYNC_LINE_NONE ) return false;
+  _line->begin(pin, role==SYNC_LEADER);
+  _role = role;
+  return true;
+}
+
+// Retiene las acciones siguientes hasta el próximo disparo.
+bool FIPC_Sync::arm(){
+  if( _role==SYNC_OFF ) return false;
+  _holding = true;
+  return true;
+}
+
+// Retiene un lote de acciones preparadas.
+// Si el disparo ocurrió mientras se preparaba el lote, se libera sin esperar al siguiente.
+bool FIPC_Sync::hold(uint32_t epoch){
+  portENTER_CRITICAL(&_mux);
+  bool holding = _holding;
+  if( holding ){
+    _ready = false;
+    _held = epoch;
+  }
+  portEXIT_CRITICAL(&_mux);
+  return holding;
+}
+
+// Descarta la retención.
+uint32_t FIPC_Sync::cancel(){
+  return FIPC_Sync::take();
+}
+
+// Solicita el pulso de disparo.
+bool FIPC_Sync::fire(){
+  if( _role!=SYNC_LEADER ) return false;
+  _fire = true;
+  return true;
+}
+
+// Proceso a ejecutar en tiempo real.
+// El líder libera su lote en el mismo ciclo en que sube la línea; el seguidor, en el
+// ciclo en que detecta el flanco.
+uint32_t FIPC_Sync::exec(){
+  uint8_t role = _role;
+  if( role==SYNC_OFF ) return 0;
+  uint32_t time;
+  if( role==SYNC_LEADER ){
+    if( _pulse ){
+      if( micros()-_edgeTime>=SYNC_PULSE_US ){
+        _line->set(false);
+        _pulse = false;
+      }
+      return 0;
+    }
+    if( !_fire ) return 0;
+    _fire = false;
+    time = micros();
+    _line->set(true);
+    _pulse = true;
+  } else if( !_line->edge(time) ) return 0;
+  _edgeTime = time;
+  _edges = _edges+1;
+  return FIPC_Sync::take();
+}
+
+// Solicita un reporte de la sincronización.
+void FIPC_Sync::getReport(FIPC_Text &out){
+  out.add((unsigned int)_role).add(';').add(_held ? "1;" : "0;").add(((_held)&&(_ready)) ? "1;" : "0;");
+  out.add((unsigned long)_edges).add(';').add((unsigned long)_edgeTime);
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Toma el lote retenido y termina la retención.
+uint32_t FIPC_Sync::take(){
+  portENTER_CRITICAL(&_mux);
+  uint32_t epoch = _held;
+  _held = 0;
+  _holding = false;
+  portEXIT_CRITICAL(&_mux);
+  return epoch;
+}
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,149 @@
+/*! \file FIPC_Sync.h
+ *  \brief Clase que sincroniza el inicio de los movimientos de varios controladores.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Sync_h
+#define FIPC_Sync_h
+
+#include "Arduino.h"
+#include "FIPC_SyncLine.h"
+#include "FIPC_Text.h"
+
+#define SYNC_PULSE_US 1000 /*!< Duración en us del pulso de disparo del líder. */
+
+//!  Clase que sincroniza el inicio de los movimientos de varios controladores.
+/*!
+ *   Los controladores se conectan con una línea de disparo (ver FIPC_SyncLine). Con arm()
+ *   las acciones que FIPC_API prepara en los ejes (ver FIPC_Axis::armAction()) quedan
+ *   retenidas en lugar de liberarse; el lote retenido se libera en el ciclo de tiempo real
+ *   en que el líder genera el pulso de disparo con fire() o en que el seguidor detecta el
+ *   flanco ascendente de la línea, por lo que todos los controladores inician juntos.
+ *
+ *   Cada flanco registra su instante en us con el reloj del controlador: la diferencia
+ *   entre los instantes del mismo flanco en dos controladores es la diferencia entre sus
+ *   relojes, que permite llevar la telemetría de ambos a una misma base de tiempo.
+ *
+ *   arm(), hold(), cancel() y fire() se llaman desde request() y exec() desde la tarea de
+ *   tiempo real; el lote retenido se intercambia en una sección crítica.
+*/
+class FIPC_Sync
+{
+  public:
+    //! Rol del controlador.
+    typedef enum {SYNC_OFF,      /*!< Sin sincronización. */
+                  SYNC_LEADER,   /*!< Genera el pulso de disparo. */
+                  SYNC_FOLLOWER  /*!< Se dispara con el flanco de la línea. */
+    }SyncRole;
+
+    //! Constructor.
+    /*!
+      \param pLine Línea de disparo.
+    */
+    FIPC_Sync(FIPC_SyncLine* pLine);
+
+    //! Configura el rol y la GPIO de la línea.
+    /*!
+      Descarta la retención en curso (ver cancel()).
+      \param role Rol del controlador (ver SyncRole).
+      \param pin GPIO de la línea.
+      \return false si el rol o la GPIO no son válidos.
+    */
+    bool setRole(uint8_t role, uint8_t pin);
+
+    //! Retiene las acciones siguientes hasta el próximo disparo.
+    /*!
+      \return false si no se configuró un rol.
+    */
+    bool arm();
+
+    //! Verifica si las acciones se retienen.
+    bool isHolding() { return _holding; }
+
+    //! Retiene un lote de acciones preparadas.
+    /*!
+      \param epoch Lote de acciones.
+      \return false si no hay retención en curso, en cuyo caso el lote debe liberarse.
+    */
+    bool hold(uint32_t epoch);
+
+    //! Lote retenido.
+    /*!
+      \return El lote retenido, o 0 si no hay acciones retenidas.
+    */
+    uint32_t getHeld() { return _held; }
+
+    //! Informa si el lote retenido puede aplicarse sin demora en el disparo.
+    /*!
+      \param ready true si todos los ejes del lote pueden iniciar en el ciclo del disparo.
+    */
+    void setReady(bool ready) { _ready = ready; }
+
+    //! Descarta la retención.
+    /*!
+      \return El lote descartado, cuyas acciones preparadas deben cancelarse, o 0.
+    */
+    uint32_t cancel();
+
+    //! Solicita el pulso de disparo.
+    /*!
+      Sin acciones retenidas el pulso solo registra el instante del flanco en cada controlador.
+      \return false si el controlador no es el líder.
+    */
+    bool fire();
+
+    //! Proceso a ejecutar en tiempo real.
+    /*!
+      Genera el pulso de disparo del líder o detecta el flanco en el seguidor.
+      \return El lote a liberar en este ciclo, o 0.
+    */
+    uint32_t exec();
+
+    //! Solicita un reporte de la sincronización.
+    /*!
+      \param out Texto donde se agrega "rol;retenido;listo;flancos;instante del último flanco en us".
+    */
+    void getReport(FIPC_Text &out);
+
+  private:
+    FIPC_SyncLine* _line; /*!< Línea de disparo. */
+
+    volatile uint8_t _role = SYNC_OFF; /*!< Rol del controlador. */
+
+    volatile bool _holding = false; /*!< Las acciones se retienen hasta el disparo. */
+
+    volatile uint32_t _held = 0; /*!< Lote retenido (0 sin acciones retenidas). */
+
+    volatile bool _ready = false; /*!< El lote retenido puede aplicarse en el ciclo del disparo. */
+
+    volatile bool _fire = false; /*!< Disparo solicitado al líder. */
+
+    bool _pulse = false; /*!< Pulso de disparo en curso. */
+
+    volatile uint32_t _edges = 0; /*!< Disparos generados o detectados. */
+
+    volatile uint32_t _edgeTime = 0; /*!< Instante del último disparo en us. */
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED; /*!< Exclusión entre los núcleos. */
+
+    //! Toma el lote retenido y termina la retención.
+    /*!
+      \return El lote retenido, o 0.
+    */
+    uint32_t take();
+};
+#endif
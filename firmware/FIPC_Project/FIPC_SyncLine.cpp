@@ -0,0 +1,88 @@
+/*! \file FIPC_SyncLine.cpp
+    \brief Línea de disparo compartida entre controladores.
+*/
+
+#include "FIPC_SyncLine.h"
+
+volatile bool FIPC_SharedSyncLine::_level[SYNC_LINE_WIRES];
+volatile uint32_t FIPC_SharedSyncLine::_edges[SYNC_LINE_WIRES];
+volatile uint32_t FIPC_SharedSyncLine::_edgeTime[SYNC_LINE_WIRES];
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Configura la línea en una GPIO.
+void FIPC_GpioSyncLine::begin(uint8_t pin, bool output){
+  if( _input ) detachInterrupt(digitalPinToInterrupt(_pin));
+  _input = false;
+  _pin = pin;
+  if( _pin==SYNC_LINE_NONE ) return;
+  if( output ){
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+  } else {
+    pinMode(_pin, INPUT_PULLDOWN);
+    _seen = _edges;
+    attachInterruptArg(digitalPinToInterrupt(_pin), FIPC_GpioSyncLine::isr, this, RISING);
+    _input = true;
+  }
+}
+
+// Cambia el nivel de la GPIO.
+void FIPC_GpioSyncLine::set(bool level){
+  if( (_pin!=SYNC_LINE_NONE)&&(!_input) ) digitalWrite(_pin, level ? HIGH : LOW);
+}
+
+// Verifica si hubo un flanco ascendente desde la última llamada.
+bool FIPC_GpioSyncLine::edge(uint32_t &time){
+  if( _edges==_seen ) return false;
+  portENTER_CRITICAL(&_mux);
+  _seen = _edges;
+  time = _edgeTime;
+  portEXIT_CRITICAL(&_mux);
+  return true;
+}
+
+// Configura una línea compartida.
+void FIPC_SharedSyncLine::begin(uint8_t pin, bool output){
+  _pin = (pin<SYNC_LINE_WIRES) ? pin : SYNC_LINE_NONE;
+  if( _pin==SYNC_LINE_NONE ) return;
+  if( output ) _level[_pin] = false;
+  _seen = _edges[_pin];
+}
+
+// Cambia el nivel de la línea compartida.
+void FIPC_SharedSyncLine::set(bool level){
+  if( _pin==SYNC_LINE_NONE ) return;
+  if( (level)&&(!_level[_pin]) ){
+    _edgeTime[_pin] = micros();
+    _edges[_pin] = _edges[_pin]+1;
+  }
+  _level[_pin] = level;
+}
+
+// Verifica si hubo un flanco ascendente desde la última llamada.
+bool FIPC_SharedSyncLine::edge(uint32_t &time){
+  if( (_pin==SYNC_LINE_NONE)||(_edges[_pin]==_seen) ) return false;
+  _seen = _edges[_pin];
+  time = _edgeTime[_pin];
+  return true;
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Interrupción del flanco ascendente.
+void IRAM_ATTR FIPC_GpioSyncLine::isr(void* arg){
+  FIPC_GpioSyncLine* line = (FIPC_GpioSyncLine*)arg;
+  portENTER_CRITICAL_ISR(&line->_mux);
+  line->_edgeTime = micros();
+  line->_edges = line->_edges+1;
+  portEXIT_CRITICAL_ISR(&line->_mux);
+}
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,122 @@
+/*! \file FIPC_SyncLine.h
+ *  \brief Línea de disparo compartida entre controladores.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_SyncLine_h
+#define FIPC_SyncLine_h
+
+#include "Arduino.h"
+
+#define SYNC_LINE_NONE  0xFF /*!< GPIO sin asignar. */
+#define SYNC_LINE_WIRES 64   /*!< Cantidad de líneas compartidas en memoria (una por número de GPIO). */
+
+//!  Interfaz de la línea de disparo compartida entre controladores.
+/*!
+ *   Una única señal digital conecta a todos los controladores: el líder la maneja como
+ *   salida y los seguidores detectan su flanco ascendente. FIPC_Sync solo utiliza esta
+ *   interfaz, por lo que la sincronización puede verificarse sin el hardware con varias
+ *   instancias de la API en un mismo proceso (ver FIPC_SharedSyncLine).
+*/
+class FIPC_SyncLine
+{
+  public:
+    //! Configura la línea.
+    /*!
+      \param pin GPIO de la línea (SYNC_LINE_NONE la libera).
+      \param output true en el líder, que maneja la línea; false en los seguidores.
+    */
+    virtual void begin(uint8_t pin, bool output) = 0;
+
+    //! Cambia el nivel de la línea (solo como salida).
+    /*!
+      \param level Nivel de la línea.
+    */
+    virtual void set(bool level) = 0;
+
+    //! Verifica si hubo un flanco ascendente desde la última llamada.
+    /*!
+      Si hubo más de un flanco se informa el último.
+      \param time Instante del flanco en us (micros() de este controlador).
+      \return true si hubo un flanco.
+    */
+    virtual bool edge(uint32_t &time) = 0;
+};
+
+
+//!  Línea de disparo en una GPIO.
+/*!
+ *   Como entrada, el flanco ascendente se registra en una interrupción con su instante,
+ *   de modo que el tiempo del flanco no depende del período del ciclo de tiempo real
+ *   (el instante se usa para estimar la diferencia entre los relojes de los controladores).
+ *   La entrada tiene pull-down para no generar disparos con la línea desconectada.
+*/
+class FIPC_GpioSyncLine : public FIPC_SyncLine
+{
+  public:
+    void begin(uint8_t pin, bool output);
+
+    void set(bool level);
+
+    bool edge(uint32_t &time);
+
+  private:
+    uint8_t _pin = SYNC_LINE_NONE; /*!< GPIO de la línea. */
+
+    bool _input = false; /*!< Interrupción asociada a la GPIO. */
+
+    volatile uint32_t _edges = 0; /*!< Flancos detectados por la interrupción. */
+
+    uint32_t _seen = 0; /*!< Flancos informados por edge(). */
+
+    volatile uint32_t _edgeTime = 0; /*!< Instante del último flanco en us. */
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED; /*!< Exclusión con la interrupción. */
+
+    //! Interrupción del flanco ascendente.
+    static void IRAM_ATTR isr(void* arg);
+};
+
+
+//!  Línea de disparo en memoria compartida por las instancias de un proceso.
+/*!
+ *   Reemplaza a la GPIO en una compilación para PC: todas las instancias configuradas con
+ *   el mismo número de GPIO comparten la línea, de modo que varias API en un mismo proceso
+ *   (cada una con su tarea de tiempo real) se comportan como controladores conectados por
+ *   un cable. El instante del flanco es el del cambio de nivel del líder.
+*/
+class FIPC_SharedSyncLine : public FIPC_SyncLine
+{
+  public:
+    void begin(uint8_t pin, bool output);
+
+    void set(bool level);
+
+    bool edge(uint32_t &time);
+
+  private:
+    uint8_t _pin = SYNC_LINE_NONE; /*!< Línea compartida. */
+
+    uint32_t _seen = 0; /*!< Flancos informados por edge(). */
+
+    static volatile bool _level[SYNC_LINE_WIRES]; /*!< Nivel de cada línea. */
+
+    static volatile uint32_t _edges[SYNC_LINE_WIRES]; /*!< Flancos ascendentes de cada línea. */
+
+    static volatile uint32_t _edgeTime[SYNC_LINE_WIRES]; /*!< Instante del último flanco de cada línea en us. */
+};
+#endif
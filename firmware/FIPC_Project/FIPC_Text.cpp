@@ -0,0 +1,112 @@
+/*! \file FIPC_Text.cpp
+    \brief Clase que implementa un texto de capacidad fija sin memoria dinámica.
+*/
+
+#include "FIPC_Text.h"
+
+// Constructor.
+FIPC_Text::FIPC_Text(char* pBuffer, uint16_t iSize) {
+  _buffer = pBuffer;
+  _size = iSize;
+  FIPC_Text::clear();
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Borra el texto.
+FIPC_Text& FIPC_Text::clear(){
+  _length = 0;
+  _overflow = false;
+  if( _size ) _buffer[0] = '\0';
+  return *this;
+}
+
+// Agrega un caracter.
+FIPC_Text& FIPC_Text::add(char iChar){
+  if( _length+1>=_size ){
+    _overflow = true;
+    return *this;
+  }
+  _buffer[_length++] = iChar;
+  _buffer[_length] = '\0';
+  return *this;
+}
+
+// Agrega un texto.
+FIPC_Text& FIPC_Text::add(const char* iText){
+  while( *iText ) FIPC_Text::add(*iText++);
+  return *this;
+}
+
+// Agrega un entero.
+FIPC_Text& FIPC_Text::add(int iValue){
+  return FIPC_Text::add((long)iValue);
+}
+
+// Agrega un entero sin signo.
+FIPC_Text& FIPC_Text::add(unsigned int iValue){
+  return FIPC_Text::add((unsigned long)iValue);
+}
+
+// Agrega un entero largo.
+FIPC_Text& FIPC_Text::add(long iValue){
+  if( iValue<0 ){
+    FIPC_Text::add('-');
+    return FIPC_Text::add(0UL-(unsigned long)iValue);
+  }
+  return FIPC_Text::add((unsigned long)iValue);
+}
+
+// Agrega un entero largo sin signo.
+FIPC_Text& FIPC_Text::add(unsigned long iValue){
+  char digits[20];
+  uint8_t n = 0;
+  do{
+    digits[n++] = '0'+(iValue%10);
+    iValue /= 10;
+  }while( iValue );
+  while( n ) FIPC_Text::add(digits[--n]);
+  return *this;
+}
+
+// Agrega un número real.
+FIPC_Text& FIPC_Text::add(double iValue, uint8_t iDigits){
+  if( isnan(iValue) ) return FIPC_Text::add("nan");
+  if( isinf(iValue) ) return FIPC_Text::add("inf");
+  if( iValue<0.0 ){
+    FIPC_Text::add('-');
+    iValue = -iValue;
+  }
+
+  // Redondeo al último decimal
+  double rounding = 0.5;
+  for(uint8_t i = 0; i<iDigits; i++) rounding /= 10.0;
+  iValue += rounding;
+  if( iValue>4294967295.0 ) return FIPC_Text::add("ovf");
+
+  unsigned long integer = (unsigned long)iValue;
+  double remainder = iValue-(double)integer;
+  FIPC_Text::add(integer);
+  if( iDigits ) FIPC_Text::add('.');
+  while( iDigits-- ){
+    remainder *= 10.0;
+    uint8_t digit = (uint8_t)remainder;
+    FIPC_Text::add((char)('0'+digit));
+    remainder -= digit;
+  }
+  return *this;
+}
+
+// Retorna el texto.
+const char* FIPC_Text::c_str(){ return _buffer;}
+
+// Retorna la cantidad de caracteres.
+uint16_t FIPC_Text::length(){ return _length;}
+
+// Indica si se descartaron caracteres.
+bool FIPC_Text::overflow(){ return _overflow;}
+
+/* End: Public                            */
+/******************************************/
@@ -0,0 +1,91 @@
+/*! \file FIPC_Text.h
+ *  \brief Clase que implementa un texto de capacidad fija sin memoria dinámica.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Text_h
+#define FIPC_Text_h
+
+#include "Arduino.h"
+
+//!  Clase que implementa un texto de capacidad fija sin memoria dinámica.
+/*!
+ *   Reemplaza a String en los reportes: escribe sobre un buffer provisto por
+ *   el dueño (normalmente un miembro estático) y nunca reserva memoria. El
+ *   texto siempre queda terminado en '\0'; si no hay lugar los caracteres
+ *   sobrantes se descartan y se indica con overflow().
+ *
+ *   Los números reales se formatean con la misma cantidad de decimales y el
+ *   mismo redondeo que String(valor, decimales).
+*/
+class FIPC_Text
+{
+  public:
+    //! Constructor.
+    /*!
+      \param pBuffer Buffer donde se escribe el texto.
+      \param iSize Tamaño del buffer en bytes (incluye el '\0').
+     */
+    FIPC_Text(char* pBuffer, uint16_t iSize);
+
+    //! Borra el texto.
+    FIPC_Text& clear();
+
+    //! Agrega un texto.
+    FIPC_Text& add(const char* iText);
+
+    //! Agrega un caracter.
+    FIPC_Text& add(char iChar);
+
+    //! Agrega un entero.
+    FIPC_Text& add(int iValue);
+
+    //! Agrega un entero sin signo.
+    FIPC_Text& add(unsigned int iValue);
+
+    //! Agrega un entero largo.
+    FIPC_Text& add(long iValue);
+
+    //! Agrega un entero largo sin signo.
+    FIPC_Text& add(unsigned long iValue);
+
+    //! Agrega un número real.
+    /*!
+      \param iValue Valor a agregar.
+      \param iDigits Cantidad de decimales.
+    */
+    FIPC_Text& add(double iValue, uint8_t iDigits);
+
+    //! Retorna el texto terminado en '\0'.
+    const char* c_str();
+
+    //! Retorna la cantidad de caracteres.
+    uint16_t length();
+
+    //! Indica si se descartaron caracteres por falta de lugar desde el último clear().
+    bool overflow();
+
+  private:
+    char* _buffer; /*!< Buffer del texto. */
+
+    uint16_t _size; /*!< Tamaño del buffer. */
+
+    uint16_t _length = 0; /*!< Cantidad de caracteres escritos. */
+
+    bool _overflow = false; /*!< Se descartaron caracteres. */
+};
+#endif
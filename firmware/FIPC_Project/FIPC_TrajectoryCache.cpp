@@ -0,0 +1,281 @@
+/*! \file FIPC_TrajectoryCache.cpp
+    \brief Tablas de intervalos de las rampas de los desplazamientos del periférico RMT.
+*/
+
+#include "FIPC_TrajectoryCache.h"
+
+#define TRAJECTORY_MAGIC   0x46495431   /*!< Identificador del formato de las tablas ("FIT1"). */
+#define TRAJECTORY_VERSION 1            /*!< Versión del formato de las tablas. */
+#define TRAJECTORY_KEY     "trajectory" /*!< Clave de las tablas en el almacenamiento. */
+#define TRAJECTORY_SLACK   64           /*!< Bytes libres pedidos además de 1,5 por paso para registrar una rampa. */
+#define TRAJECTORY_RESERVE (TRAJECTORY_BYTES/4) /*!< Mayor reserva para la que se descartan tablas. */
+
+// Diferencia con signo en zigzag: los valores chicos de ambos signos ocupan un byte.
+static inline uint32_t IRAM_ATTR zigzag(int32_t e){ return ((uint32_t)e<<1)^(uint32_t)(e>>31); }
+static inline int32_t IRAM_ATTR unzigzag(uint32_t z){ return (int32_t)(z>>1)^-(int32_t)(z&1); }
+
+// Constructor.
+FIPC_TrajectoryCache::FIPC_TrajectoryCache(FIPC_Storage* pStorage) {
+  _storage = pStorage;
+  _blob.size = 0;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Lee las tablas guardadas.
+bool FIPC_TrajectoryCache::begin(){
+  _used = 0;
+  _entries = 0;
+  if( !_storage->read(TRAJECTORY_KEY, &_blob, sizeof(_blob)) ) return false;
+  if( (_blob.magic!=TRAJECTORY_MAGIC)||(_blob.version!=TRAJECTORY_VERSION)||(_blob.size>TRAJECTORY_BYTES) ) return false;
+  if( _blob.crc!=FIPC_Storage::crc16(_blob.data, _blob.size) ) return false;
+  uint16_t entries;
+  if( !FIPC_TrajectoryCache::validate(_blob.size, entries) ) return false;
+  _entries = entries;
+  _used = _blob.size;
+  return true;
+}
+
+// Busca la tabla de una rampa.
+// Sin tabla se reserva memoria para registrarla si no hay otro registro en curso: el
+// registro puede ocupar toda la memoria libre, y si no alcanza la rampa no se guarda. Con
+// el redondeo de las raíces los intervalos alternan entre dos valores y una rampa ocupa
+// 1 a 1,5 bytes por paso, por lo que las largas no descartan tablas.
+FIPC_TrajectoryCache::TrajectoryOpen FIPC_TrajectoryCache::open(uint64_t key, uint32_t length, TrajectoryReader &oReader){
+  if( length<TRAJECTORY_MIN_STEPS ) return TRAJECTORY_MISS;
+  TrajectoryOpen mode = TRAJECTORY_MISS;
+  portENTER_CRITICAL(&_mux);
+  long at = FIPC_TrajectoryCache::find(key, length);
+  if( at>=0 ){
+    TrajectoryEntry entry;
+    memcpy(&entry, &_blob.data[at], sizeof(entry));
+    oReader.p = &_blob.data[at+sizeof(entry)];
+    oReader.k = 0;
+    oReader.time = 0;
+    oReader.interval = entry.first;
+    oReader.run = 0;
+    _readers++;
+    _hits++;
+    mode = TRAJECTORY_HIT;
+  } else {
+    _misses++;
+    uint32_t need = sizeof(TrajectoryEntry)+length+length/2+TRAJECTORY_SLACK;
+    bool room = (need<=TRAJECTORY_RESERVE) ? FIPC_TrajectoryCache::evict(need) : (!_recording)&&(TRAJECTORY_BYTES-_used>=TRAJECTORY_RESERVE);
+    if( room ){
+      _recEntry.key = key;
+      _recEntry.first = 0;
+      _recEntry.length = length;
+      _recEntry.size = 0;
+      _recPos = &_blob.data[_used+sizeof(TrajectoryEntry)];
+      _recEnd = &_blob.data[TRAJECTORY_BYTES];
+      _recCount = _recTime = _recInterval = 0;
+      _recZeros = 0;
+      _recFailed = false;
+      _recording = true;
+      mode = TRAJECTORY_RECORD;
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+  return mode;
+}
+
+// Libera la tabla abierta por open().
+void FIPC_TrajectoryCache::close(TrajectoryOpen mode){
+  portENTER_CRITICAL(&_mux);
+  if( (mode==TRAJECTORY_HIT)&&(_readers) ) _readers--;
+  if( (mode==TRAJECTORY_RECORD)&&(_recording) ){
+    if( (!_recFailed)&&(_recCount==_recEntry.length) ){
+      uint8_t* start = &_blob.data[_used];
+      _recEntry.size = _recPos-(start+sizeof(TrajectoryEntry));
+      memcpy(start, &_recEntry, sizeof(_recEntry));
+      _used += sizeof(TrajectoryEntry)+_recEntry.size;
+      _entries++;
+    }
+    _recording = false;
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+// Registra el instante del próximo paso de la rampa.
+// Los ceros se acumulan y se escriben como una repetición.
+bool IRAM_ATTR FIPC_TrajectoryCache::record(uint32_t time){
+  if( (!_recording)||(_recFailed)||(_recCount>=_recEntry.length) ) return false;
+  uint32_t interval = time-_recTime;
+  bool ok = true;
+  if( _recCount==0 ){
+    _recEntry.first = interval;
+  } else {
+    int32_t e = (int32_t)(_recInterval-interval);
+    if( e==0 ){
+      if( ++_recZeros==TRAJECTORY_RUN_MAX ) ok = FIPC_TrajectoryCache::flush();
+    } else {
+      ok = (FIPC_TrajectoryCache::flush())&&(FIPC_TrajectoryCache::put(zigzag(e)));
+    }
+  }
+  _recTime = time;
+  _recInterval = interval;
+  _recCount++;
+  if( (ok)&&(_recCount==_recEntry.length) ) ok = FIPC_TrajectoryCache::flush();
+  if( !ok ) _recFailed = true;
+  return ok;
+}
+
+// Avanza un paso: d(k) = d(k-1)-e(k) y T(k) = T(k-1)+d(k).
+void IRAM_ATTR FIPC_TrajectoryCache::forward(TrajectoryReader &reader){
+  if( reader.k++==0 ){ // el primer intervalo está en el encabezado
+    reader.time = reader.interval;
+    return;
+  }
+  uint32_t z = 0;
+  if( reader.run ){
+    reader.run--;
+  } else {
+    uint8_t b = *reader.p++;
+    if( b<0x80 )                     z = b;
+    else if( b!=TRAJECTORY_ESCAPE )  reader.run = b-0x80;
+    else { memcpy(&z, reader.p, sizeof(z)); reader.p += sizeof(z)+1; }
+  }
+  reader.interval -= (uint32_t)unzigzag(z);
+  reader.time += reader.interval;
+}
+
+// Retrocede un paso: T(k-1) = T(k)-d(k) y d(k-1) = d(k)+e(k).
+void IRAM_ATTR FIPC_TrajectoryCache::backward(TrajectoryReader &reader){
+  reader.time -= reader.interval;
+  if( --reader.k==0 ) return;
+  uint32_t z = 0;
+  if( reader.run ){
+    reader.run--;
+  } else {
+    uint8_t b = *--reader.p;
+    if( b<0x80 )                     z = b;
+    else if( b!=TRAJECTORY_ESCAPE )  reader.run = b-0x80;
+    else { reader.p -= sizeof(z)+1; memcpy(&z, reader.p+1, sizeof(z)); }
+  }
+  reader.interval += (uint32_t)unzigzag(z);
+}
+
+// Prepara un cursor de forward() para leer con backward().
+// En medio de una repetición quedan hacia atrás los ceros ya leídos.
+void IRAM_ATTR FIPC_TrajectoryCache::reverse(TrajectoryReader &reader){
+  if( !reader.run ) return;
+  reader.p--;
+  reader.run = (*reader.p-0x7F)-reader.run;
+}
+
+// Descarta todas las tablas.
+bool FIPC_TrajectoryCache::clear(){
+  bool ok = false;
+  portENTER_CRITICAL(&_mux);
+  if( (!_readers)&&(!_recording)&&(!_frozen) ){
+    _used = 0;
+    _entries = 0;
+    _hits = _misses = _evicted = 0;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&_mux);
+  return ok;
+}
+
+// Guarda las tablas en el almacenamiento no volátil.
+// Las tablas confirmadas durante la escritura quedan después de los bytes guardados.
+bool FIPC_TrajectoryCache::save(){
+  portENTER_CRITICAL(&_mux);
+  _frozen = true;
+  uint32_t size = _used;
+  portEXIT_CRITICAL(&_mux);
+  _blob.magic = TRAJECTORY_MAGIC;
+  _blob.version = TRAJECTORY_VERSION;
+  _blob.size = size;
+  _blob.crc = FIPC_Storage::crc16(_blob.data, size);
+  bool ok = _storage->write(TRAJECTORY_KEY, &_blob, sizeof(_blob));
+  _frozen = false;
+  return ok;
+}
+
+// Solicita un reporte de las tablas.
+void FIPC_TrajectoryCache::getReport(FIPC_Text &out){
+  out.add((unsigned int)_entries).add(';');
+  out.add((unsigned long)_used).add(';').add((unsigned long)TRAJECTORY_BYTES).add(';');
+  out.add((unsigned long)_hits).add(';').add((unsigned long)_misses).add(';').add((unsigned long)_evicted);
+}
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Busca una tabla de la aceleración con al menos los pasos pedidos.
+long FIPC_TrajectoryCache::find(uint64_t key, uint32_t length){
+  uint32_t at = 0;
+  while( at<_used ){
+    TrajectoryEntry entry;
+    memcpy(&entry, &_blob.data[at], sizeof(entry));
+    if( (entry.key==key)&&(entry.length>=length) ) return at;
+    at += sizeof(entry)+entry.size;
+  }
+  return -1;
+}
+
+// Descarta las tablas más antiguas hasta dejar libre la cantidad de bytes pedida.
+// Mover la memoria solo es posible si ninguna tabla se está leyendo, registrando ni guardando.
+bool FIPC_TrajectoryCache::evict(uint32_t bytes){
+  if( _recording ) return false;
+  if( TRAJECTORY_BYTES-_used>=bytes ) return true;
+  if( (_readers)||(_frozen)||(bytes>TRAJECTORY_BYTES) ) return false;
+  uint32_t cut = 0;
+  while( TRAJECTORY_BYTES-_used+cut<bytes ){
+    TrajectoryEntry entry;
+    memcpy(&entry, &_blob.data[cut], sizeof(entry));
+    cut += sizeof(entry)+entry.size;
+    _entries--;
+    _evicted++;
+  }
+  memmove(_blob.data, &_blob.data[cut], _used-cut);
+  _used -= cut;
+  return true;
+}
+
+// Escribe un símbolo.
+bool IRAM_ATTR FIPC_TrajectoryCache::put(uint32_t z){
+  if( z<0x80 ){
+    if( _recPos>=_recEnd ) return false;
+    *_recPos++ = z;
+    return true;
+  }
+  if( _recEnd-_recPos<(long)sizeof(z)+2 ) return false;
+  *_recPos++ = TRAJECTORY_ESCAPE;
+  memcpy(_recPos, &z, sizeof(z));
+  _recPos += sizeof(z);
+  *_recPos++ = TRAJECTORY_ESCAPE;
+  return true;
+}
+
+// Escribe la repetición de ceros pendiente.
+bool IRAM_ATTR FIPC_TrajectoryCache::flush(){
+  if( !_recZeros ) return true;
+  if( _recPos>=_recEnd ) return false;
+  *_recPos++ = 0x7F+_recZeros;
+  _recZeros = 0;
+  return true;
+}
+
+// Verifica la secuencia de tablas de una memoria.
+bool FIPC_TrajectoryCache::validate(uint32_t size, uint16_t &oEntries){
+  uint32_t at = 0;
+  oEntries = 0;
+  while( at<size ){
+    TrajectoryEntry entry;
+    if( size-at<sizeof(entry) ) return false;
+    memcpy(&entry, &_blob.data[at], sizeof(entry));
+    if( (entry.length<TRAJECTORY_MIN_STEPS)||(entry.size>size-at-sizeof(entry)) ) return false;
+    at += sizeof(entry)+entry.size;
+    oEntries++;
+  }
+  return true;
+}
+/* End: Private                           */
+/******************************************/
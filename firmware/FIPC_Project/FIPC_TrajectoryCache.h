@@ -0,0 +1,233 @@
+/*! \file FIPC_TrajectoryCache.h
+ *  \brief Tablas de intervalos de las rampas de los desplazamientos del periférico RMT.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_TrajectoryCache_h
+#define FIPC_TrajectoryCache_h
+
+#include "Arduino.h"
+#include "FIPC_Storage.h"
+#include "FIPC_Text.h"
+
+#define TRAJECTORY_BYTES      8192 /*!< Memoria de las tablas en bytes. */
+#define TRAJECTORY_MIN_STEPS  32   /*!< Pasos mínimos de la rampa para usar una tabla. */
+#define TRAJECTORY_RUN_MAX    127  /*!< Mayor cantidad de ceros de un símbolo de repetición. */
+#define TRAJECTORY_ESCAPE     0xFF /*!< Marca de un valor de 4 bytes (antes y después). */
+
+//! Cursor de lectura de una tabla.
+typedef struct{
+  const uint8_t* p;  /*!< Próximo byte (hacia adelante) o final del próximo símbolo (hacia atrás). */
+  uint32_t k;        /*!< Paso de la rampa. */
+  uint32_t time;     /*!< Instante del paso k en ticks. */
+  uint32_t interval; /*!< Intervalo entre los pasos k-1 y k en ticks. */
+  uint8_t run;       /*!< Ceros pendientes del último símbolo de repetición. */
+}TrajectoryReader;
+
+//!  Clase que guarda las rampas de aceleración ya calculadas de FIPC_PulseEncoder.
+/*!
+ *   Los instantes de la rampa de un desplazamiento del periférico RMT son raíces cuadradas
+ *   enteras que dependen solo de la aceleración (FIPC_PulseEncoder::timeAt()), y la
+ *   desaceleración recorre los mismos intervalos en orden inverso. Las recetas de
+ *   producción repiten los mismos desplazamientos, por lo que la rampa de cada aceleración
+ *   se registra la primera vez que se emite y las siguientes se reproducen de la tabla sin
+ *   calcular raíces en la interrupción, con los mismos ticks. El crucero se sigue calculando
+ *   en punto fijo (una suma por paso).
+ *
+ *   \par Formato
+ *   La memoria es una secuencia de tablas, de la más antigua a la más reciente. Cada una
+ *   tiene un encabezado TrajectoryEntry y los símbolos de las diferencias entre intervalos
+ *   consecutivos e(k) = d(k-1)-d(k), k = 2..length, en zigzag:
+ *   \li 0x01 a 0x7F: el valor en un byte.
+ *   \li 0x80 a 0xFE: repetición de 1 a TRAJECTORY_RUN_MAX ceros.
+ *   \li TRAJECTORY_ESCAPE, 4 bytes y TRAJECTORY_ESCAPE: valores mayores.
+ *   Los símbolos se leen en ambos sentidos: hacia adelante en la aceleración y hacia atrás
+ *   en la desaceleración.
+ *
+ *   \par Uso
+ *   open() se llama desde el proceso en tiempo real al iniciar el desplazamiento: si hay una
+ *   tabla la reserva para lectura, si no intenta reservar memoria para registrar la rampa con
+ *   record() desde la interrupción. close() al terminar confirma el registro si la rampa se
+ *   completó. Para hacer lugar se descartan las tablas más antiguas, solo si ninguna está en
+ *   lectura ni registrándose. Una rampa a la vez se registra; el resto de los fallos se
+ *   calcula como antes.
+ *
+ *   La memoria se guarda en el almacenamiento no volátil con save() ("TCACHE:1:") y se lee
+ *   en begin(), por lo que las tablas sobreviven un reinicio.
+*/
+class FIPC_TrajectoryCache
+{
+  public:
+    //! Resultado de open().
+    typedef enum {TRAJECTORY_MISS,   /*!< Sin tabla, se calcula. */
+                  TRAJECTORY_HIT,    /*!< Tabla reservada para lectura. */
+                  TRAJECTORY_RECORD  /*!< Sin tabla, se registra la rampa. */
+    }TrajectoryOpen;
+
+    //! Constructor.
+    /*!
+      \param pStorage Almacenamiento no volátil.
+     */
+    FIPC_TrajectoryCache(FIPC_Storage* pStorage);
+
+    //! Lee las tablas guardadas.
+    /*!
+      \return false si no hay tablas guardadas válidas.
+    */
+    bool begin();
+
+    //! Busca la tabla de una rampa.
+    /*!
+      \param key Identificación de la aceleración (FIPC_PulseEncoder: 2f^2/a en ticks^2 por paso).
+      \param length Pasos de la rampa.
+      \param oReader Cursor al inicio de la tabla si la encuentra.
+      \return El resultado de la búsqueda.
+    */
+    TrajectoryOpen open(uint64_t key, uint32_t length, TrajectoryReader &oReader);
+
+    //! Libera la tabla abierta por open().
+    /*!
+      \param mode Resultado de open(). Un registro se confirma si se completó.
+    */
+    void close(TrajectoryOpen mode);
+
+    //! Registra el instante del próximo paso de la rampa.
+    /*!
+      \param time Instante del paso en ticks.
+      \return false si no hay memoria: la rampa no se guarda.
+    */
+    bool IRAM_ATTR record(uint32_t time);
+
+    //! Avanza un paso.
+    /*!
+      \param reader Cursor, en el paso k pasa a k+1.
+    */
+    static void IRAM_ATTR forward(TrajectoryReader &reader);
+
+    //! Retrocede un paso.
+    /*!
+      \param reader Cursor obtenido con reverse(), en el paso k pasa a k-1.
+    */
+    static void IRAM_ATTR backward(TrajectoryReader &reader);
+
+    //! Prepara un cursor de forward() para leer con backward().
+    static void IRAM_ATTR reverse(TrajectoryReader &reader);
+
+    //! Descarta todas las tablas.
+    /*!
+      \return false si hay una tabla en uso.
+    */
+    bool clear();
+
+    //! Guarda las tablas en el almacenamiento no volátil.
+    /*!
+      Desde el núcleo 0: mientras se escribe no se descartan tablas.
+      \return false si la escritura falló.
+    */
+    bool save();
+
+    //! Solicita un reporte de las tablas.
+    /*!
+      \param out Texto donde se agrega "tablas;bytes usados;bytes totales;aciertos;fallos;descartadas".
+    */
+    void getReport(FIPC_Text &out);
+
+  private:
+    //! Encabezado de cada tabla.
+    typedef struct{
+      uint64_t key;    /*!< Identificación de la aceleración. */
+      uint32_t first;  /*!< Instante del primer paso en ticks. */
+      uint32_t length; /*!< Pasos de la rampa. */
+      uint32_t size;   /*!< Bytes de los símbolos. */
+    }TrajectoryEntry;
+
+    //! Bloque guardado en el almacenamiento no volátil.
+    typedef struct{
+      uint32_t magic;   /*!< Identificador del formato. */
+      uint16_t version; /*!< Versión del formato. */
+      uint16_t crc;     /*!< CRC-16 de los bytes usados. */
+      uint32_t size;    /*!< Bytes usados. */
+      uint8_t data[TRAJECTORY_BYTES]; /*!< Tablas. */
+    }TrajectoryBlob;
+
+    FIPC_Storage* _storage; /*!< Almacenamiento no volátil. */
+
+    TrajectoryBlob _blob; /*!< Tablas (los bytes usados son _used, _blob.size es el de la última lectura o escritura). */
+
+    volatile uint32_t _used = 0; /*!< Bytes usados. */
+
+    uint16_t _entries = 0; /*!< Cantidad de tablas. */
+
+    uint8_t _readers = 0; /*!< Tablas en lectura. */
+
+    volatile bool _frozen = false; /*!< Escritura en el almacenamiento en curso. */
+
+    bool _recording = false; /*!< Registro en curso. */
+
+    uint8_t* _recPos = NULL; /*!< Próximo byte del registro. */
+
+    uint8_t* _recEnd = NULL; /*!< Final de la memoria reservada para el registro. */
+
+    TrajectoryEntry _recEntry; /*!< Encabezado de la tabla en registro. */
+
+    uint32_t _recCount = 0; /*!< Pasos registrados. */
+
+    uint32_t _recTime = 0; /*!< Instante del último paso registrado. */
+
+    uint32_t _recInterval = 0; /*!< Último intervalo registrado. */
+
+    uint8_t _recZeros = 0; /*!< Ceros pendientes de escribir. */
+
+    bool _recFailed = false; /*!< La memoria reservada no alcanzó. */
+
+    uint32_t _hits = 0; /*!< Desplazamientos con tabla. */
+
+    uint32_t _misses = 0; /*!< Desplazamientos sin tabla. */
+
+    uint32_t _evicted = 0; /*!< Tablas descartadas para hacer lugar. */
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED; /*!< Exclusión entre los núcleos. */
+
+    //! Busca una tabla.
+    /*!
+      \param key Identificación de la aceleración.
+      \param length Pasos mínimos de la rampa.
+      \return Posición de la tabla en _blob.data o -1.
+    */
+    long find(uint64_t key, uint32_t length);
+
+    //! Descarta las tablas más antiguas hasta dejar libre la cantidad de bytes pedida.
+    /*!
+      \return false si no alcanza.
+    */
+    bool evict(uint32_t bytes);
+
+    //! Escribe un símbolo.
+    bool IRAM_ATTR put(uint32_t zigzag);
+
+    //! Escribe la repetición de ceros pendiente.
+    bool IRAM_ATTR flush();
+
+    //! Verifica la secuencia de tablas de una memoria.
+    /*!
+      \param size Bytes usados.
+      \param oEntries Cantidad de tablas.
+      \return false si una tabla excede la memoria.
+    */
+    bool validate(uint32_t size, uint16_t &oEntries);
+};
+#endif
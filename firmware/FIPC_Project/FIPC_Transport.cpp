@@ -0,0 +1,95 @@
+/*! \file FIPC_Transport.cpp
+    \brief Transporte de las conexiones de red.
+*/
+
+#include "FIPC_Transport.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "lwip/sockets.h"
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <errno.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // sin señales en lwIP
+#endif
+
+// Constructor.
+FIPC_TcpTransport::FIPC_TcpTransport(){
+  for( uint8_t i=0; i<TRANSPORT_CLIENTS; i++ ) _socket[i] = -1;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Comienza a aceptar conexiones.
+bool FIPC_TcpTransport::begin(uint16_t port){
+  if( _server>=0 ) return true;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if( fd<0 ) return false;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if( (bind(fd, (struct sockaddr*)&address, sizeof(address))<0)||(::listen(fd, TRANSPORT_CLIENTS)<0) ){
+    ::close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0)|O_NONBLOCK);
+  _server = fd;
+  return true;
+}
+
+// Acepta una conexión pendiente.
+int8_t FIPC_TcpTransport::incoming(){
+  if( _server<0 ) return -1;
+  int fd = ::accept(_server, NULL, NULL);
+  if( fd<0 ) return -1;
+  for( uint8_t i=0; i<TRANSPORT_CLIENTS; i++ ){
+    if( _socket[i]>=0 ) continue;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0)|O_NONBLOCK);
+    _socket[i] = fd;
+    return i;
+  }
+  ::close(fd); // sin índices libres
+  return -1;
+}
+
+// Lee los bytes disponibles de una conexión.
+int16_t FIPC_TcpTransport::receive(uint8_t id, char* data, uint16_t size){
+  if( (id>=TRANSPORT_CLIENTS)||(_socket[id]<0) ) return -1;
+  int n = recv(_socket[id], data, size, 0);
+  if( n>0 ) return n;
+  if( (n<0)&&((errno==EAGAIN)||(errno==EWOULDBLOCK)||(errno==EINTR)) ) return 0;
+  return -1; // 0 bytes: el otro extremo cerró la conexión
+}
+
+// Escribe los bytes que admita el buffer de envío.
+int16_t FIPC_TcpTransport::transmit(uint8_t id, const char* data, uint16_t size){
+  if( (id>=TRANSPORT_CLIENTS)||(_socket[id]<0) ) return -1;
+  int n = send(_socket[id], data, size, MSG_NOSIGNAL);
+  if( n>=0 ) return n;
+  if( (errno==EAGAIN)||(errno==EWOULDBLOCK)||(errno==EINTR) ) return 0;
+  return -1;
+}
+
+// Cierra una conexión.
+void FIPC_TcpTransport::release(uint8_t id){
+  if( (id>=TRANSPORT_CLIENTS)||(_socket[id]<0) ) return;
+  ::close(_socket[id]);
+  _socket[id] = -1;
+}
+/* End: Public                            */
+/******************************************/
@@ -0,0 +1,105 @@
+/*! \file FIPC_Transport.h
+ *  \brief Interfaz de transporte de las conexiones de red.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Transport_h
+#define FIPC_Transport_h
+
+#include "Arduino.h"
+
+#define TRANSPORT_CLIENTS 4 /*!< Cantidad máxima de conexiones simultáneas. */
+
+//!  Interfaz de transporte de las conexiones de red.
+/*!
+ *   Flujo de bytes por conexión, sin bloqueo: las lecturas y escrituras retornan
+ *   inmediatamente con los bytes que pudieron transferirse. Las conexiones se identifican
+ *   con un índice de 0 a TRANSPORT_CLIENTS-1. FIPC_Network implementa el protocolo sobre
+ *   esta interfaz, por lo que puede verificarse con cualquier transporte (ver FIPC_TcpTransport).
+*/
+class FIPC_Transport
+{
+  public:
+    //! Comienza a aceptar conexiones.
+    /*!
+      \param port Puerto.
+      \return true si se pudo abrir el puerto.
+    */
+    virtual bool begin(uint16_t port) = 0;
+
+    //! Acepta una conexión pendiente.
+    /*!
+      Si no hay índices libres la conexión se rechaza.
+      \return El índice de la nueva conexión, o -1 si no hay conexiones pendientes.
+    */
+    virtual int8_t incoming() = 0;
+
+    //! Lee los bytes disponibles de una conexión.
+    /*!
+      \param id Índice de la conexión.
+      \param data Destino de los datos.
+      \param size Cantidad máxima de bytes.
+      \return Bytes leídos, 0 sin datos o -1 si la conexión se cerró.
+    */
+    virtual int16_t receive(uint8_t id, char* data, uint16_t size) = 0;
+
+    //! Escribe en una conexión los bytes que admita sin bloquear.
+    /*!
+      \param id Índice de la conexión.
+      \param data Datos.
+      \param size Cantidad de bytes.
+      \return Bytes aceptados (0 si el buffer de envío está lleno) o -1 si la conexión se cerró.
+    */
+    virtual int16_t transmit(uint8_t id, const char* data, uint16_t size) = 0;
+
+    //! Cierra una conexión.
+    /*!
+      \param id Índice de la conexión.
+    */
+    virtual void release(uint8_t id) = 0;
+};
+
+
+//!  Transporte TCP con la interfaz de sockets.
+/*!
+ *   Utiliza sockets no bloqueantes con TCP_NODELAY, para que cada respuesta se envíe sin
+ *   esperar a completar un segmento. En el ESP32 los sockets son los de lwIP (la conexión
+ *   WiFi debe establecerse antes de begin()) y en una compilación para PC los del sistema
+ *   operativo, lo que permite probar el firmware con conexiones locales.
+*/
+class FIPC_TcpTransport : public FIPC_Transport
+{
+  public:
+    //! Constructor.
+    FIPC_TcpTransport();
+
+    bool begin(uint16_t port);
+
+    int8_t incoming();
+
+    int16_t receive(uint8_t id, char* data, uint16_t size);
+
+    int16_t transmit(uint8_t id, const char* data, uint16_t size);
+
+    void release(uint8_t id);
+
+  private:
+    int _server = -1; /*!< Socket que acepta conexiones. */
+
+    int _socket[TRANSPORT_CLIENTS]; /*!< Socket de cada conexión (-1 libre). */
+};
+#endif
@@ -0,0 +1,221 @@
+/*! \file FIPC_Tune.cpp
+    \brief Caracterización de la velocidad y la aceleración máxima de un eje.
+*/
+
+#include "FIPC_Tune.h"
+
+// Constructor.
+FIPC_Tune::FIPC_Tune(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Budget* pBudget) {
+  _axisList = pAxis;
+  _axisNumbers = iAxisNumbers;
+  _budget = pBudget;
+}
+
+
+/******************************************/
+/* Begin: Public                          */
+
+// Inicia la caracterización de un eje desde la posición actual.
+bool FIPC_Tune::start(uint8_t id, float distance, uint16_t cycles, float tolerance){
+#if HOMING_SIMULATED
+  // El switch simulado no se desplaza con los pasos perdidos: los ensayos no detectarían
+  // pérdidas y los límites guardados serían los máximos ensayados
+  return false;
+#endif
+  if( FIPC_Tune::isRunning() ) return false;
+  if( (id==0)||(id>_axisNumbers)||(distance==0.0)||(cycles==0)||!(tolerance>=0.0) ) return false;
+  FIPC_Axis* axis = _axisList[id-1];
+  if( !axis->isReady() ) return false;
+  float origin = axis->getCurrentPosition();
+  if( !axis->canMoveAbsolute(origin+distance) ) return false;
+
+  // Los ensayos de velocidad deben llegar al crucero con la aceleración reducida
+  float accelSafe = TUNE_ACCEL_SAFE*axis->getMaxAcceleration();
+  float veloHigh = min(axis->getSpeedLimit(), (float)sqrt(accelSafe*abs(distance)*(1.0-TUNE_CRUISE)));
+  float veloMax0 = axis->getMaxSpeed(), accelMax0 = axis->getMaxAcceleration();
+  float speed0 = axis->getSpeed(), accelTime0 = axis->getAccelerationTime();
+  if( !axis->setLimits(veloHigh, TUNE_ACCEL_RANGE*accelMax0) ) return false;
+
+  _axis = axis;
+  _id = id;
+  _origin = origin;
+  _distance = distance;
+  _cycles = cycles;
+  _tolerance = lroundf(tolerance*axis->getStepsPerUnit());
+  _accelSafe = accelSafe;
+  _veloMax0 = veloMax0;
+  _accelMax0 = accelMax0;
+  _speed0 = speed0;
+  _accelTime0 = accelTime0;
+  _high = veloHigh;
+  _veloMax = _accelMax = 0.0;
+  _trials = 0;
+  _error = 0;
+  _finished = _result = false;
+  _phase = PHASE_BASE;
+
+  FIPC_Tune::home();
+  return true;
+}
+
+// Cancela la caracterización.
+// Los límites se restauran en exec() cuando el eje se detiene.
+void FIPC_Tune::stop(){
+  if( (_status!=TUNE_HOME)&&(_status!=TUNE_MOVE) ) return;
+  _axis->setAction(FIPC_Axis::ACTION_STOP);
+  _status = TUNE_STOP;
+}
+
+// Retorna el estado de la caracterización.
+uint8_t FIPC_Tune::getStatus(){ return _status;}
+
+// Verifica si la caracterización está en ejecución.
+bool FIPC_Tune::isRunning(){
+  TuneStatus status = _status;
+  return (status==TUNE_HOME)||(status==TUNE_MOVE)||(status==TUNE_STOP);
+}
+
+// Solicita un reporte de la caracterización.
+void FIPC_Tune::getReport(FIPC_Text &out){
+  switch(_status){
+    case TUNE_IDLE:    out.add("Idle");     break;
+    case TUNE_HOME:    out.add("Homing");   break;
+    case TUNE_MOVE:    out.add("Moving");   break;
+    case TUNE_STOP:    out.add("Stopping"); break;
+    case TUNE_DONE:    out.add("Done");     break;
+    case TUNE_FAILED:  out.add("Failed");   break;
+    case TUNE_ABORTED: out.add("Aborted");  break;
+  }
+  out.add(';').add(_id);
+  out.add(';').add(_trials);
+  out.add(';').add(_veloMax,2);
+  out.add(';').add(_accelMax,2);
+  out.add(';').add(_error);
+}
+
+// Consulta si la caracterización terminó desde la última consulta.
+bool FIPC_Tune::finished(){
+  if( !_finished ) return false;
+  _finished = false;
+  return true;
+}
+
+// Retorna los límites a guardar.
+bool FIPC_Tune::getResult(uint8_t &oId, float &oVeloMax, float &oAccelMax){
+  if( !_result ) return false;
+  oId = _id;
+  oVeloMax = _veloMax;
+  oAccelMax = _accelMax;
+  _result = false;
+  return true;
+}
+
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+void FIPC_Tune::exec(){
+  if( !FIPC_Tune::isRunning() ) return;
+
+  // Espera que el eje termine el desplazamiento o la búsqueda del cero
+  if( !_axis->isIdle() ) return;
+
+  // 1° Cancelada o el eje perdió la referencia
+  if( (_status==TUNE_STOP)||(!_axis->isReady()) ){
+    FIPC_Tune::finish(TUNE_ABORTED);
+    return;
+  }
+
+  // 2° Un desplazamiento por ciclo hasta completar las idas y vueltas
+  if( _status==TUNE_MOVE ){
+    if( _legs<2UL*_cycles ){
+      // La caracterización no se estira: un desplazamiento descartado la cancela
+      float target = (_legs&1) ? _origin : _origin+_distance;
+      if( !_budget->setAction(&_axis, 1, FIPC_Axis::ACTION_MOVE_ABSOLUTE, &target) ){
+        FIPC_Tune::finish(TUNE_ABORTED);
+        return;
+      }
+      _legs++;
+    } else {
+      FIPC_Tune::home();
+    }
+    return;
+  }
+
+  // 3° Referencia encontrada: los pasos perdidos desplazan el flanco del switch
+  _error = _axis->getHomingError();
+  FIPC_Tune::onTrial(abs(_error)<=_tolerance);
+}
+/*------------ PROCESO EN TIEMPO REAL ----------*/
+
+/* End: Public                            */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Private                         */
+
+// Repite la búsqueda del cero.
+void FIPC_Tune::home(){
+  _status = TUNE_HOME;
+  float scale;
+  if( (!_budget->admit(&_axis, 1, FIPC_Axis::ACTION_HOMING, NULL, scale, false))||(!_axis->rehome()) )
+    FIPC_Tune::finish(TUNE_ABORTED);
+}
+
+// Inicia el ensayo del punto medio del intervalo de búsqueda.
+void FIPC_Tune::trial(){
+  _value = 0.5*(_low+_high);
+  float speed = (_phase==PHASE_VELO) ? _value : _veloMax;
+  float accel = (_phase==PHASE_VELO) ? _accelSafe : _value;
+  _axis->setSpeed(speed);
+  _axis->setAccelerationTime(speed/accel);
+  _legs = 0;
+  _status = TUNE_MOVE;
+}
+
+// Procesa el resultado de un ensayo.
+void FIPC_Tune::onTrial(bool pass){
+  if( _phase==PHASE_BASE ){ // la referencia inicial no se evalúa
+    _phase = PHASE_VELO;
+    _low = 0.0;
+    _step = 0;
+    FIPC_Tune::trial();
+    return;
+  }
+
+  _trials++;
+  if( pass ) _low = _value;
+  else       _high = _value;
+  if( ++_step<TUNE_ITERATIONS ){
+    FIPC_Tune::trial();
+    return;
+  }
+  if( _low==0.0 ){
+    FIPC_Tune::finish(TUNE_FAILED);
+    return;
+  }
+
+  if( _phase==PHASE_VELO ){
+    _veloMax = TUNE_SAFETY*_low;
+    _phase = PHASE_ACCEL;
+    _low = 0.0;
+    _high = TUNE_ACCEL_RANGE*_accelMax0;
+    _step = 0;
+    FIPC_Tune::trial();
+    return;
+  }
+  _accelMax = TUNE_SAFETY*_low;
+  FIPC_Tune::finish(TUNE_DONE);
+}
+
+// Aplica los límites y finaliza la caracterización.
+void FIPC_Tune::finish(TuneStatus status){
+  if( status==TUNE_DONE ) _axis->setLimits(_veloMax, _accelMax);
+  else                    _axis->setLimits(_veloMax0, _accelMax0);
+  _axis->setSpeed(_speed0); // rechazada si no es menor que la nueva velocidad máxima
+  _axis->setAccelerationTime(_accelTime0);
+  _result = (status==TUNE_DONE);
+  _status = status;
+  _finished = true;
+}
+
+/* End: Private                           */
+/******************************************/
@@ -0,0 +1,216 @@
+/*! \file FIPC_Tune.h
+ *  \brief Caracterización de la velocidad y la aceleración máxima de un eje.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef FIPC_Tune_h
+#define FIPC_Tune_h
+
+#include "Arduino.h"
+#include "FIPC_Axis.h"
+#include "FIPC_Budget.h"
+#include "FIPC_Text.h"
+
+#define TUNE_ITERATIONS  6    /*!< Ensayos de la búsqueda binaria de cada límite. */
+#define TUNE_SAFETY      0.8  /*!< Fracción de los límites encontrados que se aplica y se guarda. */
+#define TUNE_ACCEL_SAFE  0.5  /*!< Fracción de la aceleración configurada en los ensayos de velocidad. */
+#define TUNE_ACCEL_RANGE 4.0  /*!< Máxima aceleración ensayada como múltiplo de la configurada. */
+#define TUNE_CRUISE      0.5  /*!< Fracción mínima de cada desplazamiento a velocidad constante en los ensayos de velocidad. */
+
+//!  Caracterización de la velocidad y la aceleración máxima de un eje.
+/*!
+ *   Los límites de los tipos de eje (ver FIPC_Axis::getPreset()) son estimaciones fijas; esta
+ *   rutina los mide en el eje instalado. Se ejecuta completamente en el controlador desde el
+ *   proceso en tiempo real, como FIPC_Align.
+ *
+ *   \par Ensayos
+ *   Cada ensayo repite desplazamientos de ida y vuelta entre la posición inicial y la posición
+ *   inicial más la distancia pedida con la velocidad y la aceleración a ensayar, y luego repite
+ *   la búsqueda del cero (ver FIPC_Axis::rehome()). Si el motor perdió pasos el flanco del switch
+ *   se desplaza: el ensayo falla si el desvío supera la tolerancia. La búsqueda del cero vuelve
+ *   a fijar la referencia, por lo que un ensayo fallido no afecta a los siguientes. Antes del
+ *   primer ensayo se busca el cero una vez para partir de una referencia reciente.
+ *   Con el switch simulado (HOMING_SIMULATED en 1) la referencia no detecta pasos perdidos,
+ *   por lo que la caracterización no se inicia.
+ *
+ *   \par Búsqueda
+ *   \li Velocidad: búsqueda binaria de TUNE_ITERATIONS ensayos entre 0 y la menor de la velocidad
+ *   que admite la generación de pulsos (FIPC_Axis::getSpeedLimit()) y la que deja al menos
+ *   TUNE_CRUISE de la distancia a velocidad constante, con TUNE_ACCEL_SAFE de la aceleración
+ *   configurada.
+ *   \li Aceleración: búsqueda binaria de TUNE_ITERATIONS ensayos entre 0 y TUNE_ACCEL_RANGE veces
+ *   la aceleración configurada, a la velocidad resultante.
+ *
+ *   Los límites resultantes son TUNE_SAFETY del mayor valor sin pérdida de pasos. Se aplican al eje
+ *   (FIPC_Axis::setLimits()) y getResult() los entrega una vez para guardarlos fuera del proceso en
+ *   tiempo real (ver FIPC_Config::setLimits()). Si se cancela, el eje pierde la referencia o ningún
+ *   ensayo resulta sin pérdida se restauran los límites, la velocidad y el tiempo de aceleración
+ *   anteriores.
+*/
+class FIPC_Tune
+{
+  public:
+
+    //! Definicion de variable simbólica de estados de la caracterización.
+    typedef enum{ TUNE_IDLE,     /*!< Sin caracterización en ejecución. */
+                  TUNE_HOME,     /*!< Buscando el cero para verificar la referencia. */
+                  TUNE_MOVE,     /*!< Desplazamientos del ensayo. */
+                  TUNE_STOP,     /*!< Cancelada, esperando que el eje se detenga. */
+                  TUNE_DONE,     /*!< Caracterización finalizada. */
+                  TUNE_FAILED,   /*!< Ningún ensayo resultó sin pérdida de pasos. */
+                  TUNE_ABORTED   /*!< Caracterización cancelada. */
+                  }TuneStatus;
+
+    //! Constructor.
+    /*!
+      \param pAxis Lista de ejes del controlador.
+      \param iAxisNumbers Cantidad de ejes en la lista.
+      \param pBudget Presupuesto de pasos de exec() de las acciones de los ejes.
+     */
+    FIPC_Tune(FIPC_Axis* pAxis[], uint8_t iAxisNumbers, FIPC_Budget* pBudget);
+
+    //! Inicia la caracterización de un eje desde la posición actual.
+    /*!
+      \param id Identificador del eje, debe tener referencia válida y estar en reposo.
+      \param distance Distancia de los desplazamientos en unidades del eje (con signo).
+      \param cycles Cantidad de idas y vueltas de cada ensayo.
+      \param tolerance Desvío admitido de la referencia en unidades del eje.
+      \return true si la caracterización fue iniciada. Con HOMING_SIMULATED en 1 siempre es false:
+      la caracterización requiere el switch de referencia real.
+    */
+    bool start(uint8_t id, float distance, uint16_t cycles, float tolerance);
+
+    //! Cancela la caracterización y detiene el eje.
+    void stop();
+
+    //! Ejecuta la caracterización.
+    /*!
+     * Esta función deberá ser llamada recurrentemente en tiempo real.
+    */
+    void exec();
+
+    //! Retorna el estado de la caracterización.
+    /*!
+      \return La variable simbólica que describe el estado de la caracterización.
+    */
+    uint8_t getStatus();
+
+    //! Verifica si la caracterización está en ejecución.
+    bool isRunning();
+
+    //! Solicita un reporte de la caracterización.
+    /*!
+      \param out Texto donde se agrega "estado;eje;ensayos;velocidad máxima;aceleración máxima;
+      desvío de la última búsqueda del cero en pasos" (límites en 0 hasta que se determinan).
+    */
+    void getReport(FIPC_Text &out);
+
+    //! Consulta si la caracterización terminó desde la última consulta.
+    /*!
+      \return true una única vez al finalizar la caracterización.
+    */
+    bool finished();
+
+    //! Retorna los límites a guardar.
+    /*!
+      \param oId Identificador del eje.
+      \param oVeloMax Velocidad máxima en unidades/s.
+      \param oAccelMax Aceleración máxima en unidades/s^2.
+      \return true una única vez al finalizar una caracterización exitosa.
+    */
+    bool getResult(uint8_t &oId, float &oVeloMax, float &oAccelMax);
+
+  private:
+    //! Definicion de variable simbólica de etapas de la búsqueda.
+    typedef enum{ PHASE_BASE,   /*!< Búsqueda del cero inicial. */
+                  PHASE_VELO,   /*!< Búsqueda de la velocidad. */
+                  PHASE_ACCEL   /*!< Búsqueda de la aceleración. */
+                  }TunePhase;
+
+    FIPC_Axis** _axisList; /*!< Lista de ejes del controlador. */
+
+    uint8_t _axisNumbers; /*!< Cantidad de ejes en la lista. */
+
+    FIPC_Budget* _budget; /*!< Presupuesto de pasos de exec(). */
+
+    FIPC_Axis* _axis = NULL; /*!< Eje en caracterización. */
+
+    uint8_t _id = 0; /*!< Identificador del eje en caracterización. */
+
+    volatile TuneStatus _status = TUNE_IDLE; /*!< Estado de la caracterización. */
+
+    TunePhase _phase = PHASE_BASE; /*!< Etapa de la búsqueda. */
+
+    float _origin; /*!< Posición inicial. */
+
+    float _distance; /*!< Distancia de los desplazamientos. */
+
+    uint16_t _cycles; /*!< Idas y vueltas de cada ensayo. */
+
+    uint32_t _legs; /*!< Desplazamientos ordenados en el ensayo actual. */
+
+    long _tolerance; /*!< Desvío admitido de la referencia en pasos. */
+
+    long _error = 0; /*!< Desvío de la última búsqueda del cero en pasos. */
+
+    uint16_t _trials = 0; /*!< Ensayos completados. */
+
+    uint8_t _step; /*!< Ensayo de la búsqueda binaria en curso. */
+
+    float _low; /*!< Mayor valor ensayado sin pérdida de pasos. */
+
+    float _high; /*!< Menor valor ensayado con pérdida de pasos (o el límite de la búsqueda). */
+
+    float _value; /*!< Valor en ensayo. */
+
+    float _accelSafe; /*!< Aceleración de los ensayos de velocidad. */
+
+    float _veloMax = 0.0; /*!< Velocidad máxima resultante. */
+
+    float _accelMax = 0.0; /*!< Aceleración máxima resultante. */
+
+    float _veloMax0; /*!< Velocidad máxima anterior. */
+
+    float _accelMax0; /*!< Aceleración máxima anterior. */
+
+    float _speed0; /*!< Velocidad configurada anterior. */
+
+    float _accelTime0; /*!< Tiempo de aceleración configurado anterior. */
+
+    volatile bool _finished = false; /*!< Terminó y no fue informado. */
+
+    volatile bool _result = false; /*!< Terminó con éxito y los límites no fueron guardados. */
+
+    //! Repite la búsqueda del cero.
+    void home();
+
+    //! Inicia el ensayo del punto medio del intervalo de búsqueda.
+    void trial();
+
+    //! Procesa el resultado de un ensayo.
+    /*!
+      \param pass true si el ensayo no perdió pasos.
+    */
+    void onTrial(bool pass);
+
+    //! Aplica los límites y finaliza la caracterización.
+    /*!
+      \param status Estado final.
+    */
+    void finish(TuneStatus status);
+};
+#endif
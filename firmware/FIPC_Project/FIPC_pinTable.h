@@ -39,19 +39,53 @@
 #define   SW1_03    21 /*!< Input. Switch hacia coordenadas positivas del eje N°3. */
 #define   SW2_03    22 /*!< Input. Switch hacia coordenadas negativas del eje N°3. */
 
+#if SHIFT_ENABLED
+// Los ejes N°4 a N°8 emiten por la cadena de 74HC595 (ver FIPC_ShiftOut): las GPIO de
+// pasos y dirección de los ejes N°4 a N°6 quedan para el I2S y los switches de N°7 y N°8.
+#define   SHIFT_DATA    26 /*!< Output. Datos de la cadena de 74HC595 (SER). */
+#define   SHIFT_CLOCK   25 /*!< Output. Reloj de desplazamiento de la cadena (SRCLK). */
+#define   SHIFT_LATCH   27 /*!< Output. Reloj de las salidas de la cadena (RCLK). */
+
+#define   DIR_04    SHIFT_PIN(1) /*!< Shift. Señal de dirección del eje N°4. */
+#define   STEP_04   SHIFT_PIN(0) /*!< Shift. Señal de paso del eje N°4. */
+#else
 #define   DIR_04    32 /*!< Output. Señal de dirección del eje N°4. */
 #define   STEP_04   33 /*!< Output. Señal de paso del eje N°4. */
+#endif
 #define   SW1_04    36 /*!< Input. Switch hacia coordenadas positivas del eje N°4. */
 #define   SW2_04    36 /*!< Input. Switch hacia coordenadas negativas del eje N°4. */
 
+#if SHIFT_ENABLED
+#define   DIR_05    SHIFT_PIN(3) /*!< Shift. Señal de dirección del eje N°5. */
+#define   STEP_05   SHIFT_PIN(2) /*!< Shift. Señal de paso del eje N°5. */
+#else
 #define   DIR_05    25 /*!< Output. Señal de dirección del eje N°5. */
 #define   STEP_05   26 /*!< Output. Señal de paso del eje N°5. */
+#endif
 #define   SW1_05    34 /*!< Input. Switch hacia coordenadas positivas del eje N°5. */
 #define   SW2_05    39 /*!< Input. Switch hacia coordenadas negativas del eje N°5. */
 
+#if SHIFT_ENABLED
+#define   DIR_06    SHIFT_PIN(5) /*!< Shift. Señal de dirección del eje N°6. */
+#define   STEP_06   SHIFT_PIN(4) /*!< Shift. Señal de paso del eje N°6. */
+#else
 #define   DIR_06    27 /*!< Output. Señal de dirección del eje N°6. */
 #define   STEP_06   12 /*!< Output. Señal de paso del eje N°6. */
+#endif
 #define   SW1_06    14 /*!< Input. Switch hacia coordenadas positivas del eje N°6. */
 #define   SW2_06    35 /*!< Input. Switch hacia coordenadas negativas del eje N°6. */
 
+// Ejes N°7 y N°8: solo con la cadena. Como el eje N°4 tienen un único switch de límite.
+#define   DIR_07    SHIFT_PIN(7) /*!< Shift. Señal de dirección del eje N°7. */
+#define   STEP_07   SHIFT_PIN(6) /*!< Shift. Señal de paso del eje N°7. */
+#define   SW1_07    32 /*!< Input. Switch hacia coordenadas positivas del eje N°7. */
+#define   SW2_07    32 /*!< Input. Switch hacia coordenadas negativas del eje N°7. */
+
+#define   DIR_08    SHIFT_PIN(9) /*!< Shift. Señal de dirección del eje N°8. */
+#define   STEP_08   SHIFT_PIN(8) /*!< Shift. Señal de paso del eje N°8. */
+#define   SW1_08    33 /*!< Input. Switch hacia coordenadas positivas del eje N°8. */
+#define   SW2_08    33 /*!< Input. Switch hacia coordenadas negativas del eje N°8. */
+
+#define   PIN_MASK(pin) (1ULL<<(pin)) /*!< Máscara de una GPIO en la lectura conjunta de los registros de entrada. */
+
 #endif 
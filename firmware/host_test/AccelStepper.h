@@ -0,0 +1,98 @@
+/*! \file AccelStepper.h
+ *  \brief Reimplementación para la PC de la interfaz DRIVER de AccelStepper.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef AccelStepper_h
+#define AccelStepper_h
+
+#include "Arduino.h"
+
+//! Recibe cada paso de runSpeed(): salida de pasos, sentido (1 o -1) y velocidad del intervalo en pasos/s.
+typedef void (*HostStepHook)(uint8_t pinStep, int8_t direction, float speed);
+
+void hostSetStepHook(HostStepHook hook); /*!< Función que recibe los pasos (modelos del motor, ver HostMotor.h), NULL sin modelo. */
+
+//!  Clase con la interfaz y el algoritmo de AccelStepper 1.61 que usa el firmware.
+/*!
+ *   Genera los pasos con el mismo perfil de aceleración (D. Austin) y con el reloj simulado
+ *   de Arduino.cpp, por lo que los ejes se desplazan en la PC como en el ESP32. Solo se
+ *   implementa la interfaz DRIVER (pasos y dirección).
+*/
+class AccelStepper
+{
+  public:
+    //! Interfaces de AccelStepper (solo DRIVER se implementa).
+    typedef enum { FUNCTION = 0, DRIVER = 1, FULL2WIRE = 2 } MotorInterfaceType;
+
+    AccelStepper(uint8_t interface = DRIVER, uint8_t pin1 = 2, uint8_t pin2 = 3, uint8_t pin3 = 4, uint8_t pin4 = 5, bool enable = true);
+    virtual ~AccelStepper() {}
+
+    void moveTo(long absolute);
+    void move(long relative);
+    boolean run();
+    boolean runSpeed();
+    void setMaxSpeed(float speed);
+    float maxSpeed();
+    void setAcceleration(float acceleration);
+    float acceleration();
+    void setSpeed(float speed);
+    float speed();
+    long distanceToGo();
+    long targetPosition();
+    long currentPosition();
+    void setCurrentPosition(long position);
+    void runToPosition();
+    boolean runSpeedToPosition();
+    void runToNewPosition(long position);
+    void stop();
+    virtual void disableOutputs();
+    virtual void enableOutputs();
+    void setMinPulseWidth(unsigned int minWidth);
+    void setEnablePin(uint8_t enablePin = 0xff);
+    void setPinsInverted(bool directionInvert = false, bool stepInvert = false, bool enableInvert = false);
+    bool isRunning();
+
+  protected:
+    typedef enum { DIRECTION_CCW = 0, DIRECTION_CW = 1 } Direction;
+
+    void computeNewSpeed();
+    virtual void setOutputPins(uint8_t mask);
+    virtual void step(long step);
+
+    boolean _direction;
+    unsigned long _stepInterval;
+
+  private:
+    uint8_t _interface;
+    uint8_t _pin[2];
+    uint8_t _pinInverted[2];
+    long _currentPos;
+    long _targetPos;
+    float _speed;
+    float _maxSpeed;
+    float _acceleration;
+    unsigned int _minPulseWidth;
+    bool _enableInverted;
+    uint8_t _enablePin;
+    unsigned long _lastStepTime;
+    long _n;
+    float _c0;
+    float _cn;
+    float _cmin;
+};
+#endif
@@ -0,0 +1,124 @@
+/*! \file Arduino.cpp
+    \brief Reemplazo de Arduino.h para compilar el firmware en la PC, con reloj y GPIO simulados.
+*/
+
+#include "Arduino.h"
+
+static uint64_t hostMicros = 0;           // reloj simulado en us
+static uint8_t  hostLevel[HOST_PINS];      // nivel de cada pin
+static uint32_t hostRising[HOST_PINS];     // flancos de subida escritos
+static int      hostAnalog[HOST_PINS];     // valores de analogRead()
+static uint32_t hostAnalogReads = 0;       // llamadas a analogRead()
+static void   (*hostHandler[HOST_PINS])(void*);
+static void*    hostArg[HOST_PINS];
+static int      hostMode[HOST_PINS];
+static unsigned long hostExecBase = 0;     // costo simulado de un ciclo de exec() en us
+static unsigned long hostExecEdge = 0;     // costo simulado de cada flanco de subida en us
+static bool     hostExecActive = false;    // ciclo de exec() en curso (ver hostExecBegin())
+static bool     hostExecRead = false;      // el ciclo ya leyó el reloj
+static uint32_t hostExecEdges = 0;         // flancos de subida escritos en el ciclo
+
+// Costo acumulado del ciclo de exec() en curso.
+static unsigned long hostExecCost(){ return hostExecBase+hostExecEdge*hostExecEdges; }
+
+// Reloj visto por el firmware: dentro de un ciclo de exec() la primera lectura es el inicio
+// y las siguientes incluyen el costo acumulado, como micros()-start en FIPC_API::exec().
+static uint64_t hostClock(){
+  if( !hostExecActive ) return hostMicros;
+  if( !hostExecRead ){
+    hostExecRead = true;
+    return hostMicros;
+  }
+  return hostMicros+hostExecCost();
+}
+
+
+/******************************************/
+/* Begin: Arduino                         */
+
+unsigned long millis(){ return (unsigned long)(hostClock()/1000); }
+unsigned long micros(){ return (unsigned long)hostClock(); }
+void delay(unsigned long ms){ hostMicros += (uint64_t)ms*1000; }
+void delayMicroseconds(unsigned int us){ hostMicros += us; }
+
+void pinMode(uint8_t pin, uint8_t mode){ (void)pin; (void)mode; }
+
+int digitalRead(uint8_t pin){
+  return (pin<HOST_PINS) ? hostLevel[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level){
+  if( pin>=HOST_PINS ) return;
+  if( (level)&&(!hostLevel[pin]) ){
+    hostRising[pin]++;
+    if( hostExecActive ) hostExecEdges++;
+  }
+  hostLevel[pin] = level ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin){
+  hostAnalogReads++;
+  return (pin<HOST_PINS) ? hostAnalog[pin] : 0;
+}
+
+uint8_t digitalPinToInterrupt(uint8_t pin){ return pin; }
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode){
+  if( pin>=HOST_PINS ) return;
+  hostHandler[pin] = handler;
+  hostArg[pin] = arg;
+  hostMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin){
+  if( pin<HOST_PINS ) hostHandler[pin] = NULL;
+}
+/* End: Arduino                           */
+/******************************************/
+
+
+/******************************************/
+/* Begin: Simulación                      */
+
+void hostAdvance(unsigned long us){ hostMicros += us; }
+
+void hostReset(){
+  hostMicros = 0;
+  memset(hostLevel, 0, sizeof(hostLevel));
+  memset(hostRising, 0, sizeof(hostRising));
+  memset(hostAnalog, 0, sizeof(hostAnalog));
+  hostAnalogReads = 0;
+  hostExecActive = false;
+}
+
+void hostSetExecCost(unsigned long baseUs, unsigned long edgeUs){
+  hostExecBase = baseUs;
+  hostExecEdge = edgeUs;
+}
+
+void hostExecBegin(){
+  hostExecActive = true;
+  hostExecRead = false;
+  hostExecEdges = 0;
+}
+
+unsigned long hostExecEnd(){
+  unsigned long cost = hostExecActive ? hostExecCost() : 0;
+  hostExecActive = false;
+  hostMicros += cost;
+  return cost;
+}
+
+void hostSetInput(uint8_t pin, bool level){
+  if( (pin>=HOST_PINS)||(hostLevel[pin]==(uint8_t)level) ) return;
+  hostLevel[pin] = level;
+  int edge = level ? RISING : FALLING;
+  if( (hostHandler[pin])&&((hostMode[pin]==CHANGE)||(hostMode[pin]==edge)) ) hostHandler[pin](hostArg[pin]);
+}
+
+void hostSetAnalog(uint8_t pin, int value){ if( pin<HOST_PINS ) hostAnalog[pin] = value; }
+uint8_t hostGetOutput(uint8_t pin){ return (pin<HOST_PINS) ? hostLevel[pin] : LOW; }
+uint32_t hostGetRising(uint8_t pin){ return (pin<HOST_PINS) ? hostRising[pin] : 0; }
+uint32_t hostGetAnalogReads(){ return hostAnalogReads; }
+/* End: Simulación                        */
+/******************************************/
@@ -0,0 +1,91 @@
+/*! \file Arduino.h
+ *  \brief Reemplazo de Arduino.h para compilar el firmware en la PC, con reloj y GPIO simulados.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define INPUT          0x01
+#define OUTPUT         0x03
+#define INPUT_PULLUP   0x05
+#define INPUT_PULLDOWN 0x09
+#define HIGH    1
+#define LOW     0
+#define RISING  1
+#define FALLING 2
+#define CHANGE  3
+#define PI      3.1415926535897932384626433832795
+#define IRAM_ATTR
+
+#define HOST_PINS 128 /*!< Pines simulados: GPIO del ESP32 y salidas de la cadena de 74HC595. */
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+template<class T, class L, class H> T constrain(T x, L low, H high){ return (x<low) ? low : ((x>high) ? high : x); }
+
+// Reloj: avanza solo con hostAdvance(), delay(), delayMicroseconds() y el costo simulado de exec()
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+int analogRead(uint8_t pin);
+uint8_t digitalPinToInterrupt(uint8_t pin);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// FreeRTOS: un único hilo, las secciones críticas no tienen efecto
+typedef struct { int owner; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux)     ((void)(mux))
+#define portEXIT_CRITICAL(mux)      ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)  ((void)(mux))
+#define configMAX_PRIORITIES 25
+typedef uint8_t StackType_t;
+typedef struct { int dummy; } StaticTask_t;
+typedef void* TaskHandle_t;
+
+// Control de la simulación desde las pruebas
+void hostAdvance(unsigned long us);          /*!< Avanza el reloj. */
+void hostReset();                            /*!< Reloj en cero, entradas en bajo y contadores de flancos en cero. */
+void hostSetInput(uint8_t pin, bool level);  /*!< Nivel de una entrada (llama a la interrupción del flanco). */
+void hostSetAnalog(uint8_t pin, int value);  /*!< Valor de analogRead(). */
+uint8_t hostGetOutput(uint8_t pin);          /*!< Nivel de una salida. */
+uint32_t hostGetRising(uint8_t pin);         /*!< Flancos de subida escritos en una salida. */
+uint32_t hostGetAnalogReads();               /*!< Llamadas a analogRead(). */
+void hostSetExecCost(unsigned long baseUs, unsigned long edgeUs); /*!< Duración simulada de exec(): base más un costo por flanco de subida escrito (0 y 0: sin costo). */
+void hostExecBegin();                        /*!< Inicia un ciclo de exec(): desde la segunda lectura el reloj incluye su costo. */
+unsigned long hostExecEnd();                 /*!< Termina el ciclo, avanza el reloj con su duración y la retorna en us. */
+
+#endif
@@ -0,0 +1,139 @@
+/*! \file HostMotor.h
+ *  \brief Modelo de un motor que pierde pasos y de su switch de referencia.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef HostMotor_h
+#define HostMotor_h
+
+#include "AccelStepper.h"
+
+#define HOST_MOTORS 8 /*!< Cantidad máxima de motores modelados. */
+
+//!  Clase que modela la pérdida de pasos de un motor y el switch de referencia del eje.
+/*!
+ *   Recibe los pasos de AccelStepper (ver hostSetStepHook()) con la velocidad del intervalo
+ *   del perfil, sin la cuantización del período de exec(). Un paso se pierde si la velocidad
+ *   supera la frecuencia máxima o si la aceleración entre el intervalo anterior y el actual
+ *   supera la aceleración máxima; por debajo de la frecuencia de arranque el motor no pierde
+ *   pasos (arranca y se detiene sin rampa). Un motor que perdió un paso queda desenganchado
+ *   y pierde todos los pasos hasta volver a la frecuencia de arranque.
+ *
+ *   La carga arrastra al carro desenganchado hacia el switch: cada paso perdido, en
+ *   cualquier sentido, corre el carro un paso hacia el switch respecto de la posición
+ *   ordenada, por lo que las pérdidas de la ida y de la vuelta no se compensan y la búsqueda
+ *   del cero encuentra el flanco desplazado en los pasos perdidos. update() escribe el switch
+ *   (activo en bajo) luego de cada ciclo de exec(), como el switch real leído por
+ *   FIPC_Homing con HOMING_SIMULATED en 0.
+*/
+class HostMotor
+{
+  public:
+    //! Constructor.
+    /*!
+      El carro parte de la posición 0 en pasos.
+      \param pinStep Salida de pasos del eje.
+      \param pinSwitch Entrada del switch de referencia.
+      \param switchSteps Posición del switch en pasos; se presiona por debajo.
+      \param rateMax Frecuencia máxima sin pérdida en pasos/s.
+      \param accelMax Aceleración máxima sin pérdida en pasos/s^2.
+      \param rateStart Frecuencia de arranque en pasos/s.
+    */
+    HostMotor(uint8_t pinStep, uint8_t pinSwitch, long switchSteps, float rateMax, float accelMax, float rateStart) :
+      _pinStep(pinStep), _pinSwitch(pinSwitch), _switchSteps(switchSteps),
+      _rateMax(rateMax), _accelMax(accelMax), _rateStart(rateStart) {
+      HostMotor** list = HostMotor::list();
+      for( uint8_t i=0; i<HOST_MOTORS; i++ ) if( !list[i] ){ list[i] = this; break; }
+      hostSetStepHook(HostMotor::onStep);
+      HostMotor::update();
+    }
+
+    //! Destructor.
+    ~HostMotor(){
+      HostMotor** list = HostMotor::list();
+      for( uint8_t i=0; i<HOST_MOTORS; i++ ) if( list[i]==this ) list[i] = NULL;
+    }
+
+    //! Escribe el switch de referencia de todos los motores.
+    static void updateAll(){
+      HostMotor** list = HostMotor::list();
+      for( uint8_t i=0; i<HOST_MOTORS; i++ ) if( list[i] ) list[i]->update();
+    }
+
+    //! Escribe el switch de referencia según la posición del carro.
+    void update(){ hostSetInput(_pinSwitch, (_position-_lost>_switchSteps) ? HIGH : LOW); }
+
+    //! Retorna los pasos perdidos.
+    long getLost() { return _lost; }
+
+  private:
+    uint8_t _pinStep; /*!< Salida de pasos. */
+
+    uint8_t _pinSwitch; /*!< Entrada del switch de referencia. */
+
+    long _switchSteps; /*!< Posición del switch en pasos. */
+
+    float _rateMax; /*!< Frecuencia máxima en pasos/s. */
+
+    float _accelMax; /*!< Aceleración máxima en pasos/s^2. */
+
+    float _rateStart; /*!< Frecuencia de arranque en pasos/s. */
+
+    long _position = 0; /*!< Posición ordenada en pasos. */
+
+    long _lost = 0; /*!< Pasos perdidos. */
+
+    float _rate = 0.0; /*!< Frecuencia del intervalo anterior en pasos/s. */
+
+    unsigned long _time = 0; /*!< Instante en us del paso anterior. */
+
+    bool _stalled = false; /*!< Desenganchado desde el último paso perdido. */
+
+    //! Lista de motores modelados.
+    static HostMotor** list(){
+      static HostMotor* motors[HOST_MOTORS] = {NULL};
+      return motors;
+    }
+
+    //! Recibe un paso de AccelStepper.
+    static void onStep(uint8_t pinStep, int8_t direction, float speed){
+      HostMotor** list = HostMotor::list();
+      for( uint8_t i=0; i<HOST_MOTORS; i++ ) if( (list[i])&&(list[i]->_pinStep==pinStep) ) list[i]->step(direction, speed);
+    }
+
+    //! Procesa un paso.
+    /*!
+      La aceleración es la diferencia de frecuencia entre los centros del intervalo anterior
+      y del actual; luego de dos intervalos sin pasos el motor parte del reposo.
+    */
+    void step(int8_t direction, float speed){
+      unsigned long now = micros();
+      float rate = fabs(speed);
+      if( (_rate>0.0)&&(now-_time>2.0e6/_rate) ) _rate = 0.0;
+      if( rate<=_rateStart ) _stalled = false;
+      else if( !_stalled ){
+        float dt = (_rate>0.0) ? 0.5/rate+0.5/_rate : 1.0/rate;
+        _stalled = (rate>_rateMax)||(fabs(rate-_rate)/dt>_accelMax);
+      }
+      _position += direction;
+      if( _stalled ) _lost++;
+      _rate = rate;
+      _time = now;
+    }
+};
+
+#endif
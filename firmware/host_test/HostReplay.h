@@ -0,0 +1,291 @@
+/*! \file HostReplay.h
+ *  \brief Reproducción de una sesión de FIPC_Recorder en el controlador con el reloj simulado.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef HostReplay_h
+#define HostReplay_h
+
+#include <ctype.h>
+#include "HostSession.h"
+
+#define HOST_REPLAY_TIMEOUT 120000000UL /*!< Espera máxima del reposo de los ejes en us. */
+
+//! Registro leído de FIPC_Recorder.
+typedef struct{
+  uint64_t time;     /*!< Instante en us desde "REC:1:", extendido si el contador dio la vuelta. */
+  uint8_t type;      /*!< Tipo (ver FIPC_Recorder::RecordType). */
+  uint8_t axis;      /*!< Eje de REC_AXIS y REC_STATE. */
+  float position;    /*!< Posición de REC_AXIS. */
+  char text[256];    /*!< Solicitud o estado. */
+  uint16_t duration; /*!< Duración en us de REC_EXEC. */
+}HostRecord;
+
+//! Resumen de una sesión, como summary() de python_lib/module_session.py.
+typedef struct{
+  uint32_t requests;    /*!< Solicitudes. */
+  uint32_t transitions; /*!< Cambios de estado de los ejes. */
+  uint64_t duration;    /*!< Instante del último registro en us. */
+  uint64_t motion;      /*!< Tiempo con algún eje en movimiento en us. */
+  uint32_t slowCycles;  /*!< Ciclos de exec() de más de RECORDER_EXEC_LIMIT us. */
+  uint32_t slowMax;     /*!< Mayor duración de esos ciclos en us. */
+}HostSummary;
+
+//! Estadísticas de exec() de "?REC:".
+typedef struct{
+  uint32_t cycles; /*!< Ciclos grabados. */
+  float mean;      /*!< Duración media en us. */
+  uint32_t max;    /*!< Duración máxima en us. */
+  uint32_t slow;   /*!< Ciclos de más de RECORDER_EXEC_LIMIT us. */
+}HostExecStats;
+
+//!  Clase que reproduce una sesión grabada con "REC:1:" en HostSession.
+/*!
+ *   Equivale a replay() de python_lib/module_session.py con el controlador completo en
+ *   lugar del emulador: cada solicitud del registro se envía con request() en su instante
+ *   original multiplicado por la escala (1 con los tiempos originales, menor para
+ *   comprimirlos, 0 sin esperas) y la reproducción se graba con "REC:1:". Con la duración
+ *   de exec() simulada (ver hostSetExecCost()) las estadísticas de "?REC:" y los ciclos
+ *   lentos son los del ciclo modelado.
+*/
+class HostReplay
+{
+  public:
+    //! Constructor.
+    /*!
+      \param pHost Sesión del controlador.
+    */
+    HostReplay(HostSession* pHost) : _host(pHost) {}
+
+    //! Lee un registro de un archivo.
+    /*!
+      El archivo puede ser binario (save() de module_session.py) o el texto hexadecimal de
+      las respuestas de "?RECD:".
+      \param path Archivo.
+      \param log Registro de RECORDER_SIZE bytes.
+      \return Bytes leídos.
+    */
+    static uint16_t load(const char* path, uint8_t* log){
+      FILE* file = fopen(path, "rb");
+      if( !file ) return 0;
+      static char raw[2*RECORDER_SIZE+RECORDER_SIZE/RECORDER_CHUNK+2];
+      size_t size = fread(raw, 1, sizeof(raw), file);
+      fclose(file);
+      bool hex = size>0;
+      for( size_t i=0; (hex)&&(i<size); i++ ) hex = isxdigit((unsigned char)raw[i])||isspace((unsigned char)raw[i]);
+      if( !hex ){
+        size = min(size, (size_t)RECORDER_SIZE);
+        memcpy(log, raw, size);
+        return size;
+      }
+      raw[size] = '\0';
+      return HostReplay::decode(raw, log, 0);
+    }
+
+    //! Detiene la grabación y descarga el registro con "?RECD:".
+    /*!
+      \param log Registro de RECORDER_SIZE bytes.
+      \return Bytes descargados.
+    */
+    uint16_t download(uint8_t* log){
+      _host->request("REC:0:");
+      unsigned int size = 0;
+      sscanf(_host->request("?REC:"), "%*d;%u;", &size);
+      uint16_t offset = 0;
+      while( offset<size ){
+        char line[16];
+        snprintf(line, sizeof(line), "?RECD:%u:", offset);
+        uint16_t chunk = HostReplay::decode(_host->request(line), log, offset);
+        if( !chunk ) break;
+        offset += chunk;
+      }
+      return offset;
+    }
+
+    //! Lee el registro siguiente.
+    /*!
+      \param log Registro.
+      \param size Bytes del registro.
+      \param offset Posición del registro siguiente, se actualiza.
+      \param record Registro leído; su instante anterior extiende el contador.
+      \return false al final del registro.
+    */
+    static bool next(const uint8_t* log, uint16_t size, uint16_t &offset, HostRecord &record){
+      if( offset+RECORDER_HEADER>size ) return false;
+      uint32_t stamp;
+      memcpy(&stamp, &log[offset], sizeof(stamp));
+      uint8_t bytes = min(log[offset+5], (uint8_t)(size-offset-RECORDER_HEADER));
+      const uint8_t* data = &log[offset+RECORDER_HEADER];
+      uint64_t time = (record.time&~0xFFFFFFFFULL)|stamp;
+      record.time = (time<record.time) ? time+0x100000000ULL : time;
+      record.type = log[offset+4];
+      record.axis = 0;
+      record.position = 0.0;
+      record.text[0] = '\0';
+      record.duration = 0;
+      if( (record.type==FIPC_Recorder::REC_AXIS)&&(bytes>=5) ){
+        record.axis = data[0];
+        memcpy(&record.position, &data[1], sizeof(record.position));
+        HostReplay::copy(record.text, &data[5], bytes-5);
+      }
+      if( record.type==FIPC_Recorder::REC_REQUEST ) HostReplay::copy(record.text, data, bytes);
+      if( (record.type==FIPC_Recorder::REC_STATE)&&(bytes>=1) ){
+        record.axis = data[0];
+        HostReplay::copy(record.text, &data[1], bytes-1);
+      }
+      if( (record.type==FIPC_Recorder::REC_EXEC)&&(bytes>=2) ) memcpy(&record.duration, data, sizeof(record.duration));
+      offset += RECORDER_HEADER+log[offset+5];
+      return true;
+    }
+
+    //! Resume un registro.
+    /*!
+      \param log Registro.
+      \param size Bytes del registro.
+      \param summary Resumen.
+    */
+    static void summary(const uint8_t* log, uint16_t size, HostSummary &summary){
+      bool axisMoving[RECORDER_AXIS_NUMBERS+1] = {false};
+      bool moving = false;
+      uint64_t since = 0;
+      memset(&summary, 0, sizeof(summary));
+      HostRecord record;
+      record.time = 0;
+      for( uint16_t offset=0; HostReplay::next(log, size, offset, record); ){
+        if( record.type==FIPC_Recorder::REC_REQUEST ) summary.requests++;
+        if( record.type==FIPC_Recorder::REC_STATE ) summary.transitions++;
+        if( record.type==FIPC_Recorder::REC_EXEC ){
+          summary.slowCycles++;
+          summary.slowMax = max(summary.slowMax, (uint32_t)record.duration);
+        }
+        if( ((record.type==FIPC_Recorder::REC_AXIS)||(record.type==FIPC_Recorder::REC_STATE))&&(record.axis<=RECORDER_AXIS_NUMBERS) ){
+          axisMoving[record.axis] = HostReplay::isMoving(record.text);
+          bool active = false;
+          for( uint8_t i=0; i<=RECORDER_AXIS_NUMBERS; i++ ) active |= axisMoving[i];
+          if( (active)&&(!moving) ) since = record.time;
+          if( (!active)&&(moving) ) summary.motion += record.time-since;
+          moving = active;
+        }
+        summary.duration = max(summary.duration, record.time);
+      }
+      if( moving ) summary.motion += summary.duration-since;
+    }
+
+    //! Lleva los ejes a la posición inicial de la sesión.
+    /*!
+      Como prepare() de module_session.py: si algún eje estaba referenciado busca el cero
+      de todos y los lleva a las posiciones de REC_AXIS. "E:" se aplica en exec(), por lo
+      que "HA:" se envía luego de un ciclo de TaskReadAction.
+      \param log Registro.
+      \param size Bytes del registro.
+      \return false si los ejes no llegaron al reposo.
+    */
+    bool prepare(const uint8_t* log, uint16_t size){
+      float target[AXIS_NUMBERS] = {0};
+      bool homed = false;
+      HostRecord record;
+      record.time = 0;
+      for( uint16_t offset=0; HostReplay::next(log, size, offset, record); ){
+        if( (record.type!=FIPC_Recorder::REC_AXIS)||(record.axis<1)||(record.axis>AXIS_NUMBERS) ) continue;
+        target[record.axis-1] = record.position;
+        homed |= !strcmp(record.text, "Ready");
+      }
+      if( !homed ) return true;
+      _host->request("E:");
+      _host->run(100000);
+      _host->request("HA:");
+      if( !_host->run(HOST_REPLAY_TIMEOUT, hostIdle) ) return false;
+      char line[API_REQUEST_SIZE];
+      FIPC_Text out(line, sizeof(line));
+      out.add("SYNCAF:");
+      for( uint8_t i=0; i<AXIS_NUMBERS; i++ ) out.add(target[i], 3).add(':');
+      _host->request(line);
+      return _host->run(HOST_REPLAY_TIMEOUT, hostIdle);
+    }
+
+    //! Reproduce un registro y graba la reproducción.
+    /*!
+      Las solicitudes se envían en su instante multiplicado por scale; al final se espera el
+      reposo de los ejes y se descarga la grabación de la reproducción.
+      \param log Registro.
+      \param size Bytes del registro.
+      \param scale Escala de los tiempos (1 originales, 0 sin esperas).
+      \param summary Resumen de la reproducción, con el tiempo de movimiento.
+      \param exec Estadísticas de exec() de la reproducción.
+      \return false si los ejes no llegaron al reposo.
+    */
+    bool replay(const uint8_t* log, uint16_t size, float scale, HostSummary &summary, HostExecStats &exec){
+      _host->request("REC:1:");
+      unsigned long start = micros();
+      HostRecord record;
+      record.time = 0;
+      for( uint16_t offset=0; HostReplay::next(log, size, offset, record); ){
+        if( record.type!=FIPC_Recorder::REC_REQUEST ) continue;
+        unsigned long at = (unsigned long)(record.time*scale);
+        if( micros()-start<at ) _host->run(at-(micros()-start));
+        _host->request(record.text);
+      }
+      bool idle = _host->run(HOST_REPLAY_TIMEOUT, hostIdle);
+      _host->request("REC:0:");
+      memset(&exec, 0, sizeof(exec));
+      sscanf(_host->request("?REC:"), "%*d;%*u;%*u;%*u;%u;%f;%u;%u", &exec.cycles, &exec.mean, &exec.max, &exec.slow);
+      size = download(_log);
+      HostReplay::summary(_log, size, summary);
+      return idle;
+    }
+
+  private:
+    HostSession* _host; /*!< Sesión del controlador. */
+
+    uint8_t _log[RECORDER_SIZE]; /*!< Grabación de la reproducción. */
+
+    //! Convierte texto hexadecimal en bytes.
+    /*!
+      \param hex Texto; se ignoran los caracteres que no son dígitos.
+      \param log Registro de RECORDER_SIZE bytes.
+      \param offset Posición del primer byte.
+      \return Bytes convertidos.
+    */
+    static uint16_t decode(const char* hex, uint8_t* log, uint16_t offset){
+      uint16_t count = 0;
+      int high = -1;
+      for( ; (*hex)&&(offset+count<RECORDER_SIZE); hex++ ){
+        if( !isxdigit((unsigned char)*hex) ) continue;
+        int digit = isdigit((unsigned char)*hex) ? *hex-'0' : toupper((unsigned char)*hex)-'A'+10;
+        if( high<0 ){
+          high = digit;
+          continue;
+        }
+        log[offset+count++] = (high<<4)|digit;
+        high = -1;
+      }
+      return count;
+    }
+
+    //! Copia un texto del registro.
+    static void copy(char* text, const uint8_t* data, uint8_t size){
+      memcpy(text, data, size);
+      text[size] = '\0';
+    }
+
+    //! Verifica si un estado es de movimiento (MOVING de module_session.py).
+    static bool isMoving(const char* status){
+      return (!strcmp(status, "Homing"))||(!strcmp(status, "Moving"))||(!strcmp(status, "Jogging"))||(!strcmp(status, "Tracking"));
+    }
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*! \file HostSession.h
+ *  \brief Ejecución del controlador completo con el reloj simulado.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef HostSession_h
+#define HostSession_h
+
+#include "Arduino.h"
+#include "FIPC_API.h"
+#include "HostMotor.h"
+
+#define HOST_EXEC_US    20  /*!< Período de exec() en us (TaskExec). */
+#define HOST_PERSIST_MS 100 /*!< Período de persist() en ms (TaskReadAction). */
+#define HOST_PROGRAM_MS 5   /*!< Período de runProgram() y sample() en ms (TaskProgram). */
+#define HOST_LINK_BITS  10  /*!< Bits por byte del enlace serie (8N1). */
+
+//! Libera los fines de carrera de los ejes N°1 a N°6.
+/*!
+ *  Los switches son activos en bajo y la placa tiene resistencias de pull-up.
+*/
+static inline void hostReleaseLimits(){
+  const uint8_t switches[] = {SW1_01, SW2_01, SW1_02, SW2_02, SW1_03, SW2_03,
+                              SW1_04, SW2_04, SW1_05, SW2_05, SW1_06, SW2_06};
+  for( uint8_t i=0; i<sizeof(switches); i++ ) hostSetInput(switches[i], HIGH);
+}
+
+//!  Controlador con las tareas del firmware en un único hilo.
+/*!
+ *   run() intercala exec() cada HOST_EXEC_US, persist() cada HOST_PERSIST_MS y
+ *   runProgram() y sample() cada HOST_PROGRAM_MS como las tareas de FIPC_Project.ino,
+ *   avanzando el reloj simulado. Con la duración de exec() simulada (ver hostSetExecCost())
+ *   TaskExec repite el ciclo apenas termina: el período es el mayor entre HOST_EXEC_US y la
+ *   duración, y FIPC_Recorder la mide como en el controlador. Luego de cada exec() los
+ *   modelos de HostMotor escriben los switches de referencia.
+ *
+ *   Con setBaudrate() request() modela el puerto serie: el controlador corre durante la
+ *   transmisión de la solicitud y de la respuesta, como TaskReadAction que atiende la línea
+ *   completa y responde antes de la solicitud siguiente.
+*/
+class HostSession
+{
+  public:
+    //! Constructor.
+    /*!
+      Libera los fines de carrera (ver hostReleaseLimits()).
+      \param pApi Controlador.
+    */
+    HostSession(FIPC_API* pApi) : _api(pApi) { hostReleaseLimits(); }
+
+    //! Ejecuta el controlador.
+    /*!
+      \param us Duración en us.
+      \param pStop Si no es NULL, termina cuando la función retorna true.
+      \return true si terminó por pStop.
+    */
+    bool run(unsigned long us, bool (*pStop)(FIPC_API*) = NULL){
+      for( unsigned long start=micros(); micros()-start<us; ){
+        hostAdvance(_idle);
+        hostExecBegin();
+        _api->exec(NULL);
+        unsigned long elapsed = hostExecEnd();
+        _idle = (elapsed<HOST_EXEC_US) ? HOST_EXEC_US-elapsed : 0;
+        HostMotor::updateAll();
+        if( millis()-_persist>=HOST_PERSIST_MS ){
+          _persist = millis();
+          _api->persist();
+        }
+        if( millis()-_program>=HOST_PROGRAM_MS ){
+          _program = millis();
+          _api->runProgram();
+          _api->sample();
+        }
+        if( (pStop)&&(pStop(_api)) ) return true;
+      }
+      return false;
+    }
+
+    //! Envía una solicitud.
+    /*!
+      \param line Solicitud sin el '\n' final.
+      \return Respuesta; con el enlace modelado, una copia válida hasta la solicitud siguiente.
+    */
+    const char* request(const char* line){
+      if( !_baudrate ) return _api->request(line);
+      HostSession::wire(strlen(line)+1);
+      strncpy(_reply, _api->request(line), sizeof(_reply)-1);
+      HostSession::wire(strlen(_reply));
+      _requests++;
+      _bytesOut += strlen(line)+1;
+      _bytesIn += strlen(_reply);
+      return _reply;
+    }
+
+    //! Modela el enlace serie en request().
+    /*!
+      \param baudrate Velocidad en baudios, 0 sin enlace (la respuesta es inmediata).
+    */
+    void setBaudrate(unsigned long baudrate){
+      _baudrate = baudrate;
+      HostSession::resetLink();
+    }
+
+    //! Pone en cero los contadores del enlace.
+    void resetLink(){ _requests = _bytesOut = _bytesIn = _linkUs = 0; }
+
+    //! Retorna las solicitudes enviadas por el enlace.
+    unsigned long getRequests() { return _requests; }
+
+    //! Retorna los bytes enviados.
+    unsigned long getBytesOut() { return _bytesOut; }
+
+    //! Retorna los bytes recibidos.
+    unsigned long getBytesIn() { return _bytesIn; }
+
+    //! Retorna el tiempo de transmisión en us.
+    unsigned long getLinkTime() { return _linkUs; }
+
+  private:
+    FIPC_API* _api; /*!< Controlador. */
+
+    unsigned long _idle = HOST_EXEC_US; /*!< Tiempo en us hasta el próximo exec(). */
+
+    unsigned long _persist = 0; /*!< Instante en ms del último persist(). */
+
+    unsigned long _program = 0; /*!< Instante en ms del último runProgram(). */
+
+    unsigned long _baudrate = 0; /*!< Velocidad del enlace en baudios, 0 sin enlace. */
+
+    unsigned long _requests = 0; /*!< Solicitudes enviadas por el enlace. */
+
+    unsigned long _bytesOut = 0; /*!< Bytes enviados. */
+
+    unsigned long _bytesIn = 0; /*!< Bytes recibidos. */
+
+    unsigned long _linkUs = 0; /*!< Tiempo de transmisión en us. */
+
+    char _reply[API_OUTPUT_SIZE] = {0}; /*!< Copia de la respuesta con el enlace modelado. */
+
+    //! Ejecuta el controlador durante la transmisión de bytes por el enlace.
+    void wire(size_t bytes){
+      unsigned long us = (unsigned long)((uint64_t)bytes*HOST_LINK_BITS*1000000/_baudrate);
+      _linkUs += us;
+      HostSession::run(us);
+    }
+};
+
+//! Condición de fin de run(): todos los ejes en reposo.
+static inline bool hostIdle(FIPC_API* pApi) { return pApi->isIdle(0xFF); }
+
+#endif
@@ -0,0 +1,33 @@
+/*! \file HostTest.h
+ *  \brief Verificaciones de las pruebas del firmware en el host.
+ *
+ *  \par Copyright
+ *
+ *  This software is Copyright (C) 2020-2021 Roberto Peyton. Use is subject to license
+ *  conditions. The licensing is GPL V3.
+ *
+ *  This is the appropriate option if you want to share the source code of your
+ *  application with everyone you distribute it to, and you also want to give them
+ *  the right to share who uses it. If you wish to use this software under Open
+ *  Source Licensing, you must contribute all your source code to the open source
+ *  community in accordance with the GPL Version 23 when your application is
+ *  distributed. See https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ *  \author  Roberto Peyton (robertop@ciop.unlp.edu.ar)
+ *  Copyright (C) 2020-2021 Roberto Peyton
+*/
+
+#ifndef HostTest_h
+#define HostTest_h
+
+#include <stdio.h>
+
+static int hostFailures = 0; /*!< Verificaciones fallidas de la prueba. */
+
+//! Verifica una condición; si falla informa el archivo, la línea y la expresión.
+#define CHECK(cond) do{ if( !(cond) ){ printf("%s:%d: falla: %s\n",__FILE__,__LINE__,#cond); hostFailures++; } }while(0)
+
+//! Resultado de la prueba para make: 0 si todas las verificaciones pasaron.
+#define HOST_RESULT(name) ( printf("%s: %s\n",(name),hostFailures ? "FALLA" : "ok"), hostFailures ? 1 : 0 )
+
+#endif
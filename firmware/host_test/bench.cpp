@@ -0,0 +1,247 @@
+/*! \file bench.cpp
+    \brief Benchmark de cargas de trabajo de producción en el controlador con el reloj simulado.
+
+    Uso: bench [resultado.json] [etiqueta]
+
+    Cuántos puntos por minuto entrega una versión del firmware: cada carga se ejecuta en
+    HostSession con el enlace serie de 115200 baudios modelado (ver HostSession::setBaudrate())
+    y con la duración de exec() simulada (ver hostSetExecCost()), por lo que el resultado es
+    determinista y comparable entre commits:
+
+    \li homing: arranque en frío con "D:", "E:", "HA:" y espera de los 6 ejes con "?RA:".
+    \li raster: barrido 2D de "MR:" de los ejes N°1 y N°2 con consultas "?M:" (python_lib/example_01.py).
+    \li goniometer: barridos "SYNCA:" repetidos de los ejes N°5 y N°6 alrededor del centro del recorrido.
+    \li polling: consultas "?RA:" continuas durante un desplazamiento largo del eje N°3.
+
+    Por carga se informan los puntos completados, la duración, los puntos por minuto, las
+    solicitudes y los bytes del enlace, su utilización, los ciclos de exec() de más de
+    RECORDER_EXEC_LIMIT us y el más largo (de "?REC:") y, en polling, la duración del
+    desplazamiento sobre la estimada con "?TR:". El resultado en JSON tiene el formato de
+    python_lib/module_bench.py, que compara dos resultados.
+*/
+
+#include "HostSession.h"
+
+#define BENCH_BAUDRATE 115200    /*!< Velocidad del enlace en baudios. */
+#define BENCH_TIMEOUT  120000000 /*!< Espera máxima de cada condición en us. */
+
+//! Resultado de una carga.
+typedef struct{
+  const char* name;         /*!< Nombre de la carga. */
+  long points;              /*!< Puntos completados. */
+  double seconds;           /*!< Duración en s. */
+  unsigned long requests;   /*!< Solicitudes enviadas. */
+  unsigned long bytesOut;   /*!< Bytes enviados. */
+  unsigned long bytesIn;    /*!< Bytes recibidos. */
+  double linkUtilization;   /*!< Tiempo de transmisión sobre la duración. */
+  unsigned long execCycles; /*!< Ciclos de exec() de más de RECORDER_EXEC_LIMIT us. */
+  unsigned long execMax;    /*!< Mayor duración de exec() en us. */
+  double stretch;           /*!< Duración del desplazamiento sobre la estimada (polling). */
+}BenchResult;
+
+static FIPC_API api; /*!< Controlador. */
+
+static HostSession host(&api); /*!< Sesión con el enlace modelado. */
+
+//! Espera que un eje termine con consultas "?M:" sin pausa, como python_lib/example_01.py.
+static bool waitAxis(uint8_t id){
+  char line[16];
+  snprintf(line, sizeof(line), "?M:%u:", id);
+  for( unsigned long start=micros(); micros()-start<BENCH_TIMEOUT; )
+    if( strcmp(host.request(line), "1\n") ) return true;
+  return false;
+}
+
+//! Espera con consultas "?RA:" que una cantidad de ejes esté en "Ready".
+static bool waitReady(uint8_t ready){
+  for( unsigned long start=micros(); micros()-start<BENCH_TIMEOUT; ){
+    uint8_t count = 0;
+    for( const char* p=host.request("?RA:"); (p=strstr(p, "Ready"))!=NULL; p++ ) count++;
+    if( count>=ready ) return true;
+  }
+  return false;
+}
+
+//! Arranque en frío de los 6 ejes; "E:" se aplica en exec() antes de "HA:".
+static long homing(){
+  host.request("D:");
+  host.request("E:");
+  host.request("HA:");
+  waitReady(6);
+  return 1;
+}
+
+//! Serpentina de 4 por 4 puntos de 50 um con desplazamientos relativos.
+static long raster(){
+  const uint8_t nx = 4, ny = 4;
+  host.request("MA:1:1000.000:MA:2:1000.000:");
+  waitAxis(1);
+  waitAxis(2);
+  long points = 1;
+  for( uint8_t row=0; row<ny; row++ ){
+    for( uint8_t col=0; col<nx-1; col++ ){
+      host.request((row%2==0) ? "MR:1:50.000:" : "MR:1:-50.000:");
+      waitAxis(1);
+      points++;
+    }
+    if( row<ny-1 ){
+      host.request("MR:2:50.000:");
+      waitAxis(2);
+      points++;
+    }
+  }
+  return points;
+}
+
+//! Envía un desplazamiento sincrónico absoluto de 0.5 s y espera los ejes N°5 y N°6.
+/*!
+  La espera es con "?M:": el estado de "?RA:" sigue en "Ready" mientras la acción aceptada
+  espera el registro de la posición (ver FIPC_Persist.h).
+*/
+static void syncAbsolute(const float* target){
+  char line[API_REQUEST_SIZE];
+  FIPC_Text out(line, sizeof(line));
+  out.add("SYNCA:");
+  for( uint8_t i=0; i<AXIS_NUMBERS; i++ ) out.add(target[i], 3).add(':');
+  out.add("0.500:0.100:");
+  host.request(line);
+  waitAxis(5);
+  waitAxis(6);
+}
+
+//! Lleva los ejes N°5 y N°6 al centro del recorrido: la referencia está en el extremo negativo.
+static void center(){
+  float target[AXIS_NUMBERS];
+  for( uint8_t i=0; i<AXIS_NUMBERS; i++ ){
+    char line[16];
+    snprintf(line, sizeof(line), "?P:%u:", i+1);
+    target[i] = atof(host.request(line));
+  }
+  target[4] = target[5] = 0.0;
+  char line[API_REQUEST_SIZE];
+  FIPC_Text out(line, sizeof(line));
+  out.add("SYNCAF:");
+  for( uint8_t i=0; i<AXIS_NUMBERS; i++ ) out.add(target[i], 3).add(':');
+  host.request(line);
+  waitAxis(5);
+  waitAxis(6);
+}
+
+//! Dos barridos de 5 puntos de 1000 mgrad de los ejes N°5 y N°6 alrededor de la posición actual.
+static long goniometer(){
+  const uint8_t sweeps = 2, points = 5;
+  const float span = 1000.0;
+  float start[AXIS_NUMBERS];
+  for( uint8_t i=0; i<AXIS_NUMBERS; i++ ){
+    char line[16];
+    snprintf(line, sizeof(line), "?P:%u:", i+1);
+    start[i] = atof(host.request(line));
+  }
+  long done = 0;
+  for( uint8_t sweep=0; sweep<sweeps; sweep++ ){
+    for( uint8_t j=0; j<points; j++ ){
+      uint8_t k = (sweep%2==0) ? j : points-1-j;
+      float offset = span*(k/(float)(points-1)-0.5);
+      float target[AXIS_NUMBERS];
+      memcpy(target, start, sizeof(target));
+      target[4] += offset;
+      target[5] -= offset;
+      syncAbsolute(target);
+      done++;
+    }
+  }
+  syncAbsolute(start);
+  return done;
+}
+
+//! Consultas "?RA:" sin pausa durante una ida y vuelta de 2000 um del eje N°3.
+/*!
+  Cada desplazamiento termina cuando el eje deja "Moving" luego de haberlo mostrado: antes
+  la acción aceptada espera el registro de la posición (ver FIPC_Persist.h).
+  \param stretch Duración sobre la estimada con "?TR:" ("factible;duración;velocidad").
+  \return Consultas.
+*/
+static long polling(double &stretch){
+  const char* estimate = strchr(host.request("?TR:3:2000.000:"), ';');
+  double seconds = estimate ? atof(estimate+1) : 0.0;
+  unsigned long start = micros();
+  long queries = 0;
+  const char* moves[] = {"MR:3:2000.000:", "MR:3:-2000.000:"};
+  for( uint8_t i=0; i<2; i++ ){
+    host.request(moves[i]);
+    bool moving = false;
+    while( micros()-start<BENCH_TIMEOUT ){
+      queries++;
+      bool now = strstr(host.request("?RA:"), "Moving")!=NULL;
+      if( (moving)&&(!now) ) break;
+      moving = now;
+    }
+  }
+  stretch = (seconds>0.0) ? (micros()-start)*1e-6/(2.0*seconds) : 0.0;
+  return queries;
+}
+
+//! Ejecuta una carga; la grabación de la sesión cuenta los ciclos lentos.
+static void measure(const char* name, BenchResult &result){
+  memset(&result, 0, sizeof(result));
+  result.name = name;
+  api.request("REC:1:");
+  host.resetLink();
+  unsigned long start = micros();
+  if( !strcmp(name, "homing") )     result.points = homing();
+  if( !strcmp(name, "raster") )     result.points = raster();
+  if( !strcmp(name, "goniometer") ) result.points = goniometer();
+  if( !strcmp(name, "polling") )    result.points = polling(result.stretch);
+  result.seconds = (micros()-start)*1e-6;
+  api.request("REC:0:");
+  unsigned long cycles = 0, execMax = 0, slow = 0;
+  sscanf(api.request("?REC:"), "%*d;%*u;%*u;%*u;%lu;%*f;%lu;%lu", &cycles, &execMax, &slow);
+  result.requests = host.getRequests();
+  result.bytesOut = host.getBytesOut();
+  result.bytesIn = host.getBytesIn();
+  result.linkUtilization = (result.seconds>0.0) ? host.getLinkTime()*1e-6/result.seconds : 0.0;
+  result.execCycles = slow;
+  result.execMax = execMax;
+}
+
+//! Escribe los resultados en el formato de module_bench.save().
+static bool save(const char* path, const char* label, const BenchResult* results, uint8_t count){
+  FILE* file = fopen(path, "w");
+  if( !file ) return false;
+  fprintf(file, "{\n  \"baudrate\": %d,\n  \"label\": \"%s\",\n  \"workloads\": {\n", BENCH_BAUDRATE, label);
+  for( uint8_t i=0; i<count; i++ ){
+    const BenchResult &r = results[i];
+    fprintf(file, "    \"%s\": {\n", r.name);
+    fprintf(file, "      \"bytesIn\": %lu,\n      \"bytesOut\": %lu,\n", r.bytesIn, r.bytesOut);
+    fprintf(file, "      \"execCycles\": %lu,\n      \"execMax\": %lu,\n", r.execCycles, r.execMax);
+    fprintf(file, "      \"linkUtilization\": %.6f,\n      \"points\": %ld,\n", r.linkUtilization, r.points);
+    fprintf(file, "      \"pointsPerMinute\": %.3f,\n", (r.seconds>0.0) ? r.points*60.0/r.seconds : 0.0);
+    fprintf(file, "      \"requests\": %lu,\n      \"seconds\": %.6f,\n", r.requests, r.seconds);
+    fprintf(file, "      \"stretch\": %.6f\n    }%s\n", r.stretch, (i+1<count) ? "," : "");
+  }
+  fprintf(file, "  }\n}\n");
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char* argv[]){
+  const char* workloads[] = {"homing", "raster", "goniometer", "polling"}; // homing primero: referencia de los ejes
+  const uint8_t count = sizeof(workloads)/sizeof(workloads[0]);
+  BenchResult results[count];
+
+  hostSetExecCost(BUDGET_BASE_US, BUDGET_STEP_US);
+  api.begin();
+  host.setBaudrate(BENCH_BAUDRATE);
+  for( uint8_t i=0; i<count; i++ ){
+    if( !strcmp(workloads[i], "goniometer") ) center(); // fuera de la medición
+    measure(workloads[i], results[i]);
+    const BenchResult &r = results[i];
+    printf("%-12s %8.1f puntos/min  %7.2f s  enlace %5.1f %%  exec lentos %lu (máximo %lu us)\n", r.name,
+           (r.seconds>0.0) ? r.points*60.0/r.seconds : 0.0, r.seconds, r.linkUtilization*100.0, r.execCycles, r.execMax);
+  }
+  if( (argc>1)&&(!save(argv[1], (argc>2) ? argv[2] : "local", results, count)) ){
+    printf("%s: no se pudo escribir\n", argv[1]);
+    return 1;
+  }
+  return 0;
+}
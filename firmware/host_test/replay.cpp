@@ -0,0 +1,59 @@
+/*! \file replay.cpp
+    \brief Reproduce una sesión de FIPC_Recorder en el controlador con el reloj simulado (ver HostReplay.h).
+
+    Uso: replay <registro> [escala]
+
+    El registro es el binario de session.save() de python_lib/module_session.py o el texto
+    hexadecimal de las respuestas de "?RECD:". La escala multiplica los instantes de las
+    solicitudes: 1 (por defecto) con los tiempos originales, menor para comprimirlos y 0 sin
+    esperas. Informa el resumen grabado y el reproducido como session.compare() y las
+    estadísticas de exec() de "?REC:" con la duración de exec() simulada.
+*/
+
+#include "HostReplay.h"
+
+static FIPC_API api; /*!< Controlador. */
+
+static uint8_t logData[RECORDER_SIZE]; /*!< Registro de la sesión. */
+
+//! Imprime una fila del resumen.
+static void row(const char* name, double recorded, double replayed){
+  printf("%-12s %12.3f %12.3f\n", name, recorded, replayed);
+}
+
+int main(int argc, char* argv[]){
+  if( argc<2 ){
+    printf("uso: %s <registro> [escala]\n", argv[0]);
+    return 2;
+  }
+  float scale = (argc>2) ? atof(argv[2]) : 1.0;
+  uint16_t size = HostReplay::load(argv[1], logData);
+  if( !size ){
+    printf("%s: registro vacío o inexistente\n", argv[1]);
+    return 2;
+  }
+  HostSummary recorded;
+  HostReplay::summary(logData, size, recorded);
+
+  hostSetExecCost(BUDGET_BASE_US, BUDGET_STEP_US);
+  HostSession host(&api);
+  api.begin();
+  HostReplay replay(&host);
+  bool ready = replay.prepare(logData, size);
+  HostSummary replayed;
+  HostExecStats exec;
+  bool idle = replay.replay(logData, size, scale, replayed, exec);
+
+  printf("%-12s %12s %12s\n", "", "grabada", "reproducida");
+  row("requests", recorded.requests, replayed.requests);
+  row("transitions", recorded.transitions, replayed.transitions);
+  row("duration", recorded.duration*1e-6, replayed.duration*1e-6);
+  row("motion", recorded.motion*1e-6, replayed.motion*1e-6);
+  row("slowCycles", recorded.slowCycles, replayed.slowCycles);
+  row("slowMax", recorded.slowMax, replayed.slowMax);
+  printf("exec: %u ciclos, medio %.1f us, máximo %u us, %u de más de %u us\n",
+         exec.cycles, exec.mean, exec.max, exec.slow, RECORDER_EXEC_LIMIT);
+  if( !ready ) printf("los ejes no llegaron a la posición inicial\n");
+  if( !idle ) printf("los ejes no llegaron al reposo\n");
+  return (ready&&idle) ? 0 : 1;
+}
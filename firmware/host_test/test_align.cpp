@@ -0,0 +1,58 @@
+/*! \file test_align.cpp
+    \brief Prueba de FIPC_Align: conversor leído fuera de exec() y paso mínimo menor que un paso del eje.
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+#define ALIGN_PIN 34 /*!< GPIO analógica de potencia óptica. */
+
+static FIPC_API api; /*!< Controlador. */
+
+static unsigned long lastSample = 0; /*!< Instante en ms del último sample(). */
+
+//! Acoplamiento gaussiano centrado en (20, 15) um con radio de 5 um.
+static void coupling(){
+  float x = atof(api.request("?P:1:"))-20.0;
+  float y = atof(api.request("?P:2:"))-15.0;
+  hostSetAnalog(ALIGN_PIN, (int)(4000.0*exp(-(x*x+y*y)/25.0)));
+}
+
+//! Ejecuta la alineación; las lecturas del conversor solo ocurren en sample().
+static bool run(unsigned long us){
+  for( unsigned long t=0; t<us; t+=HOST_EXEC_US ){
+    hostAdvance(HOST_EXEC_US);
+    uint32_t reads = hostGetAnalogReads();
+    api.exec(NULL);
+    CHECK( hostGetAnalogReads()==reads ); // exec() no espera al conversor
+    if( millis()-lastSample>=HOST_PROGRAM_MS ){
+      lastSample = millis();
+      coupling();
+      api.sample();
+    }
+    if( !strncmp(api.request("?ALIGN:"), "Done;", 5) ) return true;
+  }
+  return false;
+}
+
+int main(){
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.request("MA:1:18:MA:2:13:");
+  CHECK( host.run(30000000, hostIdle) );
+
+  // Gradiente con paso mínimo de 0.05 um (un paso del eje es 0.3125 um)
+  CHECK( !strcmp(api.request("ALIGNADC:34:4:ALIGN:1:1:2:0:1:0.05:300:100:"), "1\n") );
+  CHECK( run(60000000) );
+  const char* reply = api.request("?ALIGN:");
+  const char* x = strchr(strchr(strchr(reply, ';')+1, ';')+1, ';')+1;
+  const char* y = strchr(x, ';')+1;
+  CHECK( (fabs(atof(x)-20.0)<=0.7)&&(fabs(atof(y)-15.0)<=0.7) );
+  CHECK( hostGetAnalogReads()>0 );
+
+  return HOST_RESULT("test_align");
+}
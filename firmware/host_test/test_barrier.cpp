@@ -0,0 +1,75 @@
+/*! \file test_barrier.cpp
+    \brief Prueba de los lotes de acciones: inicio en el mismo ciclo y paradas sin demora.
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+static FIPC_API api; /*!< Controlador. */
+
+//! Ejecuta ciclos de exec() sin persist(): los registros de posición quedan sin guardar.
+static void execOnly(uint16_t cycles){
+  for( uint16_t i=0; i<cycles; i++ ){
+    hostAdvance(HOST_EXEC_US);
+    api.exec(NULL);
+  }
+}
+
+//! Verifica el estado de un eje.
+static bool status(uint8_t id, const char* expected){
+  char line[16];
+  snprintf(line, sizeof(line), "?S:%u:", id);
+  const char* reply = api.request(line);
+  return !strncmp(reply, expected, strlen(expected))&&(reply[strlen(expected)]=='\n');
+}
+
+int main(){
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.run(1500000);
+
+  // Los ejes de un desplazamiento sincrónico inician en el mismo ciclo
+  // luego de guardar los registros sin referencia válida de todos
+  host.request("SYNCR:100:50:30:0:0:0:1:0.2:");
+  execOnly(10);
+  CHECK( status(1, "Ready")&&status(2, "Ready")&&status(3, "Ready") );
+  api.persist();
+  execOnly(1);
+  CHECK( status(1, "Moving")&&status(2, "Moving")&&status(3, "Moving") );
+  CHECK( status(4, "Ready") );
+  CHECK( host.run(30000000, hostIdle) );
+
+  // Una parada no espera: ni a los registros sin guardar ni a un lote retenido de otro eje
+  host.request("MR:1:2000:MR:2:2000:");
+  api.persist();
+  execOnly(1);
+  CHECK( status(1, "Moving")&&status(2, "Moving") );
+  host.request("LINK:1:4:LINKARM:MR:3:50:");
+  CHECK( !strncmp(host.request("?LINK:"), "1;1;", 4) );
+  execOnly(5000); // 100 ms a velocidad de crucero
+  host.request("S:1:");
+  CHECK( !strncmp(host.request("?LINK:"), "1;0;", 4) ); // la parada descarta la retención
+  uint32_t cycles = 0;
+  while( (status(1, "Moving"))&&(cycles<100000) ){
+    execOnly(1);
+    cycles++;
+  }
+  CHECK( cycles*HOST_EXEC_US<=250000 ); // frenado desde el crucero en menos de un tiempo de aceleración
+  CHECK( status(2, "Moving") );         // el otro eje continúa
+  CHECK( status(3, "Ready") );          // la acción retenida se canceló
+  host.request("S:2:");
+  CHECK( host.run(30000000, hostIdle) );
+
+  // La deshabilitación no queda retenida
+  host.request("LINKARM:MR:2:10:");
+  host.request("D:");
+  execOnly(1);
+  for( uint8_t id=1; id<=AXIS_NUMBERS; id++ ) CHECK( status(id, "Disable") );
+  CHECK( !strncmp(host.request("?LINK:"), "1;0;", 4) );
+
+  return HOST_RESULT("test_barrier");
+}
@@ -0,0 +1,100 @@
+/*! \file test_budget.cpp
+    \brief Prueba del presupuesto de pasos con la búsqueda del cero y los desplazamientos del programa.
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+static FIPC_API api; /*!< Controlador. */
+
+//! Registro guardado de FIPC_Budget (mismo formato).
+typedef struct{
+  uint32_t magic;
+  uint8_t mode;
+  float base;
+  float step;
+}BudgetRecord;
+
+//! Verifica la respuesta a una solicitud.
+static bool reply(const char* line, const char* expected){
+  return !strncmp(api.request(line), expected, strlen(expected));
+}
+
+//! Guarda los costos del presupuesto y un programa con un desplazamiento relativo del eje #1.
+/*!
+  Con un ciclo base de 10 ms cualquier acción que emita pasos en exec() supera el presupuesto.
+*/
+static void prepare(){
+  FIPC_FileStorage storage("fipc_nvs");
+  BudgetRecord budget = {0x46494231, 0, 10000.0, 8.0};
+  storage.write("budget", &budget, sizeof(budget));
+
+  static FIPC_Program::ProgramBlob program;
+  memset(&program, 0, sizeof(program));
+  const float distance = 10.0;
+  uint8_t* code = program.code;
+  *code++ = FIPC_Program::OP_MOVE;
+  *code++ = 0; // relativo
+  *code++ = 1;
+  *code++ = PROGRAM_CONST;
+  memcpy(code, &distance, sizeof(distance));
+  code += sizeof(distance);
+  *code++ = FIPC_Program::OP_END;
+  program.magic = 0x46495031;
+  program.version = 1;
+  program.size = code-program.code;
+  program.crc = FIPC_Storage::crc16(program.position, sizeof(program.position)+program.size);
+  storage.write("program", &program, sizeof(program));
+}
+
+int main(){
+  prepare();
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+
+  // La búsqueda del cero de un eje y de todos pasa por el presupuesto
+  host.request("BUDGET:1:H:1:");
+  host.run(100000);
+  CHECK( reply("?S:1:", "NoHome\n") );
+  host.request("HA:");
+  host.run(100000);
+  for( uint8_t id=1; id<=AXIS_NUMBERS; id++ ){
+    char line[16];
+    snprintf(line, sizeof(line), "?S:%u:", id);
+    CHECK( reply(line, "NoHome\n") );
+  }
+  CHECK( reply("?BUDGET:", "1;10000.000;8.000;0.0;2;0;") );
+
+  // En BUDGET_STRETCH la búsqueda del cero no se estira
+  host.request("BUDGET:2:H:1:");
+  host.run(100000);
+  CHECK( reply("?S:1:", "NoHome\n") );
+  CHECK( reply("?BUDGET:", "2;10000.000;8.000;0.0;3;0;") );
+
+  host.request("BUDGET:0:HA:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.run(1500000);
+
+  // El desplazamiento del programa se descarta como "MR:"
+  host.request("BUDGET:1:PRGRUN:");
+  host.run(100000);
+  CHECK( reply("?PRG:", "Error;") );
+  CHECK( reply("?P:1:", "0.00\n") );
+  CHECK( reply("?BUDGET:", "1;10000.000;8.000;0.0;4;0;") );
+
+  // y queda retenido hasta el disparo como "MR:"
+  host.request("BUDGET:0:LINK:1:4:LINKARM:PRGRUN:");
+  host.run(100000);
+  CHECK( reply("?PRG:", "Done;") );
+  CHECK( reply("?S:1:", "Ready\n") );
+  CHECK( reply("?LINK:", "1;1;") );
+  host.request("LINKGO:");
+  host.run(1000);
+  CHECK( reply("?S:1:", "Moving\n") );
+  CHECK( host.run(30000000, hostIdle) );
+  CHECK( reply("?P:1:", "10.00\n") );
+
+  return HOST_RESULT("test_budget");
+}
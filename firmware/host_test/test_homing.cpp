@@ -0,0 +1,79 @@
+/*! \file test_homing.cpp
+    \brief Prueba de FIPC_Homing con un switch real simulado (rebotes y switch que no responde).
+*/
+
+// La unidad se compila aquí con el switch real; la biblioteca la contiene con el simulado
+#define HOMING_SIMULATED 0
+#include "FIPC_Homing.cpp"
+
+#include "HostTest.h"
+
+#define SWITCH_PIN 4     /*!< GPIO del switch de referencia (activo en bajo). */
+#define SWITCH_POS -1000 /*!< Posición en pasos del switch. */
+
+//! Modelos del switch.
+typedef enum{ SWITCH_GOOD,   /*!< Presionado desde SWITCH_POS. */
+              SWITCH_BOUNCE, /*!< Al liberarse rebota y queda presionado 700 pasos más. */
+              SWITCH_BROKEN  /*!< Deja de responder luego de la primera liberación. */
+              }SwitchModel;
+
+static SwitchModel model;   /*!< Modelo en uso. */
+static bool touched;        /*!< El switch se presionó una vez. */
+
+static bool released;       /*!< El switch se liberó luego de presionarse. */
+static bool away;           /*!< El eje superó el rebote. */
+
+//! Estado del switch en una posición.
+static bool pressedAt(long pos){
+  bool pressed = (pos<=SWITCH_POS);
+  if( pressed ) touched = true;
+  else if( touched ) released = true;
+  if( (touched)&&(pos>SWITCH_POS+700) ) away = true;
+  if( model==SWITCH_BOUNCE ) return pressed||((touched)&&(!away)&&(pos>SWITCH_POS+1)&&(pos<=SWITCH_POS+700));
+  if( model==SWITCH_BROKEN ) return pressed&&(!released);
+  return pressed;
+}
+
+//! Ejecuta una búsqueda completa.
+/*!
+  \return Estado final de la búsqueda.
+*/
+static uint8_t homing(AccelStepper &stepper, FIPC_Homing &home, SwitchModel iModel){
+  model = iModel;
+  touched = released = away = false;
+  stepper.setCurrentPosition(0);
+  hostSetInput(SWITCH_PIN, HIGH);
+  uint8_t last = home.getStatus();
+  for( uint32_t cycles=0; cycles<2000000; cycles++ ){
+    hostAdvance(20);
+    bool running = home.run();
+    hostSetInput(SWITCH_PIN, !pressedAt(stepper.currentPosition()));
+    uint8_t status = home.getStatus();
+    if( (status==FIPC_Homing::HOMING_SLOW)&&(last!=status) ) CHECK( digitalRead(SWITCH_PIN)==HIGH ); // liberado
+    last = status;
+    if( !running ) return status;
+  }
+  return 0xFF;
+}
+
+int main(){
+  AccelStepper stepper(AccelStepper::DRIVER, 2, 3);
+  FIPC_Homing home(&stepper, SWITCH_PIN);
+  home.setSpeed(4000.0, 400.0); // hacia coordenadas negativas
+
+  // Switch sin rebotes: la referencia es el flanco
+  CHECK( homing(stepper, home, SWITCH_GOOD)==FIPC_Homing::HOMING_OK );
+  CHECK( home.getLatchSteps()==SWITCH_POS );
+
+  // Rebote en la liberación: la pasada lenta inicia con el switch liberado
+  home.stop();
+  CHECK( homing(stepper, home, SWITCH_BOUNCE)==FIPC_Homing::HOMING_OK );
+  CHECK( home.getLatchSteps()==SWITCH_POS );
+
+  // Switch que no responde: la pasada lenta se aborta HOMING_SLOW_STEPS pasos más allá del switch
+  home.stop();
+  CHECK( homing(stepper, home, SWITCH_BROKEN)==FIPC_Homing::HOMING_NOT );
+  CHECK( stepper.currentPosition()==SWITCH_POS-HOMING_SLOW_STEPS );
+
+  return HOST_RESULT("test_homing");
+}
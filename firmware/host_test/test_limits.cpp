@@ -0,0 +1,128 @@
+/*! \file test_limits.cpp
+    \brief Prueba de FIPC_Limits: parada con la aceleración máxima al presionar un fin de carrera.
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+#define SPEED     1000.0 /*!< Velocidad de los desplazamientos en um/s. */
+#define ACCEL_MAX 7500.0 /*!< Aceleración máxima del eje N°1 (MOX_02_30) en um/s^2. */
+#define STEP_UM   (1.0/3.2) /*!< Paso del eje N°1 en um. */
+
+static FIPC_API api; /*!< Controlador. */
+
+static long limitEvents = 0; /*!< Eventos "LIMIT:" recibidos. */
+
+static char lastEvent[32]; /*!< Último evento "LIMIT:" recibido. */
+
+//! Lee los eventos pendientes y cuenta los de fin de carrera.
+static void readEvents(){
+  const char* events = api.getEvents();
+  while( (events = strstr(events, "LIMIT:"))!=NULL ){
+    limitEvents++;
+    strncpy(lastEvent, events, sizeof(lastEvent)-1);
+    *strchr(lastEvent, '\n') = '\0';
+    events++;
+  }
+}
+
+//! Ejecuta un ciclo de exec() y lee los eventos.
+static void tick(){
+  hostAdvance(HOST_EXEC_US);
+  api.exec(NULL);
+  readEvents();
+}
+
+//! Ejecuta hasta que el eje N°1 queda en reposo.
+/*!
+  \return Duración en us.
+*/
+static unsigned long untilIdle(){
+  unsigned long start = micros();
+  while( (!api.isIdle(0x01))&&(micros()-start<30000000) ){
+    tick();
+    if( micros()%(HOST_PERSIST_MS*1000)==0 ) api.persist(); // como TaskReadAction
+  }
+  return micros()-start;
+}
+
+//! Posición del eje N°1.
+static float position(){ return atof(api.request("?P:1:")); }
+
+//! Presiona el switch durante el crucero y verifica la parada.
+/*!
+  \param host Sesión del controlador.
+  \param pin Switch.
+  \param positive true si el switch es el del sentido positivo.
+*/
+static void pressAtCruise(HostSession &host, uint8_t pin, bool positive){
+  host.run(600000); // crucero luego del tiempo de aceleración
+  readEvents();
+  limitEvents = 0;
+
+  // La parada se inicia en el mismo ciclo en que se lee el switch, antes del paso del ciclo
+  float start = position();
+  hostSetInput(pin, LOW);
+  tick();
+  char expected[32];
+  snprintf(expected, sizeof(expected), "LIMIT:1;%c;%.2f", positive ? '+' : '-', start);
+  CHECK( limitEvents==1 );
+  CHECK( !strcmp(lastEvent, expected) );
+
+  // Frena con la aceleración máxima, no con el tiempo de aceleración configurado
+  unsigned long time = untilIdle();
+  float distance = fabs(position()-start);
+  float expectedDistance = SPEED*SPEED/(2.0*ACCEL_MAX);
+  CHECK( fabs(distance-expectedDistance)<=0.05*expectedDistance );
+  CHECK( time<=1.1e6*SPEED/ACCEL_MAX );
+  CHECK( limitEvents==1 ); // un único evento aunque el switch siga presionado
+}
+
+int main(){
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.run(1500000);
+  host.request("V:1:1000:A:1:0.25:MA:1:2000:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.request("JOGT:2000:");
+
+  // Desplazamiento relativo hacia el switch positivo
+  host.request("MR:1:5000:");
+  pressAtCruise(host, SW1_01, true);
+  CHECK( !strcmp(host.request("?S:1:"), "Ready\n") );
+
+  // Con el switch presionado se puede alejar, pero no acercar
+  float stop = position();
+  host.request("MR:1:-100:");
+  CHECK( host.run(30000000, hostIdle) );
+  CHECK( fabs(position()-(stop-100.0))<=STEP_UM );
+  readEvents();
+  CHECK( limitEvents==1 );
+  host.request("MR:1:100:");
+  CHECK( host.run(30000000, hostIdle) );
+  CHECK( fabs(position()-(stop-100.0))<=STEP_UM );
+  readEvents();
+  CHECK( limitEvents==2 );
+  hostSetInput(SW1_01, HIGH);
+
+  // Modo velocidad hacia el switch negativo
+  host.request("JOG:1:-1000:");
+  pressAtCruise(host, SW2_01, false);
+  CHECK( !strcmp(host.request("?S:1:"), "Ready\n") );
+
+  // Se aleja en modo velocidad con el switch presionado
+  stop = position();
+  host.request("JOG:1:1000:");
+  host.run(300000);
+  CHECK( position()>stop+50.0 );
+  host.request("S:1:");
+  CHECK( host.run(30000000, hostIdle) );
+  readEvents();
+  CHECK( limitEvents==1 );
+
+  return HOST_RESULT("test_limits");
+}
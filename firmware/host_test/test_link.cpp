@@ -0,0 +1,101 @@
+/*! \file test_link.cpp
+    \brief Prueba de la línea de disparo con dos controladores en el mismo proceso.
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+static FIPC_API leader;   /*!< Controlador líder. */
+static FIPC_API follower; /*!< Controlador seguidor. */
+
+static unsigned long lastPersist = 0; /*!< Instante en ms del último persist(). */
+
+//! Ejecuta un ciclo de tiempo real de ambos controladores (como dos TaskExec en paralelo).
+static void tick(){
+  hostAdvance(HOST_EXEC_US);
+  leader.exec(NULL);
+  follower.exec(NULL);
+  if( millis()-lastPersist>=HOST_PERSIST_MS ){
+    lastPersist = millis();
+    leader.persist();
+    follower.persist();
+  }
+}
+
+//! Ejecuta ambos controladores.
+/*!
+  \param us Duración en us.
+  \param idle true para terminar con todos los ejes de ambos en reposo.
+  \return true si terminó con los ejes en reposo.
+*/
+static bool run(unsigned long us, bool idle = false){
+  for( unsigned long t=0; t<us; t+=HOST_EXEC_US ){
+    tick();
+    if( (idle)&&(leader.isIdle(0xFF))&&(follower.isIdle(0xFF)) ) return true;
+  }
+  return false;
+}
+
+//! Verifica la respuesta a una solicitud.
+static bool reply(FIPC_API &api, const char* line, const char* expected){
+  return !strncmp(api.request(line), expected, strlen(expected));
+}
+
+int main(){
+  hostReleaseLimits();
+  leader.begin();
+  follower.begin();
+  leader.request("E:");
+  follower.request("E:");
+  run(100000);
+  leader.request("HA:");
+  follower.request("HA:");
+  CHECK( run(30000000, true) );
+  run(1500000);
+
+  CHECK( reply(leader, "LINK:1:4:?LINK:", "1;0;0;0;") );
+  CHECK( reply(follower, "LINK:2:4:?LINK:", "2;0;0;0;") );
+
+  // El desplazamiento queda retenido en ambos controladores
+  leader.request("LINKARM:MR:1:5:");
+  follower.request("LINKARM:MR:1:5:");
+  run(200000);
+  CHECK( reply(leader, "?S:1:", "Ready\n")&&reply(follower, "?S:1:", "Ready\n") );
+  CHECK( reply(leader, "?LINK:", "1;1;")&&reply(follower, "?LINK:", "2;1;") );
+
+  // El seguidor no genera el disparo
+  follower.request("LINKGO:");
+  run(200000);
+  CHECK( reply(leader, "?S:1:", "Ready\n")&&reply(follower, "?S:1:", "Ready\n") );
+
+  // El disparo del líder inicia ambos en el mismo ciclo
+  leader.request("LINKGO:");
+  tick();
+  CHECK( reply(leader, "?S:1:", "Moving\n")&&reply(follower, "?S:1:", "Moving\n") );
+  CHECK( reply(leader, "?LINK:", "1;0;0;1;")&&reply(follower, "?LINK:", "2;0;0;1;") );
+  char edge[48];
+  strncpy(edge, leader.request("?LINK:"), sizeof(edge)-1);
+  edge[sizeof(edge)-1] = 0;
+  CHECK( !strcmp(edge+2, follower.request("?LINK:")+2) ); // mismo instante: reloj común
+  CHECK( run(30000000, true) );
+  CHECK( reply(leader, "?P:1:", "5.00\n")&&reply(follower, "?P:1:", "5.00\n") );
+
+  // Un disparo sin acciones retenidas solo registra el flanco
+  leader.request("LINKGO:");
+  run(5000);
+  CHECK( reply(leader, "?LINK:", "1;0;0;2;")&&reply(follower, "?LINK:", "2;0;0;2;") );
+  CHECK( leader.isIdle(0xFF)&&follower.isIdle(0xFF) );
+
+  // La cancelación en el seguidor descarta su lote; el líder inicia solo
+  leader.request("LINKARM:MR:1:-5:");
+  follower.request("LINKARM:MR:1:-5:");
+  follower.request("LINKX:");
+  CHECK( reply(follower, "?LINK:", "2;0;") );
+  leader.request("LINKGO:");
+  tick();
+  CHECK( reply(leader, "?S:1:", "Moving\n")&&reply(follower, "?S:1:", "Ready\n") );
+  CHECK( run(30000000, true) );
+  CHECK( reply(leader, "?P:1:", "0.00\n")&&reply(follower, "?P:1:", "5.00\n") );
+
+  return HOST_RESULT("test_link");
+}
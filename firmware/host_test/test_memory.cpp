@@ -0,0 +1,49 @@
+/*! \file test_memory.cpp
+    \brief Prueba del modelo de memoria estática: sin reservas luego de begin().
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+#include "FIPC_Memory.h"
+
+static FIPC_API api; /*!< Controlador, ubicado estáticamente como en FIPC_Project.ino. */
+
+//! Solicitudes de una sesión: consultas, desplazamientos, modo velocidad, estimaciones y reportes.
+static const char* session[] = {
+  "?RA:", "?R:1:", "?S:2:", "?M:3:", "?P:4:", "?V:5:", "?A:6:", "?MEM:", "?CFG:", "?CFGD:",
+  "V:1:3.5:", "A:1:0.2:", "MR:1:20:", "MA:2:-15:", "?TR:1:100:", "?TA:2:5:", "?TB:3:3:1:2:3:",
+  "SYNCR:1:2:3:4:5:6:0.5:0.1:", "SYNCA:0:0:0:0:0:0:0.5:0.1:", "?TS:1:1:1:1:1:1:",
+  "JOG:3:50:", "JOGA:10:-10:0:0:0:0:", "S:3:", "SA:",
+  "REC:1:", "?REC:", "?RECD:0:", "REC:0:", "?LAT:0:", "?LATH:0:", "LATX:", "?BUDGET:",
+  "?TCACHE:", "?LINK:", "?CLK:", "?NV:1:", "?SCAN:", "?ALIGN:", "?TUNE:", "?K:", "?PRG:", "?SHIFT:",
+};
+
+int main(){
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+
+  // Las lecturas de los argumentos siguen el orden del comando
+  CHECK( !strcmp(host.request("V:1:3.5:?V:1:"), "3.50\n") );
+  host.request("MR:1:2:");
+  CHECK( host.run(5000000, hostIdle) );
+  CHECK( !strcmp(host.request("?P:1:"), "1.87\n") ); // 6 pasos de 3,2 pasos/um
+  CHECK( !strcmp(host.request("?P:2:"), "0.00\n") );
+
+  // Régimen permanente: request(), exec() y persist() no reservan memoria (también lo verifican con assert())
+  uint32_t allocations = FIPC_Memory::getAllocations();
+  for( uint8_t pass=0; pass<3; pass++ ){
+    for( uint8_t i=0; i<sizeof(session)/sizeof(session[0]); i++ ){
+      host.request(session[i]);
+      host.run(20000);
+    }
+    CHECK( host.run(30000000, hostIdle) );
+  }
+  FIPC_Memory::checkAllocations(allocations);
+  CHECK( FIPC_Memory::getAllocations()==allocations );
+
+  return HOST_RESULT("test_memory");
+}
@@ -0,0 +1,113 @@
+/*! \file test_microstep.cpp
+    \brief Prueba de FIPC_Microstep con las entradas de modo simuladas.
+*/
+
+#include "HostTest.h"
+#include "FIPC_Microstep.h"
+
+//! DRV8825 simulado: aplica el modo en el próximo pulso y lleva la posición en 1/32 de paso.
+class HostStepMode : public FIPC_StepMode
+{
+  public:
+    void set(uint8_t mode) { _pending = mode; }
+
+    //! Pulso de paso.
+    void step(long dir){
+      if( _pending!=_mode ){
+        _mode = _pending;
+        if( _position%(32>>_mode) ) misaligned++; // el driver saltaría al estado válido más cercano
+      }
+      _position += dir*(32>>_mode);
+    }
+
+    long _position = 0;       /*!< Posición del driver en 1/32 de paso. */
+    uint8_t _mode = 5;        /*!< Modo aplicado. */
+    uint8_t _pending = 5;     /*!< Modo de las entradas. */
+    uint32_t misaligned = 0;  /*!< Cambios de modo fuera de un estado del nuevo modo. */
+};
+
+//! Resultado de un desplazamiento simulado.
+struct Run
+{
+  long position;  /*!< Posición del driver en pasos finos. */
+  float peak;     /*!< Mayor velocidad de los pulsos en pasos finos/s. */
+  uint32_t pulses; /*!< Pulsos emitidos. */
+};
+
+//! Ejecuta un desplazamiento con un ciclo cada us.
+/*!
+  \param stopAt Posición en pasos finos desde la que se frena con stop() (0 sin frenado).
+*/
+static Run move(FIPC_Microstep &micro, HostStepMode &driver, uint8_t fine, long from, long to, long origin, float speed, float accel, long stopAt = 0){
+  Run result = {0, 0.0, 0};
+  driver._position = (from-origin)*(32>>fine);
+  CHECK( micro.start(from, to, origin, speed, accel, 0) );
+  long dir = (to>from) ? 1 : -1;
+  long last = from;
+  unsigned long lastTime = 0;
+  bool stopped = false;
+  for( unsigned long now=0; now<60000000; now++ ){
+    bool step;
+    if( !micro.run(now, step) ) break;
+    if( !step ) continue;
+    driver.step(dir);
+    result.pulses++;
+    long u = (micro.getPosition()-last)*dir;
+    if( (result.pulses>1)&&(now>lastTime) ){
+      float v = u*1e6/(now-lastTime);
+      if( v>result.peak ) result.peak = v;
+    }
+    last = micro.getPosition();
+    lastTime = now;
+    if( (stopAt!=0)&&(!stopped)&&((last-stopAt)*dir>=0) ){
+      micro.stop();
+      stopped = true;
+    }
+  }
+  result.position = driver._position/(32>>fine)+origin;
+  return result;
+}
+
+int main(){
+  HostStepMode driver;
+  FIPC_Microstep micro;
+
+  // Modos inválidos
+  CHECK( !micro.begin(&driver, 5, 5) );
+  CHECK( !micro.begin(&driver, 6, 2) );
+  CHECK( !micro.begin(NULL, 5, 2) );
+  CHECK( micro.begin(&driver, 5, 2) );
+  CHECK( driver._pending==5 );
+
+  // Desplazamiento rápido: pasa al modo grueso y vuelve al fino en posiciones de paso completo
+  Run r = move(micro, driver, 5, 0, 64000, 0, 60000, 200000);
+  CHECK( r.position==64000 );
+  CHECK( micro.getPosition()==64000 );
+  CHECK( micro.getSwitches()==2 );
+  CHECK( micro.getMode()==5 );
+  CHECK( driver._pending==5 );
+  CHECK( driver.misaligned==0 );
+  CHECK( r.peak<=60000*1.02 );
+  CHECK( r.pulses<64000/4 ); // la mayor parte en pasos gruesos
+
+  // Origen de la tabla del driver desplazado y sentido negativo
+  r = move(micro, driver, 5, 13, -40000, 5, 60000, 200000);
+  CHECK( r.position==-40000 );
+  CHECK( micro.getSwitches()==4 );
+  CHECK( driver.misaligned==0 );
+
+  // Desplazamiento lento: siempre en el modo fino
+  r = move(micro, driver, 5, 0, 3000, 0, MICROSTEP_SWITCH_RATE/2, 20000);
+  CHECK( r.position==3000 );
+  CHECK( r.pulses==3000 );
+  CHECK( micro.getSwitches()==4 );
+
+  // Frenado en el crucero: termina en el modo fino sin perder micropasos
+  r = move(micro, driver, 5, 0, 200000, 0, 60000, 200000, 50000);
+  CHECK( r.position==micro.getPosition() );
+  CHECK( r.position<200000 );
+  CHECK( micro.getMode()==5 );
+  CHECK( driver.misaligned==0 );
+
+  return HOST_RESULT("test_microstep");
+}
@@ -0,0 +1,87 @@
+/*! \file test_persist.cpp
+    \brief Prueba de FIPC_Persist con FIPC_FileStorage: el desplazamiento espera a la escritura del registro sin referencia.
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+static FIPC_API api;     /*!< Controlador. */
+static FIPC_API early;   /*!< Controlador luego de un reinicio antes de guardar el registro. */
+static FIPC_API restart; /*!< Controlador luego de un reinicio (mismos archivos). */
+
+//! Ejecuta ciclos de exec() sin persist(), como si la escritura en flash no terminara.
+static void execOnly(FIPC_API &target, uint16_t cycles){
+  for( uint16_t i=0; i<cycles; i++ ){
+    hostAdvance(HOST_EXEC_US);
+    target.exec(NULL);
+  }
+}
+
+int main(){
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.run(1500000); // reposo: se guarda la posición con referencia válida
+  CHECK( !strncmp(host.request("?NV:1:"), "1;0.00;", 7) );
+
+  // El desplazamiento aceptado espera a que se guarde el registro sin referencia válida
+  uint32_t rising = hostGetRising(STEP_01);
+  host.request("MR:1:100:");
+  execOnly(api, 100);
+  CHECK( !strcmp(host.request("?S:1:"), "Ready\n") );
+  CHECK( hostGetRising(STEP_01)==rising );
+  CHECK( !strncmp(host.request("?NV:1:"), "1;0.00;", 7) ); // todavía no se escribió
+
+  // Un reinicio entre la aceptación y la escritura restaura la posición en la que el eje
+  // sigue detenido
+  HostSession before(&early);
+  early.begin();
+  before.request("E:");
+  before.run(100000);
+  before.request("HRA:");
+  before.run(100000);
+  CHECK( !strcmp(before.request("?S:1:"), "Ready\n") );
+  CHECK( !strcmp(before.request("?P:1:"), "0.00\n") );
+  CHECK( !strcmp(host.request("?P:1:"), "0.00\n") );
+
+  // Guardado el registro sin referencia, el eje inicia en el ciclo siguiente
+  api.persist();
+  CHECK( !strncmp(host.request("?NV:1:"), "0;", 2) );
+  execOnly(api, 2);
+  CHECK( !strcmp(host.request("?S:1:"), "Moving\n") );
+
+  // Un reinicio durante el desplazamiento no restaura la posición
+  HostSession after(&restart);
+  restart.begin();
+  after.request("E:");
+  after.run(100000);
+  after.request("HRA:");
+  after.run(100000);
+  CHECK( !strcmp(after.request("?S:1:"), "NoHome\n") );
+
+  // En reposo se guarda la nueva posición, que se restaura luego de un reinicio
+  CHECK( host.run(30000000, hostIdle) );
+  host.run(1500000);
+  CHECK( !strcmp(host.request("?P:1:"), "100.00\n") );
+  CHECK( !strncmp(host.request("?NV:1:"), "1;100.00;", 9) );
+  restart.begin();
+  after.request("HRA:");
+  after.run(100000);
+  CHECK( !strcmp(after.request("?S:1:"), "Ready\n") );
+  CHECK( !strcmp(after.request("?P:1:"), "100.00\n") );
+
+  // Un desplazamiento preparado y cancelado no deja el registro sin referencia
+  host.request("LINK:1:4:LINKARM:MR:1:10:");
+  host.run(200000);
+  CHECK( !strncmp(host.request("?NV:1:"), "0;", 2) );
+  host.request("LINKX:");
+  host.run(200000);
+  CHECK( !strncmp(host.request("?NV:1:"), "1;100.00;", 9) );
+  CHECK( !strcmp(host.request("?S:1:"), "Ready\n") );
+  CHECK( !strcmp(host.request("?P:1:"), "100.00\n") );
+
+  return HOST_RESULT("test_persist");
+}
@@ -0,0 +1,99 @@
+/*! \file test_pulse_encoder.cpp
+    \brief Prueba de FIPC_PulseEncoder: pasos y flancos contra el perfil analítico.
+*/
+
+#include "HostTest.h"
+#include "FIPC_PulseEncoder.h"
+#include "FIPC_TrajectoryCache.h"
+#include "FIPC_Storage.h"
+
+#define BLOCK 64 /*!< Símbolos por bloque, como el buffer del RMT. */
+
+//! Instante analítico en ticks del flanco del paso k de un desplazamiento de n pasos.
+static double analytic(uint32_t k, uint32_t n, double v, double a){
+  const double f = PULSE_TICK_HZ;
+  double ramp = 0.5*v*v/a;
+  if( 2.0*ramp>n ){ // triangular
+    double end = 2.0*sqrt((double)n/a);
+    return f*((k<=n/2) ? sqrt(2.0*k/a) : end-sqrt(2.0*(n-k)/a));
+  }
+  double end = v/a + n/v;
+  if( k<=(uint32_t)ramp ) return f*sqrt(2.0*k/a);
+  if( k<n-(uint32_t)ramp ) return f*(0.5*v/a + k/v);
+  return f*(end-sqrt(2.0*(n-k)/a));
+}
+
+//! Decodifica los símbolos de un desplazamiento y verifica cada flanco.
+/*!
+  \return Mayor diferencia en ticks con el perfil analítico.
+*/
+static double verify(FIPC_PulseEncoder &encoder, uint32_t n, float v, float a){
+  uint32_t out[BLOCK];
+  uint64_t time = 0;
+  uint32_t steps = 0;
+  uint32_t blockSteps = 0;
+  double worst = 0;
+  bool end = false;
+
+  CHECK( encoder.start(n,v,a) );
+  while( !encoder.done() ){
+    uint16_t s;
+    uint16_t count = encoder.fill(out,BLOCK,s);
+    blockSteps += s;
+    for( uint16_t i=0; i<count; i++ ){
+      uint32_t d0 = out[i]&0x7FFF, l0 = (out[i]>>15)&1;
+      uint32_t d1 = (out[i]>>16)&0x7FFF, l1 = out[i]>>31;
+      CHECK( !end );
+      CHECK( l0==0 );
+      if( d1==0 ){ end = true; continue; }
+      if( d0==0 ){ d0 = d1; end = true; } // nivel bajo final y fin
+      time += d0;
+      if( l1 ){
+        steps++;
+        CHECK( d1==PULSE_HIGH_TICKS );
+        double e = fabs((double)time-analytic(steps,n,v,a));
+        if( e>worst ) worst = e;
+      }
+      time += d1;
+    }
+  }
+  CHECK( steps==n );
+  CHECK( blockSteps==n );
+  CHECK( encoder.getSteps()==n );
+  return worst;
+}
+
+int main(){
+  FIPC_PulseEncoder encoder;
+
+  // Trapezoidal, triangular y de un paso
+  CHECK( verify(encoder,20000,4000,8000)<=1.0 );
+  CHECK( verify(encoder,500,4000,8000)<=1.0 );
+  CHECK( verify(encoder,1,1000,1000)<=1.0 );
+  // Intervalos mayores a PULSE_ITEM_MAX (velocidad baja)
+  CHECK( verify(encoder,50,100,50)<=1.0 );
+
+  // Parámetros inválidos
+  CHECK( !encoder.start(0,1000,1000) );
+  CHECK( !encoder.start(100,PULSE_MAX_RATE+1,1000) );
+  CHECK( !encoder.start(100,1000,0) );
+
+  // Con tablas: la primera vez se registra la rampa y luego se lee, con los mismos ticks
+  FIPC_FileStorage storage("fipc_nvs");
+  FIPC_TrajectoryCache cache(&storage);
+  CHECK( !cache.begin() ); // sin tablas guardadas
+  encoder.setCache(&cache);
+  CHECK( verify(encoder,20000,4000,8000)<=1.0 );
+  encoder.close();
+  CHECK( verify(encoder,20000,4000,8000)<=1.0 );
+  encoder.close();
+  CHECK( cache.save() );
+
+  FIPC_TrajectoryCache saved(&storage);
+  CHECK( saved.begin() );
+  encoder.setCache(&saved);
+  CHECK( verify(encoder,20000,4000,8000)<=1.0 );
+  encoder.close();
+
+  return HOST_RESULT("test_pulse_encoder");
+}
@@ -0,0 +1,85 @@
+/*! \file test_replay.cpp
+    \brief Prueba de HostReplay: una sesión grabada se reproduce en otro controlador con el exec() simulado.
+*/
+
+#include "HostTest.h"
+#include "HostReplay.h"
+
+static FIPC_API recorded; /*!< Controlador de la sesión grabada. */
+static FIPC_API replayed; /*!< Controlador de la reproducción. */
+
+static uint8_t logData[RECORDER_SIZE]; /*!< Registro de la sesión grabada. */
+
+//! Busca el cero de todos los ejes.
+static void home(HostSession &host){
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.run(1500000);
+}
+
+int main(){
+  hostSetExecCost(BUDGET_BASE_US, BUDGET_STEP_US);
+
+  // Sesión de python_emulator/example_11.py
+  HostSession session(&recorded);
+  recorded.begin();
+  home(session);
+  session.request("REC:1:");
+  session.request("SYNCRF:1000:500:0:0:0:0:");
+  session.run(500000);
+  session.request("?RA:");
+  session.request("MR:3:800:");
+  session.run(1000000);
+  session.request("S:3:");
+  session.request("SYNCRF:-500:0:0:0:0:0:");
+  session.run(1500000);
+  HostReplay recorder(&session);
+  uint16_t size = recorder.download(logData);
+  HostSummary original;
+  HostReplay::summary(logData, size, original);
+  CHECK( original.requests==5 );
+  CHECK( original.motion>1000000 );
+
+  // El archivo hexadecimal de "?RECD:" se lee igual que el registro descargado
+  FILE* file = fopen("session.hex", "w");
+  for( uint16_t offset=0; offset<size; offset+=RECORDER_CHUNK ){
+    char line[16];
+    snprintf(line, sizeof(line), "?RECD:%u:", offset);
+    fputs(recorded.request(line), file);
+  }
+  fclose(file);
+  static uint8_t loaded[RECORDER_SIZE];
+  CHECK( HostReplay::load("session.hex", loaded)==size );
+  CHECK( !memcmp(loaded, logData, size) );
+
+  // Con los tiempos originales el tiempo de movimiento es el de la sesión; cada uno de los
+  // tres desplazamientos espera hasta un período de TaskReadAction el registro de la
+  // posición (ver FIPC_Persist.h), según la fase de persist() en cada controlador
+  HostSession host(&replayed);
+  replayed.begin();
+  HostReplay replay(&host);
+  CHECK( replay.prepare(logData, size) );
+  HostSummary summary;
+  HostExecStats exec;
+  CHECK( replay.replay(logData, size, 1.0, summary, exec) );
+  CHECK( summary.requests==original.requests );
+  CHECK( summary.transitions==original.transitions );
+  CHECK( fabs((double)summary.motion-(double)original.motion)<=3.0*HOST_PERSIST_MS*1000 );
+
+  // Las estadísticas de exec() son las del ciclo simulado: base más un costo por paso
+  CHECK( exec.cycles>0 );
+  CHECK( exec.mean>=BUDGET_BASE_US );
+  CHECK( exec.max>=BUDGET_BASE_US+BUDGET_STEP_US );
+  CHECK( exec.slow==summary.slowCycles );
+
+  // Sin esperas "S:3:" llega antes de que el eje N°3 se mueva
+  CHECK( replay.prepare(logData, size) );
+  HostSummary fast;
+  CHECK( replay.replay(logData, size, 0.0, fast, exec) );
+  CHECK( fast.requests==original.requests );
+  CHECK( fast.motion<original.motion );
+
+  return HOST_RESULT("test_replay");
+}
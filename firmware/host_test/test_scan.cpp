@@ -0,0 +1,75 @@
+/*! \file test_scan.cpp
+    \brief Prueba de los disparos de FIPC_Scan: posición de cada punto y un disparo por ciclo.
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+static FIPC_API api; /*!< Controlador. */
+
+//! Campo n (desde 0) de un reporte separado por ';'.
+static long field(const char* reply, uint8_t n){
+  while( (n--)&&(reply) ){
+    reply = strchr(reply, ';');
+    if( reply ) reply++;
+  }
+  return reply ? atol(reply) : -1;
+}
+
+//! Ejecuta el barrido ciclo a ciclo y verifica cada disparo.
+/*!
+  \param start Inicio del eje rápido.
+  \param pitch Paso del eje rápido.
+  \param points Puntos por línea (serpentina de 2 líneas).
+  \param speed Velocidad del eje rápido.
+  \param maxError Error máximo de la posición del eje en el disparo (0 no verifica la posición).
+  \return Cantidad de disparos.
+*/
+static long scan(float start, float pitch, uint16_t points, float speed, float maxError){
+  char line[96];
+  snprintf(line, sizeof(line), "SCAN:1:1:2:0:%g:0:0:%g:10:0:%u:2:1:%g:SCANGO:", start, pitch, points, speed);
+  CHECK( !strcmp(api.request(line), "1\n1\n") );
+  long triggers = 0;
+  for( uint32_t cycles=0; cycles<5000000; cycles++ ){
+    hostAdvance(HOST_EXEC_US);
+    api.exec(NULL);
+    if( cycles%(HOST_PERSIST_MS*1000/HOST_EXEC_US)==0 ) api.persist(); // como TaskReadAction
+    const char* reply = api.request("?SCAN:");
+    long count = field(reply, 2);
+    CHECK( count-triggers<=1 ); // a lo sumo un disparo por ciclo
+    if( (count>triggers)&&(maxError>0.0) ){
+      // Punto de la serpentina del disparo
+      uint16_t k = (count-1)%points;
+      if( (count-1)/points ) k = points-1-k;
+      float error = fabs(atof(api.request("?P:1:"))-(start+k*pitch));
+      CHECK( error<=maxError );
+    }
+    triggers = count;
+    if( (!strncmp(reply, "Done;", 5))||(!strncmp(reply, "Aborted;", 8)) ) break;
+  }
+  return triggers;
+}
+
+int main(){
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.run(1500000);
+
+  // Paso que no es múltiplo del paso del motor (3.2 pasos/um): sin error acumulado
+  CHECK( scan(10.0, 0.7, 40, 500.0, 1.0/3.2+0.006)==80 );
+  const char* reply = api.request("?SCAN:");
+  CHECK( !strncmp(reply, "Done;2;80;0", 11) );
+
+  // Paso menor que el avance por ciclo: los puntos del mismo ciclo se informan como perdidos
+  long triggers = scan(0.0, 0.01, 30, 1000.0, 0.0);
+  reply = api.request("?SCAN:");
+  CHECK( !strncmp(reply, "Done;", 5) );
+  CHECK( field(reply, 3)>0 );
+  CHECK( triggers+field(reply, 3)==60 );
+
+  return HOST_RESULT("test_scan");
+}
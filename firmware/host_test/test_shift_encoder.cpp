@@ -0,0 +1,155 @@
+/*! \file test_shift_encoder.cpp
+    \brief Prueba de FIPC_ShiftEncoder: separación de los flancos, dirección, latencia y pasos pendientes.
+*/
+
+#include "HostTest.h"
+#include "FIPC_ShiftEncoder.h"
+#include "FIPC_ShiftOut.h"
+
+#define SAMPLE_US  (1000000UL/SHIFT_SAMPLE_RATE) /*!< Período de muestreo en us. */
+#define RUN_US     20480                         /*!< Duración de la simulación en us. */
+#define SAMPLES    (RUN_US/SAMPLE_US)            /*!< Muestras codificadas. */
+#define AXES       3                             /*!< Ejes simulados (bits 2n y 2n+1). */
+
+static uint32_t samples[SAMPLES+SHIFT_FRAME]; /*!< Muestras emitidas. */
+
+//! Flancos de un eje en las muestras.
+struct Edges
+{
+  uint32_t rises;      /*!< Flancos de subida del paso. */
+  uint32_t minPeriod;  /*!< Menor separación entre flancos de subida en muestras. */
+  uint32_t minWidth;   /*!< Menor ancho del pulso en muestras. */
+  uint32_t maxWidth;   /*!< Mayor ancho del pulso en muestras. */
+  uint32_t minSetup;   /*!< Menor demora entre el cambio de dirección y el paso siguiente en muestras. */
+  uint32_t dirInPulse; /*!< Cambios de dirección durante un pulso. */
+  uint32_t rise[64];   /*!< Muestra de los primeros flancos de subida. */
+};
+
+//! Mide los flancos del eje n.
+static Edges measure(uint8_t n, uint32_t count){
+  Edges e = {0, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0xFFFFFFFF, 0, {0}};
+  uint8_t s = 2*n, d = 2*n+1;
+  uint32_t lastRise = 0, lastTurn = 0;
+  bool turned = false;
+  for( uint32_t i=1; i<count; i++ ){
+    bool step = (samples[i]>>s)&1, stepBefore = (samples[i-1]>>s)&1;
+    bool dir = (samples[i]>>d)&1, dirBefore = (samples[i-1]>>d)&1;
+    if( dir!=dirBefore ){
+      if( step||stepBefore ) e.dirInPulse++;
+      lastTurn = i;
+      turned = true;
+    }
+    if( step&&!stepBefore ){
+      if( e.rises>0 ) e.minPeriod = min(e.minPeriod, i-lastRise);
+      if( turned ){ e.minSetup = min(e.minSetup, i-lastTurn); turned = false; }
+      if( e.rises<64 ) e.rise[e.rises] = i;
+      e.rises++;
+      lastRise = i;
+    }
+    if( !step&&stepBefore ){
+      e.minWidth = min(e.minWidth, i-lastRise);
+      e.maxWidth = max(e.maxWidth, i-lastRise);
+    }
+  }
+  return e;
+}
+
+int main(){
+  FIPC_ShiftEncoder encoder;
+  hostReset();
+  encoder.begin(SHIFT_SAMPLE_RATE, SHIFT_PULSE_SAMPLES, SHIFT_SETUP_SAMPLES, SHIFT_LATENCY_US);
+
+  // Como FIPC_ShiftOut: cada bloque se codifica al liberarse un buffer y se emite luego de los encolados.
+  // El eje 0 pide pasos a 2 kHz e invierte la dirección en el paso 10, el eje 1 a 7 kHz y el eje 2
+  // a 62,5 kHz, más rápido que el pulso y la pausa mínimos.
+  uint32_t request[64];
+  uint32_t count = 0, a0 = 0, a1 = 0, a2 = 0, n0 = 0, n1 = 0;
+  for( uint32_t now=0; now<RUN_US; now++, hostAdvance(1) ){
+    if( now%SHIFT_FRAME_US==0 ){
+      encoder.encode(&samples[count], SHIFT_FRAME, micros()+SHIFT_DMA_BUFFERS*SHIFT_FRAME_US);
+      count += SHIFT_FRAME;
+    }
+    if( now==a0 ){
+      if( n0<64 ) request[n0] = micros();
+      CHECK( encoder.step(0, 1, n0>=10, micros()) );
+      n0++;
+      a0 += 500;
+    }
+    if( now==a1 ){
+      CHECK( encoder.step(2, 3, true, micros()) );
+      if( micros()+SHIFT_LATENCY_US<SAMPLES*SAMPLE_US+SHIFT_DMA_BUFFERS*SHIFT_FRAME_US ) n1++; // emitido
+      a1 += 143;
+    }
+    if( (now==a2)&&(now<5000) ){
+      CHECK( encoder.step(4, 5, false, micros()) );
+      a2 += 16;
+    }
+  }
+
+  uint32_t steps, late, dropped;
+  encoder.getCounters(steps, late, dropped);
+  CHECK( late==0 );
+  CHECK( dropped==0 );
+
+  // Sin cambios de dirección durante los pulsos y con la demora de dirección
+  for( uint8_t n=0; n<AXES; n++ ){
+    Edges e = measure(n, count);
+    CHECK( e.minWidth==SHIFT_PULSE_SAMPLES );
+    CHECK( e.maxWidth==SHIFT_PULSE_SAMPLES );
+    CHECK( e.minPeriod>=2*SHIFT_PULSE_SAMPLES );
+    CHECK( e.dirInPulse==0 );
+    if( e.minSetup!=0xFFFFFFFF ) CHECK( e.minSetup>=SHIFT_SETUP_SAMPLES );
+  }
+
+  // Eje 0: separación pedida y latencia fija, cuantizada al período de muestreo.
+  // La muestra i se emite en i*SAMPLE_US+SHIFT_DMA_BUFFERS*SHIFT_FRAME_US.
+  Edges e0 = measure(0, count);
+  CHECK( e0.rises==n0 );
+  CHECK( e0.minPeriod==500/SAMPLE_US );
+  CHECK( e0.minSetup==SHIFT_SETUP_SAMPLES );
+  for( uint32_t k=0; (k<e0.rises)&&(k<64); k++ ){
+    uint32_t emitted = e0.rise[k]*SAMPLE_US+SHIFT_DMA_BUFFERS*SHIFT_FRAME_US;
+    CHECK( emitted-request[k]>=SHIFT_LATENCY_US );
+    CHECK( emitted-request[k]<SHIFT_LATENCY_US+SAMPLE_US );
+  }
+  CHECK( e0.rise[0]*SAMPLE_US+SHIFT_DMA_BUFFERS*SHIFT_FRAME_US==SHIFT_LATENCY_US );
+
+  // Eje 1: todos los pasos emitidos, separados 14 o 15 muestras. El primero cambia la dirección
+  // en la primera muestra libre y sale una muestra más tarde.
+  Edges e1 = measure(1, count);
+  CHECK( e1.rises==n1 );
+  CHECK( e1.rise[0]==(SHIFT_LATENCY_US-SHIFT_DMA_BUFFERS*SHIFT_FRAME_US)/SAMPLE_US+SHIFT_SETUP_SAMPLES );
+  for( uint32_t k=2; k<64; k++ ) CHECK( (e1.rise[k]-e1.rise[k-1]==14)||(e1.rise[k]-e1.rise[k-1]==15) );
+
+  // Eje 2: los pasos demorados por el pulso y la pausa mínimos no se pierden
+  Edges e2 = measure(2, count);
+  CHECK( e2.rises==(5000+15)/16 );
+  CHECK( e2.minPeriod==2*SHIFT_PULSE_SAMPLES );
+  CHECK( steps==n0+(RUN_US+142)/143+e2.rises );
+
+  // Un paso pedido para una muestra ya codificada sale en la primera libre y se cuenta atrasado
+  CHECK( encoder.step(6, 7, false, micros()-2*SHIFT_LATENCY_US) );
+  // Uno más allá del horizonte se descarta
+  CHECK( !encoder.step(8, 9, false, micros()+SHIFT_RING*SAMPLE_US) );
+  encoder.getCounters(steps, late, dropped);
+  CHECK( late==1 );
+  CHECK( dropped==1 );
+  uint32_t frame[SHIFT_FRAME];
+  encoder.encode(frame, SHIFT_FRAME, micros()+SHIFT_DMA_BUFFERS*SHIFT_FRAME_US);
+  CHECK( (frame[0]>>6)&1 );
+
+  // El bit queda pendiente hasta que se emite el flanco de bajada del último paso
+  uint32_t request10 = micros();
+  CHECK( !encoder.pending(10, request10) );
+  CHECK( encoder.step(10, 11, false, request10) );
+  CHECK( encoder.pending(10, request10) );
+  CHECK( encoder.pending(10, request10+SHIFT_LATENCY_US+(SHIFT_PULSE_SAMPLES-1)*SAMPLE_US) );
+  CHECK( !encoder.pending(10, request10+SHIFT_LATENCY_US+(SHIFT_SETUP_SAMPLES+SHIFT_PULSE_SAMPLES+1)*SAMPLE_US) );
+  CHECK( !encoder.pending(SHIFT_BITS, request10) );
+
+  // Pines fuera de la cadena o paso y dirección en la misma salida
+  CHECK( !encoder.step(SHIFT_BITS, 1, false, micros()) );
+  CHECK( !encoder.step(3, 3, false, micros()) );
+
+  return HOST_RESULT("test_shift_encoder");
+}
@@ -0,0 +1,60 @@
+/*! \file test_tracking.cpp
+    \brief Prueba de la parada y la deshabilitación de un eje que sigue una trayectoria (FIPC_Kinematics).
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+static FIPC_API api; /*!< Controlador. */
+
+//! Verifica el estado de un eje.
+static bool status(uint8_t id, const char* expected){
+  char line[16];
+  snprintf(line, sizeof(line), "?S:%u:", id);
+  const char* reply = api.request(line);
+  return !strncmp(reply, expected, strlen(expected))&&(reply[strlen(expected)]=='\n');
+}
+
+//! Inicia una rotación de la herramienta y espera que los ejes sigan la trayectoria.
+static bool rotate(HostSession &host){
+  if( !strncmp(api.request("KMR:0:0:0:0:500:0:0:0:"), "-1", 2) ) return false;
+  host.run(50000);
+  return status(1, "Tracking")&&status(2, "Tracking")&&status(3, "Tracking");
+}
+
+int main(){
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+  host.request("MA:1:5000:MA:2:5000:MA:3:5000:KP:0:0:12000:");
+  CHECK( host.run(30000000, hostIdle) );
+
+  // La parada de un eje lo detiene en el lugar y la trayectoria se aborta en todos
+  CHECK( rotate(host) );
+  host.request("S:2:");
+  host.run(HOST_EXEC_US);
+  CHECK( status(2, "Ready") );
+  CHECK( host.run(1000000, hostIdle) );
+  CHECK( !strncmp(api.request("?K:"), "Aborted;", 8) );
+
+  // "SA:" desacelera sobre la trayectoria: los ejes siguen en seguimiento hasta detenerse
+  CHECK( rotate(host) );
+  host.request("SA:");
+  host.run(HOST_EXEC_US);
+  CHECK( status(1, "Tracking")&&status(2, "Tracking")&&status(3, "Tracking") );
+  CHECK( host.run(1000000, hostIdle) );
+  CHECK( !strncmp(api.request("?K:"), "Aborted;", 8) );
+
+  // La deshabilitación detiene los ejes en el lugar, guarda la posición y los deshabilita
+  CHECK( rotate(host) );
+  host.request("D:");
+  host.run(5*HOST_EXEC_US);
+  for( uint8_t id=1; id<=AXIS_NUMBERS; id++ ) CHECK( status(id, "Disable") );
+  host.run(1000000);
+  CHECK( !strncmp(api.request("?K:"), "Aborted;", 8) );
+
+  return HOST_RESULT("test_tracking");
+}
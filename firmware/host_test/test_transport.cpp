@@ -0,0 +1,149 @@
+/*! \file test_transport.cpp
+    \brief Prueba de FIPC_TcpTransport y FIPC_Network con conexiones locales.
+*/
+
+#include "HostTest.h"
+#include "FIPC_Transport.h"
+#include "FIPC_Network.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#define WAIT_MS 1000 /*!< Espera máxima de cada operación de red en ms. */
+
+//! Abre el transporte en el primer puerto libre desde 15025.
+static uint16_t open(FIPC_Transport &transport){
+  for( uint16_t port=15025; port<15125; port++ ) if( transport.begin(port) ) return port;
+  return 0;
+}
+
+//! Conecta un cliente al puerto local.
+static int connectTo(uint16_t port){
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if( connect(fd, (struct sockaddr*)&address, sizeof(address))<0 ){
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+//! Espera una conexión entrante.
+static int8_t accept(FIPC_Transport &transport){
+  for( int i=0; i<WAIT_MS; i++ ){
+    int8_t id = transport.incoming();
+    if( id>=0 ) return id;
+    usleep(1000);
+  }
+  return -1;
+}
+
+//! Lee de una conexión hasta completar size bytes o hasta que se cierre.
+static int16_t receiveAll(FIPC_Transport &transport, uint8_t id, char* data, uint16_t size){
+  uint16_t n = 0;
+  for( int i=0; (i<WAIT_MS)&&(n<size); i++ ){
+    int16_t r = transport.receive(id, data+n, size-n);
+    if( r<0 ) return (n>0) ? n : -1;
+    n += r;
+    if( r==0 ) usleep(1000);
+  }
+  return n;
+}
+
+//! Verifica el transporte: datos en ambos sentidos, escritura sin bloqueo y cierre.
+static void testTransport(){
+  FIPC_TcpTransport transport;
+  uint16_t port = open(transport);
+  CHECK( port>0 );
+  CHECK( transport.incoming()==-1 ); // sin conexiones pendientes
+
+  int client = connectTo(port);
+  CHECK( client>=0 );
+  int8_t id = accept(transport);
+  CHECK( id==0 );
+
+  char data[64];
+  CHECK( transport.receive(id, data, sizeof(data))==0 ); // sin datos, no bloquea
+  CHECK( send(client, "?RA:\n", 5, 0)==5 );
+  CHECK( receiveAll(transport, id, data, 5)==5 );
+  CHECK( !memcmp(data, "?RA:\n", 5) );
+
+  CHECK( transport.transmit(id, "0;1\n>\n", 6)==6 );
+  CHECK( recv(client, data, 6, MSG_WAITALL)==6 );
+  CHECK( !memcmp(data, "0;1\n>\n", 6) );
+
+  // Un cliente que no lee llena el buffer de envío: transmit() retorna 0 sin bloquear
+  static char block[16384];
+  memset(block, 'x', sizeof(block));
+  bool full = false;
+  for( int i=0; (i<4096)&&(!full); i++ ) full = (transport.transmit(id, block, sizeof(block))==0);
+  CHECK( full );
+
+  // Hasta TRANSPORT_CLIENTS conexiones: la siguiente se rechaza
+  int extra[TRANSPORT_CLIENTS];
+  for( uint8_t i=1; i<TRANSPORT_CLIENTS; i++ ){
+    extra[i] = connectTo(port);
+    CHECK( accept(transport)==i );
+  }
+  int rejected = connectTo(port);
+  CHECK( accept(transport)==-1 );
+  CHECK( recv(rejected, data, sizeof(data), 0)<=0 ); // cerrada por el servidor
+  close(rejected);
+
+  // El cierre del cliente se informa con -1 y el índice queda libre
+  close(client);
+  int16_t r = 0;
+  for( int i=0; (i<WAIT_MS)&&(r>=0); i++ ){
+    r = transport.receive(id, data, sizeof(data));
+    usleep(1000);
+  }
+  CHECK( r==-1 );
+  transport.release(id);
+  CHECK( transport.receive(id, data, sizeof(data))==-1 );
+  client = connectTo(port);
+  CHECK( accept(transport)==id );
+
+  close(client);
+  for( uint8_t i=1; i<TRANSPORT_CLIENTS; i++ ) close(extra[i]);
+  for( uint8_t i=0; i<TRANSPORT_CLIENTS; i++ ) transport.release(i);
+}
+
+//! Verifica FIPC_Network: una línea de comandos recibe su respuesta terminada en ">".
+static void testNetwork(){
+  FIPC_API api;
+  api.begin();
+  FIPC_TcpTransport transport;
+  FIPC_Network network(&api, &transport);
+  uint16_t port = 0;
+  for( uint16_t p=15125; (p<15225)&&(!port); p++ ) if( network.begin(p) ) port = p;
+  CHECK( port>0 );
+
+  int client = connectTo(port);
+  CHECK( client>=0 );
+  CHECK( send(client, "?NET:\n", 6, 0)==6 );
+
+  char reply[256];
+  int n = 0;
+  for( int i=0; i<WAIT_MS; i++ ){
+    network.service();
+    int r = recv(client, reply+n, sizeof(reply)-1-n, MSG_DONTWAIT);
+    if( r>0 ) n += r;
+    reply[n] = '\0';
+    if( strstr(reply, ">\n") ) break;
+    usleep(1000);
+  }
+  CHECK( !strncmp(reply, "1;", 2) ); // una conexión
+  CHECK( strstr(reply, ">\n")!=NULL );
+  close(client);
+}
+
+int main(){
+  testTransport();
+  testNetwork();
+  return HOST_RESULT("test_transport");
+}
@@ -0,0 +1,27 @@
+/*! \file test_tune.cpp
+    \brief Prueba de FIPC_Tune con el switch simulado: la caracterización no se inicia (con el switch real ver test_tune_stall.cpp).
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+static FIPC_API api; /*!< Controlador. */
+
+int main(){
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("HA:");
+  CHECK( host.run(30000000, hostIdle) );
+
+  // El switch simulado no detecta pasos perdidos: no hay límites que medir ni guardar
+  CHECK( HOMING_SIMULATED );
+  CHECK( !strcmp(api.request("TUNE:1:5000:3:2:"), "0\n") );
+  CHECK( !strncmp(api.request("?TUNE:"), "Idle;", 5) );
+  host.run(1000000);
+  CHECK( !strncmp(api.request("?CFG:"), "0;", 2) );
+  CHECK( hostIdle(&api) );
+
+  return HOST_RESULT("test_tune");
+}
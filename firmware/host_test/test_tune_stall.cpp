@@ -0,0 +1,80 @@
+/*! \file test_tune_stall.cpp
+    \brief Prueba de FIPC_Tune con el switch real y un motor que pierde pasos (ver HostMotor.h).
+
+    Se compila con HOMING_SIMULATED en 0 (SWITCH_TESTS del Makefile).
+*/
+
+#include "HostTest.h"
+#include "HostSession.h"
+
+#define STEPS_PER_UM 3.2     /*!< Pasos por um del eje N°1 (MOX_02_30). */
+#define VELO_STALL   2000.0  /*!< Velocidad a partir de la cual el motor pierde pasos en um/s. */
+#define ACCEL_STALL  15000.0 /*!< Aceleración a partir de la cual el motor pierde pasos en um/s^2. */
+#define RATE_START   1200.0  /*!< Frecuencia de arranque del motor en pasos/s. */
+#define SWITCH_UM    -500.0  /*!< Posición inicial del switch de referencia en um. */
+#define DISTANCE     3000.0  /*!< Distancia de los ensayos en um. */
+#define ACCEL_CONFIG 7500.0  /*!< Aceleración máxima configurada del eje N°1 en um/s^2. */
+
+static FIPC_API api; /*!< Controlador. */
+
+//! Verifica que la caracterización terminó.
+static bool tuneDone(FIPC_API* pApi){ return strncmp(pApi->request("?TUNE:"), "Done;", 5)==0; }
+
+int main(){
+  CHECK( !HOMING_SIMULATED );
+  HostMotor motor(STEP_01, SW2_01, lroundf(SWITCH_UM*STEPS_PER_UM), VELO_STALL*STEPS_PER_UM, ACCEL_STALL*STEPS_PER_UM, RATE_START);
+  HostSession host(&api);
+  api.begin();
+  host.request("E:");
+  host.run(100000);
+  host.request("H:1:");
+  CHECK( host.run(30000000, hostIdle) );
+  CHECK( !strcmp(host.request("?S:1:"), "Ready\n") );
+  host.request("MA:1:100:");
+  CHECK( host.run(30000000, hostIdle) );
+  CHECK( motor.getLost()==0 );
+
+  // Velocidad y luego aceleración por búsqueda binaria, con TUNE_SAFETY de margen
+  CHECK( !strcmp(host.request("TUNE:1:3000:1:2:"), "1\n") );
+  CHECK( host.run(600000000, tuneDone) );
+  char report[64];
+  strncpy(report, host.request("?TUNE:"), sizeof(report)-1);
+  float velo = 0.0, accel = 0.0;
+  CHECK( sscanf(report, "Done;1;%*u;%f;%f;", &velo, &accel)==2 );
+  CHECK( motor.getLost()>0 ); // los ensayos por encima de los límites perdieron pasos
+
+  // Los límites quedan por debajo del umbral, a menos de un intervalo de la búsqueda
+  float veloHigh = sqrt(TUNE_ACCEL_SAFE*ACCEL_CONFIG*DISTANCE*(1.0-TUNE_CRUISE));
+  float accelHigh = TUNE_ACCEL_RANGE*ACCEL_CONFIG;
+  CHECK( velo<=TUNE_SAFETY*VELO_STALL );
+  CHECK( velo>=TUNE_SAFETY*(VELO_STALL-veloHigh/(1<<TUNE_ITERATIONS)) );
+  CHECK( accel<=TUNE_SAFETY*ACCEL_STALL );
+  CHECK( accel>=TUNE_SAFETY*(ACCEL_STALL-accelHigh/(1<<TUNE_ITERATIONS)) );
+
+  // Los límites se guardan con FIPC_Config::setLimits() desde persist()
+  host.run(2*HOST_PERSIST_MS*1000);
+  CHECK( !strncmp(host.request("?CFG:"), "1;", 2) );
+  static FIPC_Config::ConfigBlob blob;
+  const char* hex = host.request("?CFGD:");
+  uint8_t* data = (uint8_t*)&blob;
+  for( size_t i=0; i<sizeof(blob); i++ ){
+    unsigned int value = 0;
+    sscanf(&hex[2*i], "%2x", &value);
+    data[i] = value;
+  }
+  CHECK( fabs(blob.axis[0].veloMax-velo)<=0.01 );
+  CHECK( fabs(blob.axis[0].accelMax-accel)<=0.01 );
+
+  // Un desplazamiento cerca de los límites resultantes no pierde pasos
+  long lost = motor.getLost();
+  float speed = 0.99*velo;
+  char line[64];
+  snprintf(line, sizeof(line), "V:1:%.2f:A:1:%.4f:MA:1:%.0f:", speed, speed/accel, DISTANCE);
+  host.request(line);
+  CHECK( fabs(atof(host.request("?V:1:"))-speed)<=0.01 );
+  CHECK( host.run(30000000, hostIdle) );
+  CHECK( fabs(atof(host.request("?P:1:"))-DISTANCE)<=1.0/STEPS_PER_UM );
+  CHECK( motor.getLost()==lost );
+
+  return HOST_RESULT("test_tune_stall");
+}
@@ -7,9 +7,18 @@ Created on Wed Dec 23 20:18:37 2020
 
 import threading
 import time
+import math
+import random
+import json
+import os
+import struct
+import socket
+import queue
     
 class FIPC_Controler:
-    def __init__(self):
+    def __init__(self, storage = None, line = None):
+        # storage: prefijo de los archivos que reemplazan la NVS (None sin persistencia)
+        # line: linea de disparo compartida con otros emuladores (FIPC_SyncLine, "LINK:")
         self.__axis = []
         self.__axis.append(_Axis(1,"MOX_02_30"))
         self.__axis.append(_Axis(2,"MOX_02_30"))
@@ -17,9 +26,52 @@ class FIPC_Controler:
         self.__axis.append(_Axis(4,"MOR_100_30"))
         self.__axis.append(_Axis(5,"MOG_65_10"))
         self.__axis.append(_Axis(6,"MOG_65_15"))
-        self.__number_max_of_command = 16
+        self.__number_max_of_command = 32
         self.__axis_number = 6
         self.__print = False
+        self.__scan = None
+        self.__scan_status = "Idle"
+        self.__scan_index = 0
+        self.__scan_triggers = []
+        self.__scan_missed = 0
+        self.__scan_stop = threading.Event()
+        self.__events = []
+        self.__coupling = _GaussianCoupling()
+        self.__align = None
+        self.__align_samples = 8
+        self.__kin = _Kinematics(self.__axis, self.__events)
+        self.__lock = threading.RLock()
+        self.__inputs = {}
+        self.__storage = _FileStorage(storage) if storage else None
+        self.__network = None
+        self.__recorder = _Recorder(self.__axis)
+        self.__latency = _Latency()
+        self.__budget = _Budget(self.__axis, self.__storage, self.__events)
+        self.__published = ""
+        self.__boot = time.monotonic()
+        self.__line = line
+        self.__linkRole = 0
+        self.__holding = False
+        self.__held = []
+        self.__edges = 0
+        self.__edgeTime = 0
+        # configuracion por defecto (GPIO de FIPC_pinTable.h), reemplazada por la guardada
+        pins = [(15,0,4,16), (18,19,17,5), (23,13,21,22), (33,32,36,36), (26,25,34,39), (12,27,14,35)]
+        defaults = []
+        for ii in range(self.__axis_number):
+            config = dict(_PRESETS[self.__axis[ii].getType()])
+            config["pinStep"], config["pinDir"], config["pinPositive"], config["pinNegative"] = pins[ii]
+            config["pinEnable"] = 2
+            config["pinRef"] = config["pinNegative"]
+            defaults.append(config)
+        self.__config = _Config(defaults, self.__storage)
+        self.__tune = _Tune(self.__events, self.__config.setLimits)
+        self.__applyConfig()
+        for ii in range(self.__axis_number):
+            self.__axis[ii].setStorage(self.__storage)
+            self.__axis[ii].setLatency(self.__latency)
+        self.__program = _Program(self.sendData, self.__axis, self.__isIdle, self.__moveSync,
+                                  self.__moveAxis, self.__readInput, self.__storage, self.__events)
 
     def setPrintInfo(self, iPrint = True):        
         self.__print = iPrint
@@ -27,11 +79,84 @@ class FIPC_Controler:
             self.__axis[ii].setPrintInfo(iPrint)
         
     def sendData(self, text):
+        # el programa almacenado envia sus comandos por la misma via (semaforo del puerto serie)
+        self.__latency.probe(_Latency.BYTE)
+        with self.__lock:
+            self.__latency.probe(_Latency.LINE)
+            return self.__request(text)
+
+    def serve(self, port = 5025):
+        # punto de acceso por red con el protocolo de FIPC_Network (ver python_lib/module_network.py)
+        # sin la demora del puerto serie: la latencia es la de la conexion
+        self.__network = _Network(self.__networkRequest, self.__telemetry, self.__pollEvents, port, self.__clock, self.__latency)
+        return self.__network.port
+
+    def __networkRequest(self, text):
+        with self.__lock:
+            return self.__request(text, 0.0)
+
+    def __clock(self):
+        # reloj del controlador en segundos desde el inicio (micros() y millis() del firmware)
+        return time.monotonic() - self.__boot
+
+    def __edge(self, t):
+        # flanco de la linea de disparo: libera las acciones retenidas, equivalente a FIPC_Sync::exec()
+        with self.__lock:
+            self.__edges += 1
+            self.__edgeTime = int((t - self.__boot)*1e6) & 0xFFFFFFFF
+            held = self.__held
+            self.__held = []
+            self.__holding = False
+            for ii, iAction, iData, iSpeed in held:
+                self.__axis[ii].setAction(iAction, iData, iSpeed)
+
+    def __setAction(self, ii, iAction, iData = 0.0, iSpeed = 0.0):
+        # con "LINKARM:" la accion queda retenida hasta el disparo
+        if self.__holding:
+            self.__held.append((ii, iAction, iData, iSpeed))
+            return True
+        return self.__axis[ii].setAction(iAction, iData, iSpeed)
+
+    def __cancelHold(self):
+        self.__holding = False
+        self.__held = []
+
+    def __setLink(self, role, pin):
+        self.__cancelHold()
+        if self.__line:
+            self.__line.detach(self.__edge)
+        self.__linkRole = role if role in (1, 2) and self.__line else 0
+        if self.__linkRole:
+            self.__line.attach(self.__edge)
+
+    def __getLinkReport(self):
+        held = "1" if self.__held else "0"
+        return "%d;%s;%s;%d;%d" % (self.__linkRole, held, held, self.__edges, self.__edgeTime)
+
+    def __telemetry(self):
+        moving = 0
+        for ii in range(self.__axis_number):
+            if self.__axis[ii].isMoving()=="1":
+                moving |= 1 << ii
+        return ";".join(["%.2f" % float(self.__axis[ii].getCurrentPosition()) for ii in range(self.__axis_number)]) + ";%d" % moving
+
+    def __pollEvents(self):
+        # los eventos se envian a las conexiones y quedan pendientes para readEvents()
+        with self.__lock:
+            out = ""
+            while len(self.__events):
+                out += self.__events.pop(0)
+            self.__published += out
+            return out
+
+    def __request(self, text, delay = 0.1):
         if self.__print:
             print("** Read commands (INIT) **")
+        self.__recorder.request(text)
         out = "";
         self.__command = []
         count = self.__getCommands(text)
+        self.__latency.probe(_Latency.PARSE)
         for ii in range(count):
             try:
                 if self.__command[ii]=="?RA":
@@ -54,6 +179,93 @@ class FIPC_Controler:
                 elif self.__command[ii]=="?S":
                     ii += 1
                     out += self.__axis[int(self.__command[ii])-1].getStatus()                    
+                elif self.__command[ii]=="?TR":
+                    ii += 2
+                    out += self.__estimateMoveRelative(int(self.__command[ii-1]),float(self.__command[ii])) + "\n"
+                elif self.__command[ii]=="?TA":
+                    ii += 2
+                    id = int(self.__command[ii-1])
+                    iRelative = float(self.__command[ii])-float(self.__axis[id-1].getCurrentPosition())
+                    out += self.__estimateMoveRelative(id,iRelative) + "\n"
+                elif self.__command[ii]=="?TB":
+                    ii += 2
+                    id = int(self.__command[ii-1])
+                    current = float(self.__axis[id-1].getCurrentPosition())
+                    for jj in range(int(self.__command[ii])):
+                        ii += 1
+                        out += self.__estimateMoveRelative(id,float(self.__command[ii])-current) + "\n"
+                elif self.__command[ii]=="?TS":
+                    iDist = []
+                    for jj in range(self.__axis_number):
+                        ii += 1
+                        iDist.append(float(self.__command[ii]))
+                    ii += 2
+                    out += self.__estimateSyncMotionRel(iDist, float(self.__command[ii-1]), float(self.__command[ii])) + "\n"
+                elif self.__command[ii]=="?SCAN":
+                    out += self.__getScanReport() + "\n"
+                elif self.__command[ii]=="SCANT":
+                    ii += 2
+                elif self.__command[ii]=="SCAN":
+                    ii += 1
+                    iType = int(self.__command[ii])
+                    iValues = []
+                    for jj in range(13):
+                        ii += 1
+                        iValues.append(float(self.__command[ii]))
+                    out += ("1" if self.__setScan(iType, iValues) else "0") + "\n"
+                elif self.__command[ii]=="SCANGO":
+                    out += ("1" if self.__startScan() else "0") + "\n"
+                elif self.__command[ii]=="SCANSTOP":
+                    self.__scan_stop.set()
+                elif self.__command[ii]=="?ALIGN":
+                    out += (self.__align.getReport() if self.__align else "Idle;0;0.00") + "\n"
+                elif self.__command[ii]=="ALIGNADC":
+                    ii += 2
+                    self.__align_samples = int(self.__command[ii])
+                elif self.__command[ii]=="ALIGNSTOP":
+                    if self.__align:
+                        self.__align.stop()
+                elif self.__command[ii]=="ALIGN":
+                    iValues = []
+                    for jj in range(8):
+                        ii += 1
+                        iValues.append(float(self.__command[ii]))
+                    out += ("1" if self.__startAlign(iValues) else "0") + "\n"
+                elif self.__command[ii]=="?TUNE":
+                    out += self.__tune.getReport() + "\n"
+                elif self.__command[ii]=="TUNESTOP":
+                    self.__tune.stop()
+                elif self.__command[ii]=="TUNE":
+                    ii += 4
+                    id = int(self.__command[ii-3])
+                    ok = 0<id<=self.__axis_number and self.__tune.start(id, self.__axis[id-1], float(self.__command[ii-2]),
+                                                                         int(self.__command[ii-1]), float(self.__command[ii]))
+                    out += ("1" if ok else "0") + "\n"
+                elif self.__command[ii]=="?PSO":
+                    ii += 1
+                    out += self.__axis[int(self.__command[ii])-1].pso.getReport() + "\n"
+                elif self.__command[ii]=="PSOP":
+                    ii += 3
+                    self.__axis[int(self.__command[ii-2])-1].pso.setOutput(int(self.__command[ii-1]), int(self.__command[ii]))
+                elif self.__command[ii]=="PSOX":
+                    ii += 1
+                    self.__axis[int(self.__command[ii])-1].pso.disarm()
+                elif self.__command[ii]=="PSO":
+                    ii += 4
+                    axis = self.__axis[int(self.__command[ii-3])-1]
+                    factor = axis.getStepsPerUnit()
+                    ok = axis.pso.armPitch(float(self.__command[ii-2])*factor, float(self.__command[ii-1])*factor, int(self.__command[ii]))
+                    out += ("1" if ok else "0") + "\n"
+                elif self.__command[ii]=="PSOT":
+                    ii += 2
+                    axis = self.__axis[int(self.__command[ii-1])-1]
+                    axis.pso.disarm()
+                    ok = True
+                    for jj in range(int(self.__command[ii])):
+                        ii += 1
+                        ok = ok and axis.pso.addTable(int(round(float(self.__command[ii])*axis.getStepsPerUnit())))
+                    ok = ok and axis.pso.armTable()
+                    out += ("1" if ok else "0") + "\n"
                 elif self.__command[ii]=="E":
                     self.__requestAction("ENABLE")
                 elif self.__command[ii]=="D":
@@ -61,7 +273,114 @@ class FIPC_Controler:
                 elif self.__command[ii]=="HA":
                     self.__requestAction("HOMING")
                 elif self.__command[ii]=="SA":
+                    self.__program.stop()
+                    self.__scan_stop.set()
+                    if self.__align:
+                        self.__align.stop()
+                    self.__kin.stop()
+                    self.__tune.stop()
                     self.__requestAction("STOP")
+                elif self.__command[ii]=="HRA":
+                    self.__requestAction("RESTORE")
+                elif self.__command[ii]=="HR":
+                    ii += 1
+                    self.__requestAction("RESTORE",int(self.__command[ii]))
+                elif self.__command[ii]=="?NV":
+                    ii += 1
+                    out += self.__axis[int(self.__command[ii])-1].getStoredReport() + "\n"
+                elif self.__command[ii]=="?MEM":
+                    # sin heap ni pilas que supervisar: heap, mínimo y las 5 tareas en 0
+                    out += "0;0;0;0;0;0;0\n"
+                elif self.__command[ii]=="REC":
+                    ii += 1
+                    if int(self.__command[ii]):
+                        self.__recorder.start()
+                    else:
+                        self.__recorder.stop()
+                elif self.__command[ii]=="?REC":
+                    out += self.__recorder.getReport() + "\n"
+                elif self.__command[ii]=="?RECD":
+                    ii += 1
+                    out += self.__recorder.getData(int(self.__command[ii])) + "\n"
+                elif self.__command[ii]=="LINK":
+                    ii += 2
+                    self.__setLink(int(self.__command[ii-1]), int(self.__command[ii]))
+                elif self.__command[ii]=="LINKARM":
+                    self.__holding = self.__linkRole!=0
+                elif self.__command[ii]=="LINKGO":
+                    if self.__linkRole==1:
+                        self.__line.fire()
+                elif self.__command[ii]=="LINKX":
+                    self.__cancelHold()
+                elif self.__command[ii]=="?LINK":
+                    out += self.__getLinkReport() + "\n"
+                elif self.__command[ii]=="?CLK":
+                    out += "%d\n" % (int(self.__clock()*1e6) & 0xFFFFFFFF)
+                elif self.__command[ii]=="?TCACHE":
+                    # sin pulsos del periferico RMT no hay rampas que guardar: tablas vacias de 8192 bytes
+                    out += "0;0;8192;0;0;0\n"
+                elif self.__command[ii]=="TCACHE":
+                    ii += 1
+                    out += "1\n"
+                elif self.__command[ii]=="?LAT":
+                    ii += 1
+                    out += self.__latency.getReport(int(self.__command[ii])) + "\n"
+                elif self.__command[ii]=="?LATH":
+                    ii += 1
+                    out += self.__latency.getHistogram(int(self.__command[ii])) + "\n"
+                elif self.__command[ii]=="LATX":
+                    self.__latency.clear()
+                elif self.__command[ii]=="BUDGET":
+                    ii += 1
+                    self.__budget.setMode(int(self.__command[ii]))
+                elif self.__command[ii]=="BUDGETCAL":
+                    ii += 1
+                    out += ("1" if self.__budget.calibrate(int(self.__command[ii])) else "0") + "\n"
+                elif self.__command[ii]=="?BUDGET":
+                    out += self.__budget.getReport() + "\n"
+                elif self.__command[ii]=="?SHIFT":
+                    # firmware compilado sin SHIFT_ENABLED: los 6 ejes emiten por GPIO
+                    out += "0;32;100000;0;0;0\n"
+                elif self.__command[ii]=="?CFG":
+                    out += self.__config.getReport() + "\n"
+                elif self.__command[ii]=="?CFGD":
+                    out += self.__config.getBlob() + "\n"
+                elif self.__command[ii]=="CFGW":
+                    ii += 2
+                    ok = self.__config.upload(int(self.__command[ii-1]), self.__command[ii])
+                    out += ("1" if ok else "0") + "\n"
+                elif self.__command[ii]=="CFGC":
+                    out += ("1" if self.__commitConfig() else "0") + "\n"
+                elif self.__command[ii]=="?PRG":
+                    out += self.__program.getReport() + "\n"
+                elif self.__command[ii]=="?PRGV":
+                    ii += 1
+                    out += self.__program.getVariable(int(self.__command[ii])) + "\n"
+                elif self.__command[ii]=="PRGW":
+                    ii += 2
+                    ok = self.__program.upload(int(self.__command[ii-1]), self.__command[ii])
+                    out += ("1" if ok else "0") + "\n"
+                elif self.__command[ii]=="PRGC":
+                    out += ("1" if self.__program.commit() else "0") + "\n"
+                elif self.__command[ii]=="PRGRUN":
+                    out += ("1" if self.__program.start() else "0") + "\n"
+                elif self.__command[ii]=="PRGSTOP":
+                    self.__program.stop()
+                elif self.__command[ii]=="?K":
+                    out += self.__kin.getReport() + "\n"
+                elif self.__command[ii]=="KP":
+                    ii += 3
+                    pivot = [float(self.__command[ii-2+jj]) for jj in range(3)]
+                    out += ("1" if self.__kin.setPivot(pivot) else "0") + "\n"
+                elif self.__command[ii] in ("KMA", "KMR"):
+                    absolute = self.__command[ii]=="KMA"
+                    ii += 8
+                    pose = [float(self.__command[ii-7+jj]) for jj in range(6)]
+                    iTimeSpeed, iAccelTime = float(self.__command[ii-1]), float(self.__command[ii])
+                    if absolute:
+                        out += "%.3f\n" % self.__kin.moveAbsolute(pose, iTimeSpeed, iAccelTime)
+                    else:
+                        out += "%.3f\n" % self.__kin.moveRelative(pose, iTimeSpeed, iAccelTime)
                 elif self.__command[ii]=="H":
                     ii += 1
                     self.__requestAction("HOMING",int(self.__command[ii]))
@@ -80,6 +399,23 @@ class FIPC_Controler:
                 elif self.__command[ii]=="MA":
                     ii += 2
                     self.__requestAction("MOVE_ABSOLUTE",int(self.__command[ii-1]),float(self.__command[ii]))
+                elif self.__command[ii]=="JOG":
+                    ii += 2
+                    self.__requestAction("JOG",int(self.__command[ii-1]),float(self.__command[ii]))
+                elif self.__command[ii]=="JOGA":
+                    speed = []
+                    for jj in range(self.__axis_number):
+                        ii += 1
+                        speed.append(float(self.__command[ii]))
+                    rate = [self.__axis[jj].getExecRate("JOG", speed[jj]) if speed[jj] else None for jj in range(self.__axis_number)]
+                    admitted, scale = self.__budget.admit(rate)
+                    if admitted:
+                        for jj in range(self.__axis_number):
+                            self.__setAction(jj,"JOG",speed[jj]*scale)
+                elif self.__command[ii]=="JOGT":
+                    ii += 1
+                    for jj in range(self.__axis_number):
+                        self.__axis[jj].setJogTimeout(int(self.__command[ii]))
                 elif self.__command[ii]=="SYNCR":
                     iDist = []
                     for jj in range(self.__axis_number):
@@ -94,19 +430,267 @@ class FIPC_Controler:
                         iAbsolute.append(float(self.__command[ii]))
                     ii += 2
                     self.__syncMotionAbs(iAbsolute, float(self.__command[ii-1]), float(self.__command[ii]))
+                elif self.__command[ii]=="SYNCRF":
+                    iDist = []
+                    for jj in range(self.__axis_number):
+                        ii += 1
+                        iDist.append(float(self.__command[ii]))
+                    out += "%.3f\n" % self.__syncMotionRelFast(iDist)
+                elif self.__command[ii]=="SYNCAF":
+                    iAbsolute = []
+                    for jj in range(self.__axis_number):
+                        ii += 1
+                        iAbsolute.append(float(self.__command[ii]))
+                    out += "%.3f\n" % self.__syncMotionAbsFast(iAbsolute)
             except:
                 print("Error en el comando")
+                self.__latency.end()
                 return "Error"            
-        time.sleep(0.1) 
+        self.__latency.end()
+        time.sleep(delay) 
         if self.__print:
             print("** Read commands (END) **\n")                
             
         return out
     
+    def readEvents(self):
+        # eventos asincronicos (ej. fin de barrido), equivalente a FIPC_API::getEvents()
+        with self.__lock:
+            out = self.__published
+            self.__published = ""
+            while len(self.__events):
+                out += self.__events.pop(0)
+            return out
+
+    def setInput(self, pin, level):
+        # nivel de una GPIO de entrada leida por la instruccion trigger de los programas (1 por defecto)
+        self.__inputs[pin] = 1 if level else 0
+
+    def __readInput(self, pin):
+        return self.__inputs.get(pin, 1)
+
+    def __isIdle(self, mask):
+        # equivalente a FIPC_API::isIdle()
+        for ii in range(self.__axis_number):
+            if mask & (1 << ii) and self.__axis[ii].getStatus() not in ("Disable", "NoHome", "Ready"):
+                return False
+        if self.__scan_status=="Moving" or (self.__align and self.__align.isRunning()) or self.__kin.isRunning() or self.__tune.isRunning():
+            return False
+        return True
+
+    def __moveSync(self, iAbsolute, iTimeSpeed, iAccelTime):
+        # equivalente a FIPC_API::moveSync()
+        if iTimeSpeed<=0.0:
+            return self.__syncMotionAbsFast(iAbsolute)
+        if not self.__syncMotionAbs(iAbsolute, iTimeSpeed, iAccelTime):
+            return -1.0
+        return iTimeSpeed+iAccelTime
+
+    def __moveAxis(self, id, iAbsolute, iData):
+        # equivalente a FIPC_API::moveAxis()
+        return self.__requestAction("MOVE_ABSOLUTE" if iAbsolute else "MOVE_RELATIVE", id, iData)
+
+    def getScanTriggers(self):
+        # posiciones (A, B, C) en las que se emitio cada disparo del ultimo barrido
+        return list(self.__scan_triggers)
+
+    def setCouplingModel(self, center, waist, peak = 1000.0, noise = 0.0):
+        # modelo sintetico gaussiano de acoplamiento que reemplaza la entrada analogica
+        self.__coupling = _GaussianCoupling(center, waist, peak, noise)
+
+    def setStallModel(self, id, velocity = None, accel = None):
+        # perdida de pasos del eje #id por encima de la velocidad o la aceleracion dadas (None
+        # sin perdida), la mide la caracterizacion con "TUNE:"
+        self.__axis[id-1].setStall(velocity, accel)
+
+    def getAlignMotionTime(self):
+        # tiempo de desplazamiento simulado de la ultima alineacion en segundos
+        return self.__align.motionTime if self.__align else 0.0
+
+    def getPSOTiming(self, id, iRelative, tick = 25e-6):
+        # instantes ideal y de disparo [s] de cada posicion programada para un desplazamiento relativo.
+        # El disparo ocurre en el ciclo de exec() en que se emite el paso que alcanza la posicion.
+        axis = self.__axis[id-1]
+        factor = axis.getStepsPerUnit()
+        origin = float(axis.getCurrentPosition())
+        out = []
+        for ideal, step in axis.pso.getTargets():
+            if (step/factor-origin)*iRelative<=0.0:
+                continue
+            tIdeal = axis.timeAtDistance(abs(iRelative), abs(ideal/factor-origin))
+            tStep = axis.timeAtDistance(abs(iRelative), abs(step/factor-origin))
+            out.append([tIdeal, math.ceil(tStep/tick)*tick])
+        return out
+
+    def __readPower(self):
+        positions = [float(axis.getCurrentPosition()) for axis in self.__axis]
+        return self.__coupling.read(positions)
+
+    def __startAlign(self, iValues):
+        if self.__align and self.__align.isRunning():
+            return False
+        iType = int(iValues[0])
+        ids = []
+        for v in iValues[1:4]:
+            if int(v)==0:
+                break
+            ids.append(int(v))
+        step, minStep, maxEval, threshold = iValues[4], iValues[5], int(iValues[6]), iValues[7]
+        if iType>2 or step<=0.0 or minStep<=0.0 or maxEval<=0 or len(ids)==0 or len(set(ids))!=len(ids):
+            return False
+        if iType==1 and len(ids)<2:
+            return False
+        for id in ids:
+            if id>self.__axis_number or self.__axis[id-1].getStatus()!="Ready":
+                return False
+        axis = [self.__axis[id-1] for id in ids]
+        self.__align = _Align(iType, axis, step, minStep, maxEval, threshold,
+                              self.__readPower, self.__align_samples, self.__events)
+        self.__align.start()
+        return True
+
+    def __setScan(self, iType, iValues):
+        if self.__scan_status in ("Moving", "Line") or iType>2:
+            return False
+        ids = [int(v) for v in iValues[0:3]]
+        points = [int(v) for v in iValues[9:12]]
+        speed = iValues[12]
+        if speed<=0.0:
+            return False
+        for jj in range(3):
+            if jj==2 and ids[jj]==0:
+                points[jj] = 1
+                continue
+            if ids[jj]<1 or ids[jj]>self.__axis_number or points[jj]<1 or ids[jj] in ids[0:jj]:
+                return False
+        self.__scan = {"type":iType, "id":ids, "start":iValues[3:6], "pitch":iValues[6:9],
+                       "points":points, "speed":speed}
+        self.__scan_status = "Idle"
+        return True
+
+    def __getScanPoints(self):
+        # misma secuencia de puntos que FIPC_Scan en el firmware
+        sc = self.__scan
+        start, pitch, points = sc["start"], sc["pitch"], sc["points"]
+        out = []
+        if sc["type"]==2:
+            for cc in range(points[2]):
+                theta = 0.0
+                for kk in range(points[0]):
+                    radius = abs(pitch[0])*theta/(2.0*math.pi)
+                    out.append([start[0]+radius*math.cos(theta), start[1]+radius*math.sin(theta),
+                                start[2]+cc*pitch[2]])
+                    theta += abs(pitch[1])/max(radius, abs(pitch[1]))
+        else:
+            line = 0
+            for cc in range(points[2]):
+                for bb in range(points[1]):
+                    aa_range = range(points[0])
+                    if sc["type"]==1 and line%2:
+                        aa_range = reversed(aa_range)
+                    for aa in aa_range:
+                        out.append([start[0]+aa*pitch[0], start[1]+bb*pitch[1], start[2]+cc*pitch[2]])
+                    line += 1
+        return out
+
+    def __startScan(self):
+        if self.__scan is None or self.__scan_status in ("Moving", "Line"):
+            return False
+        axis = [self.__axis[ii-1] if ii else None for ii in self.__scan["id"]]
+        points = self.__getScanPoints()
+        for pp in points:
+            for jj in range(3):
+                if axis[jj] and not axis[jj].canMoveAbsolute(pp[jj]):
+                    return False
+        if not axis[0].setSpeed(self.__scan["speed"]):
+            return False
+        self.__scan_stop.clear()
+        self.__scan_triggers = []
+        self.__scan_missed = 0
+        self.__scan_index = 0
+        self.__scan_status = "Moving"
+        threading.Thread(target=self.__runScan, args=(axis, points)).start()
+        return True
+
+    def __runScan(self, axis, points, tick = 25e-6):
+        # misma secuencia que FIPC_Scan::exec(): en los barridos por lineas el eje A recorre la
+        # linea sin detenerse y cada disparo registra la posicion en pasos del eje en el ciclo
+        # de exec() (periodo tick [s]) en que alcanza el punto
+        sc = self.__scan
+        size = 1 if sc["type"]==2 else sc["points"][0]
+        for ll in range(0, len(points), size):
+            if self.__scan_stop.is_set():
+                self.__scan_status = "Aborted"
+                break
+            line = points[ll:ll+size]
+            dt = 0.0
+            for jj in range(3):
+                if axis[jj]:
+                    dt = max(dt, axis[jj].jumpTo(line[0][jj]))
+            time.sleep(dt)
+            current = [float(axis[jj].getCurrentPosition()) if axis[jj] else 0.0 for jj in range(3)]
+            self.__scan_triggers.append(current)
+            if size>1:
+                triggers, missed, dt = axis[0].lineTriggers([pp[0] for pp in line], tick)
+                self.__scan_triggers += [[aa] + current[1:] for aa in triggers]
+                self.__scan_missed += missed
+                time.sleep(dt)
+            # linea (barrido por lineas) o punto (espiral) en ejecucion, como en el firmware
+            self.__scan_index = ll//size + 1
+        if self.__scan_status!="Aborted":
+            self.__scan_status = "Done"
+        self.__events.append("SCAN:" + self.__getScanReport() + "\n")
+
+    def __getScanReport(self):
+        return (self.__scan_status + ";" + str(self.__scan_index) + ";" + str(len(self.__scan_triggers)) +
+                ";" + str(self.__scan_missed))
+
     def __requestAction(self, iAction="NOTHING", id = -1, iData = 0.0):
+        if iAction in ("STOP", "DISABLE"):
+            # la parada y la deshabilitacion no se retienen, equivalente a FIPC_Axis::armAction()
+            self.__cancelHold()
+        # presupuesto de pasos de la accion de un eje o de todos ("HA:" busca el cero en todos);
+        # la busqueda del cero y el seguimiento no se estiran
+        scale, move = 1.0, iAction in ("MOVE_RELATIVE", "MOVE_ABSOLUTE")
+        rate = [None]*self.__axis_number
         for ii in range(self.__axis_number):
             if id==ii+1 or id==-1:
-                self.__axis[ii].setAction(iAction,iData)
+                r = self.__axis[ii].getExecRate(iAction, iData)
+                rate[ii] = r if r>0.0 else None
+        if any(r is not None for r in rate):
+            admitted, scale = self.__budget.admit(rate, move or iAction=="JOG")
+            if not admitted:
+                return False
+        if scale<1.0 and iAction=="JOG":
+            # la velocidad reducida es solo de esta accion, como en FIPC_API::requestAction()
+            iData *= scale
+        accepted = False
+        for ii in range(self.__axis_number):
+            if id==ii+1 or id==-1:
+                # "SA:" desacelera la herramienta sobre la trayectoria (_Kinematics.stop())
+                if id==-1 and iAction=="STOP" and self.__axis[ii].getStatus()=="Tracking":
+                    continue
+                speed = float(self.__axis[ii].getSpeed())*scale if (move and scale<1.0) else 0.0
+                if self.__setAction(ii,iAction,iData,speed):
+                    accepted = True
+        return accepted
+
+    def __applyConfig(self):
+        axes = self.__config.getAxes()
+        for ii in range(self.__axis_number):
+            self.__axis[ii].setConfig(axes[ii])
+
+    def __commitConfig(self):
+        # solo con todos los ejes deshabilitados, equivalente a FIPC_API::commitConfig()
+        for ii in range(self.__axis_number):
+            if self.__axis[ii].getStatus()!="Disable":
+                return False
+        if not self.__config.commit():
+            return False
+        self.__applyConfig()
+        for ii in range(self.__axis_number):
+            self.__axis[ii].setStorage(self.__storage)
+        return True
 
     def __setSpeed(self, id = -1, iData = 0.0):
         for ii in range(self.__axis_number):
@@ -129,6 +713,25 @@ class FIPC_Controler:
                 break;
         return count
 
+    def __estimateMoveRelative(self, id, iRelative):
+        feasible, oTime, oPeak = self.__axis[id-1].estimateMoveRelative(iRelative)
+        return "%d;%.2f;%.2f" % (feasible, oTime, oPeak)
+
+    def __estimateSyncMotionRel(self, iDist, iTimeSpeed, iAccelTime):
+        if iTimeSpeed<=0.0 or iAccelTime<=0.0:
+            return "0;0.00"
+        feasible = True
+        duration = 0.0
+        peaks = ""
+        for ii in range(self.__axis_number):
+            oPeak = 0.0
+            if iDist[ii]:
+                ok, oTime, oPeak = self.__axis[ii].estimateMoveRelative(iDist[ii], abs(iDist[ii])/iTimeSpeed, iAccelTime)
+                feasible = feasible and ok
+                duration = max(duration, oTime)
+            peaks += ";%.2f" % oPeak
+        return "%d;%.2f" % (feasible, duration) + peaks
+
     def __getAllReport(self):
         report = ""
         for ii in range(self.__axis_number):
@@ -141,26 +744,1351 @@ class FIPC_Controler:
     def __syncMotionRel(self, iDist, iTimeSpeed, iAccelTime):
         for ii in range(self.__axis_number):
             if iDist[ii] and (not self.__axis[ii].canMoveRelative(iDist[ii])):
-                return
+                return False
         for ii in range(self.__axis_number):
             if iDist[ii] and (not self.__axis[ii].setSpeed(abs(iDist[ii])/iTimeSpeed)):
-                return
+                return False
         for ii in range(self.__axis_number):
             if iDist[ii] and (not self.__axis[ii].setAccelerationTime(iAccelTime)):
-                return
+                return False
+        # presupuesto de pasos: estirar el desplazamiento reduce todas las velocidades por igual
+        rate = [self.__axis[ii].getExecRate("MOVE_RELATIVE", iDist[ii]) if iDist[ii] else None for ii in range(self.__axis_number)]
+        admitted, scale = self.__budget.admit(rate)
+        if not admitted:
+            return False
+        if scale<1.0:
+            for ii in range(self.__axis_number):
+                if iDist[ii]:
+                    self.__axis[ii].setSpeed(abs(iDist[ii])*scale/iTimeSpeed)
         for ii in range(self.__axis_number):
             if iDist[ii]:
-                self.__axis[ii].setAction("MOVE_RELATIVE",iDist[ii])
+                self.__setAction(ii,"MOVE_RELATIVE",iDist[ii])
+        return True
 
     def __syncMotionAbs(self, iAbsolute, iTimeSpeed, iAccelTime):
         iDist = []
         for ii in range(self.__axis_number):
             value = iAbsolute[ii]-float(self.__axis[ii].getCurrentPosition())
             iDist.append(value)
-        self.__syncMotionRel(iDist, iTimeSpeed, iAccelTime)
+        return self.__syncMotionRel(iDist, iTimeSpeed, iAccelTime)
+
+    def __syncMotionRelFast(self, iDist):
+        # perfil trapezoidal comun: v = d/T y a = d/(T*ta)
+        tCruise = 0.0
+        kAccel = 0.0
+        for ii in range(self.__axis_number):
+            if iDist[ii]:
+                tCruise = max(tCruise, abs(iDist[ii])/self.__axis[ii].getMaxSpeed())
+                kAccel = max(kAccel, abs(iDist[ii])/self.__axis[ii].getMaxAcceleration())
+        if tCruise==0.0:
+            return 0.0
+        if tCruise*tCruise<kAccel:
+            iTimeSpeed = iAccelTime = kAccel**0.5
+        else:
+            iTimeSpeed = tCruise
+            iAccelTime = kAccel/tCruise
+        iTimeSpeed *= 1.01
+        if not self.__syncMotionRel(iDist, iTimeSpeed, iAccelTime):
+            return -1.0
+        return iTimeSpeed/self.__budget.getScale()+iAccelTime
+
+    def __syncMotionAbsFast(self, iAbsolute):
+        iDist = []
+        for ii in range(self.__axis_number):
+            iDist.append(iAbsolute[ii]-float(self.__axis[ii].getCurrentPosition()))
+        return self.__syncMotionRelFast(iDist)
             
     
+class FIPC_SyncLine:
+    # linea de disparo entre emuladores del mismo proceso, equivalente a FIPC_SharedSyncLine:
+    # el disparo del lider llega a todos los controladores conectados en la misma llamada
+    def __init__(self):
+        self.__edges = []
+        self.__lock = threading.Lock()
+
+    def attach(self, edge):
+        with self.__lock:
+            if edge not in self.__edges:
+                self.__edges.append(edge)
+
+    def detach(self, edge):
+        with self.__lock:
+            if edge in self.__edges:
+                self.__edges.remove(edge)
+
+    def fire(self):
+        t = time.monotonic()
+        with self.__lock:
+            edges = list(self.__edges)
+        for edge in edges:
+            edge(t)
+
+
+class _Kinematics:
+    # Desplazamientos de la herramienta alrededor del pivote, equivalente a FIPC_Kinematics
+    # (en punto flotante: los ejes del emulador no tienen resolucion de pasos)
+    def __init__(self, axis, events):
+        self.__axis = axis
+        self.__events = events
+        self.__pivot = [0.0, 0.0, 0.0]
+        self.__status = "Idle"
+        self.__stop = threading.Event()
+
+    def setPivot(self, pivot):
+        if self.__status=="Moving":
+            return False
+        self.__pivot = list(pivot)
+        return True
+
+    def moveAbsolute(self, pose, iTimeSpeed, iAccelTime):
+        return self.__start(list(pose), iTimeSpeed, iAccelTime)
+
+    def moveRelative(self, delta, iTimeSpeed, iAccelTime):
+        # la traslacion se rota con la orientacion actual y los angulos se suman
+        pose = self.__currentPose()
+        shift = self.__rotation(pose[3:], delta[0:3])
+        target = [pose[ii]+shift[ii] for ii in range(3)] + [pose[ii]+delta[ii] for ii in range(3, 6)]
+        return self.__start(target, iTimeSpeed, iAccelTime)
+
+    def stop(self):
+        self.__stop.set()
+
+    def getReport(self):
+        return self.__status + "".join([";%.3f" % value for value in self.__currentPose()])
+
+    def isRunning(self):
+        return self.__status=="Moving"
+
+    def __rotation(self, angle, p):
+        # R = Rz(a)*Rx(b)*Ry(c), angulos en mgrad
+        a, b, c = [value*math.pi/180000.0 for value in angle]
+        x, y, z = p
+        z, x = z*math.cos(c)-x*math.sin(c), z*math.sin(c)+x*math.cos(c)
+        y, z = y*math.cos(b)-z*math.sin(b), y*math.sin(b)+z*math.cos(b)
+        x, y = x*math.cos(a)-y*math.sin(a), x*math.sin(a)+y*math.cos(a)
+        return [x, y, z]
+
+    def __joints(self, pose):
+        # q = P + (I - R)*d
+        rd = self.__rotation(pose[3:], self.__pivot)
+        return [pose[ii]+self.__pivot[ii]-rd[ii] for ii in range(3)] + list(pose[3:])
+
+    def __currentPose(self):
+        q = [float(axis.getCurrentPosition()) for axis in self.__axis]
+        rd = self.__rotation(q[3:], self.__pivot)
+        return [q[ii]-self.__pivot[ii]+rd[ii] for ii in range(3)] + q[3:]
+
+    def __start(self, target, iTimeSpeed, iAccelTime):
+        if self.__status=="Moving":
+            return -1.0
+        for axis in self.__axis:
+            if axis.getStatus()!="Ready":
+                return -1.0
+        start = self.__currentPose()
+        delta = [target[ii]-start[ii] for ii in range(6)]
+        pose = lambda s: [start[ii]+s*delta[ii] for ii in range(6)]
+        # limites y maxima derivada de cada eje respecto del avance (32 tramos)
+        rate = [0.0]*6
+        previous = None
+        for kk in range(33):
+            joint = self.__joints(pose(kk/32.0))
+            for ii in range(6):
+                if not self.__axis[ii].canMoveAbsolute(joint[ii]):
+                    return -1.0
+                if previous:
+                    rate[ii] = max(rate[ii], abs(joint[ii]-previous[ii])*32.0)
+            previous = joint
+        tCruise = max([rate[ii]/self.__axis[ii].getMaxSpeed() for ii in range(6)])
+        kAccel = max([rate[ii]/self.__axis[ii].getMaxAcceleration() for ii in range(6)])
+        if tCruise==0.0:
+            return 0.0
+        if iTimeSpeed<=0.0:
+            if tCruise*tCruise<kAccel:
+                iTimeSpeed = iAccelTime = kAccel**0.5
+            else:
+                iTimeSpeed = tCruise
+                iAccelTime = kAccel/tCruise
+            iTimeSpeed *= 1.01
+        elif iAccelTime<=0.0 or iTimeSpeed<tCruise or iTimeSpeed*iAccelTime<kAccel:
+            return -1.0
+        for axis in self.__axis:
+            axis.startTracking()
+        self.__stop.clear()
+        self.__status = "Moving"
+        threading.Thread(target=self.__run, args=(pose, 1.0/iTimeSpeed, 1.0/(iTimeSpeed*iAccelTime))).start()
+        return iTimeSpeed+iAccelTime
+
+    def __run(self, pose, vMax, aMax):
+        # mismo perfil trapezoidal en linea que el firmware
+        Ts = 0.01
+        s = 0.0
+        v = 0.0
+        aborted = False
+        while True:
+            if self.__stop.is_set():
+                v -= aMax*Ts
+                if v<=0.0:
+                    aborted = True
+                    break
+            else:
+                v = v-aMax*Ts if v*v>=2.0*aMax*(1.0-s) else v+aMax*Ts
+                v = max(aMax*Ts, min(vMax, v))
+            s = min(1.0, s+v*Ts)
+            joint = self.__joints(pose(s))
+            if not all([self.__axis[ii].track(joint[ii]) for ii in range(6)]):
+                aborted = True # un eje se detuvo o se deshabilito
+                break
+            if s>=1.0:
+                break
+            time.sleep(Ts)
+        for axis in self.__axis:
+            axis.endTracking()
+        self.__status = "Aborted" if aborted else "Done"
+        self.__events.append("KIN:" + self.getReport() + "\n")
+
+
+class _Program:
+    # Programa almacenado, equivalente a FIPC_Program (mismo formato binario e instrucciones)
+    __MAGIC = 0x46495031
+    __HEADER = struct.Struct("<IHHHH")
+    __CODE_SIZE = 1024
+    __POSITIONS = 16
+    __VARIABLES = 16
+    __LOOP_DEPTH = 4
+    __CONST = 0xFF
+    __SIZE = 12 + 16*6*4 + 1024
+
+    def __init__(self, send, axis, isIdle, moveSync, moveAxis, readInput, storage, events):
+        self.__send = send
+        self.__axis = axis
+        self.__isIdle = isIdle
+        self.__moveSync = moveSync
+        self.__moveAxis = moveAxis
+        self.__readInput = readInput
+        self.__storage = storage
+        self.__events = events
+        self.__upload = b""
+        self.__blob = None
+        self.__status = "Idle"
+        self.__pc = 0
+        self.__var = [0.0]*self.__VARIABLES
+        self.__stop = threading.Event()
+        record = storage.read("program") if storage else None
+        if record:
+            blob = bytes.fromhex(record["blob"])
+            if self.__validate(blob):
+                self.__blob = blob
+
+    def upload(self, offset, text):
+        if offset==0:
+            self.__upload = b""
+        try:
+            if offset!=len(self.__upload) or len(text)%2:
+                raise ValueError
+            self.__upload += bytes.fromhex(text)
+            if len(self.__upload)>self.__SIZE:
+                raise ValueError
+        except ValueError:
+            self.__upload = b""
+            return False
+        return True
+
+    def commit(self):
+        if self.__status=="Running":
+            return False
+        blob, self.__upload = self.__upload + bytes(self.__SIZE-len(self.__upload)), b""
+        if not self.__validate(blob):
+            return False
+        if self.__storage:
+            self.__storage.write("program", {"blob":blob.hex()})
+        self.__blob = blob
+        self.__status = "Idle"
+        return True
+
+    def start(self):
+        if self.__blob is None or self.__status=="Running":
+            return False
+        self.__stop.clear()
+        self.__status = "Running"
+        threading.Thread(target=self.__run, args=()).start()
+        return True
+
+    def stop(self):
+        self.__stop.set()
+
+    def getReport(self):
+        state = "Empty" if (self.__blob is None and self.__status=="Idle") else self.__status
+        crc = self.__HEADER.unpack_from(self.__blob)[3] if self.__blob else 0
+        return "%s;%d;%d" % (state, self.__pc, crc)
+
+    def getVariable(self, id):
+        return "%.3f" % (self.__var[id] if id<self.__VARIABLES else 0.0)
+
+    def __operand(self, pc):
+        code = self.__code
+        if code[pc]<self.__VARIABLES:
+            return self.__var[code[pc]], pc+1
+        return struct.unpack_from("<f", code, pc+1)[0], pc+5
+
+    def __wait(self, done, timeout = 0.0):
+        # espera una condicion; False si se detuvo el programa o vencio el tiempo limite
+        start = time.time()
+        while not done():
+            if self.__stop.is_set() or (timeout and time.time()-start>=timeout):
+                return False
+            time.sleep(0.01)
+        return not self.__stop.is_set()
+
+    def __run(self):
+        code = self.__code = self.__blob[12+16*6*4:]
+        positions = [list(struct.unpack_from("<6f", self.__blob, 12+ii*24)) for ii in range(self.__POSITIONS)]
+        self.__var = [0.0]*self.__VARIABLES
+        loops = []
+        self.__pc = 0
+        status = "Error"
+        while not self.__stop.is_set():
+            pc, op = self.__pc+1, code[self.__pc]
+            if op==0:
+                status = "Done"
+                break
+            elif op==1:
+                self.__send(code[pc+1:pc+1+code[pc]].decode("ascii"))
+                pc += 1+code[pc]
+            elif op==2:
+                mode, id = code[pc], code[pc+1]
+                axis = self.__axis[id-1]
+                value, pc = self.__operand(pc+2)
+                if not (axis.canMoveAbsolute(value) if mode else axis.canMoveRelative(value)):
+                    break
+                # como "MR:" y "MA:": presupuesto de pasos y lote retenido hasta el disparo
+                if not self.__moveAxis(id, mode, value):
+                    break
+            elif op==3:
+                index = code[pc]
+                iTimeSpeed, pc = self.__operand(pc+1)
+                iAccelTime, pc = self.__operand(pc)
+                if self.__moveSync(positions[index], iTimeSpeed, iAccelTime)<0.0:
+                    break
+            elif op==4:
+                mask = code[pc]
+                self.__pc = pc+1
+                if not self.__wait(lambda: self.__isIdle(mask)):
+                    continue
+                pc += 1
+            elif op==5:
+                pin, level = code[pc], code[pc+1]
+                timeout, pc = self.__operand(pc+2)
+                self.__pc = pc
+                if not self.__wait(lambda: self.__readInput(pin)==level, max(timeout, 0.0)/1000.0):
+                    break
+            elif op==6:
+                delay, pc = self.__operand(pc)
+                self.__pc = pc
+                self.__wait(lambda: False, max(delay, 0.0)/1000.0)
+            elif 7<=op<=11:
+                var = code[pc]
+                value, pc = self.__operand(pc+1)
+                if op==11 and value==0.0:
+                    break
+                self.__var[var] = [value, self.__var[var]+value, self.__var[var]-value,
+                                   self.__var[var]*value, self.__var[var]/(value or 1.0)][op-7]
+            elif op==12:
+                self.__var[code[pc]] = float(self.__axis[code[pc+1]-1].getCurrentPosition())
+                pc += 2
+            elif op==13:
+                positions[code[pc]] = [float(axis.getCurrentPosition()) for axis in self.__axis]
+                pc += 1
+            elif op==14:
+                count, pc = self.__operand(pc)
+                if count>=1.0:
+                    loops.append([pc, int(count)])
+                else:
+                    depth = 1
+                    while depth:
+                        depth += {14:1, 15:-1}.get(code[pc], 0)
+                        pc += self.__length(code, pc, len(code))
+            elif op==15:
+                loops[-1][1] -= 1
+                if loops[-1][1]>0:
+                    pc = loops[-1][0]
+                else:
+                    loops.pop()
+            self.__pc = pc
+        if self.__stop.is_set() and status!="Done":
+            status = "Stopped"
+        self.__status = status
+        self.__events.append("PRG:" + self.getReport() + "\n")
+
+    def __length(self, code, pc, size):
+        # largo de una instruccion, 0 si es invalida (mismo criterio que FIPC_Program::length())
+        start, op = pc, code[pc]
+        pc += 1
+        fixed = {0:(0, 0), 2:(2, 1), 3:(1, 2), 4:(1, 0), 5:(2, 1), 6:(0, 1), 12:(2, 0), 13:(1, 0),
+                 14:(0, 1), 15:(0, 0)}
+        fixed.update({op:(1, 1) for op in range(7, 12)})
+        if op==1:
+            if pc>=size or code[pc]==0 or pc+1+code[pc]>size:
+                return 0
+            text = code[pc+1:pc+1+code[pc]]
+            if 0 in text or text[-1:]!=b":" or any(token.startswith(b"PRG") for token in text.split(b":")):
+                return 0
+            return 2+code[pc]
+        if op not in fixed:
+            return 0
+        count, operands = fixed[op]
+        if pc+count>size:
+            return 0
+        args = code[pc:pc+count]
+        axes = len(self.__axis)
+        if (op==2 and (args[0]>1 or not 1<=args[1]<=axes)) or (op in (3, 13) and args[0]>=self.__POSITIONS) or \
+           (op==5 and (args[0]>39 or args[1]>1)) or (7<=op<=12 and args[0]>=self.__VARIABLES) or \
+           (op==12 and not 1<=args[1]<=axes):
+            return 0
+        pc += count
+        for ii in range(operands):
+            if pc>=size or (code[pc]!=self.__CONST and code[pc]>=self.__VARIABLES):
+                return 0
+            pc += 5 if code[pc]==self.__CONST else 1
+        return pc-start if pc<=size else 0
+
+    def __validate(self, blob):
+        if len(blob)!=self.__SIZE:
+            return False
+        magic, version, size, crc, reserved = self.__HEADER.unpack_from(blob)
+        if magic!=self.__MAGIC or version!=1 or not 0<size<=self.__CODE_SIZE:
+            return False
+        if crc!=self.__crc(blob[12:12+16*6*4+size]) or any(blob[12+16*6*4+size:]):
+            return False
+        code = blob[12+16*6*4:12+16*6*4+size]
+        depth, last, pc = 0, 15, 0
+        while pc<size:
+            length = self.__length(code, pc, size)
+            if length==0:
+                return False
+            depth += {14:1, 15:-1}.get(code[pc], 0)
+            if depth<0 or depth>self.__LOOP_DEPTH:
+                return False
+            last = code[pc]
+            pc += length
+        return last==0 and depth==0
+
+    def __crc(self, data):
+        # CRC-16 (CCITT), igual que FIPC_Storage::crc16()
+        out = 0xFFFF
+        for byte in data:
+            out ^= byte << 8
+            for jj in range(8):
+                out = ((out << 1) ^ 0x1021) if out & 0x8000 else (out << 1)
+                out &= 0xFFFF
+        return out
+
+
+class _Recorder:
+    # FIPC_Recorder: mismo formato binario (ver python_lib/module_session.py); los estados se
+    # muestrean cada 1 ms y no hay ciclos de tiempo real que medir
+    SIZE = 16384
+    CHUNK = 256
+    AXIS, REQUEST, STATE, EXEC = range(4)
+
+    def __init__(self, axis):
+        self.__axis = axis
+        self.__log = bytearray()
+        self.__records = 0
+        self.__dropped = 0
+        self.__start = time.monotonic()
+        self.__recording = threading.Event()
+        self.__lock = threading.Lock()
+
+    def start(self):
+        self.stop()
+        with self.__lock:
+            self.__log = bytearray()
+            self.__records = self.__dropped = 0
+            self.__start = time.monotonic()
+        status = []
+        for ii in range(len(self.__axis)):
+            status.append(self.__axis[ii].getStatus())
+            self.__write(self.AXIS, struct.pack("<Bf", ii+1, float(self.__axis[ii].getCurrentPosition())) + status[-1].encode())
+        self.__recording.set()
+        threading.Thread(target=self.__run, args=(status,), daemon=True).start()
+
+    def stop(self):
+        self.__recording.clear()
+
+    def request(self, text):
+        if self.__recording.is_set() and not text.startswith(("REC:", "?REC")):
+            self.__write(self.REQUEST, text.encode())
+
+    def getReport(self):
+        return "%d;%d;%d;%d;0;0.0;0;0" % (self.__recording.is_set(), len(self.__log), self.__records, self.__dropped)
+
+    def getData(self, offset):
+        return self.__log[offset:offset+self.CHUNK].hex().upper()
+
+    def __run(self, status):
+        while self.__recording.is_set():
+            for ii in range(len(self.__axis)):
+                current = self.__axis[ii].getStatus()
+                if current != status[ii]:
+                    status[ii] = current
+                    self.__write(self.STATE, bytes([ii+1]) + current.encode())
+            time.sleep(0.001)
+
+    def __write(self, type, data):
+        data = data[:255]
+        with self.__lock:
+            if len(self.__log) + 6 + len(data) > self.SIZE:
+                self.__dropped += 1
+                return
+            now = int((time.monotonic() - self.__start)*1e6) & 0xFFFFFFFF
+            self.__log += struct.pack("<IBB", now, type, len(data)) + data
+            self.__records += 1
+
+
+class _Budget:
+    # FIPC_Budget: verifica las acciones nuevas contra la frecuencia de pasos que exec() atiende,
+    # con el mismo modelo de costo; el emulador no tiene ciclos de exec() que calibrar
+    BASE_US = 20.0
+    STEP_US = 8.0
+    MARGIN = 0.5
+    STRETCH_MIN = 0.1
+
+    def __init__(self, axis, storage, events):
+        self.__axis = axis
+        self.__storage = storage
+        self.__events = events
+        self.__mode = 0
+        self.__base = self.BASE_US
+        self.__step = self.STEP_US
+        self.__scale = 1.0
+        self.__rejected = 0
+        self.__stretched = 0
+        record = storage.read("budget") if storage else None
+        if record and 0 <= record.get("mode", -1) <= 2:
+            self.__mode, self.__base, self.__step = record["mode"], record["base"], record["step"]
+
+    def setMode(self, mode):
+        if not 0 <= mode <= 2:
+            return False
+        self.__mode = mode
+        if self.__storage:
+            self.__storage.write("budget", {"mode":mode, "base":self.__base, "step":self.__step})
+        return True
+
+    def admit(self, rate, stretch = True):
+        # rate: pasos/s pedidos de cada eje, None en los que conservan su accion en curso;
+        # stretch: False si las velocidades no pueden reducirse (busqueda del cero y seguimiento);
+        # retorna (aceptada, factor de las velocidades)
+        self.__scale = 1.0
+        if self.__mode == 0:
+            return True, 1.0
+        keep = [axis.getExecLoad() for axis, r in zip(self.__axis, rate) if r is None]
+        new = [r for r in rate if r is not None and r > 0.0]
+        keepMax, keepSum = max(keep + [0.0]), sum(keep)
+        newMax, newSum = max(new + [0.0]), sum(new)
+        demand = self.__load(max(keepMax, newMax), keepSum + newSum)
+        if demand <= 1.0:
+            return True, 1.0
+        scale = 0.0
+        if self.__mode == 2 and stretch and self.__load(keepMax, keepSum) < 1.0:
+            cross = keepMax/newMax
+            if cross < 1.0 and self.__load(keepMax, keepSum + cross*newSum) <= 1.0:
+                scale = (1e6 - self.__step*keepSum)/(self.__base*newMax/self.MARGIN + self.__step*newSum)
+            elif self.__step > 0.0:
+                scale = (1e6 - self.__base*keepMax/self.MARGIN - self.__step*keepSum)/(self.__step*newSum)
+        if scale >= self.STRETCH_MIN:
+            self.__scale = min(scale, 1.0)
+            self.__stretched += 1
+            return True, self.__scale
+        self.__rejected += 1
+        mask = sum(1 << ii for ii, r in enumerate(rate) if r is not None and r > 0.0)
+        self.__events.append("BUDGET:%d;%.1f\n" % (mask, 100.0*demand))
+        return False, 1.0
+
+    def getScale(self):
+        return self.__scale
+
+    def calibrate(self, cycles):
+        return False
+
+    def getReport(self):
+        loads = [axis.getExecLoad() for axis in self.__axis]
+        return "%d;%.3f;%.3f;%.1f;%d;%d;0" % (self.__mode, self.__base, self.__step,
+                                             100.0*self.__load(max(loads), sum(loads)), self.__rejected, self.__stretched)
+
+    def __load(self, rateMax, rateSum):
+        return (self.__base*rateMax/self.MARGIN + self.__step*rateSum)/1e6
+
+
+class _Latency:
+    # FIPC_Latency: una medicion a la vez desde los primeros bytes de un comando hasta el
+    # primer paso, con los mismos reportes; los pasos son los del hilo de cada eje
+    BYTE, LINE, PARSE, ACCEPT, PICKUP, STEP = range(6)
+    STAGES = 6
+    BUCKETS = 24
+    TIMEOUT = 1000000
+
+    def __init__(self):
+        self.__lock = threading.Lock()
+        self.__time = [0]*self.STAGES
+        self.__next = self.BYTE
+        self.clear()
+
+    def probe(self, probe):
+        if probe != self.__next and probe != self.BYTE:
+            return
+        now = int(time.monotonic()*1e6)
+        with self.__lock:
+            if probe == self.BYTE:
+                if self.__next == self.BYTE or now - self.__time[self.BYTE] >= self.TIMEOUT:
+                    self.__time[self.BYTE] = now
+                    self.__next = self.LINE
+            elif probe == self.__next:
+                self.__time[probe] = now
+                self.__add(probe-1, now - self.__time[probe-1])
+                if probe == self.STEP:
+                    self.__add(self.STAGES-1, now - self.__time[self.BYTE])
+                    self.__next = self.BYTE
+                else:
+                    self.__next = probe+1
+
+    def end(self):
+        # descarta la medicion de una solicitud sin desplazamientos
+        with self.__lock:
+            if self.__next in (self.PARSE, self.ACCEPT):
+                self.__next = self.BYTE
+
+    def clear(self):
+        with self.__lock:
+            self.__stages = [{"count":0, "min":0, "max":0, "sum":0, "bucket":[0]*self.BUCKETS} for ii in range(self.STAGES)]
+            self.__next = self.BYTE
+
+    def getReport(self, stage):
+        if not 0 <= stage < self.STAGES:
+            return "0;0;0;0;0;0"
+        with self.__lock:
+            s = dict(self.__stages[stage])
+        mean = s["sum"]//s["count"] if s["count"] else 0
+        return "%d;%d;%d;%d;%d;%d" % (s["count"], s["min"], mean, s["max"], self.__percentile(s, 50), self.__percentile(s, 99))
+
+    def getHistogram(self, stage):
+        if not 0 <= stage < self.STAGES:
+            return ";".join(["0"]*self.BUCKETS)
+        with self.__lock:
+            return ";".join(str(count) for count in self.__stages[stage]["bucket"])
+
+    def __add(self, stage, elapsed):
+        s = self.__stages[stage]
+        if s["count"] == 0 or elapsed < s["min"]:
+            s["min"] = elapsed
+        s["max"] = max(s["max"], elapsed)
+        s["sum"] += elapsed
+        s["count"] += 1
+        s["bucket"][min(max(elapsed.bit_length()-1, 0), self.BUCKETS-1)] += 1
+
+    def __percentile(self, s, percent):
+        if s["count"] == 0:
+            return 0
+        rank = (s["count"]*percent + 99)//100
+        seen = 0
+        for ii in range(self.BUCKETS-1):
+            seen += s["bucket"][ii]
+            if seen >= rank:
+                return min((2 << ii) - 1, s["max"])
+        return s["max"]
+
+
+class _Network:
+    # FIPC_Network: comandos por TCP, respuestas terminadas en ">" y lineas asincronicas con '!'
+    CLIENTS = 4
+    TX_FRAMES = 64                   # tramas asincronicas pendientes por conexion
+
+    def __init__(self, request, telemetry, events, port, clock, latency):
+        self.__request = request
+        self.__latency = latency
+        self.__clock = clock
+        self.__telemetry = telemetry
+        self.__events = events
+        self.__clients = []
+        self.__clientsLock = threading.Lock()
+        self.__sent = 0
+        self.__dropped = 0
+        self.__server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.__server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.__server.bind(("", port))
+        self.__server.listen(self.CLIENTS)
+        self.port = self.__server.getsockname()[1]
+        threading.Thread(target=self.__accept, daemon=True).start()
+        threading.Thread(target=self.__publish, daemon=True).start()
+
+    def __accept(self):
+        while True:
+            conn, _ = self.__server.accept()
+            with self.__clientsLock:
+                if len(self.__clients) >= self.CLIENTS:
+                    conn.close()
+                    continue
+                conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                client = {"socket": conn, "subscribe": 0, "period": 1, "last": 0.0,
+                          "tx": queue.Queue(self.TX_FRAMES)}
+                self.__clients.append(client)
+            threading.Thread(target=self.__receive, args=(client,), daemon=True).start()
+            threading.Thread(target=self.__transmit, args=(client,), daemon=True).start()
+
+    def __close(self, client):
+        with self.__clientsLock:
+            if client in self.__clients:
+                self.__clients.remove(client)
+        client["socket"].close()
+        client["tx"].put(None)
+
+    def __receive(self, client):
+        buffer = b""
+        while True:
+            try:
+                data = client["socket"].recv(4096)
+            except OSError:
+                data = b""
+            if not data:
+                self.__close(client)
+                return
+            if not buffer:
+                self.__latency.probe(_Latency.BYTE)
+            buffer += data
+            lines = buffer.split(b"\n")
+            buffer = lines.pop()
+            for raw in lines:
+                line = raw.decode("utf-8").strip("\r")
+                if line:
+                    # las respuestas no se descartan: la cola bloquea si el cliente no lee
+                    self.__latency.probe(_Latency.LINE)
+                    out = self.__command(client, line)
+                    if out and not out.endswith("\n"):
+                        out += "\n"
+                    client["tx"].put(out + ">\n")
+
+    def __command(self, client, line):
+        if line.startswith("NETSUB:"):
+            fields = line.split(":")
+            client["subscribe"] = int(fields[1]) & 0x03
+            client["period"] = max(int(fields[2]) if len(fields) > 2 and fields[2] else 0, 1)
+            client["last"] = time.monotonic()
+            return "%d;%d\n" % (client["subscribe"], client["period"])
+        if line.startswith("?NET:"):
+            return "%d;%d;%d\n" % (len(self.__clients), self.__sent, self.__dropped)
+        return self.__request(line)
+
+    def __transmit(self, client):
+        while True:
+            data = client["tx"].get()
+            if data is None:
+                return
+            try:
+                client["socket"].sendall(data.encode("utf-8"))
+                self.__sent += len(data)
+            except OSError:
+                self.__close(client)
+                return
+
+    def __queue(self, client, data):
+        try:
+            client["tx"].put_nowait(data)
+        except queue.Full:
+            self.__dropped += 1
+
+    def __publish(self):
+        # eventos cada 100 ms (TaskReadAction) y telemetria con la resolucion del tick de 1 ms
+        lastEvents = 0.0
+        while True:
+            time.sleep(0.001)
+            now = time.monotonic()
+            with self.__clientsLock:
+                clients = list(self.__clients)
+            if now - lastEvents >= 0.1:
+                lastEvents = now
+                events = self.__events()
+                for line in events.splitlines():
+                    for client in clients:
+                        if client["subscribe"] & 0x01:
+                            self.__queue(client, "!" + line + "\n")
+            frame = None
+            for client in clients:
+                if (client["subscribe"] & 0x02) and (now - client["last"])*1000.0 >= client["period"]:
+                    client["last"] = now
+                    if frame is None:
+                        frame = "!TEL:%d;%s\n" % (int(self.__clock()*1000.0), self.__telemetry())
+                    self.__queue(client, frame)
+
+
+class _GaussianCoupling:
+    # Potencia acoplada P = peak*exp(-sum((x-c)^2/w^2)) sobre los ejes con centro definido
+    def __init__(self, center = None, waist = None, peak = 1000.0, noise = 0.0):
+        self.__center = center or []
+        self.__waist = waist or []
+        self.__peak = peak
+        self.__noise = noise
+
+    def read(self, positions):
+        r2 = 0.0
+        for ii in range(len(self.__center)):
+            if self.__center[ii] is not None:
+                r2 += ((positions[ii]-self.__center[ii])/self.__waist[ii])**2
+        value = self.__peak*math.exp(-r2)
+        if self.__noise:
+            value += random.gauss(0.0, self.__noise)
+        return value
+
+
+class _Align:
+    # Misma secuencia de evaluaciones que FIPC_Align en el firmware
+    def __init__(self, iType, axis, step, minStep, maxEval, threshold, readPower, samples, events):
+        self.__type = iType
+        self.__axis = axis
+        self.__n = len(axis)
+        self.__step = step
+        self.__minStep = minStep
+        self.__maxEval = maxEval
+        self.__threshold = threshold
+        self.__readPower = readPower
+        self.__samples = samples
+        self.__events = events
+        self.__stop = threading.Event()
+        self.__status = "Idle"
+        self.__evals = 0
+        self.__best = [float(a.getCurrentPosition()) for a in axis]
+        self.__bestValue = -1.0e30
+        self.motionTime = 0.0
+
+    def start(self):
+        self.__status = "Moving"
+        threading.Thread(target=self.__run, args=()).start()
+
+    def stop(self):
+        self.__stop.set()
+
+    def isRunning(self):
+        return self.__status in ("Moving", "Finish")
+
+    def getReport(self):
+        out = self.__status + ";" + str(self.__evals) + ";%.2f" % self.__bestValue
+        for v in self.__best:
+            out += ";%.2f" % v
+        return out
+
+    def __evaluate(self, trial):
+        self.__evals += 1
+        for ii in range(self.__n):
+            if not self.__axis[ii].canMoveAbsolute(trial[ii]):
+                value = -1.0e30
+                break
+        else:
+            dt = 0.0
+            for ii in range(self.__n):
+                dt = max(dt, self.__axis[ii].jumpTo(trial[ii]))
+            self.motionTime += dt
+            value = sum([self.__readPower() for jj in range(self.__samples)])/self.__samples
+        if value>self.__bestValue:
+            self.__bestValue = value
+            self.__best = list(trial)
+        return value
+
+    def __run(self):
+        algorithm = [self.__hill, self.__spiralGradient, self.__simplex][self.__type]
+        try:
+            algorithm(list(self.__best))
+        except StopIteration:
+            pass
+        self.__status = "Finish"
+        for ii in range(self.__n):
+            self.motionTime += self.__axis[ii].jumpTo(self.__best[ii])
+        self.__status = "Aborted" if self.__stop.is_set() else "Done"
+        self.__events.append("ALIGN:" + self.getReport() + "\n")
+
+    def __eval(self, trial):
+        if self.__stop.is_set() or self.__evals>=self.__maxEval:
+            raise StopIteration
+        return self.__evaluate(trial)
+
+    def __hill(self, x):
+        self.__eval(x)
+        k, improved = 0, False
+        while True:
+            moved = False
+            for direction in (1, -1):
+                if moved:
+                    break
+                while True:
+                    trial = list(self.__best)
+                    trial[k] += direction*self.__step
+                    before = self.__bestValue
+                    self.__eval(trial)
+                    if self.__bestValue>before:
+                        moved = improved = True
+                    else:
+                        break
+            k += 1
+            if k>=self.__n:
+                k = 0
+                if not improved:
+                    self.__step /= 2.0
+                improved = False
+                if self.__step<self.__minStep:
+                    return
+
+    def __spiralGradient(self, x):
+        base = list(x)
+        baseValue = self.__eval(base)
+        theta = 0.0
+        while baseValue<self.__threshold:
+            radius = self.__step*theta/(2.0*math.pi)
+            theta += self.__step/max(radius, self.__step)
+            radius = self.__step*theta/(2.0*math.pi)
+            trial = list(x)
+            trial[0] += radius*math.cos(theta)
+            trial[1] += radius*math.sin(theta)
+            value = self.__eval(trial)
+            if value>=self.__threshold:
+                base, baseValue = trial, value
+        while True:
+            grad = []
+            for k in range(self.__n):
+                trial = list(base)
+                # ancho de al menos un paso del eje, como FIPC_Align::probeWidth()
+                width = max(self.__minStep, 1.0/self.__axis[k].getStepsPerUnit())
+                trial[k] += width
+                grad.append((self.__eval(trial)-baseValue)/width)
+            norm = math.sqrt(sum([g*g for g in grad]))
+            if norm==0.0:
+                return
+            while True:
+                trial = [base[ii]+self.__step*grad[ii]/norm for ii in range(self.__n)]
+                value = self.__eval(trial)
+                if value>baseValue:
+                    base, baseValue = trial, value
+                    break
+                self.__step /= 2.0
+                if self.__step<self.__minStep:
+                    return
+
+    def __simplex(self, x):
+        n = self.__n
+        simplex = [list(x)]
+        for k in range(n):
+            vertex = list(x)
+            vertex[k] += self.__step
+            simplex.append(vertex)
+        values = [self.__eval(v) for v in simplex]
+        while True:
+            best = values.index(max(values))
+            worst = values.index(min(values))
+            size = max([abs(simplex[j][i]-simplex[best][i]) for j in range(n+1) for i in range(n)])
+            if size<self.__minStep:
+                return
+            centroid = [sum([simplex[j][i] for j in range(n+1) if j!=worst])/n for i in range(n)]
+            reflect = [2.0*centroid[i]-simplex[worst][i] for i in range(n)]
+            fr = self.__eval(reflect)
+            second = min([values[j] for j in range(n+1) if j!=worst])
+            if fr>max(values):
+                expand = [centroid[i]+2.0*(reflect[i]-centroid[i]) for i in range(n)]
+                fe = self.__eval(expand)
+                simplex[worst], values[worst] = (expand, fe) if fe>fr else (reflect, fr)
+            elif fr>second:
+                simplex[worst], values[worst] = reflect, fr
+            else:
+                origin = reflect if fr>values[worst] else simplex[worst]
+                contract = [centroid[i]+0.5*(origin[i]-centroid[i]) for i in range(n)]
+                fc = self.__eval(contract)
+                if fc>=max(fr, values[worst]):
+                    simplex[worst], values[worst] = contract, fc
+                else:
+                    for j in range(n+1):
+                        if j!=best:
+                            simplex[j] = [simplex[best][i]+0.5*(simplex[j][i]-simplex[best][i]) for i in range(n)]
+                            values[j] = self.__eval(simplex[j])
+
+
+class _Tune:
+    # Misma busqueda que FIPC_Tune en el firmware: los pasos perdidos se miden repitiendo la
+    # busqueda del cero y los desplazamientos de cada ensayo no esperan su duracion
+    __ITERATIONS = 6
+    __SAFETY = 0.8
+    __ACCEL_SAFE = 0.5
+    __ACCEL_RANGE = 4.0
+    __CRUISE = 0.5
+
+    def __init__(self, events, store):
+        self.__events = events
+        self.__store = store
+        self.__stop = threading.Event()
+        self.__status = "Idle"
+        self.__id = 0
+        self.__trials = 0
+        self.__veloMax = 0.0
+        self.__accelMax = 0.0
+        self.__error = 0
+
+    def start(self, id, axis, distance, cycles, tolerance):
+        if self.isRunning():
+            return False
+        if distance==0.0 or cycles<=0 or not tolerance>=0.0 or axis.getStatus()!="Ready":
+            return False
+        origin = float(axis.getCurrentPosition())
+        if not axis.canMoveAbsolute(origin+distance):
+            return False
+        # los ensayos de velocidad deben llegar al crucero con la aceleracion reducida
+        accelSafe = self.__ACCEL_SAFE*axis.getMaxAcceleration()
+        veloHigh = min(axis.getSpeedLimit(), (accelSafe*abs(distance)*(1.0-self.__CRUISE))**0.5)
+        previous = (axis.getMaxSpeed(), axis.getMaxAcceleration(), float(axis.getSpeed()), float(axis.getAccelerationTime()))
+        if not axis.setLimits(veloHigh, self.__ACCEL_RANGE*previous[1]):
+            return False
+        self.__axis = axis
+        self.__id = id
+        self.__origin = origin
+        self.__distance = distance
+        self.__cycles = cycles
+        self.__tolerance = int(round(tolerance*axis.getStepsPerUnit()))
+        self.__accelSafe = accelSafe
+        self.__veloHigh = veloHigh
+        self.__previous = previous
+        self.__veloMax = self.__accelMax = 0.0
+        self.__trials = 0
+        self.__error = 0
+        self.__stop.clear()
+        self.__status = "Homing"
+        threading.Thread(target=self.__run, args=()).start()
+        return True
+
+    def stop(self):
+        self.__stop.set()
+
+    def isRunning(self):
+        return self.__status in ("Homing", "Moving", "Stopping")
+
+    def getReport(self):
+        return "%s;%d;%d;%.2f;%.2f;%d" % (self.__status, self.__id, self.__trials, self.__veloMax, self.__accelMax, self.__error)
+
+    def __run(self):
+        status = "Done"
+        try:
+            self.__home()                      # la referencia inicial no se evalua
+            velo = self.__search(lambda value: (value, self.__accelSafe), self.__veloHigh)
+            if velo==0.0:
+                raise ValueError
+            self.__veloMax = self.__SAFETY*velo
+            accel = self.__search(lambda value: (self.__veloMax, value), self.__ACCEL_RANGE*self.__previous[1])
+            if accel==0.0:
+                raise ValueError
+            self.__accelMax = self.__SAFETY*accel
+        except ValueError:
+            status = "Failed"
+        except StopIteration:
+            status = "Aborted"
+        self.__finish(status)
+
+    def __search(self, trial, high):
+        # biseccion: el limite inferior es el mayor valor ensayado sin pasos perdidos
+        low = 0.0
+        for step in range(self.__ITERATIONS):
+            value = 0.5*(low+high)
+            speed, accel = trial(value)
+            if self.__trial(speed, accel):
+                low = value
+            else:
+                high = value
+        return low
+
+    def __trial(self, speed, accel):
+        self.__axis.setSpeed(speed)
+        self.__axis.setAccelerationTime(speed/accel)
+        self.__status = "Moving"
+        for leg in range(2*self.__cycles):
+            if self.__stop.is_set():
+                raise StopIteration
+            self.__axis.jumpTo(self.__origin if leg%2 else self.__origin+self.__distance)
+        self.__home()
+        self.__trials += 1
+        return abs(self.__error)<=self.__tolerance
+
+    def __home(self):
+        if self.__stop.is_set() or not self.__axis.rehome():
+            raise StopIteration
+        self.__status = "Homing"
+        self.__error = self.__axis.getHomingError()
+
+    def __finish(self, status):
+        veloMax0, accelMax0, speed0, accelTime0 = self.__previous
+        if status=="Done":
+            self.__axis.setLimits(self.__veloMax, self.__accelMax)
+            self.__store(self.__id, self.__veloMax, self.__accelMax)
+        else:
+            self.__axis.setLimits(veloMax0, accelMax0)
+        self.__axis.setSpeed(speed0)          # rechazada si no es menor que la nueva velocidad maxima
+        self.__axis.setAccelerationTime(accelTime0)
+        self.__status = status
+        self.__events.append("TUNE:" + self.getReport() + "\n")
+
+
+class _FileStorage:
+    # Almacenamiento no volatil en archivos, equivalente a FIPC_FileStorage (escritura atomica)
+    def __init__(self, prefix):
+        self.__prefix = prefix
+
+    def read(self, key):
+        try:
+            with open(self.__prefix + "_" + key + ".json") as file:
+                return json.load(file)
+        except (OSError, ValueError):
+            return None
+
+    def write(self, key, record):
+        name = self.__prefix + "_" + key + ".json"
+        with open(name + ".tmp", "w") as file:
+            json.dump(record, file)
+            file.flush()
+            os.fsync(file.fileno())
+        os.replace(name + ".tmp", name)
+
+
+_STAGES = ["MOX_02_30", "MOR_100_30", "MOG_65_10", "MOG_65_15"]
+
+_PRESETS = {
+    "MOX_02_30":  {"stage":0, "flags":0x04, "units":"um",    "stepsPerUnit":3.2,     "minPosition":0,      "maxPosition":30000,  "veloMax":1875, "accelMax":7500,  "zero":0},
+    "MOR_100_30": {"stage":1, "flags":0x01, "units":"mgrad", "stepsPerUnit":1.6,     "minPosition":0,      "maxPosition":360000, "veloMax":3750, "accelMax":15000, "zero":0},
+    "MOG_65_10":  {"stage":2, "flags":0x04, "units":"mgrad", "stepsPerUnit":6.25,    "minPosition":-15000, "maxPosition":15000,  "veloMax":960,  "accelMax":3840,  "zero":-15000},
+    "MOG_65_15":  {"stage":3, "flags":0x04, "units":"mgrad", "stepsPerUnit":4.44444, "minPosition":-21000, "maxPosition":21000,  "veloMax":1350, "accelMax":5400,  "zero":-21000}}
+
+
+class _Config:
+    # Bloque de configuracion de los ejes, equivalente a FIPC_Config (mismo formato binario)
+    # Con CONFIG_MICROSTEP (0x10) el firmware cambia la resolucion de micropasos durante los
+    # desplazamientos; el emulador no genera pulsos, por lo que solo valida los campos.
+    __MAGIC = 0x46494331
+    __VERSION = 2
+    __HEADER = struct.Struct("<IHBB")
+    __AXIS = struct.Struct("<8B8s6f5B3x")
+    __AXIS_V1 = struct.Struct("<8B8s6f")
+    __TAIL = struct.Struct("<HH")
+    __FIELDS = ("stage", "flags", "pinStep", "pinDir", "pinEnable", "pinPositive", "pinNegative", "pinRef",
+                "units", "stepsPerUnit", "minPosition", "maxPosition", "veloMax", "accelMax", "zero",
+                "pinMode0", "pinMode1", "pinMode2", "stepFine", "stepCoarse")
+    __DEFAULTS = {"pinMode0":0xFF, "pinMode1":0xFF, "pinMode2":0xFF, "stepFine":0, "stepCoarse":0}
+    __SIZE = 8 + 8*48 + 4
+    __SIZE_V1 = 8 + 8*40 + 4
+
+    def __init__(self, defaults, storage):
+        self.__count = len(defaults)
+        self.__storage = storage
+        self.__stored = False
+        self.__upload = b""
+        self.__blob = self.__pack(defaults)
+        record = storage.read("config") if storage else None
+        if record:
+            blob = bytes.fromhex(record["blob"])
+            if len(blob)==self.__SIZE_V1:
+                blob = self.__migrate(blob)
+            if blob and self.__validate(blob):
+                self.__blob = blob
+                self.__stored = True
+
+    def getAxes(self):
+        return self.__unpack(self.__blob)
+
+    def upload(self, offset, text):
+        if offset==0:
+            self.__upload = b""
+        try:
+            if offset!=len(self.__upload) or len(text)%2:
+                raise ValueError
+            self.__upload += bytes.fromhex(text)
+            if len(self.__upload)>self.__SIZE:
+                raise ValueError
+        except ValueError:
+            self.__upload = b""
+            return False
+        return True
+
+    def commit(self):
+        blob, self.__upload = self.__upload, b""
+        if not self.__validate(blob):
+            return False
+        if self.__storage:
+            self.__storage.write("config", {"blob":blob.hex()})
+        self.__blob = blob
+        self.__stored = True
+        return True
+
+    def setLimits(self, id, veloMax, accelMax):
+        # equivalente a FIPC_Config::setLimits(): limites medidos por _Tune en el bloque activo
+        axes = self.__unpack(self.__blob)
+        axes[id-1]["veloMax"], axes[id-1]["accelMax"] = veloMax, accelMax
+        blob = self.__pack(axes)
+        if not self.__validate(blob):
+            return False
+        if self.__storage:
+            self.__storage.write("config", {"blob":blob.hex()})
+        self.__blob = blob
+        self.__stored = True
+        return True
+
+    def getReport(self):
+        return "%d;%d;%d" % (self.__stored, self.__TAIL.unpack_from(self.__blob, self.__SIZE-4)[0], self.__count)
+
+    def getBlob(self):
+        return self.__blob.hex().upper()
+
+    def __pack(self, axes):
+        data = self.__HEADER.pack(self.__MAGIC, self.__VERSION, len(axes), 0)
+        for ii in range(8):
+            if ii<len(axes):
+                axis = dict(self.__DEFAULTS)
+                axis.update(axes[ii])
+                axis["units"] = axis["units"].encode("ascii")
+                data += self.__AXIS.pack(*[axis[name] for name in self.__FIELDS])
+            else:
+                data += bytes(self.__AXIS.size)
+        return data + self.__TAIL.pack(self.__crc(data), 0)
+
+    def __migrate(self, blob):
+        # bloque de la version 1 guardado por un firmware anterior, equivalente a FIPC_Config::migrate()
+        magic, version, count, reserved = self.__HEADER.unpack_from(blob)
+        if magic!=self.__MAGIC or version!=1:
+            return None
+        if self.__TAIL.unpack_from(blob, self.__SIZE_V1-4)[0]!=self.__crc(blob[:self.__SIZE_V1-4]):
+            return None
+        axes = []
+        for ii in range(count):
+            axis = dict(zip(self.__FIELDS, self.__AXIS_V1.unpack_from(blob, self.__HEADER.size + ii*self.__AXIS_V1.size)))
+            axis["units"] = axis["units"].split(b"\0")[0].decode("ascii", "replace")
+            axes.append(axis)
+        return self.__pack(axes)
+
+    def __validate(self, blob):
+        if len(blob)!=self.__SIZE:
+            return False
+        magic, version, count, reserved = self.__HEADER.unpack_from(blob)
+        if magic!=self.__MAGIC or version!=self.__VERSION or count!=self.__count:
+            return False
+        if self.__TAIL.unpack_from(blob, self.__SIZE-4)[0]!=self.__crc(blob[:self.__SIZE-4]):
+            return False
+        outputs = []
+        for axis in self.__unpack(blob):
+            if max(axis["pinStep"], axis["pinDir"], axis["pinEnable"])>33 or axis["pinStep"]==axis["pinDir"]:
+                return False
+            if max(axis["pinPositive"], axis["pinNegative"], axis["pinRef"])>39:
+                return False
+            if not (axis["stepsPerUnit"]>0 and axis["minPosition"]<axis["maxPosition"] and axis["accelMax"]>0):
+                return False
+            rate = 150000 if axis["flags"]&0x08 else 12000   # CONFIG_PULSE_RMT
+            modes = []
+            if axis["flags"]&0x10:                            # CONFIG_MICROSTEP, solo por software
+                if axis["flags"]&0x08 or axis["stepFine"]>5 or axis["stepCoarse"]>=axis["stepFine"]:
+                    return False
+                modes = [axis["pinMode%d" % kk] for kk in range(3) if axis["pinMode%d" % kk]!=0xFF]
+                if len(set(modes))!=len(modes) or any(pin>33 for pin in modes):
+                    return False
+                if set(modes) & {axis["pinStep"], axis["pinDir"], axis["pinEnable"]}:
+                    return False
+                rate *= 1 << (axis["stepFine"] - axis["stepCoarse"])
+            if not (0<axis["veloMax"] and axis["veloMax"]*axis["stepsPerUnit"]<=rate):
+                return False
+            if not (axis["minPosition"]<=axis["zero"]<=axis["maxPosition"]):
+                return False
+            if axis["pinStep"] in outputs or axis["pinDir"] in outputs or set(modes) & set(outputs):
+                return False
+            outputs += [axis["pinStep"], axis["pinDir"]] + modes
+        return True
+
+    def __unpack(self, blob):
+        axes = []
+        for ii in range(self.__count):
+            axis = dict(zip(self.__FIELDS, self.__AXIS.unpack_from(blob, self.__HEADER.size + ii*self.__AXIS.size)))
+            axis["units"] = axis["units"].split(b"\0")[0].decode("ascii", "replace")
+            axes.append(axis)
+        return axes
+
+    def __crc(self, data):
+        # CRC-16 (CCITT), igual que FIPC_Storage::crc16()
+        out = 0xFFFF
+        for byte in data:
+            out ^= byte << 8
+            for jj in range(8):
+                out = ((out << 1) ^ 0x1021) if out & 0x8000 else (out << 1)
+                out &= 0xFFFF
+        return out
+
+
+class _PSO:
+    # Salida sincronizada con la posicion, equivalente a FIPC_PSO (posiciones en pasos)
+    def __init__(self):
+        self.__pin = 0xFF
+        self.__mode = 1
+        self.disarm()
+
+    def setOutput(self, pin, mode):
+        self.__pin = pin
+        self.__mode = 0 if mode==0 else 1
+
+    def armPitch(self, start, pitch, count):
+        if count==0 or (pitch==0.0 and count>1):
+            return False
+        self.__targets = [start+k*pitch for k in range(count)]
+        return self.__arm()
+
+    def addTable(self, position):
+        if self.__armed or len(self.__table)>=64:
+            return False
+        self.__table.append(position)
+        return True
+
+    def armTable(self):
+        if len(self.__table)==0:
+            return False
+        sense = -1 if len(self.__table)>1 and self.__table[1]<self.__table[0] else 1
+        for ii in range(1, len(self.__table)):
+            if (self.__table[ii]-self.__table[ii-1])*sense<=0:
+                return False
+        self.__targets = list(self.__table)
+        return self.__arm()
+
+    def disarm(self):
+        self.__armed = False
+        self.__table = []
+        self.__targets = []
+        self.__index = 0
+        self.__fired = 0
+        self.__maxError = 0
+
+    def getTargets(self):
+        # (posicion ideal, posicion comparada) en pasos de cada disparo programado
+        return [(tt, int(round(tt))) for tt in self.__targets]
+
+    def check(self, position):
+        # el emulador avanza por tramos y puede alcanzar varias posiciones en una llamada;
+        # el firmware compara en cada paso, por lo que no se acumula error de posicion
+        while self.__armed:
+            if (position-int(round(self.__targets[self.__index])))*self.__sense<0:
+                return
+            self.__fired += 1
+            self.__index += 1
+            if self.__index>=len(self.__targets):
+                self.__armed = False
+
+    def getReport(self):
+        remaining = len(self.__targets)-self.__index if self.__armed else 0
+        return "%d;%d;%d;%d" % (self.__armed, self.__fired, remaining, self.__maxError)
+
+    def __arm(self):
+        self.__sense = -1 if len(self.__targets)>1 and self.__targets[1]<self.__targets[0] else 1
+        self.__index = 0
+        self.__fired = 0
+        self.__maxError = 0
+        self.__armed = True
+        return True
+
+
 class _Axis:    
+    HOME_FACTOR_FAST = 0.1  # factor de la velocidad de la busqueda del cero rapida (FIPC_Axis.cpp)
+
     # Variables virtuales
     __targetPosition = 0.0
     __currentPosition = 0.0
@@ -173,47 +2101,157 @@ class _Axis:
         self.__print = False
         self.__thread_stop = threading.Event()
         self.__thread_moving = threading.Thread(target=self.__moving, args=(self.__thread_stop,))
+        self.pso = _PSO()
+        self.__storage = None
+        self.__record = {"generation":0, "position":0.0, "stage":iType, "homed":0}
+        self.__jogTarget = 0.0
+        self.__jogUpdate = 0.0
+        self.__jogTimeout = 0.5
+        self.__jogStop = False
+        self.__stallVelocity = None
+        self.__stallAccel = None
+        self.__slip = 0.0
+        self.__homingError = 0
+        self.__latency = None
+        self.__moveSpeed = 0.0
         
     def setPrintInfo(self, iPrint = True):
         self.__print = iPrint
+
+    def setLatency(self, latency):
+        # sondas de FIPC_Latency: aceptacion, inicio del hilo y primer paso
+        self.__latency = latency
+
+    def __probe(self, probe):
+        if self.__latency:
+            self.__latency.probe(probe)
+
+    def setStorage(self, storage):
+        # lee el registro guardado, equivalente a FIPC_Persist::begin()
+        self.__storage = storage
+        self.__record = {"generation":0, "position":0.0, "stage":self.__type, "homed":0}
+        if storage is None:
+            return
+        record = storage.read("axis%d" % self.__id)
+        if record and record.get("stage")==self.__type:
+            self.__record = record
+
+    def getStoredReport(self):
+        return "%d;%.2f;%d;0" % (self.__record["homed"], self.__record["position"], self.__record["generation"])
+
+    def __persist(self, homed):
+        # el firmware invalida el registro antes de desplazarse y lo guarda al quedar en reposo
+        if self.__storage is None:
+            return
+        self.__record = {"generation":self.__record["generation"]+1, "position":self.__currentPosition,
+                         "stage":self.__type, "homed":1 if homed else 0}
+        self.__storage.write("axis%d" % self.__id, self.__record)
     
     def __setMotorStage(self, iType):
-        if iType == "MOX_02_30":
-            self.__type = iType;
-            self.__veloMax = 1875
-            self.__minPosition = 0
-            self.__maxPosition = 30000
-            self.__speed = self.__veloMax*0.2
-            self.__accelTime = 1.0
-            self.__units = "um"
-        elif iType == "MOR_100_30":
-            self.__type = iType;
-            self.__veloMax = 3750
-            self.__minPosition = 0
-            self.__maxPosition = 360000
-            self.__speed = self.__veloMax*0.2
-            self.__accelTime = 1.0
-            self.__units = "mgrad"
-        elif iType == "MOG_65_10":
-            self.__type = iType;
-            self.__veloMax = 960
-            self.__minPosition = -15000
-            self.__maxPosition = 15000
-            self.__speed = self.__veloMax*0.2
-            self.__accelTime = 1.0
-            self.__setZero = -15000
-            self.__units = "mgrad"
-        elif iType == "MOG_65_15":
-            self.__type = iType;
-            self.__veloMax = 1350
-            self.__minPosition = -21000
-            self.__maxPosition = 21000
+        self.setConfig(_PRESETS[iType])
+
+    def setConfig(self, config):
+        # equivalente a FIPC_Axis::setConfig(), solo con el eje deshabilitado
+        if self.__axis_status!="STATUS_DISABLE":
+            return False
+        stage = config["stage"]
+        self.__type = _STAGES[stage] if stage<len(_STAGES) else "STAGE_%d" % stage
+        self.__factorToStep = config["stepsPerUnit"]
+        self.__veloMax = config["veloMax"]
+        self.__accelMax = config["accelMax"]
+        self.__minPosition = config["minPosition"]
+        self.__maxPosition = config["maxPosition"]
+        self.__setZero = config["zero"]
+        self.__units = config["units"]
+        self.__speed = self.__veloMax*0.2
+        self.__accelTime = 1.0
+        rate = 150000 if config["flags"]&0x08 else 12000   # CONFIG_PULSE_RMT
+        if config["flags"]&0x10:                            # CONFIG_MICROSTEP
+            rate *= 1 << (config.get("stepFine", 0) - config.get("stepCoarse", 0))
+        self.__rateMax = rate
+        self.__execScale = 0.0 if config["flags"]&0x08 else 1.0
+        if config["flags"]&0x10:
+            self.__execScale /= 1 << (config.get("stepFine", 0) - config.get("stepCoarse", 0))
+        return True
+
+    def setLimits(self, iVeloMax, iAccelMax):
+        # equivalente a FIPC_Axis::setLimits(), solo con el eje en reposo
+        if self.__axis_status not in ("STATUS_DISABLE", "STATUS_NO_HOME", "STATUS_READY"):
+            return False
+        if not (iVeloMax>0.0 and iVeloMax*self.__factorToStep<=self.__rateMax and iAccelMax>0.0):
+            return False
+        self.__veloMax = iVeloMax
+        self.__accelMax = iAccelMax
+        if self.__speed>=self.__veloMax:
             self.__speed = self.__veloMax*0.2
-            self.__accelTime = 1.0
-            self.__setZero = -21000
-            self.__units = "mgrad"
+        return True
+
+    def getSpeedLimit(self):
+        return self.__rateMax/self.__factorToStep
 
-    def setAction(self, iAction = "NOTHING",  iData = 0.0):
+    def getExecRate(self, iAction, iData = 0.0):
+        # pasos/s que exec() emite en una accion, equivalente a FIPC_Axis::getExecRate()
+        if iAction in ("MOVE_RELATIVE", "MOVE_ABSOLUTE"):
+            return self.__speed*self.__factorToStep*self.__execScale
+        if iAction=="JOG":
+            return min(abs(iData), self.__veloSoft())*self.__factorToStep
+        if iAction=="HOMING":
+            return self.HOME_FACTOR_FAST*self.__veloSoft()*self.__factorToStep
+        if iAction=="TRACK":
+            return self.__veloSoft()*self.__factorToStep
+        return 0.0
+
+    def getExecLoad(self):
+        # pasos/s que exec() emite en la accion en curso, equivalente a FIPC_Axis::getExecLoad()
+        if self.__axis_status=="STATUS_MOVING":
+            return self.__moveSpeed*self.__factorToStep*self.__execScale
+        if self.__axis_status=="STATUS_HOMING":
+            return self.HOME_FACTOR_FAST*self.__veloSoft()*self.__factorToStep
+        if self.__axis_status in ("STATUS_JOGGING", "STATUS_TRACKING"):
+            return self.__veloSoft()*self.__factorToStep
+        return 0.0
+
+    def __veloSoft(self):
+        return min(self.__veloMax, 12000.0/self.__factorToStep)
+
+    def setStall(self, iVelocity = None, iAccel = None):
+        # modelo de perdida de pasos: por encima de iAccel se pierde el desplazamiento completo y
+        # por encima de iVelocity el tramo recorrido a mas velocidad (None sin perdida). Los pasos
+        # perdidos se acumulan en un solo sentido, como un eje con carga que lo frena siempre igual.
+        self.__stallVelocity = iVelocity
+        self.__stallAccel = iAccel
+
+    def __lost(self, iRelative):
+        # distancia que el motor no recorre de un desplazamiento iRelative
+        dist = abs(iRelative)
+        accel = self.__speed/self.__accelTime
+        lost = 0.0
+        if self.__stallAccel is not None and accel>self.__stallAccel:
+            lost = dist
+        elif self.__stallVelocity is not None and min(self.__speed, (dist*accel)**0.5)>self.__stallVelocity:
+            lost = max(0.0, dist - self.__stallVelocity**2/(2.0*accel))
+        return lost
+
+    def rehome(self):
+        # equivalente a FIPC_Axis::rehome(): el switch queda fijo y la nueva busqueda mide en el
+        # flanco los pasos perdidos desde la anterior (getHomingError())
+        if self.__axis_status!="STATUS_READY":
+            return False
+        self.__persist(False)
+        self.__homingError = int(round(self.__slip*self.__factorToStep))
+        self.__slip = 0.0
+        self.__currentPosition = self.__setZero
+        self.__persist(True)
+        return True
+
+    def getHomingError(self):
+        return self.__homingError
+
+    def getType(self):
+        return self.__type
+
+    def setAction(self, iAction = "NOTHING",  iData = 0.0, iSpeed = 0.0):
+        # iSpeed: velocidad de este desplazamiento sin cambiar la configurada (0 la configurada)
         out = False        
         if self.__axis_status=="STATUS_DISABLE":            
             if iAction=="ENABLE":
@@ -230,7 +2268,16 @@ class _Axis:
             elif iAction=="HOMING":
                 if self.__print:
                     print("--> GoHome #" + str(self.__id))                    
+                self.__persist(False)
                 self.__currentPosition = self.__setZero
+                self.__slip = 0.0
+                self.__axis_status = "STATUS_READY"
+                self.__persist(True)
+                out = True
+            elif iAction=="RESTORE" and self.__storage and self.__record["homed"]:
+                if self.__print:
+                    print("--> Restore #" + str(self.__id))
+                self.__currentPosition = self.__record["position"]
                 self.__axis_status = "STATUS_READY"
                 out = True
         elif self.__axis_status=="STATUS_READY":
@@ -242,16 +2289,33 @@ class _Axis:
             elif iAction=="MOVE_RELATIVE" and self.__configMoveRelative(iData):
                 if self.__print:
                     print("--> Go Relative #" + str(self.__id) + " " + str(iData))
+                self.__moveSpeed = iSpeed if iSpeed>0.0 else self.__speed
                 self.__thread_moving = threading.Thread(target=self.__moving, args=())
-                self.__thread_moving.start()
+                self.__persist(False)
                 self.__axis_status = "STATUS_MOVING"
+                self.__probe(_Latency.ACCEPT)
+                self.__thread_moving.start()
+                out = True
+            elif iAction=="JOG" and iData!=0.0:
+                if self.__print:
+                    print("--> Jog #" + str(self.__id) + " " + str(iData))
+                self.__configJog(iData)
+                self.__jogStop = False
+                self.__thread_moving = threading.Thread(target=self.__jogging, args=())
+                self.__persist(False)
+                self.__axis_status = "STATUS_JOGGING"
+                self.__probe(_Latency.ACCEPT)
+                self.__thread_moving.start()
                 out = True
             elif iAction=="MOVE_ABSOLUTE" and self.__configMoveAbsolute(iData):
                 if self.__print:
                     print("--> Go Absolute #" + str(self.__id) + " " + str(iData))                
+                self.__moveSpeed = iSpeed if iSpeed>0.0 else self.__speed
                 self.__thread_moving = threading.Thread(target=self.__moving, args=())                    
-                self.__thread_moving.start()
+                self.__persist(False)
                 self.__axis_status = "STATUS_MOVING"
+                self.__probe(_Latency.ACCEPT)
+                self.__thread_moving.start()
                 out = True
         elif self.__axis_status=="STATUS_MOVING":
             if iAction=="STOP":
@@ -260,30 +2324,102 @@ class _Axis:
                 if self.__thread_moving.is_alive():
                     self.__thread_stop.set()
                 out = True               
+        elif self.__axis_status=="STATUS_TRACKING":
+            # se detiene en el lugar como FIPC_Axis, _Kinematics detiene el resto de los ejes
+            if iAction in ("STOP", "DISABLE"):
+                self.__persist(True)
+                self.__axis_status = "STATUS_READY" if iAction=="STOP" else "STATUS_DISABLE"
+                out = True
+        elif self.__axis_status=="STATUS_JOGGING":
+            if iAction=="STOP":
+                self.__jogStop = True
+                out = True
+            elif iAction=="JOG" and not self.__jogStop:
+                self.__configJog(iData)
+                out = True
         return out
 
+    def setJogTimeout(self, iTimeout):
+        self.__jogTimeout = iTimeout/1000.0
+
+    def __configJog(self, iSpeed):
+        self.__jogTarget = max(-self.__veloMax, min(self.__veloMax, iSpeed))
+        self.__jogUpdate = time.time()
+
+    def __jogging(self):
+        # mismo criterio que FIPC_Axis::jog(): rampa, hombre muerto y frenado en los límites
+        Ts = 0.01
+        speed = 0.0
+        accel = self.__speed/self.__accelTime
+        self.__probe(_Latency.PICKUP)
+        while True:
+            stop = self.__jogStop or time.time()-self.__jogUpdate>self.__jogTimeout
+            target = 0.0 if stop else self.__jogTarget
+            speed = max(speed-accel*Ts, min(speed+accel*Ts, target))
+            if speed>0.0:
+                speed = min(speed, (2.0*accel*max(self.__maxPosition-self.__currentPosition, 0.0))**0.5)
+            elif speed<0.0:
+                speed = max(speed, -(2.0*accel*max(self.__currentPosition-self.__minPosition, 0.0))**0.5)
+            self.__currentPosition = max(self.__minPosition, min(self.__maxPosition, self.__currentPosition+speed*Ts))
+            self.pso.check(int(self.__currentPosition*self.__factorToStep))
+            if speed!=0.0:
+                self.__probe(_Latency.STEP)
+            if stop and speed==0.0:
+                break
+            time.sleep(Ts)
+        if self.__print:
+            print("--> --> Position #" + str(self.__id) + " " + str(self.__currentPosition))
+        self.__persist(True)
+        self.__axis_status = "STATUS_READY"
+
     def __moving(self):
         Ts = 0.1
-        total_time = abs(self.__targetPosition-self.__currentPosition)/self.__speed
-        steps = Ts*self.__speed
+        self.__slip += self.__lost(self.__targetPosition-self.__currentPosition)
+        total_time = abs(self.__targetPosition-self.__currentPosition)/self.__moveSpeed
+        steps = Ts*self.__moveSpeed
         number_of_steps = int(total_time/Ts)
+        self.__probe(_Latency.PICKUP)
         for ii in range(number_of_steps):
             if self.__thread_stop.is_set():
+                self.__persist(True)
                 self.__axis_status = "STATUS_READY"
                 return                
             self.__currentPosition += steps
+            self.__probe(_Latency.STEP)
+            self.pso.check(int(self.__currentPosition*self.__factorToStep))
             if self.__print:
                 print("--> --> Position #" + str(self.__id) + " " + str(self.__currentPosition))
             time.sleep(Ts)
         self.__currentPosition = self.__targetPosition
+        self.pso.check(int(self.__currentPosition*self.__factorToStep))
+        self.__probe(_Latency.STEP)   # desplazamiento de menos de un periodo
         if self.__print:
             print("--> --> Position #" + str(self.__id) + " " + str(self.__currentPosition))
+        self.__persist(True)
         self.__axis_status = "STATUS_READY"
 
 
 
+    def startTracking(self):
+        # equivalente a FIPC_Axis::ACTION_TRACK, los destinos los envia _Kinematics
+        self.__persist(False)
+        self.__axis_status = "STATUS_TRACKING"
+
+    def track(self, iAbsolute):
+        if self.__axis_status!="STATUS_TRACKING":
+            return False
+        self.__currentPosition = max(self.__minPosition, min(self.__maxPosition, iAbsolute))
+        self.pso.check(int(self.__currentPosition*self.__factorToStep))
+        return True
+
+    def endTracking(self):
+        if self.__axis_status!="STATUS_TRACKING":
+            return
+        self.__persist(True)
+        self.__axis_status = "STATUS_READY"
+
     def isMoving(self):
-        if self.__axis_status == "STATUS_MOVING":
+        if self.__axis_status in ("STATUS_MOVING", "STATUS_JOGGING", "STATUS_TRACKING"):
             return "1"
         return "0"
 
@@ -296,6 +2432,90 @@ class _Axis:
     def getCurrentPosition(self):
         return str(self.__currentPosition)
 
+    def estimateMoveRelative(self, iRelative, iSpeed = 0.0, iAccelTime = 0.0):
+        # perfil trapezoidal de AccelStepper (triangular si no alcanza la velocidad)
+        if iSpeed==0.0:
+            iSpeed = self.__speed
+        if iAccelTime==0.0:
+            iAccelTime = self.__accelTime
+        dist = abs(iRelative)
+        accel = iSpeed/iAccelTime
+        if dist>=iSpeed*iSpeed/accel:
+            oPeak = iSpeed
+            oTime = dist/iSpeed + iSpeed/accel
+        else:
+            oPeak = (dist*accel)**0.5
+            oTime = 2.0*(dist/accel)**0.5
+        feasible = self.canMoveRelative(iRelative) and iSpeed<self.__veloMax
+        return feasible, oTime, oPeak
+
+    def jumpTo(self, iAbsolute):
+        # posiciona el eje cuantizando en pasos como el firmware, retorna el tiempo empleado
+        steps = int(iAbsolute*self.__factorToStep)
+        dt = abs(steps/self.__factorToStep-self.__currentPosition)/self.__speed
+        self.__slip += self.__lost(steps/self.__factorToStep-self.__currentPosition)
+        self.__currentPosition = steps/self.__factorToStep
+        return dt
+
+    def getMaxSpeed(self):
+        return self.__veloMax
+
+    def getStepsPerUnit(self):
+        return self.__factorToStep
+
+    def timeAtDistance(self, iDistance, iPosition):
+        # instante [s] en que el perfil trapezoidal de un desplazamiento iDistance recorre iPosition
+        accel = self.__speed/self.__accelTime
+        peak = min(self.__speed, (iDistance*accel)**0.5)
+        sAccel = peak*peak/(2.0*accel)
+        total = 2.0*peak/accel + (iDistance-2.0*sAccel)/peak
+        iPosition = min(max(iPosition, 0.0), iDistance)
+        if iPosition<=sAccel:
+            return (2.0*iPosition/accel)**0.5
+        if iPosition<=iDistance-sAccel:
+            return peak/accel + (iPosition-sAccel)/peak
+        return total - (2.0*(iDistance-iPosition)/accel)**0.5
+
+    def distanceAtTime(self, iDistance, iTime):
+        # distancia recorrida en el instante iTime [s] del perfil trapezoidal de un desplazamiento iDistance
+        accel = self.__speed/self.__accelTime
+        peak = min(self.__speed, (iDistance*accel)**0.5)
+        sAccel = peak*peak/(2.0*accel)
+        total = 2.0*peak/accel + (iDistance-2.0*sAccel)/peak
+        iTime = min(max(iTime, 0.0), total)
+        if iTime<=peak/accel:
+            return 0.5*accel*iTime*iTime
+        if iTime<=total-peak/accel:
+            return sAccel + peak*(iTime-peak/accel)
+        return iDistance - 0.5*accel*(total-iTime)**2
+
+    def lineTriggers(self, iPositions, tick):
+        # recorre una linea de barrido hasta la ultima posicion como FIPC_Scan::exec(): cada punto
+        # (salvo el primero, disparado al inicio) dispara en el primer ciclo de exec() en que la
+        # posicion en pasos lo alcanza y registra la posicion de ese ciclo; un unico disparo por
+        # ciclo, los demas puntos del ciclo se pierden.
+        # Retorna las posiciones de disparo, los puntos perdidos y la duracion [s]
+        origin = round(self.__currentPosition*self.__factorToStep)
+        last = int(iPositions[-1]*self.__factorToStep)
+        sign = 1 if last>=origin else -1
+        dist = abs(last-origin)/self.__factorToStep
+        out, missed, previous = [], 0, -1
+        for pp in iPositions[1:]:
+            steps = abs(int(pp*self.__factorToStep)-origin)
+            cycle = math.ceil(self.timeAtDistance(dist, steps/self.__factorToStep)/tick - 1e-9)
+            if cycle==previous:
+                missed += 1
+                continue
+            previous = cycle
+            done = int(self.distanceAtTime(dist, cycle*tick)*self.__factorToStep + 1e-9)
+            out.append((origin + sign*min(max(done, steps), abs(last-origin)))/self.__factorToStep)
+        total = self.timeAtDistance(dist, dist)
+        self.jumpTo(iPositions[-1])
+        return out, missed, total
+
+    def getMaxAcceleration(self):
+        return self.__accelMax
+
 
     def setSpeed(self, iSpeed):
         if self.__axis_status!="STATUS_READY":
@@ -346,6 +2566,10 @@ class _Axis:
             str_out += "Ready"
         elif self.__axis_status == "STATUS_MOVING":
             str_out += "Moving"        
+        elif self.__axis_status == "STATUS_JOGGING":
+            str_out += "Jogging"
+        elif self.__axis_status == "STATUS_TRACKING":
+            str_out += "Tracking"
         return str_out
 
     def __configMoveRelative(self, iRelative):
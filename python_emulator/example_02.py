@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de barrido ejecutado en el controlador (FIPC_Scan).
+Verifica las posiciones del eje en cada disparo (las que mediria un encoder, con el disparo
+emitido en el ciclo de exec() en que el eje alcanza el punto) contra la grilla.
+"""
+
+
+from FIPC_Controler import FIPC_Controler
+import time
+
+
+usb0 = FIPC_Controler()
+usb0.setPrintInfo(False) # True activa la impresion
+
+usb0.sendData("E:")  # habilita todos los ejes
+usb0.sendData("HA:") # busca la referencia de todos los ejes
+
+
+#####################################################
+# Serpentina de 6x4 puntos sobre los ejes #1 (rapido) y #2 (lento)
+#####################################################
+# SCAN:tipo:ejeA:ejeB:ejeC:inicioA:inicioB:inicioC:pasoA:pasoB:pasoC:puntosA:puntosB:puntosC:velocidad:
+start = [1000.0, 2000.0]
+pitch = [50.0, 100.0]
+points = [6, 4]
+print("\n...")
+print("Configura el barrido: " + usb0.sendData("SCAN:1:1:2:0:%g:%g:0:%g:%g:0:%d:%d:1:1500:" %
+                                               (start[0], start[1], pitch[0], pitch[1], points[0], points[1])))
+print("Inicia el barrido: " + usb0.sendData("SCANGO:"))
+
+# Espera el evento de fin de barrido
+event = usb0.readEvents()
+while event=="":
+    time.sleep(0.1)
+    event = usb0.readEvents()
+print("Evento: " + event)
+
+
+#####################################################
+# Verifica la posicion del eje en cada disparo contra la grilla
+#####################################################
+# El disparo se emite en el primer ciclo de exec() en que el eje alcanza el punto: el error
+# esta acotado por un paso mas el avance en un ciclo (25 us) a la velocidad del barrido
+triggers = usb0.getScanTriggers()
+missed = int(event.strip().split(";")[3])
+grid = []
+for bb in range(points[1]):
+    line = [[start[0]+aa*pitch[0], start[1]+bb*pitch[1]] for aa in range(points[0])]
+    if bb%2:
+        line.reverse() # serpentina
+    grid += line
+
+error = 0.0
+for tt, gg in zip(triggers, grid):
+    error = max(error, abs(tt[0]-gg[0]), abs(tt[1]-gg[1]))
+print("Disparos: %d de %d (%d perdidos)" % (len(triggers), len(grid), missed))
+print("Error maximo de posicion: %.4f um" % error)
+assert missed==0 and len(triggers)==len(grid), "Faltan disparos"
+assert error<=1/3.2 + 1500*25e-6, "Los disparos no coinciden con la grilla"
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de busqueda del maximo de potencia optica en el controlador (FIPC_Align).
+La entrada analogica se reemplaza por un modelo gaussiano de acoplamiento para
+comparar la cantidad de evaluaciones y el tiempo de convergencia de cada algoritmo.
+"""
+
+
+from FIPC_Controler import FIPC_Controler
+import time
+
+
+ALGORITHMS = ["Ascenso por coordenadas", "Espiral + gradiente", "Nelder-Mead"]
+
+usb0 = FIPC_Controler()
+usb0.setPrintInfo(False) # True activa la impresion
+
+usb0.sendData("E:")  # habilita todos los ejes
+usb0.sendData("HA:") # busca la referencia de todos los ejes
+usb0.sendData("V:1:1500:V:2:1500:V:3:1500:") # velocidad de los ejes lineales
+
+# maximo de acoplamiento en (X, Y, Z) = (10012, 9991, 15040) um con cintura de 10 um
+usb0.setCouplingModel(center=[10012.0, 9991.0, 15040.0], waist=[10.0, 10.0, 60.0], peak=1000.0, noise=1.0)
+
+print("\n...")
+for alg in range(3):
+    usb0.sendData("MA:1:10000:MA:2:10000:MA:3:15000:") # punto de partida
+    while usb0.sendData("?M:1:")=="1" or usb0.sendData("?M:2:")=="1" or usb0.sendData("?M:3:")=="1":
+        time.sleep(0.1)
+
+    # ALIGN:algoritmo:eje1:eje2:eje3:paso:paso minimo:evaluaciones:umbral:
+    usb0.sendData("ALIGNADC:34:4:ALIGN:%d:1:2:3:5:0.2:400:50:" % alg)
+    event = usb0.readEvents()
+    while event=="":
+        time.sleep(0.05)
+        event = usb0.readEvents()
+    report = event.strip().split(";")
+    print("%-24s evaluaciones: %4s  potencia: %8s  tiempo de desplazamiento: %.2f s" %
+          (ALGORITHMS[alg], report[1], report[2], usb0.getAlignMotionTime()))
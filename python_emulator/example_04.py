@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de salida sincronizada con la posicion (FIPC_PSO).
+Programa disparos equiespaciados, ejecuta el desplazamiento y estima el
+error temporal de cada disparo respecto del perfil trapezoidal ideal.
+"""
+
+
+from FIPC_Controler import FIPC_Controler
+import time
+
+
+usb0 = FIPC_Controler()
+usb0.setPrintInfo(False) # True activa la impresion
+
+usb0.sendData("E:")  # habilita todos los ejes
+usb0.sendData("HA:") # busca la referencia de todos los ejes
+usb0.sendData("V:1:1500:A:1:0.2:")
+
+
+#####################################################
+# 500 disparos cada 10.3 um (paso fraccionario en pasos) a partir de 1000 um
+#####################################################
+start, pitch, count = 1000.0, 10.3, 500
+print("\n...")
+print("Programa la salida: " + usb0.sendData("PSOP:1:4:1:PSO:1:%g:%g:%d:" % (start, pitch, count)))
+
+# Error temporal: instante del paso que alcanza la posicion, cuantizado al ciclo de exec()
+tick = 25e-6
+timing = usb0.getPSOTiming(1, 7000.0, tick)
+error = [fired-ideal for ideal, fired in timing]
+print("Error temporal (ciclo %g us): min %.1f us, max %.1f us" %
+      (tick*1e6, min(error)*1e6, max(error)*1e6))
+
+usb0.sendData("MA:1:7000:")
+while usb0.sendData("?M:1:").strip()=="1":
+    time.sleep(0.1)
+
+report = usb0.sendData("?PSO:1:").strip()
+print("Reporte (habilitado;disparos;restantes;error en pasos): " + report)
+fired = int(report.split(";")[1])
+assert fired==count and len(timing)==count, "La cantidad de disparos no coincide"
+# la posicion se redondea al paso mas cercano: el error es menor que medio paso mas un ciclo
+assert max(abs(ee) for ee in error)<=0.5/(1500*3.2)+tick, "El error temporal supera medio paso mas un ciclo"
@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de arranque rapido con la posicion guardada en memoria no volatil (FIPC_Persist).
+La NVS del controlador se reemplaza por archivos con el prefijo indicado, en el directorio
+temporal para no escribirlos en el arbol de fuentes.
+"""
+
+
+from FIPC_Controler import FIPC_Controler
+import time
+import glob
+import os
+import tempfile
+
+
+storage = os.path.join(tempfile.gettempdir(), "fipc_nvs")
+for name in glob.glob(storage + "_*"):
+    os.remove(name)
+
+#####################################################
+# Primer encendido: busca el cero y se desplaza
+#####################################################
+usb0 = FIPC_Controler(storage)
+usb0.sendData("E:HA:")
+usb0.sendData("V:1:1500:MA:1:1200:")
+while usb0.sendData("?M:1:").strip()=="1":
+    time.sleep(0.1)
+print("\n...")
+print("Posicion antes del reinicio: " + usb0.sendData("?P:1:"))
+print("Registro guardado: " + usb0.sendData("?NV:1:"))
+
+#####################################################
+# Reinicio: restaura la posicion sin buscar el cero
+#####################################################
+usb0 = FIPC_Controler(storage)
+usb0.sendData("E:HRA:")
+print("Estado luego de restaurar: " + usb0.sendData("?S:1:"))
+print("Posicion luego de restaurar: " + usb0.sendData("?P:1:"))
+assert usb0.sendData("?S:1:")=="Ready" and float(usb0.sendData("?P:1:"))==1200.0, "No se restauro la posicion"
+
+for name in glob.glob(storage + "_*"):
+    os.remove(name)
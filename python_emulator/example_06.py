@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo del modo velocidad (JOG) tal como lo usaria un joystick: se envian
+actualizaciones periodicas de la velocidad, al dejar de enviarlas el eje
+desacelera solo (hombre muerto) y nunca supera los limites del eje.
+"""
+
+
+from FIPC_Controler import FIPC_Controler
+import time
+
+
+usb0 = FIPC_Controler()
+usb0.sendData("E:HA:")
+usb0.sendData("JOGT:300:")
+
+#####################################################
+# Joystick: avanza, invierte y suelta
+#####################################################
+for velocity in [200, 400, 400, 400, -300, -300, -300]:
+    usb0.sendData("JOG:1:%f:" % velocity)
+    time.sleep(0.1)
+    print("v=%6.1f  %s" % (velocity, usb0.sendData("?R:1:")))
+
+# sin actualizaciones el eje se detiene solo
+while usb0.sendData("?M:1:")=="1":
+    time.sleep(0.05)
+print("\nLuego del tiempo limite: " + usb0.sendData("?R:1:"))
+assert usb0.sendData("?S:1:")=="Ready", "El eje no se detuvo"
+
+#####################################################
+# Limite de software: frena exactamente en el maximo
+#####################################################
+usb0.sendData("V:1:1500:MA:1:29800:")
+while usb0.sendData("?M:1:")=="1":
+    time.sleep(0.1)
+for ii in range(30):
+    usb0.sendData("JOG:1:1500:")
+    time.sleep(0.05)
+print("Contra el limite: " + usb0.sendData("?R:1:"))
+assert float(usb0.sendData("?P:1:"))==30000.0, "Supero el limite"
+usb0.sendData("S:1:")
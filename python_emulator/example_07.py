@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de cambio de la configuracion de un eje sin recompilar el firmware (FIPC_Config).
+Se lee el bloque activo, se reemplaza el eje #1 por una platina de 50 mm y se carga el
+nuevo bloque; luego de un reinicio el controlador arranca con la configuracion guardada.
+"""
+
+
+import sys
+import os
+import glob
+import time
+import tempfile
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python_lib"))
+
+from FIPC_Controler import FIPC_Controler
+import module_stage_config as stage_config
+
+
+# NVS del controlador en el directorio temporal, fuera del arbol de fuentes
+storage = os.path.join(tempfile.gettempdir(), "fipc_nvs")
+for name in glob.glob(storage + "_*"):
+    os.remove(name)
+
+usb0 = FIPC_Controler(storage)
+print("Configuracion inicial: " + usb0.sendData("?CFG:"))
+
+#####################################################
+# Nueva platina en el eje #1
+#####################################################
+axes = stage_config.read(usb0.sendData)
+axes[0].update({"stage":10, "units":"um", "stepsPerUnit":1.6, "minPosition":0, "maxPosition":50000,
+                "veloMax":3000, "accelMax":12000, "zero":0, "flags":stage_config.LIMITS})
+
+t0 = time.time()
+usb0.sendData("D:")
+assert stage_config.write(usb0.sendData, axes), "Configuracion rechazada"
+print("Carga en %.1f s: %s" % (time.time()-t0, usb0.sendData("?CFG:")))
+
+usb0.sendData("E:H:1:")
+usb0.sendData("MA:1:45000:")
+while usb0.sendData("?M:1:").strip()=="1":
+    time.sleep(0.1)
+print("Nuevo recorrido: " + usb0.sendData("?R:1:"))
+
+# un bloque invalido (velocidad sobre 12 kHz) se rechaza y se conserva el anterior
+axes[0]["veloMax"] = 9000
+usb0.sendData("D:")
+assert not stage_config.write(usb0.sendData, axes), "Configuracion invalida aceptada"
+
+#####################################################
+# Reinicio: lee la configuracion guardada
+#####################################################
+usb1 = FIPC_Controler(storage)
+print("Luego del reinicio: " + usb1.sendData("?CFG:"))
+assert stage_config.read(usb1.sendData)[0]["maxPosition"]==50000
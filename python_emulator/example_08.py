@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de rotaciones alrededor de la punta de una fibra (FIPC_Kinematics).
+Se define el pivote 12 mm sobre el centro de rotacion de la platina y se gira la
+herramienta con un unico comando: el controlador compensa X, Y y Z en cada ciclo
+para que la punta no se desplace, sin enviar un SYNCA por cada paso angular.
+"""
+
+
+from FIPC_Controler import FIPC_Controler
+import time
+
+
+usb0 = FIPC_Controler()
+usb0.sendData("E:HA:")
+usb0.sendData("SYNCAF:15000:15000:15000:90000:0:0:")
+while usb0.sendData("?M:1:")=="1" or usb0.sendData("?M:4:")=="1":
+    time.sleep(0.1)
+
+usb0.sendData("KP:0:0:12000:")
+start = usb0.sendData("?K:").strip().split(";")
+print("Pose inicial: " + ";".join(start))
+
+#####################################################
+# Barrido angular alrededor de X con el pivote fijo
+#####################################################
+for angle in [500, 500, -1500]:
+    duration = float(usb0.sendData("KMR:0:0:0:0:%d:0:0:0:" % angle))
+    assert duration>0.0, "Desplazamiento rechazado"
+    while usb0.sendData("?K:").startswith("Moving"):
+        time.sleep(0.05)
+    pose = usb0.sendData("?K:").strip().split(";")
+    print("b=%8.1f mgrad  X=%s Y=%s Z=%s  (%.2f s)" % (float(pose[5]), usb0.sendData("?P:1:"),
+          usb0.sendData("?P:2:"), usb0.sendData("?P:3:"), duration))
+    for ii in range(1, 4):
+        assert abs(float(pose[ii])-float(start[ii]))<0.01, "El pivote se desplazo"
+
+# traslacion de 100 um en el sistema de la herramienta
+usb0.sendData("KMR:0:100:0:0:0:0:0:0:")
+while usb0.sendData("?K:").startswith("Moving"):
+    time.sleep(0.05)
+print("\nLuego de avanzar en Y de la herramienta: " + usb0.sendData("?K:"))
+print(usb0.readEvents())
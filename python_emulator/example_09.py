@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de programa almacenado en el controlador (FIPC_Program).
+Se compila una receta de soldadura por puntos a lo largo del eje #1: el controlador va a la
+posicion de carga, espera el sensor de pieza y repite desplazamiento y disparo sin que el
+host envie un comando por paso. Al terminar se envia el evento "PRG:Done;...".
+"""
+
+
+import sys
+import os
+import time
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python_lib"))
+
+from FIPC_Controler import FIPC_Controler
+import module_program as program
+
+
+recipe = """
+pos carga 15000 15000 15000 90000 0 0
+E:HA:
+wait
+goto carga                 # menor tiempo posible
+wait
+trigger 4 1 5000           # sensor de pieza en la GPIO 4 (5 s como maximo)
+set v0 0
+loop 5
+  move rel 1 200
+  wait 1
+  delay 100                # disparo del laser
+  add v0 1
+end
+getpos v1 1
+"""
+
+usb0 = FIPC_Controler()
+code = program.compile(recipe)
+print("Programa de %d bytes" % len(code.pack()))
+assert program.upload(usb0.sendData, code), "Programa rechazado"
+print("Programa cargado: " + usb0.sendData("?PRG:"))
+
+#####################################################
+# Ejecucion sin intervencion del host
+#####################################################
+assert program.run(usb0.sendData), "No se pudo iniciar el programa"
+while usb0.sendData("?PRG:").startswith("Running"):
+    time.sleep(0.5)
+print(usb0.readEvents())
+print("Puntos: %s  Posicion final del eje #1: %s" % (usb0.sendData("?PRGV:0:").strip(),
+      usb0.sendData("?PRGV:1:").strip()))
+
+# una secuencia de comandos del host se convierte en programa agregando las esperas
+legacy = ["MA:1:15000:", "MR:2:-500:", "SYNCRF:100:100:0:0:0:0:"]
+assert program.upload(usb0.sendData, program.from_commands(legacy))
+assert program.run(usb0.sendData)
+while usb0.sendData("?PRG:").startswith("Running"):
+    time.sleep(0.5)
+print(usb0.readEvents())
+print(usb0.sendData("?RA:"))
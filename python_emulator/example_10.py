@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo del punto de acceso por red (FIPC_Network) con el emulador en la misma PC.
+Un cliente envia comandos y mide la latencia de cada respuesta mientras otros dos reciben
+la telemetria cada 10 ms y los eventos, sin consultar el estado con "?RA:".
+"""
+
+
+import sys
+import os
+import time
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python_lib"))
+
+from FIPC_Controler import FIPC_Controler
+from module_network import FIPC_network
+
+
+usb0 = FIPC_Controler()
+port = usb0.serve(0)             # puerto libre elegido por el sistema operativo
+print("Emulador escuchando en el puerto %d" % port)
+
+command = FIPC_network("comandos")
+command.open("127.0.0.1", port)
+monitors = []
+for ii in range(2):
+    monitor = FIPC_network("monitor %d" % ii)
+    monitor.open("127.0.0.1", port)
+    print(monitor.name + ": " + monitor.subscribe(events=True, telemetry=True, period=10).strip())
+    monitors.append(monitor)
+
+#####################################################
+# Latencia de comandos
+#####################################################
+latency = []
+for ii in range(200):
+    t0 = time.perf_counter()
+    command.ask("?P:1:")
+    latency.append((time.perf_counter() - t0)*1e3)
+latency.sort()
+print("Latencia de ?P: mediana %.2f ms, p99 %.2f ms, maxima %.2f ms" %
+      (latency[len(latency)//2], latency[int(len(latency)*0.99)], latency[-1]))
+
+#####################################################
+# Telemetria durante un desplazamiento
+#####################################################
+command.ask("E:HA:")
+while command.ask("?RA:").count("Ready") < 6:
+    time.sleep(0.2)
+for monitor in monitors:
+    monitor.readTelemetry()
+t0 = time.time()
+print("Tiempo del desplazamiento: " + command.ask("SYNCRF:2000:0:0:0:0:0:").strip() + " s")
+time.sleep(2.0)
+elapsed = time.time() - t0
+for monitor in monitors:
+    frames = monitor.readTelemetry()
+    moving = [f for f in frames if f[2] & 0x01]
+    print("%s: %d tramas en %.1f s (%.0f tramas/s), %d con el eje #1 en movimiento, ultima posicion %.2f" %
+          (monitor.name, len(frames), elapsed, len(frames)/elapsed, len(moving), frames[-1][1][0] if frames else 0.0))
+
+#####################################################
+# Eventos: fin de un giro alrededor del pivote
+#####################################################
+command.ask("KP:0:0:0:KMR:0:0:0:0:100:0:0:0:")
+events = ""
+while not events:
+    time.sleep(0.2)
+    events = monitors[0].readEvents()
+print("Eventos: " + events.strip())
+print("Estado de la red (conexiones;bytes enviados;tramas descartadas): " + command.ask("?NET:").strip())
+
+command.close()
+for monitor in monitors:
+    monitor.close()
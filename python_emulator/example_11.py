@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de grabacion y reproduccion de una sesion (FIPC_Recorder).
+Se graba una sesion en un emulador, se guarda el registro y se reproduce en otro emulador
+con los tiempos originales y lo mas rapido posible, comparando el tiempo de movimiento.
+Con un controlador real la sesion se descarga con session.download(fipc.ask).
+"""
+
+
+import sys
+import os
+import time
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python_lib"))
+
+from FIPC_Controler import FIPC_Controler
+import module_session as session
+
+
+#####################################################
+# Sesion grabada
+#####################################################
+usb0 = FIPC_Controler()
+usb0.sendData("E:HA:")
+while usb0.sendData("?RA:").count("Ready") < 6:
+    time.sleep(0.2)
+usb0.sendData("REC:1:")
+usb0.sendData("SYNCRF:1000:500:0:0:0:0:")
+time.sleep(0.5)
+usb0.sendData("?RA:")
+usb0.sendData("MR:3:800:")
+time.sleep(1.0)
+usb0.sendData("S:3:")
+usb0.sendData("SYNCRF:-500:0:0:0:0:0:")
+time.sleep(1.5)
+data = session.download(usb0.sendData)
+session.save("session.bin", data)
+recorded = session.summary(session.parse(data))
+print("Registro de %d bytes: %d solicitudes, %d cambios de estado" %
+      (len(data), recorded["requests"], recorded["transitions"]))
+print("Estado de la grabacion: " + usb0.sendData("?REC:").strip())
+
+#####################################################
+# Reproduccion
+#####################################################
+records = session.parse(session.load("session.bin"))
+for realtime in (True, False):
+    usb1 = FIPC_Controler()
+    session.prepare(usb1.sendData, records)
+    replayed = session.replay(usb1.sendData, records, realtime)
+    print("\nReproduccion %s" % ("con los tiempos originales" if realtime else "sin esperas"))
+    print("%-12s %12s %12s" % ("", "grabada", "reproducida"))
+    print(session.compare(recorded, replayed))
+os.remove("session.bin")
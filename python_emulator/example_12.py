@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de dos controladores sincronizados con la linea de disparo (FIPC_Sync), por ejemplo
+las plataformas de la fibra de entrada y de salida. Los desplazamientos se retienen en ambos
+emuladores y el disparo del lider los inicia a la vez. La telemetria de cada controlador se
+lleva a la base de tiempo de la PC con la diferencia de relojes para comparar los inicios.
+"""
+
+
+import sys
+import os
+import time
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python_lib"))
+
+from FIPC_Controler import FIPC_Controler, FIPC_SyncLine
+from module_network import FIPC_network
+import module_sync as sync
+
+
+line = FIPC_SyncLine()                 # el cable entre las GPIO 4 de ambos controladores
+stages = []
+for name in ("entrada", "salida"):
+    emulator = FIPC_Controler(line=line)
+    client = FIPC_network(name)
+    client.open("127.0.0.1", emulator.serve(0))
+    stages.append(client)
+    time.sleep(0.25)                   # relojes desfasados, como dos controladores encendidos por separado
+leader, follower = stages
+asks = [stage.ask for stage in stages]
+
+for ask in asks:
+    ask("E:HA:")
+for stage in stages:
+    while stage.ask("?RA:").count("Ready") < 6:
+        time.sleep(0.2)
+sync.setup(leader.ask, [follower.ask], pin=4)
+
+#####################################################
+# Diferencia de relojes
+#####################################################
+offsets = [sync.clockOffset(ask) for ask in asks]
+for stage, (offset, rtt) in zip(stages, offsets):
+    print("%s: reloj - PC = %.0f us (ida y vuelta %.0f us)" % (stage.name, offset, rtt))
+sync.fire(leader.ask, asks)            # disparo sin acciones: solo registra el instante en ambos
+print("Desfasaje de relojes medido con el disparo: %d us" % sync.edgeOffsets(leader.ask, [follower.ask])[0])
+
+#####################################################
+# Desplazamientos retenidos e iniciados con el disparo
+#####################################################
+for stage in stages:
+    stage.subscribe(events=False, telemetry=True, period=1)
+sync.arm(leader.ask, "SYNCRF:1500:0:0:0:0:0:")
+sync.arm(follower.ask, "SYNCRF:1000:0:0:0:0:0:")
+time.sleep(0.5)
+for stage in stages:
+    stage.readTelemetry()
+print("Retenidos: " + " | ".join(ask("?LINK:").strip() for ask in asks))
+sync.fire(leader.ask, asks)
+time.sleep(0.5)
+starts = []
+for stage, (offset, rtt) in zip(stages, offsets):
+    frames = sync.toHost(stage.readTelemetry(), offset)
+    moving = [frame for frame in frames if frame[2] & 0x01]
+    starts.append(moving[0][0] if moving else float("nan"))
+    print("%s: inicio del eje #1 en t = %.4f s" % (stage.name, starts[-1]))
+print("Diferencia entre los inicios: %.1f ms (resolucion de la telemetria 1 ms)" % ((starts[1] - starts[0])*1e3))
+
+for stage in stages:
+    stage.close()
@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de la caracterizacion de la velocidad y la aceleracion maxima de un eje (FIPC_Tune).
+El emulador pierde pasos por encima de los umbrales del modelo de perdida; cada ensayo repite
+idas y vueltas y busca el cero de nuevo para medir los pasos perdidos en el flanco del switch.
+Los limites medidos, con el margen de seguridad, quedan guardados en la configuracion.
+"""
+
+
+import sys
+import os
+import time
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python_lib"))
+
+from FIPC_Controler import FIPC_Controler
+
+
+usb0 = FIPC_Controler()
+usb0.sendData("E:HA:")
+time.sleep(0.2)
+print("Configuracion (guardada;crc;ejes): " + usb0.sendData("?CFG:").strip())
+
+#####################################################
+# Eje #1 con perdida de pasos a 1500 um/s y 9000 um/s^2
+#####################################################
+usb0.setStallModel(1, velocity=1500.0, accel=9000.0)
+print("TUNE: " + usb0.sendData("TUNE:1:5000:3:2:").strip())     # 5 mm, 3 ciclos, tolerancia 2 um
+while True:
+    events = usb0.readEvents()
+    if "TUNE:" in events:
+        break
+    print("Estado: " + usb0.sendData("?TUNE:").strip())
+    time.sleep(0.05)
+status, id, trials, velo, accel, error = usb0.sendData("?TUNE:").strip().split(";")
+print("%s en %s ensayos: velocidad %s um/s, aceleracion %s um/s^2" % (status, trials, velo, accel))
+print("Configuracion (guardada;crc;ejes): " + usb0.sendData("?CFG:").strip())
@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Ejemplo de la medicion de la latencia desde la recepcion de un comando hasta el primer paso
+(FIPC_Latency). Cada desplazamiento "MR:" recorre las sondas de recepcion, interpretacion,
+aceptacion del eje, aplicacion en exec() y primer paso; "?LAT:" retorna el resumen de cada
+etapa y "?LATH:" su histograma en intervalos de 2^n us.
+"""
+
+
+import sys
+import os
+import time
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python_lib"))
+
+from FIPC_Controler import FIPC_Controler
+
+
+STAGES = ("recepcion", "interpretacion", "aceptacion", "espera de exec", "primer paso", "total")
+
+usb0 = FIPC_Controler()
+usb0.sendData("E:HA:")
+time.sleep(0.2)
+usb0.sendData("LATX:")
+
+#####################################################
+# Desplazamientos del eje #1 con consultas "?M:" como python_lib/example_01.py
+#####################################################
+for ii in range(20):
+    usb0.sendData("MR:1:%d:" % (50 if ii%2 else -50))
+    while usb0.sendData("?M:1:").strip()=="1":
+        time.sleep(0.02)
+
+print("%-16s %8s %8s %8s %8s %8s %8s" % ("etapa [us]", "muestras", "minimo", "media", "maximo", "p50", "p99"))
+for stage, name in enumerate(STAGES):
+    print("%-16s %8s %8s %8s %8s %8s %8s" % ((name,) + tuple(usb0.sendData("?LAT:%d:" % stage).strip().split(";"))))
+print("Histograma del total: " + usb0.sendData("?LATH:5:").strip())
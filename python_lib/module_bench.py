@@ -0,0 +1,232 @@
+# -*- coding: utf-8 -*-
+"""
+Benchmark de cargas de trabajo de produccion: cuantos puntos de alineacion por minuto entrega
+una version del firmware, con el enlace serie de la PC modelado.
+
+La referencia para comparar commits es el benchmark del firmware en el host, con el reloj
+simulado, el enlace de 115200 baudios y la duracion de exec() modelados (firmware/host_test/bench.cpp):
+
+    make -C firmware/host_test bench OUT=$PWD/bench_$(git rev-parse --short HEAD).json
+
+Este modulo ejecuta las mismas cargas en un controlador real y lee o compara los resultados
+de ambos. SerialLink envia los comandos por la funcion recibida y cuenta el tiempo de
+transmision de un enlace de 115200 baudios (10 bits por byte) de cada solicitud y respuesta:
+
+    link = bench.SerialLink(fipc.ask, delay=False)
+    results = bench.run(link)
+    bench.save("bench_%s.json" % commit, results)
+    print(bench.compare(bench.load("bench_base.json"), results))
+
+Cargas (WORKLOADS):
+    homing      arranque en frio: "D:", "E:", "HA:" y espera de los 6 ejes con "?RA:"
+    raster      barrido 2D de "MR:" de los ejes #1 y #2 con consultas "?M:" (python_lib/example_01.py)
+    goniometer  barridos "SYNCA:" repetidos de los ejes #5 y #6 alrededor del centro del recorrido
+    polling     consultas "?RA:" continuas durante un desplazamiento largo del eje #3
+
+Resultado de cada carga (diccionario, guardado en JSON):
+    points          puntos completados (referencias, posiciones o consultas)
+    seconds         duracion en s
+    pointsPerMinute puntos por minuto
+    requests        solicitudes enviadas
+    bytesOut/In     bytes enviados y recibidos
+    linkUtilization tiempo de transmision sobre la duracion
+    execCycles      ciclos de exec() de mas de 80 us (RECORDER_EXEC_LIMIT), de "?REC:"
+    execMax         mayor duracion de exec() en us, de "?REC:"
+    stretch         duracion del desplazamiento sobre la estimada de "?TR:" (solo polling)
+
+Las esperas de los desplazamientos son con "?M:" o hasta que el eje deja "Moving": mientras la
+accion aceptada espera el registro de la posicion "?RA:" sigue en "Ready" (ver FIPC_Persist.h).
+Las funciones reciben la funcion que envia un comando y retorna la respuesta, por ejemplo
+FIPC_controler.ask o FIPC_network.ask.
+"""
+
+import json
+import time
+
+BAUDRATE = 115200
+BITS_PER_BYTE = 10           # 8N1
+
+WORKLOADS = ("homing", "raster", "goniometer", "polling")
+METRICS = ("points", "seconds", "pointsPerMinute", "requests", "bytesOut", "bytesIn",
+           "linkUtilization", "execCycles", "execMax", "stretch")
+
+class SerialLink:
+    # enlace serie modelado: cuenta los bytes y espera el tiempo de transmision de cada sentido
+    def __init__(self, ask, baudrate=BAUDRATE, delay=True):
+        self.raw = ask
+        self.baudrate = baudrate
+        self.delay = delay
+        self.reset()
+
+    def reset(self):
+        self.requests = 0
+        self.bytesOut = 0
+        self.bytesIn = 0
+        self.busy = 0.0
+
+    def ask(self, text):
+        out = len(text) + 1                      # '\n' final
+        self.__wire(out)
+        reply = self.raw(text)
+        self.__wire(len(reply))
+        self.requests += 1
+        self.bytesOut += out
+        self.bytesIn += len(reply)
+        return reply
+
+    def __wire(self, size):
+        seconds = size*BITS_PER_BYTE/float(self.baudrate)
+        self.busy += seconds
+        if self.delay and seconds > 0.0:
+            time.sleep(seconds)
+
+def homing(link, timeout=120.0):
+    # "E:" se aplica en el ciclo de exec(): "HA:" en la misma linea encuentra los ejes deshabilitados
+    link.ask("D:")
+    link.ask("E:")
+    link.ask("HA:")
+    _wait(link, timeout, lambda report: report.count("Ready") >= 6)
+    return 1
+
+def raster(link, nx=4, ny=4, step=50.0, origin=(1000.0, 1000.0), timeout=120.0):
+    # serpentina de nx por ny puntos con desplazamientos relativos y consultas "?M:" por eje
+    link.ask("MA:1:%.3f:MA:2:%.3f:" % origin)
+    _waitAxis(link, 1, timeout)
+    _waitAxis(link, 2, timeout)
+    points = 1
+    for row in range(ny):
+        direction = 1 if row%2==0 else -1
+        for col in range(nx-1):
+            link.ask("MR:1:%.3f:" % (direction*step))
+            _waitAxis(link, 1, timeout)
+            points += 1
+        if row < ny-1:
+            link.ask("MR:2:%.3f:" % step)
+            _waitAxis(link, 2, timeout)
+            points += 1
+    return points
+
+def center(link, timeout=120.0):
+    # lleva los ejes #5 y #6 al centro del recorrido: la referencia esta en el extremo negativo
+    target = [float(link.ask("?P:%d:" % (ii+1)).strip()) for ii in range(6)]
+    target[4] = target[5] = 0.0
+    link.ask("SYNCAF:" + "".join("%.3f:" % value for value in target))
+    _waitAxis(link, 5, timeout)
+    _waitAxis(link, 6, timeout)
+
+def goniometer(link, sweeps=2, points=5, span=1000.0, time_=0.5, accel=0.1, timeout=120.0):
+    # barridos sincronicos de los ejes #5 y #6 alrededor de la posicion actual (ver center())
+    start = [float(link.ask("?P:%d:" % (ii+1)).strip()) for ii in range(6)]
+    done = 0
+    for sweep in range(sweeps):
+        for jj in range(points):
+            k = jj if sweep%2==0 else points-1-jj
+            offset = span*(k/float(points-1) - 0.5)
+            target = list(start)
+            target[4] += offset
+            target[5] -= offset
+            _syncAbsolute(link, target, time_, accel, timeout)
+            done += 1
+    _syncAbsolute(link, start, time_, accel, timeout)
+    return done
+
+def polling(link, distance=2000.0, timeout=120.0):
+    # consultas "?RA:" sin espera durante un desplazamiento de ida y vuelta; retorna tambien
+    # el estiramiento del desplazamiento respecto de la estimacion
+    estimate = float(link.ask("?TR:3:%.3f:" % distance).strip().split(";")[1])   # "factible;duracion;velocidad"
+    start = time.monotonic()
+    queries = 0
+    for target in (distance, -distance):
+        link.ask("MR:3:%.3f:" % target)
+        moving = False
+        while time.monotonic() - start < timeout:
+            queries += 1
+            now = "Moving" in link.ask("?RA:")
+            if moving and not now:
+                break
+            moving = now
+    elapsed = time.monotonic() - start
+    return queries, (elapsed/(2.0*estimate) if estimate > 0.0 else 0.0)
+
+def measure(link, name, **options):
+    # ejecuta una carga y arma su resultado; la grabacion de la sesion cuenta los ciclos lentos
+    link.raw("REC:1:")
+    link.reset()
+    start = time.monotonic()
+    stretch = 0.0
+    if name == "homing":
+        points = homing(link, **options)
+    elif name == "raster":
+        points = raster(link, **options)
+    elif name == "goniometer":
+        points = goniometer(link, **options)
+    elif name == "polling":
+        points, stretch = polling(link, **options)
+    else:
+        raise ValueError(name)
+    seconds = time.monotonic() - start
+    link.raw("REC:0:")
+    fields = link.raw("?REC:").strip().split(";")
+    return {"points": points,
+            "seconds": seconds,
+            "pointsPerMinute": points*60.0/seconds if seconds > 0.0 else 0.0,
+            "requests": link.requests,
+            "bytesOut": link.bytesOut,
+            "bytesIn": link.bytesIn,
+            "linkUtilization": link.busy/seconds if seconds > 0.0 else 0.0,
+            "execCycles": int(fields[7]) if len(fields) > 7 else 0,
+            "execMax": int(fields[6]) if len(fields) > 6 else 0,
+            "stretch": stretch}
+
+def run(link, workloads=WORKLOADS, options=None, label=""):
+    # la referencia de los ejes la hace la primera carga: homing debe ir primero
+    options = options or {}
+    results = {"label": label, "baudrate": link.baudrate, "time": time.strftime("%Y-%m-%dT%H:%M:%S"), "workloads": {}}
+    for name in workloads:
+        if name == "goniometer":
+            center(link)                         # fuera de la medicion
+        results["workloads"][name] = measure(link, name, **options.get(name, {}))
+    return results
+
+def save(path, results):
+    with open(path, "w") as file:
+        json.dump(results, file, indent=2, sort_keys=True)
+
+def load(path):
+    with open(path) as file:
+        return json.load(file)
+
+def compare(base, other):
+    # tabla de las metricas de dos resultados con la variacion relativa
+    lines = ["%-12s %-16s %12s %12s %8s" % ("carga", "metrica", base.get("label", ""), other.get("label", ""), "%")]
+    for name in WORKLOADS:
+        if name not in base["workloads"] or name not in other["workloads"]:
+            continue
+        for key in METRICS:
+            a = base["workloads"][name].get(key, 0)
+            b = other["workloads"][name].get(key, 0)
+            change = "%+.1f" % ((b-a)*100.0/a) if a else ""
+            lines.append("%-12s %-16s %12.3f %12.3f %8s" % (name, key, a, b, change))
+    return "\n".join(lines)
+
+def _syncAbsolute(link, target, time_, accel, timeout):
+    link.ask("SYNCA:" + "".join("%.3f:" % value for value in target) + "%.3f:%.3f:" % (time_, accel))
+    _waitAxis(link, 5, timeout)
+    _waitAxis(link, 6, timeout)
+
+def _waitAxis(link, id, timeout):
+    # consulta "?M:" sin espera, como python_lib/example_01.py
+    limit = time.monotonic() + timeout
+    while time.monotonic() < limit:
+        if link.ask("?M:%d:" % id).strip() != "1":
+            return True
+    return False
+
+def _wait(link, timeout, done=None):
+    # espera el reposo de todos los ejes
+    limit = time.monotonic() + timeout
+    while time.monotonic() < limit:
+        report = link.ask("?RA:")
+        if done(report) if done else not any(value in report for value in ("Homing", "Moving", "Jogging", "Tracking")):
+            return True
+    return False
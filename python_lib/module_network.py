@@ -0,0 +1,98 @@
+# -*- coding: utf-8 -*-
+"""
+Cliente del punto de acceso por red del controlador, equivalente a FIPC_Network del firmware.
+
+Los comandos son los mismos que por el puerto serie (una lista por linea). Cada respuesta
+termina con la linea ">" y las lineas que comienzan con '!' son asincronicas:
+
+    !LIMIT:1;1;1234                     # eventos (suscripcion 0x01)
+    !TEL:ms;p1;p2;p3;p4;p5;p6;mascara   # telemetria periodica (suscripcion 0x02)
+
+Un hilo separa las respuestas de las lineas asincronicas, por lo que ask() puede usarse
+mientras llega la telemetria. ask() tiene la misma forma que FIPC_controler.ask y
+FIPC_Controler.sendData del emulador, por ejemplo para module_program.upload().
+"""
+
+import socket
+import threading
+import queue
+
+NET_PORT = 5025
+NET_SUB_EVENTS = 0x01
+NET_SUB_TELEMETRY = 0x02
+
+class FIPC_network:
+    def __init__(self, name='FIPC_network'):
+        self.name = name
+        self.__socket = None
+        self.__thread = None
+        self.__responses = queue.Queue()
+        self.__events = queue.Queue()
+        self.__telemetry = queue.Queue()
+        self.__lock = threading.Lock()
+
+    def open(self, host='192.168.4.1', port=NET_PORT, timeout=5.0):
+        self.__socket = socket.create_connection((host, port), timeout)
+        self.__socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.__socket.settimeout(None)
+        self.__thread = threading.Thread(target=self.__read, daemon=True)
+        self.__thread.start()
+
+    def close(self):
+        if self.__socket:
+            self.__socket.close()
+            self.__socket = None
+
+    def send(self, data):
+        # solo comandos sin respuesta pendiente de leer: usar ask()
+        self.__socket.sendall(data.encode('utf-8'))
+
+    def ask(self, command, timeout=5.0):
+        # una respuesta por linea: el lock evita mezclar las respuestas de dos hilos
+        with self.__lock:
+            self.__socket.sendall((command.rstrip('\n') + '\n').encode('utf-8'))
+            return self.__responses.get(timeout=timeout)
+
+    def subscribe(self, events=True, telemetry=False, period=10):
+        mask = (NET_SUB_EVENTS if events else 0) | (NET_SUB_TELEMETRY if telemetry else 0)
+        return self.ask("NETSUB:%d:%d:" % (mask, period))
+
+    def readEvents(self):
+        # eventos recibidos sin el prefijo '!', equivalente a FIPC_Controler.readEvents()
+        out = ""
+        while not self.__events.empty():
+            out += self.__events.get() + "\n"
+        return out
+
+    def readTelemetry(self):
+        # lista de tramas (ms, [posicion de cada eje], mascara de ejes en movimiento)
+        frames = []
+        while not self.__telemetry.empty():
+            frames.append(self.__telemetry.get())
+        return frames
+
+    def __read(self):
+        buffer = b""
+        response = ""
+        while True:
+            try:
+                data = self.__socket.recv(4096)
+            except (OSError, AttributeError):
+                break
+            if not data:
+                break
+            buffer += data
+            lines = buffer.split(b"\n")
+            buffer = lines.pop()
+            for raw in lines:
+                line = raw.decode('utf-8')
+                if line.startswith("!TEL:"):
+                    fields = line[5:].split(";")
+                    self.__telemetry.put((int(fields[0]), [float(x) for x in fields[1:-1]], int(fields[-1])))
+                elif line.startswith("!"):
+                    self.__events.put(line[1:])
+                elif line == ">":
+                    self.__responses.put(response)
+                    response = ""
+                else:
+                    response += line + "\n"
@@ -0,0 +1,202 @@
+# -*- coding: utf-8 -*-
+"""
+Programas de comandos almacenados en el controlador, equivalente a FIPC_Program del firmware.
+
+Una receta se escribe en un lenguaje minimo (una instruccion por linea, '#' inicia un
+comentario), se compila a codigo compacto, se carga en tramos ("PRGW:"), se confirma
+("PRGC:") y se ejecuta en el controlador ("PRGRUN:") sin intervencion del host:
+
+    pos carga 15000 15000 15000 90000 0 0   # posicion con nombre (ejes #1 a #6)
+    goto carga                              # SYNCAF hacia la posicion (goto carga T ta)
+    wait                                    # espera el reposo de todos los ejes (wait 1 2)
+    set v0 0
+    loop 10                                 # lazo (la cantidad puede ser una variable)
+      move rel 1 50                         # MR del eje #1 (move abs 1 v2 para MA)
+      wait 1
+      trigger 4 1 500                       # espera la GPIO 4 en 1, como maximo 500 ms
+      add v0 1
+      PSOP:1:4:1:                           # cualquier otra linea es una lista de comandos de la API
+    end
+    getpos v1 1                             # lee la posicion del eje #1
+    storepos 1                              # guarda la posicion actual de los ejes
+    delay 250
+
+Las operaciones aritmeticas son set, add, sub, mul y div (variables v0 a v15). Las
+funciones upload() y run() reciben la funcion que envia un comando y retorna la
+respuesta, por ejemplo FIPC_controler.ask o FIPC_Controler.sendData del emulador.
+"""
+
+import struct
+from module_stage_config import crc16
+
+PROGRAM_MAGIC = 0x46495031   # "FIP1"
+PROGRAM_VERSION = 1
+PROGRAM_CODE_SIZE = 1024
+PROGRAM_POSITIONS = 16
+PROGRAM_AXIS_NUMBERS = 6
+PROGRAM_VARIABLES = 16
+PROGRAM_LOOP_DEPTH = 4
+PROGRAM_CHUNK = 112          # bytes por tramo, entra en una solicitud de 256 caracteres
+PROGRAM_CONST = 0xFF
+
+OP_END, OP_CMD, OP_MOVE, OP_MOVEPOS, OP_WAIT, OP_TRIGGER, OP_DELAY, OP_SET, OP_ADD, OP_SUB, \
+    OP_MUL, OP_DIV, OP_GETPOS, OP_STOREPOS, OP_LOOP, OP_NEXT = range(16)
+
+_HEADER = struct.Struct("<IHHHH")
+_ARITHMETIC = {"set":OP_SET, "add":OP_ADD, "sub":OP_SUB, "mul":OP_MUL, "div":OP_DIV}
+
+# comandos que inician un desplazamiento: from_commands() agrega una espera a continuacion
+MOTION_COMMANDS = ("HA", "H", "HRA", "HR", "MR", "MA", "SYNCR", "SYNCA", "SYNCRF", "SYNCAF",
+                   "KMA", "KMR", "SCANGO", "ALIGN")
+
+
+class Program:
+    def __init__(self):
+        self.code = bytearray()
+        self.positions = [[0.0]*PROGRAM_AXIS_NUMBERS for ii in range(PROGRAM_POSITIONS)]
+        self.names = {}
+
+    def pack(self):
+        code = bytes(self.code)
+        if not code or code[-1] != OP_END:
+            code += bytes([OP_END])
+        if len(code) > PROGRAM_CODE_SIZE:
+            raise ValueError("Programa demasiado largo (%d bytes)" % len(code))
+        body = b"".join(struct.pack("<6f", *pos) for pos in self.positions) + code
+        return _HEADER.pack(PROGRAM_MAGIC, PROGRAM_VERSION, len(code), crc16(body), 0) + body
+
+
+def _operand(text):
+    if text.startswith("v"):
+        index = int(text[1:])
+        if not 0 <= index < PROGRAM_VARIABLES:
+            raise ValueError("Variable invalida: " + text)
+        return bytes([index])
+    return bytes([PROGRAM_CONST]) + struct.pack("<f", float(text))
+
+
+def _variable(text):
+    if not text.startswith("v"):
+        raise ValueError("Se esperaba una variable: " + text)
+    return _operand(text)
+
+
+def _position(program, text):
+    if text in program.names:
+        return program.names[text]
+    index = int(text)
+    if not 0 <= index < PROGRAM_POSITIONS:
+        raise ValueError("Posicion invalida: " + text)
+    return index
+
+
+def _axis(text):
+    axis = int(text)
+    if not 1 <= axis <= PROGRAM_AXIS_NUMBERS:
+        raise ValueError("Eje invalido: " + text)
+    return axis
+
+
+def _command(text):
+    data = text.encode("ascii")
+    if not text.endswith(":") or not 0 < len(data) < 256:
+        raise ValueError("Comando invalido: " + text)
+    if any(token.startswith("PRG") for token in text.split(":")):
+        raise ValueError("Un programa no puede controlar programas: " + text)
+    return bytes([OP_CMD, len(data)]) + data
+
+
+def compile(source):
+    # retorna un Program a partir del texto de la receta
+    program = Program()
+    code = program.code
+    depth = 0
+    for number, line in enumerate(source.splitlines(), 1):
+        line = line.split("#")[0].strip()
+        if not line:
+            continue
+        words = line.split()
+        name, args = words[0].lower(), words[1:]
+        try:
+            if ":" in line:
+                code += _command(line)
+            elif name == "pos":
+                if not args[0].isdigit() and args[0] not in program.names:
+                    program.names[args[0]] = len(program.names)
+                values = [float(v) for v in args[1:]]
+                if len(values) != PROGRAM_AXIS_NUMBERS:
+                    raise ValueError("Se esperaban %d coordenadas" % PROGRAM_AXIS_NUMBERS)
+                program.positions[_position(program, args[0])] = values
+            elif name in _ARITHMETIC:
+                code += bytes([_ARITHMETIC[name]]) + _variable(args[0])[:1] + _operand(args[1])
+            elif name == "loop":
+                depth += 1
+                if depth > PROGRAM_LOOP_DEPTH:
+                    raise ValueError("Demasiados lazos anidados")
+                code += bytes([OP_LOOP]) + _operand(args[0])
+            elif name == "end":
+                if depth == 0:
+                    raise ValueError("'end' sin 'loop'")
+                depth -= 1
+                code += bytes([OP_NEXT])
+            elif name == "stop":
+                code += bytes([OP_END])
+            elif name == "wait":
+                mask = 0
+                for axis in args or range(1, PROGRAM_AXIS_NUMBERS+1):
+                    mask |= 1 << (_axis(str(axis))-1)
+                code += bytes([OP_WAIT, mask])
+            elif name == "trigger":
+                pin, level = int(args[0]), int(args[1])
+                code += bytes([OP_TRIGGER, pin, 1 if level else 0]) + _operand(args[2] if len(args) > 2 else "0")
+            elif name == "delay":
+                code += bytes([OP_DELAY]) + _operand(args[0])
+            elif name == "move":
+                mode = {"rel":0, "abs":1}[args[0]]
+                code += bytes([OP_MOVE, mode, _axis(args[1])]) + _operand(args[2])
+            elif name == "goto":
+                code += bytes([OP_MOVEPOS, _position(program, args[0])])
+                code += _operand(args[1] if len(args) > 1 else "0") + _operand(args[2] if len(args) > 2 else "0")
+            elif name == "getpos":
+                code += bytes([OP_GETPOS]) + _variable(args[0])[:1] + bytes([_axis(args[1])])
+            elif name == "storepos":
+                code += bytes([OP_STOREPOS, _position(program, args[0])])
+            else:
+                raise ValueError("Instruccion desconocida: " + name)
+        except (IndexError, KeyError, ValueError) as error:
+            raise ValueError("Linea %d: %s (%s)" % (number, line, error))
+    if depth:
+        raise ValueError("Falta 'end' en %d lazos" % depth)
+    return program
+
+
+def from_commands(commands):
+    # convierte una secuencia de comandos de la API (como la enviaria el host, uno por
+    # solicitud) en una receta: se espera el reposo de los ejes luego de cada desplazamiento
+    lines = []
+    for command in commands:
+        lines.append(command)
+        if any(token in MOTION_COMMANDS for token in command.split(":")):
+            lines.append("wait")
+    return compile("\n".join(lines))
+
+
+def upload(send, program):
+    # carga y confirma un programa, no debe haber uno en ejecucion
+    data = program.pack()
+    for offset in range(0, len(data), PROGRAM_CHUNK):
+        chunk = data[offset:offset+PROGRAM_CHUNK].hex()
+        if send("PRGW:%d:%s:" % (offset, chunk)).strip() != "1":
+            return False
+    return send("PRGC:").strip() == "1"
+
+
+def run(send):
+    # inicia el programa guardado, el fin se informa con el evento "PRG:estado;instruccion;crc"
+    return send("PRGRUN:").strip() == "1"
+
+
+def status(send):
+    # retorna (estado, instruccion, crc)
+    state, pc, crc = send("?PRG:").strip().split(";")
+    return state, int(pc), int(crc)
@@ -0,0 +1,172 @@
+# -*- coding: utf-8 -*-
+"""
+Grabacion y reproduccion de sesiones del controlador, equivalente a FIPC_Recorder del firmware.
+
+Con "REC:1:" el controlador registra cada solicitud con su instante en us, los cambios de
+estado de los ejes y los ciclos de tiempo real de mas de 80 us. El registro se descarga con
+download(), se guarda con save() y se reproduce con replay() en el emulador (o en otro
+controlador) con los tiempos originales o lo mas rapido posible:
+
+    data = session.download(fipc.ask)             # controlador en produccion
+    session.save("sesion.bin", data)
+    report = session.replay(usb0.sendData, session.parse(session.load("sesion.bin")))
+    print(session.compare(session.summary(session.parse(data)), report))
+
+Formato (little-endian): cada registro es instante en us desde "REC:1:" (uint32), tipo
+(uint8), bytes de datos (uint8) y los datos:
+    REC_AXIS     eje (uint8), posicion (float) y estado inicial en texto
+    REC_REQUEST  texto de la solicitud
+    REC_STATE    eje (uint8) y nuevo estado en texto
+    REC_EXEC     duracion del ciclo de tiempo real en us (uint16)
+
+Para reproducir el registro en el firmware compilado en la PC, con el reloj simulado y las
+estadisticas de exec() de FIPC_Recorder, se usa firmware/host_test (HostReplay.h):
+
+    make -C firmware/host_test replay LOG=$PWD/sesion.bin SCALE=0.1
+
+Las funciones reciben la funcion que envia un comando y retorna la respuesta, por ejemplo
+FIPC_controler.ask, FIPC_network.ask o FIPC_Controler.sendData del emulador.
+"""
+
+import struct
+import time
+from collections import namedtuple
+
+REC_AXIS = 0
+REC_REQUEST = 1
+REC_STATE = 2
+REC_EXEC = 3
+RECORDER_HEADER = 6
+RECORDER_CHUNK = 256         # bytes por respuesta de "?RECD:"
+
+MOVING = ("Homing", "Moving", "Jogging", "Tracking")
+
+Record = namedtuple("Record", "time type axis position text duration")
+
+def download(ask):
+    # detiene la grabacion y lee el registro en tramos
+    ask("REC:0:")
+    size = int(ask("?REC:").split(";")[1])
+    data = b""
+    while len(data) < size:
+        chunk = bytes.fromhex(ask("?RECD:%d:" % len(data)).strip())
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+def save(path, data):
+    with open(path, "wb") as file:
+        file.write(data)
+
+def load(path):
+    with open(path, "rb") as file:
+        return file.read()
+
+def parse(data):
+    # lista de registros; los instantes se extienden a mas de 32 bits si el contador dio la vuelta
+    records = []
+    offset = 0
+    last = 0
+    wraps = 0
+    while offset + RECORDER_HEADER <= len(data):
+        stamp, type, size = struct.unpack_from("<IBB", data, offset)
+        payload = data[offset+RECORDER_HEADER:offset+RECORDER_HEADER+size]
+        offset += RECORDER_HEADER + size
+        if stamp < last:
+            wraps += 1
+        last = stamp
+        stamp += wraps << 32
+        if type == REC_AXIS:
+            axis, position = struct.unpack_from("<Bf", payload)
+            records.append(Record(stamp, type, axis, position, payload[5:].decode(), 0))
+        elif type == REC_REQUEST:
+            records.append(Record(stamp, type, 0, 0.0, payload.decode(), 0))
+        elif type == REC_STATE:
+            records.append(Record(stamp, type, payload[0], 0.0, payload[1:].decode(), 0))
+        elif type == REC_EXEC:
+            records.append(Record(stamp, type, 0, 0.0, "", struct.unpack_from("<H", payload)[0]))
+    return records
+
+def summary(records):
+    # estadisticas de una sesion: solicitudes, duracion, tiempo con algun eje en movimiento y ciclos lentos
+    status = {}
+    moving = 0
+    since = None
+    end = 0
+    for record in records:
+        if record.type in (REC_AXIS, REC_STATE):
+            status[record.axis] = record.text
+            active = any(value in MOVING for value in status.values())
+            if active and since is None:
+                since = record.time
+            elif not active and since is not None:
+                moving += record.time - since
+                since = None
+        end = max(end, record.time)
+    if since is not None:
+        moving += end - since
+    execs = [record.duration for record in records if record.type == REC_EXEC]
+    return {"requests": sum(1 for record in records if record.type == REC_REQUEST),
+            "transitions": sum(1 for record in records if record.type == REC_STATE),
+            "duration": end*1e-6,
+            "motion": moving*1e-6,
+            "slowCycles": len(execs),
+            "slowMax": max(execs) if execs else 0}
+
+def prepare(ask, records, timeout=120.0):
+    # lleva los ejes referenciados a la posicion inicial de la sesion (requiere buscar el cero)
+    start = {record.axis: record for record in records if record.type == REC_AXIS}
+    if not any(record.text == "Ready" for record in start.values()):
+        return
+    ask("E:HA:")
+    _wait(ask, timeout, lambda report: report.count("Ready") >= len(start))
+    target = [start[axis].position if axis in start else 0.0 for axis in sorted(start)]
+    ask("SYNCAF:" + "".join("%.3f:" % value for value in target))
+    _wait(ask, timeout)
+
+def replay(ask, records, realtime=True, timeout=120.0):
+    # envia las solicitudes con los tiempos originales (realtime) o sin esperas, graba la
+    # reproduccion y retorna su resumen con el tiempo de atencion de las solicitudes
+    requests = [record for record in records if record.type == REC_REQUEST]
+    ask("REC:1:")
+    service = []
+    lag = 0.0
+    t0 = time.monotonic()
+    for record in requests:
+        if realtime:
+            wait = t0 + record.time*1e-6 - time.monotonic()
+            if wait > 0:
+                time.sleep(wait)
+            lag = max(lag, -wait)
+        start = time.monotonic()
+        ask(record.text)
+        service.append(time.monotonic() - start)
+    _wait(ask, timeout)
+    report = summary(parse(download(ask)))
+    report["requests"] = len(requests)    # sin las consultas de la espera final
+    service.sort()
+    report["serviceMean"] = sum(service)/len(service) if service else 0.0
+    report["serviceP99"] = service[int(len(service)*0.99)] if service else 0.0
+    report["serviceMax"] = service[-1] if service else 0.0
+    report["lag"] = lag
+    return report
+
+def compare(recorded, replayed):
+    lines = []
+    for key in ("requests", "transitions", "duration", "motion", "slowCycles", "slowMax"):
+        lines.append("%-12s %12.3f %12.3f" % (key, recorded[key], replayed[key]))
+    for key in ("serviceMean", "serviceP99", "serviceMax", "lag"):
+        if key in replayed:
+            lines.append("%-12s %12s %12.4f" % (key, "", replayed[key]))
+    return "\n".join(lines)
+
+def _wait(ask, timeout, done=None):
+    # espera el reposo de todos los ejes
+    limit = time.monotonic() + timeout
+    while time.monotonic() < limit:
+        report = ask("?RA:")
+        if done(report) if done else not any(value in report for value in MOVING):
+            return True
+        time.sleep(0.05)
+    return False
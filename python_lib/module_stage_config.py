@@ -0,0 +1,90 @@
+# -*- coding: utf-8 -*-
+"""
+Bloque binario de configuracion de los ejes, equivalente a FIPC_Config del firmware.
+
+Permite leer la configuracion activa del controlador ("?CFGD:"), modificarla y cargarla
+en tramos ("CFGW:") para luego confirmarla ("CFGC:"). Las funciones read() y write()
+reciben la funcion que envia un comando y retorna la respuesta, por ejemplo
+FIPC_controler.ask o FIPC_Controler.sendData del emulador.
+"""
+
+import struct
+
+CONFIG_MAGIC = 0x46494331    # "FIC1"
+CONFIG_VERSION = 2
+CONFIG_AXIS_NUMBERS = 8      # registros en el bloque (los que no se usan en cero)
+CONFIG_CHUNK = 112           # bytes por tramo, entra en una solicitud de 256 caracteres
+
+INVERT_DIR = 0x01            # invierte el sentido de giro
+HOME_POSITIVE = 0x02         # busca la referencia hacia coordenadas positivas
+LIMITS = 0x04                # supervisa los fines de carrera
+PULSE_RMT = 0x08             # desplazamientos con el periferico RMT (hasta 150 kHz)
+MICROSTEP = 0x10             # pasos gruesos en el crucero y finos en la aproximacion (DRV8825)
+MICROSTEP_NONE = 0xFF        # entrada MODE con nivel fijo
+
+STAGES = {"MOX_02_30":0, "MOR_100_30":1, "MOG_65_10":2, "MOG_65_15":3}
+
+_HEADER = struct.Struct("<IHBB")
+_AXIS = struct.Struct("<8B8s6f5B3x")
+_TAIL = struct.Struct("<HH")
+_FIELDS = ("stage", "flags", "pinStep", "pinDir", "pinEnable", "pinPositive", "pinNegative", "pinRef",
+           "units", "stepsPerUnit", "minPosition", "maxPosition", "veloMax", "accelMax", "zero",
+           "pinMode0", "pinMode1", "pinMode2", "stepFine", "stepCoarse")
+# campos de la version 2: GPIO de MODE0..MODE2 y modos de micropasos (log2, 5 = 1/32) de
+# stepsPerUnit (fino) y del crucero (grueso), solo se usan con MICROSTEP
+_DEFAULTS = {"pinMode0":MICROSTEP_NONE, "pinMode1":MICROSTEP_NONE, "pinMode2":MICROSTEP_NONE,
+             "stepFine":0, "stepCoarse":0}
+
+
+def crc16(data):
+    # CRC-16 (CCITT), igual que FIPC_Storage::crc16()
+    out = 0xFFFF
+    for byte in data:
+        out ^= byte << 8
+        for jj in range(8):
+            out = ((out << 1) ^ 0x1021) if out & 0x8000 else (out << 1)
+            out &= 0xFFFF
+    return out
+
+
+def pack(axes):
+    # axes: lista de diccionarios con los campos de _FIELDS (uno por eje, los de _DEFAULTS son opcionales)
+    data = _HEADER.pack(CONFIG_MAGIC, CONFIG_VERSION, len(axes), 0)
+    for ii in range(CONFIG_AXIS_NUMBERS):
+        if ii < len(axes):
+            axis = dict(_DEFAULTS)
+            axis.update(axes[ii])
+            axis["units"] = axis["units"].encode("ascii")
+            data += _AXIS.pack(*[axis[name] for name in _FIELDS])
+        else:
+            data += bytes(_AXIS.size)
+    return data + _TAIL.pack(crc16(data), 0)
+
+
+def unpack(data):
+    magic, version, count, reserved = _HEADER.unpack_from(data)
+    if magic != CONFIG_MAGIC or version != CONFIG_VERSION:
+        raise ValueError("Formato de configuracion desconocido")
+    if crc16(data[:-_TAIL.size]) != _TAIL.unpack_from(data, len(data)-_TAIL.size)[0]:
+        raise ValueError("CRC de configuracion invalido")
+    axes = []
+    for ii in range(count):
+        axis = dict(zip(_FIELDS, _AXIS.unpack_from(data, _HEADER.size + ii*_AXIS.size)))
+        axis["units"] = axis["units"].split(b"\0")[0].decode("ascii")
+        axes.append(axis)
+    return axes
+
+
+def read(send):
+    # retorna la configuracion activa de todos los ejes
+    return unpack(bytes.fromhex(send("?CFGD:").strip()))
+
+
+def write(send, axes):
+    # carga y confirma una configuracion, todos los ejes deben estar deshabilitados ("D:")
+    data = pack(axes)
+    for offset in range(0, len(data), CONFIG_CHUNK):
+        chunk = data[offset:offset+CONFIG_CHUNK].hex()
+        if send("CFGW:%d:%s:" % (offset, chunk)).strip() != "1":
+            return False
+    return send("CFGC:").strip() == "1"
@@ -0,0 +1,106 @@
+# -*- coding: utf-8 -*-
+"""
+Sincronizacion de varios controladores con una linea de disparo, equivalente a FIPC_Sync del firmware.
+
+Los controladores se conectan con un cable en la misma GPIO: uno es el lider ("LINK:1:pin:")
+y el resto seguidores ("LINK:2:pin:"). Los comandos enviados con arm() quedan retenidos en cada
+controlador y fire() los inicia en todos a la vez con el pulso del lider:
+
+    sync.setup(input.ask, [output.ask], pin=4)
+    sync.arm(input.ask, "SYNCRF:100:0:0:0:0:0:")
+    sync.arm(output.ask, "SYNCRF:-100:0:0:0:0:0:")
+    sync.fire(input.ask, [input.ask, output.ask])
+
+Cada controlador registra el instante del ultimo disparo con su reloj, por lo que edgeOffsets()
+da la diferencia entre los relojes con la precision de la interrupcion. clockOffset() estima
+la diferencia entre el reloj de un controlador y el de la PC a partir de "?CLK:", y toHost()
+lleva los instantes de la telemetria ("!TEL:ms;...") a la base de tiempo de la PC.
+
+Las funciones reciben la funcion que envia un comando y retorna la respuesta, por ejemplo
+FIPC_controler.ask, FIPC_network.ask o FIPC_Controler.sendData del emulador.
+"""
+
+import time
+
+LINK_OFF = 0
+LINK_LEADER = 1
+LINK_FOLLOWER = 2
+
+CLOCK_WRAP = 1 << 32         # los relojes del controlador son contadores de 32 bits en us
+
+def setup(leader, followers, pin):
+    leader("LINK:%d:%d:" % (LINK_LEADER, pin))
+    for ask in followers:
+        ask("LINK:%d:%d:" % (LINK_FOLLOWER, pin))
+
+def release(asks):
+    for ask in asks:
+        ask("LINK:%d:0:" % LINK_OFF)
+
+def arm(ask, commands):
+    # las acciones de los comandos se retienen hasta el proximo disparo
+    return ask("LINKARM:" + commands)
+
+def cancel(asks):
+    for ask in asks:
+        ask("LINKX:")
+
+def status(ask):
+    fields = ask("?LINK:").strip().split(";")
+    return {"role": int(fields[0]), "held": fields[1]=="1", "ready": fields[2]=="1",
+            "edges": int(fields[3]), "edgeTime": int(fields[4])}
+
+def fire(leader, asks, timeout=5.0):
+    # espera que todos los controladores con acciones retenidas puedan iniciarlas en el ciclo
+    # del disparo (posicion guardada en memoria no volatil) y dispara
+    limit = time.monotonic() + timeout
+    while True:
+        states = [status(ask) for ask in asks]
+        if all(state["ready"] for state in states if state["held"]):
+            break
+        if time.monotonic() > limit:
+            return False
+        time.sleep(0.01)
+    leader("LINKGO:")
+    return True
+
+def edgeOffsets(leader, followers):
+    # diferencia en us entre el reloj de cada seguidor y el del lider, medida en el ultimo
+    # disparo (None si el seguidor no registro el mismo disparo)
+    reference = status(leader)
+    offsets = []
+    for ask in followers:
+        state = status(ask)
+        if state["edges"]!=reference["edges"]:
+            offsets.append(None)
+        else:
+            offsets.append(_signed(state["edgeTime"] - reference["edgeTime"]))
+    return offsets
+
+def clockOffset(ask, samples=16):
+    # diferencia en us entre el reloj del controlador y time.monotonic(): se conserva la
+    # muestra de menor tiempo de ida y vuelta, con la respuesta en su punto medio
+    best = None
+    for ii in range(samples):
+        t0 = time.monotonic()
+        clock = int(ask("?CLK:").strip())
+        t1 = time.monotonic()
+        rtt = (t1 - t0)*1e6
+        offset = clock - (t0 + t1)*0.5e6
+        if best is None or rtt < best[1]:
+            best = (offset, rtt)
+    return best
+
+def toHost(frames, offset, reference=None):
+    # telemetria de FIPC_network.readTelemetry() con los instantes en segundos de time.monotonic()
+    reference = time.monotonic() if reference is None else reference
+    out = []
+    for ms, positions, moving in frames:
+        host = (ms*1000 - offset)
+        host += round((reference*1e6 - host)/CLOCK_WRAP)*CLOCK_WRAP   # vueltas del contador de 32 bits
+        out.append((host*1e-6, positions, moving))
+    return out
+
+def _signed(value):
+    value %= CLOCK_WRAP
+    return value - CLOCK_WRAP if value >= CLOCK_WRAP//2 else value